@@ -60,6 +60,10 @@ enum eProcessStatus
 /** @todo r=bird: Most defines in this file needs to be scoped a little
  *        better!  For instance INPUT_FLAG_NONE is very generic. */
 
+/** Guest property the Guest Additions advertise the most process input they
+ *  accept per message in (decimal byte count). */
+#define GUEST_CONTROL_PROP_MAX_INPUT_SIZE   "/VirtualBox/GuestAdd/GuestControl/MaxInputSize"
+
 /**
  * Input flags, set by the host. This is needed for
  * handling flags on the guest side.
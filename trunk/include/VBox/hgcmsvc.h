@@ -61,9 +61,10 @@
  * 4.1->4.2 Because the VBOX_HGCM_SVC_PARM_CALLBACK parameter type was added
  * 4.2->5.1 Removed the VBOX_HGCM_SVC_PARM_CALLBACK parameter type, as
  *          this problem is already solved by service extension callbacks
+ * 5.1->5.2 Because fFlags and cWorkers were added
  */
 #define VBOX_HGCM_SVC_VERSION_MAJOR (0x0005)
-#define VBOX_HGCM_SVC_VERSION_MINOR (0x0001)
+#define VBOX_HGCM_SVC_VERSION_MINOR (0x0002)
 #define VBOX_HGCM_SVC_VERSION ((VBOX_HGCM_SVC_VERSION_MAJOR << 16) + VBOX_HGCM_SVC_VERSION_MINOR)
 
 
@@ -353,6 +354,23 @@ typedef FNHGCMSVCEXT *PFNHGCMSVCEXT;
  *  with function pointers.
  */
 
+/** @name VBOX_HGCM_SVC_F_XXX - Service flags (VBOXHGCMSVCFNTABLE::fFlags).
+ * @{ */
+/** Guest calls are executed on a pool of worker threads rather than the
+ * service thread, so a slow call doesn't hold up the others.  pfnCall must be
+ * thread safe.  All the other entry points are still called on the service
+ * thread, and only while no pfnCall is executing. */
+#define VBOX_HGCM_SVC_F_CALL_WORKERS        UINT32_C(0x00000001)
+/** Together with VBOX_HGCM_SVC_F_CALL_WORKERS: calls from the same client are
+ * executed one at a time and in the order they were made. */
+#define VBOX_HGCM_SVC_F_CALL_CLIENT_ORDERED UINT32_C(0x00000002)
+/** Mask of valid flags. */
+#define VBOX_HGCM_SVC_F_VALID_MASK          UINT32_C(0x00000003)
+/** @} */
+
+/** The max number of worker threads for VBOX_HGCM_SVC_F_CALL_WORKERS. */
+#define VBOX_HGCM_SVC_MAX_WORKERS           16
+
 /* The structure is used in separately compiled binaries so an explicit packing is required. */
 #pragma pack(1) /** @todo r=bird: The pragma pack(1) is not at all required!! */
 typedef struct VBOXHGCMSVCFNTABLE
@@ -410,6 +428,13 @@ typedef struct VBOXHGCMSVCFNTABLE
     /** User/instance data pointer for the service. */
     void *pvService;
 
+    /** VBOX_HGCM_SVC_F_XXX. */
+    uint32_t                 fFlags;
+
+    /** Number of worker threads with VBOX_HGCM_SVC_F_CALL_WORKERS, 0 for the
+     *  default.  Capped at VBOX_HGCM_SVC_MAX_WORKERS. */
+    uint32_t                 cWorkers;
+
     /** @} */
 } VBOXHGCMSVCFNTABLE;
 #pragma pack()
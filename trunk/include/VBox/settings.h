@@ -273,6 +273,7 @@ protected:
                             const MediaRegistry &mr);
     void buildNATForwardRulesMap(xml::ElementNode &elmParent, const NATRulesMap &mapRules);
     void buildNATLoopbacks(xml::ElementNode &elmParent, const NATLoopbackOffsetList &natLoopbackList);
+    void writeDocument();
     void clearDocument();
 
     struct Data;
@@ -104,6 +104,14 @@
 #define SHFL_FN_SYMLINK             (19)
 /** Ask host to show symlinks (as of VBox 4.0) */
 #define SHFL_FN_SET_SYMLINKS        (20)
+/** Open, read and close a file in one call (as of VBox 5.2) */
+#define SHFL_FN_CREATE_READ_CLOSE   (21)
+/** Read several ranges of a file in one call (as of VBox 5.2) */
+#define SHFL_FN_READ_VEC            (22)
+/** Write several ranges of a file in one call (as of VBox 5.2) */
+#define SHFL_FN_WRITE_VEC           (23)
+/** Open and list a directory in one call (as of VBox 5.2) */
+#define SHFL_FN_LIST_DIR            (24)
 
 /** @} */
 
@@ -1395,6 +1403,176 @@ typedef struct _VBoxSFSymlink
 #define SHFL_CPARMS_SYMLINK  (4)
 
 
+/**
+ * SHFL_FN_CREATE_READ_CLOSE
+ *
+ * Combines SHFL_FN_CREATE, SHFL_FN_READ and SHFL_FN_CLOSE for small files.
+ * The handle is always closed before returning, so SHFLCREATEPARMS::Handle
+ * is SHFL_HANDLE_NIL on return.  If the object could not be opened, the
+ * call succeeds with SHFLCREATEPARMS::Result telling why and cb set to 0.
+ * Directories and creating new objects are not allowed.
+ */
+
+/** Parameters structure. */
+typedef struct _VBoxSFCreateReadClose
+{
+    VBGLIOCHGCMCALL callInfo;
+
+    /** value32, in: SHFLROOT
+     * Root handle of the mapping.
+     */
+    HGCMFunctionParameter root;
+
+    /** pointer, in:
+     * Points to SHFLSTRING buffer.
+     */
+    HGCMFunctionParameter path;
+
+    /** pointer, in/out:
+     * Points to SHFLCREATEPARMS buffer.
+     */
+    HGCMFunctionParameter parms;
+
+    /** value64, in:
+     * Offset to read from.
+     */
+    HGCMFunctionParameter offset;
+
+    /** value32, in/out:
+     * Bytes to read/How many were read.
+     */
+    HGCMFunctionParameter cb;
+
+    /** pointer, out:
+     * Buffer to place data to.
+     */
+    HGCMFunctionParameter buffer;
+
+} VBoxSFCreateReadClose;
+
+/** Number of parameters */
+#define SHFL_CPARMS_CREATE_READ_CLOSE (6)
+
+
+/**
+ * SHFL_FN_READ_VEC, SHFL_FN_WRITE_VEC
+ *
+ * The data of all segments is packed back to back in the buffer, in segment
+ * order.  Processing stops at the first failing or short segment; cbDone of
+ * each segment tells how much was transferred.
+ */
+
+/** I/O segment. */
+typedef struct SHFLIOSEG
+{
+    /** In: File offset. */
+    uint64_t    off;
+    /** In: Number of bytes to transfer. */
+    uint32_t    cb;
+    /** Out: Number of bytes actually transferred. */
+    uint32_t    cbDone;
+} SHFLIOSEG;
+AssertCompileSize(SHFLIOSEG, 16);
+/** Pointer to an I/O segment. */
+typedef SHFLIOSEG *PSHFLIOSEG;
+
+/** Maximum number of segments per call. */
+#define SHFL_MAX_IOSEGS         (64)
+
+/** Parameters structure. */
+typedef struct _VBoxSFReadWriteVec
+{
+    VBGLIOCHGCMCALL callInfo;
+
+    /** value32, in: SHFLROOT
+     * Root handle of the mapping.
+     */
+    HGCMFunctionParameter root;
+
+    /** value64, in:
+     * SHFLHANDLE of object to read from/write to.
+     */
+    HGCMFunctionParameter handle;
+
+    /** value32, in:
+     * Number of segments.
+     */
+    HGCMFunctionParameter cSegs;
+
+    /** pointer, in/out:
+     * Array of SHFLIOSEG.
+     */
+    HGCMFunctionParameter segs;
+
+    /** pointer, in (write) or out (read):
+     * Data buffer, may be passed as a page list.
+     */
+    HGCMFunctionParameter buffer;
+
+} VBoxSFReadWriteVec;
+
+/** Number of parameters */
+#define SHFL_CPARMS_READ_VEC    (5)
+/** Number of parameters */
+#define SHFL_CPARMS_WRITE_VEC   (5)
+
+
+/**
+ * SHFL_FN_LIST_DIR
+ *
+ * Opens the directory and returns as many SHFLDIRINFO entries (with full
+ * object information) as fit.  If the listing is complete the directory is
+ * closed and handle returns SHFL_HANDLE_NIL, otherwise the open handle is
+ * returned and the listing continues with SHFL_FN_LIST / SHFL_FN_CLOSE.
+ */
+
+/** Parameters structure. */
+typedef struct _VBoxSFListDir
+{
+    VBGLIOCHGCMCALL callInfo;
+
+    /** value32, in: SHFLROOT
+     * Root handle of the mapping.
+     */
+    HGCMFunctionParameter root;
+
+    /** pointer, in:
+     * Points to SHFLSTRING buffer with the directory path.
+     */
+    HGCMFunctionParameter path;
+
+    /** value32, in:
+     * List flags SHFL_LIST_*.
+     */
+    HGCMFunctionParameter flags;
+
+    /** value32, in/out:
+     * Bytes to be used for listing information/How many bytes were used.
+     */
+    HGCMFunctionParameter cb;
+
+    /** pointer, out:
+     * Buffer to place listing information to. (SHFLDIRINFO)
+     */
+    HGCMFunctionParameter buffer;
+
+    /** value32, out:
+     * Number of files returned.
+     */
+    HGCMFunctionParameter cFiles;
+
+    /** value64, out:
+     * SHFLHANDLE of the directory if the listing is incomplete,
+     * SHFL_HANDLE_NIL otherwise.
+     */
+    HGCMFunctionParameter handle;
+
+} VBoxSFListDir;
+
+/** Number of parameters */
+#define SHFL_CPARMS_LIST_DIR (7)
+
+
 
 /**
  * SHFL_FN_ADD_MAPPING
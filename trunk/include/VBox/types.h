@@ -1029,6 +1029,9 @@ typedef const struct DBGFINFOHLP *PCDBGFINFOHLP;
 /** Pointer to a const register descriptor. */
 typedef struct DBGFREGDESC const *PCDBGFREGDESC;
 
+/** Pointer to a const memory scan needle. */
+typedef struct DBGFMEMSCANNEEDLE const *PCDBGFMEMSCANNEEDLE;
+
 
 /** Configuration manager tree node - A key. */
 typedef struct CFGMNODE *PCFGMNODE;
@@ -1440,9 +1440,23 @@ VMMR3DECL(int) DBGFR3DisasInstrLogInternal(PVMCPU pVCpu, RTSEL Sel, RTGCPTR GCPt
 #endif
 
 
+/**
+ * A byte string to search for with DBGFR3MemScanMulti.
+ */
+typedef struct DBGFMEMSCANNEEDLE
+{
+    /** The byte string to search for. */
+    void const         *pvNeedle;
+    /** The length of the byte string. */
+    size_t              cbNeedle;
+} DBGFMEMSCANNEEDLE;
+
 #ifdef IN_RING3
 VMMR3DECL(int) DBGFR3MemScan(PUVM pUVM, VMCPUID idCpu, PCDBGFADDRESS pAddress, RTGCUINTPTR cbRange, RTGCUINTPTR uAlign,
                              const void *pvNeedle, size_t cbNeedle, PDBGFADDRESS pHitAddress);
+VMMR3DECL(int) DBGFR3MemScanMulti(PUVM pUVM, VMCPUID idCpu, PCDBGFADDRESS pAddress, RTGCUINTPTR cbRange, RTGCUINTPTR uAlign,
+                                  PCDBGFMEMSCANNEEDLE paNeedles, uint32_t cNeedles, PDBGFADDRESS pHitAddress,
+                                  uint32_t *piNeedle);
 VMMR3DECL(int) DBGFR3MemRead(PUVM pUVM, VMCPUID idCpu, PCDBGFADDRESS pAddress, void *pvBuf, size_t cbRead);
 VMMR3DECL(int) DBGFR3MemReadString(PUVM pUVM, VMCPUID idCpu, PCDBGFADDRESS pAddress, char *pszBuf, size_t cbBuf);
 VMMR3DECL(int) DBGFR3MemWrite(PUVM pUVM, VMCPUID idCpu, PCDBGFADDRESS pAddress, void const *pvBuf, size_t cbRead);
@@ -2247,7 +2261,22 @@ VMMR3DECL(int)      DBGFR3OSQueryNameAndVersion(PUVM pUVM, char *pszName, size_t
 VMMR3DECL(void *)   DBGFR3OSQueryInterface(PUVM pUVM, DBGFOSINTERFACE enmIf);
 
 
+/** @name DBGFCOREWRITE_F_XXX - Flags for DBGFR3CoreWriteEx.
+ * @{ */
+/** Replace (/overwrite) any existing file. */
+#define DBGFCOREWRITE_F_REPLACE         RT_BIT_32(0)
+/** Compress the core file using gzip.  Zero pages cannot be left out of a
+ * compressed file, but they compress to next to nothing. */
+#define DBGFCOREWRITE_F_GZIP            RT_BIT_32(1)
+/** Only stop the EMTs while collecting the CPU states and copy the guest memory
+ * while the VM keeps running.  The memory image is therefore not consistent. */
+#define DBGFCOREWRITE_F_LIVE            RT_BIT_32(2)
+/** Mask of valid flags. */
+#define DBGFCOREWRITE_F_VALID_MASK      UINT32_C(0x00000007)
+/** @} */
+
 VMMR3DECL(int)      DBGFR3CoreWrite(PUVM pUVM, const char *pszFilename, bool fReplaceFile);
+VMMR3DECL(int)      DBGFR3CoreWriteEx(PUVM pUVM, const char *pszFilename, uint32_t fFlags);
 
 
 #ifdef IN_RING3
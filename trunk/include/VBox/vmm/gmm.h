@@ -383,8 +383,12 @@ typedef struct GMMSTATS
     uint32_t            cFreedChunks;
     /** The number of shareable modules (GMM:cShareableModules). */
     uint64_t            cShareableModules;
-    /** Space reserved for later. */
-    uint64_t            au64Reserved[2];
+    /** The number of private pages replaced by an identical shared page by the
+     * content deduplication scanner (GMM::cDedupMergedPages). */
+    uint64_t            cDedupMergedPages;
+    /** The number of times a VM replaced a shared page by a private copy because
+     * it was written to (GMM::cSharedPageCowBreaks). */
+    uint64_t            cSharedPageCowBreaks;
 
     /** Statistics for the specified VM. (Zero filled if not requested.) */
     GMMVMSTATS          VMStats;
@@ -704,6 +708,60 @@ typedef GMMUNREGISTERSHAREDMODULEREQ *PGMMUNREGISTERSHAREDMODULEREQ;
 
 GMMR0DECL(int) GMMR0UnregisterSharedModuleReq(PGVM pGVM, PVM pVM, VMCPUID idCpu, PGMMUNREGISTERSHAREDMODULEREQ pReq);
 
+/**
+ * Page descriptor for GMMR0DedupCheckPage.
+ */
+typedef struct GMMDEDUPPAGEDESC
+{
+    /** HC Physical address (in/out) */
+    RTHCPHYS                    HCPhys;
+    /** GC Physical address (in) */
+    RTGCPHYS                    GCPhys;
+    /** GMM page id. (in/out)
+     * Set to NIL_GMM_PAGEID on return if the page wasn't changed. */
+    uint32_t                    idPage;
+    /** The content hash of the page as of the previous scan, 0 if not known.
+     * (in/out) */
+    uint32_t                    uHash;
+} GMMDEDUPPAGEDESC;
+/** Pointer to a GMMDEDUPPAGEDESC. */
+typedef GMMDEDUPPAGEDESC *PGMMDEDUPPAGEDESC;
+
+GMMR0DECL(int) GMMR0DedupCheckPage(PGVM pGVM, PGMMDEDUPPAGEDESC pPageDesc);
+
+/** The max number of pages GMMR0DedupScanPagesReq will scan in one go. */
+#define GMM_DEDUP_SCAN_MAX_PAGES                4096
+
+/**
+ * Request buffer for GMMR0DedupScanPagesReq / VMMR0_DO_GMM_DEDUP_SCAN_PAGES.
+ * @see GMMR0DedupScanPages.
+ */
+typedef struct GMMDEDUPSCANREQ
+{
+    /** The header. */
+    SUPVMMR0REQHDR              Hdr;
+    /** The guest physical address of the first page to scan. (in) */
+    RTGCPHYS                    GCPhysFirst;
+    /** The number of pages to scan, the size of the auHashes array. (in) */
+    uint32_t                    cPages;
+    /** The number of pages that had the same content hash as during the previous
+     * scan and thus were considered for merging. (out) */
+    uint32_t                    cStablePages;
+    /** The number of private pages that were converted into new shared pages
+     * because an identical page was found elsewhere. (out) */
+    uint32_t                    cNewSharedPages;
+    /** The number of private pages that were replaced by an existing identical
+     * shared page. (out) */
+    uint32_t                    cMergedPages;
+    /** The content hash of each page as of the previous scan, 0 if not known.
+     * Updated on return. (in/out) */
+    uint32_t                    auHashes[1];
+} GMMDEDUPSCANREQ;
+/** Pointer to a GMMR0DedupScanPagesReq / VMMR0_DO_GMM_DEDUP_SCAN_PAGES request buffer. */
+typedef GMMDEDUPSCANREQ *PGMMDEDUPSCANREQ;
+
+GMMR0DECL(int) GMMR0DedupScanPagesReq(PGVM pGVM, PVM pVM, VMCPUID idCpu, PGMMDEDUPSCANREQ pReq);
+
 #if defined(VBOX_STRICT) && HC_ARCH_BITS == 64
 /**
  * Request buffer for GMMR0FindDuplicatePageReq / VMMR0_DO_GMM_FIND_DUPLICATE_PAGE.
@@ -793,6 +851,7 @@ GMMR3DECL(int)  GMMR3RegisterSharedModule(PVM pVM, PGMMREGISTERSHAREDMODULEREQ p
 GMMR3DECL(int)  GMMR3UnregisterSharedModule(PVM pVM, PGMMUNREGISTERSHAREDMODULEREQ pReq);
 GMMR3DECL(int)  GMMR3CheckSharedModules(PVM pVM);
 GMMR3DECL(int)  GMMR3ResetSharedModules(PVM pVM);
+GMMR3DECL(int)  GMMR3DedupScanPages(PVM pVM, PGMMDEDUPSCANREQ pReq);
 
 # if defined(VBOX_STRICT) && HC_ARCH_BITS == 64
 GMMR3DECL(bool) GMMR3IsDuplicatePage(PVM pVM, uint32_t idPage);
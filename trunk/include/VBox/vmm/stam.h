@@ -1238,6 +1238,20 @@ typedef FNSTAMR3ENUM *PFNSTAMR3ENUM;
 VMMR3DECL(int)  STAMR3Enum(PUVM pUVM, const char *pszPat, PFNSTAMR3ENUM pfnEnum, void *pvUser);
 VMMR3DECL(const char *) STAMR3GetUnit(STAMUNIT enmUnit);
 
+/** Pointer to a binary snapshot context (opaque). */
+typedef struct STAMBINSNAP *PSTAMBINSNAP;
+
+/** Binary snapshot header magic ('STB1'). */
+#define STAMBINSNAP_MAGIC           UINT32_C(0x31425453)
+/** Binary snapshot header flag: The sample definitions are included and the
+ * values are relative to zero.  Set for the first snapshot and whenever the
+ * set of matching samples changed. */
+#define STAMBINSNAP_F_FULL          RT_BIT_32(0)
+
+VMMR3DECL(int)  STAMR3BinSnapshotCreate(PUVM pUVM, const char *pszPat, PSTAMBINSNAP *phSnap);
+VMMR3DECL(int)  STAMR3BinSnapshotTake(PSTAMBINSNAP hSnap, const void **ppvData, size_t *pcbData);
+VMMR3DECL(int)  STAMR3BinSnapshotDestroy(PSTAMBINSNAP hSnap);
+
 /** @} */
 
 /** @} */
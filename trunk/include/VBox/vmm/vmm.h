@@ -449,6 +449,8 @@ typedef enum VMMR0OPERATION
     VMMR0_DO_GMM_RESET_SHARED_MODULES,
     /** Call GMMR0CheckSharedModules. */
     VMMR0_DO_GMM_CHECK_SHARED_MODULES,
+    /** Call GMMR0DedupScanPagesReq. */
+    VMMR0_DO_GMM_DEDUP_SCAN_PAGES,
     /** Call GMMR0FindDuplicatePage. */
     VMMR0_DO_GMM_FIND_DUPLICATE_PAGE,
     /** Call GMMR0QueryStatistics(). */
@@ -1078,6 +1078,18 @@ public:
      */
     void write(const char *pcszFilename, bool fSafe);
 
+    /**
+     * Calculates the SHA-256 digest of the serialized document, i.e. of the
+     * file content write() would produce, without writing anything.
+     *
+     * This allows callers to skip rewriting (and flushing) unchanged files.
+     *
+     * @returns IPRT status code.
+     * @param   pabDigest       Where to return the digest (RTSHA256_HASH_SIZE
+     *                          bytes).
+     */
+    int digest(uint8_t *pabDigest);
+
     static int WriteCallback(void *aCtxt, const char *aBuf, int aLen);
     static int CloseCallback(void *aCtxt);
 
@@ -1088,6 +1100,7 @@ public:
 
 private:
     void writeInternal(const char *pcszFilename, bool fSafe);
+    static int DigestCallback(void *pvUser, const char *pachBuf, int cbToWrite);
 
     /* Obscure class data */
     struct Data;
@@ -250,6 +250,8 @@ typedef RTDBGCFG           *PRTDBGCFG;
 #define RTDBGCFG_FLAGS_NO_RECURSIV_SEARCH           RT_BIT_64(3)
 /** Don't search the source paths recursively. */
 #define RTDBGCFG_FLAGS_NO_RECURSIV_SRC_SEARCH       RT_BIT_64(4)
+/** Load all the debug info when opening a module rather than on demand. */
+#define RTDBGCFG_FLAGS_NO_LAZY_LOADING              RT_BIT_64(5)
 /** @} */
 
 /**
@@ -1,6 +1,6 @@
 /* $Id$ */
 /** @file
- * IPRT Filesystem API (FileSys) - ext2/3 format.
+ * IPRT Filesystem API (FileSys) - ext2/3/4 format.
  */
 
 /*
@@ -32,8 +32,9 @@
 
 
 /*
- * The filesystem structures are from http://wiki.osdev.org/Ext2 and
- * http://www.nongnu.org/ext2-doc/ext2.html
+ * The filesystem structures are from http://wiki.osdev.org/Ext2,
+ * http://www.nongnu.org/ext2-doc/ext2.html and
+ * https://ext4.wiki.kernel.org/index.php/Ext4_Disk_Layout
  */
 
 /**
@@ -93,10 +94,100 @@ typedef struct EXT2SUPERBLOCK
     uint16_t    u16UidReservedBlocks;
     /** Group ID that is allowed to use reserved blocks. */
     uint16_t    u16GidReservedBlocks;
+    /** @name Dynamic revision (u32VersionMajor >= 1) fields.
+     * @{ */
+    /** First non-reserved inode number. */
+    uint32_t    iFirstInodeNonRsvd;
+    /** Size of the inode structure in bytes. */
+    uint16_t    cbInode;
+    /** Block group number of this super block. */
+    uint16_t    iBlkGrpSb;
+    /** Compatible feature set flags (EXT2_FEATURE_COMPAT_XXX). */
+    uint32_t    fFeaturesCompat;
+    /** Incompatible feature set flags (EXT2_FEATURE_INCOMPAT_XXX). */
+    uint32_t    fFeaturesIncompat;
+    /** Readonly-compatible feature set flags (EXT2_FEATURE_RO_COMPAT_XXX). */
+    uint32_t    fFeaturesCompatRo;
+    /** 128bit UUID for the volume. */
+    uint8_t     au8Uuid[16];
+    /** Volume name. */
+    char        achVolumeName[16];
+    /** Directory where the filesystem was mounted last. */
+    char        achLastMounted[64];
+    /** Bitmap usage algorithm (compression). */
+    uint32_t    u32AlgoUsageBitmap;
+    /** Number of blocks to try to preallocate for files. */
+    uint8_t     cBlocksPrealloc;
+    /** Number of blocks to try to preallocate for directories. */
+    uint8_t     cBlocksPreallocDirectory;
+    /** Number of reserved GDT entries for future filesystem expansion. */
+    uint16_t    cGdtEntriesRsvd;
+    /** UUID of the journal superblock. */
+    uint8_t     au8JournalUuid[16];
+    /** Inode number of the journal file. */
+    uint32_t    iJournalInode;
+    /** Device number of the journal file (if the appropriate feature flag is set). */
+    uint32_t    u32JournalDev;
+    /** Start of the list of orpahned inodes to delete. */
+    uint32_t    u32LastOrphan;
+    /** HTREE hash seed. */
+    uint32_t    au32HashSeedHtree[4];
+    /** Default hash version to use for directory hashes (EXT2_DIR_HASH_VER_XXX). */
+    uint8_t     u8HashVersionDef;
+    /** Journal backup type. */
+    uint8_t     u8JnlBackupType;
+    /** Size of group descriptors in bytes (if EXT2_FEATURE_INCOMPAT_64BIT is set). */
+    uint16_t    cbGroupDesc;
+    /** Default mount options. */
+    uint32_t    fMntOptsDef;
+    /** First metablock block group (if EXT2_FEATURE_INCOMPAT_META_BG is set). */
+    uint32_t    iFirstMetaBg;
+    /** Filesystem creation time. */
+    uint32_t    u32TimeFsCreation;
+    /** Backup copy of journal inodes block array. */
+    uint32_t    au32JnlBlocks[17];
+    /** High 32bits of the total number of blocks (if EXT2_FEATURE_INCOMPAT_64BIT is set). */
+    uint32_t    cBlocksTotalHigh;
+    /** High 32bits of the number of blocks reserved for the super user. */
+    uint32_t    cBlocksRsvdForSuperUserHigh;
+    /** High 32bits of the number of unallocated blocks. */
+    uint32_t    cBlocksUnallocatedHigh;
+    /** Minimum extra inode size all inodes have. */
+    uint16_t    cbInodesExtraMin;
+    /** Extra inode size new inodes should reserve. */
+    uint16_t    cbNewInodesRsv;
+    /** Miscellaneous flags (EXT2_SUPER_FLAGS_XXX). */
+    uint32_t    fFlags;
+    /** RAID stride, number of logical blocks read from or written to the disk before moving to the next disk. */
+    uint16_t    cRaidStride;
+    /** Number of seconds to wait in multi-mount prevention checking. */
+    uint16_t    cSecMmpInterval;
+    /** Block number for the multi-mount protection data. */
+    uint64_t    iMmpBlock;
+    /** RAID stride width (number of logical blocks to read or write before returning to the current disk). */
+    uint32_t    cRaidStrideWidth;
+    /** Number of block groups in a flex block group is 2^cLogGroupsPerFlex. */
+    uint8_t     cLogGroupsPerFlex;
+    /** Metadata checksum algorithm type. */
+    uint8_t     u8ChksumType;
+    /** Padding. */
+    uint16_t    u16Padding;
+    /** Number of KiB written to this filesystem over its lifetime. */
+    uint64_t    cKbWritten;
+    /** @} */
     /** Reserved fields. */
-    uint8_t     abReserved[940];
+    uint8_t     abReserved[636];
+    /** Checksum of the super block (if EXT2_FEATURE_RO_COMPAT_METADATA_CSUM is set). */
+    uint32_t    u32Chksum;
 } EXT2SUPERBLOCK;
 AssertCompileSize(EXT2SUPERBLOCK, 1024);
+AssertCompileMemberOffset(EXT2SUPERBLOCK, iFirstInodeNonRsvd, 0x54);
+AssertCompileMemberOffset(EXT2SUPERBLOCK, au32HashSeedHtree, 0xec);
+AssertCompileMemberOffset(EXT2SUPERBLOCK, cbGroupDesc, 0xfe);
+AssertCompileMemberOffset(EXT2SUPERBLOCK, cBlocksTotalHigh, 0x150);
+AssertCompileMemberOffset(EXT2SUPERBLOCK, fFlags, 0x160);
+AssertCompileMemberOffset(EXT2SUPERBLOCK, cLogGroupsPerFlex, 0x174);
+AssertCompileMemberOffset(EXT2SUPERBLOCK, u32Chksum, 0x3fc);
 /** Pointer to an ext2 super block. */
 typedef EXT2SUPERBLOCK *PEXT2SUPERBLOCK;
 /** Pointer to a const ext2 super block. */
@@ -109,6 +200,121 @@ typedef EXT2SUPERBLOCK const *PCEXT2SUPERBLOCK;
 /** Error filesystem state. */
 #define EXT2_STATE_ERRORS   UINT16_C(0x0002)
 
+/** Original revision level. */
+#define EXT2_REV_ORIG                               0
+/** Dynamic revision level (variable inode sizes, feature flags). */
+#define EXT2_REV_DYNAMIC                            1
+
+/** @name EXT2_FEATURE_COMPAT_XXX - Compatible features.
+ * @{ */
+/** Preallocate some number of blocks for new directories. */
+#define EXT2_FEATURE_COMPAT_DIR_PREALLOC            RT_BIT_32(0)
+/** AFS server inodes exist. */
+#define EXT2_FEATURE_COMPAT_IMAGIC_INODES           RT_BIT_32(1)
+/** The filesystem has a journal (ext3). */
+#define EXT2_FEATURE_COMPAT_HAS_JOURNAL             RT_BIT_32(2)
+/** Extended attributes are supported. */
+#define EXT2_FEATURE_COMPAT_EXT_ATTR                RT_BIT_32(3)
+/** Reserved GDT blocks for filesystem expansion. */
+#define EXT2_FEATURE_COMPAT_RESIZE_INODE            RT_BIT_32(4)
+/** Hashed (htree) directory indexes. */
+#define EXT2_FEATURE_COMPAT_DIR_INDEX               RT_BIT_32(5)
+/** Sparse superblock version 2. */
+#define EXT2_FEATURE_COMPAT_SPARSE_SUPER2           RT_BIT_32(9)
+/** @} */
+
+/** @name EXT2_FEATURE_INCOMPAT_XXX - Incompatible features.
+ * @{ */
+/** Compression support. */
+#define EXT2_FEATURE_INCOMPAT_COMPRESSION           RT_BIT_32(0)
+/** Directory entries record the file type. */
+#define EXT2_FEATURE_INCOMPAT_DIR_FILETYPE          RT_BIT_32(1)
+/** The journal needs recovery. */
+#define EXT2_FEATURE_INCOMPAT_RECOVER               RT_BIT_32(2)
+/** The filesystem is a journal device. */
+#define EXT2_FEATURE_INCOMPAT_JOURNAL_DEV           RT_BIT_32(3)
+/** Meta block groups. */
+#define EXT2_FEATURE_INCOMPAT_META_BG               RT_BIT_32(4)
+/** Files use extent trees (ext4). */
+#define EXT2_FEATURE_INCOMPAT_EXTENTS               RT_BIT_32(6)
+/** 64-bit block numbers and larger group descriptors. */
+#define EXT2_FEATURE_INCOMPAT_64BIT                 RT_BIT_32(7)
+/** Multiple mount protection. */
+#define EXT2_FEATURE_INCOMPAT_MMP                   RT_BIT_32(8)
+/** Flexible block groups, group metadata may live outside the group. */
+#define EXT2_FEATURE_INCOMPAT_FLEX_BG               RT_BIT_32(9)
+/** Large extended attribute values stored in inodes. */
+#define EXT2_FEATURE_INCOMPAT_EA_INODE              RT_BIT_32(10)
+/** Data in directory entries. */
+#define EXT2_FEATURE_INCOMPAT_DIRDATA               RT_BIT_32(12)
+/** Metadata checksum seed is stored in the super block. */
+#define EXT2_FEATURE_INCOMPAT_CSUM_SEED             RT_BIT_32(13)
+/** Large directories (> 2GB or 3-level htree). */
+#define EXT2_FEATURE_INCOMPAT_LARGEDIR              RT_BIT_32(14)
+/** Data stored inside the inode. */
+#define EXT2_FEATURE_INCOMPAT_INLINE_DATA           RT_BIT_32(15)
+/** Encrypted inodes are present. */
+#define EXT2_FEATURE_INCOMPAT_ENCRYPT               RT_BIT_32(16)
+/** Case-insensitive directories. */
+#define EXT2_FEATURE_INCOMPAT_CASEFOLD              RT_BIT_32(17)
+/** @} */
+
+/** @name EXT2_FEATURE_RO_COMPAT_XXX - Readonly compatible features.
+ * @{ */
+/** Sparse super blocks and group descriptor tables. */
+#define EXT2_FEATURE_RO_COMPAT_SPARSE_SUPER         RT_BIT_32(0)
+/** The filesystem contains files larger than 2GiB. */
+#define EXT2_FEATURE_RO_COMPAT_LARGE_FILE           RT_BIT_32(1)
+/** Btree directories (unused). */
+#define EXT2_FEATURE_RO_COMPAT_BTREE_DIR            RT_BIT_32(2)
+/** File sizes are represented in logical blocks rather than sectors. */
+#define EXT2_FEATURE_RO_COMPAT_HUGE_FILE            RT_BIT_32(3)
+/** Group descriptors have checksums. */
+#define EXT2_FEATURE_RO_COMPAT_GDT_CSUM             RT_BIT_32(4)
+/** No 32000 subdirectory limit. */
+#define EXT2_FEATURE_RO_COMPAT_DIR_NLINK            RT_BIT_32(5)
+/** Large inodes exist. */
+#define EXT2_FEATURE_RO_COMPAT_EXTRA_ISIZE          RT_BIT_32(6)
+/** Quota is handled as filesystem metadata. */
+#define EXT2_FEATURE_RO_COMPAT_QUOTA                RT_BIT_32(8)
+/** Allocation bitmaps track clusters of blocks. */
+#define EXT2_FEATURE_RO_COMPAT_BIGALLOC             RT_BIT_32(9)
+/** Metadata checksumming. */
+#define EXT2_FEATURE_RO_COMPAT_METADATA_CSUM        RT_BIT_32(10)
+/** Filesystem must be mounted readonly. */
+#define EXT2_FEATURE_RO_COMPAT_READONLY             RT_BIT_32(12)
+/** Project quotas. */
+#define EXT2_FEATURE_RO_COMPAT_PROJECT              RT_BIT_32(13)
+/** Verity inodes may be present. */
+#define EXT2_FEATURE_RO_COMPAT_VERITY               RT_BIT_32(15)
+/** @} */
+
+/** @name EXT2_SUPER_FLAGS_XXX - Super block flags.
+ * @{ */
+/** Signed directory hash in use. */
+#define EXT2_SUPER_FLAGS_DIRHASH_SIGNED             RT_BIT_32(0)
+/** Unsigned directory hash in use. */
+#define EXT2_SUPER_FLAGS_DIRHASH_UNSIGNED           RT_BIT_32(1)
+/** @} */
+
+/** @name EXT2_DIR_HASH_VER_XXX - Directory hash versions.
+ * @{ */
+/** Legacy hash. */
+#define EXT2_DIR_HASH_VER_LEGACY                    0
+/** Half MD4 hash. */
+#define EXT2_DIR_HASH_VER_HALF_MD4                  1
+/** Tiny encryption algorithm hash. */
+#define EXT2_DIR_HASH_VER_TEA                       2
+/** Unsigned legacy hash. */
+#define EXT2_DIR_HASH_VER_LEGACY_UNSIGNED           3
+/** Unsigned half MD4 hash. */
+#define EXT2_DIR_HASH_VER_HALF_MD4_UNSIGNED         4
+/** Unsigned tiny encryption algorithm hash. */
+#define EXT2_DIR_HASH_VER_TEA_UNSIGNED              5
+/** SIP hash (casefolded encrypted directories). */
+#define EXT2_DIR_HASH_VER_SIP                       6
+/** @} */
+
 /**
  * Block group descriptor.
  */
@@ -134,6 +340,432 @@ typedef struct EXT2BLOCKGROUPDESC
 AssertCompileSize(EXT2BLOCKGROUPDESC, 32);
 /** Pointer to an ext block group descriptor. */
 typedef EXT2BLOCKGROUPDESC *PEXT2BLOCKGROUPDESC;
+/** Pointer to a const ext block group descriptor. */
+typedef EXT2BLOCKGROUPDESC const *PCEXT2BLOCKGROUPDESC;
+
+/**
+ * Block group descriptor, 64-bit variant (EXT2_FEATURE_INCOMPAT_64BIT).
+ */
+typedef struct EXT4BLOCKGROUPDESC
+{
+    /** Low 32bits of the block address of the block bitmap. */
+    uint32_t    offBlockBitmapLow;
+    /** Low 32bits of the block address of the inode bitmap. */
+    uint32_t    offInodeBitmapLow;
+    /** Low 32bits of the start block address of the inode table. */
+    uint32_t    offInodeTableLow;
+    /** Low 16bits of the number of unallocated blocks in group. */
+    uint16_t    cBlocksUnallocatedLow;
+    /** Low 16bits of the number of unallocated inodes in group. */
+    uint16_t    cInodesUnallocatedLow;
+    /** Low 16bits of the number of directories in the group. */
+    uint16_t    cDirectoriesLow;
+    /** Block group flags (EXT4_BG_XXX). */
+    uint16_t    fFlags;
+    /** Low 32bits of the block address of the snapshot exclude bitmap. */
+    uint32_t    offSnapshotExclBitmapLow;
+    /** Low 16bits of the block bitmap checksum. */
+    uint16_t    u16ChksumBlockBitmapLow;
+    /** Low 16bits of the inode bitmap checksum. */
+    uint16_t    u16ChksumInodeBitmapLow;
+    /** Low 16bits of the unused inode count. */
+    uint16_t    cInodeTblUnusedLow;
+    /** Group descriptor checksum. */
+    uint16_t    u16Chksum;
+    /** High 32bits of the block address of the block bitmap. */
+    uint32_t    offBlockBitmapHigh;
+    /** High 32bits of the block address of the inode bitmap. */
+    uint32_t    offInodeBitmapHigh;
+    /** High 32bits of the start block address of the inode table. */
+    uint32_t    offInodeTableHigh;
+    /** High 16bits of the number of unallocated blocks in group. */
+    uint16_t    cBlocksUnallocatedHigh;
+    /** High 16bits of the number of unallocated inodes in group. */
+    uint16_t    cInodesUnallocatedHigh;
+    /** High 16bits of the number of directories in the group. */
+    uint16_t    cDirectoriesHigh;
+    /** High 16bits of the unused inode count. */
+    uint16_t    cInodeTblUnusedHigh;
+    /** High 32bits of the block address of the snapshot exclude bitmap. */
+    uint32_t    offSnapshotExclBitmapHigh;
+    /** High 16bits of the block bitmap checksum. */
+    uint16_t    u16ChksumBlockBitmapHigh;
+    /** High 16bits of the inode bitmap checksum. */
+    uint16_t    u16ChksumInodeBitmapHigh;
+    /** Padding. */
+    uint32_t    u32Padding;
+} EXT4BLOCKGROUPDESC;
+AssertCompileSize(EXT4BLOCKGROUPDESC, 64);
+/** Pointer to an ext4 block group descriptor. */
+typedef EXT4BLOCKGROUPDESC *PEXT4BLOCKGROUPDESC;
+/** Pointer to a const ext4 block group descriptor. */
+typedef EXT4BLOCKGROUPDESC const *PCEXT4BLOCKGROUPDESC;
+
+/** @name EXT4_BG_XXX - Block group flags.
+ * @{ */
+/** Inode table and bitmap are not initialized. */
+#define EXT4_BG_INODE_UNINIT                        RT_BIT(0)
+/** Block bitmap is not initialized. */
+#define EXT4_BG_BLOCK_UNINIT                        RT_BIT(1)
+/** Inode table is zeroed. */
+#define EXT4_BG_INODE_ZEROED                        RT_BIT(2)
+/** @} */
+
+/** Inode number of the root directory. */
+#define EXT2_INODE_NR_ROOT                          2
+/** Number of block pointers in the inode. */
+#define EXT2_INODE_BLOCK_ENTRIES                    15
+/** Number of direct block pointers in the inode. */
+#define EXT2_INODE_BLOCK_DIRECT_ENTRIES             12
+/** Index of the single indirect block pointer. */
+#define EXT2_INODE_BLOCK_IND                        12
+/** Index of the double indirect block pointer. */
+#define EXT2_INODE_BLOCK_DIND                       13
+/** Index of the triple indirect block pointer. */
+#define EXT2_INODE_BLOCK_TIND                       14
+
+/**
+ * Inode, original revision part.
+ */
+typedef struct EXT2INODE
+{
+    /** Type and permissions (unix mode). */
+    uint16_t    fMode;
+    /** Low 16bits of the owner user ID. */
+    uint16_t    uUidLow;
+    /** Low 32bits of the size in bytes. */
+    uint32_t    cbSizeLow;
+    /** Last access time. */
+    uint32_t    u32TimeLastAccess;
+    /** Last inode change time. */
+    uint32_t    u32TimeLastChange;
+    /** Last data modification time. */
+    uint32_t    u32TimeLastModification;
+    /** Deletion time. */
+    uint32_t    u32TimeDeletion;
+    /** Low 16bits of the group ID. */
+    uint16_t    uGidLow;
+    /** Hard link count. */
+    uint16_t    cHardLinks;
+    /** Low 32bits of the number of 512 byte sectors (or blocks, see EXT4_INODE_FLAGS_HUGE_FILE) in use. */
+    uint32_t    cBlocksLow;
+    /** Inode flags (EXT2_INODE_FLAGS_XXX). */
+    uint32_t    fFlags;
+    /** Operating system dependent field (Linux: inode version). */
+    uint32_t    u32OsDep1;
+    /** Block pointers, the extent tree root or inline data. */
+    uint32_t    au32Block[EXT2_INODE_BLOCK_ENTRIES];
+    /** File version (NFS). */
+    uint32_t    u32Generation;
+    /** Low 32bits of the extended attribute block. */
+    uint32_t    offExtAttrLow;
+    /** High 32bits of the size in bytes. */
+    uint32_t    cbSizeHigh;
+    /** Fragment address (obsolete). */
+    uint32_t    u32FragmentAddrObs;
+    /** High 16bits of the number of blocks in use. */
+    uint16_t    cBlocksHigh;
+    /** High 16bits of the extended attribute block. */
+    uint16_t    offExtAttrHigh;
+    /** High 16bits of the owner user ID. */
+    uint16_t    uUidHigh;
+    /** High 16bits of the group ID. */
+    uint16_t    uGidHigh;
+    /** Low 16bits of the inode checksum. */
+    uint16_t    u16ChksumLow;
+    /** Reserved. */
+    uint16_t    u16Rsvd;
+} EXT2INODE;
+AssertCompileSize(EXT2INODE, 128);
+AssertCompileMemberOffset(EXT2INODE, au32Block, 0x28);
+/** Pointer to an inode. */
+typedef EXT2INODE *PEXT2INODE;
+/** Pointer to a const inode. */
+typedef EXT2INODE const *PCEXT2INODE;
+
+/**
+ * Inode, including the dynamic revision extra fields.
+ */
+typedef struct EXT4INODE
+{
+    /** The original inode fields. */
+    EXT2INODE   Core;
+    /** Size of the extra fields following the original inode fields. */
+    uint16_t    cbInodeExtra;
+    /** High 16bits of the inode checksum. */
+    uint16_t    u16ChksumHigh;
+    /** Extra last inode change time bits (epoch and nanoseconds). */
+    uint32_t    u32ExtraTimeLastChange;
+    /** Extra last data modification time bits (epoch and nanoseconds). */
+    uint32_t    u32ExtraTimeLastModification;
+    /** Extra last access time bits (epoch and nanoseconds). */
+    uint32_t    u32ExtraTimeLastAccess;
+    /** File creation time. */
+    uint32_t    u32TimeCreation;
+    /** Extra file creation time bits (epoch and nanoseconds). */
+    uint32_t    u32ExtraTimeCreation;
+    /** High 32bits of the version number. */
+    uint32_t    u32VersionHigh;
+    /** Project ID. */
+    uint32_t    u32ProjectId;
+} EXT4INODE;
+AssertCompileSize(EXT4INODE, 160);
+/** Pointer to an inode with the extra fields. */
+typedef EXT4INODE *PEXT4INODE;
+/** Pointer to a const inode with the extra fields. */
+typedef EXT4INODE const *PCEXT4INODE;
+
+/** Nanosecond part of the extra time fields. */
+#define EXT4_INODE_EXTRA_TIME_NSEC(a_u32)           ((a_u32) >> 2)
+/** Epoch part of the extra time fields (bits 32 and 33 of the seconds). */
+#define EXT4_INODE_EXTRA_TIME_EPOCH(a_u32)          ((a_u32) & 0x3)
+
+/** @name EXT2_INODE_FLAGS_XXX - Inode flags.
+ * @{ */
+/** Secure deletion. */
+#define EXT2_INODE_FLAGS_SEC_DELETE                 RT_BIT_32(0)
+/** Undelete. */
+#define EXT2_INODE_FLAGS_UNDELETE                   RT_BIT_32(1)
+/** Compressed file. */
+#define EXT2_INODE_FLAGS_COMPRESSED                 RT_BIT_32(2)
+/** Synchronous updates. */
+#define EXT2_INODE_FLAGS_SYNC                       RT_BIT_32(3)
+/** Immutable file. */
+#define EXT2_INODE_FLAGS_IMMUTABLE                  RT_BIT_32(4)
+/** Append only file. */
+#define EXT2_INODE_FLAGS_APPEND_ONLY                RT_BIT_32(5)
+/** Do not dump the file. */
+#define EXT2_INODE_FLAGS_NO_DUMP                    RT_BIT_32(6)
+/** Do not update access time. */
+#define EXT2_INODE_FLAGS_NO_ACCESS_TIME             RT_BIT_32(7)
+/** Encrypted inode. */
+#define EXT2_INODE_FLAGS_ENCRYPTED                  RT_BIT_32(11)
+/** Hash indexed (htree) directory. */
+#define EXT2_INODE_FLAGS_INDEX                      RT_BIT_32(12)
+/** AFS magic directory. */
+#define EXT2_INODE_FLAGS_IMAGIC                     RT_BIT_32(13)
+/** File data must always be written through the journal. */
+#define EXT2_INODE_FLAGS_JOURNAL_DATA               RT_BIT_32(14)
+/** File tail should not be merged. */
+#define EXT2_INODE_FLAGS_NOTAIL                     RT_BIT_32(15)
+/** All directory entry data should be written synchronously. */
+#define EXT2_INODE_FLAGS_DIRSYNC                    RT_BIT_32(16)
+/** Top of directory hierarchy. */
+#define EXT2_INODE_FLAGS_TOP_DIR                    RT_BIT_32(17)
+/** This is a huge file (block count in filesystem blocks). */
+#define EXT4_INODE_FLAGS_HUGE_FILE                  RT_BIT_32(18)
+/** Inode uses extents. */
+#define EXT4_INODE_FLAGS_EXTENTS                    RT_BIT_32(19)
+/** Verity protected inode. */
+#define EXT4_INODE_FLAGS_VERITY                     RT_BIT_32(20)
+/** Inode stores a large extended attribute value in its data blocks. */
+#define EXT4_INODE_FLAGS_EA_INODE                   RT_BIT_32(21)
+/** Inode has inline data. */
+#define EXT4_INODE_FLAGS_INLINE_DATA                RT_BIT_32(28)
+/** Create children with the same project ID. */
+#define EXT4_INODE_FLAGS_PROJINHERIT                RT_BIT_32(29)
+/** Case-insensitive directory. */
+#define EXT4_INODE_FLAGS_CASEFOLD                   RT_BIT_32(30)
+/** @} */
+
+/** Size of the inline data stored in the block pointer array. */
+#define EXT4_INLINE_DATA_IN_INODE_SIZE              60
+
+/** Magic number of the in-inode extended attribute area. */
+#define EXT2_EA_INODE_MAGIC                         UINT32_C(0xea020000)
+
+/**
+ * Extended attribute entry.
+ */
+typedef struct EXT2XATTRENTRY
+{
+    /** Length of the name. */
+    uint8_t     cbName;
+    /** Attribute name index (EXT2_XATTR_INDEX_XXX). */
+    uint8_t     uNameIndex;
+    /** Offset of the value (relative to the first entry for in-inode attributes). */
+    uint16_t    offValue;
+    /** Inode holding the value (EXT2_FEATURE_INCOMPAT_EA_INODE), 0 if stored in place. */
+    uint32_t    iValueInode;
+    /** Size of the value in bytes. */
+    uint32_t    cbValue;
+    /** Hash of the attribute name and value. */
+    uint32_t    u32Hash;
+    /** The name, not terminated, padded to a 4 byte boundary. */
+    char        achName[1];
+} EXT2XATTRENTRY;
+AssertCompileMemberOffset(EXT2XATTRENTRY, achName, 16);
+/** Pointer to an extended attribute entry. */
+typedef EXT2XATTRENTRY *PEXT2XATTRENTRY;
+/** Pointer to a const extended attribute entry. */
+typedef EXT2XATTRENTRY const *PCEXT2XATTRENTRY;
+
+/** The system extended attribute namespace (holds "data" for inline data). */
+#define EXT2_XATTR_INDEX_SYSTEM                     7
+
+/**
+ * Directory entry.
+ */
+typedef struct EXT2DIRENTRY
+{
+    /** Inode number, 0 if the entry is unused. */
+    uint32_t    iInodeRef;
+    /** Size of the record, the next entry follows after this many bytes. */
+    uint16_t    cbRecord;
+    /** Length of the name (low 8 bits only if EXT2_FEATURE_INCOMPAT_DIR_FILETYPE is set). */
+    uint8_t     cbName;
+    /** File type (EXT2_TYPE_XXX) if EXT2_FEATURE_INCOMPAT_DIR_FILETYPE is set. */
+    uint8_t     uType;
+    /** The name, not terminated. */
+    char        achName[255];
+} EXT2DIRENTRY;
+AssertCompileMemberOffset(EXT2DIRENTRY, achName, 8);
+/** Pointer to a directory entry. */
+typedef EXT2DIRENTRY *PEXT2DIRENTRY;
+/** Pointer to a const directory entry. */
+typedef EXT2DIRENTRY const *PCEXT2DIRENTRY;
+
+/** Size of the fixed directory entry part. */
+#define EXT2_DIRENTRY_HDR_SIZE                      8
+
+/** @name EXT2_TYPE_XXX - Directory entry file types.
+ * @{ */
+#define EXT2_TYPE_UNKNOWN                           0
+#define EXT2_TYPE_REGULAR                           1
+#define EXT2_TYPE_DIRECTORY                         2
+#define EXT2_TYPE_CHRDEV                            3
+#define EXT2_TYPE_BLKDEV                            4
+#define EXT2_TYPE_FIFO                              5
+#define EXT2_TYPE_SOCKET                            6
+#define EXT2_TYPE_SYMLINK                           7
+/** Checksum tail pseudo entry at the end of leaf blocks (metadata_csum). */
+#define EXT2_TYPE_CHKSUM_TAIL                       0xde
+/** @} */
+
+/**
+ * Hash tree directory root information, following the '.' and '..' entries in
+ * the first directory block.
+ */
+typedef struct EXT2DIRHTREEROOTINFO
+{
+    /** Reserved, zero. */
+    uint32_t    u32Rsvd;
+    /** Hash version (EXT2_DIR_HASH_VER_XXX). */
+    uint8_t     uHashVersion;
+    /** Size of this structure (8). */
+    uint8_t     cbInfo;
+    /** Depth of the tree, 0 when the root points directly to leaf blocks. */
+    uint8_t     cIndirectLevels;
+    /** Flags, unused. */
+    uint8_t     fFlags;
+} EXT2DIRHTREEROOTINFO;
+AssertCompileSize(EXT2DIRHTREEROOTINFO, 8);
+
+/** Offset of the hash tree root information in the first directory block. */
+#define EXT2_DIR_HTREE_ROOT_INFO_OFF                0x18
+
+/**
+ * Hash tree index entry count and limit, occupying the hash field of the first
+ * index entry in a node.
+ */
+typedef struct EXT2DIRHTREECOUNTLIMIT
+{
+    /** Maximum number of index entries that fit. */
+    uint16_t    cLimit;
+    /** Number of index entries in use, including this one. */
+    uint16_t    cEntries;
+} EXT2DIRHTREECOUNTLIMIT;
+AssertCompileSize(EXT2DIRHTREECOUNTLIMIT, 4);
+
+/**
+ * Hash tree index entry.
+ */
+typedef struct EXT2DIRHTREEENTRY
+{
+    /** Lowest hash value of the block (the first entry holds the count and limit instead). */
+    uint32_t    u32Hash;
+    /** Logical directory block number. */
+    uint32_t    iBlock;
+} EXT2DIRHTREEENTRY;
+AssertCompileSize(EXT2DIRHTREEENTRY, 8);
+/** Pointer to a hash tree index entry. */
+typedef EXT2DIRHTREEENTRY *PEXT2DIRHTREEENTRY;
+/** Pointer to a const hash tree index entry. */
+typedef EXT2DIRHTREEENTRY const *PCEXT2DIRHTREEENTRY;
+
+/** Maximum depth of the hash tree (EXT2_FEATURE_INCOMPAT_LARGEDIR). */
+#define EXT2_DIR_HTREE_MAX_LEVELS                   3
+
+/**
+ * Extent tree node header.
+ */
+typedef struct EXT4EXTENTHDR
+{
+    /** Magic number (EXT4_EXTENT_HDR_MAGIC). */
+    uint16_t    u16Magic;
+    /** Number of valid entries following the header. */
+    uint16_t    cEntries;
+    /** Maximum number of entries that fit. */
+    uint16_t    cMax;
+    /** Depth of the tree below this node, 0 for leaf nodes. */
+    uint16_t    uDepth;
+    /** Generation of the tree. */
+    uint32_t    cGeneration;
+} EXT4EXTENTHDR;
+AssertCompileSize(EXT4EXTENTHDR, 12);
+/** Pointer to an extent tree node header. */
+typedef EXT4EXTENTHDR *PEXT4EXTENTHDR;
+/** Pointer to a const extent tree node header. */
+typedef EXT4EXTENTHDR const *PCEXT4EXTENTHDR;
+
+/** Magic number identifying an extent header. */
+#define EXT4_EXTENT_HDR_MAGIC                       UINT16_C(0xf30a)
+/** Maximum depth of an extent tree. */
+#define EXT4_EXTENT_MAX_DEPTH                       5
+
+/**
+ * Extent tree index node entry.
+ */
+typedef struct EXT4EXTENTIDX
+{
+    /** First logical block covered by this index entry. */
+    uint32_t    iBlock;
+    /** Low 32bits of the block number of the next level node. */
+    uint32_t    offChildLow;
+    /** High 16bits of the block number of the next level node. */
+    uint16_t    offChildHigh;
+    /** Reserved. */
+    uint16_t    u16Rsvd;
+} EXT4EXTENTIDX;
+AssertCompileSize(EXT4EXTENTIDX, 12);
+/** Pointer to an extent tree index entry. */
+typedef EXT4EXTENTIDX *PEXT4EXTENTIDX;
+/** Pointer to a const extent tree index entry. */
+typedef EXT4EXTENTIDX const *PCEXT4EXTENTIDX;
+
+/**
+ * Extent tree leaf node entry.
+ */
+typedef struct EXT4EXTENT
+{
+    /** First logical block covered by this extent. */
+    uint32_t    iBlock;
+    /** Number of blocks covered, values above EXT4_EXTENT_LENGTH_LIMIT denote
+     * uninitialized extents (length is the value minus the limit). */
+    uint16_t    cBlocks;
+    /** High 16bits of the first physical block. */
+    uint16_t    offStartHigh;
+    /** Low 32bits of the first physical block. */
+    uint32_t    offStartLow;
+} EXT4EXTENT;
+AssertCompileSize(EXT4EXTENT, 12);
+/** Pointer to an extent tree leaf entry. */
+typedef EXT4EXTENT *PEXT4EXTENT;
+/** Pointer to a const extent tree leaf entry. */
+typedef EXT4EXTENT const *PCEXT4EXTENT;
+
+/** Maximum length of an initialized extent. */
+#define EXT4_EXTENT_LENGTH_LIMIT                    UINT16_C(0x8000)
 
 #endif
 
@@ -120,7 +120,11 @@ RTDECL(int) RTFsFatVolFormat144(RTVFSFILE hVfsFile, bool fQuick);
 
 
 /**
- * Opens an EXT2 file system volume.
+ * Opens an EXT2/3/4 file system volume.
+ *
+ * The volume is accessed read-only.  Extent mapped files, hash tree indexed
+ * directories, inline data and 64-bit/meta block group layouts are supported,
+ * the journal is ignored.
  *
  * @returns IPRT status code.
  * @param   hVfsFileIn      The file or device backing the volume.
@@ -2248,6 +2248,93 @@ RTDECL(bool) RTLogSetBuffering(PRTLOGGER pLogger, bool fBuffered);
  */
 RTDECL(uint32_t) RTLogSetGroupLimit(PRTLOGGER pLogger, uint32_t cMaxEntriesPerGroup);
 
+#ifdef IN_RING3
+/** The max number of arguments a binary log record can carry. */
+# define RTLOG_BIN_MAX_ARGS     6
+
+/** @name RTLOGBINARG_XXX - Binary log argument types.
+ * The types of the arguments given to RTLogBinLoggerEx, RTLOGBINARG_SHIFT bits
+ * per argument with the first argument in the lowest bits.  Use the
+ * RTLOGBINARGSn macros to construct the list.
+ * @{ */
+/** No more arguments. */
+# define RTLOGBINARG_END        0
+/** 32-bit integer, or anything else promoted to int/unsigned. */
+# define RTLOGBINARG_U32        1
+/** 64-bit integer. */
+# define RTLOGBINARG_U64        2
+/** Pointer (%p, %s, %Rhxs, ...). */
+# define RTLOGBINARG_PTR        3
+/** size_t, uintptr_t and similar. */
+# if ARCH_BITS == 64
+#  define RTLOGBINARG_SIZE      RTLOGBINARG_U64
+# else
+#  define RTLOGBINARG_SIZE      RTLOGBINARG_U32
+# endif
+/** The number of bits per argument type. */
+# define RTLOGBINARG_SHIFT      4
+/** The argument type mask. */
+# define RTLOGBINARG_MASK       UINT32_C(0xf)
+/** Argument type list for no arguments. */
+# define RTLOGBINARGS0()                        RTLOGBINARG_END
+/** Argument type list for one argument. */
+# define RTLOGBINARGS1(a1)                      ((uint32_t)(a1))
+/** Argument type list for two arguments. */
+# define RTLOGBINARGS2(a1, a2)                  (RTLOGBINARGS1(a1) | ((uint32_t)(a2) << RTLOGBINARG_SHIFT))
+/** Argument type list for three arguments. */
+# define RTLOGBINARGS3(a1, a2, a3)              (RTLOGBINARGS2(a1, a2) | ((uint32_t)(a3) << (RTLOGBINARG_SHIFT * 2)))
+/** Argument type list for four arguments. */
+# define RTLOGBINARGS4(a1, a2, a3, a4)          (RTLOGBINARGS3(a1, a2, a3) | ((uint32_t)(a4) << (RTLOGBINARG_SHIFT * 3)))
+/** Argument type list for five arguments. */
+# define RTLOGBINARGS5(a1, a2, a3, a4, a5)      (RTLOGBINARGS4(a1, a2, a3, a4) | ((uint32_t)(a5) << (RTLOGBINARG_SHIFT * 4)))
+/** Argument type list for six arguments. */
+# define RTLOGBINARGS6(a1, a2, a3, a4, a5, a6)  (RTLOGBINARGS5(a1, a2, a3, a4, a5) | ((uint32_t)(a6) << (RTLOGBINARG_SHIFT * 5)))
+/** @} */
+
+/**
+ * Enables the binary per-thread logging fast path (RTLogBinLoggerEx).
+ *
+ * Each thread calling RTLogBinLoggerEx gets a private lock-free ring buffer
+ * storing the format string pointer and raw arguments.  The records are
+ * formatted and written to the normal destinations (including the ring
+ * buffer) when the logger is flushed, either by RTLogFlush, RTLogDestroy or
+ * the optional flusher thread.  Records are merged in time stamp order, while
+ * the prefixes reflect the time of formatting.
+ *
+ * @returns IPRT status code.
+ * @param   pLogger             The logger instance (NULL is an alias for the
+ *                              default logger).
+ * @param   cEntriesPerThread   The number of records per thread, power of two.
+ *                              0 means default.  When a buffer is full new
+ *                              records are dropped and counted.
+ * @param   cMsFlushInterval    The flusher thread interval, RT_INDEFINITE_WAIT
+ *                              for no flusher thread.
+ */
+RTDECL(int) RTLogBinEnable(PRTLOGGER pLogger, uint32_t cEntriesPerThread, RTMSINTERVAL cMsFlushInterval);
+
+/**
+ * Write a binary record to a logger instance.
+ *
+ * This does the same filtering as RTLogLoggerEx, but defers the formatting.
+ * If RTLogBinEnable hasn't been called it falls back on RTLogLoggerExV.
+ *
+ * @param   pLogger     Pointer to logger instance. If NULL the default logger
+ *                      instance will be attempted.
+ * @param   fFlags      The logging flags.
+ * @param   iGroup      The group.
+ * @param   pszFormat   Format string.  Must stay valid until the logger is
+ *                      destroyed (i.e. usually a string literal).  Each
+ *                      conversion must consume exactly one argument, i.e.
+ *                      no '*' widths or precisions.
+ * @param   fArgTypes   The argument types, see RTLOGBINARGSn.  At most
+ *                      RTLOG_BIN_MAX_ARGS arguments.
+ * @param   ...         The arguments.  Arguments pointing to data (%s,
+ *                      %Rhxs, ...) are only allowed for data that stays
+ *                      valid until the logger is flushed.
+ */
+RTDECL(void) RTLogBinLoggerEx(PRTLOGGER pLogger, unsigned fFlags, unsigned iGroup, const char *pszFormat, uint32_t fArgTypes, ...);
+#endif /* IN_RING3 */
+
 #ifndef IN_RC
 /**
  * Get the current log flags as a string.
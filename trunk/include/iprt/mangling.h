@@ -1246,6 +1246,8 @@
 # define RTLockValidatorWriteLockInc                    RT_MANGLER(RTLockValidatorWriteLockInc)
 # define RTLogBackdoorPrintf                            RT_MANGLER(RTLogBackdoorPrintf) /* r0drv-guest */
 # define RTLogBackdoorPrintfV                           RT_MANGLER(RTLogBackdoorPrintfV) /* r0drv-guest */
+# define RTLogBinEnable                                 RT_MANGLER(RTLogBinEnable)
+# define RTLogBinLoggerEx                               RT_MANGLER(RTLogBinLoggerEx)
 # define RTLogCalcSizeForR0                             RT_MANGLER(RTLogCalcSizeForR0)
 # define RTLogClearFileDelayFlag                        RT_MANGLER(RTLogClearFileDelayFlag)
 # define RTLogCloneRC                                   RT_MANGLER(RTLogCloneRC)
@@ -1347,6 +1349,7 @@
 # define RTMemCacheCreate                               RT_MANGLER(RTMemCacheCreate)
 # define RTMemCacheDestroy                              RT_MANGLER(RTMemCacheDestroy)
 # define RTMemCacheFree                                 RT_MANGLER(RTMemCacheFree)
+# define RTMemCacheQueryStats                           RT_MANGLER(RTMemCacheQueryStats)
 # define RTMemContAlloc                                 RT_MANGLER(RTMemContAlloc) /* r0drv */
 # define RTMemContFree                                  RT_MANGLER(RTMemContFree) /* r0drv */
 # define RTMemDump                                      RT_MANGLER(RTMemDump)
@@ -2603,6 +2606,7 @@
 # define RTVfsCreateProgressForIoStream                 RT_MANGLER(RTVfsCreateProgressForIoStream)
 # define RTVfsCreateReadAheadForFile                    RT_MANGLER(RTVfsCreateReadAheadForFile)
 # define RTVfsCreateReadAheadForIoStream                RT_MANGLER(RTVfsCreateReadAheadForIoStream)
+# define RTVfsReadAheadQueryConsumed                    RT_MANGLER(RTVfsReadAheadQueryConsumed)
 # define RTZipBlockCompress                             RT_MANGLER(RTZipBlockCompress)
 # define RTZipBlockDecompress                           RT_MANGLER(RTZipBlockDecompress)
 # define RTZipCompCreate                                RT_MANGLER(RTZipCompCreate)
@@ -2612,7 +2616,9 @@
 # define RTZipDecompCreate                              RT_MANGLER(RTZipDecompCreate)
 # define RTZipDecompDestroy                             RT_MANGLER(RTZipDecompDestroy)
 # define RTZipDecompress                                RT_MANGLER(RTZipDecompress)
+# define RTZipGzipCompressFinish                        RT_MANGLER(RTZipGzipCompressFinish)
 # define RTZipGzipCompressIoStream                      RT_MANGLER(RTZipGzipCompressIoStream)
+# define RTZipGzipDecompressFile                        RT_MANGLER(RTZipGzipDecompressFile)
 # define RTZipGzipDecompressIoStream                    RT_MANGLER(RTZipGzipDecompressIoStream)
 # define RTZipGzipCmd                                   RT_MANGLER(RTZipGzipCmd)
 # define RTZipPkzipFsStreamFromIoStream                 RT_MANGLER(RTZipPkzipFsStreamFromIoStream)
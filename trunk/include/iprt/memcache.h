@@ -149,6 +149,54 @@ RTDECL(int)     RTMemCacheAllocEx(RTMEMCACHE hMemCache, void **ppvObj);
  */
 RTDECL(void)    RTMemCacheFree(RTMEMCACHE hMemCache, void *pvObj);
 
+/**
+ * Memory cache statistics (RTMemCacheQueryStats).
+ */
+typedef struct RTMEMCACHESTATS
+{
+    /** The object size. */
+    uint32_t    cbObject;
+    /** The total number of objects in the cache pages. */
+    uint32_t    cTotal;
+    /** The number of free objects in the pages, i.e. not counting the ones
+     *  sitting in magazines. */
+    uint32_t    cFree;
+    /** The number of free objects sitting in magazines. */
+    uint32_t    cInMagazines;
+    /** The number of magazines allocated. */
+    uint32_t    cMagazines;
+    /** The number of magazine slots, 0 if the magazine layer is disabled. */
+    uint32_t    cSlots;
+    /** The total number of successful allocations. */
+    uint64_t    cAllocs;
+    /** The total number of frees. */
+    uint64_t    cFrees;
+    /** The number of allocations satisfied by a magazine. */
+    uint64_t    cMagazineAllocs;
+    /** The number of frees absorbed by a magazine. */
+    uint64_t    cMagazineFrees;
+    /** The number of magazine exchanges with the depot. */
+    uint64_t    cDepotExchanges;
+    /** The number of times a thread found its magazine slots busy. */
+    uint64_t    cSlotBusy;
+    /** The number of times the magazines were reaped to satisfy an allocation. */
+    uint64_t    cReaps;
+} RTMEMCACHESTATS;
+/** Pointer to memory cache statistics. */
+typedef RTMEMCACHESTATS *PRTMEMCACHESTATS;
+
+/**
+ * Queries the statistics of a memory cache.
+ *
+ * The numbers are gathered without stopping other threads using the cache, so
+ * they are only approximate while the cache is in use.
+ *
+ * @returns IPRT status code.
+ * @param   hMemCache           The cache handle.
+ * @param   pStats              Where to return the statistics.
+ */
+RTDECL(int)     RTMemCacheQueryStats(RTMEMCACHE hMemCache, PRTMEMCACHESTATS pStats);
+
 /** @} */
 
 RT_C_DECLS_END
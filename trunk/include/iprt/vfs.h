@@ -1660,6 +1660,19 @@ RTDECL(int) RTVfsCreateReadAheadForIoStream(RTVFSIOSTREAM hVfsIos, uint32_t fFla
 RTDECL(int) RTVfsCreateReadAheadForFile(RTVFSFILE hVfsFile, uint32_t fFlags, uint32_t cBuffers, uint32_t cbBuffer,
                                         PRTVFSFILE phVfsFile);
 
+/**
+ * Queries how many bytes the consumer has read from a read ahead I/O stream.
+ *
+ * Unlike RTVfsIoStrmTell, this may be called from a different thread than the
+ * one reading from the stream, e.g. for progress reporting.
+ *
+ * @returns IPRT status code.
+ * @retval  VERR_INVALID_HANDLE if @a hVfsIos isn't a read ahead stream.
+ * @param   hVfsIos     The read ahead I/O stream (or file) handle.
+ * @param   pcbConsumed Where to return the byte count.
+ */
+RTDECL(int) RTVfsReadAheadQueryConsumed(RTVFSIOSTREAM hVfsIos, uint64_t *pcbConsumed);
+
 
 /**
  * Create a file system stream for writing to a directory.
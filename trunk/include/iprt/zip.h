@@ -225,7 +225,7 @@ RTDECL(int)     RTZipBlockDecompress(RTZIPTYPE enmType, uint32_t fFlags,
  * @param   hVfsIosIn           The compressed input stream (must be readable).
  *                              The reference is not consumed, instead another
  *                              one is retained.
- * @param   fFlags              Flags, MBZ.
+ * @param   fFlags              RTZIPGZIPDECOMP_F_XXX.
  * @param   phVfsIosGunzip      Where to return the handle to the gunzipped I/O
  *                              stream (read).
  */
@@ -235,9 +235,34 @@ RTDECL(int) RTZipGzipDecompressIoStream(RTVFSIOSTREAM hVfsIosIn, uint32_t fFlags
  * @{ */
 /** Allow the smaller ZLIB header as well as the regular GZIP header. */
 #define RTZIPGZIPDECOMP_F_ALLOW_ZLIB_HDR    RT_BIT(0)
+/** Decompress streams written with RTZIPGZIPCOMP_F_BLOCKED on worker threads.
+ * Other gzip streams are decompressed serially as usual. */
+#define RTZIPGZIPDECOMP_F_PARALLEL          RT_BIT(1)
+/** Valid flags. */
+#define RTZIPGZIPDECOMP_F_VALID_MASK        UINT32_C(0x00000003)
 /** @} */
 
 
+/**
+ * Opens a blocked gzip file for random access reading.
+ *
+ * The file must have been created using RTZIPGZIPCOMP_F_BLOCKED.  An index of
+ * the gzip members is built while opening the file, and reads are then served
+ * by decompressing only the member(s) covering the requested range.
+ *
+ * @returns IPRT status code.
+ * @retval  VERR_ZIP_BAD_HEADER if not a blocked gzip file.
+ *
+ * @param   hVfsFileIn          The compressed input file (must be readable).
+ *                              The reference is not consumed, instead another
+ *                              one is retained.
+ * @param   fFlags              Flags, MBZ.
+ * @param   phVfsFileGunzip     Where to return the handle to the gunzipped file
+ *                              (read-only).
+ */
+RTDECL(int) RTZipGzipDecompressFile(RTVFSFILE hVfsFileIn, uint32_t fFlags, PRTVFSFILE phVfsFileGunzip);
+
+
 /**
  * Opens a gzip decompression I/O stream.
  *
@@ -246,13 +271,42 @@ RTDECL(int) RTZipGzipDecompressIoStream(RTVFSIOSTREAM hVfsIosIn, uint32_t fFlags
  * @param   hVfsIosDst          The compressed output stream (must be writable).
  *                              The reference is not consumed, instead another
  *                              one is retained.
- * @param   fFlags              Flags, MBZ.
+ * @param   fFlags              RTZIPGZIPCOMP_F_XXX.
  * @param   uLevel              The gzip compression level, 1 thru 9.
  * @param   phVfsIosGzip        Where to return the gzip input I/O stream handle
  *                              (you write to this).
  */
 RTDECL(int) RTZipGzipCompressIoStream(RTVFSIOSTREAM hVfsIosDst, uint32_t fFlags, uint8_t uLevel, PRTVFSIOSTREAM phVfsIosGzip);
 
+/** @name RTZipGzipCompressIoStream flags.
+ * @{ */
+/** Compress the input in blocks on worker threads.
+ * The output is still a single gzip member, each block being primed with the
+ * tail of the previous one so the ratio is close to that of the serial
+ * compressor. */
+#define RTZIPGZIPCOMP_F_PARALLEL            RT_BIT(0)
+/** Write each block as an independent gzip member tagged with its compressed
+ * and uncompressed sizes.  This can be decompressed in parallel and opened
+ * for random access by RTZipGzipDecompressFile, while remaining readable by
+ * any gzip implementation.  Implies RTZIPGZIPCOMP_F_PARALLEL. */
+#define RTZIPGZIPCOMP_F_BLOCKED             RT_BIT(1)
+/** Valid flags. */
+#define RTZIPGZIPCOMP_F_VALID_MASK          UINT32_C(0x00000003)
+/** @} */
+
+/**
+ * Completes a gzip compressor stream, writing the final deflate block and the
+ * gzip trailer and flushing the output stream.
+ *
+ * Releasing the last reference does the same, but any write error is lost
+ * there.  No more data can be written after this call.
+ *
+ * @returns IPRT status code.
+ * @param   hVfsIosGzip         The gzip input I/O stream handle returned by
+ *                              RTZipGzipCompressIoStream.
+ */
+RTDECL(int) RTZipGzipCompressFinish(RTVFSIOSTREAM hVfsIosGzip);
+
 /**
  * A mini GZIP program.
  *
@@ -273,12 +327,24 @@ RTDECL(RTEXITCODE) RTZipGzipCmd(unsigned cArgs, char **papszArgs);
  *
  * @param   hVfsIosIn           The input stream.  The reference is not
  *                              consumed, instead another one is retained.
- * @param   fFlags              Flags, MBZ.
+ * @param   fFlags              RTZIPTAR_R_XXX.
  * @param   phVfsFss            Where to return the handle to the TAR
  *                              filesystem stream.
  */
 RTDECL(int) RTZipTarFsStreamFromIoStream(RTVFSIOSTREAM hVfsIosIn, uint32_t fFlags, PRTVFSFSSTREAM phVfsFss);
 
+/** @name RTZIPTAR_R_XXX - TAR reader flags (RTZipTarFsStreamFromIoStream).
+ * @{ */
+/** Return regular files as RTVFSOBJTYPE_FILE objects reading directly from
+ * the archive file at their data offset, instead of as I/O streams consuming
+ * the input sequentially.  The file objects are seekable, stay valid after
+ * moving on to the next member or closing the filesystem stream, and can be
+ * read concurrently.  Ignored if the input stream isn't a file. */
+#define RTZIPTAR_R_FILE_VIEWS       RT_BIT_32(0)
+/** Valid bits. */
+#define RTZIPTAR_R_VALID_MASK       UINT32_C(0x00000001)
+/** @} */
+
 /** TAR format type. */
 typedef enum RTZIPTARFORMAT
 {
@@ -56,6 +56,7 @@
 #include <iprt/path.h>
 #include <iprt/process.h>
 #include <iprt/semaphore.h>
+#include <iprt/string.h>
 #include <iprt/thread.h>
 #include <VBox/VBoxGuestLib.h>
 #include <VBox/HostServices/GuestControlSvc.h>
@@ -128,7 +129,19 @@ static DECLCALLBACK(int) vgsvcGstCtrlPreInit(void)
             VGSvcError("Failed to connect to the guest property service, rc=%Rrc\n", rc);
     }
     else
+    {
+        /*
+         * Let the host know how large the process input chunks may be which
+         * our sessions accept.  Hosts not finding this stick to 64K.
+         */
+        char szValue[32];
+        RTStrPrintf(szValue, sizeof(szValue), "%RU32", (uint32_t)VGSVC_GSTCTRL_SESSION_SCRATCH_BUF_SIZE);
+        int rc2 = VbglR3GuestPropWrite(uGuestPropSvcClientID, GUEST_CONTROL_PROP_MAX_INPUT_SIZE, szValue, "TRANSRESET");
+        if (RT_FAILURE(rc2))
+            VGSvcVerbose(1, "Failed to advertise the maximum process input size, rc=%Rrc\n", rc2);
+
         VbglR3GuestPropDisconnect(uGuestPropSvcClientID);
+    }
 
     if (rc == VERR_NOT_FOUND) /* If a value is not found, don't be sad! */
         rc = VINF_SUCCESS;
@@ -136,6 +136,11 @@ typedef struct VBOXSERVICECTRLSESSIONTHREAD
 /** Pointer to thread data. */
 typedef VBOXSERVICECTRLSESSIONTHREAD *PVBOXSERVICECTRLSESSIONTHREAD;
 
+/** Size of the session scratch buffer, which limits how much process input
+ *  the host can send per message.  Advertised to the host via the
+ *  GUEST_CONTROL_PROP_MAX_INPUT_SIZE guest property. */
+#define VGSVC_GSTCTRL_SESSION_SCRATCH_BUF_SIZE          _1M
+
 /** Flag indicating that this session has been spawned from
  *  the main executable. */
 #define VBOXSERVICECTRLSESSION_FLAG_SPAWN                RT_BIT(0)
@@ -1281,7 +1281,7 @@ static RTEXITCODE vgsvcGstCtrlSessionSpawnWorker(PVBOXSERVICECTRLSESSION pSessio
 
     /* Allocate a scratch buffer for commands which also send
      * payload data with them. */
-    uint32_t cbScratchBuf = _64K; /** @todo Make buffer size configurable via guest properties/argv! */
+    uint32_t cbScratchBuf = VGSVC_GSTCTRL_SESSION_SCRATCH_BUF_SIZE;
     AssertReturn(RT_IS_POWER_OF_TWO(cbScratchBuf), RTEXITCODE_FAILURE);
     uint8_t *pvScratchBuf = NULL;
 
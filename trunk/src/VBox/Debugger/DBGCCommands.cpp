@@ -225,6 +225,7 @@ static const DBGCVARDESC    g_aArgWriteCore[] =
 {
     /* cTimesMin,   cTimesMax,  enmCategory,            fFlags,                         pszName,        pszDescription */
     {  1,           1,          DBGCVAR_CAT_STRING,     0,                              "path",         "Filename string." },
+    {  0,           2,          DBGCVAR_CAT_STRING,     0,                              "option",       "'gzip' to compress, 'live' to keep the VM running while writing memory. (optional)" },
 };
 
 
@@ -270,7 +271,7 @@ const DBGCCMD    g_aDbgcCmds[] =
     { "unload",     1,       ~0U,       &g_aArgUnload[0],    RT_ELEMENTS(g_aArgUnload),    0, dbgcCmdUnload,    "<modname1> [modname2..N]", "Unloads one or more modules in the current address space." },
     { "unloadplugin", 1,     ~0U,       &g_aArgPlugIn[0],    RT_ELEMENTS(g_aArgPlugIn),    0, dbgcCmdUnloadPlugIn, "<plugin1> [plugin2..N]", "Unloads one or more plugins." },
     { "unset",      1,       ~0U,       &g_aArgUnset[0],     RT_ELEMENTS(g_aArgUnset),     0, dbgcCmdUnset,     "<var1> [var1..[varN]]",  "Unsets (delete) one or more global variables." },
-    { "writecore",  1,        1,        &g_aArgWriteCore[0], RT_ELEMENTS(g_aArgWriteCore), 0, dbgcCmdWriteCore,   "<filename>",           "Write core to file." },
+    { "writecore",  1,        3,        &g_aArgWriteCore[0], RT_ELEMENTS(g_aArgWriteCore), 0, dbgcCmdWriteCore,   "<filename> [gzip] [live]", "Write core to file." },
 };
 /** The number of native commands. */
 const uint32_t      g_cDbgcCmds = RT_ELEMENTS(g_aDbgcCmds);
@@ -1768,18 +1769,35 @@ static DECLCALLBACK(int) dbgcCmdWriteCore(PCDBGCCMD pCmd, PDBGCCMDHLP pCmdHlp, P
     /*
      * Validate input, lots of paranoia here.
      */
-    if (    cArgs != 1
-        ||  paArgs[0].enmType != DBGCVAR_TYPE_STRING)
+    if (    cArgs < 1
+        ||  cArgs > 3)
     {
-        AssertMsgFailed(("Expected one string exactly!\n"));
+        AssertMsgFailed(("Expected one to three strings!\n"));
         return VERR_DBGC_PARSE_INCORRECT_ARG_TYPE;
     }
+    for (unsigned iArg = 0; iArg < cArgs; iArg++)
+        if (paArgs[iArg].enmType != DBGCVAR_TYPE_STRING)
+        {
+            AssertMsgFailed(("Expected strings only!\n"));
+            return VERR_DBGC_PARSE_INCORRECT_ARG_TYPE;
+        }
 
     const char *pszDumpPath = paArgs[0].u.pszString;
     if (!pszDumpPath)
         return DBGCCmdHlpFail(pCmdHlp, pCmd, "Missing file path.\n");
 
-    int rc = DBGFR3CoreWrite(pUVM, pszDumpPath, true /*fReplaceFile*/);
+    uint32_t fFlags = DBGFCOREWRITE_F_REPLACE;
+    for (unsigned iArg = 1; iArg < cArgs; iArg++)
+    {
+        if (!strcmp(paArgs[iArg].u.pszString, "gzip"))
+            fFlags |= DBGFCOREWRITE_F_GZIP;
+        else if (!strcmp(paArgs[iArg].u.pszString, "live"))
+            fFlags |= DBGFCOREWRITE_F_LIVE;
+        else
+            return DBGCCmdHlpFail(pCmdHlp, pCmd, "Unknown option '%s'.\n", paArgs[iArg].u.pszString);
+    }
+
+    int rc = DBGFR3CoreWriteEx(pUVM, pszDumpPath, fFlags);
     if (RT_FAILURE(rc))
         return DBGCCmdHlpFail(pCmdHlp, pCmd, "DBGFR3WriteCore failed. rc=%Rrc\n", rc);
 
@@ -1956,15 +1956,19 @@ static bool dbgDiggerLinuxIsLikelyNameFragment(PUVM pUVM, PCDBGFADDRESS pHitAddr
 }
 
 /**
- * Tries to find and load the kernel symbol table with the given needle.
+ * Tries to find and load the kernel symbol table with the given needles.
+ *
+ * All the needles are searched for in one pass, so there is no need to scan
+ * the whole kernel once for each of them.
  *
  * @returns VBox status code.
  * @param   pThis               The Linux digger data.
  * @param   pUVM                The user mode VM handle.
- * @param   pabNeedle           The needle to use for searching.
- * @param   cbNeedle            Size of the needle in bytes.
+ * @param   paNeedles           The needles to use for searching.
+ * @param   cNeedles            Number of needles.
  */
-static int dbgDiggerLinuxFindSymbolTableFromNeedle(PDBGDIGGERLINUX pThis, PUVM pUVM, uint8_t const *pabNeedle, uint8_t cbNeedle)
+static int dbgDiggerLinuxFindSymbolTableFromNeedles(PDBGDIGGERLINUX pThis, PUVM pUVM,
+                                                    PCDBGFMEMSCANNEEDLE paNeedles, uint32_t cNeedles)
 {
     int rc = VINF_SUCCESS;
 
@@ -1976,44 +1980,57 @@ static int dbgDiggerLinuxFindSymbolTableFromNeedle(PDBGDIGGERLINUX pThis, PUVM p
     uint32_t    cbLeft  = LNX_MAX_KERNEL_SIZE;
     while (cbLeft > 4096)
     {
-        DBGFADDRESS          HitAddr;
-        rc = DBGFR3MemScan(pUVM, 0 /*idCpu*/, &CurAddr, cbLeft, 1 /*uAlign*/,
-                           pabNeedle, cbNeedle, &HitAddr);
+        DBGFADDRESS          HitAddrMulti;
+        uint32_t             iNeedle;
+        rc = DBGFR3MemScanMulti(pUVM, 0 /*idCpu*/, &CurAddr, cbLeft, 1 /*uAlign*/,
+                                paNeedles, cNeedles, &HitAddrMulti, &iNeedle);
         if (RT_FAILURE(rc))
             break;
-        if (dbgDiggerLinuxIsLikelyNameFragment(pUVM, &HitAddr, pabNeedle, cbNeedle))
+
+        /* Later needles may match here too if one is a prefix of another, so try them all. */
+        bool fFound = false;
+        for (; iNeedle < cNeedles && !fFound; iNeedle++)
         {
-            /* There will be another hit near by. */
-            DBGFR3AddrAdd(&HitAddr, 1);
-            rc = DBGFR3MemScan(pUVM, 0 /*idCpu*/, &HitAddr, LNX_MAX_KALLSYMS_NAMES_SIZE, 1 /*uAlign*/,
-                               pabNeedle, cbNeedle, &HitAddr);
-            if (   RT_SUCCESS(rc)
-                && dbgDiggerLinuxIsLikelyNameFragment(pUVM, &HitAddr, pabNeedle, cbNeedle))
+            uint8_t const *pabNeedle = (uint8_t const *)paNeedles[iNeedle].pvNeedle;
+            uint8_t const  cbNeedle  = (uint8_t)paNeedles[iNeedle].cbNeedle;
+            DBGFADDRESS    HitAddr   = HitAddrMulti;
+            if (dbgDiggerLinuxIsLikelyNameFragment(pUVM, &HitAddr, pabNeedle, cbNeedle))
             {
-                /*
-                 * We've got a very likely candidate for a location inside kallsyms_names.
-                 * Try find the start of it, that is to say, try find kallsyms_num_syms.
-                 * kallsyms_num_syms is aligned on sizeof(unsigned long) boundrary
-                 */
-                rc = dbgDiggerLinuxFindStartOfNamesAndSymbolCount(pUVM, pThis, &HitAddr);
-                if (RT_SUCCESS(rc))
-                    rc = dbgDiggerLinuxFindEndOfNamesAndMore(pUVM, pThis, &HitAddr);
-                if (RT_SUCCESS(rc))
-                    rc = dbgDiggerLinuxFindTokenIndex(pUVM, pThis);
-                if (RT_SUCCESS(rc))
-                    rc = dbgDiggerLinuxLoadKernelSymbols(pUVM, pThis);
-                if (RT_SUCCESS(rc))
-                    break;
+                /* There will be another hit near by. */
+                DBGFR3AddrAdd(&HitAddr, 1);
+                rc = DBGFR3MemScan(pUVM, 0 /*idCpu*/, &HitAddr, LNX_MAX_KALLSYMS_NAMES_SIZE, 1 /*uAlign*/,
+                                   pabNeedle, cbNeedle, &HitAddr);
+                if (   RT_SUCCESS(rc)
+                    && dbgDiggerLinuxIsLikelyNameFragment(pUVM, &HitAddr, pabNeedle, cbNeedle))
+                {
+                    /*
+                     * We've got a very likely candidate for a location inside kallsyms_names.
+                     * Try find the start of it, that is to say, try find kallsyms_num_syms.
+                     * kallsyms_num_syms is aligned on sizeof(unsigned long) boundrary
+                     */
+                    rc = dbgDiggerLinuxFindStartOfNamesAndSymbolCount(pUVM, pThis, &HitAddr);
+                    if (RT_SUCCESS(rc))
+                        rc = dbgDiggerLinuxFindEndOfNamesAndMore(pUVM, pThis, &HitAddr);
+                    if (RT_SUCCESS(rc))
+                        rc = dbgDiggerLinuxFindTokenIndex(pUVM, pThis);
+                    if (RT_SUCCESS(rc))
+                        rc = dbgDiggerLinuxLoadKernelSymbols(pUVM, pThis);
+                    fFound = RT_SUCCESS(rc);
+                }
             }
         }
+        if (fFound)
+            break;
 
         /*
-         * Advance.
+         * Advance.  Only by one byte, as another needle may start inside the
+         * one we've just found.
          */
-        RTGCUINTPTR cbDistance = HitAddr.FlatPtr - CurAddr.FlatPtr + cbNeedle;
+        RTGCUINTPTR cbDistance = HitAddrMulti.FlatPtr - CurAddr.FlatPtr + 1;
         if (RT_UNLIKELY(cbDistance >= cbLeft))
         {
             Log(("dbgDiggerLinuxInit: Failed to find kallsyms\n"));
+            rc = VERR_NOT_FOUND;
             break;
         }
         cbLeft -= cbDistance;
@@ -2527,19 +2544,17 @@ static DECLCALLBACK(int)  dbgDiggerLinuxInit(PUVM pUVM, void *pvData)
     if (RT_FAILURE(rc))
         LogFlowFunc(("Failed to find kernel config (%Rrc), no config database available\n", rc));
 
-    static const uint8_t s_abNeedle[] = "kobj";
-    rc = dbgDiggerLinuxFindSymbolTableFromNeedle(pThis, pUVM, s_abNeedle, sizeof(s_abNeedle) - 1);
-    if (RT_FAILURE(rc))
+    /*
+     * Look for the kallsyms table.  The alternate needles are seen on older
+     * x86 Linux kernels ("kobjec") and OpenSuSe 10.2 x86 ("nmi").
+     */
+    static const DBGFMEMSCANNEEDLE s_aNeedles[] =
     {
-        /* Try alternate needle (seen on older x86 Linux kernels). */
-        static const uint8_t s_abNeedleAlt[] = "kobjec";
-        rc = dbgDiggerLinuxFindSymbolTableFromNeedle(pThis, pUVM, s_abNeedleAlt, sizeof(s_abNeedleAlt) - 1);
-        if (RT_FAILURE(rc))
-        {
-            static const uint8_t s_abNeedleOSuseX86[] = "nmi"; /* OpenSuSe 10.2 x86 */
-            rc = dbgDiggerLinuxFindSymbolTableFromNeedle(pThis, pUVM, s_abNeedleOSuseX86, sizeof(s_abNeedleOSuseX86) - 1);
-        }
-    }
+        { RT_STR_TUPLE("kobj") },
+        { RT_STR_TUPLE("kobjec") },
+        { RT_STR_TUPLE("nmi") },
+    };
+    rc = dbgDiggerLinuxFindSymbolTableFromNeedles(pThis, pUVM, s_aNeedles, RT_ELEMENTS(s_aNeedles));
 
     pThis->fValid = true;
     return VINF_SUCCESS;
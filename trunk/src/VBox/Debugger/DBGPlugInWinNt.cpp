@@ -1016,21 +1016,20 @@ static DECLCALLBACK(bool)  dbgDiggerWinNtProbe(PUVM pUVM, void *pvData)
          KernelAddr.FlatPtr < uEnd;
          KernelAddr.FlatPtr += PAGE_SIZE)
     {
-        bool fNt31 = false;
-        DBGFADDRESS const RetryAddress = KernelAddr;
-        int rc = DBGFR3MemScan(pUVM, 0 /*idCpu*/, &KernelAddr, uEnd - KernelAddr.FlatPtr,
-                               8, "PAGELK\0", sizeof("PAGELK\0"), &KernelAddr);
-        if (   rc == VERR_DBGF_MEM_NOT_FOUND
-            && enmMode != CPUMMODE_LONG)
+        /* NT3.1 didn't have a PAGELK section, so look for _TEXT too.  The
+           following VirtualSize is zero, so check for that too.  Both are
+           searched for in one pass rather than rescanning everything. */
+        static const DBGFMEMSCANNEEDLE s_aNeedles[] =
         {
-            /* NT3.1 didn't have a PAGELK section, so look for _TEXT instead.  The
-               following VirtualSize is zero, so check for that too. */
-            rc = DBGFR3MemScan(pUVM, 0 /*idCpu*/, &RetryAddress, uEnd - RetryAddress.FlatPtr,
-                               8, "_TEXT\0\0\0\0\0\0", sizeof("_TEXT\0\0\0\0\0\0"), &KernelAddr);
-            fNt31 = true;
-        }
+            { "PAGELK\0",             sizeof("PAGELK\0") },
+            { "_TEXT\0\0\0\0\0\0",     sizeof("_TEXT\0\0\0\0\0\0") },
+        };
+        uint32_t iNeedle = 0;
+        int rc = DBGFR3MemScanMulti(pUVM, 0 /*idCpu*/, &KernelAddr, uEnd - KernelAddr.FlatPtr, 8,
+                                    s_aNeedles, enmMode != CPUMMODE_LONG ? 2 : 1, &KernelAddr, &iNeedle);
         if (RT_FAILURE(rc))
             break;
+        bool const fNt31 = iNeedle == 1;
         DBGFR3AddrSub(&KernelAddr, KernelAddr.FlatPtr & PAGE_OFFSET_MASK);
 
         /* MZ + PE header. */
@@ -263,6 +263,14 @@ int vbsfMappingsAdd(const char *pszFolderName, PSHFLSTRING pMapName,
             rc = RTFsQueryProperties(FolderMapping[i].pszFolderName, &prop);
             AssertRC(rc);
             FolderMapping[i].fHostCaseSensitive = RT_SUCCESS(rc) ? prop.fCaseSensitive : false;
+
+            /* Case insensitive guests need case corrections on such hosts, which are worth caching. */
+            FolderMapping[i].pPathCache = NULL;
+            if (FolderMapping[i].fHostCaseSensitive)
+            {
+                rc = vbsfPathCacheCreate(FolderMapping[i].pszFolderName, &FolderMapping[i].pPathCache);
+                AssertRC(rc); /* Not fatal, we'll just do without. */
+            }
             vbsfRootHandleAdd(i);
             break;
         }
@@ -314,8 +322,10 @@ int vbsfMappingsRemove(PSHFLSTRING pMapName)
                  */
                 Log(("vbsfMappingsRemove: mapping %ls removed\n", pMapName->String.ucs2));
 
+                vbsfPathCacheDestroy(FolderMapping[i].pPathCache);
                 RTStrFree(FolderMapping[i].pszFolderName);
                 RTMemFree(FolderMapping[i].pMapName);
+                FolderMapping[i].pPathCache    = NULL;
                 FolderMapping[i].pszFolderName = NULL;
                 FolderMapping[i].pMapName      = NULL;
                 FolderMapping[i].fValid        = false;
@@ -366,6 +376,24 @@ bool vbsfIsHostMappingCaseSensitive(SHFLROOT root)
     return pFolderMapping->fHostCaseSensitive;
 }
 
+PVBSFPATHCACHE vbsfMappingsQueryPathCache(SHFLROOT root)
+{
+    MAPPING *pFolderMapping = vbsfMappingGetByRoot(root);
+    AssertReturn(pFolderMapping, NULL);
+    return pFolderMapping->pPathCache;
+}
+
+/**
+ * Drops the cached case corrections of a mapping, called when the guest
+ * removes or renames something in it.
+ */
+void vbsfMappingsFlushPathCache(SHFLROOT root)
+{
+    MAPPING *pFolderMapping = vbsfMappingGetByRoot(root);
+    if (pFolderMapping)
+        vbsfPathCacheFlush(pFolderMapping->pPathCache);
+}
+
 #ifdef UNITTEST
 /** Unit test the SHFL_FN_QUERY_MAPPINGS API.  Located here as a form of API
  * documentation (or should it better be inline in include/VBox/shflsvc.h?) */
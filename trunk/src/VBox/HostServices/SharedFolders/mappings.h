@@ -18,6 +18,7 @@
 #define ___MAPPINGS_H
 
 #include "shfl.h"
+#include "vbsfpathcache.h"
 #include <VBox/shflsvc.h>
 
 typedef struct
@@ -35,6 +36,7 @@ typedef struct
                                            Any guest operation on such a folder fails! */
     bool        fPlaceholder;         /**< mapping does not exist in the VM settings but the guest
                                            still has. fMissing is always true for this mapping. */
+    PVBSFPATHCACHE pPathCache;        /**< case correction cache, NULL if the host is case-insensitive */
 } MAPPING;
 /** Pointer to a MAPPING structure. */
 typedef MAPPING *PMAPPING;
@@ -61,6 +63,8 @@ const char* vbsfMappingsQueryHostRoot(SHFLROOT root);
 int vbsfMappingsQueryHostRootEx(SHFLROOT hRoot, const char **ppszRoot, uint32_t *pcbRootLen);
 bool vbsfIsGuestMappingCaseSensitive(SHFLROOT root);
 bool vbsfIsHostMappingCaseSensitive(SHFLROOT root);
+PVBSFPATHCACHE vbsfMappingsQueryPathCache(SHFLROOT root);
+void vbsfMappingsFlushPathCache(SHFLROOT root);
 
 int vbsfMappingLoaded(const PMAPPING pLoadedMapping, SHFLROOT root);
 PMAPPING vbsfMappingGetByRoot(SHFLROOT root);
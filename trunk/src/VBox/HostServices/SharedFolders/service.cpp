@@ -25,6 +25,7 @@
 #include <iprt/alloc.h>
 #include <iprt/string.h>
 #include <iprt/assert.h>
+#include <iprt/semaphore.h>
 #include <VBox/vmm/ssm.h>
 #include <VBox/vmm/pdmifs.h>
 
@@ -66,12 +67,19 @@
  * To access host file system guest just forwards file system calls
  * to the service, and specifies full paths or handles for objects.
  *
+ * Guest calls are executed concurrently on the HGCM worker pool
+ * (VBOX_HGCM_SVC_F_CALL_WORKERS), so a slow read doesn't stall the other
+ * guest threads.  The few functions which change state other calls rely on
+ * (client flags, mapping use counts, closing handles, directory listing
+ * state) are executed exclusively, see svcCallIsExclusive.
  *
  */
 
 
 PVBOXHGCMSVCHELPERS g_pHelpers;
 static PPDMLED      pStatusLed = NULL;
+/** Read/write lock serializing exclusive guest calls against the others. */
+static RTSEMRW      g_hCallLock = NIL_RTSEMRW;
 
 static DECLCALLBACK(int) svcUnload (void *)
 {
@@ -79,6 +87,8 @@ static DECLCALLBACK(int) svcUnload (void *)
 
     Log(("svcUnload\n"));
     vbsfFreeHandleTable();
+    RTSemRWDestroy(g_hCallLock);
+    g_hCallLock = NIL_RTSEMRW;
 
     return rc;
 }
@@ -296,11 +306,107 @@ static DECLCALLBACK(int) svcLoadState(void *, uint32_t u32ClientID, void *pvClie
     return VINF_SUCCESS;
 }
 
+/**
+ * Checks whether a guest call must not run concurrently with other calls.
+ *
+ * @returns true if exclusive, false if it may run in parallel with other
+ *          non-exclusive calls.
+ * @param   u32Function     The SHFL_FN_XXX function.
+ */
+static bool svcCallIsExclusive(uint32_t u32Function)
+{
+    switch (u32Function)
+    {
+        /* Modify the client flags or the mapping use counts. */
+        case SHFL_FN_MAP_FOLDER_OLD:
+        case SHFL_FN_MAP_FOLDER:
+        case SHFL_FN_UNMAP_FOLDER:
+        case SHFL_FN_SET_UTF8:
+        case SHFL_FN_SET_SYMLINKS:
+        /* Frees the handle another call may be using. */
+        case SHFL_FN_CLOSE:
+        /* Keeps the enumeration state in the directory handle. */
+        case SHFL_FN_LIST:
+            return true;
+        default:
+            return false;
+    }
+}
+
+/**
+ * Switches a shared guest call to exclusive before it frees a handle.
+ *
+ * Used by the compound functions which only need exclusive access for their
+ * final close.  Other calls may run between dropping the read lock and getting
+ * the write lock, which is fine as they cannot know the new handle.
+ *
+ * @param   pfExclusive     The call's exclusive indicator, updated.
+ */
+static void svcCallMakeExclusive(bool *pfExclusive)
+{
+    if (!*pfExclusive)
+    {
+        RTSemRWReleaseRead(g_hCallLock);
+        RTSemRWRequestWrite(g_hCallLock, RT_INDEFINITE_WAIT);
+        *pfExclusive = true;
+    }
+}
+
+/**
+ * Does the I/O for SHFL_FN_READ_VEC and SHFL_FN_WRITE_VEC.
+ *
+ * @returns VBox status code of the first failing segment, VINF_SUCCESS if none
+ *          failed.
+ * @param   pClient         The client data.
+ * @param   root            The mapping root.
+ * @param   Handle          The file handle.
+ * @param   fWrite          Whether to write or read.
+ * @param   paSegs          The segments, cbDone is updated.
+ * @param   cSegs           Number of segments.
+ * @param   pbBuffer        The data buffer, already checked to be large enough.
+ * @param   pcbTotal        Where to return the number of bytes transferred.
+ */
+static int svcReadWriteVec(SHFLCLIENTDATA *pClient, SHFLROOT root, SHFLHANDLE Handle, bool fWrite,
+                           PSHFLIOSEG paSegs, uint32_t cSegs, uint8_t *pbBuffer, uint32_t *pcbTotal)
+{
+    int      rc      = VINF_SUCCESS;
+    uint32_t cbTotal = 0;
+    uint32_t iSeg    = 0;
+    for (; iSeg < cSegs; iSeg++)
+    {
+        uint32_t cbSeg = paSegs[iSeg].cb;
+        rc = fWrite
+           ? vbsfWrite(pClient, root, Handle, paSegs[iSeg].off, &cbSeg, pbBuffer)
+           : vbsfRead(pClient, root, Handle, paSegs[iSeg].off, &cbSeg, pbBuffer);
+        if (RT_FAILURE(rc))
+            break;
+        paSegs[iSeg].cbDone = cbSeg;
+        cbTotal  += cbSeg;
+        pbBuffer += paSegs[iSeg].cb;
+        if (cbSeg != paSegs[iSeg].cb)
+        {
+            iSeg++;
+            break; /* EOF or disk full, the rest would not line up. */
+        }
+    }
+    for (; iSeg < cSegs; iSeg++)
+        paSegs[iSeg].cbDone = 0;
+
+    *pcbTotal = cbTotal;
+    return rc;
+}
+
 static DECLCALLBACK(void) svcCall (void *, VBOXHGCMCALLHANDLE callHandle, uint32_t u32ClientID, void *pvClient, uint32_t u32Function, uint32_t cParms, VBOXHGCMSVCPARM paParms[])
 {
     RT_NOREF1(u32ClientID);
     int rc = VINF_SUCCESS;
 
+    bool fExclusive = svcCallIsExclusive(u32Function);
+    if (fExclusive)
+        RTSemRWRequestWrite(g_hCallLock, RT_INDEFINITE_WAIT);
+    else
+        RTSemRWRequestRead(g_hCallLock, RT_INDEFINITE_WAIT);
+
     Log(("SharedFolders host service: svcCall: u32ClientID = %u, fn = %u, cParms = %u, pparms = %p\n", u32ClientID, u32Function, cParms, paParms));
 
     SHFLCLIENTDATA *pClient = (SHFLCLIENTDATA *)pvClient;
@@ -1260,6 +1366,263 @@ static DECLCALLBACK(void) svcCall (void *, VBOXHGCMCALLHANDLE callHandle, uint32
             break;
         }
 
+        case SHFL_FN_CREATE_READ_CLOSE:
+        {
+            Log(("SharedFolders host service: svcCall: SHFL_FN_CREATE_READ_CLOSE\n"));
+
+            /* Verify parameter count and types. */
+            if (cParms != SHFL_CPARMS_CREATE_READ_CLOSE)
+            {
+                rc = VERR_INVALID_PARAMETER;
+            }
+            else if (   paParms[0].type != VBOX_HGCM_SVC_PARM_32BIT /* root */
+                     || paParms[1].type != VBOX_HGCM_SVC_PARM_PTR   /* path */
+                     || paParms[2].type != VBOX_HGCM_SVC_PARM_PTR   /* parms */
+                     || paParms[3].type != VBOX_HGCM_SVC_PARM_64BIT /* offset */
+                     || paParms[4].type != VBOX_HGCM_SVC_PARM_32BIT /* count */
+                     || paParms[5].type != VBOX_HGCM_SVC_PARM_PTR   /* buffer */
+                    )
+            {
+                rc = VERR_INVALID_PARAMETER;
+            }
+            else
+            {
+                /* Fetch parameters. */
+                SHFLROOT  root          = (SHFLROOT)paParms[0].u.uint32;
+                SHFLSTRING *pPath       = (SHFLSTRING *)paParms[1].u.pointer.addr;
+                uint32_t cbPath         = paParms[1].u.pointer.size;
+                SHFLCREATEPARMS *pParms = (SHFLCREATEPARMS *)paParms[2].u.pointer.addr;
+                uint32_t cbParms        = paParms[2].u.pointer.size;
+                uint64_t   offset       = paParms[3].u.uint64;
+                uint32_t   count        = paParms[4].u.uint32;
+                uint8_t   *pBuffer      = (uint8_t *)paParms[5].u.pointer.addr;
+
+                /* Verify parameters values.  Only opening existing files for reading is allowed. */
+                if (   !ShflStringIsValidIn(pPath, cbPath, RT_BOOL(pClient->fu32Flags & SHFL_CF_UTF8))
+                    || cbParms != sizeof(SHFLCREATEPARMS)
+                    || count > paParms[5].u.pointer.size
+                    || (pParms->CreateFlags & (SHFL_CF_LOOKUP | SHFL_CF_OPEN_TARGET_DIRECTORY | SHFL_CF_DIRECTORY))
+                    || (pParms->CreateFlags & SHFL_CF_ACT_MASK_IF_EXISTS) != SHFL_CF_ACT_OPEN_IF_EXISTS
+                    || (pParms->CreateFlags & SHFL_CF_ACT_MASK_IF_NEW) != SHFL_CF_ACT_FAIL_IF_NEW
+                    || !(pParms->CreateFlags & SHFL_CF_ACCESS_READ)
+                   )
+                {
+                    rc = VERR_INVALID_PARAMETER;
+                }
+                else
+                {
+                    /* Execute the function. */
+                    pParms->Handle = SHFL_HANDLE_NIL;
+                    rc = vbsfCreate (pClient, root, pPath, cbPath, pParms);
+                    if (RT_SUCCESS(rc) && pParms->Handle != SHFL_HANDLE_NIL)
+                    {
+                        if (pStatusLed)
+                        {
+                            Assert(pStatusLed->u32Magic == PDMLED_MAGIC);
+                            pStatusLed->Asserted.s.fReading = pStatusLed->Actual.s.fReading = 1;
+                        }
+
+                        rc = vbsfRead (pClient, root, pParms->Handle, offset, &count, pBuffer);
+                        if (pStatusLed)
+                            pStatusLed->Actual.s.fReading = 0;
+
+                        svcCallMakeExclusive(&fExclusive);
+                        vbsfClose (pClient, root, pParms->Handle); /* Only fails if the guest closed it behind our back. */
+                        pParms->Handle = SHFL_HANDLE_NIL;
+                    }
+                    else
+                        count = 0;  /* not opened, pParms->Result tells why */
+
+                    /* Update parameters.*/
+                    paParms[4].u.uint32 = RT_SUCCESS(rc) ? count : 0;
+                }
+            }
+            break;
+        }
+
+        case SHFL_FN_READ_VEC:
+        case SHFL_FN_WRITE_VEC:
+        {
+            bool const fWrite = u32Function == SHFL_FN_WRITE_VEC;
+            Log(("SharedFolders host service: svcCall: %s\n", fWrite ? "SHFL_FN_WRITE_VEC" : "SHFL_FN_READ_VEC"));
+
+            /* Verify parameter count and types. */
+            if (cParms != (fWrite ? SHFL_CPARMS_WRITE_VEC : SHFL_CPARMS_READ_VEC))
+            {
+                rc = VERR_INVALID_PARAMETER;
+            }
+            else
+            if (   paParms[0].type != VBOX_HGCM_SVC_PARM_32BIT   /* root */
+                || paParms[1].type != VBOX_HGCM_SVC_PARM_64BIT   /* handle */
+                || paParms[2].type != VBOX_HGCM_SVC_PARM_32BIT   /* cSegs */
+                || paParms[3].type != VBOX_HGCM_SVC_PARM_PTR     /* segs */
+                || paParms[4].type != VBOX_HGCM_SVC_PARM_PTR     /* buffer */
+                    )
+            {
+                rc = VERR_INVALID_PARAMETER;
+            }
+            else
+            {
+                /* Fetch parameters. */
+                SHFLROOT   root    = (SHFLROOT)paParms[0].u.uint32;
+                SHFLHANDLE Handle  = paParms[1].u.uint64;
+                uint32_t   cSegs   = paParms[2].u.uint32;
+                PSHFLIOSEG paSegs  = (PSHFLIOSEG)paParms[3].u.pointer.addr;
+                uint8_t   *pBuffer = (uint8_t *)paParms[4].u.pointer.addr;
+
+                /* Verify parameters values. */
+                uint64_t cbTotal = 0;
+                if (   cSegs == 0
+                    || cSegs > SHFL_MAX_IOSEGS
+                    || paParms[3].u.pointer.size != cSegs * sizeof(SHFLIOSEG))
+                    rc = VERR_INVALID_PARAMETER;
+                else
+                {
+                    for (uint32_t iSeg = 0; iSeg < cSegs; iSeg++)
+                        cbTotal += paSegs[iSeg].cb;
+                    if (cbTotal > paParms[4].u.pointer.size)
+                        rc = VERR_INVALID_PARAMETER;
+                }
+                if (RT_FAILURE(rc))
+                { /* bail */ }
+                else if (Handle == SHFL_HANDLE_ROOT)
+                {
+                    rc = VERR_INVALID_PARAMETER;
+                }
+                else
+                if (Handle == SHFL_HANDLE_NIL)
+                {
+                    AssertMsgFailed(("Invalid handle!\n"));
+                    rc = VERR_INVALID_HANDLE;
+                }
+                else
+                {
+                    /* Execute the function. */
+                    if (pStatusLed)
+                    {
+                        Assert(pStatusLed->u32Magic == PDMLED_MAGIC);
+                        if (fWrite)
+                            pStatusLed->Asserted.s.fWriting = pStatusLed->Actual.s.fWriting = 1;
+                        else
+                            pStatusLed->Asserted.s.fReading = pStatusLed->Actual.s.fReading = 1;
+                    }
+
+                    uint32_t cbDone = 0;
+                    rc = svcReadWriteVec(pClient, root, Handle, fWrite, paSegs, cSegs, pBuffer, &cbDone);
+
+                    if (pStatusLed)
+                    {
+                        if (fWrite)
+                            pStatusLed->Actual.s.fWriting = 0;
+                        else
+                            pStatusLed->Actual.s.fReading = 0;
+                    }
+
+                    /* A failure after some data went through is reported via cbDone. */
+                    if (RT_FAILURE(rc) && cbDone != 0)
+                        rc = VINF_SUCCESS;
+                }
+            }
+            break;
+        }
+
+        case SHFL_FN_LIST_DIR:
+        {
+            Log(("SharedFolders host service: svcCall: SHFL_FN_LIST_DIR\n"));
+
+            /* Verify parameter count and types. */
+            if (cParms != SHFL_CPARMS_LIST_DIR)
+            {
+                rc = VERR_INVALID_PARAMETER;
+            }
+            else
+            if (   paParms[0].type != VBOX_HGCM_SVC_PARM_32BIT   /* root */
+                || paParms[1].type != VBOX_HGCM_SVC_PARM_PTR     /* path */
+                || paParms[2].type != VBOX_HGCM_SVC_PARM_32BIT   /* flags */
+                || paParms[3].type != VBOX_HGCM_SVC_PARM_32BIT   /* cb */
+                || paParms[4].type != VBOX_HGCM_SVC_PARM_PTR     /* buffer */
+                || paParms[5].type != VBOX_HGCM_SVC_PARM_32BIT   /* cFiles (out) */
+                || paParms[6].type != VBOX_HGCM_SVC_PARM_64BIT   /* handle (out) */
+                    )
+            {
+                rc = VERR_INVALID_PARAMETER;
+            }
+            else
+            {
+                /* Fetch parameters. */
+                SHFLROOT  root     = (SHFLROOT)paParms[0].u.uint32;
+                SHFLSTRING *pPath  = (SHFLSTRING *)paParms[1].u.pointer.addr;
+                uint32_t   cbPath  = paParms[1].u.pointer.size;
+                uint32_t   flags   = paParms[2].u.uint32;
+                uint32_t   length  = paParms[3].u.uint32;
+                uint8_t   *pBuffer = (uint8_t *)paParms[4].u.pointer.addr;
+                uint32_t   cFiles  = 0;
+
+                /* Verify parameters values. */
+                if (   (length < sizeof (SHFLDIRINFO))
+                    ||  length > paParms[4].u.pointer.size
+                    ||  !ShflStringIsValidIn(pPath, cbPath, RT_BOOL(pClient->fu32Flags & SHFL_CF_UTF8))
+                   )
+                {
+                    rc = VERR_INVALID_PARAMETER;
+                }
+                else
+                {
+                    SHFLCREATEPARMS CreateParms;
+                    RT_ZERO(CreateParms);
+                    CreateParms.Handle      = SHFL_HANDLE_NIL;
+                    CreateParms.CreateFlags = SHFL_CF_DIRECTORY | SHFL_CF_ACT_OPEN_IF_EXISTS | SHFL_CF_ACT_FAIL_IF_NEW
+                                            | SHFL_CF_ACCESS_READ;
+                    rc = vbsfCreate (pClient, root, pPath, cbPath, &CreateParms);
+                    if (RT_SUCCESS(rc) && CreateParms.Handle == SHFL_HANDLE_NIL)
+                        rc = CreateParms.Result == SHFL_PATH_NOT_FOUND ? VERR_PATH_NOT_FOUND : VERR_FILE_NOT_FOUND;
+                    if (RT_SUCCESS(rc))
+                    {
+                        if (pStatusLed)
+                        {
+                            Assert(pStatusLed->u32Magic == PDMLED_MAGIC);
+                            pStatusLed->Asserted.s.fReading = pStatusLed->Actual.s.fReading = 1;
+                        }
+
+                        /* The new handle is private to this call, so listing it shared is safe. */
+                        uint32_t resumePoint = 0;
+                        rc = vbsfDirList (pClient, root, CreateParms.Handle, NULL, flags, &length, pBuffer, &resumePoint, &cFiles);
+
+                        if (pStatusLed)
+                            pStatusLed->Actual.s.fReading = 0;
+
+                        if (rc == VERR_NO_MORE_FILES)
+                        {
+                            rc = VINF_SUCCESS; /* Empty directory or these were the last files. */
+                            resumePoint = 0;
+                        }
+
+                        if (RT_FAILURE(rc) || resumePoint == 0)
+                        {
+                            svcCallMakeExclusive(&fExclusive);
+                            vbsfClose (pClient, root, CreateParms.Handle);
+                            CreateParms.Handle = SHFL_HANDLE_NIL;
+                        }
+                    }
+
+                    if (RT_SUCCESS(rc))
+                    {
+                        /* Update parameters.*/
+                        paParms[3].u.uint32 = length;
+                        paParms[5].u.uint32 = cFiles;
+                        paParms[6].u.uint64 = CreateParms.Handle;
+                    }
+                    else
+                    {
+                        paParms[3].u.uint32 = 0;  /* nothing read */
+                        paParms[5].u.uint32 = 0;
+                        paParms[6].u.uint64 = SHFL_HANDLE_NIL;
+                    }
+                }
+            }
+            break;
+        }
+
         default:
         {
             rc = VERR_NOT_IMPLEMENTED;
@@ -1267,6 +1630,11 @@ static DECLCALLBACK(void) svcCall (void *, VBOXHGCMCALLHANDLE callHandle, uint32
         }
     }
 
+    if (fExclusive)
+        RTSemRWReleaseWrite(g_hCallLock);
+    else
+        RTSemRWReleaseRead(g_hCallLock);
+
     LogFlow(("SharedFolders host service: svcCall: rc=%Rrc\n", rc));
 
     if (   !fAsynchronousProcessing
@@ -1496,12 +1864,21 @@ extern "C" DECLCALLBACK(DECLEXPORT(int)) VBoxHGCMSvcLoad (VBOXHGCMSVCFNTABLE *pt
             ptable->pfnSaveState  = svcSaveState;
             ptable->pfnLoadState  = svcLoadState;
             ptable->pvService     = NULL;
+
+            /* Guest calls are thread safe, see svcCall. */
+            ptable->fFlags        = VBOX_HGCM_SVC_F_CALL_WORKERS;
+            ptable->cWorkers      = 0; /* default */
         }
 
         /* Init handle table */
         rc = vbsfInitHandleTable();
         AssertRC(rc);
 
+        int rc2 = RTSemRWCreate(&g_hCallLock);
+        AssertRC(rc2);
+        if (RT_SUCCESS(rc))
+            rc = rc2;
+
         vbsfMappingInit();
     }
 
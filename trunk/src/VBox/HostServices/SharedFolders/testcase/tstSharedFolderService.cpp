@@ -382,6 +382,12 @@ extern int  testRTFileRead(RTFILE File, void *pvBuf, size_t cbToRead, size_t *pc
     return VINF_SUCCESS;
 }
 
+extern int testRTFileReadAt(RTFILE File, RTFOFF off, void *pvBuf, size_t cbToRead, size_t *pcbRead)
+{
+    RT_NOREF1(off);
+    return testRTFileRead(File, pvBuf, cbToRead, pcbRead);
+}
+
 extern int testRTFileSeek(RTFILE hFile, int64_t offSeek, unsigned uMethod, uint64_t *poffActual)
 {
     RT_NOREF3(hFile, offSeek, uMethod);
@@ -461,6 +467,12 @@ extern int  testRTFileWrite(RTFILE File, const void *pvBuf, size_t cbToWrite, si
     return VINF_SUCCESS;
 }
 
+extern int testRTFileWriteAt(RTFILE File, RTFOFF off, const void *pvBuf, size_t cbToWrite, size_t *pcbWritten)
+{
+    RT_NOREF1(off);
+    return testRTFileWrite(File, pvBuf, cbToWrite, pcbWritten);
+}
+
 extern int testRTFsQueryProperties(const char *pszFsPath, PRTFSPROPERTIES pProperties)
 {
     RT_NOREF1(pszFsPath);
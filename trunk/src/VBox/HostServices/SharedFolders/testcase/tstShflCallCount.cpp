@@ -0,0 +1,506 @@
+/* $Id$ */
+/** @file
+ * Testcase for the compound and vectored shared folder functions.
+ *
+ * Runs a few typical guest workloads through the service entry point, once
+ * with the classic functions and once with SHFL_FN_CREATE_READ_CLOSE,
+ * SHFL_FN_READ_VEC, SHFL_FN_WRITE_VEC and SHFL_FN_LIST_DIR, checks that both
+ * give the same results and reports the number of guest calls (i.e. VM exits)
+ * each took.
+ */
+
+/*
+ * Copyright (C) 2006-2017 Oracle Corporation
+ *
+ * This file is part of VirtualBox Open Source Edition (OSE), as
+ * available from http://www.virtualbox.org. This file is free software;
+ * you can redistribute it and/or modify it under the terms of the GNU
+ * General Public License (GPL) as published by the Free Software
+ * Foundation, in version 2 as it comes in the "COPYING" file of the
+ * VirtualBox OSE distribution. VirtualBox OSE is distributed in the
+ * hope that it will be useful, but WITHOUT ANY WARRANTY of any kind.
+ */
+
+
+/*********************************************************************************************************************************
+*   Header Files                                                                                                                 *
+*********************************************************************************************************************************/
+#include "tstShflHgcm.h"
+
+#include <iprt/alloc.h>
+#include <iprt/dir.h>
+#include <iprt/file.h>
+#include <iprt/path.h>
+#include <iprt/string.h>
+#include <iprt/test.h>
+
+
+/*********************************************************************************************************************************
+*   Defined Constants And Macros                                                                                                 *
+*********************************************************************************************************************************/
+/** Number of small files. */
+#define TST_SMALL_FILES     64
+/** The size of the big file used for the scattered I/O. */
+#define TST_BIG_FILE_SIZE   _1M
+/** Number of scattered I/O segments. */
+#define TST_SEGS            16
+/** The size of each scattered I/O segment. */
+#define TST_SEG_SIZE        _4K
+/** The listing buffer size, small enough to need more than one call. */
+#define TST_LIST_BUF_SIZE   _4K
+
+
+/*********************************************************************************************************************************
+*   Global Variables                                                                                                             *
+*********************************************************************************************************************************/
+/** The temporary directory serving as mapping root. */
+static char                 g_szDir[RTPATH_MAX];
+
+
+/**
+ * Allocates a UTF-8 shared folder string.
+ */
+static PSHFLSTRING tstMakeUtf8String(const char *psz)
+{
+    size_t const cch = strlen(psz);
+    PSHFLSTRING pString = (PSHFLSTRING)RTMemAllocZ(SHFLSTRING_HEADER_SIZE + cch + 1);
+    if (pString)
+    {
+        pString->u16Length = (uint16_t)cch;
+        pString->u16Size   = (uint16_t)(cch + 1);
+        memcpy(pString->String.utf8, psz, cch + 1);
+    }
+    return pString;
+}
+
+
+static uint8_t tstPatternByte(uint32_t iFile, uint64_t off)
+{
+    return (uint8_t)(iFile * 7 + off + (off >> 8));
+}
+
+
+/**
+ * Loads the service, maps the test directory writable and switches the client
+ * to UTF-8.
+ */
+static int tstSetup(void)
+{
+    int rc = tstShflSvcLoad();
+    if (RT_SUCCESS(rc))
+        rc = tstShflSvcMapFolder(g_szDir, SHFL_ADD_MAPPING_F_WRITABLE);
+    if (RT_SUCCESS(rc))
+        rc = tstCall(SHFL_FN_SET_UTF8, 0, NULL);
+    return rc;
+}
+
+
+/**
+ * Opens a file or directory the classic way.
+ */
+static int tstOpen(const char *pszPath, uint32_t fCreateFlags, SHFLHANDLE *phHandle)
+{
+    PSHFLSTRING pPath = tstMakeUtf8String(pszPath);
+    if (!pPath)
+        return VERR_NO_MEMORY;
+    SHFLCREATEPARMS CreateParms;
+    RT_ZERO(CreateParms);
+    CreateParms.Handle      = SHFL_HANDLE_NIL;
+    CreateParms.CreateFlags = fCreateFlags;
+    VBOXHGCMSVCPARM aParms[SHFL_CPARMS_CREATE];
+    aParms[0].setUInt32(g_hRoot);
+    aParms[1].setPointer(pPath, SHFLSTRING_HEADER_SIZE + pPath->u16Size);
+    aParms[2].setPointer(&CreateParms, sizeof(CreateParms));
+    int rc = tstCall(SHFL_FN_CREATE, SHFL_CPARMS_CREATE, aParms);
+    if (RT_SUCCESS(rc) && CreateParms.Handle == SHFL_HANDLE_NIL)
+        rc = VERR_FILE_NOT_FOUND;
+    *phHandle = CreateParms.Handle;
+    RTMemFree(pPath);
+    return rc;
+}
+
+
+static int tstClose(SHFLHANDLE hHandle)
+{
+    VBOXHGCMSVCPARM aParms[SHFL_CPARMS_CLOSE];
+    aParms[0].setUInt32(g_hRoot);
+    aParms[1].setUInt64(hHandle);
+    return tstCall(SHFL_FN_CLOSE, SHFL_CPARMS_CLOSE, aParms);
+}
+
+
+static int tstReadWrite(bool fWrite, SHFLHANDLE hFile, uint64_t off, void *pvBuf, uint32_t *pcb)
+{
+    VBOXHGCMSVCPARM aParms[SHFL_CPARMS_READ];
+    aParms[0].setUInt32(g_hRoot);
+    aParms[1].setUInt64(hFile);
+    aParms[2].setUInt64(off);
+    aParms[3].setUInt32(*pcb);
+    aParms[4].setPointer(pvBuf, *pcb);
+    int rc = tstCall(fWrite ? SHFL_FN_WRITE : SHFL_FN_READ, SHFL_CPARMS_READ, aParms);
+    *pcb = aParms[3].u.uint32;
+    return rc;
+}
+
+
+static int tstList(SHFLHANDLE hDir, void *pvBuf, uint32_t *pcFiles)
+{
+    VBOXHGCMSVCPARM aParms[SHFL_CPARMS_LIST];
+    aParms[0].setUInt32(g_hRoot);
+    aParms[1].setUInt64(hDir);
+    aParms[2].setUInt32(0);
+    aParms[3].setUInt32(TST_LIST_BUF_SIZE);
+    aParms[4].setPointer(NULL, 0);
+    aParms[5].setPointer(pvBuf, TST_LIST_BUF_SIZE);
+    aParms[6].setUInt32(0);
+    aParms[7].setUInt32(0);
+    int rc = tstCall(SHFL_FN_LIST, SHFL_CPARMS_LIST, aParms);
+    *pcFiles = aParms[7].u.uint32;
+    return rc;
+}
+
+
+/**
+ * Reads all the small files, returning a checksum of the content.
+ */
+static void tstSmallFiles(bool fCompound)
+{
+    RTTestISubF("Small files - %s", fCompound ? "compound" : "classic");
+
+    uint8_t  abBuf[_8K];
+    uint32_t const cCallsStart = g_cCalls;
+    for (uint32_t iFile = 0; iFile < TST_SMALL_FILES; iFile++)
+    {
+        char szPath[64];
+        RTStrPrintf(szPath, sizeof(szPath), "/small/file%02u", iFile);
+        uint32_t cb = sizeof(abBuf);
+        if (!fCompound)
+        {
+            SHFLHANDLE hFile;
+            RTTESTI_CHECK_RC_RETV(tstOpen(szPath, SHFL_CF_ACT_OPEN_IF_EXISTS | SHFL_CF_ACT_FAIL_IF_NEW | SHFL_CF_ACCESS_READ,
+                                          &hFile), VINF_SUCCESS);
+            RTTESTI_CHECK_RC(tstReadWrite(false /*fWrite*/, hFile, 0, abBuf, &cb), VINF_SUCCESS);
+            RTTESTI_CHECK_RC(tstClose(hFile), VINF_SUCCESS);
+        }
+        else
+        {
+            PSHFLSTRING pPath = tstMakeUtf8String(szPath);
+            RTTESTI_CHECK_RETV(pPath != NULL);
+            SHFLCREATEPARMS CreateParms;
+            RT_ZERO(CreateParms);
+            CreateParms.CreateFlags = SHFL_CF_ACT_OPEN_IF_EXISTS | SHFL_CF_ACT_FAIL_IF_NEW | SHFL_CF_ACCESS_READ;
+            VBOXHGCMSVCPARM aParms[SHFL_CPARMS_CREATE_READ_CLOSE];
+            aParms[0].setUInt32(g_hRoot);
+            aParms[1].setPointer(pPath, SHFLSTRING_HEADER_SIZE + pPath->u16Size);
+            aParms[2].setPointer(&CreateParms, sizeof(CreateParms));
+            aParms[3].setUInt64(0);
+            aParms[4].setUInt32(cb);
+            aParms[5].setPointer(abBuf, cb);
+            RTTESTI_CHECK_RC(tstCall(SHFL_FN_CREATE_READ_CLOSE, SHFL_CPARMS_CREATE_READ_CLOSE, aParms), VINF_SUCCESS);
+            RTTESTI_CHECK(CreateParms.Handle == SHFL_HANDLE_NIL);
+            cb = aParms[4].u.uint32;
+            RTMemFree(pPath);
+        }
+
+        uint32_t const cbExpect = _1K + iFile * 64;
+        RTTESTI_CHECK_MSG_RETV(cb == cbExpect, ("file%02u: cb=%#x, expected %#x\n", iFile, cb, cbExpect));
+        for (uint32_t off = 0; off < cb; off++)
+            if (abBuf[off] != tstPatternByte(iFile, off))
+            {
+                RTTestIFailed("file%02u: content mismatch at %#x\n", iFile, off);
+                break;
+            }
+    }
+    RTTestIValue("calls", g_cCalls - cCallsStart, RTTESTUNIT_CALLS);
+}
+
+
+/**
+ * Lists the small file directory, returning the number of entries.
+ */
+static uint32_t tstListDir(bool fCompound)
+{
+    RTTestISubF("Directory listing - %s", fCompound ? "compound" : "classic");
+
+    void *pvBuf = RTMemAlloc(TST_LIST_BUF_SIZE);
+    RTTESTI_CHECK_RET(pvBuf != NULL, 0);
+
+    uint32_t const cCallsStart = g_cCalls;
+    uint32_t   cTotal = 0;
+    SHFLHANDLE hDir   = SHFL_HANDLE_NIL;
+    int        rc;
+    if (!fCompound)
+        rc = tstOpen("/small", SHFL_CF_DIRECTORY | SHFL_CF_ACT_OPEN_IF_EXISTS | SHFL_CF_ACT_FAIL_IF_NEW | SHFL_CF_ACCESS_READ,
+                     &hDir);
+    else
+    {
+        PSHFLSTRING pPath = tstMakeUtf8String("/small");
+        RTTESTI_CHECK_RET(pPath != NULL, 0);
+        VBOXHGCMSVCPARM aParms[SHFL_CPARMS_LIST_DIR];
+        aParms[0].setUInt32(g_hRoot);
+        aParms[1].setPointer(pPath, SHFLSTRING_HEADER_SIZE + pPath->u16Size);
+        aParms[2].setUInt32(0);
+        aParms[3].setUInt32(TST_LIST_BUF_SIZE);
+        aParms[4].setPointer(pvBuf, TST_LIST_BUF_SIZE);
+        aParms[5].setUInt32(0);
+        aParms[6].setUInt64(SHFL_HANDLE_NIL);
+        rc = tstCall(SHFL_FN_LIST_DIR, SHFL_CPARMS_LIST_DIR, aParms);
+        cTotal = aParms[5].u.uint32;
+        hDir   = aParms[6].u.uint64;
+        RTMemFree(pPath);
+    }
+    RTTESTI_CHECK_RC(rc, VINF_SUCCESS);
+
+    /* Continue the classic way until done. */
+    while (RT_SUCCESS(rc) && hDir != SHFL_HANDLE_NIL)
+    {
+        uint32_t cFiles = 0;
+        rc = tstList(hDir, pvBuf, &cFiles);
+        cTotal += cFiles;
+        if (rc == VERR_NO_MORE_FILES)
+        {
+            RTTESTI_CHECK_RC(tstClose(hDir), VINF_SUCCESS);
+            hDir = SHFL_HANDLE_NIL;
+        }
+        else
+            RTTESTI_CHECK_RC(rc, VINF_SUCCESS);
+    }
+
+    RTTestIValue("calls", g_cCalls - cCallsStart, RTTESTUNIT_CALLS);
+    RTMemFree(pvBuf);
+    return cTotal;
+}
+
+
+/**
+ * Scattered reads or writes on the big file.
+ */
+static void tstScattered(bool fWrite, bool fVectored)
+{
+    RTTestISubF("Scattered %s - %s", fWrite ? "writes" : "reads", fVectored ? "vectored" : "classic");
+
+    uint8_t *pbBuf = (uint8_t *)RTMemAlloc(TST_SEGS * TST_SEG_SIZE);
+    RTTESTI_CHECK_RETV(pbBuf != NULL);
+
+    /* Every other 4K block from the middle. */
+    SHFLIOSEG aSegs[TST_SEGS];
+    for (uint32_t iSeg = 0; iSeg < TST_SEGS; iSeg++)
+    {
+        aSegs[iSeg].off    = TST_BIG_FILE_SIZE / 4 + (uint64_t)iSeg * 2 * TST_SEG_SIZE;
+        aSegs[iSeg].cb     = TST_SEG_SIZE;
+        aSegs[iSeg].cbDone = 0;
+        for (uint32_t off = 0; off < TST_SEG_SIZE; off++)
+            pbBuf[iSeg * TST_SEG_SIZE + off] = fWrite ? (uint8_t)~tstPatternByte(0, aSegs[iSeg].off + off) : 0;
+    }
+
+    SHFLHANDLE hFile;
+    RTTESTI_CHECK_RC_RETV(tstOpen("/big", SHFL_CF_ACT_OPEN_IF_EXISTS | SHFL_CF_ACT_FAIL_IF_NEW | SHFL_CF_ACCESS_READWRITE,
+                                  &hFile), VINF_SUCCESS);
+
+    uint32_t const cCallsStart = g_cCalls;
+    if (!fVectored)
+        for (uint32_t iSeg = 0; iSeg < TST_SEGS; iSeg++)
+        {
+            uint32_t cb = aSegs[iSeg].cb;
+            RTTESTI_CHECK_RC(tstReadWrite(fWrite, hFile, aSegs[iSeg].off, &pbBuf[iSeg * TST_SEG_SIZE], &cb), VINF_SUCCESS);
+            aSegs[iSeg].cbDone = cb;
+        }
+    else
+    {
+        VBOXHGCMSVCPARM aParms[SHFL_CPARMS_READ_VEC];
+        aParms[0].setUInt32(g_hRoot);
+        aParms[1].setUInt64(hFile);
+        aParms[2].setUInt32(TST_SEGS);
+        aParms[3].setPointer(aSegs, sizeof(aSegs));
+        aParms[4].setPointer(pbBuf, TST_SEGS * TST_SEG_SIZE);
+        RTTESTI_CHECK_RC(tstCall(fWrite ? SHFL_FN_WRITE_VEC : SHFL_FN_READ_VEC, SHFL_CPARMS_READ_VEC, aParms), VINF_SUCCESS);
+    }
+    RTTestIValue("calls", g_cCalls - cCallsStart, RTTESTUNIT_CALLS);
+
+    /* Check the result, reading back what was written with plain reads. */
+    for (uint32_t iSeg = 0; iSeg < TST_SEGS; iSeg++)
+    {
+        RTTESTI_CHECK_MSG(aSegs[iSeg].cbDone == TST_SEG_SIZE, ("seg %u: cbDone=%#x\n", iSeg, aSegs[iSeg].cbDone));
+        uint8_t *pbSeg = &pbBuf[iSeg * TST_SEG_SIZE];
+        if (fWrite)
+        {
+            uint32_t cb = TST_SEG_SIZE;
+            RTTESTI_CHECK_RC(tstReadWrite(false /*fWrite*/, hFile, aSegs[iSeg].off, pbSeg, &cb), VINF_SUCCESS);
+        }
+        for (uint32_t off = 0; off < TST_SEG_SIZE; off++)
+        {
+            uint8_t bExpect = tstPatternByte(0, aSegs[iSeg].off + off);
+            if (fWrite)
+                bExpect = (uint8_t)~bExpect;
+            if (pbSeg[off] != bExpect)
+            {
+                RTTestIFailed("seg %u: content mismatch at %#x\n", iSeg, off);
+                break;
+            }
+        }
+    }
+
+    /* Restore the original content for the next round. */
+    if (fWrite)
+        for (uint32_t iSeg = 0; iSeg < TST_SEGS; iSeg++)
+        {
+            uint8_t *pbSeg = &pbBuf[iSeg * TST_SEG_SIZE];
+            for (uint32_t off = 0; off < TST_SEG_SIZE; off++)
+                pbSeg[off] = tstPatternByte(0, aSegs[iSeg].off + off);
+            uint32_t cb = TST_SEG_SIZE;
+            RTTESTI_CHECK_RC(tstReadWrite(true /*fWrite*/, hFile, aSegs[iSeg].off, pbSeg, &cb), VINF_SUCCESS);
+        }
+
+    RTTESTI_CHECK_RC(tstClose(hFile), VINF_SUCCESS);
+    RTMemFree(pbBuf);
+}
+
+
+/**
+ * Parameter validation of the new functions.
+ */
+static void tstBadParams(void)
+{
+    RTTestISub("Parameter validation");
+
+    uint8_t abBuf[64];
+    PSHFLSTRING pPath = tstMakeUtf8String("/small/nonexistent");
+    RTTESTI_CHECK_RETV(pPath != NULL);
+
+    /* Missing file: succeeds without data, the result tells why. */
+    SHFLCREATEPARMS CreateParms;
+    RT_ZERO(CreateParms);
+    CreateParms.CreateFlags = SHFL_CF_ACT_OPEN_IF_EXISTS | SHFL_CF_ACT_FAIL_IF_NEW | SHFL_CF_ACCESS_READ;
+    VBOXHGCMSVCPARM aParms[SHFL_CPARMS_CREATE_READ_CLOSE];
+    aParms[0].setUInt32(g_hRoot);
+    aParms[1].setPointer(pPath, SHFLSTRING_HEADER_SIZE + pPath->u16Size);
+    aParms[2].setPointer(&CreateParms, sizeof(CreateParms));
+    aParms[3].setUInt64(0);
+    aParms[4].setUInt32(sizeof(abBuf));
+    aParms[5].setPointer(abBuf, sizeof(abBuf));
+    RTTESTI_CHECK_RC(tstCall(SHFL_FN_CREATE_READ_CLOSE, SHFL_CPARMS_CREATE_READ_CLOSE, aParms), VINF_SUCCESS);
+    RTTESTI_CHECK(CreateParms.Result == SHFL_FILE_NOT_FOUND);
+    RTTESTI_CHECK(aParms[4].u.uint32 == 0);
+
+    /* Creating is not allowed. */
+    RT_ZERO(CreateParms);
+    CreateParms.CreateFlags = SHFL_CF_ACT_OPEN_IF_EXISTS | SHFL_CF_ACT_CREATE_IF_NEW | SHFL_CF_ACCESS_READ;
+    aParms[4].setUInt32(sizeof(abBuf));
+    RTTESTI_CHECK_RC(tstCall(SHFL_FN_CREATE_READ_CLOSE, SHFL_CPARMS_CREATE_READ_CLOSE, aParms), VERR_INVALID_PARAMETER);
+
+    /* Segments larger than the buffer. */
+    SHFLHANDLE hFile;
+    RTTESTI_CHECK_RC_RETV(tstOpen("/big", SHFL_CF_ACT_OPEN_IF_EXISTS | SHFL_CF_ACT_FAIL_IF_NEW | SHFL_CF_ACCESS_READ,
+                                  &hFile), VINF_SUCCESS);
+    SHFLIOSEG aSegs[2] = { { 0, 32, 0 }, { 128, 64, 0 } };
+    aParms[0].setUInt32(g_hRoot);
+    aParms[1].setUInt64(hFile);
+    aParms[2].setUInt32(RT_ELEMENTS(aSegs));
+    aParms[3].setPointer(aSegs, sizeof(aSegs));
+    aParms[4].setPointer(abBuf, sizeof(abBuf));
+    RTTESTI_CHECK_RC(tstCall(SHFL_FN_READ_VEC, SHFL_CPARMS_READ_VEC, aParms), VERR_INVALID_PARAMETER);
+
+    /* Segment count not matching the array. */
+    aSegs[1].cb = 32;
+    aParms[2].setUInt32(3);
+    RTTESTI_CHECK_RC(tstCall(SHFL_FN_READ_VEC, SHFL_CPARMS_READ_VEC, aParms), VERR_INVALID_PARAMETER);
+
+    /* Reading across EOF stops at the short segment. */
+    aSegs[0].off = TST_BIG_FILE_SIZE - 16;
+    aParms[2].setUInt32(RT_ELEMENTS(aSegs));
+    RTTESTI_CHECK_RC(tstCall(SHFL_FN_READ_VEC, SHFL_CPARMS_READ_VEC, aParms), VINF_SUCCESS);
+    RTTESTI_CHECK(aSegs[0].cbDone == 16);
+    RTTESTI_CHECK(aSegs[1].cbDone == 0);
+
+    RTTESTI_CHECK_RC(tstClose(hFile), VINF_SUCCESS);
+    RTMemFree(pPath);
+}
+
+
+/**
+ * Writes a host file with the test pattern.
+ */
+static int tstCreateHostFile(const char *pszName, uint32_t iFile, uint32_t cb)
+{
+    char szPath[RTPATH_MAX];
+    RTStrPrintf(szPath, sizeof(szPath), "%s/%s", g_szDir, pszName);
+    uint8_t *pb = (uint8_t *)RTMemAlloc(cb);
+    if (!pb)
+        return VERR_NO_MEMORY;
+    for (uint32_t off = 0; off < cb; off++)
+        pb[off] = tstPatternByte(iFile, off);
+
+    RTFILE hFile;
+    int rc = RTFileOpen(&hFile, szPath, RTFILE_O_WRITE | RTFILE_O_CREATE | RTFILE_O_DENY_NONE);
+    if (RT_SUCCESS(rc))
+    {
+        rc = RTFileWrite(hFile, pb, cb, NULL);
+        RTFileClose(hFile);
+    }
+    RTMemFree(pb);
+    return rc;
+}
+
+
+int main()
+{
+    RTTEST hTest;
+    RTEXITCODE rcExit = RTTestInitAndCreate("tstShflCallCount", &hTest);
+    if (rcExit != RTEXITCODE_SUCCESS)
+        return rcExit;
+    RTTestBanner(hTest);
+
+    /*
+     * Create the test tree.
+     */
+    RTTESTI_CHECK_RC_RET(RTPathTemp(g_szDir, sizeof(g_szDir)), VINF_SUCCESS, RTTestSummaryAndDestroy(hTest));
+    RTTESTI_CHECK_RC_RET(RTPathAppend(g_szDir, sizeof(g_szDir), "tstShflCallCount-XXXXXX"), VINF_SUCCESS,
+                         RTTestSummaryAndDestroy(hTest));
+    RTTESTI_CHECK_RC_RET(RTDirCreateTemp(g_szDir, 0700), VINF_SUCCESS, RTTestSummaryAndDestroy(hTest));
+
+    char szPath[RTPATH_MAX];
+    RTStrPrintf(szPath, sizeof(szPath), "%s/small", g_szDir);
+    RTTESTI_CHECK_RC(RTDirCreate(szPath, 0700, 0), VINF_SUCCESS);
+    for (uint32_t iFile = 0; iFile < TST_SMALL_FILES && RTTestIErrorCount() == 0; iFile++)
+    {
+        char szName[64];
+        RTStrPrintf(szName, sizeof(szName), "small/file%02u", iFile);
+        RTTESTI_CHECK_RC(tstCreateHostFile(szName, iFile, _1K + iFile * 64), VINF_SUCCESS);
+    }
+    RTTESTI_CHECK_RC(tstCreateHostFile("big", 0, TST_BIG_FILE_SIZE), VINF_SUCCESS);
+
+    /*
+     * Do the workloads.
+     */
+    if (RTTestIErrorCount() == 0)
+        RTTESTI_CHECK_RC(tstSetup(), VINF_SUCCESS);
+    if (RTTestIErrorCount() == 0)
+    {
+        uint32_t const cCallsBefore = g_cCalls;
+        tstSmallFiles(false /*fCompound*/);
+        uint32_t const cCallsClassic = g_cCalls - cCallsBefore;
+        tstSmallFiles(true  /*fCompound*/);
+        uint32_t const cCallsCompound = g_cCalls - cCallsBefore - cCallsClassic;
+        RTTESTI_CHECK_MSG(cCallsCompound * 3 == cCallsClassic, ("%u vs %u\n", cCallsCompound, cCallsClassic));
+
+        uint32_t const cFilesClassic  = tstListDir(false /*fCompound*/);
+        uint32_t const cFilesCompound = tstListDir(true  /*fCompound*/);
+        RTTESTI_CHECK_MSG(cFilesClassic == cFilesCompound, ("%u vs %u\n", cFilesClassic, cFilesCompound));
+        RTTESTI_CHECK_MSG(cFilesClassic >= TST_SMALL_FILES, ("%u\n", cFilesClassic)); /* plus '.' and '..' */
+
+        tstScattered(false /*fWrite*/, false /*fVectored*/);
+        tstScattered(false /*fWrite*/, true  /*fVectored*/);
+        tstScattered(true  /*fWrite*/, false /*fVectored*/);
+        tstScattered(true  /*fWrite*/, true  /*fVectored*/);
+
+        tstBadParams();
+    }
+
+    /*
+     * Cleanup.
+     */
+    tstShflSvcUnload();
+    RTDirRemoveRecursive(g_szDir, RTDIRRMREC_F_CONTENT_AND_DIR);
+
+    return RTTestSummaryAndDestroy(hTest);
+}
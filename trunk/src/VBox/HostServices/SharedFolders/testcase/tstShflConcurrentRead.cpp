@@ -0,0 +1,254 @@
+/* $Id$ */
+/** @file
+ * Testcase for concurrent shared folder guest calls - reader throughput.
+ *
+ * Drives SHFL_FN_READ through the service entry point from several threads
+ * the way the HGCM worker pool does (VBOX_HGCM_SVC_F_CALL_WORKERS), checking
+ * that concurrent reads on one handle return the right data and measuring
+ * the throughput.
+ */
+
+/*
+ * Copyright (C) 2006-2017 Oracle Corporation
+ *
+ * This file is part of VirtualBox Open Source Edition (OSE), as
+ * available from http://www.virtualbox.org. This file is free software;
+ * you can redistribute it and/or modify it under the terms of the GNU
+ * General Public License (GPL) as published by the Free Software
+ * Foundation, in version 2 as it comes in the "COPYING" file of the
+ * VirtualBox OSE distribution. VirtualBox OSE is distributed in the
+ * hope that it will be useful, but WITHOUT ANY WARRANTY of any kind.
+ */
+
+
+/*********************************************************************************************************************************
+*   Header Files                                                                                                                 *
+*********************************************************************************************************************************/
+#include "tstShflHgcm.h"
+
+#include <iprt/alloc.h>
+#include <iprt/asm.h>
+#include <iprt/dir.h>
+#include <iprt/file.h>
+#include <iprt/path.h>
+#include <iprt/semaphore.h>
+#include <iprt/string.h>
+#include <iprt/test.h>
+#include <iprt/thread.h>
+#include <iprt/time.h>
+
+
+/*********************************************************************************************************************************
+*   Defined Constants And Macros                                                                                                 *
+*********************************************************************************************************************************/
+/** The size of the test file. */
+#define TST_FILE_SIZE       _16M
+/** The size of each read. */
+#define TST_READ_SIZE       _64K
+
+
+/*********************************************************************************************************************************
+*   Structures and Typedefs                                                                                                      *
+*********************************************************************************************************************************/
+typedef struct TSTTHREAD
+{
+    RTTHREAD            hThread;
+    uint32_t            iThread;
+    uint32_t            cThreads;
+    uint64_t volatile   cbRead;
+} TSTTHREAD, *PTSTTHREAD;
+
+
+/*********************************************************************************************************************************
+*   Global Variables                                                                                                             *
+*********************************************************************************************************************************/
+static SHFLHANDLE           g_hFile = SHFL_HANDLE_NIL;
+static RTSEMEVENTMULTI      g_hEvtGo;
+static bool volatile        g_fStop;
+
+
+/**
+ * Loads the service, maps the folder and opens the test file.
+ */
+static int tstSetup(const char *pszDir)
+{
+    int rc = tstShflSvcLoad();
+    if (RT_FAILURE(rc))
+        return rc;
+    if (!(g_SvcTable.fFlags & VBOX_HGCM_SVC_F_CALL_WORKERS))
+        RTTestIFailed("Service does not use the worker pool");
+    rc = tstShflSvcMapFolder(pszDir, 0 /* read-only */);
+    if (RT_FAILURE(rc))
+        return rc;
+
+    PSHFLSTRING pPath = tstMakeUtf16String("/data.bin");
+    if (!pPath)
+        return VERR_NO_MEMORY;
+    SHFLCREATEPARMS CreateParms;
+    RT_ZERO(CreateParms);
+    CreateParms.Handle      = SHFL_HANDLE_NIL;
+    CreateParms.CreateFlags = SHFL_CF_ACT_OPEN_IF_EXISTS | SHFL_CF_ACT_FAIL_IF_NEW | SHFL_CF_ACCESS_READ;
+    VBOXHGCMSVCPARM aParms[SHFL_CPARMS_CREATE];
+    aParms[0].setUInt32(g_hRoot);
+    aParms[1].setPointer(pPath, SHFLSTRING_HEADER_SIZE + pPath->u16Size);
+    aParms[2].setPointer(&CreateParms, sizeof(CreateParms));
+    rc = tstCall(SHFL_FN_CREATE, SHFL_CPARMS_CREATE, aParms);
+    if (RT_SUCCESS(rc) && CreateParms.Handle == SHFL_HANDLE_NIL)
+        rc = VERR_FILE_NOT_FOUND;
+    if (RT_SUCCESS(rc))
+        g_hFile = CreateParms.Handle;
+    RTMemFree(pPath);
+    return rc;
+}
+
+
+static DECLCALLBACK(int) tstReaderThread(RTTHREAD hThreadSelf, void *pvUser)
+{
+    PTSTTHREAD pThread = (PTSTTHREAD)pvUser;
+    RT_NOREF_PV(hThreadSelf);
+
+    uint32_t *pau32Buf = (uint32_t *)RTMemAlloc(TST_READ_SIZE);
+    RTTESTI_CHECK_RET(pau32Buf != NULL, VERR_NO_MEMORY);
+    RTTESTI_CHECK_RC_OK(RTSemEventMultiWait(g_hEvtGo, RT_INDEFINITE_WAIT));
+
+    /* Each thread walks the file with its own phase so the offsets interleave. */
+    uint64_t cbRead = 0;
+    uint64_t off    = (uint64_t)pThread->iThread * TST_READ_SIZE;
+    while (!ASMAtomicReadBool(&g_fStop))
+    {
+        VBOXHGCMSVCPARM aParms[SHFL_CPARMS_READ];
+        aParms[0].setUInt32(g_hRoot);
+        aParms[1].setUInt64(g_hFile);
+        aParms[2].setUInt64(off);
+        aParms[3].setUInt32(TST_READ_SIZE);
+        aParms[4].setPointer(pau32Buf, TST_READ_SIZE);
+        int rc = tstCall(SHFL_FN_READ, SHFL_CPARMS_READ, aParms);
+        if (   RT_FAILURE(rc)
+            || aParms[3].u.uint32 != TST_READ_SIZE
+            || pau32Buf[0] != (uint32_t)(off / sizeof(uint32_t))
+            || pau32Buf[TST_READ_SIZE / sizeof(uint32_t) - 1] != (uint32_t)((off + TST_READ_SIZE) / sizeof(uint32_t) - 1))
+        {
+            RTTestIFailed("Read at %#RX64 failed: rc=%Rrc cb=%#x first=%#x\n", off, rc, aParms[3].u.uint32, pau32Buf[0]);
+            break;
+        }
+        cbRead += TST_READ_SIZE;
+
+        off += (uint64_t)pThread->cThreads * TST_READ_SIZE;
+        if (off + TST_READ_SIZE > TST_FILE_SIZE)
+            off = (uint64_t)pThread->iThread * TST_READ_SIZE;
+    }
+
+    pThread->cbRead = cbRead;
+    RTMemFree(pau32Buf);
+    return VINF_SUCCESS;
+}
+
+
+/**
+ * Time constrained throughput run with N threads reading the same handle.
+ */
+static void tstReaders(uint32_t cThreads, uint32_t cSecs)
+{
+    RTTestISubF("%u readers, %u secs", cThreads, cSecs);
+
+    TSTTHREAD aThreads[16];
+    RTTESTI_CHECK_RETV(cThreads <= RT_ELEMENTS(aThreads));
+    RTTESTI_CHECK_RC_OK_RETV(RTSemEventMultiReset(g_hEvtGo));
+    ASMAtomicWriteBool(&g_fStop, false);
+
+    for (uint32_t i = 0; i < cThreads; i++)
+    {
+        aThreads[i].iThread  = i;
+        aThreads[i].cThreads = cThreads;
+        aThreads[i].cbRead   = 0;
+        RTTESTI_CHECK_RC_OK_RETV(RTThreadCreateF(&aThreads[i].hThread, tstReaderThread, &aThreads[i], 0,
+                                                 RTTHREADTYPE_IO, RTTHREADFLAGS_WAITABLE, "rd-%u", i));
+    }
+
+    uint64_t const nsStart = RTTimeNanoTS();
+    RTTESTI_CHECK_RC_OK(RTSemEventMultiSignal(g_hEvtGo));
+    RTThreadSleep(cSecs * RT_MS_1SEC);
+    ASMAtomicWriteBool(&g_fStop, true);
+    uint64_t cbTotal = 0;
+    for (uint32_t i = 0; i < cThreads; i++)
+    {
+        RTTESTI_CHECK_RC_OK(RTThreadWait(aThreads[i].hThread, RT_MS_1MIN, NULL));
+        cbTotal += aThreads[i].cbRead;
+    }
+    uint64_t const cNsElapsed = RTTimeNanoTS() - nsStart;
+
+    RTTestIValueF(cbTotal * RT_NS_1SEC / _1K / RT_MAX(cNsElapsed, 1), RTTESTUNIT_KILOBYTES_PER_SEC, "%u readers", cThreads);
+}
+
+
+int main(int argc, char **argv)
+{
+    RT_NOREF_PV(argv);
+
+    RTTEST hTest;
+    RTEXITCODE rcExit = RTTestInitAndCreate("tstShflConcurrentRead", &hTest);
+    if (rcExit != RTEXITCODE_SUCCESS)
+        return rcExit;
+    RTTestBanner(hTest);
+
+    /*
+     * Create the test file, each dword holding its own index.
+     */
+    char szDir[RTPATH_MAX];
+    RTTESTI_CHECK_RC_RET(RTPathTemp(szDir, sizeof(szDir)), VINF_SUCCESS, RTTestSummaryAndDestroy(hTest));
+    RTTESTI_CHECK_RC_RET(RTPathAppend(szDir, sizeof(szDir), "tstShflConcurrentRead-XXXXXX"), VINF_SUCCESS,
+                         RTTestSummaryAndDestroy(hTest));
+    RTTESTI_CHECK_RC_RET(RTDirCreateTemp(szDir, 0700), VINF_SUCCESS, RTTestSummaryAndDestroy(hTest));
+
+    char szFile[RTPATH_MAX];
+    RTStrPrintf(szFile, sizeof(szFile), "%s/data.bin", szDir);
+    RTFILE hFile;
+    int rc = RTFileOpen(&hFile, szFile, RTFILE_O_WRITE | RTFILE_O_CREATE | RTFILE_O_DENY_NONE);
+    RTTESTI_CHECK_RC(rc, VINF_SUCCESS);
+    if (RT_SUCCESS(rc))
+    {
+        uint32_t *pau32 = (uint32_t *)RTMemAlloc(_1M);
+        RTTESTI_CHECK(pau32 != NULL);
+        for (uint32_t iChunk = 0; pau32 && iChunk < TST_FILE_SIZE / _1M && RT_SUCCESS(rc); iChunk++)
+        {
+            for (uint32_t i = 0; i < _1M / sizeof(uint32_t); i++)
+                pau32[i] = iChunk * (_1M / sizeof(uint32_t)) + i;
+            rc = RTFileWrite(hFile, pau32, _1M, NULL);
+            RTTESTI_CHECK_RC_OK(rc);
+        }
+        RTMemFree(pau32);
+        RTFileClose(hFile);
+    }
+
+    /*
+     * Load the service and do the runs.
+     */
+    if (RTTestIErrorCount() == 0)
+    {
+        RTTESTI_CHECK_RC(tstSetup(szDir), VINF_SUCCESS);
+        RTTESTI_CHECK_RC(RTSemEventMultiCreate(&g_hEvtGo), VINF_SUCCESS);
+    }
+    if (RTTestIErrorCount() == 0)
+    {
+        uint32_t const cSecs = argc > 1 ? 5 : 1;
+        static uint32_t const s_acThreads[] = { 1, 2, 4, 8 };
+        for (unsigned i = 0; i < RT_ELEMENTS(s_acThreads) && RTTestIErrorCount() == 0; i++)
+            tstReaders(s_acThreads[i], cSecs);
+    }
+
+    /*
+     * Cleanup.
+     */
+    if (g_hFile != SHFL_HANDLE_NIL)
+    {
+        VBOXHGCMSVCPARM aParms[SHFL_CPARMS_CLOSE];
+        aParms[0].setUInt32(g_hRoot);
+        aParms[1].setUInt64(g_hFile);
+        RTTESTI_CHECK_RC(tstCall(SHFL_FN_CLOSE, SHFL_CPARMS_CLOSE, aParms), VINF_SUCCESS);
+    }
+    RTSemEventMultiDestroy(g_hEvtGo);
+    tstShflSvcUnload();
+    RTDirRemoveRecursive(szDir, RTDIRRMREC_F_CONTENT_AND_DIR);
+
+    return RTTestSummaryAndDestroy(hTest);
+}
@@ -0,0 +1,149 @@
+/* $Id$ */
+/** @file
+ * VBox Shared Folders testcase helpers for driving the service through its
+ * HGCM entry points.
+ */
+
+/*
+ * Copyright (C) 2006-2017 Oracle Corporation
+ *
+ * This file is part of VirtualBox Open Source Edition (OSE), as
+ * available from http://www.virtualbox.org. This file is free software;
+ * you can redistribute it and/or modify it under the terms of the GNU
+ * General Public License (GPL) as published by the Free Software
+ * Foundation, in version 2 as it comes in the "COPYING" file of the
+ * VirtualBox OSE distribution. VirtualBox OSE is distributed in the
+ * hope that it will be useful, but WITHOUT ANY WARRANTY of any kind.
+ */
+
+
+/*********************************************************************************************************************************
+*   Header Files                                                                                                                 *
+*********************************************************************************************************************************/
+#include "tstShflHgcm.h"
+
+#include <iprt/alloc.h>
+#include <iprt/asm.h>
+#include <iprt/string.h>
+
+
+/*********************************************************************************************************************************
+*   Global Variables                                                                                                             *
+*********************************************************************************************************************************/
+VBOXHGCMSVCFNTABLE          g_SvcTable;
+static VBOXHGCMSVCHELPERS   g_SvcHelpers;
+void                       *g_pvClient;
+SHFLROOT                    g_hRoot;
+uint32_t volatile           g_cCalls;
+
+
+extern "C" DECLCALLBACK(DECLEXPORT(int)) VBoxHGCMSvcLoad(VBOXHGCMSVCFNTABLE *ptable);
+
+
+static DECLCALLBACK(void) tstCallComplete(VBOXHGCMCALLHANDLE callHandle, int32_t rc)
+{
+    callHandle->rc = rc;
+}
+
+
+/**
+ * Makes a guest call, counting it.
+ *
+ * The service completes all calls before returning from pfnCall in this
+ * setup, so this may be used from several threads at once.
+ */
+int tstCall(uint32_t uFunction, uint32_t cParms, VBOXHGCMSVCPARM *paParms)
+{
+    VBOXHGCMCALLHANDLE_TYPEDEF CallHandle = { VERR_INTERNAL_ERROR };
+    g_SvcTable.pfnCall(g_SvcTable.pvService, &CallHandle, 1, g_pvClient, uFunction, cParms, paParms);
+    ASMAtomicIncU32(&g_cCalls);
+    return CallHandle.rc;
+}
+
+
+/**
+ * Allocates a UTF-16 shared folder string, free with RTMemFree.
+ */
+PSHFLSTRING tstMakeUtf16String(const char *psz)
+{
+    size_t const cch = strlen(psz);
+    PSHFLSTRING pString = (PSHFLSTRING)RTMemAllocZ(SHFLSTRING_HEADER_SIZE + (cch + 1) * sizeof(RTUTF16));
+    if (pString)
+    {
+        pString->u16Length = (uint16_t)(cch * sizeof(RTUTF16));
+        pString->u16Size   = (uint16_t)((cch + 1) * sizeof(RTUTF16));
+        for (size_t i = 0; i <= cch; i++)
+            pString->String.ucs2[i] = (RTUTF16)psz[i];
+    }
+    return pString;
+}
+
+
+/**
+ * Loads the service and allocates the client.
+ */
+int tstShflSvcLoad(void)
+{
+    g_SvcTable.cbSize            = sizeof(g_SvcTable);
+    g_SvcTable.u32Version        = VBOX_HGCM_SVC_VERSION;
+    g_SvcHelpers.pfnCallComplete = tstCallComplete;
+    g_SvcTable.pHelpers          = &g_SvcHelpers;
+    int rc = VBoxHGCMSvcLoad(&g_SvcTable);
+    if (RT_FAILURE(rc))
+        return rc;
+    g_pvClient = RTMemAllocZ(g_SvcTable.cbClient);
+    if (!g_pvClient)
+        return VERR_NO_MEMORY;
+    return VINF_SUCCESS;
+}
+
+
+/**
+ * Unloads the service and frees the client.
+ */
+void tstShflSvcUnload(void)
+{
+    if (g_SvcTable.pfnUnload)
+        g_SvcTable.pfnUnload(g_SvcTable.pvService);
+    RT_ZERO(g_SvcTable);
+    RTMemFree(g_pvClient);
+    g_pvClient = NULL;
+}
+
+
+/**
+ * Adds a mapping called "tst" for the given directory and maps it
+ * case sensitively, setting g_hRoot.
+ *
+ * @param   pszDir      The host directory.
+ * @param   fFlags      SHFL_ADD_MAPPING_F_XXX.
+ */
+int tstShflSvcMapFolder(const char *pszDir, uint32_t fFlags)
+{
+    int         rc;
+    PSHFLSTRING pFolderName = tstMakeUtf16String(pszDir);
+    PSHFLSTRING pMapName    = tstMakeUtf16String("tst");
+    if (!pFolderName || !pMapName)
+        rc = VERR_NO_MEMORY;
+    else
+    {
+        VBOXHGCMSVCPARM aParms[RT_MAX(SHFL_CPARMS_ADD_MAPPING, SHFL_CPARMS_MAP_FOLDER)];
+        aParms[0].setPointer(pFolderName, SHFLSTRING_HEADER_SIZE + pFolderName->u16Size);
+        aParms[1].setPointer(pMapName, SHFLSTRING_HEADER_SIZE + pMapName->u16Size);
+        aParms[2].setUInt32(fFlags);
+        rc = g_SvcTable.pfnHostCall(g_SvcTable.pvService, SHFL_FN_ADD_MAPPING, SHFL_CPARMS_ADD_MAPPING, aParms);
+        if (RT_SUCCESS(rc))
+        {
+            aParms[0].setPointer(pMapName, SHFLSTRING_HEADER_SIZE + pMapName->u16Size);
+            aParms[1].setUInt32(0);
+            aParms[2].setUInt32('/');
+            aParms[3].setUInt32(1 /* case sensitive */);
+            rc = tstCall(SHFL_FN_MAP_FOLDER, SHFL_CPARMS_MAP_FOLDER, aParms);
+            if (RT_SUCCESS(rc))
+                g_hRoot = aParms[1].u.uint32;
+        }
+    }
+    RTMemFree(pFolderName);
+    RTMemFree(pMapName);
+    return rc;
+}
@@ -0,0 +1,46 @@
+/* $Id$ */
+/** @file
+ * VBox Shared Folders testcase helpers for driving the service through its
+ * HGCM entry points.
+ */
+
+/*
+ * Copyright (C) 2006-2017 Oracle Corporation
+ *
+ * This file is part of VirtualBox Open Source Edition (OSE), as
+ * available from http://www.virtualbox.org. This file is free software;
+ * you can redistribute it and/or modify it under the terms of the GNU
+ * General Public License (GPL) as published by the Free Software
+ * Foundation, in version 2 as it comes in the "COPYING" file of the
+ * VirtualBox OSE distribution. VirtualBox OSE is distributed in the
+ * hope that it will be useful, but WITHOUT ANY WARRANTY of any kind.
+ */
+
+#ifndef __VBSF_TST_SHFL_HGCM__H
+#define __VBSF_TST_SHFL_HGCM__H
+
+#include <VBox/shflsvc.h>
+#include <VBox/hgcmsvc.h>
+
+/** Call handle, receives the status of the call. */
+struct VBOXHGCMCALLHANDLE_TYPEDEF
+{
+    int32_t volatile rc;
+};
+
+/** The service function table filled in by tstShflSvcLoad. */
+extern VBOXHGCMSVCFNTABLE   g_SvcTable;
+/** The client data of the one and only client. */
+extern void                *g_pvClient;
+/** The root handle of the mapping set up by tstShflSvcMapFolder. */
+extern SHFLROOT             g_hRoot;
+/** Number of guest calls made through tstCall. */
+extern uint32_t volatile    g_cCalls;
+
+int         tstShflSvcLoad(void);
+void        tstShflSvcUnload(void);
+int         tstShflSvcMapFolder(const char *pszDir, uint32_t fFlags);
+int         tstCall(uint32_t uFunction, uint32_t cParms, VBOXHGCMSVCPARM *paParms);
+PSHFLSTRING tstMakeUtf16String(const char *psz);
+
+#endif /* __VBSF_TST_SHFL_HGCM__H */
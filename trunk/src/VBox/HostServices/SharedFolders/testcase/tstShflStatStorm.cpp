@@ -0,0 +1,244 @@
+/* $Id$ */
+/** @file
+ * Testcase for the shared folder case correction cache - stat storm benchmark.
+ */
+
+/*
+ * Copyright (C) 2006-2017 Oracle Corporation
+ *
+ * This file is part of VirtualBox Open Source Edition (OSE), as
+ * available from http://www.virtualbox.org. This file is free software;
+ * you can redistribute it and/or modify it under the terms of the GNU
+ * General Public License (GPL) as published by the Free Software
+ * Foundation, in version 2 as it comes in the "COPYING" file of the
+ * VirtualBox OSE distribution. VirtualBox OSE is distributed in the
+ * hope that it will be useful, but WITHOUT ANY WARRANTY of any kind.
+ */
+
+
+/*********************************************************************************************************************************
+*   Header Files                                                                                                                 *
+*********************************************************************************************************************************/
+#include "mappings.h"
+#include "vbsfpath.h"
+#include "vbsfpathcache.h"
+#include "tstShflHgcm.h"
+
+#include <iprt/alloc.h>
+#include <iprt/dir.h>
+#include <iprt/file.h>
+#include <iprt/fs.h>
+#include <iprt/path.h>
+#include <iprt/string.h>
+#include <iprt/test.h>
+#include <iprt/time.h>
+
+
+/*********************************************************************************************************************************
+*   Defined Constants And Macros                                                                                                 *
+*********************************************************************************************************************************/
+/** Number of files in the test directory. */
+#define TST_FILES       128
+
+
+/*********************************************************************************************************************************
+*   Global Variables                                                                                                             *
+*********************************************************************************************************************************/
+/** The temporary directory serving as mapping root. */
+static char             g_szRoot[RTPATH_MAX];
+/** Guest client, UTF-8 with slashes. */
+static SHFLCLIENTDATA   g_Client = { SHFL_CF_UTF8, '/' };
+/** The mis-cased guest paths. */
+static PSHFLSTRING      g_apGuestPaths[TST_FILES];
+
+
+/**
+ * Allocates a UTF-8 shared folder string.
+ */
+static PSHFLSTRING tstMakeUtf8String(const char *psz)
+{
+    size_t const cch = strlen(psz);
+    PSHFLSTRING pString = (PSHFLSTRING)RTMemAllocZ(SHFLSTRING_HEADER_SIZE + cch + 1);
+    if (pString)
+    {
+        pString->u16Length = (uint16_t)cch;
+        pString->u16Size   = (uint16_t)(cch + 1);
+        memcpy(pString->String.utf8, psz, cch + 1);
+    }
+    return pString;
+}
+
+
+/**
+ * Resolves a guest path and stats it the way SHFL_FN_INFORMATION would.
+ */
+static int tstResolveAndStat(SHFLROOT hRoot, PSHFLSTRING pGuestPath, char *pszHostPath, size_t cbHostPath)
+{
+    char *pszFullPath = NULL;
+    int rc = vbsfPathGuestToHost(&g_Client, hRoot, pGuestPath, SHFLSTRING_HEADER_SIZE + pGuestPath->u16Size,
+                                 &pszFullPath, NULL, VBSF_O_PATH_CHECK_ROOT_ESCAPE, NULL);
+    if (RT_SUCCESS(rc))
+    {
+        RTFSOBJINFO ObjInfo;
+        rc = RTPathQueryInfoEx(pszFullPath, &ObjInfo, RTFSOBJATTRADD_NOTHING, RTPATH_F_ON_LINK);
+        if (pszHostPath)
+            RTStrCopy(pszHostPath, cbHostPath, pszFullPath);
+        vbsfFreeHostPath(pszFullPath);
+    }
+    return rc;
+}
+
+
+/**
+ * Times a number of stat storm rounds.
+ */
+static void tstStorm(SHFLROOT hRoot, bool fCached, uint32_t cRounds)
+{
+    RTTestISubF("Stat storm - %s", fCached ? "cached" : "uncached");
+
+    PVBSFPATHCACHE pCache = vbsfMappingsQueryPathCache(hRoot);
+    RTTESTI_CHECK_RETV(pCache != NULL);
+    vbsfPathCacheFlush(pCache);
+    VBSFPATHCACHESTATS StatsBefore;
+    vbsfPathCacheQueryStats(pCache, &StatsBefore);
+
+    uint64_t const nsStart = RTTimeNanoTS();
+    for (uint32_t iRound = 0; iRound < cRounds; iRound++)
+        for (uint32_t i = 0; i < TST_FILES; i++)
+        {
+            if (!fCached)
+                vbsfPathCacheFlush(pCache);
+            int rc = tstResolveAndStat(hRoot, g_apGuestPaths[i], NULL, 0);
+            if (RT_FAILURE(rc))
+            {
+                RTTestIFailed("%s: %Rrc", g_apGuestPaths[i]->String.utf8, rc);
+                return;
+            }
+        }
+    uint64_t const cNsElapsed = RTTimeNanoTS() - nsStart;
+    RTTestIValue("ns/lookup", cNsElapsed / (cRounds * TST_FILES), RTTESTUNIT_NS_PER_CALL);
+
+    VBSFPATHCACHESTATS Stats;
+    vbsfPathCacheQueryStats(pCache, &Stats);
+    if (fCached)
+        RTTESTI_CHECK_MSG(Stats.cHits - StatsBefore.cHits >= (uint64_t)(cRounds - 1) * TST_FILES,
+                          ("cHits=%RU64 cMisses=%RU64\n", Stats.cHits - StatsBefore.cHits, Stats.cMisses - StatsBefore.cMisses));
+    else
+        RTTESTI_CHECK_MSG(Stats.cHits == StatsBefore.cHits, ("cHits=%RU64\n", Stats.cHits - StatsBefore.cHits));
+}
+
+
+/**
+ * Checks that host side renames are picked up.
+ */
+static void tstHostRename(SHFLROOT hRoot)
+{
+    RTTestISub("Host rename");
+
+    VBSFPATHCACHESTATS Stats;
+    vbsfPathCacheQueryStats(vbsfMappingsQueryPathCache(hRoot), &Stats);
+    if (!Stats.fNotifications)
+    {
+        RTTestSkipped(NIL_RTTEST, "no host change notifications");
+        return;
+    }
+
+    char szHostPath[RTPATH_MAX];
+    RTTESTI_CHECK_RC_RETV(tstResolveAndStat(hRoot, g_apGuestPaths[0], szHostPath, sizeof(szHostPath)), VINF_SUCCESS);
+
+    char szNewPath[RTPATH_MAX];
+    RTStrPrintf(szNewPath, sizeof(szNewPath), "%s/Dir/SubDir/FILE000.TXT", g_szRoot);
+    RTTESTI_CHECK_RC_RETV(RTFileRename(szHostPath, szNewPath, 0), VINF_SUCCESS);
+
+    char szResolved[RTPATH_MAX];
+    RTTESTI_CHECK_RC_RETV(tstResolveAndStat(hRoot, g_apGuestPaths[0], szResolved, sizeof(szResolved)), VINF_SUCCESS);
+    RTTESTI_CHECK_MSG(!strcmp(szResolved, szNewPath), ("'%s' vs '%s'\n", szResolved, szNewPath));
+
+    RTFileRename(szNewPath, szHostPath, 0);
+}
+
+
+int main(int argc, char **argv)
+{
+    RT_NOREF1(argv);
+
+    RTTEST hTest;
+    RTEXITCODE rcExit = RTTestInitAndCreate("tstShflStatStorm", &hTest);
+    if (rcExit != RTEXITCODE_SUCCESS)
+        return rcExit;
+    RTTestBanner(hTest);
+
+    /*
+     * Set up a tree with the casing the guest will get wrong.
+     */
+    RTTESTI_CHECK_RC_RET(RTPathTemp(g_szRoot, sizeof(g_szRoot)), VINF_SUCCESS, RTTestSummaryAndDestroy(hTest));
+    RTTESTI_CHECK_RC_RET(RTPathAppend(g_szRoot, sizeof(g_szRoot), "tstShflStatStorm-XXXXXX"), VINF_SUCCESS,
+                         RTTestSummaryAndDestroy(hTest));
+    RTTESTI_CHECK_RC_RET(RTDirCreateTemp(g_szRoot, 0700), VINF_SUCCESS, RTTestSummaryAndDestroy(hTest));
+
+    RTFSPROPERTIES FsProps;
+    if (   RT_FAILURE(RTFsQueryProperties(g_szRoot, &FsProps))
+        || !FsProps.fCaseSensitive)
+    {
+        RTDirRemove(g_szRoot);
+        return RTTestSkipAndDestroy(hTest, "Host file system is not case sensitive");
+    }
+
+    char szPath[RTPATH_MAX];
+    RTStrPrintf(szPath, sizeof(szPath), "%s/Dir", g_szRoot);
+    RTTESTI_CHECK_RC(RTDirCreate(szPath, 0700, 0), VINF_SUCCESS);
+    RTStrPrintf(szPath, sizeof(szPath), "%s/Dir/SubDir", g_szRoot);
+    RTTESTI_CHECK_RC(RTDirCreate(szPath, 0700, 0), VINF_SUCCESS);
+    for (uint32_t i = 0; i < TST_FILES && RTTestIErrorCount() == 0; i++)
+    {
+        RTFILE hFile;
+        RTStrPrintf(szPath, sizeof(szPath), "%s/Dir/SubDir/File%03u.txt", g_szRoot, i);
+        RTTESTI_CHECK_RC(RTFileOpen(&hFile, szPath, RTFILE_O_WRITE | RTFILE_O_CREATE | RTFILE_O_DENY_NONE), VINF_SUCCESS);
+        RTFileClose(hFile);
+
+        RTStrPrintf(szPath, sizeof(szPath), "/dir/SUBDIR/file%03u.TXT", i);
+        g_apGuestPaths[i] = tstMakeUtf8String(szPath);
+        RTTESTI_CHECK(g_apGuestPaths[i] != NULL);
+    }
+
+    /*
+     * Add a case insensitive mapping for it.
+     */
+    vbsfMappingInit();
+    PSHFLSTRING pMapName     = tstMakeUtf16String("storm");
+    PSHFLSTRING pMapNameUtf8 = tstMakeUtf8String("storm");
+    SHFLROOT    hRoot        = SHFL_ROOT_NIL;
+    if (RTTestIErrorCount() == 0)
+    {
+        RTTESTI_CHECK_RC(vbsfMappingsAdd(g_szRoot, pMapName, false /*fWritable*/, false /*fAutoMount*/,
+                                         false /*fSymlinksCreate*/, false /*fMissing*/, false /*fPlaceholder*/),
+                         VINF_SUCCESS);
+        RTTESTI_CHECK_RC(vbsfMapFolder(&g_Client, pMapNameUtf8, '/', false /*fCaseSensitive*/, &hRoot), VINF_SUCCESS);
+    }
+
+    /*
+     * Do the storms.
+     */
+    if (RTTestIErrorCount() == 0)
+    {
+        uint32_t const cRounds = argc > 1 ? 200 : 20;
+        tstStorm(hRoot, false /*fCached*/, cRounds);
+        tstStorm(hRoot, true  /*fCached*/, cRounds);
+        tstHostRename(hRoot);
+    }
+
+    /*
+     * Cleanup.
+     */
+    if (hRoot != SHFL_ROOT_NIL)
+        vbsfUnmapFolder(&g_Client, hRoot);
+    if (pMapName)
+        vbsfMappingsRemove(pMapName);
+    RTMemFree(pMapName);
+    RTMemFree(pMapNameUtf8);
+    for (uint32_t i = 0; i < TST_FILES; i++)
+        RTMemFree(g_apGuestPaths[i]);
+    RTDirRemoveRecursive(g_szRoot, RTDIRRMREC_F_CONTENT_AND_DIR);
+
+    return RTTestSummaryAndDestroy(hTest);
+}
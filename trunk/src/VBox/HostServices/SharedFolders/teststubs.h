@@ -56,6 +56,8 @@ extern int testRTFileOpen(PRTFILE pFile, const char *pszFilename, uint64_t fOpen
 extern int testRTFileQueryInfo(RTFILE hFile, PRTFSOBJINFO pObjInfo, RTFSOBJATTRADD enmAdditionalAttribs);
 #define RTFileRead           testRTFileRead
 extern int testRTFileRead(RTFILE hFile, void *pvBuf, size_t cbToRead, size_t *pcbRead);
+#define RTFileReadAt         testRTFileReadAt
+extern int testRTFileReadAt(RTFILE hFile, RTFOFF off, void *pvBuf, size_t cbToRead, size_t *pcbRead);
 #define RTFileSetMode        testRTFileSetMode
 extern int testRTFileSetMode(RTFILE hFile, RTFMODE fMode);
 #define RTFileSetSize        testRTFileSetSize
@@ -68,6 +70,8 @@ extern int testRTFileSeek(RTFILE hFile, int64_t offSeek, unsigned uMethod, uint6
 extern int testRTFileUnlock(RTFILE hFile, int64_t offLock, uint64_t cbLock);
 #define RTFileWrite          testRTFileWrite
 extern int testRTFileWrite(RTFILE hFile, const void *pvBuf, size_t cbToWrite, size_t *pcbWritten);
+#define RTFileWriteAt        testRTFileWriteAt
+extern int testRTFileWriteAt(RTFILE hFile, RTFOFF off, const void *pvBuf, size_t cbToWrite, size_t *pcbWritten);
 #define RTFsQueryProperties  testRTFsQueryProperties
 extern int testRTFsQueryProperties(const char *pszFsPath, PRTFSPROPERTIES pProperties);
 #define RTFsQuerySerial      testRTFsQuerySerial
@@ -1033,15 +1033,10 @@ int vbsfRead(SHFLCLIENTDATA *pClient, SHFLROOT root, SHFLHANDLE Handle, uint64_t
 
     if (RT_LIKELY(*pcbBuffer != 0))
     {
-        rc = RTFileSeek(pHandle->file.Handle, offset, RTFILE_SEEK_BEGIN, NULL);
-        if (RT_SUCCESS(rc))
-        {
-            size_t count = 0;
-            rc = RTFileRead(pHandle->file.Handle, pBuffer, *pcbBuffer, &count);
-            *pcbBuffer = (uint32_t)count;
-        }
-        else
-            AssertRC(rc);
+        /* Positional I/O, other calls on the same handle may run concurrently. */
+        size_t count = 0;
+        rc = RTFileReadAt(pHandle->file.Handle, offset, pBuffer, *pcbBuffer, &count);
+        *pcbBuffer = (uint32_t)count;
     }
     else
     {
@@ -1081,15 +1076,10 @@ int vbsfWrite(SHFLCLIENTDATA *pClient, SHFLROOT root, SHFLHANDLE Handle, uint64_
 
     if (RT_LIKELY(*pcbBuffer != 0))
     {
-        rc = RTFileSeek(pHandle->file.Handle, offset, RTFILE_SEEK_BEGIN, NULL);
-        if (RT_SUCCESS(rc))
-        {
-            size_t count = 0;
-            rc = RTFileWrite(pHandle->file.Handle, pBuffer, *pcbBuffer, &count);
-            *pcbBuffer = (uint32_t)count;
-        }
-        else
-            AssertRC(rc);
+        /* Positional I/O, other calls on the same handle may run concurrently. */
+        size_t count = 0;
+        rc = RTFileWriteAt(pHandle->file.Handle, offset, pBuffer, *pcbBuffer, &count);
+        *pcbBuffer = (uint32_t)count;
     }
     else
     {
@@ -1871,6 +1861,10 @@ int vbsfRemove(SHFLCLIENTDATA *pClient, SHFLROOT root, SHFLSTRING *pPath, uint32
                 rc = RTFileDelete(pszFullPath);
             else
                 rc = RTDirRemove(pszFullPath);
+
+            /* Cached case corrections may refer to the removed object. */
+            if (RT_SUCCESS(rc))
+                vbsfMappingsFlushPathCache(root);
         }
 
 #ifndef DEBUG_dmik
@@ -1941,6 +1935,9 @@ int vbsfRename(SHFLCLIENTDATA *pClient, SHFLROOT root, SHFLSTRING *pSrc, SHFLSTR
                 rc = RTDirRename(pszFullPathSrc, pszFullPathDest,
                                    ((flags & SHFL_RENAME_REPLACE_IF_EXISTS) ? RTPATHRENAME_FLAGS_REPLACE : 0));
             }
+
+            if (RT_SUCCESS(rc))
+                vbsfMappingsFlushPathCache(root);
         }
 
         /* free the path string */
@@ -20,6 +20,7 @@
 #endif
 
 #include "vbsfpath.h"
+#include "vbsfpathcache.h"
 #include "mappings.h"
 #include "vbsf.h"
 #include "shflhandle.h"
@@ -167,9 +168,14 @@ static int vbsfQueryExistsEx(const char *pszPath, uint32_t fFlags)
  *                                  from the case correction.
  * @param   fPreserveLastComponent  Always exclude the last component from case
  *                                  correction if set.
+ * @param   pPathCache              The case correction cache of the mapping to
+ *                                  record successful corrections in.  Optional.
+ * @param   fCacheFlags             VBSF_PATH_CACHE_F_XXX matching @a fWildCard
+ *                                  and @a fPreserveLastComponent.
  */
 static int vbsfCorrectPathCasing(SHFLCLIENTDATA *pClient, char *pszFullPath, size_t cchFullPath,
-                                 bool fWildCard, bool fPreserveLastComponent)
+                                 bool fWildCard, bool fPreserveLastComponent,
+                                 PVBSFPATHCACHE pPathCache, uint32_t fCacheFlags)
 {
     /*
      * Hide the last path component if it needs preserving.  This is required
@@ -209,10 +215,19 @@ static int vbsfCorrectPathCasing(SHFLCLIENTDATA *pClient, char *pszFullPath, siz
      */
     /** @todo Don't check when creating files or directories; waste of time. */
     int rc = vbsfQueryExistsEx(pszFullPath, SHFL_RT_LINK(pClient));
+    char *pszOrgPath = NULL;
     if (rc == VERR_FILE_NOT_FOUND || rc == VERR_PATH_NOT_FOUND)
     {
         Log(("Handle case insensitive guest fs on top of host case sensitive fs for %s\n", pszFullPath));
 
+        /* Keep the uncorrected path as key for the cache. */
+        if (pPathCache)
+        {
+            pszOrgPath = (char *)RTMemDup(pszFullPath, cchFullPath + 1);
+            if (pszOrgPath && pszLastComponent)
+                pszOrgPath[pszLastComponent - pszFullPath] = RTPATH_DELIMITER;
+        }
+
         /*
          * Work from the end of the path to find a partial path that's valid.
          */
@@ -308,6 +323,15 @@ static int vbsfCorrectPathCasing(SHFLCLIENTDATA *pClient, char *pszFullPath, siz
     if (pszLastComponent)
         *pszLastComponent = RTPATH_DELIMITER;
 
+    /* Remember the corrected path if all components could be resolved.  New
+       files are not cached, the guest is about to create them. */
+    if (pszOrgPath)
+    {
+        if (RT_SUCCESS(rc))
+            vbsfPathCacheEnter(pPathCache, pszOrgPath, pszFullPath, fCacheFlags);
+        RTMemFree(pszOrgPath);
+    }
+
     /* might be a new file so don't fail here! */
     return VINF_SUCCESS;
 }
@@ -625,8 +649,14 @@ int vbsfPathGuestToHost(SHFLCLIENTDATA *pClient, SHFLROOT hRoot,
                             {
                                 const bool fWildCard = RT_BOOL(fu32Options & VBSF_O_PATH_WILDCARD);
                                 const bool fPreserveLastComponent = RT_BOOL(fu32Options & VBSF_O_PATH_PRESERVE_LAST_COMPONENT);
-                                rc = vbsfCorrectPathCasing(pClient, pszFullPath, strlen(pszFullPath),
-                                                           fWildCard, fPreserveLastComponent);
+                                const uint32_t fCacheFlags = (fWildCard ? VBSF_PATH_CACHE_F_WILDCARD : 0)
+                                                           | (fPreserveLastComponent ? VBSF_PATH_CACHE_F_PRESERVE_LAST : 0);
+                                PVBSFPATHCACHE pPathCache = vbsfMappingsQueryPathCache(hRoot);
+                                if (   !pPathCache
+                                    || !vbsfPathCacheLookup(pPathCache, pszFullPath, fCacheFlags))
+                                    rc = vbsfCorrectPathCasing(pClient, pszFullPath, strlen(pszFullPath),
+                                                               fWildCard, fPreserveLastComponent,
+                                                               pPathCache, fCacheFlags);
                             }
 
                             if (RT_SUCCESS(rc))
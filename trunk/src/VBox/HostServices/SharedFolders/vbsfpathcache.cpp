@@ -0,0 +1,389 @@
+/* $Id$ */
+/** @file
+ * Shared Folders - Host path case correction cache.
+ *
+ * Case insensitive guests on case sensitive hosts require every path component
+ * which does not match exactly to be looked up by enumerating the parent
+ * directory (see vbsfCorrectCasing).  Guests tend to hit the same paths over
+ * and over again (stat storms from build tools, file managers and the like),
+ * so the results are remembered here per mapping.
+ *
+ * Entries are dropped when the guest modifies the name space of the mapping,
+ * when they time out, and on Linux hosts when inotify reports a change in one
+ * of the directories the corrected path runs through.  Without notifications
+ * a short time-to-live limits the exposure to host side renames.
+ */
+
+/*
+ * Copyright (C) 2006-2017 Oracle Corporation
+ *
+ * This file is part of VirtualBox Open Source Edition (OSE), as
+ * available from http://www.virtualbox.org. This file is free software;
+ * you can redistribute it and/or modify it under the terms of the GNU
+ * General Public License (GPL) as published by the Free Software
+ * Foundation, in version 2 as it comes in the "COPYING" file of the
+ * VirtualBox OSE distribution. VirtualBox OSE is distributed in the
+ * hope that it will be useful, but WITHOUT ANY WARRANTY of any kind.
+ */
+
+
+/*********************************************************************************************************************************
+*   Header Files                                                                                                                 *
+*********************************************************************************************************************************/
+#include "shfl.h"
+#include "vbsfpathcache.h"
+
+#include <iprt/alloc.h>
+#include <iprt/assert.h>
+#include <iprt/critsect.h>
+#include <iprt/list.h>
+#include <iprt/path.h>
+#include <iprt/string.h>
+#include <iprt/time.h>
+
+#ifdef RT_OS_LINUX
+# include <sys/inotify.h>
+# include <errno.h>
+# include <fcntl.h>
+# include <unistd.h>
+#endif
+
+
+/*********************************************************************************************************************************
+*   Defined Constants And Macros                                                                                                 *
+*********************************************************************************************************************************/
+/** Max number of entries per mapping before the least recently used ones are
+ * recycled. */
+#define VBSF_PATH_CACHE_MAX_ENTRIES         4096
+/** Time-to-live of an entry when host changes cannot be tracked. */
+#define VBSF_PATH_CACHE_TTL_MS              2000
+/** Time-to-live of an entry whose directories are all watched. */
+#define VBSF_PATH_CACHE_TTL_WATCHED_MS      60000
+/** Max number of directories to watch per mapping. */
+#define VBSF_PATH_CACHE_MAX_WATCHES         1024
+
+
+/*********************************************************************************************************************************
+*   Structures and Typedefs                                                                                                      *
+*********************************************************************************************************************************/
+/**
+ * A cached case correction.
+ */
+typedef struct VBSFPATHCACHEENTRY
+{
+    /** String space core, the key is the uncorrected host path. */
+    RTSTRSPACECORE      Core;
+    /** LRU list node (VBSFPATHCACHE::LruList). */
+    RTLISTNODE          ListEntry;
+    /** The RTTimeMilliTS value when this entry expires. */
+    uint64_t            msExpire;
+    /** The flags (index into VBSFPATHCACHE::aSpaces). */
+    uint32_t            fFlags;
+    /** The corrected path (same length as the key, follows szPath). */
+    char               *pszCorrected;
+    /** The uncorrected path, variable length. */
+    char                szPath[1];
+} VBSFPATHCACHEENTRY;
+/** Pointer to a cache entry. */
+typedef VBSFPATHCACHEENTRY *PVBSFPATHCACHEENTRY;
+
+/**
+ * Per mapping case correction cache.
+ */
+typedef struct VBSFPATHCACHE
+{
+    /** Serializes access. */
+    RTCRITSECT          CritSect;
+    /** One string space per flag combination. */
+    RTSTRSPACE          aSpaces[VBSF_PATH_CACHE_F_VALID_MASK + 1];
+    /** LRU list, most recently used entry first. */
+    RTLISTANCHOR        LruList;
+    /** Number of entries. */
+    uint32_t            cEntries;
+    /** Length of the mapping root (no trailing slash). */
+    size_t              cchRoot;
+#ifdef RT_OS_LINUX
+    /** The inotify descriptor, -1 if not (yet) available. */
+    int                 fdNotify;
+    /** Set if inotify initialization failed, so we don't retry. */
+    bool                fNotifyFailed;
+    /** The highest watch descriptor returned, used for counting watches. */
+    int                 iMaxWatch;
+    /** Number of directories watched. */
+    uint32_t            cWatches;
+#endif
+    /** Statistics. */
+    VBSFPATHCACHESTATS  Stats;
+} VBSFPATHCACHE;
+
+
+int vbsfPathCacheCreate(const char *pszRoot, PVBSFPATHCACHE *ppCache)
+{
+    PVBSFPATHCACHE pCache = (PVBSFPATHCACHE)RTMemAllocZ(sizeof(*pCache));
+    if (!pCache)
+        return VERR_NO_MEMORY;
+
+    int rc = RTCritSectInit(&pCache->CritSect);
+    if (RT_FAILURE(rc))
+    {
+        RTMemFree(pCache);
+        return rc;
+    }
+
+    RTListInit(&pCache->LruList);
+    pCache->cchRoot = strlen(pszRoot);
+    while (pCache->cchRoot > 1 && RTPATH_IS_SLASH(pszRoot[pCache->cchRoot - 1]))
+        pCache->cchRoot--;
+#ifdef RT_OS_LINUX
+    pCache->fdNotify      = -1;
+    pCache->fNotifyFailed = false;
+    pCache->iMaxWatch     = 0;
+    pCache->cWatches      = 0;
+#endif
+
+    *ppCache = pCache;
+    return VINF_SUCCESS;
+}
+
+
+/**
+ * Unlinks and frees an entry.
+ *
+ * @param   pCache      The cache.  Caller owns the lock.
+ * @param   pEntry      The entry.
+ */
+static void vbsfPathCacheRemoveEntry(PVBSFPATHCACHE pCache, PVBSFPATHCACHEENTRY pEntry)
+{
+    PRTSTRSPACECORE pRemoved = RTStrSpaceRemove(&pCache->aSpaces[pEntry->fFlags], pEntry->szPath);
+    Assert(pRemoved == &pEntry->Core); NOREF(pRemoved);
+    RTListNodeRemove(&pEntry->ListEntry);
+    pCache->cEntries--;
+    RTMemFree(pEntry);
+}
+
+
+/**
+ * Drops all entries.
+ *
+ * @param   pCache      The cache.  Caller owns the lock.
+ */
+static void vbsfPathCacheFlushLocked(PVBSFPATHCACHE pCache)
+{
+    PVBSFPATHCACHEENTRY pEntry, pNext;
+    RTListForEachSafe(&pCache->LruList, pEntry, pNext, VBSFPATHCACHEENTRY, ListEntry)
+    {
+        vbsfPathCacheRemoveEntry(pCache, pEntry);
+    }
+    Assert(pCache->cEntries == 0);
+    pCache->Stats.cFlushes++;
+}
+
+
+#ifdef RT_OS_LINUX
+/**
+ * Drains pending inotify events, flushing the cache if there were any.
+ *
+ * @param   pCache      The cache.  Caller owns the lock.
+ */
+static void vbsfPathCacheProcessEvents(PVBSFPATHCACHE pCache)
+{
+    if (pCache->fdNotify < 0)
+        return;
+
+    /* We don't care which directory changed, any change drops everything. */
+    bool fChanged = false;
+    for (;;)
+    {
+        union
+        {
+            struct inotify_event Event;
+            uint8_t              ab[4096];
+        } uBuf;
+        ssize_t cbRead = read(pCache->fdNotify, &uBuf, sizeof(uBuf));
+        if (cbRead > 0)
+            fChanged = true;
+        else
+        {
+            if (cbRead < 0 && errno == EINTR)
+                continue;
+            break;
+        }
+    }
+
+    if (fChanged && pCache->cEntries)
+        vbsfPathCacheFlushLocked(pCache);
+}
+
+
+/**
+ * Watches each directory from the mapping root down to the parent of the last
+ * component of the given path.
+ *
+ * @returns true if all the directories are watched, false if not (including
+ *          when the watch cap has been reached).
+ * @param   pCache      The cache.  Caller owns the lock.
+ * @param   pszPath     The corrected path.  Temporarily modified.
+ */
+static bool vbsfPathCacheWatch(PVBSFPATHCACHE pCache, char *pszPath)
+{
+    if (pCache->fdNotify < 0)
+    {
+        if (pCache->fNotifyFailed)
+            return false;
+        pCache->fdNotify = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+        if (pCache->fdNotify < 0)
+        {
+            LogRel(("SharedFolders: inotify_init1 failed (errno=%d), case correction cache uses timeouts only\n", errno));
+            pCache->fNotifyFailed = true;
+            return false;
+        }
+        pCache->Stats.fNotifications = true;
+    }
+
+    const uint32_t fMask = IN_CREATE | IN_DELETE | IN_MOVED_FROM | IN_MOVED_TO | IN_DELETE_SELF | IN_MOVE_SELF | IN_ONLYDIR;
+    char *pszSlash = pszPath + pCache->cchRoot;
+    for (;;)
+    {
+        /* Once the cap is reached we can't tell existing watches from new
+           ones without adding them, so the caller gets the short TTL. */
+        if (pCache->cWatches >= VBSF_PATH_CACHE_MAX_WATCHES)
+            return false;
+
+        char const chSaved = *pszSlash;
+        *pszSlash = '\0';
+        int iWatch = inotify_add_watch(pCache->fdNotify, pszPath, fMask);
+        *pszSlash = chSaved;
+        if (iWatch < 0)
+            return false;
+        if (iWatch > pCache->iMaxWatch)
+        {
+            /* New watch (the kernel hands out ascending descriptors and
+               returns the existing one for directories already watched). */
+            pCache->iMaxWatch = iWatch;
+            pCache->cWatches++;
+        }
+
+        /* Next directory, stopping before the last component. */
+        pszSlash = strchr(pszSlash + 1, RTPATH_SLASH);
+        if (!pszSlash)
+            return true;
+    }
+}
+#endif /* RT_OS_LINUX */
+
+
+void vbsfPathCacheDestroy(PVBSFPATHCACHE pCache)
+{
+    if (!pCache)
+        return;
+
+    RTCritSectEnter(&pCache->CritSect);
+    vbsfPathCacheFlushLocked(pCache);
+#ifdef RT_OS_LINUX
+    if (pCache->fdNotify >= 0)
+    {
+        close(pCache->fdNotify);
+        pCache->fdNotify = -1;
+    }
+#endif
+    RTCritSectLeave(&pCache->CritSect);
+
+    RTCritSectDelete(&pCache->CritSect);
+    RTMemFree(pCache);
+}
+
+
+bool vbsfPathCacheLookup(PVBSFPATHCACHE pCache, char *pszPath, uint32_t fFlags)
+{
+    AssertReturn(!(fFlags & ~VBSF_PATH_CACHE_F_VALID_MASK), false);
+
+    bool fHit = false;
+    RTCritSectEnter(&pCache->CritSect);
+#ifdef RT_OS_LINUX
+    vbsfPathCacheProcessEvents(pCache);
+#endif
+
+    PVBSFPATHCACHEENTRY pEntry = (PVBSFPATHCACHEENTRY)RTStrSpaceGet(&pCache->aSpaces[fFlags], pszPath);
+    if (pEntry)
+    {
+        if (RTTimeMilliTS() < pEntry->msExpire)
+        {
+            memcpy(pszPath, pEntry->pszCorrected, pEntry->Core.cchString);
+            RTListNodeRemove(&pEntry->ListEntry);
+            RTListPrepend(&pCache->LruList, &pEntry->ListEntry);
+            fHit = true;
+        }
+        else
+            vbsfPathCacheRemoveEntry(pCache, pEntry);
+    }
+
+    if (fHit)
+        pCache->Stats.cHits++;
+    else
+        pCache->Stats.cMisses++;
+    RTCritSectLeave(&pCache->CritSect);
+    return fHit;
+}
+
+
+void vbsfPathCacheEnter(PVBSFPATHCACHE pCache, const char *pszPath, const char *pszCorrected, uint32_t fFlags)
+{
+    AssertReturnVoid(!(fFlags & ~VBSF_PATH_CACHE_F_VALID_MASK));
+    size_t const cchPath = strlen(pszPath);
+    AssertReturnVoid(strlen(pszCorrected) == cchPath);
+    if (cchPath <= pCache->cchRoot)
+        return;
+
+    PVBSFPATHCACHEENTRY pEntry = (PVBSFPATHCACHEENTRY)RTMemAlloc(RT_OFFSETOF(VBSFPATHCACHEENTRY, szPath[cchPath + 1 + cchPath + 1]));
+    if (!pEntry)
+        return;
+    memcpy(pEntry->szPath, pszPath, cchPath + 1);
+    pEntry->pszCorrected = &pEntry->szPath[cchPath + 1];
+    memcpy(pEntry->pszCorrected, pszCorrected, cchPath + 1);
+    pEntry->Core.pszString = pEntry->szPath;
+    pEntry->Core.cchString = cchPath;
+    pEntry->fFlags         = fFlags;
+
+    RTCritSectEnter(&pCache->CritSect);
+#ifdef RT_OS_LINUX
+    /* Pick up pending changes first so they don't flush the new entry. */
+    vbsfPathCacheProcessEvents(pCache);
+    bool const fWatched = vbsfPathCacheWatch(pCache, pEntry->pszCorrected);
+#else
+    bool const fWatched = false;
+#endif
+    pEntry->msExpire = RTTimeMilliTS() + (fWatched ? VBSF_PATH_CACHE_TTL_WATCHED_MS : VBSF_PATH_CACHE_TTL_MS);
+
+    PVBSFPATHCACHEENTRY pOld = (PVBSFPATHCACHEENTRY)RTStrSpaceGet(&pCache->aSpaces[fFlags], pszPath);
+    if (pOld)
+        vbsfPathCacheRemoveEntry(pCache, pOld);
+    else if (pCache->cEntries >= VBSF_PATH_CACHE_MAX_ENTRIES)
+        vbsfPathCacheRemoveEntry(pCache, RTListGetLast(&pCache->LruList, VBSFPATHCACHEENTRY, ListEntry));
+
+    bool fRc = RTStrSpaceInsert(&pCache->aSpaces[fFlags], &pEntry->Core);
+    Assert(fRc); NOREF(fRc);
+    RTListPrepend(&pCache->LruList, &pEntry->ListEntry);
+    pCache->cEntries++;
+    RTCritSectLeave(&pCache->CritSect);
+}
+
+
+void vbsfPathCacheFlush(PVBSFPATHCACHE pCache)
+{
+    if (!pCache)
+        return;
+
+    RTCritSectEnter(&pCache->CritSect);
+    if (pCache->cEntries)
+        vbsfPathCacheFlushLocked(pCache);
+    RTCritSectLeave(&pCache->CritSect);
+}
+
+
+void vbsfPathCacheQueryStats(PVBSFPATHCACHE pCache, PVBSFPATHCACHESTATS pStats)
+{
+    RTCritSectEnter(&pCache->CritSect);
+    *pStats = pCache->Stats;
+    pStats->cEntries = pCache->cEntries;
+    RTCritSectLeave(&pCache->CritSect);
+}
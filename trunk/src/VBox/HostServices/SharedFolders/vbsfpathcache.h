@@ -0,0 +1,110 @@
+/* $Id$ */
+/** @file
+ * Shared Folders - Host path case correction cache header.
+ */
+
+/*
+ * Copyright (C) 2006-2017 Oracle Corporation
+ *
+ * This file is part of VirtualBox Open Source Edition (OSE), as
+ * available from http://www.virtualbox.org. This file is free software;
+ * you can redistribute it and/or modify it under the terms of the GNU
+ * General Public License (GPL) as published by the Free Software
+ * Foundation, in version 2 as it comes in the "COPYING" file of the
+ * VirtualBox OSE distribution. VirtualBox OSE is distributed in the
+ * hope that it will be useful, but WITHOUT ANY WARRANTY of any kind.
+ */
+
+#ifndef __VBSFPATHCACHE__H
+#define __VBSFPATHCACHE__H
+
+#include <iprt/types.h>
+
+/** Opaque path cache handle. */
+typedef struct VBSFPATHCACHE *PVBSFPATHCACHE;
+
+/** @name VBSF_PATH_CACHE_F_XXX - Lookup/enter flags.
+ * The case correction result depends on these, so they are part of the key.
+ * @{ */
+#define VBSF_PATH_CACHE_F_WILDCARD          UINT32_C(0x00000001)
+#define VBSF_PATH_CACHE_F_PRESERVE_LAST     UINT32_C(0x00000002)
+#define VBSF_PATH_CACHE_F_VALID_MASK        UINT32_C(0x00000003)
+/** @} */
+
+/**
+ * Path cache statistics.
+ */
+typedef struct VBSFPATHCACHESTATS
+{
+    /** Number of lookups satisfied by the cache. */
+    uint64_t    cHits;
+    /** Number of lookups not found or expired. */
+    uint64_t    cMisses;
+    /** Number of times the cache was flushed (host change or guest
+     *  modification). */
+    uint64_t    cFlushes;
+    /** Number of entries currently cached. */
+    uint32_t    cEntries;
+    /** Whether host change notifications are active. */
+    bool        fNotifications;
+} VBSFPATHCACHESTATS;
+/** Pointer to path cache statistics. */
+typedef VBSFPATHCACHESTATS *PVBSFPATHCACHESTATS;
+
+/**
+ * Creates a case correction cache for a mapping.
+ *
+ * @returns VBox status code.
+ * @param   pszRoot     The host root of the mapping.  Directories at or below
+ *                      it are watched for changes where the host allows it.
+ * @param   ppCache     Where to return the cache handle.
+ */
+int  vbsfPathCacheCreate(const char *pszRoot, PVBSFPATHCACHE *ppCache);
+
+/**
+ * Destroys a case correction cache.
+ *
+ * @param   pCache      The cache handle.  NULL is ignored.
+ */
+void vbsfPathCacheDestroy(PVBSFPATHCACHE pCache);
+
+/**
+ * Looks up the case corrected variant of a host path.
+ *
+ * @returns true if found and @a pszPath was replaced by the corrected path,
+ *          false if not (@a pszPath is untouched).
+ * @param   pCache      The cache handle.
+ * @param   pszPath     The host path as built from the guest path.  Updated
+ *                      in place on success; the corrected path always has the
+ *                      same length.
+ * @param   fFlags      VBSF_PATH_CACHE_F_XXX.
+ */
+bool vbsfPathCacheLookup(PVBSFPATHCACHE pCache, char *pszPath, uint32_t fFlags);
+
+/**
+ * Records the result of a successful case correction.
+ *
+ * @param   pCache          The cache handle.
+ * @param   pszPath         The host path as built from the guest path.
+ * @param   pszCorrected    The corrected host path which exists.  Must have
+ *                          the same length as @a pszPath.
+ * @param   fFlags          VBSF_PATH_CACHE_F_XXX.
+ */
+void vbsfPathCacheEnter(PVBSFPATHCACHE pCache, const char *pszPath, const char *pszCorrected, uint32_t fFlags);
+
+/**
+ * Drops all cache entries, e.g. after the guest removed or renamed an object.
+ *
+ * @param   pCache      The cache handle.  NULL is ignored.
+ */
+void vbsfPathCacheFlush(PVBSFPATHCACHE pCache);
+
+/**
+ * Queries the cache statistics.
+ *
+ * @param   pCache      The cache handle.
+ * @param   pStats      Where to return the statistics.
+ */
+void vbsfPathCacheQueryStats(PVBSFPATHCACHE pCache, PVBSFPATHCACHESTATS pStats);
+
+#endif /* __VBSFPATHCACHE__H */
@@ -201,8 +201,9 @@ private:
     HRESULT i_preCheckImageAvailability(ImportStack &stack);
     bool    i_importEnsureOvaLookAhead(ImportStack &stack);
     RTVFSIOSTREAM i_importOpenSourceFile(ImportStack &stack, Utf8Str const &rstrSrcPath, const char *pszManifestEntry);
-    HRESULT i_importCreateAndWriteDestinationFile(Utf8Str const &rstrDstPath,
-                                                  RTVFSIOSTREAM hVfsIosSrc, Utf8Str const &rstrSrcLogNm);
+    HRESULT i_importCreateAndWriteDestinationFile(ImportStack &stack, Utf8Str const &rstrDstPath,
+                                                  RTVFSIOSTREAM hVfsIosSrc, Utf8Str const &rstrSrcLogNm,
+                                                  RTVFSIOSTREAM hVfsIosIn = NIL_RTVFSIOSTREAM);
 
     void    i_importCopyFile(ImportStack &stack, Utf8Str const &rstrSrcPath, Utf8Str const &rstrDstPath,
                              const char *pszManifestEntry);
@@ -106,6 +106,21 @@ typedef struct _DISPLAYFBINFO
         ComPtr<IDisplaySourceBitmap> pSourceBitmap;
     } videoRec;
 #endif /* VBOX_WITH_VIDEOREC */
+
+    /** Incremented on every update or resize of the guest screen. */
+    uint32_t volatile u32UpdateGeneration;
+
+    /* The last screenshot taken through the API, handed out again while the
+     * guest screen stays unchanged. Protected by the Display object lock. */
+    struct
+    {
+        uint32_t u32UpdateGeneration;
+        ULONG cx;
+        ULONG cy;
+        BitmapFormat_T enmFormat;
+        uint8_t *pbData;
+        ULONG cbData;
+    } screenshotCache;
 } DISPLAYFBINFO;
 
 /* The legacy VBVA (VideoAccel) data.
@@ -543,6 +558,8 @@ void videoAccelLeaveVMMDev(VIDEOACCEL *pVideoAccel);
 /* helper function, code in DisplayResampleImage.cpp */
 void BitmapScale32(uint8_t *dst, int dstW, int dstH,
                    const uint8_t *src, int iDeltaLine, int srcW, int srcH);
+void BitmapConvertBGR0ToBGRA(uint8_t *pu8, size_t cPixels);
+void BitmapConvertBGR0ToRGBA(uint8_t *pu8, size_t cPixels);
 
 /* helper function, code in DisplayPNGUtul.cpp */
 int DisplayMakePNG(uint8_t *pbData, uint32_t cx, uint32_t cy,
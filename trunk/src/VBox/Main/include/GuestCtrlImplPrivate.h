@@ -840,6 +840,86 @@ protected:
     BYTE *m_pbBuffer;
 };
 
+/**
+ * Overlaps host file I/O with the guest transfer when copying files.
+ *
+ * A worker thread either reads the host file ahead (host -> guest) or writes
+ * it behind (guest -> host) through a ring of fixed size chunks, so the task
+ * thread only waits for the guest.  One producer, one consumer.
+ */
+class GuestFileCopyPipe
+{
+
+public:
+
+    GuestFileCopyPipe();
+
+    virtual ~GuestFileCopyPipe();
+
+public:
+
+    int Init(RTFILE hFile, bool fReadAhead, uint64_t offFile, uint64_t cbFile, uint32_t cbChunk, uint32_t cChunks);
+
+    void Destroy();
+
+    /** @name Read ahead mode (host -> guest).
+     * @{ */
+    int Peek(RTMSINTERVAL msTimeout, const BYTE **ppbData, uint32_t *pcbData);
+    void Advance(uint32_t cbConsumed);
+    /** @} */
+
+    /** @name Write behind mode (guest -> host).
+     * @{ */
+    int Acquire(RTMSINTERVAL msTimeout, BYTE **ppbBuf, uint32_t *pcbBuf);
+    void Commit(uint32_t cbData);
+    int Flush(RTMSINTERVAL msTimeout);
+    /** @} */
+
+    uint32_t GetChunkSize() { return m_cbChunk; }
+
+protected:
+
+    static DECLCALLBACK(int) i_workerThread(RTTHREAD hThread, void *pvUser);
+
+    /** A ring buffer slot. */
+    struct Chunk
+    {
+        BYTE       *pbData;
+        uint32_t    cbData;
+    };
+
+    /** The host file. */
+    RTFILE              m_hFile;
+    /** Read ahead (true) or write behind (false). */
+    bool                m_fReadAhead;
+    /** Next host file offset the worker processes. */
+    uint64_t            m_offFile;
+    /** Bytes left for the worker to read (read ahead mode only). */
+    uint64_t            m_cbLeft;
+    /** Chunk size. */
+    uint32_t            m_cbChunk;
+    /** Number of chunks in the ring. */
+    uint32_t            m_cChunks;
+    /** The chunks. */
+    Chunk              *m_paChunks;
+    /** Ring index of the next chunk the producer fills. */
+    uint32_t volatile   m_iProduce;
+    /** Ring index of the next chunk the consumer takes. */
+    uint32_t volatile   m_iConsume;
+    /** Consumer offset into the current chunk (read ahead mode). */
+    uint32_t            m_offConsume;
+    /** Signalled when a chunk was produced. */
+    RTSEMEVENT          m_hEvtProduced;
+    /** Signalled when a chunk was consumed. */
+    RTSEMEVENT          m_hEvtConsumed;
+    /** Worker status, first error sticks. */
+    int32_t volatile    m_rcWorker;
+    /** Tells the worker to quit. */
+    bool volatile       m_fShutdown;
+    /** The worker thread. */
+    RTTHREAD            m_hThread;
+};
+
 class Guest;
 class Progress;
 
@@ -76,6 +76,7 @@ protected:
     int getGuestProperty(const ComObjPtr<Guest> &pGuest,
                            const Utf8Str &strPath, Utf8Str &strValue);
     int setProgress(ULONG uPercent);
+    int setProgressThroughput(ULONG uPercent, uint64_t cbDone, uint64_t nsStart);
     int setProgressSuccess(void);
     HRESULT setProgressErrorMsg(HRESULT hr, const Utf8Str &strMsg);
     inline void setTaskDesc(const Utf8Str &strTaskDesc) throw()
@@ -84,6 +85,7 @@ protected:
     }
 
     HRESULT createAndSetProgressObject();
+    uint32_t getCopyChunkSize(void);
 protected:
 
     Utf8Str                 mDesc;
@@ -91,6 +93,8 @@ protected:
     /** Progress object for getting updated when running
      *  asynchronously. Optional. */
     ComObjPtr<Progress>     mProgress;
+    /** When the transfer rate was last put into the progress description. */
+    uint64_t                mNsLastThroughput;
 };
 
 /**
@@ -21,6 +21,7 @@
 #include "MachineDebuggerWrap.h"
 #include <iprt/log.h>
 #include <VBox/vmm/em.h>
+#include <VBox/vmm/stam.h>
 
 class Console;
 
@@ -128,11 +129,14 @@ private:
     HRESULT getStats(const com::Utf8Str &aPattern,
                      BOOL aWithDescriptions,
                      com::Utf8Str &aStats);
+    HRESULT getStatsBinary(const com::Utf8Str &aPattern,
+                           std::vector<BYTE> &aStats);
 
     // private methods
     bool i_queueSettings() const;
     HRESULT i_getEmExecPolicyProperty(EMEXECPOLICY enmPolicy, BOOL *pfEnforced);
     HRESULT i_setEmExecPolicyProperty(EMEXECPOLICY enmPolicy, BOOL fEnforce);
+    void i_destroyStatsBinSnap();
 
     /** RTLogGetFlags, RTLogGetGroupSettings and RTLogGetDestinations function. */
     typedef DECLCALLBACK(int) FNLOGGETSTR(PRTLOGGER, char *, size_t);
@@ -154,6 +158,15 @@ private:
     uint32_t mVirtualTimeRateQueued;
     bool mFlushMode;
     /** @}  */
+
+    /** @name Binary statistics snapshot context for getStatsBinary.
+     * @{ */
+    PSTAMBINSNAP mpStatsBinSnap;
+    /** The user mode VM handle the context belongs to, retained. */
+    PUVM mpStatsBinSnapUVM;
+    /** The pattern the context was created for. */
+    com::Utf8Str mStrStatsBinSnapPattern;
+    /** @}  */
 };
 
 #endif /* !____H_MACHINEDEBUGGER */
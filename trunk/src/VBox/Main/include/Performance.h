@@ -29,6 +29,7 @@
 #include <algorithm>
 #include <functional> /* For std::fun_ptr in testcase */
 #include <list>
+#include <map>
 #include <vector>
 #include <queue>
 
@@ -59,6 +60,8 @@ namespace pm
         ULONG getSequenceNumber() { return mSequenceNumber; }
         void put(ULONG value);
         void copyTo(ULONG *data);
+        /** Returns the stored samples in storage order, for order-independent use. */
+        const ULONG *getRawData() { return mData; }
     private:
         ULONG *mData;
         ULONG  mLength;
@@ -93,7 +96,7 @@ namespace pm
     class CollectorHints
     {
     public:
-        typedef std::list<ProcessFlagsPair> ProcessList;
+        typedef std::vector<ProcessFlagsPair> ProcessList;
 
         CollectorHints() : mHostFlags(COLLECT_NONE) {}
         void collectHostCpuLoad()
@@ -132,17 +135,21 @@ namespace pm
             return mProcesses;
         }
     private:
-        HintFlags   mHostFlags;
-        ProcessList mProcesses;
+        /* Maps a process to its index in mProcesses, every VM adds several hints per tick. */
+        typedef std::map<RTPROCESS, size_t> ProcessIndex;
+
+        HintFlags    mHostFlags;
+        ProcessList  mProcesses;
+        ProcessIndex mProcessIndex;
 
         ProcessFlagsPair& findProcess(RTPROCESS process)
         {
-            ProcessList::iterator it;
-            for (it = mProcesses.begin(); it != mProcesses.end(); ++it)
-                if (it->first == process)
-                    return *it;
+            ProcessIndex::const_iterator it = mProcessIndex.find(process);
+            if (it != mProcessIndex.end())
+                return mProcesses[it->second];
 
             /* Not found -- add new */
+            mProcessIndex[process] = mProcesses.size();
             mProcesses.push_back(ProcessFlagsPair(process, COLLECT_NONE));
             return mProcesses.back();
         }
@@ -811,7 +818,7 @@ namespace pm
     class Aggregate
     {
     public:
-        virtual ULONG compute(ULONG *data, ULONG length) = 0;
+        virtual ULONG compute(const ULONG *data, ULONG length) = 0;
         virtual const char *getName() = 0;
         virtual ~Aggregate() {}
     };
@@ -819,21 +826,21 @@ namespace pm
     class AggregateAvg : public Aggregate
     {
     public:
-        virtual ULONG compute(ULONG *data, ULONG length);
+        virtual ULONG compute(const ULONG *data, ULONG length);
         virtual const char *getName();
     };
 
     class AggregateMin : public Aggregate
     {
     public:
-        virtual ULONG compute(ULONG *data, ULONG length);
+        virtual ULONG compute(const ULONG *data, ULONG length);
         virtual const char *getName();
     };
 
     class AggregateMax : public Aggregate
     {
     public:
-        virtual ULONG compute(ULONG *data, ULONG length);
+        virtual ULONG compute(const ULONG *data, ULONG length);
         virtual const char *getName();
     };
 
@@ -868,7 +875,7 @@ namespace pm
         ULONG getLength()
             { return mAggregate ? 1 : mBaseMetric->getLength(); };
         ULONG getScale() { return mBaseMetric->getScale(); }
-        void query(ULONG **data, ULONG *count, ULONG *sequenceNumber);
+        void query(ULONG *data, ULONG *count, ULONG *sequenceNumber);
 
     private:
         RTCString mName;
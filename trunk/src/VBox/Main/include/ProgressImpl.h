@@ -138,6 +138,8 @@ public:
     HRESULT i_notifyCompleteEI(HRESULT aResultCode,
                                const ComPtr<IVirtualBoxErrorInfo> &aErrorInfo);
 
+    HRESULT i_setOperationDescription(const com::Utf8Str &aOperationDescription);
+
     bool i_notifyPointOfNoReturn(void);
     bool i_setCancelCallback(void (*pfnCallback)(void *), void *pvUser);
 
@@ -234,6 +234,7 @@ public:
     HRESULT i_registerMedium(const ComObjPtr<Medium> &pMedium, ComObjPtr<Medium> *ppMedium,
                              AutoWriteLock &mediaTreeLock);
     HRESULT i_unregisterMedium(Medium *pMedium);
+    void i_onMediumLocationChanged(Medium *pMedium, const Utf8Str &strOldLocation);
     void i_pushMediumToListWithChildren(MediaList &llMedia, Medium *pMedium);
     HRESULT i_unregisterMachineMedia(const Guid &id);
     HRESULT i_unregisterMachine(Machine *pMachine, const Guid &id);
@@ -369,6 +370,8 @@ private:
                                      const Utf8Str &aLocation,
                                      Utf8Str &aConflictType,
                                      ComObjPtr<Medium> *pDupMedium);
+    void i_updateMediumLocation(Medium *pMedium, const Utf8Str &strOldLocation);
+    static Utf8Str i_mediumLocationKey(const Utf8Str &strLocation);
     int  i_decryptSettings();
     int  i_decryptMediumSettings(Medium *pMedium);
     int  i_decryptSettingBytes(uint8_t *aPlaintext,
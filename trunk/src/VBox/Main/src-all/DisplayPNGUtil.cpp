@@ -161,6 +161,12 @@ int DisplayMakePNG(uint8_t *pu8Data, uint32_t cx, uint32_t cy,
                                      8, PNG_COLOR_TYPE_RGB, PNG_INTERLACE_NONE,
                                      PNG_COMPRESSION_TYPE_DEFAULT, PNG_FILTER_TYPE_DEFAULT);
 
+                        /* Screen content is mostly flat areas and repeated rows, which the
+                         * 'up' filter alone handles nearly as well as the default of trying
+                         * all five filters on every row, at half the CPU time. Lowering
+                         * the zlib level as well roughly doubles the size, so don't. */
+                        png_set_filter(png_ptr, PNG_FILTER_TYPE_BASE, PNG_FILTER_UP);
+
                         png_bytep row_pointer = (png_bytep)pu8Bitmap;
                         unsigned i = 0;
                         for (; i < cyBitmap; i++, row_pointer += cxBitmap * 4)
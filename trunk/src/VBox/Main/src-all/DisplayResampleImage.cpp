@@ -16,6 +16,12 @@
  */
 
 #include <iprt/types.h>
+#include <iprt/mem.h>
+
+#ifdef RT_ARCH_AMD64
+/* SSE2 is part of the AMD64 base line, so no run-time detection needed. */
+# include <emmintrin.h>
+#endif
 
 DECLINLINE(void) imageSetPixel (uint8_t *im, int x, int y, int color, int w)
 {
@@ -36,12 +42,14 @@ typedef int32_t FIXEDPOINT;
 #define FIXEDPOINT_FLOOR(v) ((v) & ~0xF)
 #define FIXEDPOINT_FRACTION(v) ((v) & 0xF)
 
-/* For 32 bit source only. */
-void BitmapScale32 (uint8_t *dst,
-                    int dstW, int dstH,
-                    const uint8_t *src,
-                    int iDeltaLine,
-                    int srcW, int srcH)
+/* For 32 bit source only. Works out the source area of every destination pixel
+ * from scratch, used if the span tables of BitmapScale32 can't be allocated.
+ */
+static void bitmapScale32Direct (uint8_t *dst,
+                                 int dstW, int dstH,
+                                 const uint8_t *src,
+                                 int iDeltaLine,
+                                 int srcW, int srcH)
 {
     int x, y;
 
@@ -148,3 +156,223 @@ void BitmapScale32 (uint8_t *dst,
         }
     }
 }
+
+/* The source pixels of one destination column or row. */
+typedef struct BITMAPSCALESPAN
+{
+    int iFirst;   /* First source pixel. */
+    int cSources; /* Number of source pixels. */
+    int iWeights; /* Index of the weight of the first source pixel. */
+} BITMAPSCALESPAN;
+
+/* Walks the source pixels of every destination pixel along one axis the same way
+ * bitmapScale32Direct does, recording their portions as weights. Returns the
+ * number of weights used.
+ */
+static int bitmapScaleCalcSpans(int cDst, int cSrc, BITMAPSCALESPAN *paSpans, FIXEDPOINT *paWeights, FIXEDPOINT *paSizes)
+{
+    int iWeight = 0;
+    for (int i = 0; i < cDst; i++)
+    {
+        FIXEDPOINT s1 = INT_TO_FIXEDPOINT(i * cSrc) / cDst;
+        FIXEDPOINT s2 = INT_TO_FIXEDPOINT((i + 1) * cSrc) / cDst;
+
+        paSizes[i]          = s2 - s1;
+        paSpans[i].iFirst   = FIXEDPOINT_TO_INT(s1);
+        paSpans[i].iWeights = iWeight;
+
+        FIXEDPOINT s = s1;
+        do
+        {
+            FIXEDPOINT portion;
+            if (FIXEDPOINT_FLOOR (s) == FIXEDPOINT_FLOOR (s1))
+            {
+                portion = INT_TO_FIXEDPOINT(1) - FIXEDPOINT_FRACTION(s);
+                if (portion > s2 - s1)
+                {
+                    portion = s2 - s1;
+                }
+                s = FIXEDPOINT_FLOOR (s);
+            }
+            else if (s == FIXEDPOINT_FLOOR (s2))
+            {
+                portion = FIXEDPOINT_FRACTION(s2);
+            }
+            else
+            {
+                portion = INT_TO_FIXEDPOINT(1);
+            }
+            paWeights[iWeight++] = portion;
+
+            s += INT_TO_FIXEDPOINT(1);
+        } while (s < s2);
+
+        paSpans[i].cSources = iWeight - paSpans[i].iWeights;
+    }
+    return iWeight;
+}
+
+/* For 32 bit source only.
+ *
+ * Same result as bitmapScale32Direct, but the source spans are calculated once
+ * per column and row instead of for every destination pixel, and the colour
+ * components are summed up in parallel where possible.
+ */
+void BitmapScale32 (uint8_t *dst,
+                    int dstW, int dstH,
+                    const uint8_t *src,
+                    int iDeltaLine,
+                    int srcW, int srcH)
+{
+    /* A source pixel never contributes to more than two destination pixels. */
+    size_t const cbSpans   = sizeof(BITMAPSCALESPAN) * (dstW + dstH);
+    size_t const cbWeights = sizeof(FIXEDPOINT) * (srcW + 2 * dstW + srcH + 2 * dstH + 2);
+    size_t const cbSizes   = sizeof(FIXEDPOINT) * (dstW + dstH);
+    uint8_t *pbTables = (uint8_t *)RTMemAlloc(cbSpans + cbWeights + cbSizes);
+    if (!pbTables)
+    {
+        bitmapScale32Direct(dst, dstW, dstH, src, iDeltaLine, srcW, srcH);
+        return;
+    }
+
+    BITMAPSCALESPAN *paSpansX   = (BITMAPSCALESPAN *)pbTables;
+    BITMAPSCALESPAN *paSpansY   = &paSpansX[dstW];
+    FIXEDPOINT      *paWeightsX = (FIXEDPOINT *)(pbTables + cbSpans);
+    FIXEDPOINT      *paSizesX   = (FIXEDPOINT *)(pbTables + cbSpans + cbWeights);
+    FIXEDPOINT      *paSizesY   = &paSizesX[dstW];
+    int cWeightsX = bitmapScaleCalcSpans(dstW, srcW, paSpansX, paWeightsX, paSizesX);
+    FIXEDPOINT      *paWeightsY = &paWeightsX[cWeightsX];
+    bitmapScaleCalcSpans(dstH, srcH, paSpansY, paWeightsY, paSizesY);
+
+    for (int y = 0; y < dstH; y++)
+    {
+        const BITMAPSCALESPAN *pSpanY = &paSpansY[y];
+
+        for (int x = 0; x < dstW; x++)
+        {
+            const BITMAPSCALESPAN *pSpanX = &paSpansX[x];
+            const FIXEDPOINT *paWX = &paWeightsX[pSpanX->iWeights];
+
+            FIXEDPOINT red, green, blue;
+#ifdef RT_ARCH_AMD64
+            /* One 32-bit lane per component. The contributions never exceed
+             * INT_TO_FIXEDPOINT(1) squared, so a 16-bit multiply will do and
+             * two source pixels can be weighted and added up in one go. */
+            __m128i const zero = _mm_setzero_si128();
+            __m128i sum = zero;
+            for (int j = 0; j < pSpanY->cSources; j++)
+            {
+                const uint32_t *pu32Src = (const uint32_t *)(src + iDeltaLine * (pSpanY->iFirst + j)) + pSpanX->iFirst;
+                FIXEDPOINT const yportion = paWeightsY[pSpanY->iWeights + j];
+                int i = 0;
+                for (; i + 2 <= pSpanX->cSources; i += 2)
+                {
+                    /* B0 B1 G0 G1 R0 R1 A0 A1 in 16-bit lanes. */
+                    __m128i const p = _mm_unpacklo_epi8(_mm_unpacklo_epi8(_mm_cvtsi32_si128((int)pu32Src[i]),
+                                                                          _mm_cvtsi32_si128((int)pu32Src[i + 1])),
+                                                        zero);
+                    __m128i const w = _mm_set1_epi32(  (paWX[i] * yportion)
+                                                     | ((paWX[i + 1] * yportion) << 16));
+                    sum = _mm_add_epi32(sum, _mm_madd_epi16(p, w));
+                }
+                if (i < pSpanX->cSources)
+                {
+                    __m128i const p = _mm_unpacklo_epi16(_mm_unpacklo_epi8(_mm_cvtsi32_si128((int)pu32Src[i]), zero), zero);
+                    sum = _mm_add_epi32(sum, _mm_madd_epi16(p, _mm_set1_epi32(paWX[i] * yportion)));
+                }
+            }
+            int32_t ai32Sum[4];
+            _mm_storeu_si128((__m128i *)&ai32Sum[0], sum);
+            blue  = ai32Sum[0];
+            green = ai32Sum[1];
+            red   = ai32Sum[2];
+#else
+            red = 0, green = 0, blue = 0;
+            for (int j = 0; j < pSpanY->cSources; j++)
+            {
+                const uint32_t *pu32Src = (const uint32_t *)(src + iDeltaLine * (pSpanY->iFirst + j)) + pSpanX->iFirst;
+                FIXEDPOINT const yportion = paWeightsY[pSpanY->iWeights + j];
+                for (int i = 0; i < pSpanX->cSources; i++)
+                {
+                    FIXEDPOINT const pcontribution = paWX[i] * yportion;
+                    int const p = (int)pu32Src[i];
+                    red   += trueColorGetRed (p) * pcontribution;
+                    green += trueColorGetGreen (p) * pcontribution;
+                    blue  += trueColorGetBlue (p) * pcontribution;
+                }
+            }
+#endif
+
+            FIXEDPOINT const spixels = paSizesX[x] * paSizesY[y];
+            if (spixels != 0)
+            {
+                red /= spixels;
+                green /= spixels;
+                blue /= spixels;
+            }
+            /* Clamping to allow for rounding errors above */
+            if (red > 255)
+            {
+                red = 255;
+            }
+            if (green > 255)
+            {
+                green = 255;
+            }
+            if (blue > 255)
+            {
+                blue = 255;
+            }
+            imageSetPixel (dst,
+                           x, y,
+                           ( ((int) red) << 16) + (((int) green) << 8) + ((int) blue),
+                           dstW);
+        }
+    }
+
+    RTMemFree(pbTables);
+}
+
+/* Makes 32 bpp BGR0 pixels opaque BGRA, in place. */
+void BitmapConvertBGR0ToBGRA(uint8_t *pu8, size_t cPixels)
+{
+    size_t i = 0;
+#ifdef RT_ARCH_AMD64
+    __m128i const alpha = _mm_set1_epi32(UINT32_C(0xFF000000));
+    for (; i + 4 <= cPixels; i += 4)
+    {
+        __m128i *p = (__m128i *)(pu8 + i * 4);
+        _mm_storeu_si128(p, _mm_or_si128(_mm_loadu_si128(p), alpha));
+    }
+#endif
+    for (; i < cPixels; i++)
+        pu8[i * 4 + 3] = 0xFF;
+}
+
+/* Converts 32 bpp BGR0 pixels to opaque RGBA, in place. */
+void BitmapConvertBGR0ToRGBA(uint8_t *pu8, size_t cPixels)
+{
+    size_t i = 0;
+#ifdef RT_ARCH_AMD64
+    __m128i const alpha = _mm_set1_epi32(UINT32_C(0xFF000000));
+    __m128i const green = _mm_set1_epi32(0x0000FF00);
+    __m128i const blue  = _mm_set1_epi32(0x000000FF);
+    for (; i + 4 <= cPixels; i += 4)
+    {
+        __m128i *p = (__m128i *)(pu8 + i * 4);
+        __m128i const v = _mm_loadu_si128(p);
+        __m128i const r = _mm_or_si128(_mm_or_si128(_mm_and_si128(v, green), alpha),
+                                       _mm_or_si128(_mm_and_si128(_mm_srli_epi32(v, 16), blue),
+                                                    _mm_slli_epi32(_mm_and_si128(v, blue), 16)));
+        _mm_storeu_si128(p, r);
+    }
+#endif
+    for (; i < cPixels; i++)
+    {
+        uint8_t *p = pu8 + i * 4;
+        uint8_t u8 = p[0];
+        p[0] = p[2];
+        p[2] = u8;
+        p[3] = 0xFF;
+    }
+}
@@ -485,6 +485,30 @@ HRESULT Progress::i_notifyCompleteEI(HRESULT aResultCode, const ComPtr<IVirtualB
     return S_OK;
 }
 
+/**
+ * Replaces the description of the current operation, e.g. to report the
+ * transfer rate of a long running copy operation.
+ *
+ * @returns COM status code.
+ * @param   aOperationDescription   The new description.
+ */
+HRESULT Progress::i_setOperationDescription(const com::Utf8Str &aOperationDescription)
+{
+    AutoWriteLock alock(this COMMA_LOCKVAL_SRC_POS);
+
+    if (mCanceled)
+        return E_FAIL;
+    AssertReturn(!mCompleted, E_FAIL);
+
+    m_operationDescription = aOperationDescription;
+
+    ULONG actualPercent = 0;
+    getPercent(&actualPercent);
+    fireProgressPercentageChangedEvent(pEventSource, mId.toUtf16().raw(), actualPercent);
+
+    return S_OK;
+}
+
 /**
  * Notify the progress object that we're almost at the point of no return.
  *
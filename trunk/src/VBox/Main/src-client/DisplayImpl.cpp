@@ -103,6 +103,10 @@ typedef struct DRVMAINDISPLAY
 /** Converts PDMIDISPLAYCONNECTOR pointer to a DRVMAINDISPLAY pointer. */
 #define PDMIDISPLAYCONNECTOR_2_MAINDISPLAY(pInterface)  RT_FROM_MEMBER(pInterface, DRVMAINDISPLAY, IConnector)
 
+/** Screenshots up to this size are kept for handing out again while the guest
+ *  screen does not change, see Display::takeScreenShotWorker. */
+#define DISPLAY_SCREENSHOT_CACHE_MAX    _4M
+
 // constructor / destructor
 /////////////////////////////////////////////////////////////////////////////
 
@@ -684,6 +688,9 @@ HRESULT Display::init(Console *aParent)
 #ifdef VBOX_WITH_CROGL
         RT_ZERO(maFramebuffers[ul].pendingViewportInfo);
 #endif
+
+        maFramebuffers[ul].u32UpdateGeneration = 0;
+        RT_ZERO(maFramebuffers[ul].screenshotCache);
     }
 
     {
@@ -732,6 +739,8 @@ void Display::uninit()
 #ifdef VBOX_WITH_VIDEOREC
         maFramebuffers[uScreenId].videoRec.pSourceBitmap.setNull();
 #endif
+        RTMemFree(maFramebuffers[uScreenId].screenshotCache.pbData);
+        maFramebuffers[uScreenId].screenshotCache.pbData = NULL;
     }
 
     if (mParent)
@@ -924,6 +933,9 @@ int Display::i_handleDisplayResize(unsigned uScreenId, uint32_t bpp, void *pvVRA
     /* Caller must not hold the object lock. */
     AssertReturn(!isWriteLockOnCurrentThread(), VERR_INVALID_STATE);
 
+    if (uScreenId < mcMonitors)
+        ASMAtomicIncU32(&maFramebuffers[uScreenId].u32UpdateGeneration);
+
     /* Note: the old code checked if the video mode was actially chnaged and
      * did not invalidate the source bitmap if the mode did not change.
      * The new code always invalidates the source bitmap, i.e. it will
@@ -1111,6 +1123,9 @@ void Display::i_handleDisplayUpdate(unsigned uScreenId, int x, int y, int w, int
                  uScreenId, x, y, w, h));
 #endif /* DEBUG_sunlover */
 
+    /* Invalidates the cached screenshot. */
+    ASMAtomicIncU32(&maFramebuffers[uScreenId].u32UpdateGeneration);
+
     /* No updates for a disabled guest screen. */
     if (maFramebuffers[uScreenId].fDisabled)
         return;
@@ -2270,6 +2285,36 @@ HRESULT Display::takeScreenShotWorker(ULONG aScreenId,
     if (!ptrVM.isOk())
         return ptrVM.rc();
 
+    /*
+     * Polling thumbnails of an idle guest is common, so hand out the previous
+     * screenshot again if the screen was neither updated nor resized since.
+     * Updates are reported by the VGA refresh timer from the dirty page bitmap
+     * (or by VBVA), so the result can be one refresh interval behind the VRAM.
+     * 3D output does not go through there at all.
+     */
+    bool fCacheable = aScreenId < mcMonitors;
+#if defined(VBOX_WITH_HGCM) && defined(VBOX_WITH_CROGL)
+    if (mfIsCr3DEnabled)
+        fCacheable = false;
+#endif
+    uint32_t u32UpdateGeneration = 0;
+    if (fCacheable)
+    {
+        AutoReadLock alock(this COMMA_LOCKVAL_SRC_POS);
+        DISPLAYFBINFO *pFBInfo = &maFramebuffers[aScreenId];
+        u32UpdateGeneration = ASMAtomicReadU32(&pFBInfo->u32UpdateGeneration);
+        if (   pFBInfo->screenshotCache.pbData
+            && pFBInfo->screenshotCache.u32UpdateGeneration == u32UpdateGeneration
+            && pFBInfo->screenshotCache.cx == aWidth
+            && pFBInfo->screenshotCache.cy == aHeight
+            && pFBInfo->screenshotCache.enmFormat == aBitmapFormat)
+        {
+            memcpy(aAddress, pFBInfo->screenshotCache.pbData, pFBInfo->screenshotCache.cbData);
+            *pcbOut = pFBInfo->screenshotCache.cbData;
+            return S_OK;
+        }
+    }
+
     int vrc = i_displayTakeScreenshot(ptrVM.rawUVM(), this, mpDrv, aScreenId, aAddress, aWidth, aHeight);
 
     if (RT_SUCCESS(vrc))
@@ -2285,26 +2330,11 @@ HRESULT Display::takeScreenShotWorker(ULONG aScreenId,
         }
         else if (aBitmapFormat == BitmapFormat_BGRA)
         {
-            uint32_t *pu32 = (uint32_t *)aAddress;
-            size_t cPixels = aWidth * aHeight;
-            while (cPixels--)
-            {
-                *pu32++ |= UINT32_C(0xFF000000);
-            }
+            BitmapConvertBGR0ToBGRA(aAddress, (size_t)aWidth * aHeight);
         }
         else if (aBitmapFormat == BitmapFormat_RGBA)
         {
-            uint8_t *pu8 = aAddress;
-            size_t cPixels = aWidth * aHeight;
-            while (cPixels--)
-            {
-                uint8_t u8 = pu8[0];
-                pu8[0] = pu8[2];
-                pu8[2] = u8;
-                pu8[3] = 0xFF;
-
-                pu8 += 4;
-            }
+            BitmapConvertBGR0ToRGBA(aAddress, (size_t)aWidth * aHeight);
         }
         else if (aBitmapFormat == BitmapFormat_PNG)
         {
@@ -2342,6 +2372,25 @@ HRESULT Display::takeScreenShotWorker(ULONG aScreenId,
         rc = setError(VBOX_E_IPRT_ERROR,
                       tr("Could not take a screenshot (%Rrc)"), vrc);
 
+    if (   SUCCEEDED(rc)
+        && fCacheable
+        && *pcbOut <= DISPLAY_SCREENSHOT_CACHE_MAX)
+    {
+        uint8_t *pbCopy = (uint8_t *)RTMemDup(aAddress, *pcbOut);
+        if (pbCopy)
+        {
+            AutoWriteLock alock(this COMMA_LOCKVAL_SRC_POS);
+            DISPLAYFBINFO *pFBInfo = &maFramebuffers[aScreenId];
+            RTMemFree(pFBInfo->screenshotCache.pbData);
+            pFBInfo->screenshotCache.u32UpdateGeneration = u32UpdateGeneration;
+            pFBInfo->screenshotCache.cx                  = aWidth;
+            pFBInfo->screenshotCache.cy                  = aHeight;
+            pFBInfo->screenshotCache.enmFormat           = aBitmapFormat;
+            pFBInfo->screenshotCache.pbData              = pbCopy;
+            pFBInfo->screenshotCache.cbData              = *pcbOut;
+        }
+    }
+
     return rc;
 }
 
@@ -32,9 +32,9 @@
 #include <iprt/asm.h>
 #include <iprt/cpp/utils.h> /* For unconst(). */
 #include <iprt/ctype.h>
-#ifdef DEBUG
-# include <iprt/file.h>
-#endif /* DEBUG */
+#include <iprt/file.h>
+#include <iprt/mem.h>
+#include <iprt/thread.h>
 
 
 
@@ -553,6 +553,311 @@ int GuestProcessStream::ParseBlock(GuestProcessStreamBlock &streamBlock)
     return rc;
 }
 
+GuestFileCopyPipe::GuestFileCopyPipe(void)
+    : m_hFile(NIL_RTFILE),
+      m_fReadAhead(true),
+      m_offFile(0),
+      m_cbLeft(0),
+      m_cbChunk(0),
+      m_cChunks(0),
+      m_paChunks(NULL),
+      m_iProduce(0),
+      m_iConsume(0),
+      m_offConsume(0),
+      m_hEvtProduced(NIL_RTSEMEVENT),
+      m_hEvtConsumed(NIL_RTSEMEVENT),
+      m_rcWorker(VINF_SUCCESS),
+      m_fShutdown(false),
+      m_hThread(NIL_RTTHREAD)
+{
+}
+
+GuestFileCopyPipe::~GuestFileCopyPipe(void)
+{
+    Destroy();
+}
+
+/**
+ * Sets up the chunk ring and starts the worker thread.
+ *
+ * @returns IPRT status code.
+ * @param   hFile           The host file.  Accessed with positional I/O only,
+ *                          so the caller's file position is left alone.
+ * @param   fReadAhead      true to read the file ahead (host -> guest), false
+ *                          to write it behind (guest -> host).
+ * @param   offFile         File offset to start at.
+ * @param   cbFile          Number of bytes to read ahead, ignored when writing.
+ * @param   cbChunk         Chunk size.
+ * @param   cChunks         Number of chunks in the ring.
+ */
+int GuestFileCopyPipe::Init(RTFILE hFile, bool fReadAhead, uint64_t offFile, uint64_t cbFile,
+                            uint32_t cbChunk, uint32_t cChunks)
+{
+    AssertReturn(m_hThread == NIL_RTTHREAD, VERR_WRONG_ORDER);
+    AssertReturn(cbChunk, VERR_INVALID_PARAMETER);
+    AssertReturn(cChunks >= 2, VERR_INVALID_PARAMETER);
+
+    m_hFile      = hFile;
+    m_fReadAhead = fReadAhead;
+    m_offFile    = offFile;
+    m_cbLeft     = fReadAhead ? cbFile : 0;
+    m_cbChunk    = cbChunk;
+    m_cChunks    = cChunks;
+    m_iProduce   = 0;
+    m_iConsume   = 0;
+    m_offConsume = 0;
+    m_rcWorker   = VINF_SUCCESS;
+    m_fShutdown  = false;
+
+    m_paChunks = (Chunk *)RTMemAllocZ(cChunks * sizeof(Chunk));
+    if (!m_paChunks)
+        return VERR_NO_MEMORY;
+    for (uint32_t i = 0; i < cChunks; i++)
+    {
+        m_paChunks[i].pbData = (BYTE *)RTMemAlloc(cbChunk);
+        if (!m_paChunks[i].pbData)
+        {
+            Destroy();
+            return VERR_NO_MEMORY;
+        }
+    }
+
+    int rc = RTSemEventCreate(&m_hEvtProduced);
+    if (RT_SUCCESS(rc))
+        rc = RTSemEventCreate(&m_hEvtConsumed);
+    if (RT_SUCCESS(rc))
+        rc = RTThreadCreate(&m_hThread, GuestFileCopyPipe::i_workerThread, this, 0 /* cbStack */,
+                            RTTHREADTYPE_IO, RTTHREADFLAGS_WAITABLE, fReadAhead ? "gctlCpyRd" : "gctlCpyWr");
+    if (RT_FAILURE(rc))
+        Destroy();
+
+    LogFlowThisFunc(("fReadAhead=%RTbool, cbChunk=%RU32, cChunks=%RU32, rc=%Rrc\n", fReadAhead, cbChunk, cChunks, rc));
+    return rc;
+}
+
+/**
+ * Stops the worker thread and frees everything.  Pending writes are dropped,
+ * use Flush() first when writing.
+ */
+void GuestFileCopyPipe::Destroy(void)
+{
+    if (m_hThread != NIL_RTTHREAD)
+    {
+        ASMAtomicWriteBool(&m_fShutdown, true);
+        RTSemEventSignal(m_hEvtProduced);
+        RTSemEventSignal(m_hEvtConsumed);
+        int rc = RTThreadWait(m_hThread, RT_INDEFINITE_WAIT, NULL);
+        AssertRC(rc);
+        m_hThread = NIL_RTTHREAD;
+    }
+
+    RTSemEventDestroy(m_hEvtProduced);
+    m_hEvtProduced = NIL_RTSEMEVENT;
+    RTSemEventDestroy(m_hEvtConsumed);
+    m_hEvtConsumed = NIL_RTSEMEVENT;
+
+    if (m_paChunks)
+    {
+        for (uint32_t i = 0; i < m_cChunks; i++)
+            RTMemFree(m_paChunks[i].pbData);
+        RTMemFree(m_paChunks);
+        m_paChunks = NULL;
+    }
+}
+
+/**
+ * Returns the data at the head of the read ahead ring, waiting for it if
+ * necessary.
+ *
+ * @returns IPRT status code.  VERR_EOF once everything was consumed,
+ *          VERR_TIMEOUT if the worker did not deliver in time.
+ * @param   msTimeout       How long to wait for the worker.
+ * @param   ppbData         Where to return the data pointer.
+ * @param   pcbData         Where to return the number of bytes available.
+ */
+int GuestFileCopyPipe::Peek(RTMSINTERVAL msTimeout, const BYTE **ppbData, uint32_t *pcbData)
+{
+    AssertReturn(m_fReadAhead, VERR_WRONG_ORDER);
+
+    for (;;)
+    {
+        /* Read the worker status before the index so we don't miss the last chunk. */
+        int rcWorker = ASMAtomicReadS32(&m_rcWorker);
+        if (m_iConsume != ASMAtomicReadU32(&m_iProduce))
+        {
+            Chunk *pChunk = &m_paChunks[m_iConsume % m_cChunks];
+            Assert(m_offConsume < pChunk->cbData);
+            *ppbData = pChunk->pbData + m_offConsume;
+            *pcbData = pChunk->cbData - m_offConsume;
+            return VINF_SUCCESS;
+        }
+        if (rcWorker != VINF_SUCCESS)
+            return rcWorker;
+
+        int rc = RTSemEventWait(m_hEvtProduced, msTimeout);
+        if (rc == VERR_TIMEOUT)
+            return rc;
+    }
+}
+
+/**
+ * Marks data returned by Peek() as consumed.
+ *
+ * @param   cbConsumed      Number of bytes consumed, can be less than what
+ *                          Peek() returned.
+ */
+void GuestFileCopyPipe::Advance(uint32_t cbConsumed)
+{
+    Chunk *pChunk = &m_paChunks[m_iConsume % m_cChunks];
+    Assert(m_offConsume + cbConsumed <= pChunk->cbData);
+    m_offConsume += cbConsumed;
+    if (m_offConsume >= pChunk->cbData)
+    {
+        m_offConsume = 0;
+        ASMAtomicIncU32(&m_iConsume);
+        RTSemEventSignal(m_hEvtConsumed);
+    }
+}
+
+/**
+ * Gets a free chunk to fill with data for the host file.
+ *
+ * @returns IPRT status code.  Returns the worker's status if writing the file
+ *          failed.
+ * @param   msTimeout       How long to wait for a free chunk.
+ * @param   ppbBuf          Where to return the buffer.
+ * @param   pcbBuf          Where to return the buffer size (the chunk size).
+ */
+int GuestFileCopyPipe::Acquire(RTMSINTERVAL msTimeout, BYTE **ppbBuf, uint32_t *pcbBuf)
+{
+    AssertReturn(!m_fReadAhead, VERR_WRONG_ORDER);
+
+    for (;;)
+    {
+        int rcWorker = ASMAtomicReadS32(&m_rcWorker);
+        if (RT_FAILURE(rcWorker))
+            return rcWorker;
+        if (m_iProduce - ASMAtomicReadU32(&m_iConsume) < m_cChunks)
+        {
+            *ppbBuf = m_paChunks[m_iProduce % m_cChunks].pbData;
+            *pcbBuf = m_cbChunk;
+            return VINF_SUCCESS;
+        }
+
+        int rc = RTSemEventWait(m_hEvtConsumed, msTimeout);
+        if (rc == VERR_TIMEOUT)
+            return rc;
+    }
+}
+
+/**
+ * Queues the chunk returned by Acquire() for writing.
+ *
+ * @param   cbData          Number of bytes put into the chunk.
+ */
+void GuestFileCopyPipe::Commit(uint32_t cbData)
+{
+    Assert(cbData <= m_cbChunk);
+    if (!cbData)
+        return;
+    m_paChunks[m_iProduce % m_cChunks].cbData = cbData;
+    ASMAtomicIncU32(&m_iProduce);
+    RTSemEventSignal(m_hEvtProduced);
+}
+
+/**
+ * Waits for all queued chunks to be written.
+ *
+ * @returns IPRT status code, the first write error if any.
+ * @param   msTimeout       How long to wait for each chunk.
+ */
+int GuestFileCopyPipe::Flush(RTMSINTERVAL msTimeout)
+{
+    AssertReturn(!m_fReadAhead, VERR_WRONG_ORDER);
+
+    for (;;)
+    {
+        int rcWorker = ASMAtomicReadS32(&m_rcWorker);
+        if (RT_FAILURE(rcWorker))
+            return rcWorker;
+        if (ASMAtomicReadU32(&m_iConsume) == m_iProduce)
+            return VINF_SUCCESS;
+
+        int rc = RTSemEventWait(m_hEvtConsumed, msTimeout);
+        if (rc == VERR_TIMEOUT)
+            return rc;
+    }
+}
+
+/* static */
+DECLCALLBACK(int) GuestFileCopyPipe::i_workerThread(RTTHREAD hThread, void *pvUser)
+{
+    RT_NOREF(hThread);
+    GuestFileCopyPipe *pThis = (GuestFileCopyPipe *)pvUser;
+    AssertPtr(pThis);
+
+    int rc = VINF_SUCCESS;
+    while (!ASMAtomicReadBool(&pThis->m_fShutdown))
+    {
+        if (pThis->m_fReadAhead)
+        {
+            if (!pThis->m_cbLeft)
+            {
+                rc = VERR_EOF; /* Tells the consumer we're done. */
+                break;
+            }
+            if (pThis->m_iProduce - ASMAtomicReadU32(&pThis->m_iConsume) >= pThis->m_cChunks)
+            {
+                RTSemEventWait(pThis->m_hEvtConsumed, RT_INDEFINITE_WAIT);
+                continue;
+            }
+
+            Chunk *pChunk = &pThis->m_paChunks[pThis->m_iProduce % pThis->m_cChunks];
+            size_t cbRead = 0;
+            rc = RTFileReadAt(pThis->m_hFile, pThis->m_offFile, pChunk->pbData,
+                              (size_t)RT_MIN(pThis->m_cbLeft, pThis->m_cbChunk), &cbRead);
+            if (RT_SUCCESS(rc) && !cbRead)
+                rc = VERR_EOF; /* File shrunk, the caller notices the short transfer. */
+            if (RT_FAILURE(rc))
+                break;
+
+            pChunk->cbData     = (uint32_t)cbRead;
+            pThis->m_offFile  += cbRead;
+            pThis->m_cbLeft   -= cbRead;
+            ASMAtomicIncU32(&pThis->m_iProduce);
+            RTSemEventSignal(pThis->m_hEvtProduced);
+        }
+        else
+        {
+            if (pThis->m_iConsume == ASMAtomicReadU32(&pThis->m_iProduce))
+            {
+                RTSemEventWait(pThis->m_hEvtProduced, RT_INDEFINITE_WAIT);
+                continue;
+            }
+
+            Chunk *pChunk = &pThis->m_paChunks[pThis->m_iConsume % pThis->m_cChunks];
+            rc = RTFileWriteAt(pThis->m_hFile, pThis->m_offFile, pChunk->pbData, pChunk->cbData, NULL /* No partial writes */);
+            if (RT_FAILURE(rc))
+                break;
+
+            pThis->m_offFile += pChunk->cbData;
+            ASMAtomicIncU32(&pThis->m_iConsume);
+            RTSemEventSignal(pThis->m_hEvtConsumed);
+        }
+    }
+
+    if (rc != VINF_SUCCESS)
+    {
+        ASMAtomicWriteS32(&pThis->m_rcWorker, rc);
+        /* Wake up whoever waits on us. */
+        RTSemEventSignal(pThis->m_hEvtProduced);
+        RTSemEventSignal(pThis->m_hEvtConsumed);
+    }
+
+    LogFlowFunc(("Leaving with rc=%Rrc, offFile=%RU64\n", rc, pThis->m_offFile));
+    return rc;
+}
+
 GuestBase::GuestBase(void)
     : mConsole(NULL),
       mNextContextID(0)
@@ -39,6 +39,8 @@
 #include <iprt/env.h>
 #include <iprt/file.h> /* For CopyTo/From. */
 #include <iprt/path.h>
+#include <iprt/string.h>
+#include <iprt/time.h>
 
 
 /*********************************************************************************************************************************
@@ -59,12 +61,27 @@
  *  existent on the .ISO. */
 #define UPDATEFILE_FLAG_OPTIONAL            RT_BIT(8)
 
+/**
+ * File copy pipeline.
+ */
+/** Number of chunks the host file I/O may run ahead of / behind the guest. */
+#define GSTCTL_COPY_CHUNKS                  4
+/** Chunk size all Guest Additions accept as process input. */
+#define GSTCTL_COPY_CHUNK_SIZE_DEFAULT      _64K
+/** Upper limit for the input chunk size the Guest Additions advertise. */
+#define GSTCTL_COPY_CHUNK_SIZE_MAX          _16M
+/** Chunk size for writing host files, a multiple of GSTCTL_COPY_OUTPUT_SIZE. */
+#define GSTCTL_COPY_HOST_CHUNK_SIZE         _1M
+/** The most the Guest Additions return per process output request. */
+#define GSTCTL_COPY_OUTPUT_SIZE             _64K
+
 
 // session task classes
 /////////////////////////////////////////////////////////////////////////////
 
 GuestSessionTask::GuestSessionTask(GuestSession *pSession)
-    : ThreadTask("GenericGuestSessionTask")
+    : ThreadTask("GenericGuestSessionTask"),
+      mNsLastThroughput(0)
 {
     mSession = pSession;
 }
@@ -153,6 +170,57 @@ int GuestSessionTask::setProgress(ULONG uPercent)
     return VINF_SUCCESS;
 }
 
+/**
+ * Sets the progress and reports the transfer rate in the operation
+ * description, the latter at most once a second.
+ *
+ * @returns IPRT status code, VERR_CANCELLED if the user canceled.
+ * @param   uPercent        The progress in percent.
+ * @param   cbDone          Number of bytes transferred so far.
+ * @param   nsStart         RTTimeNanoTS() when the transfer started.
+ */
+int GuestSessionTask::setProgressThroughput(ULONG uPercent, uint64_t cbDone, uint64_t nsStart)
+{
+    int rc = setProgress(uPercent);
+    if (   RT_SUCCESS(rc)
+        && !mProgress.isNull())
+    {
+        uint64_t const nsNow = RTTimeNanoTS();
+        if (nsNow - mNsLastThroughput >= RT_NS_1SEC)
+        {
+            mNsLastThroughput = nsNow;
+            uint64_t const cMsElapsed = RT_MAX((nsNow - nsStart) / RT_NS_1MS, 1);
+            mProgress->i_setOperationDescription(Utf8StrFmt(GuestSession::tr("%s (%RU64 KB/s)"), mDesc.c_str(),
+                                                            cbDone * RT_MS_1SEC / cMsElapsed / _1K));
+        }
+    }
+    return rc;
+}
+
+/**
+ * Determines the chunk size for sending file data to the guest.
+ *
+ * Guest Additions which can take larger process input chunks than the
+ * traditional 64K advertise their limit in a guest property.
+ *
+ * @returns Chunk size in bytes.
+ */
+uint32_t GuestSessionTask::getCopyChunkSize(void)
+{
+    uint32_t cbChunk = GSTCTL_COPY_CHUNK_SIZE_DEFAULT;
+
+    ComObjPtr<Guest> pGuest(mSession->i_getParent());
+    Utf8Str strValue;
+    uint32_t cbGuest;
+    if (   RT_SUCCESS(getGuestProperty(pGuest, GUEST_CONTROL_PROP_MAX_INPUT_SIZE, strValue))
+        && RTStrToUInt32Full(strValue.c_str(), 0, &cbGuest) == VINF_SUCCESS
+        && cbGuest > cbChunk)
+        cbChunk = RT_MIN(cbGuest, GSTCTL_COPY_CHUNK_SIZE_MAX);
+
+    LogFlowThisFunc(("cbChunk=%RU32 (guest: %s)\n", cbChunk, strValue.c_str()));
+    return cbChunk;
+}
+
 int GuestSessionTask::setProgressSuccess(void)
 {
     if (mProgress.isNull()) /* Progress is optional. */
@@ -386,14 +454,30 @@ int SessionTaskCopyTo::Run(void)
         }
     }
 
+    /*
+     * Read the source ahead on a worker thread so the host I/O overlaps with
+     * the guest writing the previous chunk.
+     */
+    GuestFileCopyPipe Pipe;
+    if (   RT_SUCCESS(rc)
+        && mSourceSize)
+    {
+        rc = Pipe.Init(*pFile, true /* fReadAhead */, mSourceOffset, mSourceSize,
+                       getCopyChunkSize(), GSTCTL_COPY_CHUNKS);
+        if (RT_FAILURE(rc))
+            setProgressErrorMsg(VBOX_E_IPRT_ERROR,
+                                Utf8StrFmt(GuestSession::tr("Setting up reading host file \"%s\" failed: %Rrc"),
+                                           mSource.c_str(), rc));
+    }
+
     if (RT_SUCCESS(rc))
     {
         ProcessWaitResult_T waitRes;
-        BYTE byBuf[_64K];
 
         BOOL fCanceled = FALSE;
         uint64_t cbWrittenTotal = 0;
         uint64_t cbToRead = mSourceSize;
+        uint64_t const nsStart = RTTimeNanoTS();
 
         for (;;)
         {
@@ -410,34 +494,23 @@ int SessionTaskCopyTo::Run(void)
             if (waitRes == ProcessWaitResult_WaitFlagNotSupported)
                 RTThreadYield(); /* Optional, don't check rc. */
 
-            size_t cbRead = 0;
+            const BYTE *pbData = NULL;
+            uint32_t    cbRead = 0;
             if (mSourceSize) /* If we have nothing to write, take a shortcut. */
             {
-                /** @todo Not very efficient, but works for now. */
-                rc = RTFileSeek(*pFile, mSourceOffset + cbWrittenTotal,
-                                RTFILE_SEEK_BEGIN, NULL /* poffActual */);
-                if (RT_SUCCESS(rc))
-                {
-                    rc = RTFileRead(*pFile, (uint8_t*)byBuf,
-                                    RT_MIN((size_t)cbToRead, sizeof(byBuf)), &cbRead);
-                    /*
-                     * Some other error occured? There might be a chance that RTFileRead
-                     * could not resolve/map the native error code to an IPRT code, so just
-                     * print a generic error.
-                     */
-                    if (RT_FAILURE(rc))
-                    {
-                        setProgressErrorMsg(VBOX_E_IPRT_ERROR,
-                                            Utf8StrFmt(GuestSession::tr("Could not read from host file \"%s\" (%Rrc)"),
-                                                       mSource.c_str(), rc));
-                        break;
-                    }
-                }
-                else
+                rc = Pipe.Peek(msTimeout, &pbData, &cbRead);
+                if (rc == VERR_EOF) /* The file shrunk, the size check below tells the user. */
+                    rc = VINF_SUCCESS;
+                /*
+                 * Some other error occured? There might be a chance that RTFileReadAt
+                 * could not resolve/map the native error code to an IPRT code, so just
+                 * print a generic error.
+                 */
+                else if (RT_FAILURE(rc))
                 {
                     setProgressErrorMsg(VBOX_E_IPRT_ERROR,
-                                        Utf8StrFmt(GuestSession::tr("Seeking host file \"%s\" to offset %RU64 failed: %Rrc"),
-                                                   mSource.c_str(), cbWrittenTotal, rc));
+                                        Utf8StrFmt(GuestSession::tr("Could not read from host file \"%s\" (%Rrc)"),
+                                                   mSource.c_str(), rc));
                     break;
                 }
             }
@@ -445,23 +518,21 @@ int SessionTaskCopyTo::Run(void)
             uint32_t fFlags = ProcessInputFlag_None;
 
             /* Did we reach the end of the content we want to transfer (last chunk)? */
-            if (   (cbRead < sizeof(byBuf))
-                /* Did we reach the last block which is exactly _64K? */
-                || (cbToRead - cbRead == 0)
+            if (   !cbRead
+                || cbToRead - cbRead == 0
                 /* ... or does the user want to cancel? */
                 || (   !mProgress.isNull()
                     && SUCCEEDED(mProgress->COMGETTER(Canceled(&fCanceled)))
                     && fCanceled)
                )
             {
-                LogFlowThisFunc(("Writing last chunk cbRead=%RU64\n", cbRead));
+                LogFlowThisFunc(("Writing last chunk cbRead=%RU32\n", cbRead));
                 fFlags |= ProcessInputFlag_EndOfFile;
             }
 
             uint32_t cbWritten;
-            Assert(sizeof(byBuf) >= cbRead);
             rc = pProcess->i_writeData(0 /* StdIn */, fFlags,
-                                       byBuf, cbRead,
+                                       (void *)pbData, cbRead,
                                        msTimeout, &cbWritten, &guestRc);
             if (RT_FAILURE(rc))
             {
@@ -482,7 +553,10 @@ int SessionTaskCopyTo::Run(void)
                 break;
             }
 
-            /* Only subtract bytes reported written by the guest. */
+            /* Only subtract bytes reported written by the guest, the rest goes next round. */
+            Assert(cbRead >= cbWritten);
+            if (cbWritten)
+                Pipe.Advance(cbWritten);
             Assert(cbToRead >= cbWritten);
             cbToRead -= cbWritten;
 
@@ -500,7 +574,7 @@ int SessionTaskCopyTo::Run(void)
             /* Update the progress.
              * Watch out for division by zero. */
             mSourceSize > 0
-                ? rc = setProgress((ULONG)(cbWrittenTotal * 100 / mSourceSize))
+                ? rc = setProgressThroughput((ULONG)(cbWrittenTotal * 100 / mSourceSize), cbWrittenTotal, nsStart)
                 : rc = setProgress(100);
             if (RT_FAILURE(rc))
                 break;
@@ -508,10 +582,16 @@ int SessionTaskCopyTo::Run(void)
             /* End of file reached? */
             if (!cbToRead)
                 break;
+
+            /* The guest closed stdin after taking all of the last chunk (the file shrunk). */
+            if (   (fFlags & ProcessInputFlag_EndOfFile)
+                && cbWritten == cbRead)
+                break;
         } /* for */
 
         LogFlowThisFunc(("Copy loop ended with rc=%Rrc, cbToRead=%RU64, cbWrittenTotal=%RU64, cbFileSize=%RU64\n",
                          rc, cbToRead, cbWrittenTotal, mSourceSize));
+        Pipe.Destroy();
 
         /*
          * Wait on termination of guest process until it completed all operations.
@@ -696,14 +776,30 @@ int SessionTaskCopyFrom::Run(void)
             }
             else
             {
-                ProcessWaitResult_T waitRes;
-                BYTE byBuf[_64K];
+                /*
+                 * Write the host file behind on a worker thread so the host I/O overlaps
+                 * with fetching the next output from the guest.  Each chunk collects
+                 * several guest reads.
+                 */
+                GuestFileCopyPipe Pipe;
+                rc = Pipe.Init(fileDest, false /* fReadAhead */, 0 /* offFile */, 0 /* cbFile */,
+                               GSTCTL_COPY_HOST_CHUNK_SIZE, GSTCTL_COPY_CHUNKS);
+                if (RT_FAILURE(rc))
+                    setProgressErrorMsg(VBOX_E_IPRT_ERROR,
+                                        Utf8StrFmt(GuestSession::tr("Setting up writing host file \"%s\" failed: %Rrc"),
+                                                   mDest.c_str(), rc));
+
+                ProcessWaitResult_T waitRes = ProcessWaitResult_None;
 
                 BOOL fCanceled = FALSE;
                 uint64_t cbWrittenTotal = 0;
                 uint64_t cbToRead = objData.mObjectSize;
+                uint64_t const nsStart = RTTimeNanoTS();
+                BYTE    *pbChunk = NULL;
+                uint32_t cbChunk = 0;
+                uint32_t offChunk = 0;
 
-                for (;;)
+                while (RT_SUCCESS(rc))
                 {
                     rc = pProcess->i_waitFor(ProcessWaitForFlag_StdOut, msTimeout, waitRes, &guestRc);
                     if (RT_FAILURE(rc))
@@ -733,9 +829,23 @@ int SessionTaskCopyFrom::Run(void)
                         if (waitRes == ProcessWaitResult_WaitFlagNotSupported)
                             RTThreadYield(); /* Optional, don't check rc. */
 
+                        if (!pbChunk)
+                        {
+                            rc = Pipe.Acquire(msTimeout, &pbChunk, &cbChunk);
+                            if (RT_FAILURE(rc))
+                            {
+                                setProgressErrorMsg(VBOX_E_IPRT_ERROR,
+                                                    Utf8StrFmt(GuestSession::tr("Writing to host file \"%s\" (%RU64 bytes left) failed: %Rrc"),
+                                                               mDest.c_str(), cbToRead, rc));
+                                break;
+                            }
+                            offChunk = 0;
+                        }
+                        Assert(cbChunk - offChunk >= GSTCTL_COPY_OUTPUT_SIZE);
+
                         uint32_t cbRead = 0; /* readData can return with VWRN_GSTCTL_OBJECTSTATE_CHANGED. */
-                        rc = pProcess->i_readData(OUTPUT_HANDLE_ID_STDOUT, sizeof(byBuf),
-                                                  msTimeout, byBuf, sizeof(byBuf),
+                        rc = pProcess->i_readData(OUTPUT_HANDLE_ID_STDOUT, GSTCTL_COPY_OUTPUT_SIZE,
+                                                  msTimeout, pbChunk + offChunk, GSTCTL_COPY_OUTPUT_SIZE,
                                                   &cbRead, &guestRc);
                         if (RT_FAILURE(rc))
                         {
@@ -758,13 +868,12 @@ int SessionTaskCopyFrom::Run(void)
 
                         if (cbRead)
                         {
-                            rc = RTFileWrite(fileDest, byBuf, cbRead, NULL /* No partial writes */);
-                            if (RT_FAILURE(rc))
+                            /* Hand the chunk to the writer once it can't take another read. */
+                            offChunk += cbRead;
+                            if (cbChunk - offChunk < GSTCTL_COPY_OUTPUT_SIZE)
                             {
-                                setProgressErrorMsg(VBOX_E_IPRT_ERROR,
-                                                    Utf8StrFmt(GuestSession::tr("Writing to host file \"%s\" (%RU64 bytes left) failed: %Rrc"),
-                                                                mDest.c_str(), cbToRead, rc));
-                                break;
+                                Pipe.Commit(offChunk);
+                                pbChunk = NULL;
                             }
 
                             /* Only subtract bytes reported written by the guest. */
@@ -780,7 +889,8 @@ int SessionTaskCopyFrom::Run(void)
                                 && fCanceled)
                                 break;
 
-                            rc = setProgress((ULONG)(cbWrittenTotal / ((uint64_t)objData.mObjectSize / 100.0)));
+                            rc = setProgressThroughput((ULONG)(cbWrittenTotal / ((uint64_t)objData.mObjectSize / 100.0)),
+                                                       cbWrittenTotal, nsStart);
                             if (RT_FAILURE(rc))
                                 break;
                         }
@@ -790,7 +900,20 @@ int SessionTaskCopyFrom::Run(void)
                         break;
                     }
 
-                } /* for */
+                } /* while */
+
+                /* Write out the partial chunk and wait for the writer. */
+                if (pbChunk)
+                    Pipe.Commit(offChunk);
+                if (RT_SUCCESS(rc))
+                {
+                    rc = Pipe.Flush(RT_INDEFINITE_WAIT);
+                    if (RT_FAILURE(rc))
+                        setProgressErrorMsg(VBOX_E_IPRT_ERROR,
+                                            Utf8StrFmt(GuestSession::tr("Writing to host file \"%s\" failed: %Rrc"),
+                                                       mDest.c_str(), rc));
+                }
+                Pipe.Destroy();
 
                 LogFlowThisFunc(("rc=%Rrc, guestrc=%Rrc, waitRes=%ld, cbWrittenTotal=%RU64, cbSize=%RI64, cbToRead=%RU64\n",
                                  rc, guestRc, waitRes, cbWrittenTotal, objData.mObjectSize, cbToRead));
@@ -32,6 +32,7 @@
 #include <iprt/critsect.h>
 #include <iprt/asm.h>
 #include <iprt/ldr.h>
+#include <iprt/list.h>
 #include <iprt/param.h>
 #include <iprt/path.h>
 #include <iprt/string.h>
@@ -59,18 +60,33 @@
  *
  * This message completion callback is only valid for Call requests.
  * Connect and Disconnect are processed synchronously by the service.
+ *
+ * Services setting VBOX_HGCM_SVC_F_CALL_WORKERS get a pool of worker threads
+ * in addition.  The service thread then only queues guest calls for the
+ * workers, so one slow call (e.g. a read from a network share) no longer holds
+ * up the calls of the other guest threads.  Before any other message is
+ * delivered the service thread waits for the pool to go idle, so the service
+ * never sees pfnCall concurrently with the other entry points.  With
+ * VBOX_HGCM_SVC_F_CALL_CLIENT_ORDERED a client only has one call executing at
+ * a time and the calls are executed in order.
  */
 
 
 /* The maximum allowed size of a service name in bytes. */
 #define VBOX_HGCM_SVC_NAME_MAX_BYTES 1024
 
+/* The default number of worker threads for VBOX_HGCM_SVC_F_CALL_WORKERS. */
+#define HGCM_SVC_DEFAULT_WORKERS 4
+
 struct _HGCMSVCEXTHANDLEDATA
 {
     char *pszServiceName;
     /* The service name follows. */
 };
 
+class HGCMClient;
+class HGCMMsgCall;
+
 /** Internal helper service object. HGCM code would use it to
  *  hold information about services and communicate with services.
  *  The HGCMService is an (in future) abstract class that implements
@@ -115,9 +131,40 @@ class HGCMService
 
         HGCMSVCEXTHANDLE m_hExtension;
 
+        /** @name Guest call worker pool (VBOX_HGCM_SVC_F_CALL_WORKERS).
+         * @{ */
+        /** Protects the queue and counters. */
+        RTCRITSECT m_WorkerCritSect;
+        /** Queued guest calls (HGCMMsgCall). */
+        RTLISTANCHOR m_WorkerQueue;
+        /** Signalled when there is work or when the workers should terminate. */
+        RTSEMEVENTMULTI m_hWorkerEvt;
+        /** Signalled when the pool goes idle. */
+        RTSEMEVENTMULTI m_hWorkerIdleEvt;
+        /** Number of queued calls. */
+        uint32_t m_cWorkerCallsQueued;
+        /** Number of calls being executed. */
+        uint32_t m_cWorkerCallsBusy;
+        /** Set when the workers should terminate. */
+        bool m_fWorkersTerminate;
+        /** Number of worker threads, 0 if no pool. */
+        uint32_t m_cWorkers;
+        /** The worker threads. */
+        RTTHREAD m_ahWorkers[VBOX_HGCM_SVC_MAX_WORKERS];
+        /** @} */
+
         int loadServiceDLL(void);
         void unloadServiceDLL(void);
 
+        /*
+         * Worker pool methods.
+         */
+        int workersCreate(void);
+        void workersDestroy(void);
+        void workersDrain(void);
+        void workersQueueCall(HGCMMsgCall *pMsg, HGCMClient *pClient);
+        static DECLCALLBACK(int) workerThread(RTTHREAD hThreadSelf, void *pvUser);
+
         /*
          * Main HGCM thread methods.
          */
@@ -182,7 +229,7 @@ class HGCMClient: public HGCMObject
 {
     public:
         HGCMClient() : HGCMObject(HGCMOBJ_CLIENT), pService(NULL),
-                        pvData(NULL) {};
+                        pvData(NULL), fCallBusy(false) {};
         ~HGCMClient();
 
         int Init(HGCMService *pSvc);
@@ -192,6 +239,11 @@ class HGCMClient: public HGCMObject
 
         /** Client specific data. */
         void *pvData;
+
+        /** Set while a worker executes a call of this client
+         *  (VBOX_HGCM_SVC_F_CALL_CLIENT_ORDERED).  Protected by the
+         *  service worker lock. */
+        bool fCallBusy;
 };
 
 HGCMClient::~HGCMClient()
@@ -242,9 +294,19 @@ HGCMService::HGCMService()
 #ifdef VBOX_WITH_CRHGSMI
     m_cHandleAcquires (0),
 #endif
-    m_hExtension (NULL)
+    m_hExtension (NULL),
+    m_hWorkerEvt (NIL_RTSEMEVENTMULTI),
+    m_hWorkerIdleEvt (NIL_RTSEMEVENTMULTI),
+    m_cWorkerCallsQueued (0),
+    m_cWorkerCallsBusy (0),
+    m_fWorkersTerminate (false),
+    m_cWorkers (0)
 {
     RT_ZERO(m_fntable);
+    RT_ZERO(m_WorkerCritSect);
+    RTListInit(&m_WorkerQueue);
+    for (unsigned i = 0; i < RT_ELEMENTS(m_ahWorkers); i++)
+        m_ahWorkers[i] = NIL_RTTHREAD;
 }
 
 
@@ -415,6 +477,8 @@ class HGCMMsgHeader: public HGCMMsgCore
 class HGCMMsgCall: public HGCMMsgHeader
 {
     public:
+        HGCMMsgCall() : pClient(NULL) {};
+
         /* client identifier */
         uint32_t u32ClientId;
 
@@ -425,6 +489,12 @@ class HGCMMsgCall: public HGCMMsgHeader
         uint32_t cParms;
 
         VBOXHGCMSVCPARM *paParms;
+
+        /* Worker pool queue node, valid while queued. */
+        RTLISTNODE WorkerNode;
+
+        /* The referenced client while queued for the worker pool. */
+        HGCMClient *pClient;
 };
 
 class HGCMMsgLoadSaveStateClient: public HGCMMsgCore
@@ -527,6 +597,11 @@ DECLCALLBACK(void) hgcmServiceThread(HGCMTHREADHANDLE ThreadHandle, void *pvUser
         /* Cache required information to avoid unnecessary pMsgCore access. */
         uint32_t u32MsgId = pMsgCore->MsgId();
 
+        /* Only guest calls may overlap with calls executing on the worker pool. */
+        if (   u32MsgId != SVC_MSG_GUESTCALL
+            && pSvc->m_cWorkers)
+            pSvc->workersDrain();
+
         switch (u32MsgId)
         {
 #ifdef VBOX_WITH_CRHGSMI
@@ -543,11 +618,22 @@ DECLCALLBACK(void) hgcmServiceThread(HGCMTHREADHANDLE ThreadHandle, void *pvUser
             {
                 LogFlowFunc(("SVC_MSG_LOAD\n"));
                 rc = pSvc->loadServiceDLL();
+                if (   RT_SUCCESS(rc)
+                    && (pSvc->m_fntable.fFlags & VBOX_HGCM_SVC_F_CALL_WORKERS))
+                {
+                    rc = pSvc->workersCreate();
+                    if (RT_FAILURE(rc))
+                    {
+                        pSvc->m_fntable.pfnUnload(pSvc->m_fntable.pvService);
+                        pSvc->unloadServiceDLL();
+                    }
+                }
             } break;
 
             case SVC_MSG_UNLOAD:
             {
                 LogFlowFunc(("SVC_MSG_UNLOAD\n"));
+                pSvc->workersDestroy();
                 if (pSvc->m_fntable.pfnUnload)
                 {
                     pSvc->m_fntable.pfnUnload(pSvc->m_fntable.pvService);
@@ -610,11 +696,19 @@ DECLCALLBACK(void) hgcmServiceThread(HGCMTHREADHANDLE ThreadHandle, void *pvUser
 
                 if (pClient)
                 {
-                    pSvc->m_fntable.pfnCall(pSvc->m_fntable.pvService, (VBOXHGCMCALLHANDLE)pMsg, pMsg->u32ClientId,
-                                            HGCM_CLIENT_DATA(pSvc, pClient), pMsg->u32Function,
-                                            pMsg->cParms, pMsg->paParms);
+                    if (pSvc->m_cWorkers)
+                    {
+                        /* The worker releases the client reference. */
+                        pSvc->workersQueueCall(pMsg, pClient);
+                    }
+                    else
+                    {
+                        pSvc->m_fntable.pfnCall(pSvc->m_fntable.pvService, (VBOXHGCMCALLHANDLE)pMsg, pMsg->u32ClientId,
+                                                HGCM_CLIENT_DATA(pSvc, pClient), pMsg->u32Function,
+                                                pMsg->cParms, pMsg->paParms);
 
-                    hgcmObjDereference(pClient);
+                        hgcmObjDereference(pClient);
+                    }
                 }
                 else
                 {
@@ -755,6 +849,186 @@ DECLCALLBACK(void) hgcmServiceThread(HGCMTHREADHANDLE ThreadHandle, void *pvUser
     }
 }
 
+/*
+ * The guest call worker pool.
+ */
+
+/** Creates the worker pool, called on the service thread after loading.
+ *
+ * @return VBox code
+ */
+int HGCMService::workersCreate(void)
+{
+    uint32_t cWorkers = m_fntable.cWorkers ? m_fntable.cWorkers : HGCM_SVC_DEFAULT_WORKERS;
+    cWorkers = RT_MIN(cWorkers, RT_ELEMENTS(m_ahWorkers));
+
+    int rc = RTCritSectInit(&m_WorkerCritSect);
+    if (RT_SUCCESS(rc))
+        rc = RTSemEventMultiCreate(&m_hWorkerEvt);
+    if (RT_SUCCESS(rc))
+        rc = RTSemEventMultiCreate(&m_hWorkerIdleEvt);
+
+    m_fWorkersTerminate = false;
+    for (uint32_t i = 0; i < cWorkers && RT_SUCCESS(rc); i++)
+    {
+        rc = RTThreadCreateF(&m_ahWorkers[i], workerThread, this, 0 /*cbStack*/, RTTHREADTYPE_IO,
+                             RTTHREADFLAGS_WAITABLE, "HgcmWrk%u", i);
+        if (RT_SUCCESS(rc))
+            m_cWorkers++;
+    }
+
+    if (RT_FAILURE(rc))
+    {
+        LogRel(("HGCM: Failed to create the worker pool for %s: %Rrc\n", m_pszSvcName, rc));
+        workersDestroy();
+    }
+    else
+        LogRel2(("HGCM: Service %s uses %u worker threads%s\n", m_pszSvcName, m_cWorkers,
+                 m_fntable.fFlags & VBOX_HGCM_SVC_F_CALL_CLIENT_ORDERED ? " (client ordered)" : ""));
+    return rc;
+}
+
+/** Terminates the worker pool after draining it.  Safe to call when there is
+ *  no pool. */
+void HGCMService::workersDestroy(void)
+{
+    if (m_cWorkers)
+    {
+        workersDrain();
+
+        RTCritSectEnter(&m_WorkerCritSect);
+        m_fWorkersTerminate = true;
+        RTSemEventMultiSignal(m_hWorkerEvt);
+        RTCritSectLeave(&m_WorkerCritSect);
+    }
+
+    for (unsigned i = 0; i < RT_ELEMENTS(m_ahWorkers); i++)
+        if (m_ahWorkers[i] != NIL_RTTHREAD)
+        {
+            int rc = RTThreadWait(m_ahWorkers[i], RT_INDEFINITE_WAIT, NULL);
+            AssertRC(rc);
+            m_ahWorkers[i] = NIL_RTTHREAD;
+        }
+    m_cWorkers = 0;
+
+    if (m_hWorkerIdleEvt != NIL_RTSEMEVENTMULTI)
+    {
+        RTSemEventMultiDestroy(m_hWorkerIdleEvt);
+        m_hWorkerIdleEvt = NIL_RTSEMEVENTMULTI;
+    }
+    if (m_hWorkerEvt != NIL_RTSEMEVENTMULTI)
+    {
+        RTSemEventMultiDestroy(m_hWorkerEvt);
+        m_hWorkerEvt = NIL_RTSEMEVENTMULTI;
+    }
+    if (RTCritSectIsInitialized(&m_WorkerCritSect))
+        RTCritSectDelete(&m_WorkerCritSect);
+}
+
+/** Waits for all queued and executing guest calls to return from pfnCall.
+ *  Called on the service thread. */
+void HGCMService::workersDrain(void)
+{
+    RTCritSectEnter(&m_WorkerCritSect);
+    while (m_cWorkerCallsQueued || m_cWorkerCallsBusy)
+    {
+        RTSemEventMultiReset(m_hWorkerIdleEvt);
+        RTCritSectLeave(&m_WorkerCritSect);
+
+        RTSemEventMultiWait(m_hWorkerIdleEvt, RT_INDEFINITE_WAIT);
+
+        RTCritSectEnter(&m_WorkerCritSect);
+    }
+    RTCritSectLeave(&m_WorkerCritSect);
+}
+
+/** Hands a guest call to the worker pool.  Called on the service thread.
+ *
+ * @param pMsg     The call message.
+ * @param pClient  The referenced client, the reference is released by the
+ *                 worker.
+ */
+void HGCMService::workersQueueCall(HGCMMsgCall *pMsg, HGCMClient *pClient)
+{
+    pMsg->pClient = pClient;
+
+    RTCritSectEnter(&m_WorkerCritSect);
+    RTListAppend(&m_WorkerQueue, &pMsg->WorkerNode);
+    m_cWorkerCallsQueued++;
+    RTSemEventMultiSignal(m_hWorkerEvt);
+    RTCritSectLeave(&m_WorkerCritSect);
+}
+
+/** The worker thread, executes queued guest calls. */
+/* static */ DECLCALLBACK(int) HGCMService::workerThread(RTTHREAD hThreadSelf, void *pvUser)
+{
+    HGCMService *pSvc = (HGCMService *)pvUser;
+    bool const fOrdered = RT_BOOL(pSvc->m_fntable.fFlags & VBOX_HGCM_SVC_F_CALL_CLIENT_ORDERED);
+    RT_NOREF(hThreadSelf);
+
+    RTCritSectEnter(&pSvc->m_WorkerCritSect);
+    while (!pSvc->m_fWorkersTerminate)
+    {
+        /* Take the oldest call which may be executed now. */
+        HGCMMsgCall *pMsg = NULL;
+        HGCMMsgCall *pCur;
+        RTListForEach(&pSvc->m_WorkerQueue, pCur, HGCMMsgCall, WorkerNode)
+        {
+            if (!fOrdered || !pCur->pClient->fCallBusy)
+            {
+                pMsg = pCur;
+                break;
+            }
+        }
+
+        if (!pMsg)
+        {
+            /* Nothing we can do, wait for more work.  Resetting under the lock
+               is fine as new work is signalled under the lock too. */
+            RTSemEventMultiReset(pSvc->m_hWorkerEvt);
+            RTCritSectLeave(&pSvc->m_WorkerCritSect);
+            RTSemEventMultiWait(pSvc->m_hWorkerEvt, RT_INDEFINITE_WAIT);
+            RTCritSectEnter(&pSvc->m_WorkerCritSect);
+            continue;
+        }
+
+        RTListNodeRemove(&pMsg->WorkerNode);
+        pSvc->m_cWorkerCallsQueued--;
+        pSvc->m_cWorkerCallsBusy++;
+        HGCMClient *pClient = pMsg->pClient;
+        if (fOrdered)
+            pClient->fCallBusy = true;
+        RTCritSectLeave(&pSvc->m_WorkerCritSect);
+
+        /* The message may be completed and freed before pfnCall returns, so
+           don't touch it afterwards. */
+        LogFlowFunc(("worker call u32ClientId = %d, u32Function = %d\n", pMsg->u32ClientId, pMsg->u32Function));
+        pSvc->m_fntable.pfnCall(pSvc->m_fntable.pvService, (VBOXHGCMCALLHANDLE)pMsg, pMsg->u32ClientId,
+                                HGCM_CLIENT_DATA(pSvc, pClient), pMsg->u32Function,
+                                pMsg->cParms, pMsg->paParms);
+
+        RTCritSectEnter(&pSvc->m_WorkerCritSect);
+        pSvc->m_cWorkerCallsBusy--;
+        if (fOrdered)
+        {
+            pClient->fCallBusy = false;
+            /* The next call of this client may be waiting for us. */
+            if (pSvc->m_cWorkerCallsQueued)
+                RTSemEventMultiSignal(pSvc->m_hWorkerEvt);
+        }
+        if (!pSvc->m_cWorkerCallsQueued && !pSvc->m_cWorkerCallsBusy)
+            RTSemEventMultiSignal(pSvc->m_hWorkerIdleEvt);
+        RTCritSectLeave(&pSvc->m_WorkerCritSect);
+
+        hgcmObjDereference(pClient);
+
+        RTCritSectEnter(&pSvc->m_WorkerCritSect);
+    }
+    RTCritSectLeave(&pSvc->m_WorkerCritSect);
+
+    return VINF_SUCCESS;
+}
+
 /* static */ DECLCALLBACK(void) HGCMService::svcHlpCallComplete(VBOXHGCMCALLHANDLE callHandle, int32_t rc)
 {
    HGCMMsgCore *pMsgCore = (HGCMMsgCore *)callHandle;
@@ -94,6 +94,8 @@ HRESULT MachineDebugger::init(Console *aParent)
     mLogEnabledQueued = -1;
     mVirtualTimeRateQueued = UINT32_MAX;
     mFlushMode = false;
+    mpStatsBinSnap = NULL;
+    mpStatsBinSnapUVM = NULL;
 
     /* Confirm a successful initialization */
     autoInitSpan.setSucceeded();
@@ -114,6 +116,7 @@ void MachineDebugger::uninit()
     if (autoUninitSpan.uninitDone())
         return;
 
+    i_destroyStatsBinSnap();
     unconst(mParent) = NULL;
     mFlushMode = false;
 }
@@ -799,19 +802,22 @@ HRESULT MachineDebugger::getUptime(LONG64 *aUptime)
 
 HRESULT MachineDebugger::dumpGuestCore(const com::Utf8Str &aFilename, const com::Utf8Str &aCompression)
 {
-    if (aCompression.length())
-        return setError(E_INVALIDARG, tr("The compression parameter must be empty"));
+    uint32_t fFlags = 0;
+    if (aCompression.equalsIgnoreCase("gzip"))
+        fFlags |= DBGFCOREWRITE_F_GZIP;
+    else if (aCompression.length())
+        return setError(E_INVALIDARG, tr("The compression parameter must be empty or 'gzip'"));
 
     AutoWriteLock alock(this COMMA_LOCKVAL_SRC_POS);
     Console::SafeVMPtr ptrVM(mParent);
     HRESULT hrc = ptrVM.rc();
     if (SUCCEEDED(hrc))
     {
-        int vrc = DBGFR3CoreWrite(ptrVM.rawUVM(), aFilename.c_str(), false /*fReplaceFile*/);
+        int vrc = DBGFR3CoreWriteEx(ptrVM.rawUVM(), aFilename.c_str(), fFlags);
         if (RT_SUCCESS(vrc))
             hrc = S_OK;
         else
-            hrc = setError(E_FAIL, tr("DBGFR3CoreWrite failed with %Rrc"), vrc);
+            hrc = setError(E_FAIL, tr("DBGFR3CoreWriteEx failed with %Rrc"), vrc);
     }
 
     return hrc;
@@ -1589,10 +1595,75 @@ HRESULT MachineDebugger::getStats(const com::Utf8Str &aPattern, BOOL aWithDescri
     return S_OK;
 }
 
+/**
+ * Get the VM statistics in the binary delta format.
+ *
+ * @returns COM status code.
+ * @param   aPattern            The selection pattern. A bit similar to filename globbing.
+ * @param   aStats              The binary snapshot.
+ */
+HRESULT MachineDebugger::getStatsBinary(const com::Utf8Str &aPattern, std::vector<BYTE> &aStats)
+{
+    AutoWriteLock alock(this COMMA_LOCKVAL_SRC_POS);
+    Console::SafeVMPtrQuiet ptrVM(mParent);
+
+    if (!ptrVM.isOk())
+        return setError(VBOX_E_INVALID_VM_STATE, "Machine is not running");
+
+    /*
+     * The snapshot context keeps the previous values, so it is reused as long
+     * as the pattern and the VM stay the same.  The UVM is retained so its
+     * address can't be reused by a new VM while we hang on to the context.
+     */
+    if (   mpStatsBinSnap
+        && (   mpStatsBinSnapUVM != ptrVM.rawUVM()
+            || !mStrStatsBinSnapPattern.equals(aPattern)))
+        i_destroyStatsBinSnap();
+    if (!mpStatsBinSnap)
+    {
+        int vrc = STAMR3BinSnapshotCreate(ptrVM.rawUVM(), aPattern.c_str(), &mpStatsBinSnap);
+        if (RT_FAILURE(vrc))
+            return vrc == VERR_NO_MEMORY ? E_OUTOFMEMORY : setError(E_FAIL, "STAMR3BinSnapshotCreate failed: %Rrc", vrc);
+        mpStatsBinSnapUVM = ptrVM.rawUVM();
+        VMR3RetainUVM(mpStatsBinSnapUVM);
+        mStrStatsBinSnapPattern = aPattern;
+    }
+
+    const void *pvData = NULL;
+    size_t      cbData = 0;
+    int vrc = STAMR3BinSnapshotTake(mpStatsBinSnap, &pvData, &cbData);
+    if (RT_FAILURE(vrc))
+        return vrc == VERR_NO_MEMORY ? E_OUTOFMEMORY : setError(E_FAIL, "STAMR3BinSnapshotTake failed: %Rrc", vrc);
+
+    aStats.assign((const BYTE *)pvData, (const BYTE *)pvData + cbData);
+    return S_OK;
+}
+
 
 // public methods only for internal purposes
 /////////////////////////////////////////////////////////////////////////////
 
+/**
+ * Destroys the binary statistics snapshot context, if any.
+ *
+ * The context only references the VM while taking snapshots, so this is fine
+ * after the VM is gone as long as the UVM is still retained.
+ */
+void MachineDebugger::i_destroyStatsBinSnap()
+{
+    if (mpStatsBinSnap)
+    {
+        STAMR3BinSnapshotDestroy(mpStatsBinSnap);
+        mpStatsBinSnap = NULL;
+    }
+    if (mpStatsBinSnapUVM)
+    {
+        VMR3ReleaseUVM(mpStatsBinSnapUVM);
+        mpStatsBinSnapUVM = NULL;
+    }
+    mStrStatsBinSnapPattern.setNull();
+}
+
 void MachineDebugger::i_flushQueuedSettings()
 {
     mFlushMode = true;
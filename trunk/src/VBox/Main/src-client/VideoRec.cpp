@@ -27,6 +27,7 @@
 #include <iprt/asm.h>
 #include <iprt/assert.h>
 #include <iprt/critsect.h>
+#include <iprt/mp.h>
 #include <iprt/path.h>
 #include <iprt/semaphore.h>
 #include <iprt/thread.h>
@@ -46,13 +47,23 @@
 # define DEFAULTCODEC (vpx_codec_vp8_cx())
 #endif /* VBOX_WITH_LIBVPX */
 
+#ifdef RT_ARCH_AMD64
+/* SSE2 is part of the AMD64 base line, so no run-time detection needed. */
+# include <emmintrin.h>
+#endif
+
+/** Maximum time (in ms) between two encoded frames, even if the screen content
+ *  did not change in the meantime. */
+#define VIDEOREC_IDLE_FRAME_MS      1000
+
 struct VIDEORECVIDEOFRAME;
 typedef struct VIDEORECVIDEOFRAME *PVIDEORECVIDEOFRAME;
 
 static int videoRecEncodeAndWrite(PVIDEORECSTREAM pStream, PVIDEORECVIDEOFRAME pFrame);
 static int videoRecRGBToYUV(uint32_t uPixelFormat,
                             uint8_t *paDst, uint32_t uDstWidth, uint32_t uDstHeight,
-                            uint8_t *paSrc, uint32_t uSrcWidth, uint32_t uSrcHeight);
+                            uint8_t *paSrc, uint32_t uSrcWidth, uint32_t uSrcHeight,
+                            uint32_t uYStart, uint32_t uYEnd);
 
 static int videoRecStreamCloseFile(PVIDEORECSTREAM pStream);
 static void videoRecStreamLock(PVIDEORECSTREAM pStream);
@@ -206,6 +217,13 @@ typedef struct VIDEORECSTREAM
         VIDEORECVIDEOFRAME  Frame;
         bool                fHasVideoData;
 #endif
+        /** First row of the RGB buffer which changed since the last conversion. */
+        uint32_t            uDirtyYStart;
+        /** Row after the last one which changed since the last conversion.
+         *  Nothing changed if this is not bigger than uDirtyYStart. */
+        uint32_t            uDirtyYEnd;
+        /** Time stamp (in ms) of the last frame actually handed to the encoder. */
+        uint64_t            uLastEncodedMs;
         /** Number of failed attempts to encode the current video frame in a row. */
         uint16_t            cFailedEncodingFrames;
     } Video;
@@ -284,9 +302,8 @@ AssertCompileSize(VIDEORECBMPDIBHDR, 40);
  */
 class ColorConvBGRA32Iter
 {
-private:
-    enum { PIX_SIZE = 4 };
 public:
+    enum { PIX_SIZE = 4 };
     ColorConvBGRA32Iter(unsigned aWidth, unsigned aHeight, uint8_t *aBuf)
     {
         LogFlow(("width = %d height=%d aBuf=%lx\n", aWidth, aHeight, aBuf));
@@ -306,15 +323,27 @@ public:
         bool rc = false;
         if (mPos + PIX_SIZE <= mSize)
         {
-            *aRed   = mBuf[mPos + 2];
-            *aGreen = mBuf[mPos + 1];
-            *aBlue  = mBuf[mPos    ];
+            getPixel(&mBuf[mPos], aRed, aGreen, aBlue);
             mPos += PIX_SIZE;
             rc = true;
         }
         return rc;
     }
 
+    /**
+     * Convert the pixel at the given address to RGB, without any bounds checking.
+     * @param   pbPixel Pointer to the pixel
+     * @param   aRed    where to store the red value
+     * @param   aGreen  where to store the green value
+     * @param   aBlue   where to store the blue value
+     */
+    static void getPixel(const uint8_t *pbPixel, unsigned *aRed, unsigned *aGreen, unsigned *aBlue)
+    {
+        *aRed   = pbPixel[2];
+        *aGreen = pbPixel[1];
+        *aBlue  = pbPixel[0];
+    }
+
     /**
      * Skip forward by a certain number of pixels
      * @param aPixels  how many pixels to skip
@@ -338,9 +367,8 @@ private:
  */
 class ColorConvBGR24Iter
 {
-private:
-    enum { PIX_SIZE = 3 };
 public:
+    enum { PIX_SIZE = 3 };
     ColorConvBGR24Iter(unsigned aWidth, unsigned aHeight, uint8_t *aBuf)
     {
         mPos = 0;
@@ -359,15 +387,27 @@ public:
         bool rc = false;
         if (mPos + PIX_SIZE <= mSize)
         {
-            *aRed   = mBuf[mPos + 2];
-            *aGreen = mBuf[mPos + 1];
-            *aBlue  = mBuf[mPos    ];
+            getPixel(&mBuf[mPos], aRed, aGreen, aBlue);
             mPos += PIX_SIZE;
             rc = true;
         }
         return rc;
     }
 
+    /**
+     * Convert the pixel at the given address to RGB, without any bounds checking.
+     * @param   pbPixel Pointer to the pixel
+     * @param   aRed    where to store the red value
+     * @param   aGreen  where to store the green value
+     * @param   aBlue   where to store the blue value
+     */
+    static void getPixel(const uint8_t *pbPixel, unsigned *aRed, unsigned *aGreen, unsigned *aBlue)
+    {
+        *aRed   = pbPixel[2];
+        *aGreen = pbPixel[1];
+        *aBlue  = pbPixel[0];
+    }
+
     /**
      * Skip forward by a certain number of pixels
      * @param aPixels  how many pixels to skip
@@ -391,9 +431,8 @@ private:
  */
 class ColorConvBGR565Iter
 {
-private:
-    enum { PIX_SIZE = 2 };
 public:
+    enum { PIX_SIZE = 2 };
     ColorConvBGR565Iter(unsigned aWidth, unsigned aHeight, uint8_t *aBuf)
     {
         mPos = 0;
@@ -412,17 +451,29 @@ public:
         bool rc = false;
         if (mPos + PIX_SIZE <= mSize)
         {
-            unsigned uFull =  (((unsigned) mBuf[mPos + 1]) << 8)
-                             | ((unsigned) mBuf[mPos]);
-            *aRed   = (uFull >> 8) & ~7;
-            *aGreen = (uFull >> 3) & ~3 & 0xff;
-            *aBlue  = (uFull << 3) & ~7 & 0xff;
+            getPixel(&mBuf[mPos], aRed, aGreen, aBlue);
             mPos += PIX_SIZE;
             rc = true;
         }
         return rc;
     }
 
+    /**
+     * Convert the pixel at the given address to RGB, without any bounds checking.
+     * @param   pbPixel Pointer to the pixel
+     * @param   aRed    where to store the red value
+     * @param   aGreen  where to store the green value
+     * @param   aBlue   where to store the blue value
+     */
+    static void getPixel(const uint8_t *pbPixel, unsigned *aRed, unsigned *aGreen, unsigned *aBlue)
+    {
+        unsigned uFull =  (((unsigned) pbPixel[1]) << 8)
+                         | ((unsigned) pbPixel[0]);
+        *aRed   = (uFull >> 8) & ~7;
+        *aGreen = (uFull >> 3) & ~3 & 0xff;
+        *aBlue  = (uFull << 3) & ~7 & 0xff;
+    }
+
     /**
      * Skip forward by a certain number of pixels
      * @param aPixels  how many pixels to skip
@@ -441,7 +492,171 @@ private:
 };
 
 /**
- * Convert an image to YUV420p format.
+ * Calculates the luma (Y) value of a pixel.
+ */
+DECLINLINE(uint8_t) colorConvRGBToY(unsigned uRed, unsigned uGreen, unsigned uBlue)
+{
+    return (uint8_t)(((66 * uRed + 129 * uGreen + 25 * uBlue + 128) >> 8) + 16);
+}
+
+/**
+ * Calculates a quarter of the blue difference (U) value of a pixel.
+ * The U value of a 2x2 block is the sum of those of its four pixels.
+ */
+DECLINLINE(int) colorConvRGBToQuarterU(int iRed, int iGreen, int iBlue)
+{
+    return (((-38 * iRed - 74 * iGreen + 112 * iBlue + 128) >> 8) + 128) / 4;
+}
+
+/**
+ * Calculates a quarter of the red difference (V) value of a pixel.
+ * The V value of a 2x2 block is the sum of those of its four pixels.
+ */
+DECLINLINE(int) colorConvRGBToQuarterV(int iRed, int iGreen, int iBlue)
+{
+    return (((112 * iRed - 94 * iGreen - 18 * iBlue + 128) >> 8) + 128) / 4;
+}
+
+/**
+ * Converts a pair of source rows to YUV420p, i.e. to two rows of Y and one
+ * row each of U and V samples.
+ *
+ * @param  pbSrc1               The first source row.
+ * @param  pbSrc2               The second source row.
+ * @param  pbY1                 Where to store the Y values of the first row.
+ * @param  pbY2                 Where to store the Y values of the second row.
+ * @param  pbU                  Where to store the U samples.
+ * @param  pbV                  Where to store the V samples.
+ * @param  iFirst               The first 2x2 block to convert.
+ * @param  cBlocks              Number of 2x2 blocks in the rows (half the width).
+ */
+template <class T>
+inline void colorConvRowPairYUV420pGeneric(const uint8_t *pbSrc1, const uint8_t *pbSrc2,
+                                           uint8_t *pbY1, uint8_t *pbY2, uint8_t *pbU, uint8_t *pbV,
+                                           unsigned iFirst, unsigned cBlocks)
+{
+    for (unsigned j = iFirst; j < cBlocks; ++j)
+    {
+        unsigned red, green, blue;
+        T::getPixel(&pbSrc1[(2 * j) * T::PIX_SIZE], &red, &green, &blue);
+        pbY1[2 * j] = colorConvRGBToY(red, green, blue);
+        int u = colorConvRGBToQuarterU(red, green, blue);
+        int v = colorConvRGBToQuarterV(red, green, blue);
+
+        T::getPixel(&pbSrc1[(2 * j + 1) * T::PIX_SIZE], &red, &green, &blue);
+        pbY1[2 * j + 1] = colorConvRGBToY(red, green, blue);
+        u += colorConvRGBToQuarterU(red, green, blue);
+        v += colorConvRGBToQuarterV(red, green, blue);
+
+        T::getPixel(&pbSrc2[(2 * j) * T::PIX_SIZE], &red, &green, &blue);
+        pbY2[2 * j] = colorConvRGBToY(red, green, blue);
+        u += colorConvRGBToQuarterU(red, green, blue);
+        v += colorConvRGBToQuarterV(red, green, blue);
+
+        T::getPixel(&pbSrc2[(2 * j + 1) * T::PIX_SIZE], &red, &green, &blue);
+        pbY2[2 * j + 1] = colorConvRGBToY(red, green, blue);
+        u += colorConvRGBToQuarterU(red, green, blue);
+        v += colorConvRGBToQuarterV(red, green, blue);
+
+        pbU[j] = (uint8_t)u;
+        pbV[j] = (uint8_t)v;
+    }
+}
+
+/**
+ * Converts a pair of source rows to YUV420p.
+ *
+ * The default is the generic per-pixel code, formats with a vectorized
+ * version specialize this.
+ */
+template <class T>
+inline void colorConvRowPairYUV420p(const uint8_t *pbSrc1, const uint8_t *pbSrc2,
+                                    uint8_t *pbY1, uint8_t *pbY2, uint8_t *pbU, uint8_t *pbV, unsigned cBlocks)
+{
+    colorConvRowPairYUV420pGeneric<T>(pbSrc1, pbSrc2, pbY1, pbY2, pbU, pbV, 0, cBlocks);
+}
+
+#ifdef RT_ARCH_AMD64
+/**
+ * Converts eight BGRA32 pixels to Y values and adds their quarter U and V
+ * values to the given per-pixel sums.
+ */
+DECLINLINE(void) colorConvBGRA32x8SSE2(const uint8_t *pbSrc, uint8_t *pbY, __m128i *puSumU, __m128i *puSumV)
+{
+    __m128i const fMaskByte = _mm_set1_epi32(0xff);
+    __m128i const u128      = _mm_set1_epi16(128);
+
+    __m128i const uPixels0 = _mm_loadu_si128((const __m128i *)pbSrc);
+    __m128i const uPixels1 = _mm_loadu_si128((const __m128i *)(pbSrc + 16));
+
+    /* Spread the channels over 16-bit lanes, the alpha channel is ignored. */
+    __m128i const uBlue  = _mm_packs_epi32(_mm_and_si128(uPixels0, fMaskByte),
+                                           _mm_and_si128(uPixels1, fMaskByte));
+    __m128i const uGreen = _mm_packs_epi32(_mm_and_si128(_mm_srli_epi32(uPixels0, 8), fMaskByte),
+                                           _mm_and_si128(_mm_srli_epi32(uPixels1, 8), fMaskByte));
+    __m128i const uRed   = _mm_packs_epi32(_mm_and_si128(_mm_srli_epi32(uPixels0, 16), fMaskByte),
+                                           _mm_and_si128(_mm_srli_epi32(uPixels1, 16), fMaskByte));
+
+    /* Y: the sum fits into an unsigned 16-bit lane. */
+    __m128i uY = _mm_add_epi16(_mm_add_epi16(_mm_mullo_epi16(uRed,   _mm_set1_epi16(66)),
+                                             _mm_mullo_epi16(uGreen, _mm_set1_epi16(129))),
+                               _mm_add_epi16(_mm_mullo_epi16(uBlue,  _mm_set1_epi16(25)), u128));
+    uY = _mm_add_epi16(_mm_srli_epi16(uY, 8), _mm_set1_epi16(16));
+    _mm_storel_epi64((__m128i *)pbY, _mm_packus_epi16(uY, uY));
+
+    /* U and V: the sums fit into a signed 16-bit lane. */
+    __m128i uU = _mm_add_epi16(_mm_add_epi16(_mm_mullo_epi16(uRed,   _mm_set1_epi16(-38)),
+                                             _mm_mullo_epi16(uGreen, _mm_set1_epi16(-74))),
+                               _mm_add_epi16(_mm_mullo_epi16(uBlue,  _mm_set1_epi16(112)), u128));
+    uU = _mm_srli_epi16(_mm_add_epi16(_mm_srai_epi16(uU, 8), u128), 2);
+    *puSumU = _mm_add_epi16(*puSumU, uU);
+
+    __m128i uV = _mm_add_epi16(_mm_add_epi16(_mm_mullo_epi16(uRed,   _mm_set1_epi16(112)),
+                                             _mm_mullo_epi16(uGreen, _mm_set1_epi16(-94))),
+                               _mm_add_epi16(_mm_mullo_epi16(uBlue,  _mm_set1_epi16(-18)), u128));
+    uV = _mm_srli_epi16(_mm_add_epi16(_mm_srai_epi16(uV, 8), u128), 2);
+    *puSumV = _mm_add_epi16(*puSumV, uV);
+}
+
+/**
+ * Adds up the horizontally neighbouring 16-bit sums and stores the four
+ * results as bytes.
+ */
+DECLINLINE(void) colorConvStoreChromaSSE2(__m128i uSum, uint8_t *pbDst)
+{
+    uSum = _mm_and_si128(_mm_add_epi16(uSum, _mm_srli_epi32(uSum, 16)), _mm_set1_epi32(0xffff));
+    uSum = _mm_packs_epi32(uSum, uSum);
+    uint32_t const u32 = (uint32_t)_mm_cvtsi128_si32(_mm_packus_epi16(uSum, uSum));
+    memcpy(pbDst, &u32, sizeof(u32));
+}
+
+/**
+ * BGRA32 version of colorConvRowPairYUV420p, doing four 2x2 blocks at a time
+ * using SSE2. The results are identical to the generic version.
+ */
+template <>
+inline void colorConvRowPairYUV420p<ColorConvBGRA32Iter>(const uint8_t *pbSrc1, const uint8_t *pbSrc2,
+                                                         uint8_t *pbY1, uint8_t *pbY2, uint8_t *pbU, uint8_t *pbV,
+                                                         unsigned cBlocks)
+{
+    unsigned j = 0;
+    for (; j + 4 <= cBlocks; j += 4)
+    {
+        __m128i uSumU = _mm_setzero_si128();
+        __m128i uSumV = _mm_setzero_si128();
+        colorConvBGRA32x8SSE2(&pbSrc1[j * 8], &pbY1[j * 2], &uSumU, &uSumV);
+        colorConvBGRA32x8SSE2(&pbSrc2[j * 8], &pbY2[j * 2], &uSumU, &uSumV);
+        colorConvStoreChromaSSE2(uSumU, &pbU[j]);
+        colorConvStoreChromaSSE2(uSumV, &pbV[j]);
+    }
+
+    /* The remainder, if any. */
+    colorConvRowPairYUV420pGeneric<ColorConvBGRA32Iter>(pbSrc1, pbSrc2, pbY1, pbY2, pbU, pbV, j, cBlocks);
+}
+#endif /* RT_ARCH_AMD64 */
+
+/**
+ * Convert (part of) an image to YUV420p format.
  *
  * @return true on success, false on failure.
  * @param  aDstBuf              The destination image buffer.
@@ -450,65 +665,33 @@ private:
  * @param  aSrcBuf              The source image buffer.
  * @param  aSrcWidth            Width (in pixel) of source buffer.
  * @param  aSrcHeight           Height (in pixel) of source buffer.
+ * @param  aYStart              First row to convert, must be even.
+ * @param  aYEnd                Row after the last one to convert, must be even.
  */
 template <class T>
 inline bool colorConvWriteYUV420p(uint8_t *aDstBuf, unsigned aDstWidth, unsigned aDstHeight,
-                                  uint8_t *aSrcBuf, unsigned aSrcWidth, unsigned aSrcHeight)
+                                  uint8_t *aSrcBuf, unsigned aSrcWidth, unsigned aSrcHeight,
+                                  unsigned aYStart, unsigned aYEnd)
 {
     RT_NOREF(aDstWidth, aDstHeight);
 
     AssertReturn(!(aSrcWidth & 1),  false);
     AssertReturn(!(aSrcHeight & 1), false);
-
-    bool fRc = true;
-    T iter1(aSrcWidth, aSrcHeight, aSrcBuf);
-    T iter2 = iter1;
-    iter2.skip(aSrcWidth);
-    unsigned cPixels = aSrcWidth * aSrcHeight;
-    unsigned offY = 0;
-    unsigned offU = cPixels;
-    unsigned offV = cPixels + cPixels / 4;
-    unsigned const cyHalf = aSrcHeight / 2;
-    unsigned const cxHalf = aSrcWidth  / 2;
-    for (unsigned i = 0; i < cyHalf && fRc; ++i)
+    AssertReturn(!(aYStart & 1),    false);
+    AssertReturn(!(aYEnd & 1),      false);
+    AssertReturn(aYEnd <= aSrcHeight, false);
+
+    size_t const cPixels = (size_t)aSrcWidth * aSrcHeight;
+    size_t const cbLine  = (size_t)aSrcWidth * T::PIX_SIZE;
+    unsigned const cxHalf = aSrcWidth / 2;
+    uint8_t *pbU = &aDstBuf[cPixels];
+    uint8_t *pbV = &aDstBuf[cPixels + cPixels / 4];
+    for (unsigned y = aYStart; y < aYEnd; y += 2)
     {
-        for (unsigned j = 0; j < cxHalf; ++j)
-        {
-            unsigned red, green, blue;
-            fRc = iter1.getRGB(&red, &green, &blue);
-            AssertReturn(fRc, false);
-            aDstBuf[offY] = ((66 * red + 129 * green + 25 * blue + 128) >> 8) + 16;
-            unsigned u = (((-38 * red - 74 * green + 112 * blue + 128) >> 8) + 128) / 4;
-            unsigned v = (((112 * red - 94 * green -  18 * blue + 128) >> 8) + 128) / 4;
-
-            fRc = iter1.getRGB(&red, &green, &blue);
-            AssertReturn(fRc, false);
-            aDstBuf[offY + 1] = ((66 * red + 129 * green + 25 * blue + 128) >> 8) + 16;
-            u += (((-38 * red - 74 * green + 112 * blue + 128) >> 8) + 128) / 4;
-            v += (((112 * red - 94 * green -  18 * blue + 128) >> 8) + 128) / 4;
-
-            fRc = iter2.getRGB(&red, &green, &blue);
-            AssertReturn(fRc, false);
-            aDstBuf[offY + aSrcWidth] = ((66 * red + 129 * green + 25 * blue + 128) >> 8) + 16;
-            u += (((-38 * red - 74 * green + 112 * blue + 128) >> 8) + 128) / 4;
-            v += (((112 * red - 94 * green -  18 * blue + 128) >> 8) + 128) / 4;
-
-            fRc = iter2.getRGB(&red, &green, &blue);
-            AssertReturn(fRc, false);
-            aDstBuf[offY + aSrcWidth + 1] = ((66 * red + 129 * green + 25 * blue + 128) >> 8) + 16;
-            u += (((-38 * red - 74 * green + 112 * blue + 128) >> 8) + 128) / 4;
-            v += (((112 * red - 94 * green -  18 * blue + 128) >> 8) + 128) / 4;
-
-            aDstBuf[offU] = u;
-            aDstBuf[offV] = v;
-            offY += 2;
-            ++offU;
-            ++offV;
-        }
-
-        iter1.skip(aSrcWidth);
-        iter2.skip(aSrcWidth);
-        offY += aSrcWidth;
+        const uint8_t *pbSrc = &aSrcBuf[y * cbLine];
+        uint8_t       *pbY   = &aDstBuf[(size_t)y * aSrcWidth];
+        size_t const   offUV = (size_t)(y / 2) * cxHalf;
+        colorConvRowPairYUV420p<T>(pbSrc, pbSrc + cbLine, pbY, pbY + aSrcWidth, &pbU[offUV], &pbV[offUV], cxHalf);
     }
 
     return true;
@@ -612,13 +795,31 @@ static DECLCALLBACK(int) videoRecThread(RTTHREAD hThreadSelf, void *pvUser)
 
             if (fEncodeVideo)
             {
-                rc = videoRecRGBToYUV(pVideoFrame->uPixelFormat,
-                                      /* Destination */
-                                      pStream->Video.pu8YuvBuf, pVideoFrame->uWidth, pVideoFrame->uHeight,
-                                      /* Source */
-                                      pVideoFrame->pu8RGBBuf, pStream->Video.uWidth, pStream->Video.uHeight);
-                if (RT_SUCCESS(rc))
-                    rc = videoRecEncodeAndWrite(pStream, pVideoFrame);
+                /* Don't bother the encoder with frames which didn't change at all, but still
+                 * feed it every now and then so that the recording doesn't stall. */
+                const bool fChanged = pStream->Video.uDirtyYStart < pStream->Video.uDirtyYEnd;
+                if (   fChanged
+                    || pVideoFrame->uTimeStampMs - pStream->Video.uLastEncodedMs >= VIDEOREC_IDLE_FRAME_MS)
+                {
+                    /* Only the changed rows need converting, the YUV buffer still holds the rest. */
+                    rc = VINF_SUCCESS;
+                    if (fChanged)
+                    {
+                        rc = videoRecRGBToYUV(pVideoFrame->uPixelFormat,
+                                              /* Destination */
+                                              pStream->Video.pu8YuvBuf, pVideoFrame->uWidth, pVideoFrame->uHeight,
+                                              /* Source */
+                                              pVideoFrame->pu8RGBBuf, pStream->Video.uWidth, pStream->Video.uHeight,
+                                              pStream->Video.uDirtyYStart & ~1U,
+                                              RT_MIN(RT_ALIGN_32(pStream->Video.uDirtyYEnd, 2), pStream->Video.uHeight));
+                        pStream->Video.uDirtyYStart = pStream->Video.uDirtyYEnd = 0;
+                    }
+                    if (RT_SUCCESS(rc))
+                    {
+                        rc = videoRecEncodeAndWrite(pStream, pVideoFrame);
+                        pStream->Video.uLastEncodedMs = pVideoFrame->uTimeStampMs;
+                    }
+                }
 
                 pStream->Video.fHasVideoData = false;
             }
@@ -1050,6 +1251,10 @@ int VideoRecStreamInit(PVIDEORECCONTEXT pCtx, uint32_t uScreen)
     pStream->Video.uWidth                = pCfg->Video.uWidth;
     pStream->Video.uHeight               = pCfg->Video.uHeight;
     pStream->Video.cFailedEncodingFrames = 0;
+    /* The first frame needs converting in full. */
+    pStream->Video.uDirtyYStart          = 0;
+    pStream->Video.uDirtyYEnd            = pStream->Video.uHeight;
+    pStream->Video.uLastEncodedMs        = 0;
 
 #ifndef VBOX_VIDEOREC_WITH_QUEUE
     /* When not using a queue, we only use one frame per stream at once.
@@ -1170,8 +1375,8 @@ int VideoRecStreamInit(PVIDEORECCONTEXT pCtx, uint32_t uScreen)
     /* 1ms per frame. */
     pVC->VPX.Cfg.g_timebase.num = 1;
     pVC->VPX.Cfg.g_timebase.den = 1000;
-    /* Disable multithreading. */
-    pVC->VPX.Cfg.g_threads = 0;
+    /* Let the encoder use up to half of the host CPUs, the VM needs the rest. */
+    pVC->VPX.Cfg.g_threads = RT_MIN(RT_MAX(RTMpGetOnlineCount() / 2, 1), 8);
 
     /* Initialize codec. */
     rcv = vpx_codec_enc_init(&pVC->VPX.Ctx, DEFAULTCODEC, &pVC->VPX.Cfg, 0);
@@ -1181,6 +1386,18 @@ int VideoRecStreamInit(PVIDEORECCONTEXT pCtx, uint32_t uScreen)
         return VERR_INVALID_PARAMETER;
     }
 
+    /* VP8 can only encode the token partitions of a frame in parallel, so have one per thread
+     * (the control takes the log2 of the count, which is limited to 8). */
+    int iTokenPartitions = 0;
+    while (   (2U << iTokenPartitions) <= pVC->VPX.Cfg.g_threads
+           && iTokenPartitions < 3)
+        iTokenPartitions++;
+    rcv = vpx_codec_control(&pVC->VPX.Ctx, VP8E_SET_TOKEN_PARTITIONS, iTokenPartitions);
+    if (rcv != VPX_CODEC_OK)
+        LogRel(("VideoRec: Failed to set VP8 token partitions: %s\n", vpx_codec_err_to_string(rcv)));
+
+    LogRel2(("VideoRec: Using %u encoder thread(s)\n", pVC->VPX.Cfg.g_threads));
+
     if (!vpx_img_alloc(&pVC->VPX.RawImage, VPX_IMG_FMT_I420, pCfg->Video.uWidth, pCfg->Video.uHeight, 1))
     {
         LogRel(("VideoRec: Failed to allocate image %RU32x%RU32\n", pCfg->Video.uWidth, pCfg->Video.uHeight));
@@ -1381,30 +1598,39 @@ static int videoRecEncodeAndWrite(PVIDEORECSTREAM pStream, PVIDEORECVIDEOFRAME p
 }
 
 /**
- * Converts a RGB to YUV buffer.
+ * Converts (part of) a RGB to YUV buffer.
  *
  * @returns IPRT status code.
- * TODO
+ * @param   uPixelFormat        Pixel format of the source buffer (VIDEORECPIXELFMT_XXX).
+ * @param   paDst               The YUV420p destination buffer.
+ * @param   uDstWidth           Width (in pixel) of destination buffer.
+ * @param   uDstHeight          Height (in pixel) of destination buffer.
+ * @param   paSrc               The RGB source buffer.
+ * @param   uSrcWidth           Width (in pixel) of source buffer.
+ * @param   uSrcHeight          Height (in pixel) of source buffer.
+ * @param   uYStart             First row to convert, must be even.
+ * @param   uYEnd               Row after the last one to convert, must be even.
  */
 static int videoRecRGBToYUV(uint32_t uPixelFormat,
                             uint8_t *paDst, uint32_t uDstWidth, uint32_t uDstHeight,
-                            uint8_t *paSrc, uint32_t uSrcWidth, uint32_t uSrcHeight)
+                            uint8_t *paSrc, uint32_t uSrcWidth, uint32_t uSrcHeight,
+                            uint32_t uYStart, uint32_t uYEnd)
 {
     switch (uPixelFormat)
     {
         case VIDEORECPIXELFMT_RGB32:
             if (!colorConvWriteYUV420p<ColorConvBGRA32Iter>(paDst, uDstWidth, uDstHeight,
-                                                            paSrc, uSrcWidth, uSrcHeight))
+                                                            paSrc, uSrcWidth, uSrcHeight, uYStart, uYEnd))
                 return VERR_INVALID_PARAMETER;
             break;
         case VIDEORECPIXELFMT_RGB24:
             if (!colorConvWriteYUV420p<ColorConvBGR24Iter>(paDst, uDstWidth, uDstHeight,
-                                                           paSrc, uSrcWidth, uSrcHeight))
+                                                           paSrc, uSrcWidth, uSrcHeight, uYStart, uYEnd))
                 return VERR_INVALID_PARAMETER;
             break;
         case VIDEORECPIXELFMT_RGB565:
             if (!colorConvWriteYUV420p<ColorConvBGR565Iter>(paDst, uDstWidth, uDstHeight,
-                                                            paSrc, uSrcWidth, uSrcHeight))
+                                                            paSrc, uSrcWidth, uSrcHeight, uYStart, uYEnd))
                 return VERR_INVALID_PARAMETER;
             break;
         default:
@@ -1566,6 +1792,8 @@ int VideoRecSendVideoFrame(PVIDEORECCONTEXT pCtx, uint32_t uScreen, uint32_t x,
 #else
         PVIDEORECVIDEOFRAME pFrame = &pStream->Video.Frame;
 #endif
+        const uint32_t uPixelFormatOld = pFrame->uPixelFormat;
+
         /* Calculate bytes per pixel and set pixel format. */
         const unsigned uBytesPerPixel = uBPP / 8;
         if (uPixelFormat == BitmapFormat_BGR)
@@ -1600,8 +1828,26 @@ int VideoRecSendVideoFrame(PVIDEORECCONTEXT pCtx, uint32_t uScreen, uint32_t x,
         {
             /** @todo r=andy Only clear dirty areas. */
             RT_BZERO(pFrame->pu8RGBBuf, pFrame->cbRGBBuf);
+            pStream->Video.uDirtyYStart = 0;
+            pStream->Video.uDirtyYEnd   = pStream->Video.uHeight;
         }
 #endif
+        /* The buffer content means something else now, so everything needs converting. */
+        if (pFrame->uPixelFormat != uPixelFormatOld)
+        {
+            pStream->Video.uDirtyYStart = 0;
+            pStream->Video.uDirtyYEnd   = pStream->Video.uHeight;
+        }
+
+        /* Rows which did not change since the last frame need no copying, and more
+         * importantly no conversion, so keep track of the ones which did. */
+        uint32_t uDirtyYStart = pStream->Video.uDirtyYStart;
+        uint32_t uDirtyYEnd   = pStream->Video.uDirtyYEnd;
+        if (uDirtyYStart >= uDirtyYEnd)
+        {
+            uDirtyYStart = UINT32_MAX;
+            uDirtyYEnd   = 0;
+        }
         /* Calculate start offset in source and destination buffers. */
         uint32_t offSrc = y * uBytesPerLine + x * uBytesPerPixel;
         uint32_t offDst = (destY * pStream->Video.uWidth + destX) * uBytesPerPixel;
@@ -1643,7 +1889,12 @@ int VideoRecSendVideoFrame(PVIDEORECCONTEXT pCtx, uint32_t uScreen, uint32_t x,
             Assert(offSrc + w * uBytesPerPixel <= uSrcHeight * uBytesPerLine);
             Assert(offDst + w * uBytesPerPixel <= pStream->Video.uHeight * pStream->Video.uWidth * uBytesPerPixel);
 
-            memcpy(pFrame->pu8RGBBuf + offDst, puSrcData + offSrc, w * uBytesPerPixel);
+            if (memcmp(pFrame->pu8RGBBuf + offDst, puSrcData + offSrc, w * uBytesPerPixel))
+            {
+                memcpy(pFrame->pu8RGBBuf + offDst, puSrcData + offSrc, w * uBytesPerPixel);
+                uDirtyYStart = RT_MIN(uDirtyYStart, destY + i);
+                uDirtyYEnd   = RT_MAX(uDirtyYEnd,   destY + i + 1);
+            }
 
 #ifdef VBOX_VIDEOREC_DUMP
             if (RT_SUCCESS(rc2))
@@ -1661,6 +1912,12 @@ int VideoRecSendVideoFrame(PVIDEORECCONTEXT pCtx, uint32_t uScreen, uint32_t x,
         pFrame->uWidth       = uSrcWidth;
         pFrame->uHeight      = uSrcHeight;
 
+        if (uDirtyYStart < uDirtyYEnd)
+        {
+            pStream->Video.uDirtyYStart = uDirtyYStart;
+            pStream->Video.uDirtyYEnd   = uDirtyYEnd;
+        }
+
         pStream->Video.fHasVideoData = true;
 
     } while (0);
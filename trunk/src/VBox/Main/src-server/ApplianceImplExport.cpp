@@ -2191,12 +2191,9 @@ HRESULT Appliance::i_writeFSOPC(TaskOVF *pTask, AutoWriteLockBase &writeLock)
         if (RT_SUCCESS(vrc))
         {
             RTVFSIOSTREAM hVfsIosGzip = NIL_RTVFSIOSTREAM;
-            vrc = RTZipGzipCompressIoStream(hVfsIosFile, 0 /*fFlags*/, 6 /*uLevel*/, &hVfsIosGzip);
+            vrc = RTZipGzipCompressIoStream(hVfsIosFile, RTZIPGZIPCOMP_F_PARALLEL, 6 /*uLevel*/, &hVfsIosGzip);
             RTVfsIoStrmRelease(hVfsIosFile);
 
-            /** @todo insert I/O thread here between gzip and the tar creator. Needs
-             *        implementing. */
-
             RTVFSFSSTREAM hVfsFssTar = NIL_RTVFSFSSTREAM;
             if (RT_SUCCESS(vrc))
                 vrc = RTZipTarFsStreamToIoStream(hVfsIosGzip, RTZIPTARFORMAT_GNU, RTZIPTAR_C_SPARSE, &hVfsFssTar);
@@ -19,12 +19,14 @@
 #include <iprt/path.h>
 #include <iprt/dir.h>
 #include <iprt/file.h>
+#include <iprt/mem.h>
 #include <iprt/s3.h>
 #include <iprt/sha.h>
 #include <iprt/manifest.h>
 #include <iprt/tar.h>
 #include <iprt/zip.h>
 #include <iprt/stream.h>
+#include <iprt/time.h>
 #include <iprt/crypto/digest.h>
 #include <iprt/crypto/pkix.h>
 #include <iprt/crypto/store.h>
@@ -894,6 +896,22 @@ RTVFSIOSTREAM Appliance::i_importOpenSourceFile(ImportStack &stack, Utf8Str cons
             throw setErrorVrc(vrc, tr("Error opening '%s' for reading (%Rrc)"), rstrSrcPath.c_str(), vrc);
     }
 
+    /*
+     * When digesting, read ahead on a separate thread so the hashing done by
+     * the pass thru below (on the caller's read ahead thread) doesn't stall
+     * the source reads.
+     */
+    if (m->fDigestTypes)
+    {
+        RTVFSIOSTREAM hVfsIosReadAhead;
+        int vrc = RTVfsCreateReadAheadForIoStream(hVfsIosSrc, 0 /*fFlags*/, 0 /*cBuffers=default*/, 0 /*cbBuffers=default*/,
+                                                  &hVfsIosReadAhead);
+        RTVfsIoStrmRelease(hVfsIosSrc);
+        if (RT_FAILURE(vrc))
+            throw setErrorVrc(vrc, tr("Error initializing read ahead thread for '%s' (%Rrc)"), rstrSrcPath.c_str(), vrc);
+        hVfsIosSrc = hVfsIosReadAhead;
+    }
+
     /*
      * Digest calculation filtering.
      */
@@ -910,16 +928,27 @@ RTVFSIOSTREAM Appliance::i_importOpenSourceFile(ImportStack &stack, Utf8Str cons
  * This assumes that we digest the source when fDigestTypes is non-zero, and
  * thus calls RTManifestPtIosAddEntryNow when done.
  *
+ * The throughput is reported in the operation description of the import
+ * progress about once a second.  When the source is decompressed on the fly,
+ * the rate the compressed input is consumed at is reported as well.
+ *
+ * @param   stack           Import stack.
  * @param   rstrDstPath     The path to the destination file.  Missing path
  *                          components will be created.
  * @param   hVfsIosSrc      The source I/O stream.
  * @param   rstrSrcLogNm    The name of the source for logging and error
  *                          messages.
+ * @param   hVfsIosIn       The read ahead stream with the compressed input
+ *                          feeding @a hVfsIosSrc, only used for reporting.
+ *                          Another thread reads from it, so we only query
+ *                          its consumed byte count.  NIL_RTVFSIOSTREAM if
+ *                          the source isn't compressed.
  * @returns COM status code.
  * @throws Nothing (as the caller has VFS handles to release).
  */
-HRESULT Appliance::i_importCreateAndWriteDestinationFile(Utf8Str const &rstrDstPath, RTVFSIOSTREAM hVfsIosSrc,
-                                                         Utf8Str const &rstrSrcLogNm)
+HRESULT Appliance::i_importCreateAndWriteDestinationFile(ImportStack &stack, Utf8Str const &rstrDstPath,
+                                                         RTVFSIOSTREAM hVfsIosSrc, Utf8Str const &rstrSrcLogNm,
+                                                         RTVFSIOSTREAM hVfsIosIn)
 {
     int vrc;
 
@@ -939,7 +968,66 @@ HRESULT Appliance::i_importCreateAndWriteDestinationFile(Utf8Str const &rstrDstP
             /*
              * Pump the bytes thru. If we fail, delete the output file.
              */
-            vrc = RTVfsUtilPumpIoStreams(hVfsIosSrc, hVfsIosDst, 0);
+            Bstr bstrOpDesc;
+            if (!stack.pProgress.isNull())
+                stack.pProgress->COMGETTER(OperationDescription)(bstrOpDesc.asOutParam());
+            Utf8Str const strOpDesc(bstrOpDesc);
+
+            size_t const cbBuf = _128K;
+            void *pvBuf = RTMemTmpAlloc(cbBuf);
+            if (pvBuf)
+            {
+                uint64_t const nsStart      = RTTimeNanoTS();
+                uint64_t       nsLastReport = nsStart;
+                uint64_t       cbWritten    = 0;
+                for (;;)
+                {
+                    size_t cbRead;
+                    vrc = RTVfsIoStrmRead(hVfsIosSrc, pvBuf, cbBuf, true /*fBlocking*/, &cbRead);
+                    if (RT_FAILURE(vrc))
+                        break;
+                    if (vrc == VINF_EOF && cbRead == 0)
+                        break;
+
+                    vrc = RTVfsIoStrmWrite(hVfsIosDst, pvBuf, cbRead, true /*fBlocking*/, NULL /*cbWritten*/);
+                    if (RT_FAILURE(vrc))
+                        break;
+                    cbWritten += cbRead;
+
+                    uint64_t const nsNow = RTTimeNanoTS();
+                    if (   nsNow - nsLastReport >= RT_NS_1SEC
+                        && !stack.pProgress.isNull())
+                    {
+                        nsLastReport = nsNow;
+                        uint64_t const cMsElapsed = RT_MAX((nsNow - nsStart) / RT_NS_1MS, 1);
+                        uint64_t       cbIn       = 0;
+                        if (   hVfsIosIn != NIL_RTVFSIOSTREAM
+                            && RT_SUCCESS(RTVfsReadAheadQueryConsumed(hVfsIosIn, &cbIn)))
+                            stack.pProgress->i_setOperationDescription(
+                                Utf8StrFmt(tr("%s (read %RU64 KB/s, written %RU64 KB/s)"), strOpDesc.c_str(),
+                                           cbIn * RT_MS_1SEC / cMsElapsed / _1K,
+                                           cbWritten * RT_MS_1SEC / cMsElapsed / _1K));
+                        else
+                            stack.pProgress->i_setOperationDescription(
+                                Utf8StrFmt(tr("%s (%RU64 KB/s)"), strOpDesc.c_str(), cbWritten * RT_MS_1SEC / cMsElapsed / _1K));
+                    }
+                }
+                RTMemTmpFree(pvBuf);
+
+                /* Flush the destination to catch errors caused by buffering delays. */
+                if (RT_SUCCESS(vrc))
+                    vrc = RTVfsIoStrmFlush(hVfsIosDst);
+
+                uint64_t const cMsElapsed = RT_MAX((RTTimeNanoTS() - nsStart) / RT_NS_1MS, 1);
+                LogRel(("Appliance: Wrote %RU64 bytes from '%s' to '%s' in %RU64 ms (%RU64 KB/s), rc=%Rrc\n",
+                        cbWritten, rstrSrcLogNm.c_str(), rstrDstPath.c_str(), cMsElapsed,
+                        cbWritten * RT_MS_1SEC / cMsElapsed / _1K, vrc));
+                if (!stack.pProgress.isNull())
+                    stack.pProgress->i_setOperationDescription(strOpDesc);
+            }
+            else
+                vrc = VERR_NO_TMP_MEMORY;
+
             if (RT_SUCCESS(vrc))
                 hrc = S_OK;
             else
@@ -987,7 +1075,7 @@ void Appliance::i_importCopyFile(ImportStack &stack, Utf8Str const &rstrSrcPath,
     /*
      * Write the destination file (nothrow).
      */
-    HRESULT hrc = i_importCreateAndWriteDestinationFile(rstrDstPath, hVfsIosReadAhead, rstrSrcPath);
+    HRESULT hrc = i_importCreateAndWriteDestinationFile(stack, rstrDstPath, hVfsIosReadAhead, rstrSrcPath);
     RTVfsIoStrmRelease(hVfsIosReadAhead);
 
     /*
@@ -1024,8 +1112,9 @@ void Appliance::i_importDecompressFile(ImportStack &stack, Utf8Str const &rstrSr
     RTVFSIOSTREAM hVfsIosSrcCompressed = i_importOpenSourceFile(stack, rstrSrcPath, pszManifestEntry);
 
     /*
-     * Add a read ahead thread here.  This means reading and digest calculation
-     * is done on one thread, while unpacking and writing is one on this thread.
+     * Add a read ahead thread here.  This means digest calculation is done on
+     * one thread (the source reads on another, see i_importOpenSourceFile),
+     * while unpacking and writing are done on two more below.
      */
     RTVFSIOSTREAM hVfsIosReadAhead;
     int vrc = RTVfsCreateReadAheadForIoStream(hVfsIosSrcCompressed, 0 /*fFlags*/, 0 /*cBuffers=default*/,
@@ -1037,21 +1126,35 @@ void Appliance::i_importDecompressFile(ImportStack &stack, Utf8Str const &rstrSr
     }
 
     /*
-     * Add decompression step.
+     * Add decompression step, on a read ahead thread of its own so inflating
+     * overlaps with writing the destination.  We keep our reference to the
+     * compressed read ahead stream for reporting the input rate.
      */
-    RTVFSIOSTREAM hVfsIosSrc;
-    vrc = RTZipGzipDecompressIoStream(hVfsIosReadAhead, 0, &hVfsIosSrc);
-    RTVfsIoStrmRelease(hVfsIosReadAhead);
+    RTVFSIOSTREAM hVfsIosInflate;
+    vrc = RTZipGzipDecompressIoStream(hVfsIosReadAhead, 0, &hVfsIosInflate);
     if (RT_FAILURE(vrc))
     {
+        RTVfsIoStrmRelease(hVfsIosReadAhead);
         RTVfsIoStrmRelease(hVfsIosSrcCompressed);
         throw setErrorVrc(vrc, tr("Error initializing gzip decompression for '%s' (%Rrc)"), rstrSrcPath.c_str(), vrc);
     }
 
+    RTVFSIOSTREAM hVfsIosSrc;
+    vrc = RTVfsCreateReadAheadForIoStream(hVfsIosInflate, 0 /*fFlags*/, 0 /*cBuffers=default*/,
+                                          0 /*cbBuffers=default*/, &hVfsIosSrc);
+    RTVfsIoStrmRelease(hVfsIosInflate);
+    if (RT_FAILURE(vrc))
+    {
+        RTVfsIoStrmRelease(hVfsIosReadAhead);
+        RTVfsIoStrmRelease(hVfsIosSrcCompressed);
+        throw setErrorVrc(vrc, tr("Error initializing read ahead thread for '%s' (%Rrc)"), rstrSrcPath.c_str(), vrc);
+    }
+
     /*
      * Write the stream to the destination file (nothrow).
      */
-    HRESULT hrc = i_importCreateAndWriteDestinationFile(rstrDstPath, hVfsIosSrc, rstrSrcPath);
+    HRESULT hrc = i_importCreateAndWriteDestinationFile(stack, rstrDstPath, hVfsIosSrc, rstrSrcPath, hVfsIosReadAhead);
+    RTVfsIoStrmRelease(hVfsIosReadAhead);
 
     /*
      * Before releasing the source stream, make sure we've successfully added
@@ -1256,7 +1359,7 @@ HRESULT Appliance::i_readFSOVA(TaskOVF *pTask)
         return setErrorVrc(vrc, tr("Error opening the OVA file '%s' (%Rrc)"), pTask->locInfo.strPath.c_str(), vrc);
 
     RTVFSFSSTREAM hVfsFssOva;
-    vrc = RTZipTarFsStreamFromIoStream(hVfsIosOva, 0 /*fFlags*/, &hVfsFssOva);
+    vrc = RTZipTarFsStreamFromIoStream(hVfsIosOva, RTZIPTAR_R_FILE_VIEWS, &hVfsFssOva);
     RTVfsIoStrmRelease(hVfsIosOva);
     if (RT_FAILURE(vrc))
         return setErrorVrc(vrc, tr("Error reading the OVA file '%s' (%Rrc)"), pTask->locInfo.strPath.c_str(), vrc);
@@ -2095,7 +2198,7 @@ HRESULT Appliance::i_importFSOVA(TaskOVF *pTask, AutoWriteLockBase &rWriteLock)
         return setErrorVrc(vrc, tr("Error opening the OVA file '%s' (%Rrc)"), pTask->locInfo.strPath.c_str(), vrc);
 
     RTVFSFSSTREAM hVfsFssOva;
-    vrc = RTZipTarFsStreamFromIoStream(hVfsIosOva, 0 /*fFlags*/, &hVfsFssOva);
+    vrc = RTZipTarFsStreamFromIoStream(hVfsIosOva, RTZIPTAR_R_FILE_VIEWS, &hVfsFssOva);
     RTVfsIoStrmRelease(hVfsIosOva);
     if (RT_FAILURE(vrc))
         return setErrorVrc(vrc, tr("Error reading the OVA file '%s' (%Rrc)"), pTask->locInfo.strPath.c_str(), vrc);
@@ -9063,6 +9063,7 @@ HRESULT Medium::i_taskMoveHandler(Medium::MoveTask &task)
     uint64_t size = 0; NOREF(size);
     uint64_t logicalSize = 0; NOREF(logicalSize);
     MediumVariant_T variant = MediumVariant_Standard; NOREF(variant);
+    Utf8Str strOldLocation;
 
     /*
      * it's exactly moving, not cloning
@@ -9172,6 +9173,7 @@ HRESULT Medium::i_taskMoveHandler(Medium::MoveTask &task)
                  * also reset moving flag
                  */
                 i_resetMoveOperationData();
+                strOldLocation = m->strLocationFull;
                 m->strLocationFull = targetLocation;
 
             }
@@ -9190,6 +9192,10 @@ HRESULT Medium::i_taskMoveHandler(Medium::MoveTask &task)
     // now, at the end of this task (always asynchronous), save the settings
     if (SUCCEEDED(mrc))
     {
+        // keep the media registry location index in sync
+        if (strOldLocation.isNotEmpty())
+            m->pVirtualBox->i_onMediumLocationChanged(this, strOldLocation);
+
         // save the settings
         i_markRegistriesModified();
         /* collect multiple errors */
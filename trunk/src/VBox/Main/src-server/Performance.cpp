@@ -1267,38 +1267,33 @@ void SubMetric::query(ULONG *data)
     copyTo(data);
 }
 
-void Metric::query(ULONG **data, ULONG *count, ULONG *sequenceNumber)
+/**
+ * Copies the samples of the metric into @a data, which must have room for
+ * getLength() values.  Aggregates are computed straight off the ring buffer
+ * as they do not depend on the order of the samples.
+ */
+void Metric::query(ULONG *data, ULONG *count, ULONG *sequenceNumber)
 {
-    ULONG length;
-    ULONG *tmpData;
-
-    length = mSubMetric->length();
+    ULONG length = mSubMetric->length();
     *sequenceNumber = mSubMetric->getSequenceNumber() - length;
     if (length)
     {
-        tmpData = (ULONG*)RTMemAlloc(sizeof(*tmpData)*length);
-        mSubMetric->query(tmpData);
         if (mAggregate)
         {
             *count = 1;
-            *data  = (ULONG*)RTMemAlloc(sizeof(**data));
-            **data = mAggregate->compute(tmpData, length);
-            RTMemFree(tmpData);
+            *data  = mAggregate->compute(mSubMetric->getRawData(), length);
         }
         else
         {
             *count = length;
-            *data  = tmpData;
+            mSubMetric->query(data);
         }
     }
     else
-    {
         *count = 0;
-        *data  = 0;
-    }
 }
 
-ULONG AggregateAvg::compute(ULONG *data, ULONG length)
+ULONG AggregateAvg::compute(const ULONG *data, ULONG length)
 {
     uint64_t tmp = 0;
     for (ULONG i = 0; i < length; ++i)
@@ -1311,7 +1306,7 @@ const char * AggregateAvg::getName()
     return "avg";
 }
 
-ULONG AggregateMin::compute(ULONG *data, ULONG length)
+ULONG AggregateMin::compute(const ULONG *data, ULONG length)
 {
     ULONG tmp = *data;
     for (ULONG i = 0; i < length; ++i)
@@ -1325,7 +1320,7 @@ const char * AggregateMin::getName()
     return "min";
 }
 
-ULONG AggregateMax::compute(ULONG *data, ULONG length)
+ULONG AggregateMax::compute(const ULONG *data, ULONG length)
 {
     ULONG tmp = *data;
     for (ULONG i = 0; i < length; ++i)
@@ -496,15 +496,14 @@ HRESULT PerformanceCollector::queryMetricsData(const std::vector<com::Utf8Str> &
     aReturnDataLengths.resize(numberOfMetrics);
     aReturnData.resize(flatSize);
 
+    AssertCompile(sizeof(LONG) == sizeof(ULONG));
     for (it = filteredMetrics.begin(); it != filteredMetrics.end(); ++it, ++i)
     {
-        ULONG *values, length, sequenceNumber;
-        /** @todo We may want to revise the query method to get rid of excessive alloc/memcpy calls. */
-        (*it)->query(&values, &length, &sequenceNumber);
+        ULONG length, sequenceNumber;
+        /* The samples go straight into the result, there is room for getLength() values left. */
+        (*it)->query(flatIndex < flatSize ? (ULONG *)&aReturnData[flatIndex] : NULL, &length, &sequenceNumber);
         LogFlow(("PerformanceCollector::QueryMetricsData() querying metric %s returned %d values.\n",
                  (*it)->getName(), length));
-        memcpy(&aReturnData[flatIndex], values, length * sizeof(*values));
-        RTMemFree(values);
         aReturnMetricNames[i] = (*it)->getName();
         aReturnObjects[i] = (*it)->getObject();
         aReturnUnits[i] = (*it)->getUnit();
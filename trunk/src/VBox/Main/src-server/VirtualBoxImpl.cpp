@@ -176,6 +176,8 @@ typedef ObjectsList<NATNetwork> NATNetworksOList;
 
 typedef std::map<Guid, ComPtr<IProgress> > ProgressMap;
 typedef std::map<Guid, ComObjPtr<Medium> > HardDiskMap;
+typedef std::map<Guid, ComObjPtr<Medium> > MediaMap;
+typedef std::map<Utf8Str, ComObjPtr<Medium> > MediaLocationMap;
 
 /**
  *  Main VirtualBox data structure.
@@ -262,6 +264,12 @@ struct VirtualBox::Data
     // and contains ALL hard disks (base and differencing); it is protected by
     // the same lock as the other media lists above
     HardDiskMap                         mapHardDisks;
+    // the same for DVD and floppy images, plus a map of all registered media
+    // keyed by their full location (see i_mediumLocationKey()); also protected
+    // by the media lists lock
+    MediaMap                            mapDVDImages,
+                                        mapFloppyImages;
+    MediaLocationMap                    mapMediaByLocation;
 
     // list of pending machine renames (also protected by media tree lock;
     // see VirtualBox::rememberMachineNameChangeForMedia())
@@ -3475,23 +3483,22 @@ HRESULT VirtualBox::i_findHardDiskByLocation(const Utf8Str &strLocation,
 {
     AssertReturn(!strLocation.isEmpty(), E_INVALIDARG);
 
-    // we use the hard disks map, but it is protected by the
+    // we use the location map, but it is protected by the
     // hard disk _list_ lock handle
     AutoReadLock alock(m->allHardDisks.getLockHandle() COMMA_LOCKVAL_SRC_POS);
 
-    for (HardDiskMap::const_iterator it = m->mapHardDisks.begin();
-         it != m->mapHardDisks.end();
-         ++it)
+    MediaLocationMap::const_iterator it = m->mapMediaByLocation.find(i_mediumLocationKey(strLocation));
+    if (it != m->mapMediaByLocation.end())
     {
         const ComObjPtr<Medium> &pHD = (*it).second;
 
         AutoCaller autoCaller(pHD);
         if (FAILED(autoCaller.rc())) return autoCaller.rc();
-        AutoWriteLock mlock(pHD COMMA_LOCKVAL_SRC_POS);
-
-        Utf8Str strLocationFull = pHD->i_getLocationFull();
+        AutoReadLock mlock(pHD COMMA_LOCKVAL_SRC_POS);
 
-        if (0 == RTPathCompare(strLocationFull.c_str(), strLocation.c_str()))
+        /* The key is only a normalized form, so do the real comparison too. */
+        if (   pHD->i_getDeviceType() == DeviceType_HardDisk
+            && 0 == RTPathCompare(pHD->i_getLocationFull().c_str(), strLocation.c_str()))
         {
             if (aHardDisk)
                 *aHardDisk = pHD;
@@ -3544,15 +3551,18 @@ HRESULT VirtualBox::i_findDVDOrFloppyImage(DeviceType_T mediumType,
     }
 
     MediaOList *pMediaList;
+    MediaMap   *pMediaMap;
 
     switch (mediumType)
     {
         case DeviceType_DVD:
             pMediaList = &m->allDVDImages;
+            pMediaMap  = &m->mapDVDImages;
         break;
 
         case DeviceType_Floppy:
             pMediaList = &m->allFloppyImages;
+            pMediaMap  = &m->mapFloppyImages;
         break;
 
         default:
@@ -3561,38 +3571,46 @@ HRESULT VirtualBox::i_findDVDOrFloppyImage(DeviceType_T mediumType,
 
     AutoReadLock alock(pMediaList->getLockHandle() COMMA_LOCKVAL_SRC_POS);
 
-    bool found = false;
+    /* Look up the candidates by ID and by location, the ID taking precedence. */
+    Medium *pMedium = NULL;
+    if (aId)
+    {
+        MediaMap::const_iterator it = pMediaMap->find(*aId);
+        if (it != pMediaMap->end())
+            pMedium = (*it).second;
+    }
+    if (!pMedium && !aLocation.isEmpty())
+    {
+        MediaLocationMap::const_iterator it = m->mapMediaByLocation.find(i_mediumLocationKey(location));
+        if (it != m->mapMediaByLocation.end())
+        {
+            // no AutoCaller, registered image life time is bound to this
+            Medium *pCandidate = (*it).second;
+            AutoReadLock imageLock(pCandidate COMMA_LOCKVAL_SRC_POS);
+            /* The location map holds all device types, only look at the requested one. */
+            if (   pCandidate->i_getDeviceType() == mediumType
+                && RTPathCompare(location.c_str(), pCandidate->i_getLocationFull().c_str()) == 0)
+                pMedium = pCandidate;
+        }
+    }
 
-    for (MediaList::const_iterator it = pMediaList->begin();
-         it != pMediaList->end();
-         ++it)
+    bool found = pMedium != NULL;
+    if (found)
     {
         // no AutoCaller, registered image life time is bound to this
-        Medium *pMedium = *it;
         AutoReadLock imageLock(pMedium COMMA_LOCKVAL_SRC_POS);
-        const Utf8Str &strLocationFull = pMedium->i_getLocationFull();
-
-        found =     (    aId
-                      && pMedium->i_getId() == *aId)
-                 || (    !aLocation.isEmpty()
-                      && RTPathCompare(location.c_str(),
-                                       strLocationFull.c_str()) == 0);
-        if (found)
+        if (pMedium->i_getDeviceType() != mediumType)
         {
-            if (pMedium->i_getDeviceType() != mediumType)
-            {
-                if (mediumType == DeviceType_DVD)
-                    return setError(E_INVALIDARG,
-                                    "Cannot mount DVD medium '%s' as floppy", strLocationFull.c_str());
-                else
-                    return setError(E_INVALIDARG,
-                                    "Cannot mount floppy medium '%s' as DVD", strLocationFull.c_str());
-            }
-
-            if (aImage)
-                *aImage = pMedium;
-            break;
+            if (mediumType == DeviceType_DVD)
+                return setError(E_INVALIDARG,
+                                "Cannot mount DVD medium '%s' as floppy", pMedium->i_getLocationFull().c_str());
+            else
+                return setError(E_INVALIDARG,
+                                "Cannot mount floppy medium '%s' as DVD", pMedium->i_getLocationFull().c_str());
         }
+
+        if (aImage)
+            *aImage = pMedium;
     }
 
     HRESULT rc = found ? S_OK : VBOX_E_OBJECT_NOT_FOUND;
@@ -4098,10 +4116,17 @@ void VirtualBox::i_saveMediaRegistry(settings::MediaRegistry &mediaRegistry,
                  ++it2)
             {
                 const Data::PendingMachineRename &pmr = *it2;
+                Utf8Str strOldLocation;
+                {
+                    AutoReadLock mlock(pMedium COMMA_LOCKVAL_SRC_POS);
+                    strOldLocation = pMedium->i_getLocationFull();
+                }
                 HRESULT rc = pMedium->i_updatePath(pmr.strConfigDirOld,
                                                    pmr.strConfigDirNew);
                 if (SUCCEEDED(rc))
                 {
+                    i_updateMediumLocation(pMedium, strOldLocation);
+
                     // Remember which medium objects has been changed,
                     // to trigger saving their registries later.
                     pDesc->llMedia.push_back(pMedium);
@@ -4444,6 +4469,11 @@ HRESULT VirtualBox::i_registerMedium(const ComObjPtr<Medium> &pMedium,
         // store all hard disks (even differencing images) in the map
         if (devType == DeviceType_HardDisk)
             m->mapHardDisks[id] = pMedium;
+        else if (devType == DeviceType_DVD)
+            m->mapDVDImages[id] = pMedium;
+        else
+            m->mapFloppyImages[id] = pMedium;
+        m->mapMediaByLocation[i_mediumLocationKey(strLocationFull)] = pMedium;
 
         mediumCaller.release();
         mediaTreeLock.release();
@@ -4491,11 +4521,13 @@ HRESULT VirtualBox::i_unregisterMedium(Medium *pMedium)
     Assert(i_getMediaTreeLockHandle().isWriteLockOnCurrentThread());
 
     Guid id;
+    Utf8Str strLocationFull;
     ComObjPtr<Medium> pParent;
     DeviceType_T devType;
     {
         AutoReadLock mediumLock(pMedium COMMA_LOCKVAL_SRC_POS);
         id = pMedium->i_getId();
+        strLocationFull = pMedium->i_getLocationFull();
         pParent = pMedium->i_getParent();
         devType = pMedium->i_getDeviceType();
     }
@@ -4527,10 +4559,97 @@ HRESULT VirtualBox::i_unregisterMedium(Medium *pMedium)
         Assert(cnt == 1);
         NOREF(cnt);
     }
+    else
+    {
+        size_t cnt = (devType == DeviceType_DVD ? m->mapDVDImages : m->mapFloppyImages).erase(id);
+        Assert(cnt == 1);
+        NOREF(cnt);
+    }
+
+    MediaLocationMap::iterator it = m->mapMediaByLocation.find(i_mediumLocationKey(strLocationFull));
+    if (   it == m->mapMediaByLocation.end()
+        || it->second != pMedium)
+    {
+        /* The location changed behind our back, find it the slow way. */
+        AssertMsgFailed(("'%s' is not in the location map\n", strLocationFull.c_str()));
+        for (it = m->mapMediaByLocation.begin(); it != m->mapMediaByLocation.end(); ++it)
+        {
+            Medium *pObj = it->second;
+            if (pObj == pMedium)
+                break;
+        }
+    }
+    if (it != m->mapMediaByLocation.end())
+        m->mapMediaByLocation.erase(it);
 
     return S_OK;
 }
 
+/**
+ * Re-keys the location map entry of a registered medium after its location
+ * was changed while it was registered.
+ *
+ * @param pMedium           The medium which was moved or renamed.
+ * @param strOldLocation    The full location before the change.
+ *
+ * @note Caller must hold the media tree lock for writing; in addition, this locks @a pMedium for reading
+ */
+void VirtualBox::i_updateMediumLocation(Medium *pMedium, const Utf8Str &strOldLocation)
+{
+    Assert(i_getMediaTreeLockHandle().isWriteLockOnCurrentThread());
+
+    Utf8Str strLocationFull;
+    {
+        AutoReadLock mediumLock(pMedium COMMA_LOCKVAL_SRC_POS);
+        strLocationFull = pMedium->i_getLocationFull();
+    }
+
+    /* Only registered media are in the map, leave the others alone. */
+    MediaLocationMap::iterator it = m->mapMediaByLocation.find(i_mediumLocationKey(strOldLocation));
+    if (   it == m->mapMediaByLocation.end()
+        || it->second != pMedium)
+        return;
+
+    ComObjPtr<Medium> pObj = it->second;
+    m->mapMediaByLocation.erase(it);
+    m->mapMediaByLocation[i_mediumLocationKey(strLocationFull)] = pObj;
+}
+
+/**
+ * Variant of i_updateMediumLocation() for callers not holding any locks.
+ *
+ * @param pMedium           The medium which was moved or renamed.
+ * @param strOldLocation    The full location before the change.
+ *
+ * @note Locks the media tree for writing.
+ */
+void VirtualBox::i_onMediumLocationChanged(Medium *pMedium, const Utf8Str &strOldLocation)
+{
+    AutoWriteLock treeLock(i_getMediaTreeLockHandle() COMMA_LOCKVAL_SRC_POS);
+    i_updateMediumLocation(pMedium, strOldLocation);
+}
+
+/**
+ * Returns the key of a medium location in the location map.
+ *
+ * This is the location folded the way RTPathCompare() folds it on the host,
+ * so that a map lookup finds the same media as comparing each location would.
+ *
+ * @param strLocation   The full medium location.
+ */
+/* static */
+Utf8Str VirtualBox::i_mediumLocationKey(const Utf8Str &strLocation)
+{
+#if defined(RT_OS_WINDOWS) || defined(RT_OS_OS2)
+    Utf8Str strKey(strLocation);
+    strKey.findReplace('\\', '/');
+    strKey.toUpper();
+    return strKey;
+#else
+    return strLocation;
+#endif
+}
+
 /**
  * Little helper called from unregisterMachineMedia() to recursively add media to the given list,
  * with children appearing before their parents.
@@ -21,6 +21,7 @@
 #include <unistd.h>
 #include <sys/statvfs.h>
 #include <errno.h>
+#include <fcntl.h>
 #include <mntent.h>
 #include <iprt/alloc.h>
 #include <iprt/cdefs.h>
@@ -113,20 +114,32 @@ CollectorLinux::CollectorLinux()
 
 int CollectorLinux::preCollect(const CollectorHints& hints, uint64_t /* iTick */)
 {
-    std::vector<RTPROCESS> processes;
-    hints.getProcesses(processes);
-
-    std::vector<RTPROCESS>::iterator it;
+    /*
+     * Rebuild the process map from scratch every time so that processes
+     * which are no longer hinted (i.e. VMs which went away) get dropped.
+     */
+    const CollectorHints::ProcessList& processes = hints.getProcessFlags();
+    VMProcessMap newStats;
+
+    CollectorHints::ProcessList::const_iterator it;
     for (it = processes.begin(); it != processes.end(); ++it)
     {
         VMProcessStats vmStats;
-        int rc = getRawProcessStats(*it, &vmStats.cpuUser, &vmStats.cpuKernel, &vmStats.pagesUsed);
+        int rc = getRawProcessStats(it->first, &vmStats.cpuUser, &vmStats.cpuKernel, &vmStats.pagesUsed);
         /* On failure, do NOT stop. Just skip the entry. Having the stats for
          * one (probably broken) process frozen/zero is a minor issue compared
          * to not updating many process stats and the host cpu stats. */
         if (RT_SUCCESS(rc))
-            mProcessStats[*it] = vmStats;
+            newStats[it->first] = vmStats;
+        else
+        {
+            VMProcessMap::const_iterator itOld = mProcessStats.find(it->first);
+            if (itOld != mProcessStats.end())
+                newStats[it->first] = itOld->second;
+        }
     }
+    mProcessStats.swap(newStats);
+
     if (hints.isHostCpuLoadCollected() || !mProcessStats.empty())
     {
         _getRawHostCpuLoad();
@@ -276,43 +289,67 @@ int CollectorLinux::getProcessMemoryUsage(RTPROCESS process, ULONG *used)
 
 int CollectorLinux::getRawProcessStats(RTPROCESS process, uint64_t *cpuUser, uint64_t *cpuKernel, ULONG *memPagesUsed)
 {
-    int rc = VINF_SUCCESS;
-    char *pszName;
-    pid_t pid2;
-    char c;
-    int iTmp;
-    long long unsigned int u64Tmp;
-    unsigned uTmp;
-    unsigned long ulTmp;
-    signed long ilTmp;
-    ULONG u32user, u32kernel;
-    char buf[80]; /** @todo this should be tied to max allowed proc name. */
-
-    RTStrAPrintf(&pszName, "/proc/%d/stat", process);
-    FILE *f = fopen(pszName, "r");
-    RTStrFree(pszName);
+    /*
+     * This is called for every VM process on every tick, so read the stat
+     * file in one go and pick the fields out by hand instead of going thru
+     * stdio and a 24 conversion fscanf.
+     */
+    char szName[32];
+    RTStrPrintf(szName, sizeof(szName), "/proc/%d/stat", process);
+    int fd = open(szName, O_RDONLY);
+    if (fd < 0)
+        return VERR_ACCESS_DENIED;
 
-    if (f)
+    char szBuf[1024];
+    ssize_t cbRead = read(fd, szBuf, sizeof(szBuf) - 1);
+    close(fd);
+    if (cbRead <= 0)
+        return VERR_FILE_IO_ERROR;
+    szBuf[cbRead] = '\0';
+
+    /* Format: pid (comm) state ppid ... The command name may contain anything, so skip to the last ')'. */
+    Assert((pid_t)process == (pid_t)RTStrToInt32(szBuf));
+    char *psz = strrchr(szBuf, ')');
+    if (!psz)
+        return VERR_FILE_IO_ERROR;
+    psz++;
+
+    /* Fields 14 (utime), 15 (stime) and 24 (rss), counting from 1; the state is field 3. */
+    uint64_t u64User = 0, u64Kernel = 0, u64Rss = 0;
+    unsigned iField = 2;
+    while (iField < 24)
     {
-        if (fscanf(f, "%d %79s %c %d %d %d %d %d %u %lu %lu %lu %lu %u %u "
-                      "%ld %ld %ld %ld %ld %ld %llu %lu %u",
-                   &pid2, buf, &c, &iTmp, &iTmp, &iTmp, &iTmp, &iTmp, &uTmp,
-                   &ulTmp, &ulTmp, &ulTmp, &ulTmp, &u32user, &u32kernel,
-                   &ilTmp, &ilTmp, &ilTmp, &ilTmp, &ilTmp, &ilTmp, &u64Tmp,
-                   &ulTmp, memPagesUsed) == 24)
+        psz = RTStrStripL(psz);
+        if (!*psz)
+            return VERR_FILE_IO_ERROR;
+        iField++;
+        char *pszNext;
+        if (iField == 14 || iField == 15 || iField == 24)
         {
-            Assert((pid_t)process == pid2);
-            *cpuUser   = u32user;
-            *cpuKernel = u32kernel;
+            uint64_t u64;
+            int rc = RTStrToUInt64Ex(psz, &pszNext, 10, &u64);
+            if (RT_FAILURE(rc))
+                return VERR_FILE_IO_ERROR;
+            if (iField == 14)
+                u64User = u64;
+            else if (iField == 15)
+                u64Kernel = u64;
+            else
+                u64Rss = u64;
         }
         else
-            rc = VERR_FILE_IO_ERROR;
-        fclose(f);
+        {
+            pszNext = psz;
+            while (*pszNext && !RT_C_IS_SPACE(*pszNext))
+                pszNext++;
+        }
+        psz = pszNext;
     }
-    else
-        rc = VERR_ACCESS_DENIED;
 
-    return rc;
+    *cpuUser      = (ULONG)u64User;
+    *cpuKernel    = (ULONG)u64Kernel;
+    *memPagesUsed = (ULONG)u64Rss;
+    return VINF_SUCCESS;
 }
 
 int CollectorLinux::getRawHostNetworkLoad(const char *pszFile, uint64_t *rx, uint64_t *tx)
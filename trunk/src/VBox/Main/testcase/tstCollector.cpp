@@ -150,6 +150,141 @@ void measurePerformance(pm::CollectorHAL *collector, const char *pszName, int cV
     shutdownProcessList(processes);
 }
 
+/**
+ * Collector HAL handing out made up process statistics, so the cost of the
+ * collector itself can be measured with lots of VMs but no real processes.
+ */
+class CollectorFake : public pm::CollectorHAL
+{
+public:
+    CollectorFake() : mHostTotal(0) {}
+
+    virtual int preCollect(const pm::CollectorHints& hints, uint64_t /* iTick */)
+    {
+        mHostTotal += 1000;
+        const pm::CollectorHints::ProcessList& processes = hints.getProcessFlags();
+        for (pm::CollectorHints::ProcessList::const_iterator it = processes.begin(); it != processes.end(); ++it)
+        {
+            VMStats &stats = mStats[it->first];
+            stats.user   += it->first % 7;
+            stats.kernel += it->first % 3;
+            stats.used    = it->first * 16;
+        }
+        return VINF_SUCCESS;
+    }
+
+    virtual int getRawProcessCpuLoad(RTPROCESS process, uint64_t *user, uint64_t *kernel, uint64_t *total)
+    {
+        std::map<RTPROCESS, VMStats>::const_iterator it = mStats.find(process);
+        if (it == mStats.end())
+            return VERR_INTERNAL_ERROR;
+        *user   = it->second.user;
+        *kernel = it->second.kernel;
+        *total  = mHostTotal;
+        return VINF_SUCCESS;
+    }
+
+    virtual int getProcessMemoryUsage(RTPROCESS process, ULONG *used)
+    {
+        std::map<RTPROCESS, VMStats>::const_iterator it = mStats.find(process);
+        if (it == mStats.end())
+            return VERR_INTERNAL_ERROR;
+        *used = it->second.used;
+        return VINF_SUCCESS;
+    }
+
+private:
+    struct VMStats
+    {
+        VMStats() : user(0), kernel(0), used(0) {}
+        uint64_t user;
+        uint64_t kernel;
+        ULONG    used;
+    };
+
+    uint64_t                     mHostTotal;
+    std::map<RTPROCESS, VMStats> mStats;
+};
+
+/**
+ * Runs the collection and query cycle of PerformanceCollector for a number of
+ * simulated VMs, each with CPU load and RAM usage metrics and all aggregates.
+ */
+void benchmarkCollector(int cVMs)
+{
+    RTPrintf("tstCollector: TESTING - Collector overhead with %d simulated VMs\n", cVMs);
+
+    const ULONG cSamples = 60;
+    CollectorFake hal;
+    std::vector<pm::BaseMetric *> baseMetrics;
+    std::vector<pm::Metric *> metrics;
+    ComPtr<IUnknown> object;
+
+    for (int i = 0; i < cVMs; i++)
+    {
+        RTPROCESS process = 1000 + i;
+        pm::SubMetric *subs[3];
+        subs[0] = new pm::SubMetric("CPU/Load/User", "");
+        subs[1] = new pm::SubMetric("CPU/Load/Kernel", "");
+        baseMetrics.push_back(new pm::MachineCpuLoadRaw(&hal, object, process, subs[0], subs[1]));
+        subs[2] = new pm::SubMetric("RAM/Usage/Used", "");
+        baseMetrics.push_back(new pm::MachineRamUsage(&hal, object, process, subs[2]));
+
+        for (unsigned j = 0; j < RT_ELEMENTS(subs); j++)
+        {
+            pm::BaseMetric *pBase = baseMetrics[baseMetrics.size() - (j < 2 ? 2 : 1)];
+            metrics.push_back(new pm::Metric(pBase, subs[j], 0));
+            metrics.push_back(new pm::Metric(pBase, subs[j], new pm::AggregateAvg()));
+            metrics.push_back(new pm::Metric(pBase, subs[j], new pm::AggregateMin()));
+            metrics.push_back(new pm::Metric(pBase, subs[j], new pm::AggregateMax()));
+        }
+    }
+    for (size_t i = 0; i < baseMetrics.size(); i++)
+    {
+        baseMetrics[i]->init(1, cSamples);
+        baseMetrics[i]->enable();
+    }
+
+    /* Collect enough ticks to fill the ring buffers, the way samplerCallback does. */
+    const unsigned cTicks = cSamples * 2;
+    uint64_t start = RTTimeNanoTS();
+    for (unsigned iTick = 0; iTick < cTicks; iTick++)
+    {
+        pm::CollectorHints hints;
+        for (size_t i = 0; i < baseMetrics.size(); i++)
+            baseMetrics[i]->preCollect(hints, iTick);
+        hal.preCollect(hints, iTick);
+        for (size_t i = 0; i < baseMetrics.size(); i++)
+            baseMetrics[i]->collect();
+    }
+    RTPrintf("%70s -- %llu us per tick\n", "collect", (RTTimeNanoTS() - start) / cTicks / 1000);
+
+    /* Query everything, the way queryMetricsData does for an empty filter. */
+    size_t cTotal = 0;
+    for (size_t i = 0; i < metrics.size(); i++)
+        cTotal += metrics[i]->getLength();
+    std::vector<ULONG> data(cTotal);
+    const unsigned cQueries = 100;
+    start = RTTimeNanoTS();
+    for (unsigned iQuery = 0; iQuery < cQueries; iQuery++)
+    {
+        size_t offData = 0;
+        for (size_t i = 0; i < metrics.size(); i++)
+        {
+            ULONG cValues, sequenceNumber;
+            metrics[i]->query(&data[offData], &cValues, &sequenceNumber);
+            offData += cValues;
+        }
+    }
+    RTPrintf("%70s -- %llu us per query (%u metrics, %u values)\n\n", "query all",
+             (RTTimeNanoTS() - start) / cQueries / 1000, (unsigned)metrics.size(), (unsigned)cTotal);
+
+    for (size_t i = 0; i < metrics.size(); i++)
+        delete metrics[i];
+    for (size_t i = 0; i < baseMetrics.size(); i++)
+        delete baseMetrics[i];
+}
+
 #ifdef RT_OS_SOLARIS
 #define NETIFNAME "net0"
 #else
@@ -326,8 +461,8 @@ int testDisk(pm::CollectorHAL *collector)
 
 int main(int argc, char *argv[])
 {
-    bool cpuTest, ramTest, netTest, diskTest, fsTest, perfTest;
-    cpuTest = ramTest = netTest = diskTest = fsTest = perfTest = false;
+    bool cpuTest, ramTest, netTest, diskTest, fsTest, perfTest, benchTest;
+    cpuTest = ramTest = netTest = diskTest = fsTest = perfTest = benchTest = false;
     /*
      * Initialize the VBox runtime without loading
      * the support driver.
@@ -360,6 +495,8 @@ int main(int argc, char *argv[])
                 fsTest = true;
             else if (!strcmp(argv[i], "-perf"))
                 perfTest = true;
+            else if (!strcmp(argv[i], "-bench"))
+                benchTest = true;
             else
             {
                 RTPrintf("tstCollector: Unknown option: %s\n", argv[i]);
@@ -368,7 +505,7 @@ int main(int argc, char *argv[])
         }
     }
     else
-        cpuTest = ramTest = netTest = diskTest = fsTest = perfTest = true;
+        cpuTest = ramTest = netTest = diskTest = fsTest = perfTest = benchTest = true;
 
 #ifdef RT_OS_WINDOWS
     HRESULT hRes = CoInitialize(NULL);
@@ -570,6 +707,8 @@ int main(int argc, char *argv[])
 
         measurePerformance(collector, argv[0], 100);
     }
+    if (benchTest)
+        benchmarkCollector(500);
 
     delete collector;
 
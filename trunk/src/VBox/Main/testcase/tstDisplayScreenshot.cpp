@@ -0,0 +1,195 @@
+/* $Id$ */
+/** @file
+ * Screenshot testcase - scaling, pixel format conversion and PNG encoding.
+ */
+
+/*
+ * Copyright (C) 2009-2017 Oracle Corporation
+ *
+ * This file is part of VirtualBox Open Source Edition (OSE), as
+ * available from http://www.virtualbox.org. This file is free software;
+ * you can redistribute it and/or modify it under the terms of the GNU
+ * General Public License (GPL) as published by the Free Software
+ * Foundation, in version 2 as it comes in the "COPYING" file of the
+ * VirtualBox OSE distribution. VirtualBox OSE is distributed in the
+ * hope that it will be useful, but WITHOUT ANY WARRANTY of any kind.
+ */
+
+/* bitmapScale32Direct is static, so pull in the whole thing. */
+#include "../src-all/DisplayResampleImage.cpp"
+#include "DisplayImpl.h"
+
+#include <iprt/initterm.h>
+#include <iprt/mem.h>
+#include <iprt/rand.h>
+#include <iprt/string.h>
+#include <iprt/test.h>
+#include <iprt/time.h>
+
+
+/** The synthetic screen width. */
+#define TST_WIDTH       1920
+/** The synthetic screen height. */
+#define TST_HEIGHT      1080
+
+
+/**
+ * Paints something resembling a desktop: a gradient background with a window
+ * full of text on it.
+ */
+static void tstPaintDesktop(uint8_t *pbScreen, unsigned cx, unsigned cy)
+{
+    for (unsigned y = 0; y < cy; y++)
+        for (unsigned x = 0; x < cx; x++)
+        {
+            uint8_t *pb = &pbScreen[(y * cx + x) * 4];
+            if (x > cx / 10 && x < cx * 3 / 4 && y > cy / 10 && y < cy * 5 / 6)
+            {
+                bool const fInk = y % 20 < 12 && (x * 7 + y * 3) % 11 < 5 && x % 300 < 260;
+                pb[0] = pb[1] = pb[2] = fInk ? 0x20 : 0xf0;
+            }
+            else
+            {
+                pb[0] = (uint8_t)(x / 8);
+                pb[1] = (uint8_t)(y / 5);
+                pb[2] = 0x60;
+            }
+            pb[3] = 0;
+        }
+}
+
+
+/**
+ * Checks that BitmapScale32 gives exactly the same results as the original
+ * per-pixel implementation.
+ */
+static void tstScaleCompare(int cxSrc, int cySrc, int cxDst, int cyDst)
+{
+    RTTestISubF("Compare %dx%d -> %dx%d", cxSrc, cySrc, cxDst, cyDst);
+
+    uint8_t *pbSrc = (uint8_t *)RTMemAlloc(cxSrc * cySrc * 4);
+    uint8_t *pbDst = (uint8_t *)RTMemAllocZ(cxDst * cyDst * 4);
+    uint8_t *pbRef = (uint8_t *)RTMemAllocZ(cxDst * cyDst * 4);
+    RTTESTI_CHECK_RETV(pbSrc && pbDst && pbRef);
+
+    RTRandBytes(pbSrc, cxSrc * cySrc * 4);
+    BitmapScale32(pbDst, cxDst, cyDst, pbSrc, cxSrc * 4, cxSrc, cySrc);
+    bitmapScale32Direct(pbRef, cxDst, cyDst, pbSrc, cxSrc * 4, cxSrc, cySrc);
+    RTTESTI_CHECK(!memcmp(pbDst, pbRef, cxDst * cyDst * 4));
+
+    RTMemFree(pbSrc);
+    RTMemFree(pbDst);
+    RTMemFree(pbRef);
+}
+
+
+/**
+ * Checks the pixel format conversions, including the tail handling.
+ */
+static void tstConvert(void)
+{
+    RTTestISub("Pixel format conversion");
+
+    uint8_t abSrc[7 * 4];
+    uint8_t abDst[7 * 4];
+    for (unsigned i = 0; i < sizeof(abSrc); i++)
+        abSrc[i] = (uint8_t)(i * 37);
+
+    memcpy(abDst, abSrc, sizeof(abDst));
+    BitmapConvertBGR0ToBGRA(abDst, 7);
+    for (unsigned i = 0; i < 7; i++)
+        RTTESTI_CHECK(   abDst[i * 4]     == abSrc[i * 4]
+                      && abDst[i * 4 + 1] == abSrc[i * 4 + 1]
+                      && abDst[i * 4 + 2] == abSrc[i * 4 + 2]
+                      && abDst[i * 4 + 3] == 0xff);
+
+    memcpy(abDst, abSrc, sizeof(abDst));
+    BitmapConvertBGR0ToRGBA(abDst, 7);
+    for (unsigned i = 0; i < 7; i++)
+        RTTESTI_CHECK(   abDst[i * 4]     == abSrc[i * 4 + 2]
+                      && abDst[i * 4 + 1] == abSrc[i * 4 + 1]
+                      && abDst[i * 4 + 2] == abSrc[i * 4]
+                      && abDst[i * 4 + 3] == 0xff);
+}
+
+
+/**
+ * Times the building blocks of IDisplay::takeScreenShotToArray.
+ */
+static void tstBench(unsigned cRounds)
+{
+    uint8_t *pbScreen = (uint8_t *)RTMemAlloc(TST_WIDTH * TST_HEIGHT * 4);
+    uint8_t *pbDst    = (uint8_t *)RTMemAlloc(TST_WIDTH * TST_HEIGHT * 4);
+    RTTESTI_CHECK_RETV(pbScreen && pbDst);
+    tstPaintDesktop(pbScreen, TST_WIDTH, TST_HEIGHT);
+
+    RTTestISub("Scale to thumbnail");
+    uint64_t nsStart = RTTimeNanoTS();
+    for (unsigned i = 0; i < cRounds; i++)
+        BitmapScale32(pbDst, 160, 90, pbScreen, TST_WIDTH * 4, TST_WIDTH, TST_HEIGHT);
+    RTTestIValue("new", (RTTimeNanoTS() - nsStart) / cRounds, RTTESTUNIT_NS_PER_CALL);
+    nsStart = RTTimeNanoTS();
+    for (unsigned i = 0; i < cRounds; i++)
+        bitmapScale32Direct(pbDst, 160, 90, pbScreen, TST_WIDTH * 4, TST_WIDTH, TST_HEIGHT);
+    RTTestIValue("old", (RTTimeNanoTS() - nsStart) / cRounds, RTTESTUNIT_NS_PER_CALL);
+
+    RTTestISub("Scale to PNG size limit");
+    nsStart = RTTimeNanoTS();
+    for (unsigned i = 0; i < cRounds; i++)
+        BitmapScale32(pbDst, 1024, 576, pbScreen, TST_WIDTH * 4, TST_WIDTH, TST_HEIGHT);
+    RTTestIValue("new", (RTTimeNanoTS() - nsStart) / cRounds, RTTESTUNIT_NS_PER_CALL);
+    nsStart = RTTimeNanoTS();
+    for (unsigned i = 0; i < cRounds; i++)
+        bitmapScale32Direct(pbDst, 1024, 576, pbScreen, TST_WIDTH * 4, TST_WIDTH, TST_HEIGHT);
+    RTTestIValue("old", (RTTimeNanoTS() - nsStart) / cRounds, RTTESTUNIT_NS_PER_CALL);
+
+    RTTestISub("Convert to RGBA");
+    nsStart = RTTimeNanoTS();
+    for (unsigned i = 0; i < cRounds; i++)
+    {
+        memcpy(pbDst, pbScreen, TST_WIDTH * TST_HEIGHT * 4);
+        BitmapConvertBGR0ToRGBA(pbDst, TST_WIDTH * TST_HEIGHT);
+    }
+    RTTestIValue("copy+convert", (RTTimeNanoTS() - nsStart) / cRounds, RTTESTUNIT_NS_PER_CALL);
+
+    RTTestISub("PNG");
+    uint32_t cbPNG = 0;
+    nsStart = RTTimeNanoTS();
+    for (unsigned i = 0; i < cRounds; i++)
+    {
+        uint8_t *pbPNG = NULL;
+        uint32_t cxPNG = 0;
+        uint32_t cyPNG = 0;
+        RTTESTI_CHECK_RC_BREAK(DisplayMakePNG(pbScreen, TST_WIDTH, TST_HEIGHT, &pbPNG, &cbPNG, &cxPNG, &cyPNG, 0),
+                               VINF_SUCCESS);
+        RTMemFree(pbPNG);
+    }
+    RTTestIValue("encode", (RTTimeNanoTS() - nsStart) / cRounds, RTTESTUNIT_NS_PER_CALL);
+    RTTestIValue("size", cbPNG, RTTESTUNIT_BYTES);
+
+    RTMemFree(pbScreen);
+    RTMemFree(pbDst);
+}
+
+
+int main(int argc, char **argv)
+{
+    RT_NOREF1(argv);
+
+    RTTEST hTest;
+    RTEXITCODE rcExit = RTTestInitAndCreate("tstDisplayScreenshot", &hTest);
+    if (rcExit != RTEXITCODE_SUCCESS)
+        return rcExit;
+    RTTestBanner(hTest);
+
+    tstScaleCompare(1920, 1080, 1024, 576);
+    tstScaleCompare(1920, 1080, 160, 90);
+    tstScaleCompare(1023, 767, 333, 111);
+    tstScaleCompare(640, 480, 1280, 960);
+    tstScaleCompare(7, 5, 100, 3);
+    tstConvert();
+
+    tstBench(argc > 1 ? 100 : 10);
+
+    return RTTestSummaryAndDestroy(hTest);
+}
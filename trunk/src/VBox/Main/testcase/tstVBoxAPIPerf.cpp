@@ -27,9 +27,14 @@
 #include <VBox/com/VirtualBox.h>
 #include <VBox/sup.h>
 
+#include <iprt/path.h>
+#include <iprt/process.h>
+#include <iprt/string.h>
 #include <iprt/test.h>
 #include <iprt/time.h>
 
+#include <vector>
+
 
 
 /*********************************************************************************************************************************
@@ -194,8 +199,218 @@ static void tstApiPrf4(IVirtualBox *pVBox)
 }
 
 
+/**
+ * Registers and mutates a bunch of machines and media, timing how long
+ * saving the settings takes as the registries grow.
+ *
+ * This leaves traces in the user's VirtualBox.xml, so it is only done on
+ * request.  Everything is unregistered and deleted again afterwards.
+ */
+static void tstApiPrf5(IVirtualBox *pVBox, uint32_t cMachines)
+{
+    RTTestSubF(g_hTest, "Settings with %u machines and media", cMachines);
+
+    std::vector<ComPtr<IMachine> >  aMachines(cMachines);
+    std::vector<ComPtr<IMedium> >   aMedia(cMachines);
+    com::SafeArray<BSTR>            aGroups;
+    com::SafeArray<MediumVariant_T> aVariant;
+    aVariant.push_back(MediumVariant_Standard);
+    HRESULT hrc = S_OK;
+
+    /* Register machines, each with a medium in the global registry. */
+    uint64_t uStartTS = RTTimeNanoTS();
+    uint32_t cCreated = 0;
+    for (; cCreated < cMachines && SUCCEEDED(hrc); cCreated++)
+    {
+        ComPtr<IMachine> ptrMachine;
+        hrc = TST_COM_EXPR(pVBox->CreateMachine(NULL, com::BstrFmt("tstVBoxAPIPerf-%u-%u", RTProcSelf(), cCreated).raw(),
+                                                ComSafeArrayAsInParam(aGroups), NULL, NULL, ptrMachine.asOutParam()));
+        if (SUCCEEDED(hrc))
+            hrc = TST_COM_EXPR(ptrMachine->SaveSettings());
+        if (SUCCEEDED(hrc))
+            hrc = TST_COM_EXPR(pVBox->RegisterMachine(ptrMachine));
+        if (FAILED(hrc))
+            break;
+        aMachines[cCreated] = ptrMachine;
+
+        com::Bstr bstrSettingsFile;
+        hrc = TST_COM_EXPR(ptrMachine->COMGETTER(SettingsFilePath)(bstrSettingsFile.asOutParam()));
+        if (FAILED(hrc))
+            break;
+        char szMediumPath[RTPATH_MAX];
+        RTStrCopy(szMediumPath, sizeof(szMediumPath), com::Utf8Str(bstrSettingsFile).c_str());
+        RTPathStripSuffix(szMediumPath);
+        RTStrCat(szMediumPath, sizeof(szMediumPath), ".vdi");
+
+        ComPtr<IMedium> ptrMedium;
+        hrc = TST_COM_EXPR(pVBox->CreateMedium(com::Bstr("VDI").raw(), com::Bstr(szMediumPath).raw(), AccessMode_ReadWrite,
+                                               DeviceType_HardDisk, ptrMedium.asOutParam()));
+        ComPtr<IProgress> ptrProgress;
+        if (SUCCEEDED(hrc))
+            hrc = TST_COM_EXPR(ptrMedium->CreateBaseStorage(_1M, ComSafeArrayAsInParam(aVariant), ptrProgress.asOutParam()));
+        if (SUCCEEDED(hrc))
+            hrc = TST_COM_EXPR(ptrProgress->WaitForCompletion(-1));
+        if (SUCCEEDED(hrc))
+            aMedia[cCreated] = ptrMedium;
+    }
+    uint64_t uElapsed = RTTimeNanoTS() - uStartTS;
+    if (cCreated)
+        RTTestValue(g_hTest, "Register machine + medium average", uElapsed / cCreated, RTTESTUNIT_NS_PER_CALL);
+
+    /* Small changes which each end up saving a settings file. */
+    if (SUCCEEDED(hrc) && cCreated)
+    {
+        uStartTS = RTTimeNanoTS();
+        for (uint32_t i = 0; i < cCreated && SUCCEEDED(hrc); i++)
+            hrc = TST_COM_EXPR(pVBox->SetExtraData(com::Bstr("tstVBoxAPIPerf/Global").raw(), com::BstrFmt("%u", i).raw()));
+        uElapsed = RTTimeNanoTS() - uStartTS;
+        RTTestValue(g_hTest, "IVirtualBox::SetExtraData average", uElapsed / cCreated, RTTESTUNIT_NS_PER_CALL);
+        pVBox->SetExtraData(com::Bstr("tstVBoxAPIPerf/Global").raw(), NULL);
+
+        uStartTS = RTTimeNanoTS();
+        for (uint32_t i = 0; i < cCreated && SUCCEEDED(hrc); i++)
+            hrc = TST_COM_EXPR(aMachines[i]->SetExtraData(com::Bstr("tstVBoxAPIPerf/Machine").raw(), com::BstrFmt("%u", i).raw()));
+        uElapsed = RTTimeNanoTS() - uStartTS;
+        RTTestValue(g_hTest, "IMachine::SetExtraData average", uElapsed / cCreated, RTTESTUNIT_NS_PER_CALL);
+
+        /* Modifying a medium marks the global registry as needing saving. */
+        uStartTS = RTTimeNanoTS();
+        for (uint32_t i = 0; i < cCreated && SUCCEEDED(hrc); i++)
+            if (aMedia[i].isNotNull())
+                hrc = TST_COM_EXPR(aMedia[i]->COMSETTER(Description)(com::BstrFmt("medium %u", i).raw()));
+        uElapsed = RTTimeNanoTS() - uStartTS;
+        RTTestValue(g_hTest, "IMedium::Description average", uElapsed / cCreated, RTTESTUNIT_NS_PER_CALL);
+    }
+
+    /* Cleanup. */
+    for (uint32_t i = 0; i < cCreated; i++)
+    {
+        if (aMedia[i].isNotNull())
+        {
+            ComPtr<IProgress> ptrProgress;
+            if (SUCCEEDED(aMedia[i]->DeleteStorage(ptrProgress.asOutParam())))
+                ptrProgress->WaitForCompletion(-1);
+        }
+        if (aMachines[i].isNotNull())
+        {
+            com::SafeIfaceArray<IMedium> aMachineMedia;
+            if (SUCCEEDED(aMachines[i]->Unregister(CleanupMode_DetachAllReturnHardDisksOnly,
+                                                   ComSafeArrayAsOutParam(aMachineMedia))))
+            {
+                ComPtr<IProgress> ptrProgress;
+                if (SUCCEEDED(aMachines[i]->DeleteConfig(ComSafeArrayAsInParam(aMachineMedia), ptrProgress.asOutParam())))
+                    ptrProgress->WaitForCompletion(-1);
+            }
+        }
+    }
+
+    RTTestSubDone(g_hTest);
+}
+
 
-int main()
+/**
+ * Registers a large number of DVD images and times looking them up again
+ * by location and by UUID, which is what attaching media and the conflict
+ * checks done when registering media boil down to.
+ *
+ * Like tstApiPrf5 this modifies the global media registry, so it is only
+ * done on request.  The images are closed and deleted again afterwards.
+ */
+static void tstApiPrf6(IVirtualBox *pVBox, uint32_t cMedia)
+{
+    RTTestSubF(g_hTest, "Media registry lookups with %u media", cMedia);
+
+    char szDir[RTPATH_MAX];
+    int rc = RTPathTemp(szDir, sizeof(szDir));
+    if (RT_SUCCESS(rc))
+        rc = RTPathAppend(szDir, sizeof(szDir), "tstVBoxAPIPerf-XXXXXX");
+    if (RT_SUCCESS(rc))
+        rc = RTDirCreateTemp(szDir, 0700);
+    if (RT_FAILURE(rc))
+    {
+        RTTestFailed(g_hTest, "Creating the temporary directory failed: %Rrc", rc);
+        return;
+    }
+
+    std::vector<ComPtr<IMedium> >   aMedia(cMedia);
+    std::vector<com::Bstr>          aLocations(cMedia);
+    std::vector<com::Bstr>          aIds(cMedia);
+    HRESULT hrc = S_OK;
+
+    /* Create the (empty) image files and register them. */
+    uint8_t abSector[2048];
+    RT_ZERO(abSector);
+    uint64_t cNsRegister = 0;
+    uint32_t cRegistered = 0;
+    for (; cRegistered < cMedia && SUCCEEDED(hrc); cRegistered++)
+    {
+        char szPath[RTPATH_MAX];
+        RTStrPrintf(szPath, sizeof(szPath), "%s%cimage-%u.iso", szDir, RTPATH_SLASH, cRegistered);
+        RTFILE hFile;
+        rc = RTFileOpen(&hFile, szPath, RTFILE_O_WRITE | RTFILE_O_CREATE_REPLACE | RTFILE_O_DENY_NONE);
+        if (RT_SUCCESS(rc))
+        {
+            rc = RTFileWrite(hFile, abSector, sizeof(abSector), NULL);
+            RTFileClose(hFile);
+        }
+        if (RT_FAILURE(rc))
+        {
+            RTTestFailed(g_hTest, "Creating '%s' failed: %Rrc", szPath, rc);
+            break;
+        }
+        aLocations[cRegistered] = com::Bstr(szPath);
+
+        ComPtr<IMedium> ptrMedium;
+        uint64_t uStartTS = RTTimeNanoTS();
+        hrc = TST_COM_EXPR(pVBox->OpenMedium(aLocations[cRegistered].raw(), DeviceType_DVD, AccessMode_ReadOnly,
+                                             FALSE /*fForceNewUuid*/, ptrMedium.asOutParam()));
+        cNsRegister += RTTimeNanoTS() - uStartTS;
+        if (FAILED(hrc))
+            break;
+        hrc = TST_COM_EXPR(ptrMedium->COMGETTER(Id)(aIds[cRegistered].asOutParam()));
+        aMedia[cRegistered] = ptrMedium;
+    }
+    if (cRegistered)
+        RTTestValue(g_hTest, "Register average", cNsRegister / cRegistered, RTTESTUNIT_NS_PER_CALL);
+
+    /* Look all of them up again; opening a registered location or UUID returns the existing object. */
+    if (SUCCEEDED(hrc) && cRegistered)
+    {
+        uint64_t uStartTS = RTTimeNanoTS();
+        for (uint32_t i = 0; i < cRegistered && SUCCEEDED(hrc); i++)
+        {
+            ComPtr<IMedium> ptrMedium;
+            hrc = TST_COM_EXPR(pVBox->OpenMedium(aLocations[i].raw(), DeviceType_DVD, AccessMode_ReadOnly,
+                                                 FALSE /*fForceNewUuid*/, ptrMedium.asOutParam()));
+        }
+        RTTestValue(g_hTest, "Lookup by location average", (RTTimeNanoTS() - uStartTS) / cRegistered,
+                    RTTESTUNIT_NS_PER_CALL);
+
+        uStartTS = RTTimeNanoTS();
+        for (uint32_t i = 0; i < cRegistered && SUCCEEDED(hrc); i++)
+        {
+            ComPtr<IMedium> ptrMedium;
+            hrc = TST_COM_EXPR(pVBox->OpenMedium(aIds[i].raw(), DeviceType_DVD, AccessMode_ReadOnly,
+                                                 FALSE /*fForceNewUuid*/, ptrMedium.asOutParam()));
+        }
+        RTTestValue(g_hTest, "Lookup by UUID average", (RTTimeNanoTS() - uStartTS) / cRegistered,
+                    RTTESTUNIT_NS_PER_CALL);
+    }
+
+    /* Cleanup. */
+    uint64_t uStartTS = RTTimeNanoTS();
+    for (uint32_t i = 0; i < cRegistered; i++)
+        if (aMedia[i].isNotNull())
+            aMedia[i]->Close();
+    if (cRegistered)
+        RTTestValue(g_hTest, "Close average", (RTTimeNanoTS() - uStartTS) / cRegistered, RTTESTUNIT_NS_PER_CALL);
+    RTDirRemoveRecursive(szDir, RTDIRRMREC_F_CONTENT_AND_DIR);
+
+    RTTestSubDone(g_hTest);
+}
+
+
+int main(int argc, char **argv)
 {
     /*
      * Initialization.
@@ -233,6 +448,13 @@ int main()
                 /** @todo Find something that returns a 2nd instance of an interface and see
                  *        how if wrapper stuff is reused in any way. */
                 tstApiPrf4(ptrVBox);
+
+                /* Only when asked for, this one registers machines and media. */
+                if (argc > 1)
+                    tstApiPrf5(ptrVBox, RTStrToUInt32(argv[1]));
+                /* Ditto for media registry lookups, use something like 10000 here. */
+                if (argc > 2)
+                    tstApiPrf6(ptrVBox, RTStrToUInt32(argv[2]));
             }
         }
 
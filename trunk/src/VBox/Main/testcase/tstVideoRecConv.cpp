@@ -0,0 +1,212 @@
+/* $Id$ */
+/** @file
+ * Video recording testcase - colour conversion and encoding frame rates.
+ */
+
+/*
+ * Copyright (C) 2012-2017 Oracle Corporation
+ *
+ * This file is part of VirtualBox Open Source Edition (OSE), as
+ * available from http://www.virtualbox.org. This file is free software;
+ * you can redistribute it and/or modify it under the terms of the GNU
+ * General Public License (GPL) as published by the Free Software
+ * Foundation, in version 2 as it comes in the "COPYING" file of the
+ * VirtualBox OSE distribution. VirtualBox OSE is distributed in the
+ * hope that it will be useful, but WITHOUT ANY WARRANTY of any kind.
+ */
+
+/* The conversion routines are all static, so pull in the whole thing. */
+#include "../src-client/VideoRec.cpp"
+
+#include <iprt/initterm.h>
+#include <iprt/mem.h>
+#include <iprt/rand.h>
+#include <iprt/test.h>
+#include <iprt/time.h>
+
+
+/** The synthetic screen width. */
+#define TST_WIDTH       1920
+/** The synthetic screen height. */
+#define TST_HEIGHT      1080
+
+
+/**
+ * Paints frame number @a iFrame of a synthetic screen: a static gradient
+ * with a box moving over it.
+ */
+static void tstPaintFrame(uint8_t *pbFrame, unsigned cbPixel, unsigned cx, unsigned cy, unsigned iFrame)
+{
+    unsigned const xBox = (iFrame * 16) % (cx - 64);
+    unsigned const yBox = (iFrame * 8)  % (cy - 64);
+    for (unsigned y = 0; y < cy; y++)
+        for (unsigned x = 0; x < cx; x++)
+        {
+            uint8_t *pb = &pbFrame[(y * cx + x) * cbPixel];
+            bool const fBox = x - xBox < 64 && y - yBox < 64;
+            for (unsigned i = 0; i < cbPixel; i++)
+                pb[i] = fBox ? (uint8_t)(0xff - i * 0x40) : (uint8_t)(x + y * (i + 1));
+        }
+}
+
+
+/**
+ * Checks that the format specific conversion code produces exactly the same
+ * output as the generic per-pixel code.
+ */
+template <class T>
+static void tstConvCompare(uint32_t uPixelFormat, unsigned cx, unsigned cy)
+{
+    RTTestISubF("Compare %u bpp %ux%u", T::PIX_SIZE * 8, cx, cy);
+
+    size_t const cbSrc = (size_t)cx * cy * T::PIX_SIZE;
+    size_t const cbDst = (size_t)cx * cy * 3 / 2;
+    uint8_t *pbSrc = (uint8_t *)RTMemAlloc(cbSrc);
+    uint8_t *pbDst = (uint8_t *)RTMemAllocZ(cbDst);
+    uint8_t *pbRef = (uint8_t *)RTMemAllocZ(cbDst);
+    RTTESTI_CHECK_RETV(pbSrc && pbDst && pbRef);
+
+    RTRandBytes(pbSrc, cbSrc);
+    RTTESTI_CHECK_RC(videoRecRGBToYUV(uPixelFormat, pbDst, cx, cy, pbSrc, cx, cy, 0, cy), VINF_SUCCESS);
+
+    size_t const cbLine = (size_t)cx * T::PIX_SIZE;
+    for (unsigned y = 0; y < cy; y += 2)
+        colorConvRowPairYUV420pGeneric<T>(&pbSrc[y * cbLine], &pbSrc[(y + 1) * cbLine],
+                                          &pbRef[y * cx], &pbRef[(y + 1) * cx],
+                                          &pbRef[cx * cy + y / 2 * cx / 2], &pbRef[cx * cy * 5 / 4 + y / 2 * cx / 2],
+                                          0, cx / 2);
+    RTTESTI_CHECK(!memcmp(pbDst, pbRef, cbDst));
+
+    /* Converting a range of rows must not touch anything else. */
+    memset(pbDst, 0x55, cbDst);
+    RTTESTI_CHECK_RC(videoRecRGBToYUV(uPixelFormat, pbDst, cx, cy, pbSrc, cx, cy, 2, 4), VINF_SUCCESS);
+    RTTESTI_CHECK(!memcmp(&pbDst[2 * cx], &pbRef[2 * cx], 2 * cx));
+    RTTESTI_CHECK(pbDst[0] == 0x55 && pbDst[4 * cx] == 0x55);
+
+    RTMemFree(pbSrc);
+    RTMemFree(pbDst);
+    RTMemFree(pbRef);
+}
+
+
+/**
+ * Measures how many frames per second can be converted, both with the whole
+ * screen changing and with only a small band of it changing.
+ */
+static void tstConvBench(uint32_t uPixelFormat, unsigned cbPixel, unsigned cFrames)
+{
+    RTTestISubF("Convert %u bpp %ux%u", cbPixel * 8, TST_WIDTH, TST_HEIGHT);
+
+    size_t const cbSrc = (size_t)TST_WIDTH * TST_HEIGHT * cbPixel;
+    uint8_t *pbSrc = (uint8_t *)RTMemAlloc(cbSrc);
+    uint8_t *pbDst = (uint8_t *)RTMemAlloc((size_t)TST_WIDTH * TST_HEIGHT * 3 / 2);
+    RTTESTI_CHECK_RETV(pbSrc && pbDst);
+    tstPaintFrame(pbSrc, cbPixel, TST_WIDTH, TST_HEIGHT, 0);
+
+    uint64_t nsStart = RTTimeNanoTS();
+    for (unsigned i = 0; i < cFrames; i++)
+        videoRecRGBToYUV(uPixelFormat, pbDst, TST_WIDTH, TST_HEIGHT, pbSrc, TST_WIDTH, TST_HEIGHT, 0, TST_HEIGHT);
+    uint64_t cNsElapsed = RTTimeNanoTS() - nsStart;
+    RTTestIValue("full frames", (uint64_t)cFrames * RT_NS_1SEC / RT_MAX(cNsElapsed, 1), RTTESTUNIT_OCCURRENCES_PER_SEC);
+
+    /* A 64 row band, about what a scrolling text line or a moving window edge dirties. */
+    nsStart = RTTimeNanoTS();
+    for (unsigned i = 0; i < cFrames; i++)
+    {
+        unsigned const yStart = (i * 64) % (TST_HEIGHT - 64);
+        videoRecRGBToYUV(uPixelFormat, pbDst, TST_WIDTH, TST_HEIGHT, pbSrc, TST_WIDTH, TST_HEIGHT, yStart, yStart + 64);
+    }
+    cNsElapsed = RTTimeNanoTS() - nsStart;
+    RTTestIValue("partial frames", (uint64_t)cFrames * RT_NS_1SEC / RT_MAX(cNsElapsed, 1), RTTESTUNIT_OCCURRENCES_PER_SEC);
+
+    RTMemFree(pbSrc);
+    RTMemFree(pbDst);
+}
+
+
+#ifdef VBOX_WITH_LIBVPX
+/**
+ * Measures how many synthetic frames per second the VP8 encoder manages with
+ * the given number of threads.
+ */
+static void tstEncodeBench(unsigned cThreads, unsigned cFrames)
+{
+    RTTestISubF("Encode %ux%u, %u thread(s)", TST_WIDTH, TST_HEIGHT, cThreads);
+
+    vpx_codec_enc_cfg_t Cfg;
+    RTTESTI_CHECK_RETV(vpx_codec_enc_config_default(DEFAULTCODEC, &Cfg, 0) == VPX_CODEC_OK);
+    Cfg.rc_target_bitrate = 512;
+    Cfg.g_w               = TST_WIDTH;
+    Cfg.g_h               = TST_HEIGHT;
+    Cfg.g_timebase.num    = 1;
+    Cfg.g_timebase.den    = 1000;
+    Cfg.g_threads         = cThreads;
+
+    vpx_codec_ctx_t Ctx;
+    RTTESTI_CHECK_RETV(vpx_codec_enc_init(&Ctx, DEFAULTCODEC, &Cfg, 0) == VPX_CODEC_OK);
+    int iTokenPartitions = 0;
+    while (   (2U << iTokenPartitions) <= cThreads
+           && iTokenPartitions < 3)
+        iTokenPartitions++;
+    RTTESTI_CHECK(vpx_codec_control(&Ctx, VP8E_SET_TOKEN_PARTITIONS, iTokenPartitions) == VPX_CODEC_OK);
+
+    vpx_image_t Image;
+    uint8_t *pbSrc = (uint8_t *)RTMemAlloc((size_t)TST_WIDTH * TST_HEIGHT * 4);
+    if (   pbSrc
+        && vpx_img_alloc(&Image, VPX_IMG_FMT_I420, TST_WIDTH, TST_HEIGHT, 1))
+    {
+        uint64_t cNsElapsed = 0;
+        for (unsigned i = 0; i < cFrames; i++)
+        {
+            tstPaintFrame(pbSrc, 4, TST_WIDTH, TST_HEIGHT, i);
+            uint64_t const nsStart = RTTimeNanoTS();
+            videoRecRGBToYUV(VIDEORECPIXELFMT_RGB32, Image.planes[0], TST_WIDTH, TST_HEIGHT,
+                             pbSrc, TST_WIDTH, TST_HEIGHT, 0, TST_HEIGHT);
+            RTTESTI_CHECK(vpx_codec_encode(&Ctx, &Image, i * 33, 33, 0, VPX_DL_REALTIME) == VPX_CODEC_OK);
+            vpx_codec_iter_t iter = NULL;
+            while (vpx_codec_get_cx_data(&Ctx, &iter))
+                ;
+            cNsElapsed += RTTimeNanoTS() - nsStart;
+        }
+        RTTestIValue("frames", (uint64_t)cFrames * RT_NS_1SEC / RT_MAX(cNsElapsed, 1), RTTESTUNIT_OCCURRENCES_PER_SEC);
+        vpx_img_free(&Image);
+    }
+    else
+        RTTestIFailed("out of memory");
+
+    RTMemFree(pbSrc);
+    vpx_codec_destroy(&Ctx);
+}
+#endif /* VBOX_WITH_LIBVPX */
+
+
+int main(int argc, char **argv)
+{
+    RT_NOREF1(argv);
+
+    RTTEST hTest;
+    RTEXITCODE rcExit = RTTestInitAndCreate("tstVideoRecConv", &hTest);
+    if (rcExit != RTEXITCODE_SUCCESS)
+        return rcExit;
+    RTTestBanner(hTest);
+
+    /* Odd block counts exercise the remainder handling of the vectorized code. */
+    tstConvCompare<ColorConvBGRA32Iter>(VIDEORECPIXELFMT_RGB32,  TST_WIDTH, TST_HEIGHT);
+    tstConvCompare<ColorConvBGRA32Iter>(VIDEORECPIXELFMT_RGB32,  642, 10);
+    tstConvCompare<ColorConvBGR24Iter>(VIDEORECPIXELFMT_RGB24,   642, 10);
+    tstConvCompare<ColorConvBGR565Iter>(VIDEORECPIXELFMT_RGB565, 642, 10);
+
+    unsigned const cFrames = argc > 1 ? 300 : 30;
+    tstConvBench(VIDEORECPIXELFMT_RGB32,  4, cFrames);
+    tstConvBench(VIDEORECPIXELFMT_RGB24,  3, cFrames);
+    tstConvBench(VIDEORECPIXELFMT_RGB565, 2, cFrames);
+
+#ifdef VBOX_WITH_LIBVPX
+    tstEncodeBench(1, cFrames);
+    unsigned const cThreads = RT_MIN(RT_MAX(RTMpGetOnlineCount() / 2, 1), 8);
+    if (cThreads > 1)
+        tstEncodeBench(cThreads, cFrames);
+#endif
+
+    return RTTestSummaryAndDestroy(hTest);
+}
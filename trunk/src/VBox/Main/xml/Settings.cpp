@@ -75,7 +75,10 @@
 #include <iprt/stream.h>
 #include <iprt/ctype.h>
 #include <iprt/file.h>
+#include <iprt/path.h>
 #include <iprt/process.h>
+#include <iprt/sha.h>
+#include <iprt/time.h>
 #include <iprt/ldr.h>
 #include <iprt/base64.h>
 #include <iprt/cpp/lock.h>
@@ -178,6 +181,12 @@ struct ConfigFileBase::Data
     SettingsVersion_T       svRead;                     // settings version that the original file had when it was read,
                                                         // or SettingsVersion_Null if none
 
+    // what we wrote last, for skipping rewrites of unchanged files (see writeDocument())
+    RTCString               strWrittenFilename;         // empty if nothing is known
+    uint8_t                 abWrittenDigest[RTSHA256_HASH_SIZE];
+    RTFOFF                  cbWritten;
+    RTTIMESPEC              WrittenModificationTime;
+
     void copyFrom(const Data &d)
     {
         strFilename = d.strFilename;
@@ -185,6 +194,10 @@ struct ConfigFileBase::Data
         strSettingsVersionFull = d.strSettingsVersionFull;
         sv = d.sv;
         svRead = d.svRead;
+        strWrittenFilename = d.strWrittenFilename;
+        memcpy(abWrittenDigest, d.abWrittenDigest, sizeof(abWrittenDigest));
+        cbWritten = d.cbWritten;
+        WrittenModificationTime = d.WrittenModificationTime;
     }
 
     void cleanup()
@@ -1410,6 +1423,54 @@ void ConfigFileBase::buildNATLoopbacks(xml::ElementNode &elmParent, const NATLoo
     }
 }
 
+/**
+ * Writes the DOM tree to m->strFilename, unless it serializes to exactly what
+ * we wrote there the last time and the file hasn't been touched since.
+ *
+ * Only byte-identical rewrites are skipped (e.g. machine files forced out when
+ * saving the media registries).  Any actual change still rewrites the whole
+ * file, and additionally pays for serializing the document once more to
+ * calculate the digest.
+ *
+ * Throws xml::Error on write errors.
+ */
+void ConfigFileBase::writeDocument()
+{
+    xml::XmlFileWriter writer(*m->pDoc);
+
+    uint8_t abDigest[RTSHA256_HASH_SIZE];
+    int vrc = writer.digest(abDigest);
+    if (   RT_SUCCESS(vrc)
+        && m->strWrittenFilename.isNotEmpty()
+        && m->strWrittenFilename == m->strFilename
+        && !memcmp(abDigest, m->abWrittenDigest, sizeof(abDigest)))
+    {
+        RTFSOBJINFO ObjInfo;
+        vrc = RTPathQueryInfo(m->strFilename.c_str(), &ObjInfo, RTFSOBJATTRADD_NOTHING);
+        if (   RT_SUCCESS(vrc)
+            && ObjInfo.cbObject == m->cbWritten
+            && RTTimeSpecIsEqual(&ObjInfo.ModificationTime, &m->WrittenModificationTime))
+        {
+            LogFlowFunc(("'%s' is unchanged, skipping\n", m->strFilename.c_str()));
+            return;
+        }
+        vrc = VINF_SUCCESS;
+    }
+
+    m->strWrittenFilename.setNull();
+    writer.write(m->strFilename.c_str(), true /*fSafe*/);
+
+    RTFSOBJINFO ObjInfo;
+    if (   RT_SUCCESS(vrc)
+        && RT_SUCCESS(RTPathQueryInfo(m->strFilename.c_str(), &ObjInfo, RTFSOBJATTRADD_NOTHING)))
+    {
+        m->strWrittenFilename = m->strFilename;
+        memcpy(m->abWrittenDigest, abDigest, sizeof(abDigest));
+        m->cbWritten = ObjInfo.cbObject;
+        m->WrittenModificationTime = ObjInfo.ModificationTime;
+    }
+}
+
 /**
  * Cleans up memory allocated by the internal XML parser. To be called by
  * descendant classes when they're done analyzing the DOM tree to discard it.
@@ -2156,8 +2217,7 @@ void MainConfigFile::write(const com::Utf8Str strFilename)
                               host.llUSBDeviceSources);
 
     // now go write the XML
-    xml::XmlFileWriter writer(*m->pDoc);
-    writer.write(m->strFilename.c_str(), true /*fSafe*/);
+    writeDocument();
 
     m->fFileExists = true;
 
@@ -7472,8 +7532,7 @@ void MachineConfigFile::write(const com::Utf8Str &strFilename)
                         NULL); /* pllElementsWithUuidAttributes */
 
         // now go write the XML
-        xml::XmlFileWriter writer(*m->pDoc);
-        writer.write(m->strFilename.c_str(), true /*fSafe*/);
+        writeDocument();
 
         m->fFileExists = true;
         clearDocument();
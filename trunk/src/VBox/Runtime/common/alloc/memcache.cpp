@@ -36,11 +36,25 @@
 #include <iprt/critsect.h>
 #include <iprt/err.h>
 #include <iprt/mem.h>
+#include <iprt/mp.h>
 #include <iprt/param.h>
+#include <iprt/thread.h>
 
 #include "internal/magics.h"
 
 
+/*********************************************************************************************************************************
+*   Defined Constants And Macros                                                                                                 *
+*********************************************************************************************************************************/
+/** The number of objects a magazine can hold. */
+#define RTMEMCACHE_MAG_ROUNDS       30
+/** The max number of magazine slots per cache. */
+#define RTMEMCACHE_MAX_SLOTS        64
+/** The minimum cMaxObjects value for using magazines.  Smaller caches could
+ * easily end up with most of their objects sitting in magazines. */
+#define RTMEMCACHE_MAG_MIN_OBJECTS  (RTMEMCACHE_MAG_ROUNDS * 16)
+
+
 /*********************************************************************************************************************************
 *   Structures and Typedefs                                                                                                      *
 *********************************************************************************************************************************/
@@ -66,6 +80,59 @@ typedef struct RTMEMCACHEFREEOBJ
 typedef RTMEMCACHEFREEOBJ *PRTMEMCACHEFREEOBJ;
 
 
+/**
+ * A magazine of free objects (Bonwick).
+ *
+ * The objects are marked as used in the allocation bitmaps and have been thru
+ * the constructor, so they can be handed out without touching the pages.
+ */
+typedef struct RTMEMCACHEMAG
+{
+    /** Pointer to the next magazine in the depot list. */
+    struct RTMEMCACHEMAG       *pNext;
+    /** The number of objects in the magazine. */
+    uint32_t                    cRounds;
+    /** The objects. */
+    void                       *apvRounds[RTMEMCACHE_MAG_ROUNDS];
+} RTMEMCACHEMAG;
+/** Pointer to a magazine. */
+typedef RTMEMCACHEMAG *PRTMEMCACHEMAG;
+
+
+/**
+ * A magazine slot.
+ *
+ * Threads are spread over the slots by their native handle, so that with
+ * enough slots each one is mostly used by a single thread and its cache line
+ * stays put.  The slot is owned by setting fBusy; a thread finding it busy
+ * goes to the pages instead of waiting.
+ *
+ * The loaded magazine is partially filled, the previous one is either full or
+ * empty.
+ */
+typedef struct RTMEMCACHESLOT
+{
+    /** Set while a thread is using the slot. */
+    uint32_t volatile           fBusy;
+    uint32_t                    u32Padding;
+    /** The loaded magazine.  NULL until first needed. */
+    PRTMEMCACHEMAG              pLoaded;
+    /** The previous magazine, either full or empty.  NULL until first needed. */
+    PRTMEMCACHEMAG              pPrevious;
+    /** Number of allocations served by the slot. */
+    uint64_t                    cAllocs;
+    /** Number of frees absorbed by the slot. */
+    uint64_t                    cFrees;
+    /** Number of magazine exchanges with the depot. */
+    uint64_t                    cDepotExchanges;
+    /** Pad the structure to a cache line. (ASSUMES CL = 64) */
+    uint8_t                     abPadding[64 - 4 - 4 - 2 * ARCH_BITS / 8 - 3 * 8];
+} RTMEMCACHESLOT;
+AssertCompileSize(RTMEMCACHESLOT, 64);
+/** Pointer to a magazine slot. */
+typedef RTMEMCACHESLOT *PRTMEMCACHESLOT;
+
+
 /**
  * A cache page.
  *
@@ -133,6 +200,32 @@ typedef struct RTMEMCACHEINT
     /** Critical section serializing page allocation and similar. */
     RTCRITSECT                  CritSect;
 
+    /** The magazine slots, cache line aligned.  NULL if not using magazines. */
+    PRTMEMCACHESLOT             paSlots;
+    /** The number of magazine slots (power of two). */
+    uint32_t                    cSlots;
+    /** The number of allocated magazines. */
+    uint32_t volatile           cMagazines;
+    /** The allocation backing paSlots. */
+    void                       *pvSlotsAlloc;
+    /** Critical section protecting the depot. */
+    RTCRITSECT                  DepotCritSect;
+    /** Depot: Full magazines. */
+    PRTMEMCACHEMAG              pDepotFull;
+    /** Depot: Empty magazines. */
+    PRTMEMCACHEMAG              pDepotEmpty;
+    /** Depot: Number of full magazines. */
+    uint32_t volatile           cDepotFull;
+
+    /** Number of allocations not served by a magazine slot. */
+    uint64_t volatile           cSlowAllocs;
+    /** Number of frees not absorbed by a magazine slot. */
+    uint64_t volatile           cSlowFrees;
+    /** Number of times a magazine slot was busy. */
+    uint64_t volatile           cSlotBusy;
+    /** Number of times the magazines were reaped. */
+    uint64_t volatile           cReaps;
+
     /** The total object count. */
     uint32_t volatile           cTotal;
     /** The number of free objects. */
@@ -152,7 +245,9 @@ typedef struct RTMEMCACHEINT
 /*********************************************************************************************************************************
 *   Internal Functions                                                                                                           *
 *********************************************************************************************************************************/
+static void rtMemCacheFreeOne(RTMEMCACHEINT *pThis, void *pvObj);
 static void rtMemCacheFreeList(RTMEMCACHEINT *pThis, PRTMEMCACHEFREEOBJ pHead);
+static void rtMemCacheReap(RTMEMCACHEINT *pThis);
 
 
 RTDECL(int) RTMemCacheCreate(PRTMEMCACHE phMemCache, size_t cbObject, size_t cbAlignment, uint32_t cMaxObjects,
@@ -225,6 +320,50 @@ RTDECL(int) RTMemCacheCreate(PRTMEMCACHE phMemCache, size_t cbObject, size_t cbA
     pThis->pPageHint        = NULL;
     pThis->pFreeTop         = NULL;
 
+    /*
+     * Set up the magazine layer.  We use twice as many slots as there are
+     * CPUs to keep hash collisions between the threads down.
+     */
+    pThis->paSlots          = NULL;
+    pThis->cSlots           = 0;
+    pThis->cMagazines       = 0;
+    pThis->pvSlotsAlloc     = NULL;
+    pThis->pDepotFull       = NULL;
+    pThis->pDepotEmpty      = NULL;
+    pThis->cDepotFull       = 0;
+    pThis->cSlowAllocs      = 0;
+    pThis->cSlowFrees       = 0;
+    pThis->cSlotBusy        = 0;
+    pThis->cReaps           = 0;
+    if (cMaxObjects >= RTMEMCACHE_MAG_MIN_OBJECTS)
+    {
+        uint32_t const cCpus  = RT_MAX(RTMpGetCount(), 1);
+        uint32_t       cSlots = 1;
+        while (cSlots < cCpus * 2 && cSlots < RTMEMCACHE_MAX_SLOTS)
+            cSlots *= 2;
+
+        rc = RTCritSectInit(&pThis->DepotCritSect);
+        if (RT_SUCCESS(rc))
+        {
+            pThis->pvSlotsAlloc = RTMemAllocZ(cSlots * sizeof(RTMEMCACHESLOT) + 64);
+            if (pThis->pvSlotsAlloc)
+            {
+                pThis->paSlots = RT_ALIGN_PT(pThis->pvSlotsAlloc, 64, PRTMEMCACHESLOT);
+                pThis->cSlots  = cSlots;
+            }
+            else
+                rc = VERR_NO_MEMORY;
+            if (RT_FAILURE(rc))
+                RTCritSectDelete(&pThis->DepotCritSect);
+        }
+        if (RT_FAILURE(rc))
+        {
+            RTCritSectDelete(&pThis->CritSect);
+            RTMemFree(pThis);
+            return rc;
+        }
+    }
+
     *phMemCache = pThis;
     return VINF_SUCCESS;
 }
@@ -251,6 +390,29 @@ RTDECL(int) RTMemCacheDestroy(RTMEMCACHE hMemCache)
     AssertReturn(ASMAtomicCmpXchgU32(&pThis->u32Magic, RTMEMCACHE_MAGIC_DEAD, RTMEMCACHE_MAGIC), VERR_INVALID_HANDLE);
     RTCritSectDelete(&pThis->CritSect);
 
+    /* The magazines, the objects in them go away with the pages. */
+    if (pThis->paSlots)
+    {
+        for (uint32_t iSlot = 0; iSlot < pThis->cSlots; iSlot++)
+        {
+            RTMemFree(pThis->paSlots[iSlot].pLoaded);
+            RTMemFree(pThis->paSlots[iSlot].pPrevious);
+        }
+        for (unsigned iList = 0; iList < 2; iList++)
+        {
+            PRTMEMCACHEMAG pMag = iList == 0 ? pThis->pDepotFull : pThis->pDepotEmpty;
+            while (pMag)
+            {
+                PRTMEMCACHEMAG pFreeMe = pMag;
+                pMag = pMag->pNext;
+                RTMemFree(pFreeMe);
+            }
+        }
+        RTMemFree(pThis->pvSlotsAlloc);
+        pThis->paSlots = NULL;
+        RTCritSectDelete(&pThis->DepotCritSect);
+    }
+
     while (pThis->pPageHead)
     {
         PRTMEMCACHEPAGE pPage = pThis->pPageHead;
@@ -360,12 +522,15 @@ DECL_FORCE_INLINE(int32_t) rtMemCacheGrabObj(PRTMEMCACHEPAGE pPage)
 }
 
 
-RTDECL(int) RTMemCacheAllocEx(RTMEMCACHE hMemCache, void **ppvObj)
+/**
+ * Allocates an object from the free stack or the pages.
+ *
+ * @returns IPRT status code.
+ * @param   pThis               The memory cache instance.
+ * @param   ppvObj              Where to return the object.
+ */
+static int rtMemCacheAllocFromPages(RTMEMCACHEINT *pThis, void **ppvObj)
 {
-    RTMEMCACHEINT *pThis = hMemCache;
-    AssertPtrReturn(pThis, VERR_INVALID_PARAMETER);
-    AssertReturn(pThis->u32Magic == RTMEMCACHE_MAGIC, VERR_INVALID_PARAMETER);
-
     /*
      * Try grab a free object from the stack.
      */
@@ -468,11 +633,11 @@ RTDECL(int) RTMemCacheAllocEx(RTMEMCACHE hMemCache, void **ppvObj)
     if (   pThis->pfnCtor
         && !ASMAtomicBitTestAndSet(pPage->pbmCtor, iObj))
     {
-        int rc = pThis->pfnCtor(hMemCache, pvObj, pThis->pvUser);
+        int rc = pThis->pfnCtor(pThis, pvObj, pThis->pvUser);
         if (RT_FAILURE(rc))
         {
             ASMAtomicBitClear(pPage->pbmCtor, iObj);
-            RTMemCacheFree(pThis, pvObj);
+            rtMemCacheFreeOne(pThis, pvObj);
             return rc;
         }
     }
@@ -482,6 +647,190 @@ RTDECL(int) RTMemCacheAllocEx(RTMEMCACHE hMemCache, void **ppvObj)
 }
 
 
+/**
+ * Tries to take ownership of the magazine slot of the calling thread.
+ *
+ * @returns Pointer to the slot on success, NULL if busy.
+ * @param   pThis               The memory cache instance.
+ */
+DECL_FORCE_INLINE(PRTMEMCACHESLOT) rtMemCacheSlotTryEnter(RTMEMCACHEINT *pThis)
+{
+    uint64_t const uHash = (uint64_t)(uintptr_t)RTThreadNativeSelf() * UINT64_C(0x9e3779b97f4a7c15);
+    uint32_t const iSlot = (uint32_t)(uHash >> 40) & (pThis->cSlots - 1);
+    PRTMEMCACHESLOT pSlot = &pThis->paSlots[iSlot];
+    if (ASMAtomicCmpXchgU32(&pSlot->fBusy, true, false))
+        return pSlot;
+
+    /* Try the neighbour before giving up. */
+    pSlot = &pThis->paSlots[(iSlot + 1) & (pThis->cSlots - 1)];
+    if (ASMAtomicCmpXchgU32(&pSlot->fBusy, true, false))
+        return pSlot;
+
+    ASMAtomicIncU64(&pThis->cSlotBusy);
+    return NULL;
+}
+
+
+/**
+ * Releases a magazine slot.
+ *
+ * @param   pSlot               The slot.
+ */
+DECL_FORCE_INLINE(void) rtMemCacheSlotLeave(PRTMEMCACHESLOT pSlot)
+{
+    ASMAtomicWriteU32(&pSlot->fBusy, false);
+}
+
+
+/**
+ * Exchanges an empty magazine for a full one from the depot.
+ *
+ * @returns Full magazine, NULL if the depot hasn't got any.
+ * @param   pThis               The memory cache instance.
+ * @param   pEmpty              The empty magazine to give to the depot if we
+ *                              get a full one.  Optional.
+ */
+static PRTMEMCACHEMAG rtMemCacheDepotSwapForFull(RTMEMCACHEINT *pThis, PRTMEMCACHEMAG pEmpty)
+{
+    RTCritSectEnter(&pThis->DepotCritSect);
+    PRTMEMCACHEMAG pFull = pThis->pDepotFull;
+    if (pFull)
+    {
+        pThis->pDepotFull = pFull->pNext;
+        pThis->cDepotFull--;
+        if (pEmpty)
+        {
+            Assert(!pEmpty->cRounds);
+            pEmpty->pNext      = pThis->pDepotEmpty;
+            pThis->pDepotEmpty = pEmpty;
+        }
+        pFull->pNext = NULL;
+    }
+    RTCritSectLeave(&pThis->DepotCritSect);
+    return pFull;
+}
+
+
+/**
+ * Exchanges a full magazine for an empty one from the depot, allocating a new
+ * magazine if the depot is out of empty ones.
+ *
+ * @returns Empty magazine, NULL if out of memory.
+ * @param   pThis               The memory cache instance.
+ * @param   pFull               The full magazine to give to the depot if we
+ *                              get an empty one.  Optional.
+ */
+static PRTMEMCACHEMAG rtMemCacheDepotSwapForEmpty(RTMEMCACHEINT *pThis, PRTMEMCACHEMAG pFull)
+{
+    RTCritSectEnter(&pThis->DepotCritSect);
+    PRTMEMCACHEMAG pEmpty = pThis->pDepotEmpty;
+    if (pEmpty)
+        pThis->pDepotEmpty = pEmpty->pNext;
+    else
+    {
+        RTCritSectLeave(&pThis->DepotCritSect);
+        pEmpty = (PRTMEMCACHEMAG)RTMemAlloc(sizeof(*pEmpty));
+        if (!pEmpty)
+            return NULL;
+        pEmpty->cRounds = 0;
+        ASMAtomicIncU32(&pThis->cMagazines);
+        RTCritSectEnter(&pThis->DepotCritSect);
+    }
+    if (pFull)
+    {
+        Assert(pFull->cRounds == RTMEMCACHE_MAG_ROUNDS);
+        pFull->pNext      = pThis->pDepotFull;
+        pThis->pDepotFull = pFull;
+        pThis->cDepotFull++;
+    }
+    RTCritSectLeave(&pThis->DepotCritSect);
+
+    pEmpty->pNext = NULL;
+    return pEmpty;
+}
+
+
+/**
+ * Allocates an object from a magazine slot.
+ *
+ * @returns Pointer to the object, NULL if the slot and depot are out of
+ *          objects.
+ * @param   pThis               The memory cache instance.
+ * @param   pSlot               The slot, owned by the caller.
+ */
+DECL_FORCE_INLINE(void *) rtMemCacheSlotAlloc(RTMEMCACHEINT *pThis, PRTMEMCACHESLOT pSlot)
+{
+    PRTMEMCACHEMAG pMag = pSlot->pLoaded;
+    if (RT_UNLIKELY(!pMag || !pMag->cRounds))
+    {
+        PRTMEMCACHEMAG pPrev = pSlot->pPrevious;
+        if (pPrev && pPrev->cRounds)
+        {
+            /* The previous magazine is full, swap. */
+            pSlot->pPrevious = pMag;
+            pSlot->pLoaded   = pMag = pPrev;
+        }
+        else
+        {
+            /* Both are empty, try get a full one from the depot. */
+            if (!ASMAtomicUoReadU32(&pThis->cDepotFull))
+                return NULL;
+            PRTMEMCACHEMAG pFull = rtMemCacheDepotSwapForFull(pThis, pPrev);
+            if (!pFull)
+                return NULL;
+            pSlot->pPrevious = pMag;
+            pSlot->pLoaded   = pMag = pFull;
+            pSlot->cDepotExchanges++;
+        }
+    }
+
+    pSlot->cAllocs++;
+    return pMag->apvRounds[--pMag->cRounds];
+}
+
+
+RTDECL(int) RTMemCacheAllocEx(RTMEMCACHE hMemCache, void **ppvObj)
+{
+    RTMEMCACHEINT *pThis = hMemCache;
+    AssertPtrReturn(pThis, VERR_INVALID_PARAMETER);
+    AssertReturn(pThis->u32Magic == RTMEMCACHE_MAGIC, VERR_INVALID_PARAMETER);
+
+    /*
+     * Try the magazines first.
+     */
+    if (pThis->paSlots)
+    {
+        PRTMEMCACHESLOT pSlot = rtMemCacheSlotTryEnter(pThis);
+        if (pSlot)
+        {
+            void *pvObj = rtMemCacheSlotAlloc(pThis, pSlot);
+            rtMemCacheSlotLeave(pSlot);
+            if (pvObj)
+            {
+                *ppvObj = pvObj;
+                return VINF_SUCCESS;
+            }
+        }
+    }
+
+    /*
+     * Go to the pages.  If that fails, the objects may be stuck in the
+     * magazines of other threads, so reap them and retry.
+     */
+    int rc = rtMemCacheAllocFromPages(pThis, ppvObj);
+    if (   RT_FAILURE(rc)
+        && pThis->paSlots
+        && (rc == VERR_MEM_CACHE_MAX_SIZE || rc == VERR_NO_MEMORY))
+    {
+        rtMemCacheReap(pThis);
+        rc = rtMemCacheAllocFromPages(pThis, ppvObj);
+    }
+    if (RT_SUCCESS(rc))
+        ASMAtomicIncU64(&pThis->cSlowAllocs);
+    return rc;
+}
+
+
 RTDECL(void *) RTMemCacheAlloc(RTMEMCACHE hMemCache)
 {
     void *pvObj;
@@ -544,6 +893,94 @@ static void rtMemCacheFreeList(RTMEMCACHEINT *pThis, PRTMEMCACHEFREEOBJ pHead)
 
 
 
+/**
+ * Empties a magazine, really freeing the objects in it.
+ *
+ * @param   pThis               The memory cache.
+ * @param   pMag                The magazine.  NULL is ignored.
+ */
+static void rtMemCacheMagEmpty(RTMEMCACHEINT *pThis, PRTMEMCACHEMAG pMag)
+{
+    if (pMag)
+        while (pMag->cRounds > 0)
+            rtMemCacheFreeOne(pThis, pMag->apvRounds[--pMag->cRounds]);
+}
+
+
+/**
+ * Returns all the objects in the magazines to the pages.
+ *
+ * This is done when an allocation fails, as the cache may have run out
+ * because the free objects are sitting in magazines the caller cannot get at.
+ *
+ * @param   pThis               The memory cache.
+ */
+static void rtMemCacheReap(RTMEMCACHEINT *pThis)
+{
+    for (uint32_t iSlot = 0; iSlot < pThis->cSlots; iSlot++)
+    {
+        PRTMEMCACHESLOT pSlot = &pThis->paSlots[iSlot];
+        while (!ASMAtomicCmpXchgU32(&pSlot->fBusy, true, false))
+            RTThreadYield();
+        rtMemCacheMagEmpty(pThis, pSlot->pLoaded);
+        rtMemCacheMagEmpty(pThis, pSlot->pPrevious);
+        rtMemCacheSlotLeave(pSlot);
+    }
+
+    RTCritSectEnter(&pThis->DepotCritSect);
+    while (pThis->pDepotFull)
+    {
+        PRTMEMCACHEMAG pMag = pThis->pDepotFull;
+        pThis->pDepotFull = pMag->pNext;
+        rtMemCacheMagEmpty(pThis, pMag);
+        pMag->pNext = pThis->pDepotEmpty;
+        pThis->pDepotEmpty = pMag;
+    }
+    pThis->cDepotFull = 0;
+    RTCritSectLeave(&pThis->DepotCritSect);
+
+    ASMAtomicIncU64(&pThis->cReaps);
+}
+
+
+/**
+ * Frees an object into a magazine slot.
+ *
+ * @returns true if freed, false if we couldn't get an empty magazine.
+ * @param   pThis               The memory cache instance.
+ * @param   pSlot               The slot, owned by the caller.
+ * @param   pvObj               The object to free.
+ */
+DECL_FORCE_INLINE(bool) rtMemCacheSlotFree(RTMEMCACHEINT *pThis, PRTMEMCACHESLOT pSlot, void *pvObj)
+{
+    PRTMEMCACHEMAG pMag = pSlot->pLoaded;
+    if (RT_UNLIKELY(!pMag || pMag->cRounds >= RTMEMCACHE_MAG_ROUNDS))
+    {
+        PRTMEMCACHEMAG pPrev = pSlot->pPrevious;
+        if (pPrev && pPrev->cRounds < RTMEMCACHE_MAG_ROUNDS)
+        {
+            /* The previous magazine is empty, swap. */
+            pSlot->pPrevious = pMag;
+            pSlot->pLoaded   = pMag = pPrev;
+        }
+        else
+        {
+            /* Both are full, give one to the depot for an empty one. */
+            PRTMEMCACHEMAG pEmpty = rtMemCacheDepotSwapForEmpty(pThis, pPrev);
+            if (!pEmpty)
+                return false;
+            pSlot->pPrevious = pMag;
+            pSlot->pLoaded   = pMag = pEmpty;
+            pSlot->cDepotExchanges++;
+        }
+    }
+
+    pMag->apvRounds[pMag->cRounds++] = pvObj;
+    pSlot->cFrees++;
+    return true;
+}
+
+
 RTDECL(void) RTMemCacheFree(RTMEMCACHE hMemCache, void *pvObj)
 {
     if (!pvObj)
@@ -556,12 +993,10 @@ RTDECL(void) RTMemCacheFree(RTMEMCACHE hMemCache, void *pvObj)
     AssertPtr(pvObj);
     Assert(RT_ALIGN_P(pvObj, pThis->cbAlignment) == pvObj);
 
-    if (!pThis->fUseFreeList)
-        rtMemCacheFreeOne(pThis, pvObj);
-    else
+#ifdef RT_STRICT
+    if (pThis->fUseFreeList || pThis->paSlots)
     {
-# ifdef RT_STRICT
-        /* This is the same as the other branch, except it's not actually freed. */
+        /* This is the same as rtMemCacheFreeOne, except it's not actually freed. */
         PRTMEMCACHEPAGE pPage = (PRTMEMCACHEPAGE)(((uintptr_t)pvObj) & ~(uintptr_t)PAGE_OFFSET_MASK);
         Assert(pPage->pCache == pThis);
         Assert(ASMAtomicUoReadS32(&pPage->cFree) < (int32_t)pThis->cPerPage);
@@ -570,8 +1005,29 @@ RTDECL(void) RTMemCacheFree(RTMEMCACHE hMemCache, void *pvObj)
         Assert(iObj * pThis->cbObject == offObj);
         Assert(iObj < pThis->cPerPage);
         AssertReturnVoid(ASMBitTest(pPage->pbmAlloc, (int32_t)iObj));
-# endif
+    }
+#endif
 
+    /*
+     * Try put it in a magazine.
+     */
+    if (pThis->paSlots)
+    {
+        PRTMEMCACHESLOT pSlot = rtMemCacheSlotTryEnter(pThis);
+        if (pSlot)
+        {
+            bool const fFreed = rtMemCacheSlotFree(pThis, pSlot, pvObj);
+            rtMemCacheSlotLeave(pSlot);
+            if (fFreed)
+                return;
+        }
+    }
+    ASMAtomicIncU64(&pThis->cSlowFrees);
+
+    if (!pThis->fUseFreeList)
+        rtMemCacheFreeOne(pThis, pvObj);
+    else
+    {
         /*
          * Push it onto the free stack.
          */
@@ -583,3 +1039,51 @@ RTDECL(void) RTMemCacheFree(RTMEMCACHE hMemCache, void *pvObj)
     }
 }
 
+
+
+RTDECL(int) RTMemCacheQueryStats(RTMEMCACHE hMemCache, PRTMEMCACHESTATS pStats)
+{
+    RTMEMCACHEINT *pThis = hMemCache;
+    AssertPtrReturn(pThis, VERR_INVALID_HANDLE);
+    AssertReturn(pThis->u32Magic == RTMEMCACHE_MAGIC, VERR_INVALID_HANDLE);
+    AssertPtrReturn(pStats, VERR_INVALID_POINTER);
+
+    int32_t const cFree = ASMAtomicUoReadS32(&pThis->cFree);
+    pStats->cbObject        = pThis->cbObject;
+    pStats->cTotal          = ASMAtomicUoReadU32(&pThis->cTotal);
+    pStats->cFree           = cFree > 0 ? (uint32_t)cFree : 0;
+    pStats->cInMagazines    = 0;
+    pStats->cMagazines      = ASMAtomicUoReadU32(&pThis->cMagazines);
+    pStats->cSlots          = pThis->cSlots;
+    pStats->cAllocs         = ASMAtomicUoReadU64(&pThis->cSlowAllocs);
+    pStats->cFrees          = ASMAtomicUoReadU64(&pThis->cSlowFrees);
+    pStats->cMagazineAllocs = 0;
+    pStats->cMagazineFrees  = 0;
+    pStats->cDepotExchanges = 0;
+    pStats->cSlotBusy       = ASMAtomicUoReadU64(&pThis->cSlotBusy);
+    pStats->cReaps          = ASMAtomicUoReadU64(&pThis->cReaps);
+
+    /*
+     * Sum up the slots without taking them, the numbers are only approximate
+     * anyway.  Magazines are not freed before the cache is destroyed, so it's
+     * safe to peek at them.
+     */
+    for (uint32_t iSlot = 0; iSlot < pThis->cSlots; iSlot++)
+    {
+        PRTMEMCACHESLOT pSlot = &pThis->paSlots[iSlot];
+        pStats->cMagazineAllocs += pSlot->cAllocs;
+        pStats->cMagazineFrees  += pSlot->cFrees;
+        pStats->cDepotExchanges += pSlot->cDepotExchanges;
+        PRTMEMCACHEMAG pMag = ASMAtomicUoReadPtrT(&pSlot->pLoaded, PRTMEMCACHEMAG);
+        if (pMag)
+            pStats->cInMagazines += pMag->cRounds;
+        pMag = ASMAtomicUoReadPtrT(&pSlot->pPrevious, PRTMEMCACHEMAG);
+        if (pMag)
+            pStats->cInMagazines += pMag->cRounds;
+    }
+    pStats->cInMagazines += ASMAtomicUoReadU32(&pThis->cDepotFull) * RTMEMCACHE_MAG_ROUNDS;
+    pStats->cAllocs      += pStats->cMagazineAllocs;
+    pStats->cFrees       += pStats->cMagazineFrees;
+
+    return VINF_SUCCESS;
+}
@@ -179,6 +179,8 @@ static const RTDBGCFGU64MNEMONIC g_aDbgCfgFlags[] =
     {   RTDBGCFG_FLAGS_NO_RECURSIV_SEARCH,      RT_STR_TUPLE("norec"),          true  },
     {   RTDBGCFG_FLAGS_NO_RECURSIV_SRC_SEARCH,  RT_STR_TUPLE("recsrc"),         false },
     {   RTDBGCFG_FLAGS_NO_RECURSIV_SRC_SEARCH,  RT_STR_TUPLE("norecsrc"),       true  },
+    {   RTDBGCFG_FLAGS_NO_LAZY_LOADING,         RT_STR_TUPLE("lazy"),           false },
+    {   RTDBGCFG_FLAGS_NO_LAZY_LOADING,         RT_STR_TUPLE("nolazy"),         true  },
     {   0,                                      NULL, 0,                        false }
 };
 
@@ -807,6 +807,13 @@ RTDECL(int) RTDbgModCreateFromImage(PRTDBGMOD phDbgMod, const char *pszFilename,
     if (!pszName)
         pszName = RTPathFilenameEx(pszFilename, RTPATH_STR_F_STYLE_DOS);
 
+    uint64_t fDbgCfg = 0;
+    if (hDbgCfg)
+    {
+        rc = RTDbgCfgQueryUInt(hDbgCfg, RTDBGCFGPROP_FLAGS, &fDbgCfg);
+        AssertRCReturn(rc, rc);
+    }
+
     /*
      * Allocate a new module instance.
      */
@@ -815,6 +822,7 @@ RTDECL(int) RTDbgModCreateFromImage(PRTDBGMOD phDbgMod, const char *pszFilename,
         return VERR_NO_MEMORY;
     pDbgMod->u32Magic = RTDBGMOD_MAGIC;
     pDbgMod->cRefs = 1;
+    pDbgMod->fNoLazyLoading = RT_BOOL(fDbgCfg & RTDBGCFG_FLAGS_NO_LAZY_LOADING);
     rc = RTCritSectInit(&pDbgMod->CritSect);
     if (RT_SUCCESS(rc))
     {
@@ -1107,6 +1115,7 @@ RTDECL(int) RTDbgModCreateFromPeImage(PRTDBGMOD phDbgMod, const char *pszFilenam
         return VERR_NO_MEMORY;
     pDbgMod->u32Magic = RTDBGMOD_MAGIC;
     pDbgMod->cRefs = 1;
+    pDbgMod->fNoLazyLoading = RT_BOOL(fDbgCfg & RTDBGCFG_FLAGS_NO_LAZY_LOADING);
     rc = RTCritSectInit(&pDbgMod->CritSect);
     if (RT_SUCCESS(rc))
     {
@@ -1414,6 +1423,7 @@ RTDECL(int) RTDbgModCreateFromMachOImage(PRTDBGMOD phDbgMod, const char *pszFile
         return VERR_NO_MEMORY;
     pDbgMod->u32Magic = RTDBGMOD_MAGIC;
     pDbgMod->cRefs = 1;
+    pDbgMod->fNoLazyLoading = RT_BOOL(fDbgCfg & RTDBGCFG_FLAGS_NO_LAZY_LOADING);
     rc = RTCritSectInit(&pDbgMod->CritSect);
     if (RT_SUCCESS(rc))
     {
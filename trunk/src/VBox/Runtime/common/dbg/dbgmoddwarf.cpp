@@ -43,6 +43,7 @@
 # include <iprt/memcache.h>
 #endif
 #include <iprt/path.h>
+#include <iprt/sort.h>
 #include <iprt/string.h>
 #include <iprt/strcache.h>
 #include "internal/dbgmod.h"
@@ -421,6 +422,54 @@ typedef struct RTDBGDWARFSEG
 /** Pointer to segment info. */
 typedef RTDBGDWARFSEG *PRTDBGDWARFSEG;
 
+/**
+ * Compilation unit index entry, for loading units on demand.
+ */
+typedef struct RTDWARFUNIT
+{
+    /** The offset of the unit header in debug_info. */
+    uint64_t            offUnit;
+    /** The offset of the line number program in debug_line, UINT64_MAX if none. */
+    uint64_t            offLine;
+    /** Set when the unit has been loaded into the container. */
+    bool                fLoaded;
+    /** Set if the unit has entries in the address range index. */
+    bool                fHaveRange;
+} RTDWARFUNIT;
+/** Pointer to a compilation unit index entry. */
+typedef RTDWARFUNIT *PRTDWARFUNIT;
+
+/**
+ * Address range index entry, maps an RVA range to a compilation unit.
+ */
+typedef struct RTDWARFUNITRANGE
+{
+    /** The first RVA in the range. */
+    RTUINTPTR           uRvaFirst;
+    /** The last RVA in the range (inclusive). */
+    RTUINTPTR           uRvaLast;
+    /** The highest uRvaLast of this and all preceding entries, for dealing
+     * with overlapping ranges in the binary search. */
+    RTUINTPTR           uRvaLastMax;
+    /** The compilation unit index. */
+    uint32_t            iUnit;
+} RTDWARFUNITRANGE;
+/** Pointer to an address range index entry. */
+typedef RTDWARFUNITRANGE *PRTDWARFUNITRANGE;
+
+/**
+ * Name index entry, maps a public name to a compilation unit.
+ */
+typedef struct RTDWARFUNITNAME
+{
+    /** The name (points into the debug_pubnames section). */
+    const char         *pszName;
+    /** The compilation unit index. */
+    uint32_t            iUnit;
+} RTDWARFUNITNAME;
+/** Pointer to a name index entry. */
+typedef RTDWARFUNITNAME *PRTDWARFUNITNAME;
+
 
 /**
  * The instance data of the DWARF reader.
@@ -482,6 +531,32 @@ typedef struct RTDBGMODDWARF
     uint32_t                cSegs;
     /** Pointer to segments if iWatcomPass isn't -1. */
     PRTDBGDWARFSEG          paSegs;
+
+    /** @name Lazy loading.
+     * When set up, the compilation units are only loaded into the container
+     * when a lookup needs them and the sections stay mapped till close.
+     * @{ */
+    /** Set if units are loaded on demand. */
+    bool                    fLazy;
+    /** Set when all the units have been loaded. */
+    bool                    fAllUnitsLoaded;
+    /** The number of compilation units. */
+    uint32_t                cUnits;
+    /** The compilation units, sorted by offset. */
+    PRTDWARFUNIT            paUnits;
+    /** The number of address range index entries. */
+    uint32_t                cUnitRanges;
+    /** The address range index, sorted by first RVA. */
+    PRTDWARFUNITRANGE       paUnitRanges;
+    /** The number of name index entries. */
+    uint32_t                cUnitNames;
+    /** The name index, sorted by name. */
+    PRTDWARFUNITNAME        paUnitNames;
+    /** The image symbol table, kept apart from hCnt until all the units have
+     * been loaded so that the placeholder symbols don't clash with the DWARF
+     * ones added later.  NIL_RTDBGMOD when merged or not lazy. */
+    RTDBGMOD                hCntImgSyms;
+    /** @} */
 #ifdef RTDBGMODDWARF_WITH_MEM_CACHE
     /** DIE allocators. */
     struct
@@ -4435,6 +4510,27 @@ static int rtDwarfInfo_LoadAll(PRTDBGMODDWARF pThis)
 
 #define RTDBGDWARF_SYM_ENUM_BASE_ADDRESS  UINT32_C(0x200000)
 
+/**
+ * Adds an image symbol to the container unless there already is a symbol at
+ * that address.
+ *
+ * @returns IPRT status code.
+ * @param   pThis               The DWARF instance.
+ * @param   pszSymbol           The symbol name.
+ * @param   uRva                The symbol RVA.
+ */
+static int rtDwarfSyms_AddImageSymbol(PRTDBGMODDWARF pThis, const char *pszSymbol, RTUINTPTR uRva)
+{
+    RTDBGSYMBOL SymInfo;
+    RTINTPTR    offDisp;
+    int rc = RTDbgModSymbolByAddr(pThis->hCnt, RTDBGSEGIDX_RVA, uRva, RTDBGSYMADDR_FLAGS_LESS_OR_EQUAL, &offDisp, &SymInfo);
+    if (   RT_FAILURE(rc)
+        || offDisp != 0)
+        rc = RTDbgModSymbolAdd(pThis->hCnt, pszSymbol, RTDBGSEGIDX_RVA, uRva, 1, 0 /*fFlags*/, NULL /*piOrdinal*/);
+    return rc;
+}
+
+
 /** @callback_method_impl{FNRTLDRENUMSYMS,
  *  Adds missing symbols from the image symbol table.} */
 static DECLCALLBACK(int) rtDwarfSyms_EnumSymbolsCallback(RTLDRMOD hLdrMod, const char *pszSymbol, unsigned uSymbol,
@@ -4448,15 +4544,12 @@ static DECLCALLBACK(int) rtDwarfSyms_EnumSymbolsCallback(RTLDRMOD hLdrMod, const
     if (   Value >= RTDBGDWARF_SYM_ENUM_BASE_ADDRESS
         && uRva  <  _1G)
     {
-        RTDBGSYMBOL SymInfo;
-        RTINTPTR    offDisp;
-        int rc = RTDbgModSymbolByAddr(pThis->hCnt, RTDBGSEGIDX_RVA, uRva, RTDBGSYMADDR_FLAGS_LESS_OR_EQUAL, &offDisp, &SymInfo);
-        if (   RT_FAILURE(rc)
-            || offDisp != 0)
-        {
-            rc = RTDbgModSymbolAdd(pThis->hCnt, pszSymbol, RTDBGSEGIDX_RVA, uRva, 1, 0 /*fFlags*/, NULL /*piOrdinal*/);
-            Log(("Dwarf: Symbol #%05u %#018RTptr %s [%Rrc]\n", uSymbol, Value, pszSymbol, rc)); NOREF(rc);
-        }
+        int rc;
+        if (pThis->hCntImgSyms != NIL_RTDBGMOD)
+            rc = RTDbgModSymbolAdd(pThis->hCntImgSyms, pszSymbol, RTDBGSEGIDX_RVA, uRva, 1, 0 /*fFlags*/, NULL /*piOrdinal*/);
+        else
+            rc = rtDwarfSyms_AddImageSymbol(pThis, pszSymbol, uRva);
+        Log(("Dwarf: Symbol #%05u %#018RTptr %s [%Rrc]\n", uSymbol, Value, pszSymbol, rc)); NOREF(rc);
     }
     else
         Log(("Dwarf: Symbol #%05u %#018RTptr '%s' [SKIPPED - INVALID ADDRESS]\n", uSymbol, Value, pszSymbol));
@@ -4465,6 +4558,35 @@ static DECLCALLBACK(int) rtDwarfSyms_EnumSymbolsCallback(RTLDRMOD hLdrMod, const
 
 
 
+/**
+ * Creates the container holding the image symbols while loading units on
+ * demand, with the same segments as the main one.
+ *
+ * @returns IPRT status code.
+ * @param   pThis               The DWARF instance.
+ */
+static int rtDwarfSyms_CreateImageSymContainer(PRTDBGMODDWARF pThis)
+{
+    int rc = RTDbgModCreate(&pThis->hCntImgSyms, RTDbgModName(pThis->hCnt), 0 /*cbSeg*/, 0 /*fFlags*/);
+    if (RT_FAILURE(rc))
+        return rc;
+    uint32_t const cSegs = RTDbgModSegmentCount(pThis->hCnt);
+    for (uint32_t iSeg = 0; iSeg < cSegs && RT_SUCCESS(rc); iSeg++)
+    {
+        RTDBGSEGMENT SegInfo;
+        rc = RTDbgModSegmentByIndex(pThis->hCnt, iSeg, &SegInfo);
+        if (RT_SUCCESS(rc))
+            rc = RTDbgModSegmentAdd(pThis->hCntImgSyms, SegInfo.uRva, SegInfo.cb, SegInfo.szName, SegInfo.fFlags, NULL);
+    }
+    if (RT_FAILURE(rc))
+    {
+        RTDbgModRelease(pThis->hCntImgSyms);
+        pThis->hCntImgSyms = NIL_RTDBGMOD;
+    }
+    return rc;
+}
+
+
 /**
  * Loads additional symbols from the pubnames section and the executable image.
  *
@@ -4495,18 +4617,22 @@ static int rtDwarfSyms_LoadAll(PRTDBGMODDWARF pThis)
     }
 
     /*
-     * The executable image.
+     * The executable image.  When loading units on demand, the symbols go
+     * into a separate container for now, see rtDwarfUnits_MergeImageSyms.
      */
     if (   pThis->pImgMod
         && pThis->pImgMod->pImgVt->pfnEnumSymbols
         && pThis->iWatcomPass != 1
         && RT_SUCCESS(rc))
     {
-        rc = pThis->pImgMod->pImgVt->pfnEnumSymbols(pThis->pImgMod,
-                                                    RTLDR_ENUM_SYMBOL_FLAGS_ALL | RTLDR_ENUM_SYMBOL_FLAGS_NO_FWD,
-                                                    RTDBGDWARF_SYM_ENUM_BASE_ADDRESS,
-                                                    rtDwarfSyms_EnumSymbolsCallback,
-                                                    pThis);
+        if (pThis->fLazy && !pThis->fAllUnitsLoaded)
+            rc = rtDwarfSyms_CreateImageSymContainer(pThis);
+        if (RT_SUCCESS(rc))
+            rc = pThis->pImgMod->pImgVt->pfnEnumSymbols(pThis->pImgMod,
+                                                        RTLDR_ENUM_SYMBOL_FLAGS_ALL | RTLDR_ENUM_SYMBOL_FLAGS_NO_FWD,
+                                                        RTDBGDWARF_SYM_ENUM_BASE_ADDRESS,
+                                                        rtDwarfSyms_EnumSymbolsCallback,
+                                                        pThis);
     }
 
     return rc;
@@ -4515,6 +4641,632 @@ static int rtDwarfSyms_LoadAll(PRTDBGMODDWARF pThis)
 
 
 
+
+/*
+ *
+ * On demand loading of compilation units.
+ * On demand loading of compilation units.
+ * On demand loading of compilation units.
+ *
+ *
+ */
+
+/**
+ * Looks up a compilation unit by its debug_info offset.
+ *
+ * @returns Unit index, UINT32_MAX if not found.
+ * @param   pThis               The DWARF instance.
+ * @param   offUnit             The offset of the unit header.
+ */
+static uint32_t rtDwarfUnits_LookupByOffset(PRTDBGMODDWARF pThis, uint64_t offUnit)
+{
+    uint32_t iStart = 0;
+    uint32_t iEnd   = pThis->cUnits;
+    while (iStart < iEnd)
+    {
+        uint32_t const i = iStart + (iEnd - iStart) / 2;
+        if (pThis->paUnits[i].offUnit < offUnit)
+            iStart = i + 1;
+        else if (pThis->paUnits[i].offUnit > offUnit)
+            iEnd = i;
+        else
+            return i;
+    }
+    return UINT32_MAX;
+}
+
+
+/**
+ * Adds an entry to the address range index.
+ *
+ * Ranges which cannot be translated to an RVA are quietly dropped, the unit
+ * will then be loaded up front.
+ *
+ * @returns IPRT status code.
+ * @param   pThis               The DWARF instance.
+ * @param   pcAlloced           The number of allocated index entries.
+ * @param   iUnit               The compilation unit index.
+ * @param   uLowAddress         The first link address.
+ * @param   uHighAddress        The link address following the range.
+ */
+static int rtDwarfUnits_AddRange(PRTDBGMODDWARF pThis, uint32_t *pcAlloced, uint32_t iUnit,
+                                 uint64_t uLowAddress, uint64_t uHighAddress)
+{
+    if (uHighAddress <= uLowAddress)
+        return VINF_SUCCESS;
+
+    RTDBGSEGIDX iSeg;
+    RTUINTPTR   offSeg;
+    int rc = rtDbgModDwarfLinkAddressToSegOffset(pThis, 0 /*uSegment*/, uLowAddress, &iSeg, &offSeg);
+    if (RT_FAILURE(rc) || iSeg > RTDBGSEGIDX_LAST)
+        return VINF_SUCCESS;
+    RTUINTPTR uRva = RTDbgModSegmentRva(pThis->hCnt, iSeg);
+    if (uRva == RTUINTPTR_MAX)
+        return VINF_SUCCESS;
+    uRva += offSeg;
+
+    if (pThis->cUnitRanges >= *pcAlloced)
+    {
+        uint32_t const cNew = *pcAlloced ? *pcAlloced * 2 : 256;
+        void *pvNew = RTMemRealloc(pThis->paUnitRanges, cNew * sizeof(pThis->paUnitRanges[0]));
+        if (!pvNew)
+            return VERR_NO_MEMORY;
+        pThis->paUnitRanges = (PRTDWARFUNITRANGE)pvNew;
+        *pcAlloced = cNew;
+    }
+
+    PRTDWARFUNITRANGE pRange = &pThis->paUnitRanges[pThis->cUnitRanges++];
+    pRange->uRvaFirst   = uRva;
+    pRange->uRvaLast    = uRva + (RTUINTPTR)(uHighAddress - uLowAddress - 1);
+    pRange->uRvaLastMax = pRange->uRvaLast;
+    pRange->iUnit       = iUnit;
+    pThis->paUnits[iUnit].fHaveRange = true;
+    return VINF_SUCCESS;
+}
+
+
+/**
+ * Adds the address ranges of a compile unit DIE to the address range index.
+ *
+ * This is used when there is no debug_aranges section.
+ *
+ * @returns IPRT status code.
+ * @param   pThis               The DWARF instance.
+ * @param   pcAlloced           The number of allocated index entries.
+ * @param   iUnit               The compilation unit index.
+ * @param   pPcRange            The PC range of the compile unit DIE.
+ * @param   cbNativeAddr        The native address size of the unit.
+ */
+static int rtDwarfUnits_AddDieRanges(PRTDBGMODDWARF pThis, uint32_t *pcAlloced, uint32_t iUnit,
+                                     PCRTDWARFADDRRANGE pPcRange, uint8_t cbNativeAddr)
+{
+    if (!pPcRange->fHaveRanges)
+    {
+        if (!pPcRange->fHaveLowAddress || !pPcRange->fHaveHighAddress)
+            return VINF_SUCCESS;
+        uint64_t uHighAddress = pPcRange->uHighAddress;
+        if (!pPcRange->fHaveHighIsAddress)
+            uHighAddress += pPcRange->uLowAddress;
+        return rtDwarfUnits_AddRange(pThis, pcAlloced, iUnit, pPcRange->uLowAddress, uHighAddress);
+    }
+
+    /*
+     * Walk the range list.  A begin address of all ones selects a new base.
+     */
+    RTDWARFCURSOR Cursor;
+    int rc = rtDwarfCursor_InitWithOffset(&Cursor, pThis, krtDbgModDwarfSect_ranges,
+                                          (uint32_t)(pPcRange->pbRanges
+                                                     - (uint8_t const *)pThis->aSections[krtDbgModDwarfSect_ranges].pv));
+    if (RT_FAILURE(rc))
+        return rc;
+    Cursor.cbNativeAddr = cbNativeAddr;
+
+    uint64_t const uBaseSelect = cbNativeAddr == 8 ? UINT64_MAX : UINT32_MAX;
+    uint64_t       uBase       = pPcRange->fHaveLowAddress ? pPcRange->uLowAddress : 0;
+    while (   RT_SUCCESS(rc)
+           && !rtDwarfCursor_IsAtEnd(&Cursor))
+    {
+        uint64_t const uBegin = rtDwarfCursor_GetNativeUOff(&Cursor, 0);
+        uint64_t const uEnd   = rtDwarfCursor_GetNativeUOff(&Cursor, 0);
+        if (!uBegin && !uEnd)
+            break;
+        if (uBegin == uBaseSelect)
+            uBase = uEnd;
+        else
+            rc = rtDwarfUnits_AddRange(pThis, pcAlloced, iUnit, uBase + uBegin, uBase + uEnd);
+    }
+    return rtDwarfCursor_Delete(&Cursor, rc);
+}
+
+
+/**
+ * Fills the address range index from the debug_aranges section.
+ *
+ * @returns IPRT status code.
+ * @param   pThis               The DWARF instance.
+ * @param   pcAlloced           The number of allocated index entries.
+ */
+static int rtDwarfUnits_IndexAranges(PRTDBGMODDWARF pThis, uint32_t *pcAlloced)
+{
+    RTDWARFCURSOR Cursor;
+    int rc = rtDwarfCursor_Init(&Cursor, pThis, krtDbgModDwarfSect_aranges);
+    if (RT_FAILURE(rc))
+        return rc;
+
+    while (   !rtDwarfCursor_IsAtEnd(&Cursor)
+           && RT_SUCCESS(rc))
+    {
+        uint8_t const *pbSet       = Cursor.pb;
+        rtDwarfCursor_GetInitalLength(&Cursor);
+        uint16_t const uVer        = rtDwarfCursor_GetUHalf(&Cursor, 0);
+        uint64_t const offInfo     = rtDwarfCursor_GetUOff(&Cursor, UINT64_MAX);
+        uint8_t  const cbAddr      = rtDwarfCursor_GetU8(&Cursor, 0);
+        uint8_t  const cbSegDesc   = rtDwarfCursor_GetU8(&Cursor, 0);
+        uint32_t const iUnit       = rtDwarfUnits_LookupByOffset(pThis, offInfo);
+        if (   uVer == 2
+            && (cbAddr == 4 || cbAddr == 8)
+            && cbSegDesc == 0
+            && iUnit != UINT32_MAX
+            && RT_SUCCESS(Cursor.rc))
+        {
+            /* The tuples are aligned on twice the address size relative to the start of the set. */
+            Cursor.cbNativeAddr = cbAddr;
+            size_t const offMisalign = (size_t)(Cursor.pb - pbSet) % (cbAddr * 2);
+            if (offMisalign)
+                rtDwarfCursor_SkipBytes(&Cursor, cbAddr * 2 - offMisalign);
+
+            while (   !rtDwarfCursor_IsAtEndOfUnit(&Cursor)
+                   && RT_SUCCESS(rc))
+            {
+                uint64_t const uAddress = rtDwarfCursor_GetNativeUOff(&Cursor, 0);
+                uint64_t const cbRange  = rtDwarfCursor_GetNativeUOff(&Cursor, 0);
+                if (!uAddress && !cbRange)
+                    break;
+                rc = rtDwarfUnits_AddRange(pThis, pcAlloced, iUnit, uAddress, uAddress + cbRange);
+            }
+        }
+        else
+            Log(("rtDwarfUnits_IndexAranges: Skipping set at %#x: uVer=%u offInfo=%#llx cbAddr=%u cbSegDesc=%u\n",
+                 (uint32_t)(pbSet - (uint8_t const *)pThis->aSections[krtDbgModDwarfSect_aranges].pv),
+                 uVer, offInfo, cbAddr, cbSegDesc));
+        if (RT_SUCCESS(rc))
+            rc = rtDwarfCursor_SkipUnit(&Cursor);
+    }
+
+    return rtDwarfCursor_Delete(&Cursor, rc);
+}
+
+
+/** @callback_method_impl{FNRTSORTCMP, Sorts the address range index.} */
+static DECLCALLBACK(int) rtDwarfUnits_CompareRanges(void const *pvElement1, void const *pvElement2, void *pvUser)
+{
+    PRTDWARFUNITRANGE pRange1 = (PRTDWARFUNITRANGE)pvElement1;
+    PRTDWARFUNITRANGE pRange2 = (PRTDWARFUNITRANGE)pvElement2;
+    RT_NOREF_PV(pvUser);
+    if (pRange1->uRvaFirst < pRange2->uRvaFirst)
+        return -1;
+    return pRange1->uRvaFirst > pRange2->uRvaFirst;
+}
+
+
+/** @callback_method_impl{FNRTSORTCMP, Sorts the name index.} */
+static DECLCALLBACK(int) rtDwarfUnits_CompareNames(void const *pvElement1, void const *pvElement2, void *pvUser)
+{
+    RT_NOREF_PV(pvUser);
+    return strcmp(((PRTDWARFUNITNAME)pvElement1)->pszName, ((PRTDWARFUNITNAME)pvElement2)->pszName);
+}
+
+
+/**
+ * Fills the name index from the debug_pubnames section.
+ *
+ * @returns IPRT status code.
+ * @param   pThis               The DWARF instance.
+ */
+static int rtDwarfUnits_IndexPubNames(PRTDBGMODDWARF pThis)
+{
+    RTDWARFCURSOR Cursor;
+    int rc = rtDwarfCursor_Init(&Cursor, pThis, krtDbgModDwarfSect_pubnames);
+    if (RT_FAILURE(rc))
+        return rc;
+
+    uint32_t cAlloced = 0;
+    while (   !rtDwarfCursor_IsAtEnd(&Cursor)
+           && RT_SUCCESS(rc))
+    {
+        rtDwarfCursor_GetInitalLength(&Cursor);
+        uint16_t const uVer    = rtDwarfCursor_GetUHalf(&Cursor, 0);
+        uint64_t const offInfo = rtDwarfCursor_GetUOff(&Cursor, UINT64_MAX);
+        rtDwarfCursor_GetUOff(&Cursor, 0); /* The size of the unit. */
+        uint32_t const iUnit   = rtDwarfUnits_LookupByOffset(pThis, offInfo);
+        if (   uVer == 2
+            && iUnit != UINT32_MAX
+            && RT_SUCCESS(Cursor.rc))
+        {
+            while (   !rtDwarfCursor_IsAtEndOfUnit(&Cursor)
+                   && RT_SUCCESS(rc))
+            {
+                if (!rtDwarfCursor_GetUOff(&Cursor, 0))
+                    break;
+                const char *pszName = rtDwarfCursor_GetSZ(&Cursor, NULL);
+                if (!pszName)
+                    break;
+
+                if (pThis->cUnitNames >= cAlloced)
+                {
+                    uint32_t const cNew = cAlloced ? cAlloced * 2 : 1024;
+                    void *pvNew = RTMemRealloc(pThis->paUnitNames, cNew * sizeof(pThis->paUnitNames[0]));
+                    if (!pvNew)
+                    {
+                        rc = VERR_NO_MEMORY;
+                        break;
+                    }
+                    pThis->paUnitNames = (PRTDWARFUNITNAME)pvNew;
+                    cAlloced = cNew;
+                }
+                pThis->paUnitNames[pThis->cUnitNames].pszName = pszName;
+                pThis->paUnitNames[pThis->cUnitNames].iUnit   = iUnit;
+                pThis->cUnitNames++;
+            }
+        }
+        if (RT_SUCCESS(rc))
+            rc = rtDwarfCursor_SkipUnit(&Cursor);
+    }
+
+    rc = rtDwarfCursor_Delete(&Cursor, rc);
+    if (RT_SUCCESS(rc))
+        RTSortShell(pThis->paUnitNames, pThis->cUnitNames, sizeof(pThis->paUnitNames[0]), rtDwarfUnits_CompareNames, NULL);
+    return rc;
+}
+
+
+/**
+ * Reads the header and compile unit DIE of a unit for the index, leaving the
+ * cursor at the next unit.
+ *
+ * @returns IPRT status code.
+ * @param   pThis               The DWARF instance.
+ * @param   pCursor             The debug_info cursor.
+ * @param   pUnit               The index entry to fill in.
+ * @param   pPcRange            Where to return the PC range of the unit.
+ * @param   pcbNativeAddr       Where to return the native address size.
+ */
+static int rtDwarfUnits_IndexUnit(PRTDBGMODDWARF pThis, PRTDWARFCURSOR pCursor, PRTDWARFUNIT pUnit,
+                                  PRTDWARFADDRRANGE pPcRange, uint8_t *pcbNativeAddr)
+{
+    RT_ZERO(*pPcRange);
+    *pcbNativeAddr = 0;
+
+    uint64_t offUnit = rtDwarfCursor_CalcSectOffsetU32(pCursor);
+    uint64_t cbUnit  = rtDwarfCursor_GetInitalLength(pCursor);
+    cbUnit += rtDwarfCursor_CalcSectOffsetU32(pCursor) - offUnit;
+    uint16_t const uVer = rtDwarfCursor_GetUHalf(pCursor, 0);
+    if (   uVer < 2
+        || uVer > 4)
+    {
+        pUnit->fLoaded = true; /* rtDwarfInfo_LoadUnit skips these. */
+        return rtDwarfCursor_SkipUnit(pCursor);
+    }
+    uint64_t const offAbbrev    = rtDwarfCursor_GetUOff(pCursor, UINT64_MAX);
+    uint8_t  const cbNativeAddr = rtDwarfCursor_GetU8(pCursor, UINT8_MAX);
+    if (RT_FAILURE(pCursor->rc))
+        return pCursor->rc;
+    if (offAbbrev > UINT32_MAX)
+        return VERR_DWARF_BAD_INFO;
+    rtDwarfAbbrev_SetUnitOffset(pThis, (uint32_t)offAbbrev);
+    pCursor->cbNativeAddr = cbNativeAddr;
+
+    uint32_t const  uAbbrCode = rtDwarfCursor_GetULeb128AsU32(pCursor, UINT32_MAX);
+    PCRTDWARFABBREV pAbbrev   = uAbbrCode ? rtDwarfAbbrev_Lookup(pThis, uAbbrCode) : NULL;
+    if (!pAbbrev)
+        return VERR_DWARF_ABBREV_NOT_FOUND;
+    if (   pAbbrev->uTag != DW_TAG_compile_unit
+        && pAbbrev->uTag != DW_TAG_partial_unit)
+        return VERR_DWARF_BAD_INFO;
+
+    PRTDWARFDIECOMPILEUNIT pCompUnit;
+    pCompUnit = (PRTDWARFDIECOMPILEUNIT)rtDwarfInfo_NewDie(pThis, &g_CompileUnitDesc, pAbbrev, NULL /*pParent*/);
+    if (!pCompUnit)
+        return VERR_NO_MEMORY;
+    pCompUnit->offUnit      = offUnit;
+    pCompUnit->cbUnit       = cbUnit;
+    pCompUnit->offAbbrev    = offAbbrev;
+    pCompUnit->cbNativeAddr = cbNativeAddr;
+    pCompUnit->uDwarfVer    = (uint8_t)uVer;
+
+    int rc = rtDwarfInfo_ParseDie(pThis, &pCompUnit->Core, &g_CompileUnitDesc, pCursor, pAbbrev, true /*fInitDie*/);
+    if (RT_SUCCESS(rc))
+    {
+        if (   pCompUnit->StmtListRef.enmWrt == krtDwarfRef_LineSection
+            && pCompUnit->StmtListRef.off < pThis->aSections[krtDbgModDwarfSect_line].cb)
+            pUnit->offLine = pCompUnit->StmtListRef.off;
+        *pPcRange      = pCompUnit->PcRange;
+        *pcbNativeAddr = cbNativeAddr;
+        rc = rtDwarfCursor_SkipUnit(pCursor);
+    }
+    rtDwarfInfo_FreeDie(pThis, &pCompUnit->Core);
+    return rc;
+}
+
+
+/**
+ * Loads the symbols and line numbers of a compilation unit into the
+ * container, unless already done.
+ *
+ * @returns IPRT status code.
+ * @param   pThis               The DWARF instance.
+ * @param   iUnit               The compilation unit index.
+ */
+static int rtDwarfUnits_Load(PRTDBGMODDWARF pThis, uint32_t iUnit)
+{
+    PRTDWARFUNIT pUnit = &pThis->paUnits[iUnit];
+    if (pUnit->fLoaded)
+        return VINF_SUCCESS;
+    pUnit->fLoaded = true; /* Failures aren't retried. */
+
+    RTDWARFCURSOR Cursor;
+    int rc = rtDwarfCursor_InitWithOffset(&Cursor, pThis, krtDbgModDwarfSect_info, (uint32_t)pUnit->offUnit);
+    if (RT_SUCCESS(rc))
+    {
+        rc = rtDwarfInfo_LoadUnit(pThis, &Cursor, false /* fKeepDies */);
+        rc = rtDwarfCursor_Delete(&Cursor, rc);
+    }
+    if (   RT_SUCCESS(rc)
+        && pUnit->offLine != UINT64_MAX)
+    {
+        rc = rtDwarfCursor_InitWithOffset(&Cursor, pThis, krtDbgModDwarfSect_line, (uint32_t)pUnit->offLine);
+        if (RT_SUCCESS(rc))
+        {
+            rc = rtDwarfLine_ExplodeUnit(pThis, &Cursor);
+            rc = rtDwarfCursor_Delete(&Cursor, rc);
+        }
+    }
+    if (RT_FAILURE(rc))
+        Log(("rtDwarfUnits_Load: Unit #%u at %#llx: %Rrc\n", iUnit, pUnit->offUnit, rc));
+    return rc;
+}
+
+
+/**
+ * Moves the image symbols into the main container once all the units are
+ * loaded, skipping the ones the debug info already covers just like the eager
+ * path does.
+ *
+ * @param   pThis               The DWARF instance.
+ */
+static void rtDwarfUnits_MergeImageSyms(PRTDBGMODDWARF pThis)
+{
+    RTDBGMOD const hCntImgSyms = pThis->hCntImgSyms;
+    if (hCntImgSyms == NIL_RTDBGMOD)
+        return;
+    pThis->hCntImgSyms = NIL_RTDBGMOD;
+
+    uint32_t const cSymbols = RTDbgModSymbolCount(hCntImgSyms);
+    for (uint32_t iOrdinal = 0; iOrdinal < cSymbols; iOrdinal++)
+    {
+        RTDBGSYMBOL SymInfo;
+        int rc = RTDbgModSymbolByOrdinal(hCntImgSyms, iOrdinal, &SymInfo);
+        if (RT_SUCCESS(rc))
+            rc = rtDwarfSyms_AddImageSymbol(pThis, SymInfo.szName,
+                                            RTDbgModSegmentRva(hCntImgSyms, SymInfo.iSeg) + SymInfo.Value);
+        Log5(("rtDwarfUnits_MergeImageSyms: %s [%Rrc]\n", SymInfo.szName, rc)); NOREF(rc);
+    }
+    RTDbgModRelease(hCntImgSyms);
+}
+
+
+/**
+ * Loads all compilation units that haven't been loaded yet.
+ *
+ * This is needed by the container wide operations (counts and ordinals).
+ *
+ * @param   pThis               The DWARF instance.
+ */
+static void rtDwarfUnits_LoadAll(PRTDBGMODDWARF pThis)
+{
+    if (!pThis->fLazy || pThis->fAllUnitsLoaded)
+        return;
+    pThis->fAllUnitsLoaded = true;
+    for (uint32_t iUnit = 0; iUnit < pThis->cUnits; iUnit++)
+        rtDwarfUnits_Load(pThis, iUnit);
+    rtDwarfUnits_MergeImageSyms(pThis);
+}
+
+
+/**
+ * Loads the compilation units covering the given address.
+ *
+ * @param   pThis               The DWARF instance.
+ * @param   iSeg                The segment index.
+ * @param   off                 The segment offset.
+ */
+static void rtDwarfUnits_LoadByAddr(PRTDBGMODDWARF pThis, RTDBGSEGIDX iSeg, RTUINTPTR off)
+{
+    if (!pThis->fLazy || pThis->fAllUnitsLoaded)
+        return;
+
+    RTUINTPTR uRva = off;
+    if (iSeg != RTDBGSEGIDX_RVA)
+    {
+        if (iSeg > RTDBGSEGIDX_LAST)
+            return;
+        RTUINTPTR const uSegRva = RTDbgModSegmentRva(pThis->hCnt, iSeg);
+        if (uSegRva == RTUINTPTR_MAX)
+            return;
+        uRva += uSegRva;
+    }
+
+    /* Find the first range starting after the address, then walk backwards
+       over the ones that may cover it. */
+    uint32_t iStart = 0;
+    uint32_t iEnd   = pThis->cUnitRanges;
+    while (iStart < iEnd)
+    {
+        uint32_t const i = iStart + (iEnd - iStart) / 2;
+        if (pThis->paUnitRanges[i].uRvaFirst <= uRva)
+            iStart = i + 1;
+        else
+            iEnd = i;
+    }
+    uint32_t i = iStart;
+    while (   i-- > 0
+           && pThis->paUnitRanges[i].uRvaLastMax >= uRva)
+        if (pThis->paUnitRanges[i].uRvaLast >= uRva)
+            rtDwarfUnits_Load(pThis, pThis->paUnitRanges[i].iUnit);
+}
+
+
+/**
+ * Loads the compilation units defining the given name.
+ *
+ * Without a name index, this loads everything.
+ *
+ * @returns true if any units were loaded, false if not.
+ * @param   pThis               The DWARF instance.
+ * @param   pszSymbol           The symbol name.
+ */
+static bool rtDwarfUnits_LoadByName(PRTDBGMODDWARF pThis, const char *pszSymbol)
+{
+    if (!pThis->fLazy || pThis->fAllUnitsLoaded)
+        return false;
+    if (!pThis->cUnitNames)
+    {
+        rtDwarfUnits_LoadAll(pThis);
+        return true;
+    }
+
+    uint32_t iStart = 0;
+    uint32_t iEnd   = pThis->cUnitNames;
+    while (iStart < iEnd)
+    {
+        uint32_t const i = iStart + (iEnd - iStart) / 2;
+        if (strcmp(pThis->paUnitNames[i].pszName, pszSymbol) < 0)
+            iStart = i + 1;
+        else
+            iEnd = i;
+    }
+
+    bool fLoaded = false;
+    for (uint32_t i = iStart; i < pThis->cUnitNames && !strcmp(pThis->paUnitNames[i].pszName, pszSymbol); i++)
+        if (!pThis->paUnits[pThis->paUnitNames[i].iUnit].fLoaded)
+        {
+            rtDwarfUnits_Load(pThis, pThis->paUnitNames[i].iUnit);
+            fLoaded = true;
+        }
+    return fLoaded;
+}
+
+
+/**
+ * Builds the unit, address range and name indexes for loading the debug info
+ * on demand, and loads the units that cannot be found by address.
+ *
+ * @returns IPRT status code.  On failure the caller should fall back on
+ *          loading everything up front.
+ * @param   pThis               The DWARF instance.
+ */
+static int rtDwarfUnits_BuildIndex(PRTDBGMODDWARF pThis)
+{
+    bool const fAranges = pThis->aSections[krtDbgModDwarfSect_aranges].fPresent;
+
+    /*
+     * Walk the units in debug_info, only looking at the compile unit DIEs.
+     */
+    uint32_t cUnitsAlloced  = 0;
+    uint32_t cRangesAlloced = 0;
+    RTDWARFCURSOR Cursor;
+    int rc = rtDwarfCursor_Init(&Cursor, pThis, krtDbgModDwarfSect_info);
+    if (RT_FAILURE(rc))
+        return rc;
+    while (   !rtDwarfCursor_IsAtEnd(&Cursor)
+           && RT_SUCCESS(rc))
+    {
+        if (pThis->cUnits >= cUnitsAlloced)
+        {
+            uint32_t const cNew = cUnitsAlloced ? cUnitsAlloced * 2 : 64;
+            void *pvNew = RTMemRealloc(pThis->paUnits, cNew * sizeof(pThis->paUnits[0]));
+            if (!pvNew)
+            {
+                rc = VERR_NO_MEMORY;
+                break;
+            }
+            pThis->paUnits = (PRTDWARFUNIT)pvNew;
+            cUnitsAlloced = cNew;
+        }
+
+        uint32_t const   iUnit = pThis->cUnits++;
+        PRTDWARFUNIT     pUnit = &pThis->paUnits[iUnit];
+        pUnit->offUnit    = rtDwarfCursor_CalcSectOffsetU32(&Cursor);
+        pUnit->offLine    = UINT64_MAX;
+        pUnit->fLoaded    = false;
+        pUnit->fHaveRange = false;
+
+        RTDWARFADDRRANGE PcRange;
+        uint8_t          cbNativeAddr;
+        rc = rtDwarfUnits_IndexUnit(pThis, &Cursor, pUnit, &PcRange, &cbNativeAddr);
+        if (RT_SUCCESS(rc) && !fAranges && !pUnit->fLoaded)
+            rc = rtDwarfUnits_AddDieRanges(pThis, &cRangesAlloced, iUnit, &PcRange, cbNativeAddr);
+    }
+    rc = rtDwarfCursor_Delete(&Cursor, rc);
+
+    /*
+     * The address ranges and public names.
+     */
+    if (RT_SUCCESS(rc) && fAranges)
+        rc = rtDwarfUnits_IndexAranges(pThis, &cRangesAlloced);
+    if (RT_SUCCESS(rc))
+    {
+        RTSortShell(pThis->paUnitRanges, pThis->cUnitRanges, sizeof(pThis->paUnitRanges[0]), rtDwarfUnits_CompareRanges, NULL);
+        for (uint32_t i = 1; i < pThis->cUnitRanges; i++)
+            pThis->paUnitRanges[i].uRvaLastMax = RT_MAX(pThis->paUnitRanges[i].uRvaLast,
+                                                        pThis->paUnitRanges[i - 1].uRvaLastMax);
+    }
+    if (RT_SUCCESS(rc) && pThis->aSections[krtDbgModDwarfSect_pubnames].fPresent)
+    {
+        rc = rtDwarfUnits_IndexPubNames(pThis);
+        if (RT_FAILURE(rc))
+        {
+            /* Not fatal, name lookups will load everything instead. */
+            Log(("rtDwarfUnits_BuildIndex: Ignoring bad pubnames: %Rrc\n", rc));
+            RTMemFree(pThis->paUnitNames);
+            pThis->paUnitNames = NULL;
+            pThis->cUnitNames  = 0;
+            rc = VINF_SUCCESS;
+        }
+    }
+
+    /*
+     * Load the units we cannot locate by address right away.
+     */
+    if (RT_SUCCESS(rc))
+    {
+        uint32_t cLoaded = 0;
+        for (uint32_t iUnit = 0; iUnit < pThis->cUnits; iUnit++)
+            if (!pThis->paUnits[iUnit].fHaveRange && !pThis->paUnits[iUnit].fLoaded)
+            {
+                rtDwarfUnits_Load(pThis, iUnit);
+                cLoaded++;
+            }
+        Log(("rtDwarfUnits_BuildIndex: %u units, %u ranges, %u names, %u units loaded up front\n",
+             pThis->cUnits, pThis->cUnitRanges, pThis->cUnitNames, cLoaded));
+        pThis->fLazy = true;
+    }
+    else
+    {
+        RTMemFree(pThis->paUnits);
+        pThis->paUnits      = NULL;
+        pThis->cUnits       = 0;
+        RTMemFree(pThis->paUnitRanges);
+        pThis->paUnitRanges = NULL;
+        pThis->cUnitRanges  = 0;
+        RTMemFree(pThis->paUnitNames);
+        pThis->paUnitNames  = NULL;
+        pThis->cUnitNames   = 0;
+    }
+    return rc;
+}
+
+
 /*
  *
  * DWARF Debug module implementation.
@@ -4529,6 +5281,7 @@ static DECLCALLBACK(int) rtDbgModDwarf_LineByAddr(PRTDBGMODINT pMod, RTDBGSEGIDX
                                                   PRTINTPTR poffDisp, PRTDBGLINE pLineInfo)
 {
     PRTDBGMODDWARF pThis = (PRTDBGMODDWARF)pMod->pvDbgPriv;
+    rtDwarfUnits_LoadByAddr(pThis, iSeg, off);
     return RTDbgModLineByAddr(pThis->hCnt, iSeg, off, poffDisp, pLineInfo);
 }
 
@@ -4537,6 +5290,7 @@ static DECLCALLBACK(int) rtDbgModDwarf_LineByAddr(PRTDBGMODINT pMod, RTDBGSEGIDX
 static DECLCALLBACK(int) rtDbgModDwarf_LineByOrdinal(PRTDBGMODINT pMod, uint32_t iOrdinal, PRTDBGLINE pLineInfo)
 {
     PRTDBGMODDWARF pThis = (PRTDBGMODDWARF)pMod->pvDbgPriv;
+    rtDwarfUnits_LoadAll(pThis);
     return RTDbgModLineByOrdinal(pThis->hCnt, iOrdinal, pLineInfo);
 }
 
@@ -4545,6 +5299,7 @@ static DECLCALLBACK(int) rtDbgModDwarf_LineByOrdinal(PRTDBGMODINT pMod, uint32_t
 static DECLCALLBACK(uint32_t) rtDbgModDwarf_LineCount(PRTDBGMODINT pMod)
 {
     PRTDBGMODDWARF pThis = (PRTDBGMODDWARF)pMod->pvDbgPriv;
+    rtDwarfUnits_LoadAll(pThis);
     return RTDbgModLineCount(pThis->hCnt);
 }
 
@@ -4564,7 +5319,39 @@ static DECLCALLBACK(int) rtDbgModDwarf_SymbolByAddr(PRTDBGMODINT pMod, RTDBGSEGI
                                                     PRTINTPTR poffDisp, PRTDBGSYMBOL pSymInfo)
 {
     PRTDBGMODDWARF pThis = (PRTDBGMODDWARF)pMod->pvDbgPriv;
-    return RTDbgModSymbolByAddr(pThis->hCnt, iSeg, off, fFlags, poffDisp, pSymInfo);
+    rtDwarfUnits_LoadByAddr(pThis, iSeg, off);
+    RTINTPTR offDisp = 0;
+    int rc = RTDbgModSymbolByAddr(pThis->hCnt, iSeg, off, fFlags, &offDisp, pSymInfo);
+    if (pThis->hCntImgSyms != NIL_RTDBGMOD)
+    {
+        /*
+         * The image symbol wins if it is closer, unless it is at the same
+         * address or within the debug info symbol, as it would not have been
+         * added to the container then.  The address may be outside the ranges
+         * of the unit defining the image symbol, so load that and retry first.
+         */
+        RTDBGSYMBOL ImgSymInfo;
+        RTINTPTR    offImgDisp;
+        int rc2 = RTDbgModSymbolByAddr(pThis->hCntImgSyms, iSeg, off, fFlags, &offImgDisp, &ImgSymInfo);
+        if (   RT_SUCCESS(rc2)
+            && (RT_FAILURE(rc) || RT_ABS(offImgDisp) < RT_ABS(offDisp)))
+        {
+            rtDwarfUnits_LoadByAddr(pThis, ImgSymInfo.iSeg, ImgSymInfo.Value);
+            rc = RTDbgModSymbolByAddr(pThis->hCnt, iSeg, off, fFlags, &offDisp, pSymInfo);
+            if (   RT_FAILURE(rc)
+                || (   RT_ABS(offImgDisp) < RT_ABS(offDisp)
+                    && (   offImgDisp < 0
+                        || (RTUINTPTR)(offDisp - offImgDisp) >= pSymInfo->cb)))
+            {
+                *pSymInfo = ImgSymInfo;
+                offDisp   = offImgDisp;
+                rc        = rc2;
+            }
+        }
+    }
+    if (poffDisp && RT_SUCCESS(rc))
+        *poffDisp = offDisp;
+    return rc;
 }
 
 
@@ -4574,7 +5361,14 @@ static DECLCALLBACK(int) rtDbgModDwarf_SymbolByName(PRTDBGMODINT pMod, const cha
 {
     PRTDBGMODDWARF pThis = (PRTDBGMODDWARF)pMod->pvDbgPriv;
     Assert(!pszSymbol[cchSymbol]); RT_NOREF_PV(cchSymbol);
-    return RTDbgModSymbolByName(pThis->hCnt, pszSymbol/*, cchSymbol*/, pSymInfo);
+    int rc = RTDbgModSymbolByName(pThis->hCnt, pszSymbol/*, cchSymbol*/, pSymInfo);
+    if (   RT_FAILURE(rc)
+        && rtDwarfUnits_LoadByName(pThis, pszSymbol))
+        rc = RTDbgModSymbolByName(pThis->hCnt, pszSymbol/*, cchSymbol*/, pSymInfo);
+    if (   RT_FAILURE(rc)
+        && pThis->hCntImgSyms != NIL_RTDBGMOD)
+        rc = RTDbgModSymbolByName(pThis->hCntImgSyms, pszSymbol/*, cchSymbol*/, pSymInfo);
+    return rc;
 }
 
 
@@ -4582,6 +5376,7 @@ static DECLCALLBACK(int) rtDbgModDwarf_SymbolByName(PRTDBGMODINT pMod, const cha
 static DECLCALLBACK(int) rtDbgModDwarf_SymbolByOrdinal(PRTDBGMODINT pMod, uint32_t iOrdinal, PRTDBGSYMBOL pSymInfo)
 {
     PRTDBGMODDWARF pThis = (PRTDBGMODDWARF)pMod->pvDbgPriv;
+    rtDwarfUnits_LoadAll(pThis);
     return RTDbgModSymbolByOrdinal(pThis->hCnt, iOrdinal, pSymInfo);
 }
 
@@ -4590,6 +5385,7 @@ static DECLCALLBACK(int) rtDbgModDwarf_SymbolByOrdinal(PRTDBGMODINT pMod, uint32
 static DECLCALLBACK(uint32_t) rtDbgModDwarf_SymbolCount(PRTDBGMODINT pMod)
 {
     PRTDBGMODDWARF pThis = (PRTDBGMODDWARF)pMod->pvDbgPriv;
+    rtDwarfUnits_LoadAll(pThis);
     return RTDbgModSymbolCount(pThis->hCnt);
 }
 
@@ -4659,7 +5455,11 @@ static DECLCALLBACK(int) rtDbgModDwarf_Close(PRTDBGMODINT pMod)
             pThis->pDbgInfoMod->pImgVt->pfnUnmapPart(pThis->pDbgInfoMod, pThis->aSections[iSect].cb, &pThis->aSections[iSect].pv);
 
     RTDbgModRelease(pThis->hCnt);
+    RTDbgModRelease(pThis->hCntImgSyms);
     RTMemFree(pThis->paCachedAbbrevs);
+    RTMemFree(pThis->paUnits);
+    RTMemFree(pThis->paUnitRanges);
+    RTMemFree(pThis->paUnitNames);
     if (pThis->pNestedMod)
     {
         pThis->pNestedMod->pImgVt->pfnClose(pThis->pNestedMod);
@@ -4878,6 +5678,22 @@ static DECLCALLBACK(int) rtDbgModDwarf_TryOpen(PRTDBGMODINT pMod, RTLDRARCH enmA
                 pMod->pvDbgPriv = pThis;
 
                 rc = rtDbgModDwarfAddSegmentsFromImage(pThis);
+
+                /*
+                 * Unless this is a watcom image where we have to figure out the
+                 * segments from the debug info first, index the units and load
+                 * them as they are needed.  The sections must stay mapped then.
+                 */
+                if (   RT_SUCCESS(rc)
+                    && pThis->iWatcomPass == -1
+                    && !pMod->fNoLazyLoading
+                    && RT_SUCCESS(rtDwarfUnits_BuildIndex(pThis)))
+                {
+                    rc = rtDwarfSyms_LoadAll(pThis);
+                    if (RT_SUCCESS(rc))
+                        return VINF_SUCCESS;
+                }
+
                 if (RT_SUCCESS(rc))
                     rc = rtDwarfInfo_LoadAll(pThis);
                 if (RT_SUCCESS(rc))
@@ -4915,6 +5731,7 @@ static DECLCALLBACK(int) rtDbgModDwarf_TryOpen(PRTDBGMODINT pMod, RTLDRARCH enmA
 
                 /* bail out. */
                 RTDbgModRelease(pThis->hCnt);
+                RTDbgModRelease(pThis->hCntImgSyms);
                 pMod->pvDbgPriv = NULL;
             }
         }
@@ -4923,6 +5740,9 @@ static DECLCALLBACK(int) rtDbgModDwarf_TryOpen(PRTDBGMODINT pMod, RTLDRARCH enmA
     }
 
     RTMemFree(pThis->paCachedAbbrevs);
+    RTMemFree(pThis->paUnits);
+    RTMemFree(pThis->paUnitRanges);
+    RTMemFree(pThis->paUnitNames);
 
 #ifdef RTDBGMODDWARF_WITH_MEM_CACHE
     uint32_t i = RT_ELEMENTS(pThis->aDieAllocators);
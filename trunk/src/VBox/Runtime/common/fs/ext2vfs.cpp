@@ -31,14 +31,42 @@
 #define LOG_GROUP RTLOGGROUP_FS
 #include <iprt/fsvfs.h>
 
+#include <iprt/asm.h>
 #include <iprt/assert.h>
+#include <iprt/critsect.h>
+#include <iprt/file.h>
 #include <iprt/log.h>
 #include <iprt/mem.h>
+#include <iprt/poll.h>
 #include <iprt/string.h>
+#include <iprt/thread.h>
+#include <iprt/time.h>
 #include <iprt/vfs.h>
 #include <iprt/vfslowlevel.h>
 #include <iprt/formats/ext2.h>
 
+#include <internal/fs.h>
+
+
+/*********************************************************************************************************************************
+*   Defined Constants And Macros                                                                                                 *
+*********************************************************************************************************************************/
+/** The maximum size of the metadata block cache (in bytes). */
+#if ARCH_BITS >= 64
+# define RTFSEXT_MAX_BLOCK_CACHE_SIZE       _2M
+#else
+# define RTFSEXT_MAX_BLOCK_CACHE_SIZE       _512K
+#endif
+/** The maximum number of entries in the metadata block cache (power of two). */
+#define RTFSEXT_MAX_BLOCK_CACHE_ENTRIES     512
+/** The minimum number of entries in the metadata block cache (power of two). */
+#define RTFSEXT_MIN_BLOCK_CACHE_ENTRIES     16
+/** Number of entries in the inode cache (power of two). */
+#define RTFSEXT_INODE_CACHE_ENTRIES         1024
+
+/** Mask for the logical block numbers in hash tree index entries. */
+#define RTFSEXT_HTREE_BLOCK_MASK            UINT32_C(0x0fffffff)
+
 
 /*********************************************************************************************************************************
 *   Structures and Typedefs                                                                                                      *
@@ -46,95 +74,2315 @@
 /**
  * Cached block group descriptor data.
  */
-typedef struct RTFILESYSTEMEXTBLKGRP
+typedef struct RTFILESYSTEMEXTBLKGRP
+{
+    /** The block group number. */
+    uint32_t    iBlkGrp;
+    /** Start offset (in bytes and from the start of the disk). */
+    uint64_t    offStart;
+    /** Last offset in the block group (inclusive). */
+    uint64_t    offLast;
+    /** Block bitmap - variable in size (depends on the block size
+     * and number of blocks per group). */
+    uint8_t     abBlockBitmap[1];
+} RTFILESYSTEMEXTBLKGRP;
+/** Pointer to block group descriptor data. */
+typedef RTFILESYSTEMEXTBLKGRP *PRTFILESYSTEMEXTBLKGRP;
+
+/**
+ * The parts of a block group descriptor we need, converted to host format.
+ */
+typedef struct RTFILESYSTEMEXTGRP
+{
+    /** Block number of the block bitmap. */
+    uint64_t    iBlockBitmap;
+    /** Block number of the inode bitmap. */
+    uint64_t    iInodeBitmap;
+    /** First block of the inode table. */
+    uint64_t    iInodeTable;
+    /** Block group flags (EXT4_BG_XXX). */
+    uint16_t    fFlags;
+} RTFILESYSTEMEXTGRP;
+/** Pointer to block group info. */
+typedef RTFILESYSTEMEXTGRP *PRTFILESYSTEMEXTGRP;
+/** Pointer to const block group info. */
+typedef RTFILESYSTEMEXTGRP const *PCRTFILESYSTEMEXTGRP;
+
+/**
+ * Parsed inode, this is what the inode cache holds.
+ */
+typedef struct RTFSEXTINODE
+{
+    /** The inode number, 0 if this cache entry is unused. */
+    uint32_t        iInode;
+    /** Inode flags (EXT2_INODE_FLAGS_XXX). */
+    uint32_t        fFlags;
+    /** Set if this is a symbolic link with the target stored in au32Block. */
+    bool            fFastSymlink;
+    /** Object information. */
+    RTFSOBJINFO     ObjInfo;
+    /** Block pointers, extent tree root or inline data (little endian). */
+    uint32_t        au32Block[EXT2_INODE_BLOCK_ENTRIES];
+} RTFSEXTINODE;
+/** Pointer to a parsed inode. */
+typedef RTFSEXTINODE *PRTFSEXTINODE;
+/** Pointer to a const parsed inode. */
+typedef RTFSEXTINODE const *PCRTFSEXTINODE;
+
+/**
+ * Ext2/3/4 filesystem data.
+ */
+typedef struct RTFILESYSTEMEXT
+{
+    /** Handle to itself. */
+    RTVFS                     hVfsSelf;
+    /** VFS file handle. */
+    RTVFSFILE                 hVfsFile;
+    /** Block number of the superblock (first data block). */
+    uint32_t                  iSbBlock;
+    /** Size of one block. */
+    size_t                    cbBlock;
+    /** Block size shift count. */
+    uint32_t                  cBlockShift;
+    /** Number of blocks in one group. */
+    uint32_t                  cBlocksPerGroup;
+    /** Number of inodes in one group. */
+    uint32_t                  cInodesPerGroup;
+    /** Block bitmap bit to block shift count (EXT2_FEATURE_RO_COMPAT_BIGALLOC). */
+    uint32_t                  cClusterShift;
+    /** Size of an inode. */
+    uint32_t                  cbInode;
+    /** Size of a group descriptor. */
+    uint32_t                  cbGroupDesc;
+    /** Total number of blocks. */
+    uint64_t                  cBlocksTotal;
+    /** Total number of inodes. */
+    uint32_t                  cInodesTotal;
+    /** Number of blocks groups in the volume. */
+    unsigned                  cBlockGroups;
+    /** Number of reserved GDT blocks. */
+    uint32_t                  cGdtBlocksRsvd;
+    /** First meta block group (EXT2_FEATURE_INCOMPAT_META_BG). */
+    uint32_t                  iFirstMetaBg;
+    /** Compatible features (EXT2_FEATURE_COMPAT_XXX). */
+    uint32_t                  fFeaturesCompat;
+    /** Incompatible features (EXT2_FEATURE_INCOMPAT_XXX). */
+    uint32_t                  fFeaturesIncompat;
+    /** Readonly compatible features (EXT2_FEATURE_RO_COMPAT_XXX). */
+    uint32_t                  fFeaturesCompatRo;
+    /** Whether directory hashes are calculated using unsigned chars. */
+    bool                      fHashUnsigned;
+    /** The directory hash seed. */
+    uint32_t                  au32HashSeed[4];
+    /** Block group info array (cBlockGroups). */
+    PRTFILESYSTEMEXTGRP       paGroups;
+    /** Cached block group descriptor data. */
+    PRTFILESYSTEMEXTBLKGRP    pBlkGrpDesc;
+
+    /** Critical section serializing access to the caches.  Read-only VFS
+     * methods are called with the shared volume lock held, so we need our own. */
+    RTCRITSECT                CritSect;
+    /** Number of entries in the block cache. */
+    uint32_t                  cBlockCacheEntries;
+    /** The block numbers of the cached blocks, UINT64_MAX for unused entries. */
+    uint64_t                 *paiBlockCacheTags;
+    /** The block cache data (cBlockCacheEntries * cbBlock). */
+    uint8_t                  *pbBlockCache;
+    /** The inode cache (RTFSEXT_INODE_CACHE_ENTRIES). */
+    PRTFSEXTINODE             paInodeCache;
+    /** @name Cache statistics.
+     * @{ */
+    uint64_t                  cBlockCacheHits;
+    uint64_t                  cBlockCacheMisses;
+    uint64_t                  cInodeCacheHits;
+    uint64_t                  cInodeCacheMisses;
+    /** @} */
+} RTFILESYSTEMEXT;
+/** Pointer to the ext filesystem data. */
+typedef RTFILESYSTEMEXT *PRTFILESYSTEMEXT;
+
+/**
+ * Last block mapping lookup result, saves walking the extent tree or the
+ * indirect blocks for each block.
+ */
+typedef struct RTFSEXTMAPCACHE
+{
+    /** First logical block. */
+    uint64_t                  iLogBlock;
+    /** Number of blocks, 0 if the entry is invalid. */
+    uint64_t                  cBlocks;
+    /** First physical block, 0 if sparse. */
+    uint64_t                  iPhysBlock;
+} RTFSEXTMAPCACHE;
+/** Pointer to a block mapping cache entry. */
+typedef RTFSEXTMAPCACHE *PRTFSEXTMAPCACHE;
+
+/**
+ * Data shared by files, directories and symbolic links.
+ */
+typedef struct RTFSEXTCORE
+{
+    /** The volume. */
+    PRTFILESYSTEMEXT          pVol;
+    /** The inode. */
+    RTFSEXTINODE              Inode;
+    /** The last block mapping. */
+    RTFSEXTMAPCACHE           Map;
+    /** Copy of the data for inodes with EXT4_INODE_FLAGS_INLINE_DATA. */
+    uint8_t                  *pbInline;
+    /** Size of the pbInline data. */
+    size_t                    cbInline;
+} RTFSEXTCORE;
+/** Pointer to the core object data. */
+typedef RTFSEXTCORE *PRTFSEXTCORE;
+
+/**
+ * Instance data for a file.
+ */
+typedef struct RTFSEXTFILE
+{
+    /** Core data. */
+    RTFSEXTCORE               Core;
+    /** The current file offset. */
+    uint64_t                  offFile;
+} RTFSEXTFILE;
+/** Pointer to a file instance. */
+typedef RTFSEXTFILE *PRTFSEXTFILE;
+
+/**
+ * Instance data for a directory.
+ */
+typedef struct RTFSEXTDIR
+{
+    /** Core data. */
+    RTFSEXTCORE               Core;
+    /** The byte offset of the next entry for ReadDir. */
+    uint64_t                  offDir;
+    /** The size of a directory block, cbBlock unless the data is inline. */
+    uint32_t                  cbDirBlock;
+    /** The logical block in pbBlock, UINT64_MAX if none. */
+    uint64_t                  iBlockLoaded;
+    /** Directory block buffer for ReadDir (or the inline data). */
+    uint8_t                  *pbBlock;
+} RTFSEXTDIR;
+/** Pointer to a directory instance. */
+typedef RTFSEXTDIR *PRTFSEXTDIR;
+
+/**
+ * Instance data for a symbolic link.
+ */
+typedef struct RTFSEXTSYMLINK
+{
+    /** Core data. */
+    RTFSEXTCORE               Core;
+} RTFSEXTSYMLINK;
+/** Pointer to a symbolic link instance. */
+typedef RTFSEXTSYMLINK *PRTFSEXTSYMLINK;
+
+
+/*********************************************************************************************************************************
+*   Internal Functions                                                                                                           *
+*********************************************************************************************************************************/
+static int rtFsExtDir_New(PRTFILESYSTEMEXT pThis, uint32_t iInode, PRTVFSDIR phVfsDir);
+
+
+
+/**
+ * Checks whether the given block group has a superblock backup.
+ *
+ * @returns true if it has, false if not.
+ * @param   pThis    EXT filesystem instance data.
+ * @param   iBlkGrp  The block group number.
+ */
+static bool rtFsExtBlkGrpHasSuperBlock(PRTFILESYSTEMEXT pThis, uint32_t iBlkGrp)
+{
+    if (iBlkGrp <= 1)
+        return true;
+    if (pThis->fFeaturesCompat & EXT2_FEATURE_COMPAT_SPARSE_SUPER2)
+        return iBlkGrp == pThis->cBlockGroups - 1; /* The mke2fs default, s_backup_bgs isn't parsed. */
+    if (!(pThis->fFeaturesCompatRo & EXT2_FEATURE_RO_COMPAT_SPARSE_SUPER))
+        return true;
+    if (!(iBlkGrp & 1))
+        return false;
+    static uint32_t const s_auBases[] = { 3, 5, 7 };
+    for (unsigned i = 0; i < RT_ELEMENTS(s_auBases); i++)
+    {
+        uint32_t uPower = s_auBases[i];
+        while (uPower < iBlkGrp)
+            uPower *= s_auBases[i];
+        if (uPower == iBlkGrp)
+            return true;
+    }
+    return false;
+}
+
+
+/**
+ * Calculates the number of blocks at the start of the given block group taken
+ * up by a superblock backup and group descriptor blocks.
+ *
+ * @returns Number of blocks.
+ * @param   pThis    EXT filesystem instance data.
+ * @param   iBlkGrp  The block group number.
+ */
+static uint32_t rtFsExtBlkGrpBaseMetaBlocks(PRTFILESYSTEMEXT pThis, uint32_t iBlkGrp)
+{
+    uint32_t const cDescPerBlock = (uint32_t)(pThis->cbBlock / pThis->cbGroupDesc);
+    uint32_t       cBlocks       = rtFsExtBlkGrpHasSuperBlock(pThis, iBlkGrp) ? 1 : 0;
+    if (   !(pThis->fFeaturesIncompat & EXT2_FEATURE_INCOMPAT_META_BG)
+        || iBlkGrp / cDescPerBlock < pThis->iFirstMetaBg)
+    {
+        if (cBlocks)
+        {
+            if (pThis->fFeaturesIncompat & EXT2_FEATURE_INCOMPAT_META_BG)
+                cBlocks += pThis->iFirstMetaBg;
+            else
+                cBlocks += (pThis->cBlockGroups + cDescPerBlock - 1) / cDescPerBlock;
+            cBlocks += pThis->cGdtBlocksRsvd;
+        }
+    }
+    else
+    {
+        uint32_t const iInMetaGrp = iBlkGrp % cDescPerBlock;
+        if (   iInMetaGrp == 0
+            || iInMetaGrp == 1
+            || iInMetaGrp == cDescPerBlock - 1)
+            cBlocks++;
+    }
+    return cBlocks;
+}
+
+
+/**
+ * Marks a block range as used in a block bitmap, ignoring blocks outside the
+ * group.
+ */
+static void rtFsExtBlkGrpMarkUsed(PRTFILESYSTEMEXT pThis, PRTFILESYSTEMEXTBLKGRP pBlkGrpDesc, uint64_t iFirstBlock,
+                                  uint64_t iBlock, uint64_t cBlocks)
+{
+    while (cBlocks-- > 0)
+    {
+        if (iBlock >= iFirstBlock && iBlock - iFirstBlock < pThis->cBlocksPerGroup)
+        {
+            uint32_t const iBit = (uint32_t)((iBlock - iFirstBlock) >> pThis->cClusterShift);
+            pBlkGrpDesc->abBlockBitmap[iBit / 8] |= (uint8_t)RT_BIT(iBit % 8);
+        }
+        iBlock++;
+    }
+}
+
+
+/**
+ * Loads the block bitmap of the given block group from the medium.
+ *
+ * @returns IPRT status code.
+ * @param   pThis    EXT filesystem instance data.
+ * @param   iBlkGrp  Block group number to load.
+ */
+static int rtFsExtLoadBlkGrpDesc(PRTFILESYSTEMEXT pThis, uint32_t iBlkGrp)
+{
+    AssertReturn(iBlkGrp < pThis->cBlockGroups, VERR_OUT_OF_RANGE);
+
+    uint32_t const cBits         = pThis->cBlocksPerGroup >> pThis->cClusterShift;
+    size_t         cbBlockBitmap = cBits / 8;
+    if (cBits % 8)
+        cbBlockBitmap++;
+
+    PRTFILESYSTEMEXTBLKGRP pBlkGrpDesc = pThis->pBlkGrpDesc;
+    if (!pBlkGrpDesc)
+    {
+        size_t cbBlkDesc = RT_OFFSETOF(RTFILESYSTEMEXTBLKGRP, abBlockBitmap[cbBlockBitmap]);
+        pBlkGrpDesc = (PRTFILESYSTEMEXTBLKGRP)RTMemAllocZ(cbBlkDesc);
+        if (!pBlkGrpDesc)
+            return VERR_NO_MEMORY;
+        pThis->pBlkGrpDesc = pBlkGrpDesc;
+    }
+
+    uint64_t const iFirstBlock = pThis->iSbBlock + (uint64_t)iBlkGrp * pThis->cBlocksPerGroup;
+    pBlkGrpDesc->iBlkGrp  = UINT32_MAX;
+    pBlkGrpDesc->offStart = iFirstBlock << pThis->cBlockShift;
+    pBlkGrpDesc->offLast  = pBlkGrpDesc->offStart + ((uint64_t)pThis->cBlocksPerGroup << pThis->cBlockShift) - 1;
+
+    int rc = VINF_SUCCESS;
+    PCRTFILESYSTEMEXTGRP pGrp = &pThis->paGroups[iBlkGrp];
+    if (!(pGrp->fFlags & EXT4_BG_BLOCK_UNINIT))
+        rc = RTVfsFileReadAt(pThis->hVfsFile, pGrp->iBlockBitmap << pThis->cBlockShift,
+                             &pBlkGrpDesc->abBlockBitmap[0], cbBlockBitmap, NULL);
+    else
+    {
+        /* The bitmap isn't initialized, only the group metadata is in use. */
+        RT_BZERO(&pBlkGrpDesc->abBlockBitmap[0], cbBlockBitmap);
+        rtFsExtBlkGrpMarkUsed(pThis, pBlkGrpDesc, iFirstBlock, iFirstBlock, rtFsExtBlkGrpBaseMetaBlocks(pThis, iBlkGrp));
+        rtFsExtBlkGrpMarkUsed(pThis, pBlkGrpDesc, iFirstBlock, pGrp->iBlockBitmap, 1);
+        rtFsExtBlkGrpMarkUsed(pThis, pBlkGrpDesc, iFirstBlock, pGrp->iInodeBitmap, 1);
+        rtFsExtBlkGrpMarkUsed(pThis, pBlkGrpDesc, iFirstBlock, pGrp->iInodeTable,
+                              ((uint64_t)pThis->cInodesPerGroup * pThis->cbInode + pThis->cbBlock - 1) >> pThis->cBlockShift);
+    }
+    if (RT_SUCCESS(rc))
+        pBlkGrpDesc->iBlkGrp = iBlkGrp;
+    return rc;
+}
+
+
+static bool rtFsExtIsBlockRangeInUse(PRTFILESYSTEMEXTBLKGRP pBlkGrpDesc, uint32_t offBlockStart, size_t cBlocks)
+{
+    while (cBlocks)
+    {
+        uint32_t idxByte = offBlockStart / 8;
+        uint32_t iBit = offBlockStart % 8;
+
+        if (pBlkGrpDesc->abBlockBitmap[idxByte] & RT_BIT(iBit))
+            return true;
+
+        cBlocks--;
+        offBlockStart++;
+    }
+
+    return false;
+}
+
+
+/**
+ * Gets a metadata block thru the block cache.
+ *
+ * The caller must own the cache critical section.  The returned pointer is
+ * only valid until the next cache call.
+ *
+ * @returns IPRT status code.
+ * @param   pThis       EXT filesystem instance data.
+ * @param   iBlock      The block number.
+ * @param   ppbBlock    Where to return the pointer to the block data.
+ */
+static int rtFsExtBlockCacheGet(PRTFILESYSTEMEXT pThis, uint64_t iBlock, uint8_t const **ppbBlock)
+{
+    Assert(RTCritSectIsOwner(&pThis->CritSect));
+    if (RT_LIKELY(iBlock < pThis->cBlocksTotal))
+    { /* likely */ }
+    else
+    {
+        Log(("rtFsExtBlockCacheGet: iBlock=%#RX64 is out of range (cBlocksTotal=%#RX64)\n", iBlock, pThis->cBlocksTotal));
+        return VERR_FILESYSTEM_CORRUPT;
+    }
+
+    uint32_t const idx     = (uint32_t)iBlock & (pThis->cBlockCacheEntries - 1);
+    uint8_t       *pbBlock = &pThis->pbBlockCache[(size_t)idx << pThis->cBlockShift];
+    if (pThis->paiBlockCacheTags[idx] == iBlock)
+        pThis->cBlockCacheHits++;
+    else
+    {
+        pThis->cBlockCacheMisses++;
+        pThis->paiBlockCacheTags[idx] = UINT64_MAX;
+        int rc = RTVfsFileReadAt(pThis->hVfsFile, iBlock << pThis->cBlockShift, pbBlock, pThis->cbBlock, NULL);
+        if (RT_FAILURE(rc))
+            return rc;
+        pThis->paiBlockCacheTags[idx] = iBlock;
+    }
+    *ppbBlock = pbBlock;
+    return VINF_SUCCESS;
+}
+
+
+/**
+ * Converts an inode time stamp.
+ *
+ * @param   pTime       Where to return the time.
+ * @param   u32Secs     The seconds field (little endian).
+ * @param   pu32Extra   The extra time field (little endian), NULL if not
+ *                      present.
+ */
+static void rtFsExtTimeFromInode(PRTTIMESPEC pTime, uint32_t u32Secs, uint32_t const *pu32Extra)
+{
+    int64_t  cSecs = (int32_t)RT_LE2H_U32(u32Secs);
+    uint32_t cNs   = 0;
+    if (pu32Extra)
+    {
+        uint32_t const u32Extra = RT_LE2H_U32(*pu32Extra);
+        cSecs += (int64_t)EXT4_INODE_EXTRA_TIME_EPOCH(u32Extra) << 32;
+        cNs    = EXT4_INODE_EXTRA_TIME_NSEC(u32Extra);
+        if (cNs >= RT_NS_1SEC)
+            cNs = 0;
+        /* The epoch bits reach past what RTTIMESPEC can represent (year 2262). */
+        if (cSecs >= INT64_MAX / RT_NS_1SEC)
+            cSecs = INT64_MAX / RT_NS_1SEC - 1;
+    }
+    RTTimeSpecAddNano(RTTimeSpecSetSeconds(pTime, cSecs), cNs);
+}
+
+
+/**
+ * Parses a raw inode.
+ *
+ * @param   pThis       EXT filesystem instance data.
+ * @param   pRaw        The raw inode (cbInode bytes).
+ * @param   iInode      The inode number.
+ * @param   pInode      Where to return the parsed inode.
+ */
+static void rtFsExtInodeParse(PRTFILESYSTEMEXT pThis, PCEXT4INODE pRaw, uint32_t iInode, PRTFSEXTINODE pInode)
+{
+    uint16_t const fMode   = RT_LE2H_U16(pRaw->Core.fMode);
+    uint32_t const fFlags  = RT_LE2H_U32(pRaw->Core.fFlags);
+    uint32_t const cbExtra = pThis->cbInode > sizeof(EXT2INODE) ? RT_LE2H_U16(pRaw->cbInodeExtra) : 0;
+#define HAS_EXTRA_FIELD(a_Member) \
+        (   pThis->cbInode >= RT_UOFFSETOF(EXT4INODE, a_Member) + sizeof(uint32_t) \
+         && sizeof(EXT2INODE) + cbExtra >= RT_UOFFSETOF(EXT4INODE, a_Member) + sizeof(uint32_t))
+
+    pInode->iInode = iInode;
+    pInode->fFlags = fFlags;
+    memcpy(pInode->au32Block, pRaw->Core.au32Block, sizeof(pInode->au32Block));
+
+    PRTFSOBJINFO pObjInfo = &pInode->ObjInfo;
+    pObjInfo->cbObject = RT_LE2H_U32(pRaw->Core.cbSizeLow);
+    if (   !RTFS_IS_DIRECTORY(fMode)
+        || (pThis->fFeaturesIncompat & EXT2_FEATURE_INCOMPAT_LARGEDIR))
+        pObjInfo->cbObject |= (uint64_t)RT_LE2H_U32(pRaw->Core.cbSizeHigh) << 32;
+
+    uint64_t cBlocks = RT_LE2H_U32(pRaw->Core.cBlocksLow);
+    if (pThis->fFeaturesCompatRo & EXT2_FEATURE_RO_COMPAT_HUGE_FILE)
+        cBlocks |= (uint64_t)RT_LE2H_U16(pRaw->Core.cBlocksHigh) << 32;
+    if (fFlags & EXT4_INODE_FLAGS_HUGE_FILE)
+        pObjInfo->cbAllocated = cBlocks << pThis->cBlockShift;
+    else
+        pObjInfo->cbAllocated = cBlocks * 512;
+
+    rtFsExtTimeFromInode(&pObjInfo->AccessTime, pRaw->Core.u32TimeLastAccess,
+                         HAS_EXTRA_FIELD(u32ExtraTimeLastAccess) ? &pRaw->u32ExtraTimeLastAccess : NULL);
+    rtFsExtTimeFromInode(&pObjInfo->ModificationTime, pRaw->Core.u32TimeLastModification,
+                         HAS_EXTRA_FIELD(u32ExtraTimeLastModification) ? &pRaw->u32ExtraTimeLastModification : NULL);
+    rtFsExtTimeFromInode(&pObjInfo->ChangeTime, pRaw->Core.u32TimeLastChange,
+                         HAS_EXTRA_FIELD(u32ExtraTimeLastChange) ? &pRaw->u32ExtraTimeLastChange : NULL);
+    if (HAS_EXTRA_FIELD(u32ExtraTimeCreation))
+        rtFsExtTimeFromInode(&pObjInfo->BirthTime, pRaw->u32TimeCreation, &pRaw->u32ExtraTimeCreation);
+    else
+        pObjInfo->BirthTime = pObjInfo->ChangeTime;
+#undef HAS_EXTRA_FIELD
+
+    pObjInfo->Attr.fMode                 = rtFsModeFromUnix(fMode, NULL, 0);
+    pObjInfo->Attr.enmAdditional         = RTFSOBJATTRADD_UNIX;
+    pObjInfo->Attr.u.Unix.uid            = RT_LE2H_U16(pRaw->Core.uUidLow) | ((uint32_t)RT_LE2H_U16(pRaw->Core.uUidHigh) << 16);
+    pObjInfo->Attr.u.Unix.gid            = RT_LE2H_U16(pRaw->Core.uGidLow) | ((uint32_t)RT_LE2H_U16(pRaw->Core.uGidHigh) << 16);
+    pObjInfo->Attr.u.Unix.cHardlinks     = RT_LE2H_U16(pRaw->Core.cHardLinks);
+    pObjInfo->Attr.u.Unix.INodeIdDevice  = 0;
+    pObjInfo->Attr.u.Unix.INodeId        = iInode;
+    pObjInfo->Attr.u.Unix.fFlags         = 0;
+    pObjInfo->Attr.u.Unix.GenerationId   = RT_LE2H_U32(pRaw->Core.u32Generation);
+    pObjInfo->Attr.u.Unix.Device         = 0;
+    if (RTFS_IS_DEV_CHAR(fMode) || RTFS_IS_DEV_BLOCK(fMode))
+    {
+        /* Old style (8:8) encoding in the first block pointer, new style in the second. */
+        uint32_t const uOld = RT_LE2H_U32(pRaw->Core.au32Block[0]);
+        uint32_t const uNew = RT_LE2H_U32(pRaw->Core.au32Block[1]);
+        if (uOld)
+            pObjInfo->Attr.u.Unix.Device = RTDEV_MAKE((uOld >> 8) & 0xff, uOld & 0xff);
+        else
+            pObjInfo->Attr.u.Unix.Device = RTDEV_MAKE((uNew >> 8) & 0xfff, ((uNew & 0xff) | ((uNew >> 12) & 0xfff00)));
+    }
+
+    /* Fast symbolic links keep the target in the block pointer array and have
+       no data blocks (an extended attribute block may be accounted for). */
+    uint64_t cbXattrBlock = 0;
+    if (pRaw->Core.offExtAttrLow || pRaw->Core.offExtAttrHigh)
+        cbXattrBlock = pThis->cbBlock;
+    pInode->fFastSymlink = RTFS_IS_SYMLINK(fMode)
+                        && !(fFlags & (EXT4_INODE_FLAGS_EXTENTS | EXT4_INODE_FLAGS_INLINE_DATA))
+                        && (uint64_t)pObjInfo->cbObject < sizeof(pInode->au32Block)
+                        && (uint64_t)pObjInfo->cbAllocated <= cbXattrBlock;
+}
+
+
+/**
+ * Gets the raw inode thru the block cache.
+ *
+ * The caller must own the cache critical section.
+ *
+ * @returns IPRT status code.
+ * @param   pThis       EXT filesystem instance data.
+ * @param   iInode      The inode number.
+ * @param   ppRaw       Where to return the pointer to the raw inode.  Only
+ *                      valid until the next cache call.
+ */
+static int rtFsExtInodeGetRaw(PRTFILESYSTEMEXT pThis, uint32_t iInode, PCEXT4INODE *ppRaw)
+{
+    if (RT_LIKELY(iInode - 1 < pThis->cInodesTotal))
+    { /* likely */ }
+    else
+    {
+        Log(("rtFsExtInodeGetRaw: iInode=%#RX32 is out of range (cInodesTotal=%#RX32)\n", iInode, pThis->cInodesTotal));
+        return VERR_FILESYSTEM_CORRUPT;
+    }
+
+    uint32_t const iBlkGrp    = (iInode - 1) / pThis->cInodesPerGroup;
+    uint64_t const offInTable = (uint64_t)((iInode - 1) % pThis->cInodesPerGroup) * pThis->cbInode;
+    uint8_t const *pbBlock;
+    int rc = rtFsExtBlockCacheGet(pThis, pThis->paGroups[iBlkGrp].iInodeTable + (offInTable >> pThis->cBlockShift), &pbBlock);
+    if (RT_SUCCESS(rc))
+        *ppRaw = (PCEXT4INODE)&pbBlock[offInTable & (pThis->cbBlock - 1)];
+    return rc;
+}
+
+
+/**
+ * Loads an inode thru the inode cache.
+ *
+ * @returns IPRT status code.
+ * @param   pThis       EXT filesystem instance data.
+ * @param   iInode      The inode number.
+ * @param   pInode      Where to return a copy of the parsed inode.
+ */
+static int rtFsExtInodeLoad(PRTFILESYSTEMEXT pThis, uint32_t iInode, PRTFSEXTINODE pInode)
+{
+    int rc = VINF_SUCCESS;
+    RTCritSectEnter(&pThis->CritSect);
+
+    PRTFSEXTINODE pCached = &pThis->paInodeCache[iInode & (RTFSEXT_INODE_CACHE_ENTRIES - 1)];
+    if (pCached->iInode == iInode && iInode != 0)
+        pThis->cInodeCacheHits++;
+    else
+    {
+        pThis->cInodeCacheMisses++;
+        pCached->iInode = 0;
+        PCEXT4INODE pRaw;
+        rc = rtFsExtInodeGetRaw(pThis, iInode, &pRaw);
+        if (RT_SUCCESS(rc))
+            rtFsExtInodeParse(pThis, pRaw, iInode, pCached);
+    }
+    if (RT_SUCCESS(rc))
+        *pInode = *pCached;
+
+    RTCritSectLeave(&pThis->CritSect);
+    return rc;
+}
+
+
+/**
+ * Loads the inline data of an inode (EXT4_INODE_FLAGS_INLINE_DATA).
+ *
+ * The first part lives in the block pointer array, the remainder in the
+ * "system.data" extended attribute stored in the inode itself.
+ *
+ * @returns IPRT status code.
+ * @param   pThis       EXT filesystem instance data.
+ * @param   iInode      The inode number.
+ * @param   ppbData     Where to return the data (RTMemFree).
+ * @param   pcbData     Where to return the data size.
+ */
+static int rtFsExtInodeLoadInline(PRTFILESYSTEMEXT pThis, uint32_t iInode, uint8_t **ppbData, size_t *pcbData)
+{
+    RTCritSectEnter(&pThis->CritSect);
+
+    PCEXT4INODE pRaw;
+    int rc = rtFsExtInodeGetRaw(pThis, iInode, &pRaw);
+    if (RT_SUCCESS(rc))
+    {
+        uint8_t const *pbXattrValue = NULL;
+        uint32_t       cbXattrValue = 0;
+        uint32_t const cbExtra      = pThis->cbInode > sizeof(EXT2INODE) ? RT_LE2H_U16(pRaw->cbInodeExtra) : 0;
+        uint32_t const offXattrs    = sizeof(EXT2INODE) + RT_ALIGN_32(cbExtra, 4);
+        if (offXattrs + sizeof(uint32_t) <= pThis->cbInode)
+        {
+            uint8_t const *pbInode = (uint8_t const *)pRaw;
+            if (RT_LE2H_U32(*(uint32_t const *)&pbInode[offXattrs]) == EXT2_EA_INODE_MAGIC)
+            {
+                uint32_t const offFirst = offXattrs + sizeof(uint32_t);
+                uint32_t       off      = offFirst;
+                while (off + RT_UOFFSETOF(EXT2XATTRENTRY, achName) <= pThis->cbInode)
+                {
+                    PCEXT2XATTRENTRY pEntry = (PCEXT2XATTRENTRY)&pbInode[off];
+                    if (*(uint32_t const *)pEntry == 0)
+                        break;
+                    uint32_t const cbEntry = RT_ALIGN_32(RT_UOFFSETOF(EXT2XATTRENTRY, achName) + pEntry->cbName, 4);
+                    if (off + cbEntry > pThis->cbInode)
+                        break;
+                    if (   pEntry->uNameIndex == EXT2_XATTR_INDEX_SYSTEM
+                        && pEntry->cbName == 4
+                        && !memcmp(pEntry->achName, "data", 4))
+                    {
+                        uint32_t const offValue = offFirst + RT_LE2H_U16(pEntry->offValue);
+                        cbXattrValue = RT_LE2H_U32(pEntry->cbValue);
+                        if (   pEntry->iValueInode == 0
+                            && offValue <= pThis->cbInode
+                            && cbXattrValue <= pThis->cbInode - offValue)
+                            pbXattrValue = &pbInode[offValue];
+                        else
+                            cbXattrValue = 0;
+                        break;
+                    }
+                    off += cbEntry;
+                }
+            }
+        }
+
+        size_t const cbData = EXT4_INLINE_DATA_IN_INODE_SIZE + cbXattrValue;
+        uint8_t *pbData = (uint8_t *)RTMemAlloc(cbData);
+        if (pbData)
+        {
+            memcpy(pbData, pRaw->Core.au32Block, EXT4_INLINE_DATA_IN_INODE_SIZE);
+            if (cbXattrValue)
+                memcpy(&pbData[EXT4_INLINE_DATA_IN_INODE_SIZE], pbXattrValue, cbXattrValue);
+            *ppbData = pbData;
+            *pcbData = cbData;
+        }
+        else
+            rc = VERR_NO_MEMORY;
+    }
+
+    RTCritSectLeave(&pThis->CritSect);
+    return rc;
+}
+
+
+/**
+ * Validates an extent tree node header.
+ *
+ * @returns true if valid, false if not.
+ * @param   pHdr        The header.
+ * @param   cbNode      The size of the node.
+ * @param   uDepth      The expected depth, UINT16_MAX if not known.
+ */
+static bool rtFsExtExtentHdrIsValid(PCEXT4EXTENTHDR pHdr, size_t cbNode, uint16_t uDepth)
+{
+    uint16_t const cMax = RT_LE2H_U16(pHdr->cMax);
+    return RT_LE2H_U16(pHdr->u16Magic) == EXT4_EXTENT_HDR_MAGIC
+        && RT_LE2H_U16(pHdr->cEntries) <= cMax
+        && sizeof(*pHdr) + (size_t)cMax * sizeof(EXT4EXTENT) <= cbNode
+        && (uDepth == UINT16_MAX ? RT_LE2H_U16(pHdr->uDepth) <= EXT4_EXTENT_MAX_DEPTH : RT_LE2H_U16(pHdr->uDepth) == uDepth);
+}
+
+
+/**
+ * Maps a logical block of an inode using extents to a physical block.
+ *
+ * @returns IPRT status code.
+ * @param   pThis       EXT filesystem instance data.
+ * @param   pInode      The inode.
+ * @param   iLogBlock   The logical block to map.
+ * @param   pMap        Where to return the mapping, the number of blocks is
+ *                      that of the contiguous run starting at @a iLogBlock.
+ */
+static int rtFsExtInodeMapExtents(PRTFILESYSTEMEXT pThis, PCRTFSEXTINODE pInode, uint64_t iLogBlock, PRTFSEXTMAPCACHE pMap)
+{
+    PCEXT4EXTENTHDR pHdr = (PCEXT4EXTENTHDR)&pInode->au32Block[0];
+    if (!rtFsExtExtentHdrIsValid(pHdr, sizeof(pInode->au32Block), UINT16_MAX))
+    {
+        Log(("rtFsExtInodeMapExtents: Inode %#RX32 has a bad extent tree root\n", pInode->iInode));
+        return VERR_FILESYSTEM_CORRUPT;
+    }
+
+    pMap->iLogBlock  = iLogBlock;
+    pMap->iPhysBlock = 0;
+    bool     fRightmost = true;
+    uint16_t uDepth     = RT_LE2H_U16(pHdr->uDepth);
+    while (uDepth > 0)
+    {
+        /* Find the last index entry starting at or before the block. */
+        PCEXT4EXTENTIDX paIdx    = (PCEXT4EXTENTIDX)(pHdr + 1);
+        uint32_t const  cEntries = RT_LE2H_U16(pHdr->cEntries);
+        if (!cEntries || iLogBlock < RT_LE2H_U32(paIdx[0].iBlock))
+        {
+            pMap->cBlocks = cEntries ? RT_LE2H_U32(paIdx[0].iBlock) - iLogBlock : 1;
+            return VINF_SUCCESS;
+        }
+        uint32_t iLow  = 0;
+        uint32_t iHigh = cEntries - 1;
+        while (iLow < iHigh)
+        {
+            uint32_t const iMid = iLow + (iHigh - iLow + 1) / 2;
+            if (RT_LE2H_U32(paIdx[iMid].iBlock) <= iLogBlock)
+                iLow = iMid;
+            else
+                iHigh = iMid - 1;
+        }
+        fRightmost &= iLow == cEntries - 1;
+
+        uint64_t const iChild = RT_LE2H_U32(paIdx[iLow].offChildLow) | ((uint64_t)RT_LE2H_U16(paIdx[iLow].offChildHigh) << 32);
+        uint8_t const *pbBlock;
+        int rc = rtFsExtBlockCacheGet(pThis, iChild, &pbBlock);
+        if (RT_FAILURE(rc))
+            return rc;
+        pHdr = (PCEXT4EXTENTHDR)pbBlock;
+        uDepth--;
+        if (!rtFsExtExtentHdrIsValid(pHdr, pThis->cbBlock, uDepth))
+        {
+            Log(("rtFsExtInodeMapExtents: Inode %#RX32 has a bad extent tree node at %#RX64\n", pInode->iInode, iChild));
+            return VERR_FILESYSTEM_CORRUPT;
+        }
+    }
+
+    /* Find the last extent starting at or before the block. */
+    PCEXT4EXTENT   paExtents = (PCEXT4EXTENT)(pHdr + 1);
+    uint32_t const cEntries  = RT_LE2H_U16(pHdr->cEntries);
+    if (!cEntries || iLogBlock < RT_LE2H_U32(paExtents[0].iBlock))
+    {
+        pMap->cBlocks = cEntries ? RT_LE2H_U32(paExtents[0].iBlock) - iLogBlock : fRightmost ? UINT32_MAX : 1;
+        return VINF_SUCCESS;
+    }
+    uint32_t iLow  = 0;
+    uint32_t iHigh = cEntries - 1;
+    while (iLow < iHigh)
+    {
+        uint32_t const iMid = iLow + (iHigh - iLow + 1) / 2;
+        if (RT_LE2H_U32(paExtents[iMid].iBlock) <= iLogBlock)
+            iLow = iMid;
+        else
+            iHigh = iMid - 1;
+    }
+
+    PCEXT4EXTENT   pExtent   = &paExtents[iLow];
+    uint64_t const iFirst    = RT_LE2H_U32(pExtent->iBlock);
+    uint32_t       cBlocks   = RT_LE2H_U16(pExtent->cBlocks);
+    bool const     fUninit   = cBlocks > EXT4_EXTENT_LENGTH_LIMIT;
+    if (fUninit)
+        cBlocks -= EXT4_EXTENT_LENGTH_LIMIT;
+    if (iLogBlock < iFirst + cBlocks)
+    {
+        pMap->cBlocks = iFirst + cBlocks - iLogBlock;
+        if (!fUninit) /* Uninitialized extents read as zeros. */
+        {
+            uint64_t const iStart = RT_LE2H_U32(pExtent->offStartLow) | ((uint64_t)RT_LE2H_U16(pExtent->offStartHigh) << 32);
+            if (   iStart + cBlocks > pThis->cBlocksTotal
+                || iStart + cBlocks < iStart)
+            {
+                Log(("rtFsExtInodeMapExtents: Inode %#RX32 has an extent outside the volume: %#RX64 LB %#RX32\n",
+                     pInode->iInode, iStart, cBlocks));
+                return VERR_FILESYSTEM_CORRUPT;
+            }
+            pMap->iPhysBlock = iStart + (iLogBlock - iFirst);
+        }
+    }
+    else if (iLow + 1 < cEntries)
+        pMap->cBlocks = RT_LE2H_U32(pExtent[1].iBlock) - iLogBlock;
+    else
+        pMap->cBlocks = fRightmost ? UINT32_MAX : 1;
+    return VINF_SUCCESS;
+}
+
+
+/**
+ * Maps a logical block of an inode using indirect blocks to a physical block.
+ *
+ * @returns IPRT status code.
+ * @param   pThis       EXT filesystem instance data.
+ * @param   pInode      The inode.
+ * @param   iLogBlock   The logical block to map.
+ * @param   pMap        Where to return the mapping, the number of blocks is
+ *                      that of the contiguous run starting at @a iLogBlock
+ *                      within the same pointer block.
+ */
+static int rtFsExtInodeMapIndirect(PRTFILESYSTEMEXT pThis, PCRTFSEXTINODE pInode, uint64_t iLogBlock, PRTFSEXTMAPCACHE pMap)
+{
+    uint32_t const cPtrShift = pThis->cBlockShift - 2;
+    uint64_t const cPtrs     = RT_BIT_64(cPtrShift);
+
+    pMap->iLogBlock  = iLogBlock;
+    pMap->iPhysBlock = 0;
+
+    /* Work out which pointer in the inode to start with and the indexes at
+       each indirection level. */
+    uint32_t const *pau32Ptrs = &pInode->au32Block[0];
+    uint32_t        cEntries  = EXT2_INODE_BLOCK_DIRECT_ENTRIES;
+    uint32_t        idx;
+    unsigned        cLevels;
+    uint64_t        iRel      = iLogBlock;
+    if (iRel < EXT2_INODE_BLOCK_DIRECT_ENTRIES)
+    {
+        idx     = (uint32_t)iRel;
+        cLevels = 0;
+    }
+    else
+    {
+        iRel -= EXT2_INODE_BLOCK_DIRECT_ENTRIES;
+        cLevels = 1;
+        while (iRel >= RT_BIT_64(cPtrShift * cLevels))
+        {
+            iRel -= RT_BIT_64(cPtrShift * cLevels);
+            if (++cLevels > 3)
+                return VERR_OUT_OF_RANGE;
+        }
+        idx = EXT2_INODE_BLOCK_IND + cLevels - 1;
+    }
+
+    for (unsigned iLevel = cLevels; iLevel > 0; iLevel--)
+    {
+        uint64_t const iPtrBlock = RT_LE2H_U32(pau32Ptrs[idx]);
+        if (!iPtrBlock)
+        {
+            pMap->cBlocks = 1;
+            return VINF_SUCCESS;
+        }
+        uint8_t const *pbBlock;
+        int rc = rtFsExtBlockCacheGet(pThis, iPtrBlock, &pbBlock);
+        if (RT_FAILURE(rc))
+            return rc;
+        pau32Ptrs = (uint32_t const *)pbBlock;
+        cEntries  = (uint32_t)cPtrs;
+        idx       = (uint32_t)((iRel >> (cPtrShift * (iLevel - 1))) & (cPtrs - 1));
+    }
+
+    /* Count the contiguous run (or hole). */
+    uint32_t const iFirst = RT_LE2H_U32(pau32Ptrs[idx]);
+    uint32_t       i      = idx + 1;
+    if (iFirst)
+        while (i < cEntries && RT_LE2H_U32(pau32Ptrs[i]) == iFirst + (i - idx))
+            i++;
+    else
+        while (i < cEntries && pau32Ptrs[i] == 0)
+            i++;
+    pMap->cBlocks = i - idx;
+    if (iFirst)
+    {
+        if (iFirst + (uint64_t)pMap->cBlocks > pThis->cBlocksTotal)
+        {
+            Log(("rtFsExtInodeMapIndirect: Inode %#RX32 block %#RX64 maps outside the volume: %#RX32\n",
+                 pInode->iInode, iLogBlock, iFirst));
+            return VERR_FILESYSTEM_CORRUPT;
+        }
+        pMap->iPhysBlock = iFirst;
+    }
+    return VINF_SUCCESS;
+}
+
+
+/**
+ * Maps a logical block of an object, using the last mapping if possible.
+ *
+ * The cache critical section may be owned by the caller.
+ *
+ * @returns IPRT status code.
+ * @param   pCore       The object core.
+ * @param   iLogBlock   The logical block to map.
+ * @param   piPhysBlock Where to return the physical block, 0 if sparse.
+ * @param   pcBlocks    Where to return the number of contiguous blocks.
+ */
+static int rtFsExtCore_MapBlock(PRTFSEXTCORE pCore, uint64_t iLogBlock, uint64_t *piPhysBlock, uint64_t *pcBlocks)
+{
+    PRTFILESYSTEMEXT const pVol = pCore->pVol;
+    PRTFSEXTMAPCACHE const pMap = &pCore->Map;
+    int rc = VINF_SUCCESS;
+    RTCritSectEnter(&pVol->CritSect);
+
+    if (   iLogBlock < pMap->iLogBlock
+        || iLogBlock - pMap->iLogBlock >= pMap->cBlocks)
+    {
+        if (pCore->Inode.fFlags & EXT4_INODE_FLAGS_EXTENTS)
+            rc = rtFsExtInodeMapExtents(pVol, &pCore->Inode, iLogBlock, pMap);
+        else
+            rc = rtFsExtInodeMapIndirect(pVol, &pCore->Inode, iLogBlock, pMap);
+        if (RT_FAILURE(rc))
+            pMap->cBlocks = 0;
+        Assert(RT_FAILURE(rc) || pMap->cBlocks > 0);
+    }
+    if (RT_SUCCESS(rc))
+    {
+        uint64_t const offRun = iLogBlock - pMap->iLogBlock;
+        *piPhysBlock = pMap->iPhysBlock ? pMap->iPhysBlock + offRun : 0;
+        *pcBlocks    = pMap->cBlocks - offRun;
+    }
+
+    RTCritSectLeave(&pVol->CritSect);
+    return rc;
+}
+
+
+/**
+ * Reads data from an object, no EOF checking.
+ *
+ * Contiguous blocks are read in one go, sparse blocks are zero filled.
+ *
+ * @returns IPRT status code.
+ * @param   pCore       The object core.
+ * @param   off         The byte offset to start reading at.
+ * @param   pvBuf       Where to put the data.
+ * @param   cbToRead    How much to read.
+ */
+static int rtFsExtCore_ReadAt(PRTFSEXTCORE pCore, uint64_t off, void *pvBuf, size_t cbToRead)
+{
+    uint8_t *pbDst = (uint8_t *)pvBuf;
+    if (pCore->pbInline)
+    {
+        size_t const cbAvail = off < pCore->cbInline ? pCore->cbInline - (size_t)off : 0;
+        size_t const cbCopy  = RT_MIN(cbAvail, cbToRead);
+        memcpy(pbDst, &pCore->pbInline[off], cbCopy);
+        RT_BZERO(&pbDst[cbCopy], cbToRead - cbCopy);
+        return VINF_SUCCESS;
+    }
+
+    PRTFILESYSTEMEXT const pVol = pCore->pVol;
+    while (cbToRead > 0)
+    {
+        uint64_t iPhysBlock;
+        uint64_t cBlocks;
+        int rc = rtFsExtCore_MapBlock(pCore, off >> pVol->cBlockShift, &iPhysBlock, &cBlocks);
+        if (RT_FAILURE(rc))
+            return rc;
+
+        uint64_t const offInBlock = off & (pVol->cbBlock - 1);
+        uint64_t const cbRun      = cBlocks >= (UINT64_MAX >> pVol->cBlockShift) ? UINT64_MAX
+                                  : (cBlocks << pVol->cBlockShift) - offInBlock;
+        size_t const   cbThis     = (size_t)RT_MIN(cbRun, cbToRead);
+        if (iPhysBlock)
+        {
+            rc = RTVfsFileReadAt(pVol->hVfsFile, (iPhysBlock << pVol->cBlockShift) + offInBlock, pbDst, cbThis, NULL);
+            if (RT_FAILURE(rc))
+                return rc;
+        }
+        else
+            RT_BZERO(pbDst, cbThis);
+
+        pbDst    += cbThis;
+        off      += cbThis;
+        cbToRead -= cbThis;
+    }
+    return VINF_SUCCESS;
+}
+
+
+/**
+ * Initializes the core data of a new object.
+ *
+ * @returns IPRT status code.
+ * @param   pCore       The object core (zeroed).
+ * @param   pVol        The volume.
+ * @param   pInode      The inode.
+ */
+static int rtFsExtCore_Init(PRTFSEXTCORE pCore, PRTFILESYSTEMEXT pVol, PCRTFSEXTINODE pInode)
+{
+    pCore->pVol     = pVol;
+    pCore->Inode    = *pInode;
+    pCore->Map.cBlocks = 0;
+    pCore->pbInline = NULL;
+    pCore->cbInline = 0;
+    if (pInode->fFlags & EXT2_INODE_FLAGS_ENCRYPTED)
+        return VERR_NOT_SUPPORTED;
+    if (pInode->fFlags & EXT4_INODE_FLAGS_INLINE_DATA)
+        return rtFsExtInodeLoadInline(pVol, pInode->iInode, &pCore->pbInline, &pCore->cbInline);
+    return VINF_SUCCESS;
+}
+
+
+/**
+ * Cleans up the core data of an object.
+ *
+ * @param   pCore       The object core.
+ */
+static void rtFsExtCore_Destroy(PRTFSEXTCORE pCore)
+{
+    if (pCore->pbInline)
+    {
+        RTMemFree(pCore->pbInline);
+        pCore->pbInline = NULL;
+    }
+}
+
+
+/**
+ * Worker for the QueryInfo methods and ReadDir.
+ */
+static int rtFsExtCore_QueryInfo(PCRTFSEXTINODE pInode, PRTFSOBJINFO pObjInfo, RTFSOBJATTRADD enmAddAttr)
+{
+    *pObjInfo = pInode->ObjInfo;
+    switch (enmAddAttr)
+    {
+        case RTFSOBJATTRADD_NOTHING: RT_FALL_THRU();
+        case RTFSOBJATTRADD_UNIX:
+            pObjInfo->Attr.enmAdditional = RTFSOBJATTRADD_UNIX;
+            break;
+        case RTFSOBJATTRADD_UNIX_OWNER:
+            pObjInfo->Attr.enmAdditional         = RTFSOBJATTRADD_UNIX_OWNER;
+            pObjInfo->Attr.u.UnixOwner.uid       = pInode->ObjInfo.Attr.u.Unix.uid;
+            pObjInfo->Attr.u.UnixOwner.szName[0] = '\0';
+            break;
+        case RTFSOBJATTRADD_UNIX_GROUP:
+            pObjInfo->Attr.enmAdditional         = RTFSOBJATTRADD_UNIX_GROUP;
+            pObjInfo->Attr.u.UnixGroup.gid       = pInode->ObjInfo.Attr.u.Unix.gid;
+            pObjInfo->Attr.u.UnixGroup.szName[0] = '\0';
+            break;
+        case RTFSOBJATTRADD_EASIZE:
+            pObjInfo->Attr.enmAdditional = RTFSOBJATTRADD_EASIZE;
+            pObjInfo->Attr.u.EASize.cb   = 0;
+            break;
+        default:
+            return VERR_INVALID_PARAMETER;
+    }
+    return VINF_SUCCESS;
+}
+
+
+/**
+ * @interface_method_impl{RTVFSOBJOPS,pfnClose}
+ */
+static DECLCALLBACK(int) rtFsExtFile_Close(void *pvThis)
+{
+    PRTFSEXTFILE pThis = (PRTFSEXTFILE)pvThis;
+    LogFlow(("rtFsExtFile_Close(%p/%#RX32)\n", pThis, pThis->Core.Inode.iInode));
+    rtFsExtCore_Destroy(&pThis->Core);
+    return VINF_SUCCESS;
+}
+
+
+/**
+ * @interface_method_impl{RTVFSOBJOPS,pfnQueryInfo}
+ */
+static DECLCALLBACK(int) rtFsExtFile_QueryInfo(void *pvThis, PRTFSOBJINFO pObjInfo, RTFSOBJATTRADD enmAddAttr)
+{
+    PRTFSEXTFILE pThis = (PRTFSEXTFILE)pvThis;
+    return rtFsExtCore_QueryInfo(&pThis->Core.Inode, pObjInfo, enmAddAttr);
+}
+
+
+/**
+ * @interface_method_impl{RTVFSIOSTREAMOPS,pfnRead}
+ */
+static DECLCALLBACK(int) rtFsExtFile_Read(void *pvThis, RTFOFF off, PCRTSGBUF pSgBuf, bool fBlocking, size_t *pcbRead)
+{
+    PRTFSEXTFILE pThis = (PRTFSEXTFILE)pvThis;
+    AssertReturn(pSgBuf->cSegs == 1, VERR_INTERNAL_ERROR_3);
+    RT_NOREF(fBlocking);
+
+    if (off == -1)
+        off = pThis->offFile;
+    else
+        AssertReturn(off >= 0, VERR_INTERNAL_ERROR_3);
+
+    /*
+     * Check for EOF.
+     */
+    uint64_t const cbObject = pThis->Core.Inode.ObjInfo.cbObject;
+    if ((uint64_t)off >= cbObject)
+    {
+        if (pcbRead)
+        {
+            *pcbRead = 0;
+            return VINF_EOF;
+        }
+        return VERR_EOF;
+    }
+
+    int    rcRet    = VINF_SUCCESS;
+    size_t cbToRead = pSgBuf->paSegs[0].cbSeg;
+    if (cbToRead > cbObject - (uint64_t)off)
+    {
+        if (!pcbRead)
+            return VERR_EOF;
+        cbToRead = (size_t)(cbObject - (uint64_t)off);
+        rcRet = VINF_EOF;
+    }
+
+    /*
+     * Do the reading.
+     */
+    int rc = rtFsExtCore_ReadAt(&pThis->Core, off, pSgBuf->paSegs[0].pvSeg, cbToRead);
+    if (RT_SUCCESS(rc))
+    {
+        pThis->offFile = off + cbToRead;
+        if (pcbRead)
+            *pcbRead = cbToRead;
+        return rcRet;
+    }
+    if (pcbRead)
+        *pcbRead = 0;
+    return rc;
+}
+
+
+/**
+ * @interface_method_impl{RTVFSIOSTREAMOPS,pfnFlush}
+ */
+static DECLCALLBACK(int) rtFsExtFile_Flush(void *pvThis)
+{
+    RT_NOREF(pvThis);
+    return VINF_SUCCESS;
+}
+
+
+/**
+ * @interface_method_impl{RTVFSIOSTREAMOPS,pfnPollOne}
+ */
+static DECLCALLBACK(int) rtFsExtFile_PollOne(void *pvThis, uint32_t fEvents, RTMSINTERVAL cMillies, bool fIntr,
+                                             uint32_t *pfRetEvents)
+{
+    NOREF(pvThis);
+    int rc;
+    if (fEvents != RTPOLL_EVT_ERROR)
+    {
+        *pfRetEvents = fEvents & ~RTPOLL_EVT_ERROR;
+        rc = VINF_SUCCESS;
+    }
+    else if (fIntr)
+        rc = RTThreadSleep(cMillies);
+    else
+    {
+        uint64_t uMsStart = RTTimeMilliTS();
+        do
+            rc = RTThreadSleep(cMillies);
+        while (   rc == VERR_INTERRUPTED
+               && !fIntr
+               && RTTimeMilliTS() - uMsStart < cMillies);
+        if (rc == VERR_INTERRUPTED)
+            rc = VERR_TIMEOUT;
+    }
+    return rc;
+}
+
+
+/**
+ * @interface_method_impl{RTVFSIOSTREAMOPS,pfnTell}
+ */
+static DECLCALLBACK(int) rtFsExtFile_Tell(void *pvThis, PRTFOFF poffActual)
+{
+    PRTFSEXTFILE pThis = (PRTFSEXTFILE)pvThis;
+    *poffActual = pThis->offFile;
+    return VINF_SUCCESS;
+}
+
+
+/**
+ * @interface_method_impl{RTVFSFILEOPS,pfnSeek}
+ */
+static DECLCALLBACK(int) rtFsExtFile_Seek(void *pvThis, RTFOFF offSeek, unsigned uMethod, PRTFOFF poffActual)
+{
+    PRTFSEXTFILE pThis = (PRTFSEXTFILE)pvThis;
+    RTFOFF offNew;
+    switch (uMethod)
+    {
+        case RTFILE_SEEK_BEGIN:
+            offNew = offSeek;
+            break;
+        case RTFILE_SEEK_END:
+            offNew = (RTFOFF)pThis->Core.Inode.ObjInfo.cbObject + offSeek;
+            break;
+        case RTFILE_SEEK_CURRENT:
+            offNew = (RTFOFF)pThis->offFile + offSeek;
+            break;
+        default:
+            return VERR_INVALID_PARAMETER;
+    }
+    if (offNew >= 0)
+    {
+        pThis->offFile = offNew;
+        *poffActual    = offNew;
+        return VINF_SUCCESS;
+    }
+    return VERR_NEGATIVE_SEEK;
+}
+
+
+/**
+ * @interface_method_impl{RTVFSFILEOPS,pfnQuerySize}
+ */
+static DECLCALLBACK(int) rtFsExtFile_QuerySize(void *pvThis, uint64_t *pcbFile)
+{
+    PRTFSEXTFILE pThis = (PRTFSEXTFILE)pvThis;
+    *pcbFile = pThis->Core.Inode.ObjInfo.cbObject;
+    return VINF_SUCCESS;
+}
+
+
+/**
+ * EXT file operations.
+ */
+static const RTVFSFILEOPS g_rtFsExtFileOps =
+{
+    { /* Stream */
+        { /* Obj */
+            RTVFSOBJOPS_VERSION,
+            RTVFSOBJTYPE_FILE,
+            "ExtFile",
+            rtFsExtFile_Close,
+            rtFsExtFile_QueryInfo,
+            RTVFSOBJOPS_VERSION
+        },
+        RTVFSIOSTREAMOPS_VERSION,
+        RTVFSIOSTREAMOPS_FEAT_NO_SG,
+        rtFsExtFile_Read,
+        NULL /*Write*/,
+        rtFsExtFile_Flush,
+        rtFsExtFile_PollOne,
+        rtFsExtFile_Tell,
+        NULL /*pfnSkip*/,
+        NULL /*pfnZeroFill*/,
+        RTVFSIOSTREAMOPS_VERSION,
+    },
+    RTVFSFILEOPS_VERSION,
+    0,
+    { /* ObjSet */
+        RTVFSOBJSETOPS_VERSION,
+        RT_OFFSETOF(RTVFSFILEOPS, Stream.Obj) - RT_OFFSETOF(RTVFSFILEOPS, ObjSet),
+        NULL /*SetMode*/,
+        NULL /*SetTimes*/,
+        NULL /*SetOwner*/,
+        RTVFSOBJSETOPS_VERSION
+    },
+    rtFsExtFile_Seek,
+    rtFsExtFile_QuerySize,
+    NULL /*SetSize*/,
+    NULL /*QueryMaxSize*/,
+    RTVFSFILEOPS_VERSION
+};
+
+
+/**
+ * Instantiates a new file.
+ *
+ * @returns IPRT status code.
+ * @param   pThis       The EXT volume instance.
+ * @param   pInode      The inode of the file.
+ * @param   fOpen       RTFILE_O_XXX flags.
+ * @param   phVfsFile   Where to return the file handle.
+ */
+static int rtFsExtFile_New(PRTFILESYSTEMEXT pThis, PCRTFSEXTINODE pInode, uint64_t fOpen, PRTVFSFILE phVfsFile)
+{
+    PRTFSEXTFILE pNewFile;
+    int rc = RTVfsNewFile(&g_rtFsExtFileOps, sizeof(*pNewFile), fOpen, pThis->hVfsSelf, NIL_RTVFSLOCK /*use volume lock*/,
+                          phVfsFile, (void **)&pNewFile);
+    if (RT_SUCCESS(rc))
+    {
+        pNewFile->offFile = 0;
+        rc = rtFsExtCore_Init(&pNewFile->Core, pThis, pInode);
+        if (RT_SUCCESS(rc))
+            return VINF_SUCCESS;
+
+        RTVfsFileRelease(*phVfsFile);
+        *phVfsFile = NIL_RTVFSFILE;
+    }
+    return rc;
+}
+
+
+/**
+ * @interface_method_impl{RTVFSOBJOPS,pfnClose}
+ */
+static DECLCALLBACK(int) rtFsExtSym_Close(void *pvThis)
+{
+    PRTFSEXTSYMLINK pThis = (PRTFSEXTSYMLINK)pvThis;
+    rtFsExtCore_Destroy(&pThis->Core);
+    return VINF_SUCCESS;
+}
+
+
+/**
+ * @interface_method_impl{RTVFSOBJOPS,pfnQueryInfo}
+ */
+static DECLCALLBACK(int) rtFsExtSym_QueryInfo(void *pvThis, PRTFSOBJINFO pObjInfo, RTFSOBJATTRADD enmAddAttr)
+{
+    PRTFSEXTSYMLINK pThis = (PRTFSEXTSYMLINK)pvThis;
+    return rtFsExtCore_QueryInfo(&pThis->Core.Inode, pObjInfo, enmAddAttr);
+}
+
+
+/**
+ * @interface_method_impl{RTVFSSYMLINKOPS,pfnRead}
+ */
+static DECLCALLBACK(int) rtFsExtSym_Read(void *pvThis, char *pszTarget, size_t cbTarget)
+{
+    PRTFSEXTSYMLINK pThis    = (PRTFSEXTSYMLINK)pvThis;
+    uint64_t const  cbObject = pThis->Core.Inode.ObjInfo.cbObject;
+    if (cbObject >= RTPATH_MAX)
+        return VERR_FILENAME_TOO_LONG;
+    if (cbObject >= cbTarget)
+        return VERR_BUFFER_OVERFLOW;
+
+    int rc = VINF_SUCCESS;
+    if (pThis->Core.Inode.fFastSymlink)
+        memcpy(pszTarget, pThis->Core.Inode.au32Block, (size_t)cbObject);
+    else
+        rc = rtFsExtCore_ReadAt(&pThis->Core, 0, pszTarget, (size_t)cbObject);
+    pszTarget[RT_SUCCESS(rc) ? (size_t)cbObject : 0] = '\0';
+    return rc;
+}
+
+
+/**
+ * EXT symbolic link operations.
+ */
+static const RTVFSSYMLINKOPS g_rtFsExtSymOps =
+{
+    { /* Obj */
+        RTVFSOBJOPS_VERSION,
+        RTVFSOBJTYPE_SYMLINK,
+        "ExtSymlink",
+        rtFsExtSym_Close,
+        rtFsExtSym_QueryInfo,
+        RTVFSOBJOPS_VERSION
+    },
+    RTVFSSYMLINKOPS_VERSION,
+    0,
+    { /* ObjSet */
+        RTVFSOBJSETOPS_VERSION,
+        RT_OFFSETOF(RTVFSSYMLINKOPS, Obj) - RT_OFFSETOF(RTVFSSYMLINKOPS, ObjSet),
+        NULL /*SetMode*/,
+        NULL /*SetTimes*/,
+        NULL /*SetOwner*/,
+        RTVFSOBJSETOPS_VERSION
+    },
+    rtFsExtSym_Read,
+    RTVFSSYMLINKOPS_VERSION
+};
+
+
+/**
+ * Instantiates a new symbolic link.
+ *
+ * @returns IPRT status code.
+ * @param   pThis       The EXT volume instance.
+ * @param   pInode      The inode of the symbolic link.
+ * @param   phVfsSym    Where to return the symbolic link handle.
+ */
+static int rtFsExtSym_New(PRTFILESYSTEMEXT pThis, PCRTFSEXTINODE pInode, PRTVFSSYMLINK phVfsSym)
+{
+    PRTFSEXTSYMLINK pNewSym;
+    int rc = RTVfsNewSymlink(&g_rtFsExtSymOps, sizeof(*pNewSym), pThis->hVfsSelf, NIL_RTVFSLOCK /*use volume lock*/,
+                             phVfsSym, (void **)&pNewSym);
+    if (RT_SUCCESS(rc))
+    {
+        rc = rtFsExtCore_Init(&pNewSym->Core, pThis, pInode);
+        if (RT_SUCCESS(rc))
+            return VINF_SUCCESS;
+
+        RTVfsSymlinkRelease(*phVfsSym);
+        *phVfsSym = NIL_RTVFSSYMLINK;
+    }
+    return rc;
+}
+
+
+/**
+ * Converts the on-disk directory entry record length.
+ *
+ * @returns Record length in bytes.
+ * @param   u16RecLen   The on-disk record length (little endian).
+ */
+DECLINLINE(uint32_t) rtFsExtDirRecLen(uint16_t u16RecLen)
+{
+    uint32_t const cbRecord = RT_LE2H_U16(u16RecLen);
+    if (cbRecord == 0 || cbRecord == UINT16_MAX)
+        return _64K;
+    return (cbRecord & 0xfffc) | ((cbRecord & 3) << 16);
+}
+
+
+/**
+ * Validates the directory entry at the given offset of a directory block.
+ *
+ * @returns Record length if valid, 0 if not.
+ * @param   pbBlock     The directory block.
+ * @param   cbBlock     The size of the directory block.
+ * @param   off         The offset of the entry.
+ */
+static uint32_t rtFsExtDirEntryValidate(uint8_t const *pbBlock, uint32_t cbBlock, uint32_t off)
+{
+    if (off + EXT2_DIRENTRY_HDR_SIZE > cbBlock)
+        return 0;
+    PCEXT2DIRENTRY pEntry   = (PCEXT2DIRENTRY)&pbBlock[off];
+    uint32_t const cbRecord = rtFsExtDirRecLen(pEntry->cbRecord);
+    if (   cbRecord < EXT2_DIRENTRY_HDR_SIZE
+        || (cbRecord & 3)
+        || cbRecord > cbBlock - off
+        || EXT2_DIRENTRY_HDR_SIZE + (uint32_t)pEntry->cbName > cbRecord)
+        return 0;
+    return cbRecord;
+}
+
+
+/**
+ * Looks for a name in a directory block.
+ *
+ * @returns true if found, false if not.
+ * @param   pbBlock     The directory block.
+ * @param   cbBlock     The size of the directory block.
+ * @param   pszEntry    The name to look for.
+ * @param   cchEntry    The length of the name.
+ * @param   piInode     Where to return the inode number.
+ */
+static bool rtFsExtDirBlockFind(uint8_t const *pbBlock, uint32_t cbBlock, const char *pszEntry, size_t cchEntry,
+                                uint32_t *piInode)
+{
+    uint32_t off = 0;
+    while (off < cbBlock)
+    {
+        uint32_t const cbRecord = rtFsExtDirEntryValidate(pbBlock, cbBlock, off);
+        if (!cbRecord)
+        {
+            Log(("rtFsExtDirBlockFind: Bad directory entry at %#x\n", off));
+            break;
+        }
+        PCEXT2DIRENTRY pEntry = (PCEXT2DIRENTRY)&pbBlock[off];
+        if (   pEntry->cbName == cchEntry
+            && pEntry->iInodeRef != 0
+            && memcmp(pEntry->achName, pszEntry, cchEntry) == 0)
+        {
+            *piInode = RT_LE2H_U32(pEntry->iInodeRef);
+            return true;
+        }
+        off += cbRecord;
+    }
+    return false;
+}
+
+
+/** The legacy directory hash. */
+static uint32_t rtFsExtDirHashLegacy(const char *pchName, size_t cchName, bool fUnsigned)
+{
+    uint32_t uHash0 = UINT32_C(0x12a3fe2d);
+    uint32_t uHash1 = UINT32_C(0x37abe8f9);
+    for (size_t i = 0; i < cchName; i++)
+    {
+        int32_t  iCh   = fUnsigned ? (int32_t)(uint8_t)pchName[i] : (int32_t)(int8_t)pchName[i];
+        uint32_t uHash = uHash1 + (uHash0 ^ (uint32_t)(iCh * 7152373));
+        if (uHash & UINT32_C(0x80000000))
+            uHash -= UINT32_C(0x7fffffff);
+        uHash1 = uHash0;
+        uHash0 = uHash;
+    }
+    return uHash0 << 1;
+}
+
+
+/** Converts a name into the hash input buffer. */
+static void rtFsExtDirHashStrToBuf(const char *pchName, size_t cchName, uint32_t *pau32Buf, unsigned cWords, bool fUnsigned)
+{
+    uint32_t uPad = (uint32_t)cchName | ((uint32_t)cchName << 8);
+    uPad |= uPad << 16;
+
+    uint32_t uVal = uPad;
+    if (cchName > cWords * 4)
+        cchName = cWords * 4;
+    int cLeft = (int)cWords;
+    for (size_t i = 0; i < cchName; i++)
+    {
+        int32_t iCh = fUnsigned ? (int32_t)(uint8_t)pchName[i] : (int32_t)(int8_t)pchName[i];
+        uVal = (uint32_t)iCh + (uVal << 8);
+        if ((i % 4) == 3)
+        {
+            *pau32Buf++ = uVal;
+            uVal = uPad;
+            cLeft--;
+        }
+    }
+    if (--cLeft >= 0)
+        *pau32Buf++ = uVal;
+    while (--cLeft >= 0)
+        *pau32Buf++ = uPad;
+}
+
+
+/** The half MD4 transformation. */
+static void rtFsExtDirHashHalfMd4(uint32_t au32Hash[4], uint32_t const au32In[8])
+{
+    uint32_t a = au32Hash[0];
+    uint32_t b = au32Hash[1];
+    uint32_t c = au32Hash[2];
+    uint32_t d = au32Hash[3];
+#define MD4_F(x, y, z) ((z) ^ ((x) & ((y) ^ (z))))
+#define MD4_G(x, y, z) (((x) & (y)) + (((x) ^ (y)) & (z)))
+#define MD4_H(x, y, z) ((x) ^ (y) ^ (z))
+#define MD4_ROUND(f, a, b, c, d, x, s) do { (a) += f(b, c, d) + (x); (a) = ASMRotateLeftU32((a), (s)); } while (0)
+    MD4_ROUND(MD4_F, a, b, c, d, au32In[0],  3);
+    MD4_ROUND(MD4_F, d, a, b, c, au32In[1],  7);
+    MD4_ROUND(MD4_F, c, d, a, b, au32In[2], 11);
+    MD4_ROUND(MD4_F, b, c, d, a, au32In[3], 19);
+    MD4_ROUND(MD4_F, a, b, c, d, au32In[4],  3);
+    MD4_ROUND(MD4_F, d, a, b, c, au32In[5],  7);
+    MD4_ROUND(MD4_F, c, d, a, b, au32In[6], 11);
+    MD4_ROUND(MD4_F, b, c, d, a, au32In[7], 19);
+
+    MD4_ROUND(MD4_G, a, b, c, d, au32In[1] + UINT32_C(0x5a827999),  3);
+    MD4_ROUND(MD4_G, d, a, b, c, au32In[3] + UINT32_C(0x5a827999),  5);
+    MD4_ROUND(MD4_G, c, d, a, b, au32In[5] + UINT32_C(0x5a827999),  9);
+    MD4_ROUND(MD4_G, b, c, d, a, au32In[7] + UINT32_C(0x5a827999), 13);
+    MD4_ROUND(MD4_G, a, b, c, d, au32In[0] + UINT32_C(0x5a827999),  3);
+    MD4_ROUND(MD4_G, d, a, b, c, au32In[2] + UINT32_C(0x5a827999),  5);
+    MD4_ROUND(MD4_G, c, d, a, b, au32In[4] + UINT32_C(0x5a827999),  9);
+    MD4_ROUND(MD4_G, b, c, d, a, au32In[6] + UINT32_C(0x5a827999), 13);
+
+    MD4_ROUND(MD4_H, a, b, c, d, au32In[3] + UINT32_C(0x6ed9eba1),  3);
+    MD4_ROUND(MD4_H, d, a, b, c, au32In[7] + UINT32_C(0x6ed9eba1),  9);
+    MD4_ROUND(MD4_H, c, d, a, b, au32In[2] + UINT32_C(0x6ed9eba1), 11);
+    MD4_ROUND(MD4_H, b, c, d, a, au32In[6] + UINT32_C(0x6ed9eba1), 15);
+    MD4_ROUND(MD4_H, a, b, c, d, au32In[1] + UINT32_C(0x6ed9eba1),  3);
+    MD4_ROUND(MD4_H, d, a, b, c, au32In[5] + UINT32_C(0x6ed9eba1),  9);
+    MD4_ROUND(MD4_H, c, d, a, b, au32In[0] + UINT32_C(0x6ed9eba1), 11);
+    MD4_ROUND(MD4_H, b, c, d, a, au32In[4] + UINT32_C(0x6ed9eba1), 15);
+#undef MD4_ROUND
+#undef MD4_H
+#undef MD4_G
+#undef MD4_F
+    au32Hash[0] += a;
+    au32Hash[1] += b;
+    au32Hash[2] += c;
+    au32Hash[3] += d;
+}
+
+
+/** The TEA transformation. */
+static void rtFsExtDirHashTea(uint32_t au32Hash[4], uint32_t const au32In[4])
+{
+    uint32_t uSum = 0;
+    uint32_t b0   = au32Hash[0];
+    uint32_t b1   = au32Hash[1];
+    for (unsigned i = 0; i < 16; i++)
+    {
+        uSum += UINT32_C(0x9e3779b9);
+        b0 += ((b1 << 4) + au32In[0]) ^ (b1 + uSum) ^ ((b1 >> 5) + au32In[1]);
+        b1 += ((b0 << 4) + au32In[2]) ^ (b0 + uSum) ^ ((b0 >> 5) + au32In[3]);
+    }
+    au32Hash[0] += b0;
+    au32Hash[1] += b1;
+}
+
+
+/**
+ * Calculates the hash tree hash of a name.
+ *
+ * @returns The major hash value with the collision bit clear.
+ * @param   pThis       EXT filesystem instance data.
+ * @param   uHashVer    The hash version (EXT2_DIR_HASH_VER_XXX), must be valid.
+ * @param   pchName     The name.
+ * @param   cchName     The length of the name.
+ */
+static uint32_t rtFsExtDirHash(PRTFILESYSTEMEXT pThis, uint8_t uHashVer, const char *pchName, size_t cchName)
+{
+    uint32_t au32Hash[4] = { UINT32_C(0x67452301), UINT32_C(0xefcdab89), UINT32_C(0x98badcfe), UINT32_C(0x10325476) };
+    if (pThis->au32HashSeed[0] | pThis->au32HashSeed[1] | pThis->au32HashSeed[2] | pThis->au32HashSeed[3])
+        memcpy(au32Hash, pThis->au32HashSeed, sizeof(au32Hash));
+
+    uint32_t uHash;
+    bool const fUnsigned = uHashVer >= EXT2_DIR_HASH_VER_LEGACY_UNSIGNED;
+    switch (uHashVer)
+    {
+        case EXT2_DIR_HASH_VER_LEGACY:
+        case EXT2_DIR_HASH_VER_LEGACY_UNSIGNED:
+            uHash = rtFsExtDirHashLegacy(pchName, cchName, fUnsigned);
+            break;
+
+        case EXT2_DIR_HASH_VER_HALF_MD4:
+        case EXT2_DIR_HASH_VER_HALF_MD4_UNSIGNED:
+        {
+            uint32_t au32In[8];
+            do
+            {
+                rtFsExtDirHashStrToBuf(pchName, cchName, au32In, 8, fUnsigned);
+                rtFsExtDirHashHalfMd4(au32Hash, au32In);
+                pchName += RT_MIN(cchName, 32);
+                cchName -= RT_MIN(cchName, 32);
+            } while (cchName > 0);
+            uHash = au32Hash[1];
+            break;
+        }
+
+        case EXT2_DIR_HASH_VER_TEA:
+        case EXT2_DIR_HASH_VER_TEA_UNSIGNED:
+        {
+            uint32_t au32In[4];
+            do
+            {
+                rtFsExtDirHashStrToBuf(pchName, cchName, au32In, 4, fUnsigned);
+                rtFsExtDirHashTea(au32Hash, au32In);
+                pchName += RT_MIN(cchName, 16);
+                cchName -= RT_MIN(cchName, 16);
+            } while (cchName > 0);
+            uHash = au32Hash[0];
+            break;
+        }
+
+        default:
+            AssertFailedReturn(0);
+    }
+
+    uHash &= ~UINT32_C(1);
+    if (uHash == UINT32_C(0xfffffffe))
+        uHash = UINT32_C(0xfffffffc);
+    return uHash;
+}
+
+
+/**
+ * Hash tree index node position.
+ *
+ * We only keep positions and not pointers since the block cache may evict the
+ * blocks while we descend.
+ */
+typedef struct RTFSEXTHTREEFRAME
+{
+    /** The physical block of the node. */
+    uint64_t    iPhysBlock;
+    /** Offset of the count/limit entry in the block. */
+    uint32_t    offEntries;
+    /** Number of entries in the node. */
+    uint32_t    cEntries;
+    /** The current entry. */
+    uint32_t    iAt;
+} RTFSEXTHTREEFRAME;
+/** Pointer to a hash tree index node position. */
+typedef RTFSEXTHTREEFRAME *PRTFSEXTHTREEFRAME;
+
+
+/**
+ * Loads a hash tree index node, picks an entry and maps the block it points to.
+ *
+ * The caller must own the cache critical section.
+ *
+ * @returns IPRT status code, VERR_NOT_SUPPORTED if the node is bad.
+ * @param   pDir        The directory.
+ * @param   pFrame      The node position, iPhysBlock and offEntries are input.
+ * @param   fFirst      Whether to take the first entry rather than searching
+ *                      for @a uHash.
+ * @param   uHash       The hash to look for.
+ * @param   piPhysChild Where to return the physical block of the child.
+ */
+static int rtFsExtDir_HtreeLoadNode(PRTFSEXTDIR pDir, PRTFSEXTHTREEFRAME pFrame, bool fFirst, uint32_t uHash,
+                                    uint64_t *piPhysChild)
+{
+    uint8_t const *pbBlock;
+    int rc = rtFsExtBlockCacheGet(pDir->Core.pVol, pFrame->iPhysBlock, &pbBlock);
+    if (RT_FAILURE(rc))
+        return rc;
+
+    EXT2DIRHTREECOUNTLIMIT const *pCountLimit = (EXT2DIRHTREECOUNTLIMIT const *)&pbBlock[pFrame->offEntries];
+    PCEXT2DIRHTREEENTRY           paEntries   = (PCEXT2DIRHTREEENTRY)&pbBlock[pFrame->offEntries];
+    uint32_t const cEntries = RT_LE2H_U16(pCountLimit->cEntries);
+    uint32_t const cLimit   = RT_LE2H_U16(pCountLimit->cLimit);
+    if (   cEntries == 0
+        || cEntries > cLimit
+        || pFrame->offEntries + cLimit * sizeof(EXT2DIRHTREEENTRY) > pDir->Core.pVol->cbBlock)
+    {
+        Log(("rtFsExtDir_HtreeLoadNode: Bad index node at %#RX64: cEntries=%#x cLimit=%#x\n",
+             pFrame->iPhysBlock, cEntries, cLimit));
+        return VERR_NOT_SUPPORTED;
+    }
+
+    /* Find the last entry with a hash less or equal to the one we're looking for. */
+    uint32_t iAt = 0;
+    if (!fFirst)
+    {
+        uint32_t iLow  = 1;
+        uint32_t iHigh = cEntries;
+        while (iLow < iHigh)
+        {
+            uint32_t const iMid = iLow + (iHigh - iLow) / 2;
+            if (RT_LE2H_U32(paEntries[iMid].u32Hash) > uHash)
+                iHigh = iMid;
+            else
+                iLow = iMid + 1;
+        }
+        iAt = iLow - 1;
+    }
+    pFrame->cEntries = cEntries;
+    pFrame->iAt      = iAt;
+
+    uint64_t cBlocks;
+    rc = rtFsExtCore_MapBlock(&pDir->Core, RT_LE2H_U32(paEntries[iAt].iBlock) & RTFSEXT_HTREE_BLOCK_MASK, piPhysChild, &cBlocks);
+    if (RT_SUCCESS(rc) && !*piPhysChild)
+        rc = VERR_NOT_SUPPORTED;
+    return rc;
+}
+
+
+/**
+ * Looks up a name using the hash tree index of a directory.
+ *
+ * The caller must own the cache critical section.
+ *
+ * @returns IPRT status code.
+ * @retval  VERR_FILE_NOT_FOUND if not found.
+ * @retval  VERR_NOT_SUPPORTED if the index cannot be used, the caller should
+ *          fall back on a linear search.
+ * @param   pDir        The directory.
+ * @param   pszEntry    The name to look for.
+ * @param   cchEntry    The length of the name.
+ * @param   piInode     Where to return the inode number.
+ */
+static int rtFsExtDir_HtreeLookup(PRTFSEXTDIR pDir, const char *pszEntry, size_t cchEntry, uint32_t *piInode)
+{
+    PRTFILESYSTEMEXT const pVol    = pDir->Core.pVol;
+    uint32_t const         cbBlock = (uint32_t)pVol->cbBlock;
+    RTFSEXTHTREEFRAME      aFrames[EXT2_DIR_HTREE_MAX_LEVELS];
+
+    /*
+     * Check out the root.
+     */
+    uint64_t iPhysBlock;
+    uint64_t cBlocks;
+    int rc = rtFsExtCore_MapBlock(&pDir->Core, 0, &iPhysBlock, &cBlocks);
+    if (RT_FAILURE(rc))
+        return rc;
+    if (!iPhysBlock)
+        return VERR_NOT_SUPPORTED;
+
+    uint8_t const *pbBlock;
+    rc = rtFsExtBlockCacheGet(pVol, iPhysBlock, &pbBlock);
+    if (RT_FAILURE(rc))
+        return rc;
+    EXT2DIRHTREEROOTINFO const *pInfo = (EXT2DIRHTREEROOTINFO const *)&pbBlock[EXT2_DIR_HTREE_ROOT_INFO_OFF];
+    uint8_t uHashVer = pInfo->uHashVersion;
+    if (uHashVer <= EXT2_DIR_HASH_VER_TEA && pVol->fHashUnsigned)
+        uHashVer += EXT2_DIR_HASH_VER_LEGACY_UNSIGNED;
+    uint32_t const cMaxLevels = pVol->fFeaturesIncompat & EXT2_FEATURE_INCOMPAT_LARGEDIR ? EXT2_DIR_HTREE_MAX_LEVELS : 2;
+    if (   pInfo->u32Rsvd != 0
+        || pInfo->cbInfo != sizeof(*pInfo)
+        || pInfo->cIndirectLevels >= cMaxLevels
+        || uHashVer > EXT2_DIR_HASH_VER_TEA_UNSIGNED)
+    {
+        Log(("rtFsExtDir_HtreeLookup: Unsupported root: cbInfo=%#x cIndirectLevels=%u uHashVer=%u\n",
+             pInfo->cbInfo, pInfo->cIndirectLevels, uHashVer));
+        return VERR_NOT_SUPPORTED;
+    }
+    uint32_t const cIndirect = pInfo->cIndirectLevels;
+    uint32_t const uHash     = rtFsExtDirHash(pVol, uHashVer, pszEntry, cchEntry);
+
+    /*
+     * Walk down the tree to the leaf block.
+     */
+    aFrames[0].iPhysBlock = iPhysBlock;
+    aFrames[0].offEntries = EXT2_DIR_HTREE_ROOT_INFO_OFF + sizeof(*pInfo);
+    for (uint32_t iLevel = 0; iLevel <= cIndirect; iLevel++)
+    {
+        if (iLevel > 0)
+        {
+            aFrames[iLevel].iPhysBlock = iPhysBlock;
+            aFrames[iLevel].offEntries = EXT2_DIRENTRY_HDR_SIZE; /* Skip the fake empty entry. */
+        }
+        rc = rtFsExtDir_HtreeLoadNode(pDir, &aFrames[iLevel], false /*fFirst*/, uHash, &iPhysBlock);
+        if (RT_FAILURE(rc))
+            return rc;
+    }
+
+    for (;;)
+    {
+        /*
+         * Search the leaf block.
+         */
+        rc = rtFsExtBlockCacheGet(pVol, iPhysBlock, &pbBlock);
+        if (RT_FAILURE(rc))
+            return rc;
+        if (rtFsExtDirBlockFind(pbBlock, cbBlock, pszEntry, cchEntry, piInode))
+            return VINF_SUCCESS;
+
+        /*
+         * Not found.  If the next leaf starts with the same hash (collision),
+         * we have to continue searching there.
+         */
+        int iUp = (int)cIndirect;
+        while (iUp >= 0 && aFrames[iUp].iAt + 1 >= aFrames[iUp].cEntries)
+            iUp--;
+        if (iUp < 0)
+            return VERR_FILE_NOT_FOUND;
+
+        rc = rtFsExtBlockCacheGet(pVol, aFrames[iUp].iPhysBlock, &pbBlock);
+        if (RT_FAILURE(rc))
+            return rc;
+        PCEXT2DIRHTREEENTRY paEntries = (PCEXT2DIRHTREEENTRY)&pbBlock[aFrames[iUp].offEntries];
+        uint32_t const      iAt       = ++aFrames[iUp].iAt;
+        if ((RT_LE2H_U32(paEntries[iAt].u32Hash) & ~UINT32_C(1)) != uHash)
+            return VERR_FILE_NOT_FOUND;
+        rc = rtFsExtCore_MapBlock(&pDir->Core, RT_LE2H_U32(paEntries[iAt].iBlock) & RTFSEXT_HTREE_BLOCK_MASK,
+                                  &iPhysBlock, &cBlocks);
+        if (RT_FAILURE(rc))
+            return rc;
+        if (!iPhysBlock)
+            return VERR_NOT_SUPPORTED;
+
+        /* Descend along the first entries of the nodes below. */
+        for (uint32_t iLevel = (uint32_t)iUp + 1; iLevel <= cIndirect; iLevel++)
+        {
+            aFrames[iLevel].iPhysBlock = iPhysBlock;
+            aFrames[iLevel].offEntries = EXT2_DIRENTRY_HDR_SIZE;
+            rc = rtFsExtDir_HtreeLoadNode(pDir, &aFrames[iLevel], true /*fFirst*/, uHash, &iPhysBlock);
+            if (RT_FAILURE(rc))
+                return rc;
+        }
+    }
+}
+
+
+/**
+ * Looks up a name in a directory.
+ *
+ * @returns IPRT status code.
+ * @retval  VERR_FILE_NOT_FOUND if not found.
+ * @param   pThis       The directory.
+ * @param   pszEntry    The name to look for.
+ * @param   piInode     Where to return the inode number.
+ */
+static int rtFsExtDir_Lookup(PRTFSEXTDIR pThis, const char *pszEntry, uint32_t *piInode)
+{
+    size_t const cchEntry = strlen(pszEntry);
+    if (cchEntry > 255)
+        return VERR_FILENAME_TOO_LONG;
+    if (cchEntry == 1 && pszEntry[0] == '.')
+    {
+        *piInode = pThis->Core.Inode.iInode;
+        return VINF_SUCCESS;
+    }
+
+    /* Inline directories are a single block we've already got. */
+    if (pThis->Core.Inode.fFlags & EXT4_INODE_FLAGS_INLINE_DATA)
+        return rtFsExtDirBlockFind(pThis->pbBlock, pThis->cbDirBlock, pszEntry, cchEntry, piInode)
+             ? VINF_SUCCESS : VERR_FILE_NOT_FOUND;
+
+    PRTFILESYSTEMEXT const pVol = pThis->Core.pVol;
+    RTCritSectEnter(&pVol->CritSect);
+
+    /*
+     * Use the hash tree index if present.  The '.' and '..' entries are only
+     * found in the first block, which the index doesn't cover.
+     */
+    int rc = VERR_NOT_SUPPORTED;
+    if (   (pVol->fFeaturesCompat & EXT2_FEATURE_COMPAT_DIR_INDEX)
+        && (pThis->Core.Inode.fFlags & EXT2_INODE_FLAGS_INDEX)
+        && !(pThis->Core.Inode.fFlags & EXT4_INODE_FLAGS_CASEFOLD)
+        && !(cchEntry == 2 && pszEntry[0] == '.' && pszEntry[1] == '.'))
+        rc = rtFsExtDir_HtreeLookup(pThis, pszEntry, cchEntry, piInode);
+
+    /*
+     * Otherwise (or if the index is unusable) scan all the directory blocks.
+     */
+    if (rc == VERR_NOT_SUPPORTED)
+    {
+        uint64_t const cDirBlocks = (pThis->Core.Inode.ObjInfo.cbObject + pVol->cbBlock - 1) >> pVol->cBlockShift;
+        uint64_t       iLogBlock  = 0;
+        rc = VERR_FILE_NOT_FOUND;
+        while (iLogBlock < cDirBlocks)
+        {
+            uint64_t iPhysBlock;
+            uint64_t cBlocks;
+            int rc2 = rtFsExtCore_MapBlock(&pThis->Core, iLogBlock, &iPhysBlock, &cBlocks);
+            if (RT_FAILURE(rc2))
+            {
+                rc = rc2;
+                break;
+            }
+            cBlocks = RT_MIN(cBlocks, cDirBlocks - iLogBlock);
+            if (iPhysBlock)
+            {
+                for (uint64_t i = 0; i < cBlocks; i++)
+                {
+                    uint8_t const *pbBlock;
+                    rc2 = rtFsExtBlockCacheGet(pVol, iPhysBlock + i, &pbBlock);
+                    if (RT_FAILURE(rc2))
+                        break;
+                    if (rtFsExtDirBlockFind(pbBlock, (uint32_t)pVol->cbBlock, pszEntry, cchEntry, piInode))
+                    {
+                        rc2 = VINF_SUCCESS;
+                        break;
+                    }
+                    rc2 = VERR_FILE_NOT_FOUND;
+                }
+                if (rc2 != VERR_FILE_NOT_FOUND)
+                {
+                    rc = rc2;
+                    break;
+                }
+            }
+            iLogBlock += cBlocks;
+        }
+    }
+
+    RTCritSectLeave(&pVol->CritSect);
+    return rc;
+}
+
+
+/**
+ * Loads a directory block into the ReadDir buffer.
+ *
+ * @returns IPRT status code.
+ * @param   pThis       The directory.
+ * @param   iLogBlock   The logical block to load.
+ */
+static int rtFsExtDir_LoadBlock(PRTFSEXTDIR pThis, uint64_t iLogBlock)
 {
-    /** Start offset (in bytes and from the start of the disk). */
-    uint64_t    offStart;
-    /** Last offset in the block group (inclusive). */
-    uint64_t    offLast;
-    /** Block bitmap - variable in size (depends on the block size
-     * and number of blocks per group). */
-    uint8_t     abBlockBitmap[1];
-} RTFILESYSTEMEXTBLKGRP;
-/** Pointer to block group descriptor data. */
-typedef RTFILESYSTEMEXTBLKGRP *PRTFILESYSTEMEXTBLKGRP;
+    if (pThis->iBlockLoaded == iLogBlock)
+        return VINF_SUCCESS;
+    pThis->iBlockLoaded = UINT64_MAX;
+
+    PRTFILESYSTEMEXT const pVol = pThis->Core.pVol;
+    uint64_t iPhysBlock;
+    uint64_t cBlocks;
+    int rc = rtFsExtCore_MapBlock(&pThis->Core, iLogBlock, &iPhysBlock, &cBlocks);
+    if (RT_SUCCESS(rc))
+    {
+        if (iPhysBlock)
+            rc = RTVfsFileReadAt(pVol->hVfsFile, iPhysBlock << pVol->cBlockShift, pThis->pbBlock, pVol->cbBlock, NULL);
+        else
+        {
+            /* Sparse block, present it as a single unused entry. */
+            RT_BZERO(pThis->pbBlock, pVol->cbBlock);
+            ((PEXT2DIRENTRY)pThis->pbBlock)->cbRecord = RT_H2LE_U16((uint16_t)(pVol->cbBlock < _64K ? pVol->cbBlock : 0));
+        }
+        if (RT_SUCCESS(rc))
+            pThis->iBlockLoaded = iLogBlock;
+    }
+    return rc;
+}
+
 
 /**
- * Ext2/3 filesystem data.
+ * @interface_method_impl{RTVFSOBJOPS,pfnClose}
  */
-typedef struct RTFILESYSTEMEXT
+static DECLCALLBACK(int) rtFsExtDir_Close(void *pvThis)
 {
-    /** VFS file handle. */
-    RTVFSFILE                 hVfsFile;
-    /** Block number of the superblock. */
-    uint32_t                  iSbBlock;
-    /** Size of one block. */
-    size_t                    cbBlock;
-    /** Number of blocks in one group. */
-    unsigned                  cBlocksPerGroup;
-    /** Number of blocks groups in the volume. */
-    unsigned                  cBlockGroups;
-    /** Cached block group descriptor data. */
-    PRTFILESYSTEMEXTBLKGRP    pBlkGrpDesc;
-} RTFILESYSTEMEXT;
-/** Pointer to the ext filesystem data. */
-typedef RTFILESYSTEMEXT *PRTFILESYSTEMEXT;
+    PRTFSEXTDIR pThis = (PRTFSEXTDIR)pvThis;
+    LogFlow(("rtFsExtDir_Close(%p/%#RX32)\n", pThis, pThis->Core.Inode.iInode));
+    rtFsExtCore_Destroy(&pThis->Core);
+    if (pThis->pbBlock)
+    {
+        RTMemFree(pThis->pbBlock);
+        pThis->pbBlock = NULL;
+    }
+    return VINF_SUCCESS;
+}
 
 
+/**
+ * @interface_method_impl{RTVFSOBJOPS,pfnQueryInfo}
+ */
+static DECLCALLBACK(int) rtFsExtDir_QueryInfo(void *pvThis, PRTFSOBJINFO pObjInfo, RTFSOBJATTRADD enmAddAttr)
+{
+    PRTFSEXTDIR pThis = (PRTFSEXTDIR)pvThis;
+    return rtFsExtCore_QueryInfo(&pThis->Core.Inode, pObjInfo, enmAddAttr);
+}
+
 
 /**
- * Loads the block descriptor of the given block group from the medium.
- *
- * @returns IPRT status code.
- * @param   pThis    EXT filesystem instance data.
- * @param   iBlkGrp  Block group number to load.
+ * @interface_method_impl{RTVFSDIROPS,pfnOpen}
  */
-static int rtFsExtLoadBlkGrpDesc(PRTFILESYSTEMEXT pThis, uint32_t iBlkGrp)
+static DECLCALLBACK(int) rtFsExtDir_Open(void *pvThis, const char *pszEntry, uint64_t fOpen,
+                                         uint32_t fFlags, PRTVFSOBJ phVfsObj)
 {
-    size_t cbBlockBitmap = pThis->cBlocksPerGroup / 8;
-    if (pThis->cBlocksPerGroup % 8)
-        cbBlockBitmap++;
+    PRTFSEXTDIR            pThis = (PRTFSEXTDIR)pvThis;
+    PRTFILESYSTEMEXT const pVol  = pThis->Core.pVol;
 
-    PRTFILESYSTEMEXTBLKGRP pBlkGrpDesc = pThis->pBlkGrpDesc;
-    if (!pBlkGrpDesc)
-    {
-        size_t cbBlkDesc = RT_OFFSETOF(RTFILESYSTEMEXTBLKGRP, abBlockBitmap[cbBlockBitmap]);
-        pBlkGrpDesc = (PRTFILESYSTEMEXTBLKGRP)RTMemAllocZ(cbBlkDesc);
-        if (!pBlkGrpDesc)
-            return VERR_NO_MEMORY;
-    }
+    /*
+     * We cannot create or replace anything, just open stuff.
+     */
+    if (   (fOpen & RTFILE_O_ACTION_MASK) == RTFILE_O_OPEN
+        || (fOpen & RTFILE_O_ACTION_MASK) == RTFILE_O_OPEN_CREATE)
+    { /* likely */ }
+    else
+        return VERR_WRITE_PROTECT;
 
-    uint64_t            offRead = (pThis->iSbBlock + 1) * pThis->cbBlock;
-    EXT2BLOCKGROUPDESC  BlkDesc;
-    int rc = RTVfsFileReadAt(pThis->hVfsFile, offRead, &BlkDesc, sizeof(BlkDesc), NULL);
-    if (RT_SUCCESS(rc))
+    /*
+     * Look up the entry and load its inode.
+     */
+    uint32_t iInode;
+    int rc = rtFsExtDir_Lookup(pThis, pszEntry, &iInode);
+    Log2(("rtFsExtDir_Open: Lookup(,%s,) -> %Rrc iInode=%#RX32\n", pszEntry, rc, iInode));
+    if (RT_FAILURE(rc))
+        return rc;
+
+    RTFSEXTINODE Inode;
+    rc = rtFsExtInodeLoad(pVol, iInode, &Inode);
+    if (RT_FAILURE(rc))
+        return rc;
+
+    switch (Inode.ObjInfo.Attr.fMode & RTFS_TYPE_MASK)
     {
-        pBlkGrpDesc->offStart = pThis->iSbBlock + (uint64_t)iBlkGrp * pThis->cBlocksPerGroup * pThis->cbBlock;
-        pBlkGrpDesc->offLast  = pBlkGrpDesc->offStart + pThis->cBlocksPerGroup * pThis->cbBlock;
-        rc = RTVfsFileReadAt(pThis->hVfsFile, BlkDesc.offBlockBitmap * pThis->cbBlock,
-                             &pBlkGrpDesc->abBlockBitmap[0], cbBlockBitmap, NULL);
-    }
+        case RTFS_TYPE_FILE:
+            if (fFlags & RTVFSOBJ_F_OPEN_FILE)
+            {
+                RTVFSFILE hVfsFile;
+                rc = rtFsExtFile_New(pVol, &Inode, fOpen, &hVfsFile);
+                if (RT_SUCCESS(rc))
+                {
+                    *phVfsObj = RTVfsObjFromFile(hVfsFile);
+                    RTVfsFileRelease(hVfsFile);
+                    AssertStmt(*phVfsObj != NIL_RTVFSOBJ, rc = VERR_INTERNAL_ERROR_3);
+                }
+            }
+            else
+                rc = VERR_IS_A_FILE;
+            break;
+
+        case RTFS_TYPE_DIRECTORY:
+            if (fFlags & RTVFSOBJ_F_OPEN_DIRECTORY)
+            {
+                RTVFSDIR hVfsDir;
+                rc = rtFsExtDir_New(pVol, iInode, &hVfsDir);
+                if (RT_SUCCESS(rc))
+                {
+                    *phVfsObj = RTVfsObjFromDir(hVfsDir);
+                    RTVfsDirRelease(hVfsDir);
+                    AssertStmt(*phVfsObj != NIL_RTVFSOBJ, rc = VERR_INTERNAL_ERROR_3);
+                }
+            }
+            else
+                rc = VERR_IS_A_DIRECTORY;
+            break;
+
+        case RTFS_TYPE_SYMLINK:
+            if (fFlags & RTVFSOBJ_F_OPEN_SYMLINK)
+            {
+                RTVFSSYMLINK hVfsSym;
+                rc = rtFsExtSym_New(pVol, &Inode, &hVfsSym);
+                if (RT_SUCCESS(rc))
+                {
+                    *phVfsObj = RTVfsObjFromSymlink(hVfsSym);
+                    RTVfsSymlinkRelease(hVfsSym);
+                    AssertStmt(*phVfsObj != NIL_RTVFSOBJ, rc = VERR_INTERNAL_ERROR_3);
+                }
+            }
+            else
+                rc = VERR_IS_A_SYMLINK;
+            break;
+
+        case RTFS_TYPE_DEV_BLOCK:
+        case RTFS_TYPE_DEV_CHAR:
+        case RTFS_TYPE_FIFO:
+        case RTFS_TYPE_SOCKET:
+            rc = VERR_NOT_IMPLEMENTED;
+            break;
 
-    pThis->pBlkGrpDesc = pBlkGrpDesc;
+        default:
+            rc = VERR_PATH_NOT_FOUND;
+            break;
+    }
     return rc;
 }
 
 
-static bool rtFsExtIsBlockRangeInUse(PRTFILESYSTEMEXTBLKGRP pBlkGrpDesc, uint32_t offBlockStart, size_t cBlocks)
+/**
+ * @interface_method_impl{RTVFSDIROPS,pfnCreateDir}
+ */
+static DECLCALLBACK(int) rtFsExtDir_CreateDir(void *pvThis, const char *pszSubDir, RTFMODE fMode, PRTVFSDIR phVfsDir)
 {
-    while (cBlocks)
+    RT_NOREF(pvThis, pszSubDir, fMode, phVfsDir);
+    return VERR_WRITE_PROTECT;
+}
+
+
+/**
+ * @interface_method_impl{RTVFSDIROPS,pfnOpenSymlink}
+ */
+static DECLCALLBACK(int) rtFsExtDir_OpenSymlink(void *pvThis, const char *pszSymlink, PRTVFSSYMLINK phVfsSymlink)
+{
+    RT_NOREF(pvThis, pszSymlink, phVfsSymlink);
+    return VERR_NOT_SUPPORTED;
+}
+
+
+/**
+ * @interface_method_impl{RTVFSDIROPS,pfnCreateSymlink}
+ */
+static DECLCALLBACK(int) rtFsExtDir_CreateSymlink(void *pvThis, const char *pszSymlink, const char *pszTarget,
+                                                  RTSYMLINKTYPE enmType, PRTVFSSYMLINK phVfsSymlink)
+{
+    RT_NOREF(pvThis, pszSymlink, pszTarget, enmType, phVfsSymlink);
+    return VERR_WRITE_PROTECT;
+}
+
+
+/**
+ * @interface_method_impl{RTVFSDIROPS,pfnUnlinkEntry}
+ */
+static DECLCALLBACK(int) rtFsExtDir_UnlinkEntry(void *pvThis, const char *pszEntry, RTFMODE fType)
+{
+    RT_NOREF(pvThis, pszEntry, fType);
+    return VERR_WRITE_PROTECT;
+}
+
+
+/**
+ * @interface_method_impl{RTVFSDIROPS,pfnRenameEntry}
+ */
+static DECLCALLBACK(int) rtFsExtDir_RenameEntry(void *pvThis, const char *pszEntry, RTFMODE fType, const char *pszNewName)
+{
+    RT_NOREF(pvThis, pszEntry, fType, pszNewName);
+    return VERR_WRITE_PROTECT;
+}
+
+
+/**
+ * @interface_method_impl{RTVFSDIROPS,pfnRewindDir}
+ */
+static DECLCALLBACK(int) rtFsExtDir_RewindDir(void *pvThis)
+{
+    PRTFSEXTDIR pThis = (PRTFSEXTDIR)pvThis;
+    pThis->offDir = 0;
+    return VINF_SUCCESS;
+}
+
+
+/**
+ * @interface_method_impl{RTVFSDIROPS,pfnReadDir}
+ */
+static DECLCALLBACK(int) rtFsExtDir_ReadDir(void *pvThis, PRTDIRENTRYEX pDirEntry, size_t *pcbDirEntry,
+                                            RTFSOBJATTRADD enmAddAttr)
+{
+    PRTFSEXTDIR    pThis      = (PRTFSEXTDIR)pvThis;
+    uint32_t const cbDirBlock = pThis->cbDirBlock;
+    uint64_t const cbDir      = pThis->Core.Inode.fFlags & EXT4_INODE_FLAGS_INLINE_DATA
+                              ? cbDirBlock : pThis->Core.Inode.ObjInfo.cbObject;
+
+    /* Linear reading works fine for hash tree indexed directories as well,
+       the index nodes look like unused entries covering the whole block. */
+    while (pThis->offDir < cbDir)
     {
-        uint32_t idxByte = offBlockStart / 8;
-        uint32_t iBit = offBlockStart % 8;
+        uint64_t const iLogBlock  = pThis->offDir / cbDirBlock;
+        uint32_t const offInBlock = (uint32_t)(pThis->offDir % cbDirBlock);
+        int rc = rtFsExtDir_LoadBlock(pThis, iLogBlock);
+        if (RT_FAILURE(rc))
+            return rc;
 
-        if (pBlkGrpDesc->abBlockBitmap[idxByte] & RT_BIT(iBit))
-            return true;
+        uint32_t const cbRecord = rtFsExtDirEntryValidate(pThis->pbBlock, cbDirBlock, offInBlock);
+        if (!cbRecord)
+        {
+            Log(("rtFsExtDir_ReadDir: Bad directory entry at %#RX64 in inode %#RX32, skipping the rest of the block\n",
+                 pThis->offDir, pThis->Core.Inode.iInode));
+            pThis->offDir = (iLogBlock + 1) * cbDirBlock;
+            continue;
+        }
 
-        cBlocks--;
-        offBlockStart++;
+        PCEXT2DIRENTRY pEntry = (PCEXT2DIRENTRY)&pThis->pbBlock[offInBlock];
+        if (pEntry->iInodeRef == 0)
+        {
+            pThis->offDir += cbRecord;
+            continue;
+        }
+
+        size_t const cchName  = pEntry->cbName;
+        size_t const cbNeeded = RT_UOFFSETOF(RTDIRENTRYEX, szName) + cchName + 1;
+        if (*pcbDirEntry < cbNeeded)
+        {
+            Log3(("rtFsExtDir_ReadDir: VERR_BUFFER_OVERFLOW - cbDst=%zu cbNeeded=%zu\n", *pcbDirEntry, cbNeeded));
+            *pcbDirEntry = cbNeeded;
+            return VERR_BUFFER_OVERFLOW;
+        }
+
+        RTFSEXTINODE Inode;
+        rc = rtFsExtInodeLoad(pThis->Core.pVol, RT_LE2H_U32(pEntry->iInodeRef), &Inode);
+        pThis->offDir += cbRecord;
+        if (RT_FAILURE(rc))
+            return rc;
+
+        pDirEntry->cbName = (uint16_t)cchName;
+        memcpy(pDirEntry->szName, pEntry->achName, cchName);
+        pDirEntry->szName[cchName] = '\0';
+        RTStrPurgeEncoding(pDirEntry->szName);
+        pDirEntry->cwcShortName    = 0;
+        pDirEntry->wszShortName[0] = '\0';
+        return rtFsExtCore_QueryInfo(&Inode, &pDirEntry->Info, enmAddAttr);
     }
+    return VERR_NO_MORE_FILES;
+}
 
-    return false;
+
+/**
+ * EXT directory operations.
+ */
+static const RTVFSDIROPS g_rtFsExtDirOps =
+{
+    { /* Obj */
+        RTVFSOBJOPS_VERSION,
+        RTVFSOBJTYPE_DIR,
+        "ExtDir",
+        rtFsExtDir_Close,
+        rtFsExtDir_QueryInfo,
+        RTVFSOBJOPS_VERSION
+    },
+    RTVFSDIROPS_VERSION,
+    0,
+    { /* ObjSet */
+        RTVFSOBJSETOPS_VERSION,
+        RT_OFFSETOF(RTVFSDIROPS, Obj) - RT_OFFSETOF(RTVFSDIROPS, ObjSet),
+        NULL /*SetMode*/,
+        NULL /*SetTimes*/,
+        NULL /*SetOwner*/,
+        RTVFSOBJSETOPS_VERSION
+    },
+    rtFsExtDir_Open,
+    NULL /* pfnFollowAbsoluteSymlink */,
+    NULL /* pfnOpenFile */,
+    NULL /* pfnOpenDir */,
+    rtFsExtDir_CreateDir,
+    rtFsExtDir_OpenSymlink,
+    rtFsExtDir_CreateSymlink,
+    NULL /* pfnQueryEntryInfo */,
+    rtFsExtDir_UnlinkEntry,
+    rtFsExtDir_RenameEntry,
+    rtFsExtDir_RewindDir,
+    rtFsExtDir_ReadDir,
+    RTVFSDIROPS_VERSION,
+};
+
+
+/**
+ * Instantiates a new directory.
+ *
+ * @returns IPRT status code.
+ * @param   pThis       The EXT volume instance.
+ * @param   iInode      The inode number of the directory.
+ * @param   phVfsDir    Where to return the directory handle.
+ */
+static int rtFsExtDir_New(PRTFILESYSTEMEXT pThis, uint32_t iInode, PRTVFSDIR phVfsDir)
+{
+    RTFSEXTINODE Inode;
+    int rc = rtFsExtInodeLoad(pThis, iInode, &Inode);
+    if (RT_FAILURE(rc))
+        return rc;
+    if (!RTFS_IS_DIRECTORY(Inode.ObjInfo.Attr.fMode))
+        return VERR_NOT_A_DIRECTORY;
+
+    PRTFSEXTDIR pNewDir;
+    rc = RTVfsNewDir(&g_rtFsExtDirOps, sizeof(*pNewDir), 0 /*fFlags*/, pThis->hVfsSelf, NIL_RTVFSLOCK /*use volume lock*/,
+                     phVfsDir, (void **)&pNewDir);
+    if (RT_SUCCESS(rc))
+    {
+        pNewDir->offDir       = 0;
+        pNewDir->iBlockLoaded = UINT64_MAX;
+        pNewDir->pbBlock      = NULL;
+        rc = rtFsExtCore_Init(&pNewDir->Core, pThis, &Inode);
+        if (RT_SUCCESS(rc))
+        {
+            if (!pNewDir->Core.pbInline)
+            {
+                pNewDir->cbDirBlock = (uint32_t)pThis->cbBlock;
+                pNewDir->pbBlock    = (uint8_t *)RTMemAlloc(pThis->cbBlock);
+                if (pNewDir->pbBlock)
+                    return VINF_SUCCESS;
+                rc = VERR_NO_MEMORY;
+            }
+            else if (pNewDir->Core.cbInline >= sizeof(uint32_t))
+            {
+                /*
+                 * Inline directories start with the parent inode number followed by
+                 * the entries.  Turn it into a regular directory block by prepending
+                 * '.' and '..' entries so lookup and ReadDir don't need to care.
+                 */
+                uint32_t const cbDotEntries = 2 * 12;
+                uint32_t const cbDirBlock   = cbDotEntries + (uint32_t)pNewDir->Core.cbInline - sizeof(uint32_t);
+                uint8_t       *pbBlock      = (uint8_t *)RTMemAllocZ(cbDirBlock);
+                if (pbBlock)
+                {
+                    PEXT2DIRENTRY pDot = (PEXT2DIRENTRY)pbBlock;
+                    pDot->iInodeRef  = RT_H2LE_U32(iInode);
+                    pDot->cbRecord   = RT_H2LE_U16(12);
+                    pDot->cbName     = 1;
+                    pDot->uType      = EXT2_TYPE_DIRECTORY;
+                    pDot->achName[0] = '.';
+                    PEXT2DIRENTRY pDotDot = (PEXT2DIRENTRY)&pbBlock[12];
+                    memcpy(&pDotDot->iInodeRef, pNewDir->Core.pbInline, sizeof(uint32_t));
+                    pDotDot->cbRecord   = RT_H2LE_U16(12);
+                    pDotDot->cbName     = 2;
+                    pDotDot->uType      = EXT2_TYPE_DIRECTORY;
+                    pDotDot->achName[0] = '.';
+                    pDotDot->achName[1] = '.';
+                    memcpy(&pbBlock[cbDotEntries], &pNewDir->Core.pbInline[sizeof(uint32_t)],
+                           pNewDir->Core.cbInline - sizeof(uint32_t));
+
+                    pNewDir->pbBlock      = pbBlock;
+                    pNewDir->cbDirBlock   = cbDirBlock;
+                    pNewDir->iBlockLoaded = 0;
+                    return VINF_SUCCESS;
+                }
+                rc = VERR_NO_MEMORY;
+            }
+            else
+                rc = VERR_FILESYSTEM_CORRUPT;
+        }
+
+        RTVfsDirRelease(*phVfsDir);
+        *phVfsDir = NIL_RTVFSDIR;
+    }
+    return rc;
 }
 
 
@@ -144,9 +2392,25 @@ static bool rtFsExtIsBlockRangeInUse(PRTFILESYSTEMEXTBLKGRP pBlkGrpDesc, uint32_
 static DECLCALLBACK(int) rtFsExt2Vol_Close(void *pvThis)
 {
     PRTFILESYSTEMEXT pThis = (PRTFILESYSTEMEXT)pvThis;
+    Log(("rtFsExt2Vol_Close(%p): block cache %RU64 hits / %RU64 misses, inode cache %RU64 hits / %RU64 misses\n", pThis,
+         pThis->cBlockCacheHits, pThis->cBlockCacheMisses, pThis->cInodeCacheHits, pThis->cInodeCacheMisses));
 
     if (pThis->pBlkGrpDesc)
         RTMemFree(pThis->pBlkGrpDesc);
+    pThis->pBlkGrpDesc = NULL;
+    RTMemFree(pThis->paGroups);
+    pThis->paGroups = NULL;
+    RTMemFree(pThis->pbBlockCache);
+    pThis->pbBlockCache = NULL;
+    RTMemFree(pThis->paiBlockCacheTags);
+    pThis->paiBlockCacheTags = NULL;
+    RTMemFree(pThis->paInodeCache);
+    pThis->paInodeCache = NULL;
+    if (RTCritSectIsInitialized(&pThis->CritSect))
+        RTCritSectDelete(&pThis->CritSect);
+
+    RTVfsFileRelease(pThis->hVfsFile);
+    pThis->hVfsFile = NIL_RTVFSFILE;
 
     return VINF_SUCCESS;
 }
@@ -163,18 +2427,17 @@ static DECLCALLBACK(int) rtFsExt2Vol_QueryInfo(void *pvThis, PRTFSOBJINFO pObjIn
 
 
 /**
- * @interface_method_impl{RTVFSOBJOPS::Obj,pfnOpenRoot}
+ * @interface_method_impl{RTVFSOPS,pfnOpenRoot}
  */
 static DECLCALLBACK(int) rtFsExt2_OpenRoot(void *pvThis, PRTVFSDIR phVfsDir)
 {
-    NOREF(pvThis);
-    NOREF(phVfsDir);
-    return VERR_NOT_IMPLEMENTED;
+    PRTFILESYSTEMEXT pThis = (PRTFILESYSTEMEXT)pvThis;
+    return rtFsExtDir_New(pThis, EXT2_INODE_NR_ROOT, phVfsDir);
 }
 
 
 /**
- * @interface_method_impl{RTVFSOBJOPS::Obj,pfnQueryRangeState}
+ * @interface_method_impl{RTVFSOPS,pfnQueryRangeState}
  */
 static DECLCALLBACK(int) rtFsExt2_QueryRangeState(void *pvThis, uint64_t off, size_t cb, bool *pfUsed)
 {
@@ -183,25 +2446,35 @@ static DECLCALLBACK(int) rtFsExt2_QueryRangeState(void *pvThis, uint64_t off, si
 
     *pfUsed = false;
 
+    RTCritSectEnter(&pThis->CritSect);
     while (cb > 0)
     {
-        uint32_t const offBlockStart    = (uint32_t)(off / pThis->cbBlock);
-        uint32_t const iBlockGroup      = (offBlockStart - pThis->iSbBlock) / pThis->cBlocksPerGroup;
-        uint32_t const offBlockRelStart = offBlockStart - iBlockGroup * pThis->cBlocksPerGroup;
+        uint64_t const iBlock = off >> pThis->cBlockShift;
+        if (iBlock < pThis->iSbBlock)
+        {
+            /* The boot block in front of the first group. */
+            *pfUsed = true;
+            break;
+        }
+        uint64_t const iBlockGroup = (iBlock - pThis->iSbBlock) / pThis->cBlocksPerGroup;
+        if (iBlockGroup >= pThis->cBlockGroups)
+            break; /* Beyond the end of the filesystem. */
 
-        if (   off < pThis->pBlkGrpDesc->offStart
-            || off > pThis->pBlkGrpDesc->offLast)
+        if (   !pThis->pBlkGrpDesc
+            || pThis->pBlkGrpDesc->iBlkGrp != iBlockGroup)
         {
             /* Load new block descriptor. */
-            rc = rtFsExtLoadBlkGrpDesc(pThis, iBlockGroup);
+            rc = rtFsExtLoadBlkGrpDesc(pThis, (uint32_t)iBlockGroup);
             if (RT_FAILURE(rc))
                 break;
         }
 
-        size_t cbThis = RT_MIN(cb, pThis->pBlkGrpDesc->offLast - off + 1);
-        if (rtFsExtIsBlockRangeInUse(pThis->pBlkGrpDesc,
-                                     offBlockRelStart,
-                                     cbThis / pThis->cbBlock + (cbThis % pThis->cbBlock ? 1 : 0)) )
+        size_t const   cbThis           = (size_t)RT_MIN(cb, pThis->pBlkGrpDesc->offLast - off + 1);
+        uint64_t const iBlockLast       = (off + cbThis - 1) >> pThis->cBlockShift;
+        uint32_t const offBlockRelStart = (uint32_t)(iBlock - pThis->iSbBlock - iBlockGroup * pThis->cBlocksPerGroup);
+        uint32_t const iBitFirst        = offBlockRelStart >> pThis->cClusterShift;
+        uint32_t const iBitLast         = (uint32_t)(offBlockRelStart + (iBlockLast - iBlock)) >> pThis->cClusterShift;
+        if (rtFsExtIsBlockRangeInUse(pThis->pBlkGrpDesc, iBitFirst, iBitLast - iBitFirst + 1))
         {
             *pfUsed = true;
             break;
@@ -210,6 +2483,7 @@ static DECLCALLBACK(int) rtFsExt2_QueryRangeState(void *pvThis, uint64_t off, si
         cb  -= cbThis;
         off += cbThis;
     }
+    RTCritSectLeave(&pThis->CritSect);
 
     return rc;
 }
@@ -234,6 +2508,225 @@ DECL_HIDDEN_CONST(const RTVFSOPS) g_rtFsExt2VolOps =
 };
 
 
+/**
+ * Parses and validates the superblock.
+ *
+ * @returns IPRT status code.
+ * @param   pThis       EXT filesystem instance data.
+ * @param   pSb         The superblock.
+ * @param   pErrInfo    Where to return additional error information.
+ */
+static int rtFsExtVolParseSuperBlock(PRTFILESYSTEMEXT pThis, PCEXT2SUPERBLOCK pSb, PRTERRINFO pErrInfo)
+{
+    if (RT_LE2H_U16(pSb->u16Signature) != EXT2_SIGNATURE)
+        return RTERRINFO_LOG_SET_F(pErrInfo, VERR_VFS_UNKNOWN_FORMAT, "Bad superblock signature: %#RX16",
+                                   RT_LE2H_U16(pSb->u16Signature));
+    if (RT_LE2H_U16(pSb->u16FilesystemState) == EXT2_STATE_ERRORS)
+        return RTERRINFO_LOG_SET(pErrInfo, VERR_FILESYSTEM_CORRUPT, "EXT2_STATE_ERRORS");
+
+    uint32_t const cBlockShiftRel = RT_LE2H_U32(pSb->cBitsShiftLeftBlockSize);
+    if (cBlockShiftRel > 6)
+        return RTERRINFO_LOG_SET_F(pErrInfo, VERR_VFS_BOGUS_FORMAT, "Unsupported block size: 1024 << %#RX32", cBlockShiftRel);
+    pThis->cBlockShift     = 10 + cBlockShiftRel;
+    pThis->cbBlock         = (size_t)1 << pThis->cBlockShift;
+    pThis->iSbBlock        = RT_LE2H_U32(pSb->iBlockOfSuperblock);
+    pThis->cBlocksPerGroup = RT_LE2H_U32(pSb->cBlocksPerGroup);
+    pThis->cInodesPerGroup = RT_LE2H_U32(pSb->cInodesPerBlockGroup);
+    pThis->cInodesTotal    = RT_LE2H_U32(pSb->cInodesTotal);
+
+    /*
+     * Features.
+     */
+    if (RT_LE2H_U32(pSb->u32VersionMajor) >= EXT2_REV_DYNAMIC)
+    {
+        pThis->fFeaturesCompat   = RT_LE2H_U32(pSb->fFeaturesCompat);
+        pThis->fFeaturesIncompat = RT_LE2H_U32(pSb->fFeaturesIncompat);
+        pThis->fFeaturesCompatRo = RT_LE2H_U32(pSb->fFeaturesCompatRo);
+        pThis->cbInode           = RT_LE2H_U16(pSb->cbInode);
+    }
+    else
+        pThis->cbInode           = sizeof(EXT2INODE);
+
+    uint32_t const fIncompatSupported = EXT2_FEATURE_INCOMPAT_DIR_FILETYPE | EXT2_FEATURE_INCOMPAT_RECOVER
+                                      | EXT2_FEATURE_INCOMPAT_META_BG      | EXT2_FEATURE_INCOMPAT_EXTENTS
+                                      | EXT2_FEATURE_INCOMPAT_64BIT        | EXT2_FEATURE_INCOMPAT_MMP
+                                      | EXT2_FEATURE_INCOMPAT_FLEX_BG      | EXT2_FEATURE_INCOMPAT_EA_INODE
+                                      | EXT2_FEATURE_INCOMPAT_CSUM_SEED    | EXT2_FEATURE_INCOMPAT_LARGEDIR
+                                      | EXT2_FEATURE_INCOMPAT_INLINE_DATA  | EXT2_FEATURE_INCOMPAT_ENCRYPT
+                                      | EXT2_FEATURE_INCOMPAT_CASEFOLD;
+    if (pThis->fFeaturesIncompat & ~fIncompatSupported)
+        return RTERRINFO_LOG_SET_F(pErrInfo, VERR_VFS_UNSUPPORTED_FORMAT, "Unsupported incompatible features: %#RX32",
+                                   pThis->fFeaturesIncompat & ~fIncompatSupported);
+    if (pThis->fFeaturesIncompat & EXT2_FEATURE_INCOMPAT_RECOVER)
+        LogRel(("RTFsExt2VolOpen: The journal needs recovery, ignoring it and accessing the volume as is\n"));
+
+    if (   pThis->cbInode < sizeof(EXT2INODE)
+        || pThis->cbInode > pThis->cbBlock
+        || !RT_IS_POWER_OF_TWO(pThis->cbInode))
+        return RTERRINFO_LOG_SET_F(pErrInfo, VERR_VFS_BOGUS_FORMAT, "Bad inode size: %#RX32", pThis->cbInode);
+
+    if (pThis->fFeaturesIncompat & EXT2_FEATURE_INCOMPAT_64BIT)
+    {
+        pThis->cbGroupDesc  = RT_LE2H_U16(pSb->cbGroupDesc);
+        pThis->cBlocksTotal = RT_LE2H_U32(pSb->cBlocksTotal) | ((uint64_t)RT_LE2H_U32(pSb->cBlocksTotalHigh) << 32);
+    }
+    else
+    {
+        pThis->cbGroupDesc  = sizeof(EXT2BLOCKGROUPDESC);
+        pThis->cBlocksTotal = RT_LE2H_U32(pSb->cBlocksTotal);
+    }
+    if (   pThis->cbGroupDesc < sizeof(EXT2BLOCKGROUPDESC)
+        || pThis->cbGroupDesc > pThis->cbBlock
+        || !RT_IS_POWER_OF_TWO(pThis->cbGroupDesc))
+        return RTERRINFO_LOG_SET_F(pErrInfo, VERR_VFS_BOGUS_FORMAT, "Bad group descriptor size: %#RX32", pThis->cbGroupDesc);
+
+    if (pThis->fFeaturesCompatRo & EXT2_FEATURE_RO_COMPAT_BIGALLOC)
+    {
+        uint32_t const cClusterShiftRel = RT_LE2H_U32(pSb->cBitsShiftLeftFragmentSize);
+        if (cClusterShiftRel < cBlockShiftRel || cClusterShiftRel - cBlockShiftRel > 16)
+            return RTERRINFO_LOG_SET_F(pErrInfo, VERR_VFS_BOGUS_FORMAT, "Bad cluster size: 1024 << %#RX32", cClusterShiftRel);
+        pThis->cClusterShift = cClusterShiftRel - cBlockShiftRel;
+    }
+
+    /*
+     * Geometry.
+     */
+    if (   pThis->cBlocksPerGroup == 0
+        || pThis->cBlocksPerGroup >> pThis->cClusterShift > pThis->cbBlock * 8
+        || pThis->cInodesPerGroup == 0
+        || pThis->cInodesPerGroup > pThis->cbBlock * 8
+        || pThis->iSbBlock >= pThis->cBlocksTotal)
+        return RTERRINFO_LOG_SET_F(pErrInfo, VERR_VFS_BOGUS_FORMAT,
+                                   "Bad geometry: cBlocksPerGroup=%#RX32 cInodesPerGroup=%#RX32 cBlocksTotal=%#RX64 iSbBlock=%#RX32",
+                                   pThis->cBlocksPerGroup, pThis->cInodesPerGroup, pThis->cBlocksTotal, pThis->iSbBlock);
+    uint64_t const cBlockGroups = (pThis->cBlocksTotal - pThis->iSbBlock + pThis->cBlocksPerGroup - 1) / pThis->cBlocksPerGroup;
+    if (   cBlockGroups > UINT32_MAX / pThis->cInodesPerGroup
+        || cBlockGroups * pThis->cInodesPerGroup < pThis->cInodesTotal)
+        return RTERRINFO_LOG_SET_F(pErrInfo, VERR_VFS_BOGUS_FORMAT, "Bad inode count: %#RX32 (%#RX64 groups of %#RX32)",
+                                   pThis->cInodesTotal, cBlockGroups, pThis->cInodesPerGroup);
+    pThis->cBlockGroups   = (unsigned)cBlockGroups;
+    pThis->cGdtBlocksRsvd = RT_LE2H_U16(pSb->cGdtEntriesRsvd);
+    pThis->iFirstMetaBg   = RT_LE2H_U32(pSb->iFirstMetaBg);
+
+    /*
+     * Directory hashing.
+     */
+    for (unsigned i = 0; i < RT_ELEMENTS(pThis->au32HashSeed); i++)
+        pThis->au32HashSeed[i] = RT_LE2H_U32(pSb->au32HashSeedHtree[i]);
+    pThis->fHashUnsigned = RT_BOOL(RT_LE2H_U32(pSb->fFlags) & EXT2_SUPER_FLAGS_DIRHASH_UNSIGNED);
+
+    Log(("RTFsExt2VolOpen: cbBlock=%#zx cBlocksTotal=%#RX64 cBlockGroups=%#x cbInode=%#x cbGroupDesc=%#x features=%#RX32/%#RX32/%#RX32\n",
+         pThis->cbBlock, pThis->cBlocksTotal, pThis->cBlockGroups, pThis->cbInode, pThis->cbGroupDesc,
+         pThis->fFeaturesCompat, pThis->fFeaturesIncompat, pThis->fFeaturesCompatRo));
+    return VINF_SUCCESS;
+}
+
+
+/**
+ * Loads all the block group descriptors.
+ *
+ * @returns IPRT status code.
+ * @param   pThis       EXT filesystem instance data.
+ * @param   pErrInfo    Where to return additional error information.
+ */
+static int rtFsExtVolLoadGroupDescs(PRTFILESYSTEMEXT pThis, PRTERRINFO pErrInfo)
+{
+    pThis->paGroups = (PRTFILESYSTEMEXTGRP)RTMemAllocZ(sizeof(pThis->paGroups[0]) * pThis->cBlockGroups);
+    uint8_t *pbBuf = (uint8_t *)RTMemTmpAlloc(pThis->cbBlock);
+    if (!pThis->paGroups || !pbBuf)
+    {
+        RTMemTmpFree(pbBuf);
+        return VERR_NO_MEMORY;
+    }
+
+    bool const     f64Bit        = pThis->cbGroupDesc >= sizeof(EXT4BLOCKGROUPDESC);
+    uint32_t const cDescPerBlock = (uint32_t)(pThis->cbBlock / pThis->cbGroupDesc);
+    uint32_t const cDescBlocks   = (pThis->cBlockGroups + cDescPerBlock - 1) / cDescPerBlock;
+    uint64_t const cInodeTblBlks = ((uint64_t)pThis->cInodesPerGroup * pThis->cbInode + pThis->cbBlock - 1) >> pThis->cBlockShift;
+    int rc = VINF_SUCCESS;
+    for (uint32_t iDescBlock = 0; iDescBlock < cDescBlocks && RT_SUCCESS(rc); iDescBlock++)
+    {
+        /* Locate the descriptor block, meta block groups keep it in the first group they describe. */
+        uint64_t iBlock;
+        if (   !(pThis->fFeaturesIncompat & EXT2_FEATURE_INCOMPAT_META_BG)
+            || iDescBlock < pThis->iFirstMetaBg)
+            iBlock = pThis->iSbBlock + 1 + iDescBlock;
+        else
+        {
+            uint32_t const iBlkGrp = iDescBlock * cDescPerBlock;
+            iBlock = pThis->iSbBlock + (uint64_t)iBlkGrp * pThis->cBlocksPerGroup;
+            if (rtFsExtBlkGrpHasSuperBlock(pThis, iBlkGrp))
+                iBlock++;
+            if (pThis->iSbBlock == 0 && pThis->cBlockShift == 10)
+                iBlock++;
+        }
+        rc = RTVfsFileReadAt(pThis->hVfsFile, iBlock << pThis->cBlockShift, pbBuf, pThis->cbBlock, NULL);
+        if (RT_FAILURE(rc))
+        {
+            rc = RTERRINFO_LOG_SET_F(pErrInfo, rc, "Error reading group descriptor block %#RX64", iBlock);
+            break;
+        }
+
+        for (uint32_t i = 0; i < cDescPerBlock; i++)
+        {
+            uint32_t const iBlkGrp = iDescBlock * cDescPerBlock + i;
+            if (iBlkGrp >= pThis->cBlockGroups)
+                break;
+            PCEXT2BLOCKGROUPDESC pDesc   = (PCEXT2BLOCKGROUPDESC)&pbBuf[i * pThis->cbGroupDesc];
+            PRTFILESYSTEMEXTGRP  pGrp    = &pThis->paGroups[iBlkGrp];
+            pGrp->iBlockBitmap = RT_LE2H_U32(pDesc->offBlockBitmap);
+            pGrp->iInodeBitmap = RT_LE2H_U32(pDesc->offInodeBitmap);
+            pGrp->iInodeTable  = RT_LE2H_U32(pDesc->offInodeTable);
+            if (f64Bit)
+            {
+                PCEXT4BLOCKGROUPDESC pDesc64 = (PCEXT4BLOCKGROUPDESC)pDesc;
+                pGrp->iBlockBitmap |= (uint64_t)RT_LE2H_U32(pDesc64->offBlockBitmapHigh) << 32;
+                pGrp->iInodeBitmap |= (uint64_t)RT_LE2H_U32(pDesc64->offInodeBitmapHigh) << 32;
+                pGrp->iInodeTable  |= (uint64_t)RT_LE2H_U32(pDesc64->offInodeTableHigh) << 32;
+            }
+            if (pThis->fFeaturesCompatRo & (EXT2_FEATURE_RO_COMPAT_GDT_CSUM | EXT2_FEATURE_RO_COMPAT_METADATA_CSUM))
+                pGrp->fFlags = RT_LE2H_U16(((PCEXT4BLOCKGROUPDESC)pDesc)->fFlags);
+
+            if (   pGrp->iBlockBitmap >= pThis->cBlocksTotal
+                || pGrp->iInodeTable >= pThis->cBlocksTotal
+                || pThis->cBlocksTotal - pGrp->iInodeTable < cInodeTblBlks)
+            {
+                rc = RTERRINFO_LOG_SET_F(pErrInfo, VERR_VFS_BOGUS_FORMAT,
+                                         "Block group %#x has bad metadata locations: block bitmap %#RX64, inode table %#RX64",
+                                         iBlkGrp, pGrp->iBlockBitmap, pGrp->iInodeTable);
+                break;
+            }
+        }
+    }
+
+    RTMemTmpFree(pbBuf);
+    return rc;
+}
+
+
+/**
+ * Allocates the block and inode caches.
+ *
+ * @returns IPRT status code.
+ * @param   pThis       EXT filesystem instance data.
+ */
+static int rtFsExtVolInitCaches(PRTFILESYSTEMEXT pThis)
+{
+    uint32_t cEntries = RTFSEXT_MAX_BLOCK_CACHE_ENTRIES;
+    while (cEntries > RTFSEXT_MIN_BLOCK_CACHE_ENTRIES && ((size_t)cEntries << pThis->cBlockShift) > RTFSEXT_MAX_BLOCK_CACHE_SIZE)
+        cEntries /= 2;
+    pThis->cBlockCacheEntries = cEntries;
+    pThis->pbBlockCache       = (uint8_t *)RTMemAlloc((size_t)cEntries << pThis->cBlockShift);
+    pThis->paiBlockCacheTags  = (uint64_t *)RTMemAlloc(sizeof(pThis->paiBlockCacheTags[0]) * cEntries);
+    pThis->paInodeCache       = (PRTFSEXTINODE)RTMemAllocZ(sizeof(pThis->paInodeCache[0]) * RTFSEXT_INODE_CACHE_ENTRIES);
+    if (!pThis->pbBlockCache || !pThis->paiBlockCacheTags || !pThis->paInodeCache)
+        return VERR_NO_MEMORY;
+    for (uint32_t i = 0; i < cEntries; i++)
+        pThis->paiBlockCacheTags[i] = UINT64_MAX;
+    return RTCritSectInit(&pThis->CritSect);
+}
+
+
 RTDECL(int) RTFsExt2VolOpen(RTVFSFILE hVfsFileIn, uint32_t fMntFlags, uint32_t fExtFlags, PRTVFS phVfs, PRTERRINFO pErrInfo)
 {
     AssertPtrReturn(phVfs, VERR_INVALID_POINTER);
@@ -247,6 +2740,7 @@ RTDECL(int) RTFsExt2VolOpen(RTVFSFILE hVfsFileIn, uint32_t fMntFlags, uint32_t f
     int rc = RTVfsNew(&g_rtFsExt2VolOps, sizeof(*pThis), NIL_RTVFS, RTVFSLOCK_CREATE_RW, phVfs, (void **)&pThis);
     if (RT_SUCCESS(rc))
     {
+        pThis->hVfsSelf    = *phVfs;
         pThis->hVfsFile    = hVfsFileIn;
         pThis->pBlkGrpDesc = NULL;
 
@@ -254,25 +2748,13 @@ RTDECL(int) RTFsExt2VolOpen(RTVFSFILE hVfsFileIn, uint32_t fMntFlags, uint32_t f
         rc = RTVfsFileReadAt(hVfsFileIn, 1024, &SuperBlock, sizeof(EXT2SUPERBLOCK), NULL);
         if (RT_SUCCESS(rc))
         {
-#if defined(RT_BIGENDIAN)
-            /** @todo Convert to host endianess. */
-#endif
-            if (SuperBlock.u16FilesystemState == EXT2_STATE_ERRORS)
-                rc = RTERRINFO_LOG_SET(pErrInfo, VERR_FILESYSTEM_CORRUPT, "EXT2_STATE_ERRORS");
-            else
-            {
-                pThis->iSbBlock = SuperBlock.iBlockOfSuperblock;
-                pThis->cbBlock = 1024 << SuperBlock.cBitsShiftLeftBlockSize;
-                pThis->cBlocksPerGroup = SuperBlock.cBlocksPerGroup;
-                pThis->cBlockGroups = SuperBlock.cBlocksTotal / pThis->cBlocksPerGroup;
-
-                /* Load first block group descriptor. */
-                rc = rtFsExtLoadBlkGrpDesc(pThis, 0);
-            }
+            rc = rtFsExtVolParseSuperBlock(pThis, &SuperBlock, pErrInfo);
+            if (RT_SUCCESS(rc))
+                rc = rtFsExtVolLoadGroupDescs(pThis, pErrInfo);
+            if (RT_SUCCESS(rc))
+                rc = rtFsExtVolInitCaches(pThis);
             if (RT_SUCCESS(rc))
-            {
                 return VINF_SUCCESS;
-            }
         }
         else
             rc = RTERRINFO_LOG_SET(pErrInfo, rc, "Error reading super block");
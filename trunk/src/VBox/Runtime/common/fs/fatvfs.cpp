@@ -80,6 +80,15 @@
 /** Maximum number of characters we will create in a long file name. */
 #define RTFSFAT_MAX_LFN_CHARS   255
 
+/** Number of FAT cache entries when the FAT is too large to be cached in one
+ * go (power of two). */
+#define RTFSFAT_FAT_CACHE_ENTRIES           256
+/** The size of a FAT cache entry when the FAT is too large to be cached in one
+ * go (power of two, at least the max sector size). */
+#define RTFSFAT_FAT_CACHE_ENTRY_SIZE        _4K
+/** The max size of a directory we'll buffer fully in memory (if contiguous). */
+#define RTFSFAT_MAX_FULLY_BUFFERED_DIR      _256K
+
 
 /*********************************************************************************************************************************
 *   Structures and Typedefs                                                                                                      *
@@ -90,39 +99,45 @@ typedef struct RTFSFATDIRSHRD *PRTFSFATDIRSHRD;
 typedef struct RTFSFATVOL *PRTFSFATVOL;
 
 
-/** The number of entire in a chain part. */
-#define RTFSFATCHAINPART_ENTRIES (256U - 4U)
-
 /**
- * A part of the cluster chain covering up to 252 clusters.
+ * A run of clusters that are consecutive on the disk as well as in the chain.
  */
-typedef struct RTFSFATCHAINPART
+typedef struct RTFSFATCHAINEXTENT
 {
-    /** List entry. */
-    RTLISTNODE  ListEntry;
-    /** Chain entries. */
-    uint32_t    aEntries[RTFSFATCHAINPART_ENTRIES];
-} RTFSFATCHAINPART;
-AssertCompile(sizeof(RTFSFATCHAINPART) <= _1K);
-typedef RTFSFATCHAINPART *PRTFSFATCHAINPART;
-typedef RTFSFATCHAINPART const *PCRTFSFATCHAINPART;
+    /** The chain index of the first cluster in the extent. */
+    uint32_t    iFirst;
+    /** The first cluster number. */
+    uint32_t    idxCluster;
+    /** Number of clusters in the extent. */
+    uint32_t    cClusters;
+} RTFSFATCHAINEXTENT;
+typedef RTFSFATCHAINEXTENT *PRTFSFATCHAINEXTENT;
+typedef RTFSFATCHAINEXTENT const *PCRTFSFATCHAINEXTENT;
 
 
 /**
  * A FAT cluster chain.
+ *
+ * The chain is kept as a run-length encoded extent array, so that large and
+ * mostly contiguous files can be mapped with a binary search rather than by
+ * walking a list of cluster numbers.
  */
 typedef struct RTFSFATCHAIN
 {
     /** The chain size in bytes. */
-    uint32_t        cbChain;
+    uint32_t            cbChain;
     /** The chain size in entries. */
-    uint32_t        cClusters;
+    uint32_t            cClusters;
     /** The cluster size. */
-    uint32_t        cbCluster;
+    uint32_t            cbCluster;
     /** The shift count for converting between clusters and bytes. */
-    uint8_t         cClusterByteShift;
-    /** List of chain parts (RTFSFATCHAINPART). */
-    RTLISTANCHOR    ListParts;
+    uint8_t             cClusterByteShift;
+    /** Number of valid entries in paExtents. */
+    uint32_t            cExtents;
+    /** Number of entries allocated for paExtents. */
+    uint32_t            cExtentsAlloc;
+    /** The extents, sorted by RTFSFATCHAINEXTENT::iFirst. */
+    PRTFSFATCHAINEXTENT paExtents;
 } RTFSFATCHAIN;
 /** Pointer to a FAT chain. */
 typedef RTFSFATCHAIN *PRTFSFATCHAIN;
@@ -197,7 +212,7 @@ typedef RTFSFATFILE *PRTFSFATFILE;
  *
  * We work directories in one of two buffering modes.  If there are few entries
  * or if it's the FAT12/16 root directory, we map the whole thing into memory.
- * If it's too large, we use an inefficient sector buffer for now.
+ * If it's too large, we buffer one cluster at a time.
  *
  * Directory entry updates happens exclusively via the directory, so any open
  * files or subdirs have a parent reference for doing that.  The parent OTOH,
@@ -243,7 +258,7 @@ typedef struct RTFSFATDIRSHRD
             /** Dirty sector bitmap (one bit per sector). */
             uint8_t            *pbDirtySectors;
         } Full;
-        /** The simple sector buffering.
+        /** The simple cluster buffering.
          * This only works for clusters, so no FAT12/16 root directory fun. */
         struct
         {
@@ -251,6 +266,12 @@ typedef struct RTFSFATDIRSHRD
             uint32_t            offInDir;
             /** Dirty flag. */
             bool                fDirty;
+            /** The offset of the first dirty sector in the buffer.  Only valid
+             *  when fDirty is set. */
+            uint32_t            offFirstDirty;
+            /** The offset of the end of the last dirty sector in the buffer. Only
+             *  valid when fDirty is set. */
+            uint32_t            offEndDirty;
         } Simple;
     } u;
 } RTFSFATDIRSHRD;
@@ -533,16 +554,20 @@ DECLINLINE(uint64_t) rtFsFatClusterToDiskOffset(PRTFSFATVOL pThis, uint32_t idxC
  */
 static bool rtFsFatChain_AssertValid(PCRTFSFATCHAIN pChain)
 {
-    bool                fRc = true;
-    uint32_t            cParts = 0;
-    PRTFSFATCHAINPART   pPart;
-    RTListForEach(&pChain->ListParts, pPart, RTFSFATCHAINPART, ListEntry)
-        cParts++;
-
-    uint32_t cExpected = (pChain->cClusters + RTFSFATCHAINPART_ENTRIES - 1) / RTFSFATCHAINPART_ENTRIES;
-    AssertMsgStmt(cExpected == cParts, ("cExpected=%#x cParts=%#x\n", cExpected, cParts), fRc = false);
+    bool     fRc       = true;
+    uint32_t cClusters = 0;
+    for (uint32_t i = 0; i < pChain->cExtents; i++)
+    {
+        AssertMsgStmt(pChain->paExtents[i].iFirst == cClusters,
+                      ("i=%#x iFirst=%#x cClusters=%#x\n", i, pChain->paExtents[i].iFirst, cClusters), fRc = false);
+        AssertMsgStmt(pChain->paExtents[i].cClusters > 0, ("i=%#x\n", i), fRc = false);
+        cClusters += pChain->paExtents[i].cClusters;
+    }
+    AssertMsgStmt(cClusters == pChain->cClusters, ("cClusters=%#x, expected %#x\n", cClusters, pChain->cClusters), fRc = false);
+    AssertMsgStmt(pChain->cExtents <= pChain->cExtentsAlloc,
+                  ("cExtents=%#x cExtentsAlloc=%#x\n", pChain->cExtents, pChain->cExtentsAlloc), fRc = false);
     AssertMsgStmt(pChain->cbChain == (pChain->cClusters << pChain->cClusterByteShift),
-                  ("cExpected=%#x cParts=%#x\n", cExpected, cParts), fRc = false);
+                  ("cbChain=%#x cClusters=%#x\n", pChain->cbChain, pChain->cClusters), fRc = false);
     return fRc;
 }
 #endif /* RT_STRICT */
@@ -560,7 +585,9 @@ static void rtFsFatChain_InitEmpty(PRTFSFATCHAIN pChain, PRTFSFATVOL pVol)
     pChain->cClusterByteShift   = pVol->cClusterByteShift;
     pChain->cbChain             = 0;
     pChain->cClusters           = 0;
-    RTListInit(&pChain->ListParts);
+    pChain->cExtents            = 0;
+    pChain->cExtentsAlloc       = 0;
+    pChain->paExtents           = NULL;
 }
 
 
@@ -574,15 +601,12 @@ static void rtFsFatChain_Delete(PRTFSFATCHAIN pChain)
     Assert(RT_IS_POWER_OF_TWO(pChain->cbCluster));
     Assert(RT_BIT_32(pChain->cClusterByteShift) == pChain->cbCluster);
 
-    PRTFSFATCHAINPART pPart = RTListRemoveLast(&pChain->ListParts, RTFSFATCHAINPART, ListEntry);
-    while (pPart)
-    {
-        RTMemFree(pPart);
-        pPart = RTListRemoveLast(&pChain->ListParts, RTFSFATCHAINPART, ListEntry);
-    }
-
-    pChain->cbChain   = 0;
-    pChain->cClusters = 0;
+    RTMemFree(pChain->paExtents);
+    pChain->paExtents     = NULL;
+    pChain->cExtents      = 0;
+    pChain->cExtentsAlloc = 0;
+    pChain->cbChain       = 0;
+    pChain->cClusters     = 0;
 }
 
 
@@ -595,24 +619,70 @@ static void rtFsFatChain_Delete(PRTFSFATCHAIN pChain)
  */
 static int rtFsFatChain_Append(PRTFSFATCHAIN pChain, uint32_t idxCluster)
 {
-    PRTFSFATCHAINPART pPart;
-    uint32_t idxLast = pChain->cClusters % RTFSFATCHAINPART_ENTRIES;
-    if (idxLast != 0)
-        pPart = RTListGetLast(&pChain->ListParts, RTFSFATCHAINPART, ListEntry);
+    /* Extend the last extent if the cluster follows it on the disk. */
+    PRTFSFATCHAINEXTENT pExtent = pChain->cExtents > 0 ? &pChain->paExtents[pChain->cExtents - 1] : NULL;
+    if (   pExtent
+        && pExtent->idxCluster + pExtent->cClusters == idxCluster)
+        pExtent->cClusters++;
     else
     {
-        pPart = (PRTFSFATCHAINPART)RTMemAllocZ(sizeof(*pPart));
-        if (!pPart)
-            return VERR_NO_MEMORY;
-        RTListAppend(&pChain->ListParts, &pPart->ListEntry);
+        if (pChain->cExtents >= pChain->cExtentsAlloc)
+        {
+            uint32_t const cNew = pChain->cExtentsAlloc ? pChain->cExtentsAlloc * 2 : 4;
+            void *pvNew = RTMemRealloc(pChain->paExtents, cNew * sizeof(pChain->paExtents[0]));
+            if (!pvNew)
+                return VERR_NO_MEMORY;
+            pChain->paExtents     = (PRTFSFATCHAINEXTENT)pvNew;
+            pChain->cExtentsAlloc = cNew;
+        }
+        pExtent = &pChain->paExtents[pChain->cExtents++];
+        pExtent->iFirst     = pChain->cClusters;
+        pExtent->idxCluster = idxCluster;
+        pExtent->cClusters  = 1;
     }
-    pPart->aEntries[idxLast] = idxCluster;
     pChain->cClusters++;
     pChain->cbChain += pChain->cbCluster;
     return VINF_SUCCESS;
 }
 
 
+/**
+ * Looks up the extent containing chain index @a idx.
+ *
+ * @returns Pointer to the extent.
+ * @param   pChain              The chain.
+ * @param   idx                 The chain index.  Must be less than the number
+ *                              of clusters in the chain.
+ */
+static PCRTFSFATCHAINEXTENT rtFsFatChain_LookupExtent(PCRTFSFATCHAIN pChain, uint32_t idx)
+{
+    Assert(idx < pChain->cClusters);
+
+    /* Appending and sequential access usually hit the first or last extent. */
+    PCRTFSFATCHAINEXTENT paExtents = pChain->paExtents;
+    uint32_t             iLast     = pChain->cExtents - 1;
+    if (idx >= paExtents[iLast].iFirst)
+        return &paExtents[iLast];
+    if (idx < paExtents[0].cClusters)
+        return &paExtents[0];
+
+    /* Binary search the rest. */
+    uint32_t iStart = 1;
+    uint32_t iEnd   = iLast;
+    for (;;)
+    {
+        uint32_t const i = iStart + (iEnd - iStart) / 2;
+        if (idx < paExtents[i].iFirst)
+            iEnd = i;
+        else if (idx - paExtents[i].iFirst >= paExtents[i].cClusters)
+            iStart = i + 1;
+        else
+            return &paExtents[i];
+        Assert(iStart < iEnd);
+    }
+}
+
+
 /**
  * Reduces the number of clusters in the chain to @a cClusters.
  *
@@ -622,11 +692,15 @@ static int rtFsFatChain_Append(PRTFSFATCHAIN pChain, uint32_t idxCluster)
  */
 static void rtFsFatChain_Shrink(PRTFSFATCHAIN pChain, uint32_t cClustersNew)
 {
-    uint32_t cOldParts = (pChain->cClusters + RTFSFATCHAINPART_ENTRIES - 1) / RTFSFATCHAINPART_ENTRIES;
-    uint32_t cNewParts = (cClustersNew      + RTFSFATCHAINPART_ENTRIES - 1) / RTFSFATCHAINPART_ENTRIES;
-    Assert(cOldParts >= cNewParts);
-    while (cOldParts-- > cNewParts)
-        RTMemFree(RTListRemoveLast(&pChain->ListParts, RTFSFATCHAINPART, ListEntry));
+    Assert(cClustersNew <= pChain->cClusters);
+    if (cClustersNew > 0)
+    {
+        PRTFSFATCHAINEXTENT pExtent = (PRTFSFATCHAINEXTENT)rtFsFatChain_LookupExtent(pChain, cClustersNew - 1);
+        pExtent->cClusters = cClustersNew - pExtent->iFirst;
+        pChain->cExtents   = (uint32_t)(pExtent - pChain->paExtents) + 1;
+    }
+    else
+        pChain->cExtents = 0;
     pChain->cClusters = cClustersNew;
     pChain->cbChain   = cClustersNew << pChain->cClusterByteShift;
     Assert(rtFsFatChain_AssertValid(pChain));
@@ -637,28 +711,35 @@ static void rtFsFatChain_Shrink(PRTFSFATCHAIN pChain, uint32_t cClustersNew)
 /**
  * Converts a file offset to a disk offset.
  *
- * The disk offset is only valid until the end of the cluster it is within.
+ * The disk offset is valid until the end of the extent it is within, the
+ * number of bytes until then is optionally returned.
  *
  * @returns Disk offset. UINT64_MAX if invalid file offset.
  * @param   pChain              The chain.
  * @param   offFile             The file offset.
  * @param   pVol                The volume.
+ * @param   pcbContiguous       Where to return the number of bytes that are
+ *                              contiguous on the disk from @a offFile on.
+ *                              Optional.
  */
-static uint64_t rtFsFatChain_FileOffsetToDiskOff(PCRTFSFATCHAIN pChain, uint32_t offFile, PCRTFSFATVOL pVol)
+static uint64_t rtFsFatChain_FileOffsetToDiskOff(PCRTFSFATCHAIN pChain, uint32_t offFile, PCRTFSFATVOL pVol,
+                                                 uint32_t *pcbContiguous)
 {
-    uint32_t idxCluster = offFile >> pChain->cClusterByteShift;
-    if (idxCluster < pChain->cClusters)
+    uint32_t idx = offFile >> pChain->cClusterByteShift;
+    if (idx < pChain->cClusters)
     {
-        PRTFSFATCHAINPART pPart = RTListGetFirst(&pChain->ListParts, RTFSFATCHAINPART, ListEntry);
-        while (idxCluster >= RTFSFATCHAINPART_ENTRIES)
+        PCRTFSFATCHAINEXTENT pExtent = rtFsFatChain_LookupExtent(pChain, idx);
+        if (pcbContiguous)
         {
-            idxCluster -= RTFSFATCHAINPART_ENTRIES;
-            pPart = RTListGetNext(&pChain->ListParts, pPart, RTFSFATCHAINPART, ListEntry);
+            uint64_t const offEnd = (uint64_t)(pExtent->iFirst + pExtent->cClusters) << pChain->cClusterByteShift;
+            *pcbContiguous = (uint32_t)RT_MIN(offEnd - offFile, UINT32_MAX);
         }
         return pVol->offFirstCluster
-             + ((uint64_t)(pPart->aEntries[idxCluster] - FAT_FIRST_DATA_CLUSTER) << pChain->cClusterByteShift)
+             + ((uint64_t)(pExtent->idxCluster + (idx - pExtent->iFirst) - FAT_FIRST_DATA_CLUSTER) << pChain->cClusterByteShift)
              + (offFile & (pChain->cbCluster - 1));
     }
+    if (pcbContiguous)
+        *pcbContiguous = 0;
     return UINT64_MAX;
 }
 
@@ -671,25 +752,7 @@ static uint64_t rtFsFatChain_FileOffsetToDiskOff(PCRTFSFATCHAIN pChain, uint32_t
  */
 static bool rtFsFatChain_IsContiguous(PCRTFSFATCHAIN pChain)
 {
-    if (pChain->cClusters <= 1)
-        return true;
-
-    PRTFSFATCHAINPART   pPart   = RTListGetFirst(&pChain->ListParts, RTFSFATCHAINPART, ListEntry);
-    uint32_t            idxNext = pPart->aEntries[0];
-    uint32_t            cLeft   = pChain->cClusters;
-    for (;;)
-    {
-        uint32_t const cInPart = RT_MIN(cLeft, RTFSFATCHAINPART_ENTRIES);
-        for (uint32_t iPart = 0; iPart < cInPart; iPart++)
-            if (pPart->aEntries[iPart] == idxNext)
-                idxNext++;
-            else
-                return false;
-        cLeft -= cInPart;
-        if (!cLeft)
-            return true;
-        pPart = RTListGetNext(&pChain->ListParts, pPart, RTFSFATCHAINPART, ListEntry);
-    }
+    return pChain->cExtents <= 1;
 }
 
 
@@ -706,35 +769,8 @@ static uint32_t rtFsFatChain_GetClusterByIndex(PCRTFSFATCHAIN pChain, uint32_t i
 {
     if (idx < pChain->cClusters)
     {
-        /*
-         * In the first part?
-         */
-        PRTFSFATCHAINPART pPart;
-        if (idx < RTFSFATCHAINPART_ENTRIES)
-        {
-            pPart = RTListGetFirst(&pChain->ListParts, RTFSFATCHAINPART, ListEntry);
-            return pPart->aEntries[idx];
-        }
-
-        /*
-         * In the last part?
-         */
-        uint32_t cParts    = (pChain->cClusters + RTFSFATCHAINPART_ENTRIES - 1) / RTFSFATCHAINPART_ENTRIES;
-        uint32_t idxPart   = idx / RTFSFATCHAINPART_ENTRIES;
-        uint32_t idxInPart = idx % RTFSFATCHAINPART_ENTRIES;
-        if (idxPart + 1 == cParts)
-            pPart = RTListGetLast(&pChain->ListParts, RTFSFATCHAINPART, ListEntry);
-        else
-        {
-            /*
-             * No, do linear search from the start, skipping the first part.
-             */
-            pPart = RTListGetFirst(&pChain->ListParts, RTFSFATCHAINPART, ListEntry);
-            while (idxPart-- > 1)
-                pPart = RTListGetNext(&pChain->ListParts, pPart, RTFSFATCHAINPART, ListEntry);
-        }
-
-        return pPart->aEntries[idxInPart];
+        PCRTFSFATCHAINEXTENT pExtent = rtFsFatChain_LookupExtent(pChain, idx);
+        return pExtent->idxCluster + (idx - pExtent->iFirst);
     }
     return UINT32_MAX;
 }
@@ -749,10 +785,7 @@ static uint32_t rtFsFatChain_GetClusterByIndex(PCRTFSFATCHAIN pChain, uint32_t i
 static uint32_t rtFsFatChain_GetFirstCluster(PCRTFSFATCHAIN pChain)
 {
     if (pChain->cClusters > 0)
-    {
-        PRTFSFATCHAINPART pPart = RTListGetFirst(&pChain->ListParts, RTFSFATCHAINPART, ListEntry);
-        return pPart->aEntries[0];
-    }
+        return pChain->paExtents[0].idxCluster;
     return UINT32_MAX;
 }
 
@@ -768,8 +801,8 @@ static uint32_t rtFsFatChain_GetLastCluster(PCRTFSFATCHAIN pChain)
 {
     if (pChain->cClusters > 0)
     {
-        PRTFSFATCHAINPART pPart = RTListGetLast(&pChain->ListParts, RTFSFATCHAINPART, ListEntry);
-        return pPart->aEntries[(pChain->cClusters - 1) % RTFSFATCHAINPART_ENTRIES];
+        PCRTFSFATCHAINEXTENT pExtent = &pChain->paExtents[pChain->cExtents - 1];
+        return pExtent->idxCluster + pExtent->cClusters - 1;
     }
     return UINT32_MAX;
 }
@@ -808,14 +841,16 @@ static int rtFsFatClusterMap_Create(PRTFSFATVOL pThis, uint8_t const *pbFirst512
     }
     else
     {
-        Assert(pThis->cbSector < _512K / 8);
-        cEntries         = 8;
-        cEntryIndexShift = 9;
+        /* Direct mapped, 1MB worth of page sized entries.  That covers 1GB
+           worth of clusters with 4KB clusters. */
+        Assert(pThis->cbSector <= RTFSFAT_FAT_CACHE_ENTRY_SIZE);
+        cEntries         = RTFSFAT_FAT_CACHE_ENTRIES;
         fEntryIndexMask  = cEntries - 1;
         AssertReturn(RT_IS_POWER_OF_TWO(cEntries), VERR_INTERNAL_ERROR_4);
 
-        cbEntry          = pThis->cbSector;
-        fEntryOffsetMask = pThis->cbSector - 1;
+        cbEntry          = RT_MAX(RTFSFAT_FAT_CACHE_ENTRY_SIZE, pThis->cbSector);
+        fEntryOffsetMask = cbEntry - 1;
+        cEntryIndexShift = ASMBitFirstSetU32(cbEntry) - 1;
         AssertReturn(RT_IS_POWER_OF_TWO(cbEntry), VERR_INTERNAL_ERROR_5);
     }
 
@@ -893,93 +928,117 @@ static int rtFsFatClusterMap_Create(PRTFSFATVOL pThis, uint8_t const *pbFirst512
 
 
 /**
- * Worker for rtFsFatClusterMap_Flush and rtFsFatClusterMap_FlushEntry.
+ * Flushes out all dirty lines in the entire file allocation table cache.
+ *
+ * The dirty entries are written in FAT offset order, so that adjacent dirty
+ * lines from different cache entries end up in the same write request and
+ * each FAT copy is written front to back.
  *
  * @returns IPRT status code.  On failure, we're currently kind of screwed.
  * @param   pThis       The FAT volume instance.
- * @param   iFirstEntry Entry to start flushing at.
- * @param   iLastEntry  Last entry to flush.
  */
-static int rtFsFatClusterMap_FlushWorker(PRTFSFATVOL pThis, uint32_t const iFirstEntry, uint32_t const iLastEntry)
+static int rtFsFatClusterMap_Flush(PRTFSFATVOL pThis)
 {
     PRTFSFATCLUSTERMAPCACHE pFatCache = pThis->pFatCache;
 
     /*
-     * Walk the cache entries, accumulating segments to flush.
+     * Collect the dirty entries, sorted by FAT offset.  The cache is direct
+     * mapped, so this is usually sorted already or close to it, making an
+     * insertion sort the right tool.
+     */
+    uint16_t aiDirty[RTFSFAT_FAT_CACHE_ENTRIES];
+    uint32_t cDirty = 0;
+    AssertCompile(RTFSFAT_FAT_CACHE_ENTRIES <= UINT16_MAX);
+    Assert(pFatCache->cEntries <= RT_ELEMENTS(aiDirty));
+    for (uint32_t iEntry = 0; iEntry < pFatCache->cEntries; iEntry++)
+        if (   pFatCache->aEntries[iEntry].bmDirty != 0
+            && pFatCache->aEntries[iEntry].offFat != UINT32_MAX)
+        {
+            uint32_t const offFat = pFatCache->aEntries[iEntry].offFat;
+            uint32_t       i      = cDirty++;
+            while (i > 0 && pFatCache->aEntries[aiDirty[i - 1]].offFat > offFat)
+            {
+                aiDirty[i] = aiDirty[i - 1];
+                i--;
+            }
+            aiDirty[i] = (uint16_t)iEntry;
+        }
+    if (!cDirty)
+        return VINF_SUCCESS;
+
+    /*
+     * Walk the dirty cache entries, accumulating segments to flush.
      */
     int      rc      = VINF_SUCCESS;
     uint64_t off     = UINT64_MAX;
     uint64_t offEdge = UINT64_MAX;
-    RTSGSEG  aSgSegs[8];
+    RTSGSEG  aSgSegs[16];
     RTSGBUF  SgBuf;
     RTSgBufInit(&SgBuf, aSgSegs, RT_ELEMENTS(aSgSegs));
     SgBuf.cSegs = 0; /** @todo RTSgBuf API is stupid, make it smarter. */
 
     for (uint32_t iFatCopy = 0; iFatCopy < pThis->cFats; iFatCopy++)
     {
-        for (uint32_t iEntry = iFirstEntry; iEntry <= iLastEntry; iEntry++)
+        for (uint32_t iDirty = 0; iDirty < cDirty; iDirty++)
         {
-            uint64_t bmDirty = pFatCache->aEntries[iEntry].bmDirty;
-            if (   bmDirty != 0
-                && pFatCache->aEntries[iEntry].offFat != UINT32_MAX)
+            uint32_t const iEntry     = aiDirty[iDirty];
+            uint64_t       bmDirty    = pFatCache->aEntries[iEntry].bmDirty;
+            uint32_t       offEntry   = 0;
+            uint64_t       iDirtyLine = 1;
+            while (offEntry < pFatCache->cbEntry)
             {
-                uint32_t offEntry   = 0;
-                uint64_t iDirtyLine = 1;
-                while (offEntry < pFatCache->cbEntry)
+                if (pFatCache->aEntries[iEntry].bmDirty & iDirtyLine)
                 {
-                    if (pFatCache->aEntries[iEntry].bmDirty & iDirtyLine)
+                    /*
+                     * Found dirty cache line.
+                     */
+                    uint64_t offDirtyLine = pThis->aoffFats[iFatCopy] + pFatCache->aEntries[iEntry].offFat + offEntry;
+
+                    /* Can we simply extend the last segment? */
+                    if (   offDirtyLine == offEdge
+                        && offEntry)
+                    {
+                        Assert(SgBuf.cSegs > 0);
+                        Assert(   (uintptr_t)aSgSegs[SgBuf.cSegs - 1].pvSeg + aSgSegs[SgBuf.cSegs - 1].cbSeg
+                               == (uintptr_t)&pFatCache->aEntries[iEntry].pbData[offEntry]);
+                        aSgSegs[SgBuf.cSegs - 1].cbSeg += pFatCache->cbDirtyLine;
+                        offEdge += pFatCache->cbDirtyLine;
+                    }
+                    else
                     {
-                        /*
-                         * Found dirty cache line.
-                         */
-                        uint64_t offDirtyLine = pThis->aoffFats[iFatCopy] + pFatCache->aEntries[iEntry].offFat + offEntry;
-
-                        /* Can we simply extend the last segment? */
-                        if (   offDirtyLine == offEdge
-                            && offEntry)
+                        /* Starting new job? */
+                        if (off == UINT64_MAX)
                         {
-                            Assert(SgBuf.cSegs > 0);
-                            Assert(   (uintptr_t)aSgSegs[SgBuf.cSegs - 1].pvSeg + aSgSegs[SgBuf.cSegs - 1].cbSeg
-                                   == (uintptr_t)&pFatCache->aEntries[iEntry].pbData[offEntry]);
-                            aSgSegs[SgBuf.cSegs - 1].cbSeg += pFatCache->cbDirtyLine;
-                            offEdge += pFatCache->cbDirtyLine;
+                            off = offDirtyLine;
+                            Assert(SgBuf.cSegs == 0);
                         }
-                        else
+                        /* flush if not adjacent or if we're out of segments. */
+                        else if (   offDirtyLine != offEdge
+                                 || SgBuf.cSegs >= RT_ELEMENTS(aSgSegs))
                         {
-                            /* Starting new job? */
-                            if (off == UINT64_MAX)
-                            {
-                                off = offDirtyLine;
-                                Assert(SgBuf.cSegs == 0);
-                            }
-                            /* flush if not adjacent or if we're out of segments. */
-                            else if (   offDirtyLine != offEdge
-                                     || SgBuf.cSegs >= RT_ELEMENTS(aSgSegs))
-                            {
-                                int rc2 = RTVfsFileSgWrite(pThis->hVfsBacking, off, &SgBuf, true /*fBlocking*/, NULL);
-                                if (RT_FAILURE(rc2) && RT_SUCCESS(rc))
-                                    rc = rc2;
-                                RTSgBufReset(&SgBuf);
-                                SgBuf.cSegs = 0;
-                                off = offDirtyLine;
-                            }
-
-                            /* Append segment. */
-                            aSgSegs[SgBuf.cSegs].cbSeg = pFatCache->cbDirtyLine;
-                            aSgSegs[SgBuf.cSegs].pvSeg = &pFatCache->aEntries[iEntry].pbData[offEntry];
-                            SgBuf.cSegs++;
-                            offEdge = offDirtyLine + pFatCache->cbDirtyLine;
+                            int rc2 = RTVfsFileSgWrite(pThis->hVfsBacking, off, &SgBuf, true /*fBlocking*/, NULL);
+                            if (RT_FAILURE(rc2) && RT_SUCCESS(rc))
+                                rc = rc2;
+                            RTSgBufReset(&SgBuf);
+                            SgBuf.cSegs = 0;
+                            off = offDirtyLine;
                         }
 
-                        bmDirty &= ~iDirtyLine;
-                        if (!bmDirty)
-                            break;
+                        /* Append segment. */
+                        aSgSegs[SgBuf.cSegs].cbSeg = pFatCache->cbDirtyLine;
+                        aSgSegs[SgBuf.cSegs].pvSeg = &pFatCache->aEntries[iEntry].pbData[offEntry];
+                        SgBuf.cSegs++;
+                        offEdge = offDirtyLine + pFatCache->cbDirtyLine;
                     }
-                    iDirtyLine <<= 1;
-                    offEntry += pFatCache->cbDirtyLine;
+
+                    bmDirty &= ~iDirtyLine;
+                    if (!bmDirty)
+                        break;
                 }
-                Assert(!bmDirty);
+                iDirtyLine <<= 1;
+                offEntry += pFatCache->cbDirtyLine;
             }
+            Assert(!bmDirty);
         }
     }
 
@@ -997,101 +1056,13 @@ static int rtFsFatClusterMap_FlushWorker(PRTFSFATVOL pThis, uint32_t const iFirs
      * Clear the dirty flags on success.
      */
     if (RT_SUCCESS(rc))
-        for (uint32_t iEntry = iFirstEntry; iEntry <= iLastEntry; iEntry++)
-            pFatCache->aEntries[iEntry].bmDirty = 0;
+        for (uint32_t iDirty = 0; iDirty < cDirty; iDirty++)
+            pFatCache->aEntries[aiDirty[iDirty]].bmDirty = 0;
 
     return rc;
 }
 
 
-/**
- * Flushes out all dirty lines in the entire file allocation table cache.
- *
- * @returns IPRT status code.  On failure, we're currently kind of screwed.
- * @param   pThis       The FAT volume instance.
- */
-static int rtFsFatClusterMap_Flush(PRTFSFATVOL pThis)
-{
-    return rtFsFatClusterMap_FlushWorker(pThis, 0, pThis->pFatCache->cEntries - 1);
-}
-
-
-/**
- * Flushes out all dirty lines in the file allocation table (cluster map) cache
- * entry.
- *
- * This is typically called prior to reusing the cache entry.
- *
- * @returns IPRT status code.  On failure, we're currently kind of screwed.
- * @param   pFatCache   The FAT cache
- * @param   iEntry      The cache entry to flush.
- */
-static int rtFsFatClusterMap_FlushEntry(PRTFSFATCLUSTERMAPCACHE pFatCache, uint32_t iEntry)
-{
-    return rtFsFatClusterMap_FlushWorker(pFatCache->pVol, iEntry, iEntry);
-}
-
-
-/**
- * Gets a pointer to a FAT entry.
- *
- * @returns IPRT status code.  On failure, we're currently kind of screwed.
- * @param   pFatCache   The FAT cache.
- * @param   offFat      The FAT byte offset to get the entry off.
- * @param   ppbEntry    Where to return the pointer to the entry.
- */
-static int rtFsFatClusterMap_GetEntry(PRTFSFATCLUSTERMAPCACHE pFatCache, uint32_t offFat, uint8_t **ppbEntry)
-{
-    int rc;
-    if (offFat < pFatCache->cbFat)
-    {
-        uint32_t const iEntry      = (offFat >> pFatCache->cEntryIndexShift) & pFatCache->fEntryIndexMask;
-        uint32_t const offInEntry  = offFat & pFatCache->fEntryOffsetMask;
-        uint32_t const offFatEntry = offFat - offInEntry;
-
-        *ppbEntry = pFatCache->aEntries[iEntry].pbData + offInEntry;
-
-        /* If it's already ready, return immediately. */
-        if (pFatCache->aEntries[iEntry].offFat == offFatEntry)
-        {
-            Log3(("rtFsFatClusterMap_GetEntry: Hit entry %u for offFat=%#RX32\n", iEntry, offFat));
-            return VINF_SUCCESS;
-        }
-
-        /* Do we need to flush it? */
-        rc = VINF_SUCCESS;
-        if (   pFatCache->aEntries[iEntry].bmDirty != 0
-            && pFatCache->aEntries[iEntry].offFat != UINT32_MAX)
-        {
-            Log3(("rtFsFatClusterMap_GetEntry: Flushing entry %u for offFat=%#RX32\n", iEntry, offFat));
-            rc = rtFsFatClusterMap_FlushEntry(pFatCache, iEntry);
-        }
-        if (RT_SUCCESS(rc))
-        {
-            pFatCache->aEntries[iEntry].bmDirty = 0;
-
-            /* Read in the entry from disk */
-            rc = RTVfsFileReadAt(pFatCache->pVol->hVfsBacking, pFatCache->pVol->aoffFats[0] + offFatEntry,
-                                 pFatCache->aEntries[iEntry].pbData, pFatCache->cbEntry, NULL);
-            if (RT_SUCCESS(rc))
-            {
-                Log3(("rtFsFatClusterMap_GetEntry: Loaded entry %u for offFat=%#RX32\n", iEntry, offFat));
-                pFatCache->aEntries[iEntry].offFat = offFatEntry;
-                return VINF_SUCCESS;
-            }
-            /** @todo We can try other FAT copies here... */
-            LogRel(("rtFsFatClusterMap_GetEntry: Error loading entry %u for offFat=%#RX32 (%#64RX32 LB %#x): %Rrc\n",
-                    iEntry, offFat, pFatCache->pVol->aoffFats[0] + offFatEntry, pFatCache->cbEntry, rc));
-            pFatCache->aEntries[iEntry].offFat = UINT32_MAX;
-        }
-    }
-    else
-        rc = VERR_OUT_OF_RANGE;
-    *ppbEntry = NULL;
-    return rc;
-}
-
-
 /**
  * Gets a pointer to a FAT entry, extended version.
  *
@@ -1121,23 +1092,27 @@ static int rtFsFatClusterMap_GetEntryEx(PRTFSFATCLUSTERMAPCACHE pFatCache, uint3
             return VINF_SUCCESS;
         }
 
-        /* Do we need to flush it? */
+        /* Do we need to flush it?  We write back everything that's dirty when
+           this happens, as that gives fewer and larger writes in disk order. */
         rc = VINF_SUCCESS;
         if (   pFatCache->aEntries[iEntry].bmDirty != 0
             && pFatCache->aEntries[iEntry].offFat != UINT32_MAX)
         {
-            Log3(("rtFsFatClusterMap_GetEntryEx: Flushing entry %u for offFat=%#RX32\n", iEntry, offFat));
-            rc = rtFsFatClusterMap_FlushEntry(pFatCache, iEntry);
+            Log3(("rtFsFatClusterMap_GetEntryEx: Flushing for entry %u for offFat=%#RX32\n", iEntry, offFat));
+            rc = rtFsFatClusterMap_Flush(pFatCache->pVol);
         }
         if (RT_SUCCESS(rc))
         {
             pFatCache->aEntries[iEntry].bmDirty = 0;
 
-            /* Read in the entry from disk */
+            /* Read in the entry from disk (the last entry may extend beyond the FAT). */
+            uint32_t const cbToRead = RT_MIN(pFatCache->cbEntry, pFatCache->cbFat - offFatEntry);
             rc = RTVfsFileReadAt(pFatCache->pVol->hVfsBacking, pFatCache->pVol->aoffFats[0] + offFatEntry,
-                                 pFatCache->aEntries[iEntry].pbData, pFatCache->cbEntry, NULL);
+                                 pFatCache->aEntries[iEntry].pbData, cbToRead, NULL);
             if (RT_SUCCESS(rc))
             {
+                if (cbToRead < pFatCache->cbEntry)
+                    RT_BZERO(&pFatCache->aEntries[iEntry].pbData[cbToRead], pFatCache->cbEntry - cbToRead);
                 Log3(("rtFsFatClusterMap_GetEntryEx: Loaded entry %u for offFat=%#RX32\n", iEntry, offFat));
                 pFatCache->aEntries[iEntry].offFat = offFatEntry;
                 return VINF_SUCCESS;
@@ -1156,6 +1131,21 @@ static int rtFsFatClusterMap_GetEntryEx(PRTFSFATCLUSTERMAPCACHE pFatCache, uint3
 }
 
 
+/**
+ * Gets a pointer to a FAT entry.
+ *
+ * @returns IPRT status code.  On failure, we're currently kind of screwed.
+ * @param   pFatCache   The FAT cache.
+ * @param   offFat      The FAT byte offset to get the entry off.
+ * @param   ppbEntry    Where to return the pointer to the entry.
+ */
+DECLINLINE(int) rtFsFatClusterMap_GetEntry(PRTFSFATCLUSTERMAPCACHE pFatCache, uint32_t offFat, uint8_t **ppbEntry)
+{
+    uint32_t idxEntryIgn;
+    return rtFsFatClusterMap_GetEntryEx(pFatCache, offFat, ppbEntry, &idxEntryIgn);
+}
+
+
 /**
  * Destroys the file allcation table cache, first flushing any dirty lines.
  *
@@ -1322,11 +1312,7 @@ static int rtFsFatClusterMap_Fat32_ReadClusterChain(PRTFSFATCLUSTERMAPCACHE pFat
  */
 static int rtFsFatClusterMap_ReadClusterChain(PRTFSFATVOL pThis, uint32_t idxFirstCluster, PRTFSFATCHAIN pChain)
 {
-    pChain->cbCluster           = pThis->cbCluster;
-    pChain->cClusterByteShift   = pThis->cClusterByteShift;
-    pChain->cClusters           = 0;
-    pChain->cbChain             = 0;
-    RTListInit(&pChain->ListParts);
+    rtFsFatChain_InitEmpty(pChain, pThis);
     switch (pThis->enmFatType)
     {
         case RTFSFATTYPE_FAT12: return rtFsFatClusterMap_Fat12_ReadClusterChain(pThis->pFatCache, idxFirstCluster, pChain);
@@ -1410,8 +1396,8 @@ static int rtFsFatClusterMap_SetCluster16(PRTFSFATCLUSTERMAPCACHE pFatCache, uin
     /* Make the change. */
     uint8_t *pbFat  = pFatCache->aEntries[0].pbData;
     uint32_t offFat = idxCluster * 2;
-    pbFat[offFat]     = (uint8_t)idxCluster;
-    pbFat[offFat + 1] = (uint8_t)(idxCluster >> 8);
+    pbFat[offFat]     = (uint8_t)uValue;
+    pbFat[offFat + 1] = (uint8_t)(uValue >> 8);
 
     /* Update the dirty bits. */
     rtFsFatClusterMap_SetDirtyByte(pFatCache, 0, offFat);
@@ -1432,10 +1418,10 @@ static int rtFsFatClusterMap_SetCluster32(PRTFSFATCLUSTERMAPCACHE pFatCache, uin
     if (RT_SUCCESS(rc))
     {
         /* Make the change. */
-        pbEntry[0] = (uint8_t)idxCluster;
-        pbEntry[1] = (uint8_t)(idxCluster >>  8);
-        pbEntry[2] = (uint8_t)(idxCluster >> 16);
-        pbEntry[3] = (uint8_t)(idxCluster >> 24);
+        pbEntry[0] = (uint8_t)uValue;
+        pbEntry[1] = (uint8_t)(uValue >>  8);
+        pbEntry[2] = (uint8_t)(uValue >> 16);
+        pbEntry[3] = (uint8_t)(uValue >> 24);
 
         /* Update the dirty bits. */
         rtFsFatClusterMap_SetDirtyByteByPtr(pFatCache, idxEntry, pbEntry);
@@ -1612,7 +1598,7 @@ static int rtFsFatClusterMap_AllocateCluster16(PRTFSFATCLUSTERMAPCACHE pFatCache
      * We start searching at idxAllocHint and continues to the end.  The next
      * iteration starts searching from the start and up to idxAllocHint.
      */
-    uint32_t idxCluster = RT_MIN(pFatCache->idxAllocHint, FAT_FIRST_DATA_CLUSTER);
+    uint32_t idxCluster = RT_MAX(pFatCache->idxAllocHint, FAT_FIRST_DATA_CLUSTER);
     uint32_t offFat     = idxCluster * 2;
     uint32_t cClusters  = pFatCache->cClusters;
     for (uint32_t i = 0; i < 2; i++)
@@ -1689,28 +1675,29 @@ static int rtFsFatClusterMap_AllocateCluster32(PRTFSFATCLUSTERMAPCACHE pFatCache
      * We start searching at idxAllocHint and continues to the end.  The next
      * iteration starts searching from the start and up to idxAllocHint.
      */
-    uint32_t idxCluster = RT_MIN(pFatCache->idxAllocHint, FAT_FIRST_DATA_CLUSTER);
+    uint32_t idxCluster = RT_MAX(pFatCache->idxAllocHint, FAT_FIRST_DATA_CLUSTER);
     uint32_t offFat     = idxCluster * 4;
     uint32_t cClusters  = pFatCache->cClusters;
     for (uint32_t i = 0; i < 2; i++)
     {
         while (idxCluster < cClusters)
         {
-            /* Note! This could be done in cache entry chunks.  */
             uint32_t idxEntry;
             rc = rtFsFatClusterMap_GetEntryEx(pFatCache, offFat, &pbEntry, &idxEntry);
             if (RT_SUCCESS(rc))
             {
-                if (   pbEntry[0] != 0x00
-                    || pbEntry[1] != 0x00
-                    || pbEntry[2] != 0x00
-                    || pbEntry[3] != 0x00)
+                /* Skip entries that are in use, working the rest of the cache entry. */
+                uint32_t cLeftInEntry = RT_MIN((pFatCache->cbEntry - (offFat & pFatCache->fEntryOffsetMask)) / 4,
+                                               cClusters - idxCluster);
+                while (   cLeftInEntry > 0
+                       && (pbEntry[0] | pbEntry[1] | pbEntry[2] | pbEntry[3]) != 0x00)
                 {
-                    /* In use - advance to the next one. */
-                    offFat += 4;
+                    pbEntry += 4;
+                    offFat  += 4;
                     idxCluster++;
+                    cLeftInEntry--;
                 }
-                else
+                if (cLeftInEntry > 0)
                 {
                     /*
                      * Found one. Grab it.
@@ -1758,12 +1745,14 @@ static int rtFsFatClusterMap_AllocateCluster32(PRTFSFATCLUSTERMAPCACHE pFatCache
                     return VINF_SUCCESS;
                 }
             }
+            else
+                return rc;
         }
 
         /* Wrap around to the start of the map. */
         cClusters  = RT_MIN(pFatCache->idxAllocHint, pFatCache->cClusters);
         idxCluster = FAT_FIRST_DATA_CLUSTER;
-        offFat     = 4;
+        offFat     = FAT_FIRST_DATA_CLUSTER * 4;
     }
 
     return VERR_DISK_FULL;
@@ -1821,6 +1810,7 @@ static int rtFsFatClusterMap_AllocateMoreClusters(PRTFSFATVOL pThis, PRTFSFATCHA
             if (RT_SUCCESS(rc))
             {
                 /* next */
+                idxPrevCluster = idxCluster;
                 iCluster++;
                 continue;
             }
@@ -1832,7 +1822,7 @@ static int rtFsFatClusterMap_AllocateMoreClusters(PRTFSFATVOL pThis, PRTFSFATCHA
             rtFsFatClusterMap_SetEndOfChain(pThis, idxOldLastCluster);
         while (iCluster-- > 0)
             rtFsFatClusterMap_FreeCluster(pThis, rtFsFatChain_GetClusterByIndex(pChain, cOldClustersInChain + iCluster));
-        rtFsFatChain_Shrink(pChain, iCluster);
+        rtFsFatChain_Shrink(pChain, cOldClustersInChain);
         break;
     }
     return rc;
@@ -2166,7 +2156,7 @@ static DECLCALLBACK(int) rtFsFatFile_Read(void *pvThis, RTFOFF off, PCRTSGBUF pS
     }
 
     /*
-     * Do the reading cluster by cluster.
+     * Do the reading extent by extent.
      */
     int      rc         = VINF_SUCCESS;
     uint32_t cbFileLeft = pShared->Core.cbObject - (uint32_t)off;
@@ -2177,10 +2167,11 @@ static DECLCALLBACK(int) rtFsFatFile_Read(void *pvThis, RTFOFF off, PCRTSGBUF pS
     {
         if (cbFileLeft > 0)
         {
-            uint64_t offDisk = rtFsFatChain_FileOffsetToDiskOff(&pShared->Core.Clusters, (uint32_t)off, pShared->Core.pVol);
+            uint32_t cbToRead;
+            uint64_t offDisk = rtFsFatChain_FileOffsetToDiskOff(&pShared->Core.Clusters, (uint32_t)off, pShared->Core.pVol,
+                                                                &cbToRead);
             if (offDisk != UINT64_MAX)
             {
-                uint32_t cbToRead = pShared->Core.Clusters.cbCluster - ((uint32_t)off & (pShared->Core.Clusters.cbCluster - 1));
                 if (cbToRead > cbLeft)
                     cbToRead = (uint32_t)cbLeft;
                 if (cbToRead > cbFileLeft)
@@ -2240,14 +2231,8 @@ static int rtFsFatObj_SetSize(PRTFSFATOBJ pObj, uint32_t cbFile)
     { /* likely when writing small bits at a time. */ }
     else if (pObj->Clusters.cClusters < cClustersNew)
     {
-        /* Allocate and append new clusters. */
-        do
-        {
-            uint32_t idxCluster;
-            rc = rtFsFatClusterMap_AllocateCluster(pObj->pVol, rtFsFatChain_GetLastCluster(&pObj->Clusters), &idxCluster);
-            if (RT_SUCCESS(rc))
-                rc = rtFsFatChain_Append(&pObj->Clusters, idxCluster);
-        } while (pObj->Clusters.cClusters < cClustersNew && RT_SUCCESS(rc));
+        /* Allocate and append new clusters (all or nothing). */
+        rc = rtFsFatClusterMap_AllocateMoreClusters(pObj->pVol, &pObj->Clusters, cClustersNew - pObj->Clusters.cClusters);
         pObj->fMaybeDirtyFat = true;
     }
     else
@@ -2319,43 +2304,64 @@ static DECLCALLBACK(int) rtFsFatFile_Write(void *pvThis, RTFOFF off, PCRTSGBUF p
         off = pThis->offFile;
 
     /*
-     * Do the reading cluster by cluster.
+     * Do the writing extent by extent.
      */
     int            rc         = VINF_SUCCESS;
     uint32_t       cbWritten  = 0;
     size_t         cbLeft     = pSgBuf->paSegs[0].cbSeg;
     uint8_t const *pbSrc      = (uint8_t const *)pSgBuf->paSegs[0].pvSeg;
+    bool           fGrowSlow  = false;
     while (cbLeft > 0)
     {
         /* Figure out how much we can write.  Checking for max file size and such. */
-        uint32_t cbToWrite = pShared->Core.Clusters.cbCluster - ((uint32_t)off & (pShared->Core.Clusters.cbCluster - 1));
-        if (cbToWrite > cbLeft)
-            cbToWrite = (uint32_t)cbLeft;
+        uint32_t cbToWrite = (uint32_t)RT_MIN(cbLeft, _4G - 1U);
         uint64_t offNew = (uint64_t)off + cbToWrite;
         if (offNew < _4G)
         { /*likely*/ }
         else if ((uint64_t)off < _4G - 1U)
+        {
             cbToWrite = _4G - 1U - off;
+            offNew    = _4G - 1U;
+        }
         else
         {
             rc = VERR_FILE_TOO_BIG;
             break;
         }
 
-        /* Grow the file? */
+        /* Grow the file?  If there isn't room for all of it, fill up the current
+           cluster and continue one cluster at a time, so a write running into a
+           full disk doesn't try allocating all the free clusters over and over. */
         if ((uint32_t)offNew > pShared->Core.cbObject)
         {
-            rc = rtFsFatObj_SetSize(&pShared->Core, (uint32_t)offNew);
-            if (RT_SUCCESS(rc))
-            { /* likely */}
-            else
-                break;
+            rc = VERR_DISK_FULL;
+            if (!fGrowSlow)
+                rc = rtFsFatObj_SetSize(&pShared->Core, (uint32_t)offNew);
+            if (RT_FAILURE(rc))
+            {
+                uint32_t const cbInCluster = pShared->Core.Clusters.cbCluster
+                                           - ((uint32_t)off & (pShared->Core.Clusters.cbCluster - 1));
+                if (!fGrowSlow && cbToWrite <= cbInCluster)
+                    break;
+                fGrowSlow = true;
+                if (cbToWrite > cbInCluster)
+                {
+                    cbToWrite = cbInCluster;
+                    offNew    = (uint64_t)off + cbToWrite;
+                }
+                rc = rtFsFatObj_SetSize(&pShared->Core, (uint32_t)offNew);
+                if (RT_FAILURE(rc))
+                    break;
+            }
         }
 
-        /* Figure the disk offset. */
-        uint64_t offDisk = rtFsFatChain_FileOffsetToDiskOff(&pShared->Core.Clusters, (uint32_t)off, pVol);
+        /* Figure the disk offset and how much of it is contiguous. */
+        uint32_t cbContiguous;
+        uint64_t offDisk = rtFsFatChain_FileOffsetToDiskOff(&pShared->Core.Clusters, (uint32_t)off, pVol, &cbContiguous);
         if (offDisk != UINT64_MAX)
         {
+            if (cbToWrite > cbContiguous)
+                cbToWrite = cbContiguous;
             rc = RTVfsFileWriteAt(pVol->hVfsBacking, offDisk, pbSrc, cbToWrite, NULL);
             if (RT_SUCCESS(rc))
             {
@@ -2693,18 +2699,28 @@ static int rtFsFatDirShrd_FlushFullyBuffered(PRTFSFATDIRSHRD pThis)
 {
     Assert(pThis->fFullyBuffered);
     uint32_t const  cbSector    = pThis->Core.pVol->cbSector;
+    uint32_t const  cSectors    = pThis->u.Full.cSectors;
     RTVFSFILE const hVfsBacking = pThis->Core.pVol->hVfsBacking;
     int             rc          = VINF_SUCCESS;
-    for (uint32_t i = 0; i < pThis->u.Full.cSectors; i++)
-        if (ASMBitTest(pThis->u.Full.pbDirtySectors, i))
-        {
-            int rc2 = RTVfsFileWriteAt(hVfsBacking, pThis->offEntriesOnDisk + i * cbSector,
-                                       (uint8_t *)pThis->paEntries + i * cbSector, cbSector, NULL);
-            if (RT_SUCCESS(rc2))
-                ASMBitClear(pThis->u.Full.pbDirtySectors, i);
-            else if (RT_SUCCESS(rc))
-                rc = rc2;
-        }
+
+    /* Write each run of dirty sectors in one go.  (The bitmap allocation is
+       rounded up to 64 bits, so it's fine to search it in 32-bit units.) */
+    uint32_t const cBits  = RT_ALIGN_32(cSectors, 32);
+    int32_t        iFirst = cBits ? ASMBitFirstSet(pThis->u.Full.pbDirtySectors, cBits) : -1;
+    while (iFirst >= 0)
+    {
+        int32_t iEnd = (uint32_t)iFirst + 1 < cBits ? ASMBitNextClear(pThis->u.Full.pbDirtySectors, cBits, iFirst) : -1;
+        if (iEnd < 0 || (uint32_t)iEnd > cSectors)
+            iEnd = (int32_t)cSectors;
+        int rc2 = RTVfsFileWriteAt(hVfsBacking, pThis->offEntriesOnDisk + (uint32_t)iFirst * cbSector,
+                                   (uint8_t *)pThis->paEntries + (uint32_t)iFirst * cbSector,
+                                   (uint32_t)(iEnd - iFirst) * cbSector, NULL);
+        if (RT_SUCCESS(rc2))
+            ASMBitClearRange(pThis->u.Full.pbDirtySectors, iFirst, iEnd);
+        else if (RT_SUCCESS(rc))
+            rc = rc2;
+        iFirst = (uint32_t)iEnd + 1 < cBits ? ASMBitNextSet(pThis->u.Full.pbDirtySectors, cBits, iEnd) : -1;
+    }
     return rc;
 }
 
@@ -2720,13 +2736,16 @@ static int rtFsFatDirShrd_FlushSimple(PRTFSFATDIRSHRD pThis)
     Assert(!pThis->fFullyBuffered);
     int rc;
     if (   !pThis->u.Simple.fDirty
-        || pThis->offEntriesOnDisk != UINT64_MAX)
+        || pThis->offEntriesOnDisk == UINT64_MAX)
         rc = VINF_SUCCESS;
     else
     {
         Assert(pThis->u.Simple.offInDir != UINT32_MAX);
-        rc = RTVfsFileWriteAt(pThis->Core.pVol->hVfsBacking,  pThis->offEntriesOnDisk,
-                              pThis->paEntries, pThis->Core.pVol->cbSector, NULL);
+        Assert(pThis->u.Simple.offFirstDirty < pThis->u.Simple.offEndDirty);
+        Assert(pThis->u.Simple.offEndDirty <= pThis->cbAllocatedForEntries);
+        rc = RTVfsFileWriteAt(pThis->Core.pVol->hVfsBacking, pThis->offEntriesOnDisk + pThis->u.Simple.offFirstDirty,
+                              (uint8_t *)pThis->paEntries + pThis->u.Simple.offFirstDirty,
+                              pThis->u.Simple.offEndDirty - pThis->u.Simple.offFirstDirty, NULL);
         if (RT_SUCCESS(rc))
             pThis->u.Simple.fDirty = false;
     }
@@ -2791,12 +2810,12 @@ static int rtFsFatDirShrd_GetEntriesAtCommon(PRTFSFATDIRSHRD pThis, uint32_t off
             /*
              * Simple buffering: If hit, return the number of entries.
              */
-            PRTFSFATVOL pVol = pThis->Core.pVol;
-            uint32_t    off  = offEntryInDir - pThis->u.Simple.offInDir;
-            if (off < pVol->cbSector)
+            uint32_t const cbBuffer = pThis->cbAllocatedForEntries;
+            uint32_t       off      = offEntryInDir - pThis->u.Simple.offInDir;
+            if (off < cbBuffer)
             {
                 *ppaEntries = &pThis->paEntries[off / sizeof(FATDIRENTRY)];
-                *pcEntries  = (pVol->cbSector - off) / sizeof(FATDIRENTRY);
+                *pcEntries  = RT_MIN((cbBuffer - off) / sizeof(FATDIRENTRY), pThis->cEntries - idxEntryInDir);
                 *puLock     = !fForUpdate ? 1 : UINT32_C(0x80000001);
                 rc = VINF_SUCCESS;
             }
@@ -2804,8 +2823,8 @@ static int rtFsFatDirShrd_GetEntriesAtCommon(PRTFSFATDIRSHRD pThis, uint32_t off
             {
                 /*
                  * Simple buffering: Miss.
-                 * Flush dirty. Read in new sector. Return entries in sector starting
-                 * at offEntryInDir.
+                 * Flush dirty. Read in new cluster. Return entries in cluster
+                 * starting at offEntryInDir.
                  */
                 if (!pThis->u.Simple.fDirty)
                     rc = VINF_SUCCESS;
@@ -2813,16 +2832,16 @@ static int rtFsFatDirShrd_GetEntriesAtCommon(PRTFSFATDIRSHRD pThis, uint32_t off
                     rc = rtFsFatDirShrd_FlushSimple(pThis);
                 if (RT_SUCCESS(rc))
                 {
-                    off                      =  offEntryInDir &  (pVol->cbSector - 1);
-                    pThis->u.Simple.offInDir = (offEntryInDir & ~(pVol->cbSector - 1));
+                    off                      =  offEntryInDir &  (cbBuffer - 1);
+                    pThis->u.Simple.offInDir = (offEntryInDir & ~(cbBuffer - 1));
                     pThis->offEntriesOnDisk  = rtFsFatChain_FileOffsetToDiskOff(&pThis->Core.Clusters, pThis->u.Simple.offInDir,
-                                                                                pThis->Core.pVol);
+                                                                                pThis->Core.pVol, NULL);
                     rc = RTVfsFileReadAt(pThis->Core.pVol->hVfsBacking, pThis->offEntriesOnDisk,
-                                         pThis->paEntries, pVol->cbSector, NULL);
+                                         pThis->paEntries, cbBuffer, NULL);
                     if (RT_SUCCESS(rc))
                     {
                         *ppaEntries = &pThis->paEntries[off / sizeof(FATDIRENTRY)];
-                        *pcEntries  = (pVol->cbSector - off) / sizeof(FATDIRENTRY);
+                        *pcEntries  = RT_MIN((cbBuffer - off) / sizeof(FATDIRENTRY), pThis->cEntries - idxEntryInDir);
                         *puLock     = !fForUpdate ? 1 : UINT32_C(0x80000001);
                         rc = VINF_SUCCESS;
                     }
@@ -2860,7 +2879,20 @@ static int rtFsFatDirShrd_PutEntryAfterUpdate(PRTFSFATDIRSHRD pThis, PFATDIRENTR
         ASMBitSet(pThis->u.Full.pbDirtySectors, idxSector);
     }
     else
-        pThis->u.Simple.fDirty = true;
+    {
+        uint32_t const cbSector  = pThis->Core.pVol->cbSector;
+        uint32_t const offSector = ((uintptr_t)pDirEntry - (uintptr_t)pThis->paEntries) & ~(cbSector - 1);
+        if (!pThis->u.Simple.fDirty)
+        {
+            pThis->u.Simple.offFirstDirty = offSector;
+            pThis->u.Simple.offEndDirty   = offSector + cbSector;
+            pThis->u.Simple.fDirty        = true;
+        }
+        else if (offSector < pThis->u.Simple.offFirstDirty)
+            pThis->u.Simple.offFirstDirty = offSector;
+        else if (offSector + cbSector > pThis->u.Simple.offEndDirty)
+            pThis->u.Simple.offEndDirty   = offSector + cbSector;
+    }
     return VINF_SUCCESS;
 }
 
@@ -4737,7 +4769,7 @@ static int rtFsFatDirShrd_New(PRTFSFATVOL pThis, PRTFSFATDIRSHRD pParentDir, PCF
         if (pShared->fFullyBuffered)
             pShared->cbAllocatedForEntries = RT_ALIGN_32(cbDir, pThis->cbSector);
         else
-            pShared->cbAllocatedForEntries = pThis->cbSector;
+            pShared->cbAllocatedForEntries = pThis->cbCluster;
 
         /*
          * If clustered backing, read the chain and see if we cannot still do the full buffering.
@@ -4748,7 +4780,7 @@ static int rtFsFatDirShrd_New(PRTFSFATVOL pThis, PRTFSFATDIRSHRD pParentDir, PCF
             if (RT_SUCCESS(rc))
             {
                 if (   pShared->Core.Clusters.cClusters >= 1
-                    && pShared->Core.Clusters.cbChain   <= _64K
+                    && pShared->Core.Clusters.cbChain   <= RTFSFAT_MAX_FULLY_BUFFERED_DIR
                     && rtFsFatChain_IsContiguous(&pShared->Core.Clusters))
                 {
                     Assert(pShared->Core.Clusters.cbChain >= cbDir);
@@ -4784,7 +4816,7 @@ static int rtFsFatDirShrd_New(PRTFSFATVOL pThis, PRTFSFATDIRSHRD pParentDir, PCF
                 if (pShared->fFullyBuffered && !pShared->fIsLinearRootDir)
                 {
                     pShared->fFullyBuffered = false;
-                    pShared->cbAllocatedForEntries = pThis->cbSector;
+                    pShared->cbAllocatedForEntries = pThis->cbCluster;
                     pShared->paEntries = (PFATDIRENTRYUNION)RTMemAlloc(pShared->cbAllocatedForEntries);
                 }
                 if (!pShared->paEntries)
@@ -4809,6 +4841,8 @@ static int rtFsFatDirShrd_New(PRTFSFATVOL pThis, PRTFSFATDIRSHRD pParentDir, PCF
                     pShared->offEntriesOnDisk       = rtFsFatClusterToDiskOffset(pThis, idxCluster);
                     pShared->u.Simple.offInDir      = 0;
                     pShared->u.Simple.fDirty        = false;
+                    pShared->u.Simple.offFirstDirty = 0;
+                    pShared->u.Simple.offEndDirty   = 0;
                 }
                 if (RT_SUCCESS(rc))
                     rc = RTVfsFileReadAt(pThis->hVfsBacking, pShared->offEntriesOnDisk,
@@ -35,6 +35,7 @@
 #include <iprt/asm.h>
 #include <iprt/assert.h>
 #include <iprt/buildconfig.h>
+#include <iprt/critsect.h>
 #include <iprt/err.h>
 #include <iprt/ctype.h>
 #include <iprt/md5.h>
@@ -42,14 +43,18 @@
 #include <iprt/list.h>
 #include <iprt/log.h>
 #include <iprt/mem.h>
+#include <iprt/mp.h>
 #include <iprt/path.h>
+#include <iprt/semaphore.h>
 #include <iprt/string.h>
+#include <iprt/thread.h>
 #include <iprt/vfs.h>
 #include <iprt/vfslowlevel.h>
 #include <iprt/zero.h>
 #include <iprt/formats/iso9660.h>
 
 #include <internal/magics.h>
+#include <internal/workers.h>
 
 
 /*********************************************************************************************************************************
@@ -87,6 +92,20 @@
  * these long obsolete files. */
 #define RTFSISOMAKER_TRANS_TBL_LEFT_PAD         12
 
+/** Number of source files the output file read-ahead keeps in flight. */
+#define RTFSISOMAKER_READ_AHEAD_SLOTS           64
+/** Max number of source file read-ahead threads. */
+#define RTFSISOMAKER_READ_AHEAD_MAX_THREADS     4
+/** Source files up to this size are read into memory by the read-ahead
+ * threads, larger ones are only opened and then read directly into the
+ * caller's buffer. */
+#define RTFSISOMAKER_READ_AHEAD_MAX_FILE        _1M
+/** Max number of bytes the read-ahead threads may buffer. */
+#define RTFSISOMAKER_READ_AHEAD_MAX_BYTES       _32M
+/** Number of source files that must be read back to back before the output
+ * file starts the read-ahead threads. */
+#define RTFSISOMAKER_READ_AHEAD_TRIGGER         4
+
 /** Tests if @a a_ch is in the set of d-characters. */
 #define RTFSISOMAKER_IS_IN_D_CHARS(a_ch)        (RT_C_IS_UPPER(a_ch) || RT_C_IS_DIGIT(a_ch) || (a_ch) == '_')
 
@@ -612,6 +631,68 @@ typedef RTFSISOMAKERINT *PRTFSISOMAKERINT;
 typedef struct RTFSISOMAKERINT::RTFSISOMAKERFINALIZEDDIRS *PRTFSISOMAKERFINALIZEDDIRS;
 
 
+/**
+ * Source file read-ahead slot state.
+ */
+typedef enum RTFSISOMAKERRASTATE
+{
+    /** Free slot. */
+    RTFSISOMAKERRASTATE_FREE = 0,
+    /** Waiting for a read-ahead thread to pick it up. */
+    RTFSISOMAKERRASTATE_QUEUED,
+    /** A read-ahead thread is working on it. */
+    RTFSISOMAKERRASTATE_BUSY,
+    /** Done, rc, pbData and hVfsFile are valid. */
+    RTFSISOMAKERRASTATE_READY
+} RTFSISOMAKERRASTATE;
+
+/**
+ * Source file read-ahead slot.
+ */
+typedef struct RTFSISOMAKERRASLOT
+{
+    /** The file (RTFSISOMAKERSRCTYPE_PATH). */
+    PRTFSISOMAKERFILE       pFile;
+    /** The slot state. */
+    RTFSISOMAKERRASTATE     enmState;
+    /** Set if the consumer dropped the slot while it was busy, the thread
+     * frees it when done. */
+    bool                    fCancelled;
+    /** The read-ahead status code. */
+    int                     rc;
+    /** The whole file content if small enough, otherwise NULL. */
+    uint8_t                *pbData;
+    /** The opened source file if pbData is NULL. */
+    RTVFSFILE               hVfsFile;
+} RTFSISOMAKERRASLOT;
+/** Pointer to a source file read-ahead slot. */
+typedef RTFSISOMAKERRASLOT *PRTFSISOMAKERRASLOT;
+
+/**
+ * Source file read-ahead of an ISO maker output file.
+ *
+ * This is started when the output file is read sequentially.  It opens and
+ * reads the next few source files on a couple of threads, so that producing
+ * an image from lots of small files isn't bound by the latency of opening and
+ * reading them one by one.
+ */
+typedef struct RTFSISOMAKERREADAHEAD
+{
+    /** The threads.  The lock protects the slots and everything else below,
+     * the work event is signalled when there are queued slots and the done
+     * event when a slot is ready. */
+    RTWORKERS               Workers;
+    /** The next file to consider for queuing, NULL if at the end. */
+    PRTFSISOMAKERFILE       pNextFile;
+    /** Number of bytes buffered or about to be buffered by the slots. */
+    size_t                  cbBuffered;
+    /** The slots. */
+    RTFSISOMAKERRASLOT      aSlots[RTFSISOMAKER_READ_AHEAD_SLOTS];
+} RTFSISOMAKERREADAHEAD;
+/** Pointer to the source file read-ahead of an ISO maker output file. */
+typedef RTFSISOMAKERREADAHEAD *PRTFSISOMAKERREADAHEAD;
+
+
 /**
  * Instance data of an ISO maker output file.
  */
@@ -635,6 +716,15 @@ typedef struct RTFSISOMAKEROUTPUTFILE
     uint32_t                iChildPrimaryIso;
     /** Joliet directory child index hint. */
     uint32_t                iChildJoliet;
+
+    /** Source file read-ahead, NULL if not started. */
+    PRTFSISOMAKERREADAHEAD  pReadAhead;
+    /** The ready read-ahead slot for pFileHint, NULL if none. */
+    PRTFSISOMAKERRASLOT     pReadAheadSlot;
+    /** Number of source files read back to back. */
+    uint32_t                cSequentialFiles;
+    /** Set if starting the read-ahead failed, so we don't retry. */
+    bool                    fNoReadAhead;
 } RTFSISOMAKEROUTPUTFILE;
 /** Pointer to the instance data of an ISO maker output file. */
 typedef RTFSISOMAKEROUTPUTFILE *PRTFSISOMAKEROUTPUTFILE;
@@ -713,6 +803,7 @@ static int rtFsIsoMakerObjRemoveWorker(PRTFSISOMAKERINT pThis, PRTFSISOMAKEROBJ
 
 static ssize_t rtFsIsoMakerOutFile_RockRidgeGenSL(const char *pszTarget, uint8_t *pbBuf, size_t cbBuf);
 static DECLCALLBACK(int) rtFsIsoMakerOutFile_Seek(void *pvThis, RTFOFF offSeek, unsigned uMethod, PRTFOFF poffActual);
+static void rtFsIsoMakerReadAheadDestroy(PRTFSISOMAKERREADAHEAD pReadAhead);
 
 
 
@@ -5526,6 +5617,13 @@ static DECLCALLBACK(int) rtFsIsoMakerOutFile_Close(void *pvThis)
 {
     PRTFSISOMAKEROUTPUTFILE pThis = (PRTFSISOMAKEROUTPUTFILE)pvThis;
 
+    if (pThis->pReadAhead)
+    {
+        rtFsIsoMakerReadAheadDestroy(pThis->pReadAhead);
+        pThis->pReadAhead     = NULL;
+        pThis->pReadAheadSlot = NULL;
+    }
+
     RTFsIsoMakerRelease(pThis->pIsoMaker);
     pThis->pIsoMaker = NULL;
 
@@ -6232,6 +6330,291 @@ static int rtFsIsoMakerOutFile_ProduceTransTbl(PRTFSISOMAKEROUTPUTFILE pThis, PR
 }
 
 
+/**
+ * Frees the resources of a read-ahead slot, leaving it free.
+ *
+ * @param   pReadAhead      The read-ahead instance.  Caller owns the lock.
+ * @param   pSlot           The slot, not busy.
+ */
+static void rtFsIsoMakerReadAheadFreeSlot(PRTFSISOMAKERREADAHEAD pReadAhead, PRTFSISOMAKERRASLOT pSlot)
+{
+    Assert(pSlot->enmState != RTFSISOMAKERRASTATE_BUSY);
+    if (pSlot->pFile->cbData <= RTFSISOMAKER_READ_AHEAD_MAX_FILE)
+        pReadAhead->cbBuffered -= (size_t)pSlot->pFile->cbData;
+    if (pSlot->pbData)
+    {
+        RTMemFree(pSlot->pbData);
+        pSlot->pbData = NULL;
+    }
+    if (pSlot->hVfsFile != NIL_RTVFSFILE)
+    {
+        RTVfsFileRelease(pSlot->hVfsFile);
+        pSlot->hVfsFile = NIL_RTVFSFILE;
+    }
+    pSlot->pFile      = NULL;
+    pSlot->fCancelled = false;
+    pSlot->enmState   = RTFSISOMAKERRASTATE_FREE;
+}
+
+
+/**
+ * Drops a read-ahead slot, deferring it to the thread if it is busy.
+ *
+ * @param   pReadAhead      The read-ahead instance.  Caller owns the lock.
+ * @param   pSlot           The slot, not free.
+ */
+static void rtFsIsoMakerReadAheadDropSlot(PRTFSISOMAKERREADAHEAD pReadAhead, PRTFSISOMAKERRASLOT pSlot)
+{
+    if (pSlot->enmState != RTFSISOMAKERRASTATE_BUSY)
+        rtFsIsoMakerReadAheadFreeSlot(pReadAhead, pSlot);
+    else
+        pSlot->fCancelled = true;
+}
+
+
+/**
+ * @callback_method_impl{FNRTTHREAD, Source file read-ahead thread.}
+ */
+static DECLCALLBACK(int) rtFsIsoMakerReadAheadThread(RTTHREAD hThreadSelf, void *pvUser)
+{
+    PRTFSISOMAKERREADAHEAD pReadAhead = (PRTFSISOMAKERREADAHEAD)pvUser;
+    RT_NOREF(hThreadSelf);
+
+    RTCritSectEnter(&pReadAhead->Workers.CritSect);
+    while (!pReadAhead->Workers.fTerminate)
+    {
+        /*
+         * Pick the queued file closest to the consumer.
+         */
+        PRTFSISOMAKERRASLOT pSlot = NULL;
+        for (uint32_t i = 0; i < RT_ELEMENTS(pReadAhead->aSlots); i++)
+            if (   pReadAhead->aSlots[i].enmState == RTFSISOMAKERRASTATE_QUEUED
+                && (!pSlot || pReadAhead->aSlots[i].pFile->offData < pSlot->pFile->offData))
+                pSlot = &pReadAhead->aSlots[i];
+        if (!pSlot)
+        {
+            rtWorkersWaitForWork(&pReadAhead->Workers);
+            continue;
+        }
+        pSlot->enmState = RTFSISOMAKERRASTATE_BUSY;
+        PRTFSISOMAKERFILE const pFile = pSlot->pFile;
+        RTCritSectLeave(&pReadAhead->Workers.CritSect);
+
+        /*
+         * Open it and read small files in full.  The name and size of a
+         * finalized file won't change, so no need for any locking here.
+         */
+        RTVFSFILE hVfsFile = NIL_RTVFSFILE;
+        uint8_t  *pbData   = NULL;
+        int rc = RTVfsChainOpenFile(pFile->u.pszSrcPath, RTFILE_O_READ | RTFILE_O_DENY_NONE | RTFILE_O_OPEN,
+                                    &hVfsFile, NULL, NULL);
+        if (RT_SUCCESS(rc) && pFile->cbData <= RTFSISOMAKER_READ_AHEAD_MAX_FILE)
+        {
+            pbData = (uint8_t *)RTMemAlloc((size_t)pFile->cbData);
+            if (pbData)
+            {
+                rc = RTVfsFileReadAt(hVfsFile, 0, pbData, (size_t)pFile->cbData, NULL);
+                if (RT_FAILURE(rc))
+                {
+                    RTMemFree(pbData);
+                    pbData = NULL;
+                }
+            }
+            else
+                rc = VERR_NO_MEMORY;
+            RTVfsFileRelease(hVfsFile);
+            hVfsFile = NIL_RTVFSFILE;
+        }
+
+        /*
+         * Hand it over to the consumer.
+         */
+        RTCritSectEnter(&pReadAhead->Workers.CritSect);
+        pSlot->rc       = rc;
+        pSlot->pbData   = pbData;
+        pSlot->hVfsFile = hVfsFile;
+        pSlot->enmState = RTFSISOMAKERRASTATE_READY;
+        if (pSlot->fCancelled)
+            rtFsIsoMakerReadAheadFreeSlot(pReadAhead, pSlot);
+        rtWorkersSignalDone(&pReadAhead->Workers);
+    }
+    RTCritSectLeave(&pReadAhead->Workers.CritSect);
+    return VINF_SUCCESS;
+}
+
+
+/**
+ * Destroys the source file read-ahead of an output file.
+ *
+ * @param   pReadAhead      The read-ahead instance.
+ */
+static void rtFsIsoMakerReadAheadDestroy(PRTFSISOMAKERREADAHEAD pReadAhead)
+{
+    rtWorkersDelete(&pReadAhead->Workers);
+
+    for (uint32_t i = 0; i < RT_ELEMENTS(pReadAhead->aSlots); i++)
+        if (pReadAhead->aSlots[i].enmState != RTFSISOMAKERRASTATE_FREE)
+            rtFsIsoMakerReadAheadFreeSlot(pReadAhead, &pReadAhead->aSlots[i]);
+    Assert(pReadAhead->cbBuffered == 0);
+    RTMemFree(pReadAhead);
+}
+
+
+/**
+ * Creates the source file read-ahead for an output file.
+ *
+ * @returns IPRT status code.
+ * @param   ppReadAhead     Where to return the read-ahead instance.
+ */
+static int rtFsIsoMakerReadAheadCreate(PRTFSISOMAKERREADAHEAD *ppReadAhead)
+{
+    PRTFSISOMAKERREADAHEAD pReadAhead = (PRTFSISOMAKERREADAHEAD)RTMemAllocZ(sizeof(*pReadAhead));
+    if (!pReadAhead)
+        return VERR_NO_MEMORY;
+    for (uint32_t i = 0; i < RT_ELEMENTS(pReadAhead->aSlots); i++)
+        pReadAhead->aSlots[i].hVfsFile = NIL_RTVFSFILE;
+
+    /* The threads mostly wait for I/O, a few are enough even on small boxes. */
+    uint32_t const cThreads = RT_MIN(RT_MAX(RTMpGetOnlineCount(), 2), RTFSISOMAKER_READ_AHEAD_MAX_THREADS);
+    int rc = rtWorkersInit(&pReadAhead->Workers, cThreads, rtFsIsoMakerReadAheadThread, pReadAhead,
+                           RTTHREADTYPE_IO, "isomkra");
+    if (RT_SUCCESS(rc))
+    {
+        *ppReadAhead = pReadAhead;
+        return VINF_SUCCESS;
+    }
+    RTMemFree(pReadAhead);
+    return rc;
+}
+
+
+/**
+ * Updates the source file read-ahead when the output file moves on to a new
+ * file and looks up the read-ahead slot for it.
+ *
+ * @param   pThis           The output file instance data.
+ * @param   pIsoMaker       The ISO maker instance.
+ * @param   pFile           The file we're moving on to.
+ * @param   fSequential     Set if this is the file following the previous one,
+ *                          clear if the consumer is jumping around.
+ */
+static void rtFsIsoMakerOutFile_ReadAheadAdvance(PRTFSISOMAKEROUTPUTFILE pThis, PRTFSISOMAKERINT pIsoMaker,
+                                                 PRTFSISOMAKERFILE pFile, bool fSequential)
+{
+    pThis->pReadAheadSlot = NULL;
+    PRTFSISOMAKERREADAHEAD pReadAhead = pThis->pReadAhead;
+
+    /*
+     * Random access: Drop everything we've read ahead.  We'll restart when
+     * it turns sequential again.
+     */
+    if (!fSequential)
+    {
+        pThis->cSequentialFiles = 0;
+        if (pReadAhead)
+        {
+            RTCritSectEnter(&pReadAhead->Workers.CritSect);
+            for (uint32_t i = 0; i < RT_ELEMENTS(pReadAhead->aSlots); i++)
+                if (pReadAhead->aSlots[i].enmState != RTFSISOMAKERRASTATE_FREE)
+                    rtFsIsoMakerReadAheadDropSlot(pReadAhead, &pReadAhead->aSlots[i]);
+            pReadAhead->pNextFile = NULL;
+            RTCritSectLeave(&pReadAhead->Workers.CritSect);
+        }
+        return;
+    }
+
+    /*
+     * Sequential: Start the read-ahead once it looks like we're being copied.
+     */
+    if (!pReadAhead)
+    {
+        if (   ++pThis->cSequentialFiles < RTFSISOMAKER_READ_AHEAD_TRIGGER
+            || pThis->fNoReadAhead)
+            return;
+        int rc = rtFsIsoMakerReadAheadCreate(&pThis->pReadAhead);
+        if (RT_FAILURE(rc))
+        {
+            LogRel(("ISO maker: Failed to start source file read-ahead: %Rrc\n", rc));
+            pThis->fNoReadAhead = true;
+            return;
+        }
+        pReadAhead = pThis->pReadAhead;
+    }
+
+    RTCritSectEnter(&pReadAhead->Workers.CritSect);
+
+    /* Drop slots for files we've passed. */
+    for (uint32_t i = 0; i < RT_ELEMENTS(pReadAhead->aSlots); i++)
+        if (   pReadAhead->aSlots[i].enmState != RTFSISOMAKERRASTATE_FREE
+            && !pReadAhead->aSlots[i].fCancelled
+            && pReadAhead->aSlots[i].pFile->offData < pFile->offData)
+            rtFsIsoMakerReadAheadDropSlot(pReadAhead, &pReadAhead->aSlots[i]);
+
+    /* Queue up more files. */
+    if (!pReadAhead->pNextFile || pReadAhead->pNextFile->offData < pFile->offData)
+        pReadAhead->pNextFile = pFile;
+    bool     fQueued = false;
+    uint32_t iFree   = 0;
+    while (pReadAhead->pNextFile)
+    {
+        PRTFSISOMAKERFILE pNext = pReadAhead->pNextFile;
+        if (   pNext->enmSrcType == RTFSISOMAKERSRCTYPE_PATH
+            && pNext->cbData > 0)
+        {
+            size_t const cbBuffer = pNext->cbData <= RTFSISOMAKER_READ_AHEAD_MAX_FILE ? (size_t)pNext->cbData : 0;
+            if (pReadAhead->cbBuffered + cbBuffer > RTFSISOMAKER_READ_AHEAD_MAX_BYTES)
+                break;
+            while (   iFree < RT_ELEMENTS(pReadAhead->aSlots)
+                   && pReadAhead->aSlots[iFree].enmState != RTFSISOMAKERRASTATE_FREE)
+                iFree++;
+            if (iFree >= RT_ELEMENTS(pReadAhead->aSlots))
+                break;
+
+            PRTFSISOMAKERRASLOT pSlot = &pReadAhead->aSlots[iFree];
+            pSlot->pFile    = pNext;
+            pSlot->rc       = VERR_INTERNAL_ERROR;
+            pSlot->enmState = RTFSISOMAKERRASTATE_QUEUED;
+            pReadAhead->cbBuffered += cbBuffer;
+            fQueued = true;
+        }
+        pReadAhead->pNextFile = RTListGetNext(&pIsoMaker->FinalizedFiles, pNext, RTFSISOMAKERFILE, FinalizedEntry);
+    }
+    if (fQueued)
+        rtWorkersSignalWork(&pReadAhead->Workers);
+
+    /*
+     * Look up the slot for the current file, waiting for it to become ready.
+     */
+    if (pFile->enmSrcType == RTFSISOMAKERSRCTYPE_PATH)
+    {
+        for (;;)
+        {
+            PRTFSISOMAKERRASLOT pSlot = NULL;
+            for (uint32_t i = 0; i < RT_ELEMENTS(pReadAhead->aSlots); i++)
+                if (   pReadAhead->aSlots[i].pFile == pFile
+                    && pReadAhead->aSlots[i].enmState != RTFSISOMAKERRASTATE_FREE
+                    && !pReadAhead->aSlots[i].fCancelled)
+                {
+                    pSlot = &pReadAhead->aSlots[i];
+                    break;
+                }
+            if (!pSlot)
+                break;
+            if (pSlot->enmState == RTFSISOMAKERRASTATE_READY)
+            {
+                /* Failures are left to the regular code path to deal with. */
+                if (RT_SUCCESS(pSlot->rc))
+                    pThis->pReadAheadSlot = pSlot;
+                break;
+            }
+            rtWorkersWaitForDone(&pReadAhead->Workers);
+        }
+    }
+
+    RTCritSectLeave(&pReadAhead->Workers.CritSect);
+}
+
+
 
 /**
  * Reads file data.
@@ -6287,12 +6670,16 @@ static int rtFsIsoMakerOutFile_ReadFileData(PRTFSISOMAKEROUTPUTFILE pThis, PRTFS
      */
     if (pThis->pFileHint != pFile)
     {
+        bool const fSequential = pThis->pFileHint
+                              && offInFile == 0
+                              && pFile->offData > pThis->pFileHint->offData;
         pThis->pFileHint = pFile;
         if (pThis->hVfsSrcFile != NIL_RTVFSFILE)
         {
             RTVfsFileRelease(pThis->hVfsSrcFile);
             pThis->hVfsSrcFile = NIL_RTVFSFILE;
         }
+        rtFsIsoMakerOutFile_ReadAheadAdvance(pThis, pIsoMaker, pFile, fSequential);
     }
 
     /*
@@ -6306,15 +6693,34 @@ static int rtFsIsoMakerOutFile_ReadFileData(PRTFSISOMAKEROUTPUTFILE pThis, PRTFS
         switch (pFile->enmSrcType)
         {
             case RTFSISOMAKERSRCTYPE_PATH:
+            {
+                /* Small files may already have been read by the read-ahead
+                   threads, larger ones may at least have been opened. */
+                PRTFSISOMAKERRASLOT pSlot = pThis->pReadAheadSlot;
+                if (pSlot && pSlot->pbData)
+                {
+                    memcpy(pbBuf, &pSlot->pbData[offInFile], cbToRead);
+                    rc = VINF_SUCCESS;
+                    break;
+                }
                 if (pThis->hVfsSrcFile == NIL_RTVFSFILE)
                 {
-                    rc = RTVfsChainOpenFile(pFile->u.pszSrcPath, RTFILE_O_READ | RTFILE_O_DENY_NONE | RTFILE_O_OPEN,
-                                            &pThis->hVfsSrcFile, NULL, NULL);
-                    AssertMsgRCReturn(rc, ("%s -> %Rrc\n", pFile->u.pszSrcPath, rc), rc);
+                    if (pSlot && pSlot->hVfsFile != NIL_RTVFSFILE)
+                    {
+                        pThis->hVfsSrcFile = pSlot->hVfsFile;
+                        pSlot->hVfsFile    = NIL_RTVFSFILE;
+                    }
+                    else
+                    {
+                        rc = RTVfsChainOpenFile(pFile->u.pszSrcPath, RTFILE_O_READ | RTFILE_O_DENY_NONE | RTFILE_O_OPEN,
+                                                &pThis->hVfsSrcFile, NULL, NULL);
+                        AssertMsgRCReturn(rc, ("%s -> %Rrc\n", pFile->u.pszSrcPath, rc), rc);
+                    }
                 }
                 rc = RTVfsFileReadAt(pThis->hVfsSrcFile, offInFile, pbBuf, cbToRead, NULL);
                 AssertRC(rc);
                 break;
+            }
 
             case RTFSISOMAKERSRCTYPE_VFS_FILE:
                 rc = RTVfsFileReadAt(pFile->u.hVfsFile, offInFile, pbBuf, cbToRead, NULL);
@@ -7428,6 +7834,10 @@ RTDECL(int) RTFsIsoMakerCreateVfsOutputFile(RTFSISOMAKER hIsoMaker, PRTVFSFILE p
         pFileData->pDirHintJoliet     = NULL;
         pFileData->iChildPrimaryIso   = UINT32_MAX;
         pFileData->iChildJoliet       = UINT32_MAX;
+        pFileData->pReadAhead         = NULL;
+        pFileData->pReadAheadSlot     = NULL;
+        pFileData->cSequentialFiles   = 0;
+        pFileData->fNoReadAhead       = false;
         *phVfsFile = hVfsFile;
         return VINF_SUCCESS;
     }
@@ -47,6 +47,7 @@
 #include <iprt/rand.h>
 #include <iprt/stream.h>
 #include <iprt/string.h>
+#include <iprt/time.h>
 #include <iprt/vfs.h>
 #include <iprt/formats/iso9660.h>
 
@@ -98,7 +99,9 @@ typedef enum RTFSISOMAKERCMDOPT
     RTFSISOMAKERCMD_OPT_OUTPUT_BUFFER_SIZE,
     RTFSISOMAKERCMD_OPT_RANDOM_OUTPUT_BUFFER_SIZE,
     RTFSISOMAKERCMD_OPT_RANDOM_ORDER_VERIFICATION,
+    RTFSISOMAKERCMD_OPT_NO_READ_AHEAD,
     RTFSISOMAKERCMD_OPT_NAME_SETUP,
+    RTFSISOMAKERCMD_OPT_INCREMENTAL,
 
     RTFSISOMAKERCMD_OPT_ROCK_RIDGE,
     RTFSISOMAKERCMD_OPT_LIMITED_ROCK_RIDGE,
@@ -338,6 +341,10 @@ typedef struct RTFSISOMAKERCMDOPTS
     /** Do output verification, but do it in random order if non-zero.  The
      * values gives the block size to use. */
     uint32_t            cbRandomOrderVerifciationBlock;
+    /** Don't produce the image on a read-ahead thread while writing it. */
+    bool                fNoReadAhead;
+    /** Only rewrite the parts of an existing output file that changed. */
+    bool                fIncremental;
 
     /** Index of the top source stack entry, -1 if empty.  */
     int32_t             iSrcStack;
@@ -498,6 +505,7 @@ static const RTGETOPTDEF g_aRtFsIsoMakerOptions[] =
     { "--output-buffer-size",           RTFSISOMAKERCMD_OPT_OUTPUT_BUFFER_SIZE,             RTGETOPT_REQ_UINT32  },
     { "--random-output-buffer-size",    RTFSISOMAKERCMD_OPT_RANDOM_OUTPUT_BUFFER_SIZE,      RTGETOPT_REQ_NOTHING },
     { "--random-order-verification",    RTFSISOMAKERCMD_OPT_RANDOM_ORDER_VERIFICATION,      RTGETOPT_REQ_UINT32 },
+    { "--no-read-ahead",                RTFSISOMAKERCMD_OPT_NO_READ_AHEAD,                  RTGETOPT_REQ_NOTHING },
 
 #define DD(a_szLong, a_chShort, a_fFlags) { a_szLong, a_chShort, a_fFlags  }, { "-" a_szLong, a_chShort, a_fFlags  }
 
@@ -537,6 +545,7 @@ static const RTGETOPTDEF g_aRtFsIsoMakerOptions[] =
     DD("--iso-level",                   RTFSISOMAKERCMD_OPT_ISO_LEVEL,                      RTGETOPT_REQ_UINT8   ),
     { "--long-names",                   'l',                                                RTGETOPT_REQ_NOTHING },
     { "--output",                       'o',                                                RTGETOPT_REQ_STRING  },
+    { "--incremental",                  RTFSISOMAKERCMD_OPT_INCREMENTAL,                    RTGETOPT_REQ_NOTHING },
     { "--joliet",                       'J',                                                RTGETOPT_REQ_NOTHING },
     DD("-ucs-level",                    RTFSISOMAKERCMD_OPT_JOLIET_LEVEL,                   RTGETOPT_REQ_UINT8   ),
     DD("-rock",                         'R',                                                RTGETOPT_REQ_NOTHING ),
@@ -1056,13 +1065,19 @@ static int rtFsIsoMakerCmdWriteImageRandomBufferSize(PRTFSISOMAKERCMDOPTS pOpts,
  * @param   cbImage             The size of the ISO.
  * @param   pvBuf               Pointer to read buffer.
  * @param   cbBuf               The buffer size.
+ * @param   pvOldBuf            Buffer of size @a cbBuf for reading back the
+ *                              current destination file content when doing an
+ *                              incremental update.  NULL for a normal write.
+ * @param   pcbWritten          Where to return the number of bytes actually
+ *                              written to the destination file.
  */
 static int rtFsIsoMakerCmdWriteImageSimple(PRTFSISOMAKERCMDOPTS pOpts, RTVFSFILE hVfsSrcFile, RTVFSFILE hVfsDstFile,
-                                           uint64_t cbImage, void *pvBuf, size_t cbBuf)
+                                           uint64_t cbImage, void *pvBuf, size_t cbBuf, void *pvOldBuf, uint64_t *pcbWritten)
 {
     /*
      * Copy the virtual image bits to the destination file.
      */
+    *pcbWritten = 0;
     uint64_t offImage = 0;
     while (offImage < cbImage)
     {
@@ -1077,7 +1092,21 @@ static int rtFsIsoMakerCmdWriteImageSimple(PRTFSISOMAKERCMDOPTS pOpts, RTVFSFILE
         int rc = RTVfsFileReadAt(hVfsSrcFile, offImage, pvBuf, cbToCopy, NULL);
         if (RT_SUCCESS(rc))
         {
-            rc = RTVfsFileWriteAt(hVfsDstFile, offImage, pvBuf, cbToCopy, NULL);
+            /* When updating an image, the layout doesn't change unless the
+               set of files or their sizes did, so typically only the blocks
+               of modified files need rewriting. */
+            size_t cbOld = 0;
+            if (   pvOldBuf
+                && RT_SUCCESS(RTVfsFileReadAt(hVfsDstFile, offImage, pvOldBuf, cbToCopy, &cbOld))
+                && cbOld == cbToCopy
+                && memcmp(pvOldBuf, pvBuf, cbToCopy) == 0)
+                rc = VINF_SUCCESS;
+            else
+            {
+                rc = RTVfsFileWriteAt(hVfsDstFile, offImage, pvBuf, cbToCopy, NULL);
+                if (RT_SUCCESS(rc))
+                    *pcbWritten += cbToCopy;
+            }
             if (RT_SUCCESS(rc))
                 offImage += cbToCopy;
             else
@@ -1097,8 +1126,10 @@ static int rtFsIsoMakerCmdWriteImageSimple(PRTFSISOMAKERCMDOPTS pOpts, RTVFSFILE
  * @returns IPRT status code.
  * @param   pOpts               The ISO maker command instance.
  * @param   hVfsSrcFile         The source file from the ISO maker.
+ * @param   nsStart             RTTimeNanoTS() value from when we started
+ *                              finalizing the image, for the timing summary.
  */
-static int rtFsIsoMakerCmdWriteImage(PRTFSISOMAKERCMDOPTS pOpts, RTVFSFILE hVfsSrcFile)
+static int rtFsIsoMakerCmdWriteImage(PRTFSISOMAKERCMDOPTS pOpts, RTVFSFILE hVfsSrcFile, uint64_t nsStart)
 {
     /*
      * Get the image size and setup the copy buffer.
@@ -1109,9 +1140,10 @@ static int rtFsIsoMakerCmdWriteImage(PRTFSISOMAKERCMDOPTS pOpts, RTVFSFILE hVfsS
     {
         rtFsIsoMakerPrintf(pOpts, "Image size: %'RU64 (%#RX64) bytes\n", cbImage, cbImage);
 
-        uint32_t cbBuf = pOpts->cbOutputReadBuffer == 0 ? _1M : pOpts->cbOutputReadBuffer;
-        void    *pvBuf = RTMemTmpAlloc(cbBuf);
-        if (pvBuf)
+        uint32_t cbBuf    = pOpts->cbOutputReadBuffer == 0 ? _1M : pOpts->cbOutputReadBuffer;
+        void    *pvBuf    = RTMemTmpAlloc(cbBuf);
+        void    *pvOldBuf = pOpts->fIncremental ? RTMemTmpAlloc(cbBuf) : NULL;
+        if (pvBuf && (pvOldBuf || !pOpts->fIncremental))
         {
             /*
              * Open the output file.
@@ -1120,7 +1152,8 @@ static int rtFsIsoMakerCmdWriteImage(PRTFSISOMAKERCMDOPTS pOpts, RTVFSFILE hVfsS
             uint32_t        offError;
             RTERRINFOSTATIC ErrInfo;
             rc = RTVfsChainOpenFile(pOpts->pszOutFile,
-                                    RTFILE_O_READWRITE | RTFILE_O_CREATE_REPLACE | RTFILE_O_DENY_WRITE
+                                    RTFILE_O_READWRITE | RTFILE_O_DENY_WRITE
+                                    | (pOpts->fIncremental ? RTFILE_O_OPEN_CREATE : RTFILE_O_CREATE_REPLACE)
                                     | (0664 << RTFILE_O_CREATE_MODE_SHIFT),
                                     &hVfsDstFile, &offError, RTErrInfoInitStatic(&ErrInfo));
             if (RT_SUCCESS(rc))
@@ -1128,12 +1161,37 @@ static int rtFsIsoMakerCmdWriteImage(PRTFSISOMAKERCMDOPTS pOpts, RTVFSFILE hVfsS
                 /*
                  * Apply the desired writing method.
                  */
-                if (!pOpts->fRandomOutputReadBufferSize)
+                uint64_t const nsStartWrite = RTTimeNanoTS();
+                uint64_t       cbWritten    = cbImage;
+                if (pOpts->fRandomOutputReadBufferSize)
                     rc = rtFsIsoMakerCmdWriteImageRandomBufferSize(pOpts, hVfsSrcFile, hVfsDstFile, cbImage, &pvBuf);
                 else
-                    rc = rtFsIsoMakerCmdWriteImageSimple(pOpts, hVfsSrcFile, hVfsDstFile, cbImage, pvBuf, cbBuf);
+                {
+                    /* Have a thread produce the next bits of the image while we're
+                       writing the current ones (unless told not to). */
+                    RTVFSFILE hVfsReadAhead = NIL_RTVFSFILE;
+                    if (!pOpts->fNoReadAhead)
+                    {
+                        rc = RTVfsCreateReadAheadForFile(hVfsSrcFile, 0 /*fFlags*/, 4 /*cBuffers*/, cbBuf, &hVfsReadAhead);
+                        if (RT_FAILURE(rc))
+                            hVfsReadAhead = NIL_RTVFSFILE;
+                    }
+                    rc = rtFsIsoMakerCmdWriteImageSimple(pOpts, hVfsReadAhead != NIL_RTVFSFILE ? hVfsReadAhead : hVfsSrcFile,
+                                                         hVfsDstFile, cbImage, pvBuf, cbBuf, pvOldBuf, &cbWritten);
+                    RTVfsFileRelease(hVfsReadAhead);
+                }
                 RTMemTmpFree(pvBuf);
 
+                /* The file isn't truncated when opened for an incremental update,
+                   so drop whatever a larger old image left behind. */
+                if (RT_SUCCESS(rc) && pOpts->fIncremental)
+                {
+                    rc = RTVfsFileSetSize(hVfsDstFile, cbImage, RTVFSFILE_SIZE_F_NORMAL);
+                    if (RT_FAILURE(rc))
+                        rc = rtFsIsoMakerCmdErrorRc(pOpts, rc, "RTVfsFileSetSize failed on '%s': %Rrc",
+                                                    pOpts->pszOutFile, rc);
+                }
+
                 if (RT_SUCCESS(rc) && pOpts->cbRandomOrderVerifciationBlock > 0)
                     rc = rtFsIsoMakerCmdVerifyImageInRandomOrder(pOpts, hVfsSrcFile, hVfsDstFile, cbImage);
 
@@ -1148,6 +1206,20 @@ static int rtFsIsoMakerCmdWriteImage(PRTFSISOMAKERCMDOPTS pOpts, RTVFSFILE hVfsS
                 }
 
                 RTVfsFileRelease(hVfsDstFile);
+
+                /*
+                 * Timing summary.
+                 */
+                if (RT_SUCCESS(rc))
+                {
+                    uint64_t const nsNow       = RTTimeNanoTS();
+                    uint64_t const cMsWrite    = RT_MAX((nsNow - nsStartWrite) / RT_NS_1MS, 1);
+                    uint64_t const cMsFinalize = (nsStartWrite - nsStart) / RT_NS_1MS;
+                    rtFsIsoMakerPrintf(pOpts, "Finalized in %'RU64 ms, written in %'RU64 ms (%'RU64 KiB/s)\n",
+                                       cMsFinalize, cMsWrite, cbImage * RT_MS_1SEC / _1K / cMsWrite);
+                    if (pOpts->fIncremental)
+                        rtFsIsoMakerPrintf(pOpts, "Incremental update rewrote %'RU64 of %'RU64 bytes\n", cbWritten, cbImage);
+                }
             }
             else
             {
@@ -1156,7 +1228,11 @@ static int rtFsIsoMakerCmdWriteImage(PRTFSISOMAKERCMDOPTS pOpts, RTVFSFILE hVfsS
             }
         }
         else
+        {
+            RTMemTmpFree(pvBuf);
             rc = rtFsIsoMakerCmdErrorRc(pOpts, VERR_NO_TMP_MEMORY, "RTMemTmpAlloc(%zu) failed", cbBuf);
+        }
+        RTMemTmpFree(pvOldBuf);
     }
     else
         rc = rtFsIsoMakerCmdErrorRc(pOpts, rc, "RTVfsFileGetSize failed: %Rrc", rc);
@@ -3128,6 +3204,12 @@ static int rtFsIsoMakerCmdParse(PRTFSISOMAKERCMDOPTS pOpts, unsigned cArgs, char
                 pOpts->pszOutFile = ValueUnion.psz;
                 break;
 
+            case RTFSISOMAKERCMD_OPT_INCREMENTAL:
+                if (pOpts->fVirtualImageMaker)
+                    return rtFsIsoMakerCmdSyntaxError(pOpts, "The --incremental option is not allowed");
+                pOpts->fIncremental = true;
+                break;
+
             case RTFSISOMAKERCMD_OPT_NAME_SETUP:
                 rc = rtFsIsoMakerCmdOptNameSetup(pOpts, ValueUnion.psz);
                 break;
@@ -3394,6 +3476,10 @@ static int rtFsIsoMakerCmdParse(PRTFSISOMAKERCMDOPTS pOpts, unsigned cArgs, char
                 pOpts->cbRandomOrderVerifciationBlock = ValueUnion.u32;
                 break;
 
+            case RTFSISOMAKERCMD_OPT_NO_READ_AHEAD:                     /* --no-read-ahead */
+                pOpts->fNoReadAhead = true;
+                break;
+
 
             /*
              * Standard bits.
@@ -3511,6 +3597,7 @@ RTDECL(int) RTFsIsoMakerCmdEx(unsigned cArgs, char **papszArgs, RTVFSDIR hVfsCwd
                 /*
                  * Finalize the image and get the virtual file.
                  */
+                uint64_t const nsStart = RTTimeNanoTS();
                 rc = RTFsIsoMakerFinalize(Opts.hIsoMaker);
                 if (RT_SUCCESS(rc))
                 {
@@ -3525,7 +3612,7 @@ RTDECL(int) RTFsIsoMakerCmdEx(unsigned cArgs, char **papszArgs, RTVFSDIR hVfsCwd
                             *phVfsFile = hVfsFile;
                         else
                         {
-                            rc = rtFsIsoMakerCmdWriteImage(&Opts, hVfsFile);
+                            rc = rtFsIsoMakerCmdWriteImage(&Opts, hVfsFile, nsStart);
                             RTVfsFileRelease(hVfsFile);
                         }
                     }
@@ -88,6 +88,16 @@ AssertCompile(sizeof(RTLOG_RINGBUF_EYE_CATCHER) == 16);
 #define RTLOG_RINGBUF_EYE_CATCHER_END    "\0\0\0END RING BUF"
 AssertCompile(sizeof(RTLOG_RINGBUF_EYE_CATCHER_END) == 16);
 
+/** @def RTLOG_BIN_DEF_ENTRIES
+ * The default number of records in a per-thread binary log buffer. */
+/** @def RTLOG_BIN_MIN_ENTRIES
+ * The min number of records in a per-thread binary log buffer. */
+/** @def RTLOG_BIN_MAX_ENTRIES
+ * The max number of records in a per-thread binary log buffer. */
+#define RTLOG_BIN_DEF_ENTRIES           _4K
+#define RTLOG_BIN_MIN_ENTRIES           16
+#define RTLOG_BIN_MAX_ENTRIES           _1M
+
 
 /*********************************************************************************************************************************
 *   Structures and Typedefs                                                                                                      *
@@ -103,8 +113,81 @@ typedef struct RTLOGOUTPUTPREFIXEDARGS
     unsigned                fFlags;
     /** The group. (used for prefixing.) */
     unsigned                iGroup;
+    /** The thread to show in the prefix, NIL_RTNATIVETHREAD for the calling
+     *  thread. */
+    RTNATIVETHREAD          hNativeThread;
+    /** The thread name to show in the prefix, NULL for the calling thread. */
+    const char             *pszThreadName;
 } RTLOGOUTPUTPREFIXEDARGS, *PRTLOGOUTPUTPREFIXEDARGS;
 
+#ifdef IN_RING3
+/**
+ * A binary log record (RTLogBinLoggerEx).
+ *
+ * The record is formatted when the buffer is drained, so the format string
+ * and any data the arguments point to must stay valid until then.
+ */
+typedef struct RTLOGBINENTRY
+{
+    /** The nano second time stamp of the record (for merging). */
+    uint64_t                NanoTS;
+    /** The format string. */
+    const char             *pszFormat;
+    /** The logging flags. */
+    uint16_t                fFlags;
+    /** The group, UINT16_MAX for ~0U. */
+    uint16_t                iGroup;
+    /** The argument types (RTLOGBINARG_XXX). */
+    uint32_t                fArgTypes;
+    /** The raw arguments, zero extended. */
+    uint64_t                au64Args[RTLOG_BIN_MAX_ARGS];
+} RTLOGBINENTRY;
+/** Pointer to a binary log record. */
+typedef RTLOGBINENTRY *PRTLOGBINENTRY;
+/** Pointer to a const binary log record. */
+typedef RTLOGBINENTRY const *PCRTLOGBINENTRY;
+
+/**
+ * Per-thread binary log buffer.
+ *
+ * This is a single producer (the owner thread), single consumer (whoever
+ * holds the logger lock) ring, so the producer needs no locking.
+ */
+typedef struct RTLOGBINBUF
+{
+    /** Pointer to the next buffer (protected by the logger lock). */
+    struct RTLOGBINBUF     *pNext;
+    /** The logger this buffer belongs to. */
+    PRTLOGGER               pLogger;
+    /** The owner thread. */
+    RTNATIVETHREAD          hNativeThread;
+    /** The name of the owner thread, for the log prefix (which shows up to 16
+     * characters). */
+    char                    szThreadName[16];
+    /** The number of entries in aEntries (power of two). */
+    uint32_t                cEntries;
+    /** Set when the owner thread has terminated. */
+    bool volatile           fOrphaned;
+    /** The producer position as seen by the current drain (logger lock). */
+    uint32_t                iHeadSnapshot;
+    /** The consumer position, updated under the logger lock. */
+    uint32_t volatile       iTail;
+    /** The number of records dropped because the ring was full. */
+    uint64_t volatile       cDropped;
+    /** The producer position, only written by the owner thread.
+     * Padded so it doesn't share a cache line with the consumer fields. */
+    union
+    {
+        uint32_t volatile   iHead;
+        uint8_t             abPadding[64];
+    } Prod;
+    /** The records. */
+    RTLOGBINENTRY           aEntries[1];
+} RTLOGBINBUF;
+/** Pointer to a per-thread binary log buffer. */
+typedef RTLOGBINBUF *PRTLOGBINBUF;
+#endif /* IN_RING3 */
+
 #ifndef IN_RC
 
 /**
@@ -199,11 +282,29 @@ typedef struct RTLOGGERINTERNAL
     /** Pointer to filename. */
     char                    szFilename[RTPATH_MAX];
     /** @} */
+
+    /** @name Binary per-thread logging (RTLogBinLoggerEx).
+     * @{ */
+    /** TLS index of the per-thread buffers, NIL_RTTLS if not enabled. */
+    RTTLS                   iBinTls;
+    /** The number of records in each per-thread buffer (power of two). */
+    uint32_t                cBinEntries;
+    /** List of per-thread buffers (protected by the logger lock). */
+    PRTLOGBINBUF            pBinBufHead;
+    /** Event semaphore for waking up the flusher thread. */
+    RTSEMEVENT              hBinFlushEvt;
+    /** The flusher thread, NIL_RTTHREAD if none. */
+    RTTHREAD                hBinFlushThread;
+    /** The flusher thread interval. */
+    RTMSINTERVAL            cMsBinFlushInterval;
+    /** Set when the flusher thread should terminate. */
+    bool volatile           fBinFlushShutdown;
+    /** @} */
 # endif /* IN_RING3 */
 } RTLOGGERINTERNAL;
 
 /** The revision of the internal logger structure. */
-# define RTLOGGERINTERNAL_REV    UINT32_C(10)
+# define RTLOGGERINTERNAL_REV    UINT32_C(11)
 
 # ifdef IN_RING3
 /** The size of the RTLOGGERINTERNAL structure in ring-0.  */
@@ -228,6 +329,8 @@ static void rtR0LogLoggerExFallback(uint32_t fDestFlags, uint32_t fFlags, PRTLOG
 #endif
 #ifdef IN_RING3
 static int  rtR3LogOpenFileDestination(PRTLOGGER pLogger, PRTERRINFO pErrInfo);
+static void rtlogBinDrainLocked(PRTLOGGER pLogger);
+static void rtlogBinTerm(PRTLOGGER pLogger);
 #endif
 #ifndef IN_RC
 static void rtLogRingBufFlush(PRTLOGGER pLogger);
@@ -238,6 +341,7 @@ static DECLCALLBACK(size_t) rtLogOutputPrefixed(void *pv, const char *pachChars,
 static void rtlogLoggerExVLocked(PRTLOGGER pLogger, unsigned fFlags, unsigned iGroup, const char *pszFormat, va_list args);
 #ifndef IN_RC
 static void rtlogLoggerExFLocked(PRTLOGGER pLogger, unsigned fFlags, unsigned iGroup, const char *pszFormat, ...);
+static void rtlogMuteGroupLocked(PRTLOGGER pLogger, unsigned fFlags, unsigned iGroup, uint32_t cEntries);
 #endif
 
 
@@ -847,6 +951,10 @@ RTDECL(int) RTLogCreateExV(PRTLOGGER *ppLogger, uint32_t fFlags, const char *psz
             pLogger->pInt->cSecsHistoryTimeSlot = UINT32_MAX;
         else
             pLogger->pInt->cSecsHistoryTimeSlot = cSecsHistoryTimeSlot;
+        pLogger->pInt->iBinTls                  = NIL_RTTLS;
+        pLogger->pInt->pBinBufHead              = NULL;
+        pLogger->pInt->hBinFlushEvt             = NIL_RTSEMEVENT;
+        pLogger->pInt->hBinFlushThread          = NIL_RTTHREAD;
 # else   /* !IN_RING3 */
         RT_NOREF_PV(pfnPhase); RT_NOREF_PV(cHistory); RT_NOREF_PV(cbHistoryFileMax); RT_NOREF_PV(cSecsHistoryTimeSlot);
 # endif  /* !IN_RING3 */
@@ -1061,6 +1169,13 @@ RTDECL(int) RTLogDestroy(PRTLOGGER pLogger)
     AssertReturn(pLogger->u32Magic == RTLOGGER_MAGIC, VERR_INVALID_MAGIC);
     AssertPtrReturn(pLogger->pInt, VERR_INVALID_POINTER);
 
+# ifdef IN_RING3
+    /*
+     * Write out pending binary records and stop the flusher thread.
+     */
+    rtlogBinTerm(pLogger);
+# endif
+
     /*
      * Acquire logger instance sem and disable all logging. (paranoia)
      */
@@ -2115,6 +2230,494 @@ RTDECL(uint32_t) RTLogSetGroupLimit(PRTLOGGER pLogger, uint32_t cMaxEntriesPerGr
 
     return cOld;
 }
+
+
+/**
+ * Allocates the calling thread's binary log buffer.
+ *
+ * @returns Pointer to the buffer, NULL on failure.
+ * @param   pLogger     The logger instance.
+ */
+static PRTLOGBINBUF rtlogBinAllocThreadBuf(PRTLOGGER pLogger)
+{
+    PRTLOGGERINTERNAL pInt = pLogger->pInt;
+    PRTLOGBINBUF pBuf = (PRTLOGBINBUF)RTMemAllocZTag(RT_OFFSETOF(RTLOGBINBUF, aEntries[pInt->cBinEntries]),
+                                                     "may-leak:log-bin-buf");
+    if (pBuf)
+    {
+        pBuf->pLogger       = pLogger;
+        pBuf->hNativeThread = RTThreadNativeSelf();
+        pBuf->cEntries      = pInt->cBinEntries;
+        const char *pszName = RTThreadSelfName();
+        RTStrCopy(pBuf->szThreadName, sizeof(pBuf->szThreadName), pszName ? pszName : "");
+        if (RT_SUCCESS(RTTlsSet(pInt->iBinTls, pBuf)))
+        {
+            if (RT_SUCCESS(rtlogLock(pLogger)))
+            {
+                pBuf->pNext       = pInt->pBinBufHead;
+                pInt->pBinBufHead = pBuf;
+                rtlogUnlock(pLogger);
+                return pBuf;
+            }
+            RTTlsSet(pInt->iBinTls, NULL);
+        }
+        RTMemFree(pBuf);
+    }
+    return NULL;
+}
+
+
+/**
+ * TLS destructor which hands the buffer of an exiting thread over to the
+ * drainer for cleanup.
+ *
+ * @param   pvValue     The thread's RTLOGBINBUF.
+ */
+static DECLCALLBACK(void) rtlogBinTlsDtor(void *pvValue)
+{
+    PRTLOGBINBUF pBuf = (PRTLOGBINBUF)pvValue;
+    if (pBuf)
+        ASMAtomicWriteBool(&pBuf->fOrphaned, true);
+}
+
+
+/**
+ * RTLogFormatV wrapper for rtlogBinFormatPieceLocked.
+ *
+ * @param   pfnOutput   The output function.
+ * @param   pvOutput    The output function argument.
+ * @param   pszFormat   The format string.
+ * @param   ...         The format arguments.
+ */
+static void rtlogBinOutputF(PFNRTSTROUTPUT pfnOutput, void *pvOutput, const char *pszFormat, ...)
+{
+    va_list va;
+    va_start(va, pszFormat);
+    RTLogFormatV(pfnOutput, pvOutput, pszFormat, va);
+    va_end(va);
+}
+
+
+/**
+ * Formats one piece of a binary log record format string.
+ *
+ * @param   pArgs       The output arguments of the record.
+ * @param   pchFormat   The piece of the format string.  Not terminated.
+ * @param   cchFormat   The length of the piece.
+ * @param   fArg        Whether the piece starts with a conversion consuming
+ *                      an argument.
+ * @param   uType       The argument type (RTLOGBINARG_XXX).
+ * @param   u64Arg      The argument value.
+ */
+static void rtlogBinFormatPieceLocked(PRTLOGOUTPUTPREFIXEDARGS pArgs, const char *pchFormat, size_t cchFormat,
+                                      bool fArg, uint32_t uType, uint64_t u64Arg)
+{
+    char  szBuf[256];
+    char *pszFormat = cchFormat < sizeof(szBuf) ? szBuf : (char *)RTMemTmpAlloc(cchFormat + 1);
+    if (!pszFormat)
+        return;
+    memcpy(pszFormat, pchFormat, cchFormat);
+    pszFormat[cchFormat] = '\0';
+
+    PRTLOGGER const pLogger   = pArgs->pLogger;
+    PFNRTSTROUTPUT  pfnOutput = rtLogOutputPrefixed;
+    void           *pvOutput  = pArgs;
+    if (!(pLogger->fFlags & (RTLOGFLAGS_PREFIX_MASK | RTLOGFLAGS_USECRLF)))
+    {
+        pfnOutput = rtLogOutput;
+        pvOutput  = pLogger;
+    }
+    if (!fArg)
+        rtlogBinOutputF(pfnOutput, pvOutput, pszFormat);
+    else if (uType == RTLOGBINARG_U32)
+        rtlogBinOutputF(pfnOutput, pvOutput, pszFormat, (uint32_t)u64Arg);
+    else if (uType == RTLOGBINARG_PTR)
+        rtlogBinOutputF(pfnOutput, pvOutput, pszFormat, (void *)(uintptr_t)u64Arg);
+    else /* RTLOGBINARG_U64, and a zero for conversions without an argument */
+        rtlogBinOutputF(pfnOutput, pvOutput, pszFormat, u64Arg);
+
+    if (pszFormat != szBuf)
+        RTMemTmpFree(pszFormat);
+}
+
+
+/**
+ * Formats a binary log record into the logger.
+ *
+ * The arguments can't be passed on in one go as we only know their types at
+ * runtime, so the format string is split in front of each conversion and each
+ * piece is formatted with the single argument it consumes.  The pieces all go
+ * to the same output, so the record is prefixed and counted against the group
+ * restrictions once, on behalf of the thread that logged it.
+ *
+ * @param   pLogger     The logger instance, owner of the lock.
+ * @param   pBuf        The buffer the record was taken from.
+ * @param   pEntry      The record.
+ */
+static void rtlogBinFormatEntryLocked(PRTLOGGER pLogger, PRTLOGBINBUF pBuf, PCRTLOGBINENTRY pEntry)
+{
+    unsigned const fFlags = pEntry->fFlags;
+    unsigned const iGroup = pEntry->iGroup == UINT16_MAX ? ~0U : pEntry->iGroup;
+
+    /*
+     * Check group restrictions the same way RTLogLoggerExV does.
+     */
+    uint32_t cMuteEntries = 0;
+    if (RT_UNLIKELY(   (pLogger->fFlags & RTLOGFLAGS_RESTRICT_GROUPS)
+                    && iGroup < pLogger->cGroups
+                    && (pLogger->afGroups[iGroup] & RTLOGGRPFLAGS_RESTRICT)
+                    && ++pLogger->pInt->pacEntriesPerGroup[iGroup] >= pLogger->pInt->cMaxEntriesPerGroup ))
+    {
+        uint32_t cEntries = pLogger->pInt->pacEntriesPerGroup[iGroup];
+        if (cEntries > pLogger->pInt->cMaxEntriesPerGroup)
+        {
+            pLogger->pInt->pacEntriesPerGroup[iGroup] = cEntries - 1;
+            return;
+        }
+        cMuteEntries = cEntries;
+    }
+
+    RTLOGOUTPUTPREFIXEDARGS OutputArgs;
+    OutputArgs.pLogger       = pLogger;
+    OutputArgs.iGroup        = iGroup;
+    OutputArgs.fFlags        = fFlags;
+    OutputArgs.hNativeThread = pBuf->hNativeThread;
+    OutputArgs.pszThreadName = pBuf->szThreadName;
+
+    const char *pszPiece = pEntry->pszFormat;
+    bool        fArg     = false;
+    unsigned    iArg     = 0;
+    for (const char *psz = pszPiece; ; psz++)
+    {
+        char const ch = *psz;
+        if (ch == '%' && psz[1] == '%')
+            psz++;
+        else if (ch == '%' || ch == '\0')
+        {
+            if (psz != pszPiece)
+            {
+                uint32_t uType  = RTLOGBINARG_END;
+                uint64_t u64Arg = 0;
+                if (fArg && iArg < RTLOG_BIN_MAX_ARGS)
+                {
+                    uType  = (pEntry->fArgTypes >> (iArg * RTLOGBINARG_SHIFT)) & RTLOGBINARG_MASK;
+                    u64Arg = pEntry->au64Args[iArg];
+                }
+                rtlogBinFormatPieceLocked(&OutputArgs, pszPiece, (size_t)(psz - pszPiece), fArg, uType, u64Arg);
+                iArg += fArg;
+            }
+            if (ch == '\0')
+                break;
+            pszPiece = psz;
+            fArg     = true;
+        }
+    }
+
+    if (    !(pLogger->fFlags & RTLOGFLAGS_BUFFERED)
+        &&  pLogger->offScratch)
+        rtlogFlush(pLogger, false /*fNeedSpace*/);
+
+    if (cMuteEntries)
+        rtlogMuteGroupLocked(pLogger, fFlags, iGroup, cMuteEntries);
+}
+
+
+/**
+ * Formats the records in the per-thread binary buffers into the logger.
+ *
+ * Records are merged in time stamp order.  The number of records is bounded by
+ * the fill level at the time of the call so busy producers cannot keep us here.
+ *
+ * @param   pLogger     The logger instance, owner of the lock.
+ */
+static void rtlogBinDrainLocked(PRTLOGGER pLogger)
+{
+    PRTLOGGERINTERNAL pInt = pLogger->pInt;
+    PRTLOGBINBUF      pBuf;
+
+    /*
+     * Snapshot the producer positions.
+     */
+    for (pBuf = pInt->pBinBufHead; pBuf; pBuf = pBuf->pNext)
+        pBuf->iHeadSnapshot = ASMAtomicReadU32(&pBuf->Prod.iHead);
+
+    /*
+     * Merge the records into the log.
+     */
+    for (;;)
+    {
+        PRTLOGBINBUF pOldest = NULL;
+        uint64_t     NanoTSOldest = UINT64_MAX;
+        for (pBuf = pInt->pBinBufHead; pBuf; pBuf = pBuf->pNext)
+            if (pBuf->iTail != pBuf->iHeadSnapshot)
+            {
+                PCRTLOGBINENTRY pEntry = &pBuf->aEntries[pBuf->iTail & (pBuf->cEntries - 1)];
+                if (pEntry->NanoTS < NanoTSOldest)
+                {
+                    NanoTSOldest = pEntry->NanoTS;
+                    pOldest      = pBuf;
+                }
+            }
+        if (!pOldest)
+            break;
+
+        rtlogBinFormatEntryLocked(pLogger, pOldest, &pOldest->aEntries[pOldest->iTail & (pOldest->cEntries - 1)]);
+        ASMAtomicWriteU32(&pOldest->iTail, pOldest->iTail + 1);
+    }
+
+    /*
+     * Report drops and free the buffers of threads that have terminated.
+     */
+    PRTLOGBINBUF *ppPrev = &pInt->pBinBufHead;
+    while ((pBuf = *ppPrev) != NULL)
+    {
+        uint64_t cDropped = ASMAtomicXchgU64(&pBuf->cDropped, 0);
+        if (cDropped)
+            rtlogLoggerExFLocked(pLogger, 0, ~0U, "RTLogBin: Dropped %RU64 records from thread %p.\n",
+                                 cDropped, (void *)pBuf->hNativeThread);
+        if (   ASMAtomicReadBool(&pBuf->fOrphaned)
+            && pBuf->iTail == ASMAtomicReadU32(&pBuf->Prod.iHead))
+        {
+            *ppPrev = pBuf->pNext;
+            RTMemFree(pBuf);
+        }
+        else
+            ppPrev = &pBuf->pNext;
+    }
+}
+
+
+/**
+ * The binary log flusher thread.
+ *
+ * @returns VINF_SUCCESS.
+ * @param   hThreadSelf     The thread handle.
+ * @param   pvUser          The logger instance.
+ */
+static DECLCALLBACK(int) rtlogBinFlushThread(RTTHREAD hThreadSelf, void *pvUser)
+{
+    PRTLOGGER         pLogger = (PRTLOGGER)pvUser;
+    PRTLOGGERINTERNAL pInt    = pLogger->pInt;
+    RT_NOREF(hThreadSelf);
+
+    while (!ASMAtomicReadBool(&pInt->fBinFlushShutdown))
+    {
+        RTSemEventWait(pInt->hBinFlushEvt, pInt->cMsBinFlushInterval);
+        if (RT_SUCCESS(rtlogLock(pLogger)))
+        {
+            rtlogBinDrainLocked(pLogger);
+            rtlogFlush(pLogger, false /*fNeedSpace*/);
+            rtlogUnlock(pLogger);
+        }
+    }
+    return VINF_SUCCESS;
+}
+
+
+/**
+ * Stops the flusher thread and frees all binary log buffers.
+ *
+ * The remaining records are written to the log.  Caller must not own the lock.
+ *
+ * @param   pLogger     The logger instance.
+ */
+static void rtlogBinTerm(PRTLOGGER pLogger)
+{
+    PRTLOGGERINTERNAL pInt = pLogger->pInt;
+    RTTLS const       iTls = pInt->iBinTls;
+    if (iTls == NIL_RTTLS)
+        return;
+
+    /* Stop new records from going into the buffers before freeing them, and
+       free the TLS index first so the destructor can't touch them either. */
+    pInt->iBinTls = NIL_RTTLS;
+    ASMCompilerBarrier();
+    RTTlsFree(iTls);
+
+    if (pInt->hBinFlushThread != NIL_RTTHREAD)
+    {
+        ASMAtomicWriteBool(&pInt->fBinFlushShutdown, true);
+        RTSemEventSignal(pInt->hBinFlushEvt);
+        int rc = RTThreadWait(pInt->hBinFlushThread, 30000, NULL);
+        AssertRC(rc);
+        pInt->hBinFlushThread = NIL_RTTHREAD;
+    }
+    if (pInt->hBinFlushEvt != NIL_RTSEMEVENT)
+    {
+        RTSemEventDestroy(pInt->hBinFlushEvt);
+        pInt->hBinFlushEvt = NIL_RTSEMEVENT;
+    }
+
+    if (RT_SUCCESS(rtlogLock(pLogger)))
+    {
+        rtlogBinDrainLocked(pLogger);
+        PRTLOGBINBUF pBuf = pInt->pBinBufHead;
+        pInt->pBinBufHead = NULL;
+        while (pBuf)
+        {
+            PRTLOGBINBUF pNext = pBuf->pNext;
+            RTMemFree(pBuf);
+            pBuf = pNext;
+        }
+        rtlogUnlock(pLogger);
+    }
+}
+
+
+RTDECL(int) RTLogBinEnable(PRTLOGGER pLogger, uint32_t cEntriesPerThread, RTMSINTERVAL cMsFlushInterval)
+{
+    /*
+     * Resolve the logger instance.
+     */
+    if (!pLogger)
+    {
+        pLogger = RTLogDefaultInstance();
+        if (!pLogger)
+            return VERR_NOT_FOUND;
+    }
+    AssertReturn(pLogger->u32Magic == RTLOGGER_MAGIC, VERR_INVALID_MAGIC);
+    PRTLOGGERINTERNAL pInt = pLogger->pInt;
+    AssertReturn(pInt->iBinTls == NIL_RTTLS, VERR_WRONG_ORDER);
+
+    if (!cEntriesPerThread)
+        cEntriesPerThread = RTLOG_BIN_DEF_ENTRIES;
+    AssertMsgReturn(cEntriesPerThread >= RTLOG_BIN_MIN_ENTRIES && cEntriesPerThread <= RTLOG_BIN_MAX_ENTRIES,
+                    ("%#x\n", cEntriesPerThread), VERR_OUT_OF_RANGE);
+    AssertMsgReturn(RT_IS_POWER_OF_TWO(cEntriesPerThread), ("%#x\n", cEntriesPerThread), VERR_INVALID_PARAMETER);
+
+    /*
+     * Set up the flusher before publishing the TLS index.
+     */
+    pInt->cBinEntries         = cEntriesPerThread;
+    pInt->cMsBinFlushInterval = cMsFlushInterval;
+    pInt->fBinFlushShutdown   = false;
+
+    RTTLS iTls;
+    int rc = RTTlsAllocEx(&iTls, rtlogBinTlsDtor);
+    if (rc == VERR_NOT_SUPPORTED)
+    {
+        iTls = RTTlsAlloc();
+        rc = iTls != NIL_RTTLS ? VINF_SUCCESS : VERR_NO_MEMORY;
+    }
+    if (RT_FAILURE(rc))
+        return rc;
+
+    if (cMsFlushInterval != RT_INDEFINITE_WAIT)
+    {
+        rc = RTSemEventCreate(&pInt->hBinFlushEvt);
+        if (RT_SUCCESS(rc))
+        {
+            rc = RTThreadCreate(&pInt->hBinFlushThread, rtlogBinFlushThread, pLogger, 0 /*cbStack*/,
+                                RTTHREADTYPE_DEFAULT, RTTHREADFLAGS_WAITABLE, "LogBinFlush");
+            if (RT_FAILURE(rc))
+            {
+                RTSemEventDestroy(pInt->hBinFlushEvt);
+                pInt->hBinFlushEvt = NIL_RTSEMEVENT;
+            }
+        }
+        if (RT_FAILURE(rc))
+        {
+            RTTlsFree(iTls);
+            return rc;
+        }
+    }
+
+    ASMCompilerBarrier();
+    pInt->iBinTls = iTls;
+    return VINF_SUCCESS;
+}
+RT_EXPORT_SYMBOL(RTLogBinEnable);
+
+
+RTDECL(void) RTLogBinLoggerEx(PRTLOGGER pLogger, unsigned fFlags, unsigned iGroup, const char *pszFormat, uint32_t fArgTypes, ...)
+{
+    va_list va;
+
+    /*
+     * A NULL logger means default instance.
+     */
+    if (!pLogger)
+    {
+        pLogger = RTLogDefaultInstance();
+        if (!pLogger)
+            return;
+    }
+
+    /*
+     * Same filtering as RTLogLoggerExV.
+     */
+    if (iGroup != ~0U && iGroup >= pLogger->cGroups)
+        iGroup = 0;
+    if (    (pLogger->fFlags & RTLOGFLAGS_DISABLED)
+        || !pLogger->fDestFlags
+        || !pszFormat || !*pszFormat)
+        return;
+    if (    iGroup != ~0U
+        &&  (pLogger->afGroups[iGroup] & (fFlags | RTLOGGRPFLAGS_ENABLED)) != (fFlags | RTLOGGRPFLAGS_ENABLED))
+        return;
+    AssertMsgReturnVoid(!(fArgTypes >> (RTLOG_BIN_MAX_ARGS * RTLOGBINARG_SHIFT)), ("%#x\n", fArgTypes));
+
+    /*
+     * Get the calling thread's buffer, falling back on the regular
+     * (locked and formatting) path if binary logging isn't enabled.
+     */
+    PRTLOGGERINTERNAL pInt = pLogger->pInt;
+    RTTLS const       iTls = pInt->iBinTls;
+    PRTLOGBINBUF      pBuf = iTls != NIL_RTTLS ? (PRTLOGBINBUF)RTTlsGet(iTls) : NULL;
+    if (RT_UNLIKELY(!pBuf))
+    {
+        if (iTls != NIL_RTTLS)
+            pBuf = rtlogBinAllocThreadBuf(pLogger);
+        if (!pBuf)
+        {
+            va_start(va, fArgTypes);
+            RTLogLoggerExV(pLogger, fFlags, iGroup, pszFormat, va);
+            va_end(va);
+            return;
+        }
+    }
+
+    /*
+     * Single producer, single consumer ring.  We're the only writer of iHead.
+     */
+    uint32_t const iHead = pBuf->Prod.iHead;
+    uint32_t const cUsed = iHead - ASMAtomicReadU32(&pBuf->iTail);
+    if (RT_UNLIKELY(cUsed >= pBuf->cEntries))
+    {
+        ASMAtomicIncU64(&pBuf->cDropped);
+        return;
+    }
+
+    PRTLOGBINENTRY pEntry = &pBuf->aEntries[iHead & (pBuf->cEntries - 1)];
+    pEntry->NanoTS    = RTTimeNanoTS();
+    pEntry->pszFormat = pszFormat;
+    pEntry->fFlags    = (uint16_t)fFlags;
+    pEntry->iGroup    = iGroup == ~0U ? UINT16_MAX : (uint16_t)iGroup;
+    pEntry->fArgTypes = fArgTypes;
+    va_start(va, fArgTypes);
+    for (uint32_t iArg = 0; iArg < RT_ELEMENTS(pEntry->au64Args); iArg++)
+    {
+        switch ((fArgTypes >> (iArg * RTLOGBINARG_SHIFT)) & RTLOGBINARG_MASK)
+        {
+            case RTLOGBINARG_END:   pEntry->au64Args[iArg] = 0; continue;
+            case RTLOGBINARG_U32:   pEntry->au64Args[iArg] = va_arg(va, uint32_t); continue;
+            case RTLOGBINARG_U64:   pEntry->au64Args[iArg] = va_arg(va, uint64_t); continue;
+            case RTLOGBINARG_PTR:   pEntry->au64Args[iArg] = (uintptr_t)va_arg(va, void *); continue;
+            default:
+                AssertMsgFailed(("%#x\n", fArgTypes));
+                pEntry->au64Args[iArg] = 0;
+                continue;
+        }
+    }
+    va_end(va);
+    ASMAtomicWriteU32(&pBuf->Prod.iHead, iHead + 1);
+
+    /* Kick the flusher when the ring is getting full. */
+    if (   cUsed + 1 == pBuf->cEntries - pBuf->cEntries / 4
+        && pInt->hBinFlushEvt != NIL_RTSEMEVENT)
+        RTSemEventSignal(pInt->hBinFlushEvt);
+}
+RT_EXPORT_SYMBOL(RTLogBinLoggerEx);
 #endif
 
 #ifndef IN_RC
@@ -2611,6 +3214,9 @@ RTDECL(void) RTLogFlush(PRTLOGGER pLogger)
     if (   pLogger->offScratch
 #ifndef IN_RC
         || (pLogger->fDestFlags & RTLOGDEST_RINGBUF)
+#endif
+#ifdef IN_RING3
+        || pLogger->pInt->pBinBufHead
 #endif
        )
     {
@@ -2622,6 +3228,14 @@ RTDECL(void) RTLogFlush(PRTLOGGER pLogger)
         if (RT_FAILURE(rc))
             return;
 #endif
+#ifdef IN_RING3
+        /*
+         * Format any pending binary records.
+         */
+        if (pLogger->pInt->pBinBufHead)
+            rtlogBinDrainLocked(pLogger);
+#endif
+
         /*
          * Call worker.
          */
@@ -2955,13 +3569,7 @@ RTDECL(void) RTLogLoggerExV(PRTLOGGER pLogger, unsigned fFlags, unsigned iGroup,
         else
         {
             rtlogLoggerExVLocked(pLogger, fFlags, iGroup, pszFormat, args);
-            if (   pLogger->pInt->papszGroups
-                && pLogger->pInt->papszGroups[iGroup])
-                rtlogLoggerExFLocked(pLogger, fFlags, iGroup, "%u messages from group %s (#%u), muting it.\n",
-                                     cEntries, pLogger->pInt->papszGroups[iGroup], iGroup);
-            else
-                rtlogLoggerExFLocked(pLogger, fFlags, iGroup, "%u messages from group #%u, muting it.\n",
-                                     cEntries, iGroup);
+            rtlogMuteGroupLocked(pLogger, fFlags, iGroup, cEntries);
         }
     }
     else
@@ -3798,7 +4406,8 @@ static DECLCALLBACK(size_t) rtLogOutputPrefixed(void *pv, const char *pachChars,
                 if (pLogger->fFlags & RTLOGFLAGS_PREFIX_TID)
                 {
 #ifndef IN_RC
-                    RTNATIVETHREAD Thread = RTThreadNativeSelf();
+                    RTNATIVETHREAD Thread = pArgs->hNativeThread != NIL_RTNATIVETHREAD
+                                          ? pArgs->hNativeThread : RTThreadNativeSelf();
 #else
                     RTNATIVETHREAD Thread = NIL_RTNATIVETHREAD;
 #endif
@@ -3810,7 +4419,7 @@ static DECLCALLBACK(size_t) rtLogOutputPrefixed(void *pv, const char *pachChars,
                 if (pLogger->fFlags & RTLOGFLAGS_PREFIX_THREAD)
                 {
 #ifdef IN_RING3
-                    const char *pszName = RTThreadSelfName();
+                    const char *pszName = pArgs->pszThreadName ? pArgs->pszThreadName : RTThreadSelfName();
 #elif defined IN_RC
                     const char *pszName = "EMT-RC";
 #else
@@ -4036,9 +4645,11 @@ static void rtlogLoggerExVLocked(PRTLOGGER pLogger, unsigned fFlags, unsigned iG
     if (pLogger->fFlags & (RTLOGFLAGS_PREFIX_MASK | RTLOGFLAGS_USECRLF))
     {
         RTLOGOUTPUTPREFIXEDARGS OutputArgs;
-        OutputArgs.pLogger = pLogger;
-        OutputArgs.iGroup  = iGroup;
-        OutputArgs.fFlags  = fFlags;
+        OutputArgs.pLogger       = pLogger;
+        OutputArgs.iGroup        = iGroup;
+        OutputArgs.fFlags        = fFlags;
+        OutputArgs.hNativeThread = NIL_RTNATIVETHREAD;
+        OutputArgs.pszThreadName = NULL;
         RTLogFormatV(rtLogOutputPrefixed, &OutputArgs, pszFormat, args);
     }
     else
@@ -4068,5 +4679,25 @@ static void rtlogLoggerExFLocked(PRTLOGGER pLogger, unsigned fFlags, unsigned iG
     rtlogLoggerExVLocked(pLogger, fFlags, iGroup, pszFormat, va);
     va_end(va);
 }
+
+
+/**
+ * Logs that a group hit the RTLOGFLAGS_RESTRICT_GROUPS limit and is muted.
+ *
+ * @param   pLogger     The logger.
+ * @param   fFlags      The logging flags.
+ * @param   iGroup      The group.
+ * @param   cEntries    The number of entries logged for the group.
+ */
+static void rtlogMuteGroupLocked(PRTLOGGER pLogger, unsigned fFlags, unsigned iGroup, uint32_t cEntries)
+{
+    if (   pLogger->pInt->papszGroups
+        && pLogger->pInt->papszGroups[iGroup])
+        rtlogLoggerExFLocked(pLogger, fFlags, iGroup, "%u messages from group %s (#%u), muting it.\n",
+                             cEntries, pLogger->pInt->papszGroups[iGroup], iGroup);
+    else
+        rtlogLoggerExFLocked(pLogger, fFlags, iGroup, "%u messages from group #%u, muting it.\n",
+                             cEntries, iGroup);
+}
 #endif /* !IN_RC */
 
@@ -0,0 +1,178 @@
+/* $Id$ */
+/** @file
+ * IPRT - Worker thread set.
+ */
+
+/*
+ * Copyright (C) 2017 Oracle Corporation
+ *
+ * This file is part of VirtualBox Open Source Edition (OSE), as
+ * available from http://www.virtualbox.org. This file is free software;
+ * you can redistribute it and/or modify it under the terms of the GNU
+ * General Public License (GPL) as published by the Free Software
+ * Foundation, in version 2 as it comes in the "COPYING" file of the
+ * VirtualBox OSE distribution. VirtualBox OSE is distributed in the
+ * hope that it will be useful, but WITHOUT ANY WARRANTY of any kind.
+ *
+ * The contents of this file may alternatively be used under the terms
+ * of the Common Development and Distribution License Version 1.0
+ * (CDDL) only, as it comes in the "COPYING.CDDL" file of the
+ * VirtualBox OSE distribution, in which case the provisions of the
+ * CDDL are applicable instead of those of the GPL.
+ *
+ * You may elect to license modified versions of this file under the
+ * terms and conditions of either the GPL or the CDDL or both.
+ */
+
+
+/*********************************************************************************************************************************
+*   Header Files                                                                                                                 *
+*********************************************************************************************************************************/
+#include "internal/iprt.h"
+#include "internal/workers.h"
+
+#include <iprt/assert.h>
+#include <iprt/critsect.h>
+#include <iprt/err.h>
+#include <iprt/semaphore.h>
+#include <iprt/thread.h>
+
+
+/**
+ * Initializes a worker thread set and starts the threads.
+ *
+ * Succeeds if at least one thread could be started.
+ *
+ * @returns IPRT status code.
+ * @param   pWorkers        The worker thread set, zeroed.
+ * @param   cThreads        The number of threads to start, at most
+ *                          RTWORKERS_MAX_THREADS.
+ * @param   pfnThread       The thread function.
+ * @param   pvUser          The thread function argument.
+ * @param   enmType         The thread type.
+ * @param   pszName         The thread name prefix, the index is appended.
+ */
+DECLHIDDEN(int) rtWorkersInit(PRTWORKERS pWorkers, uint32_t cThreads, PFNRTTHREAD pfnThread, void *pvUser,
+                              RTTHREADTYPE enmType, const char *pszName)
+{
+    AssertReturn(cThreads > 0 && cThreads <= RTWORKERS_MAX_THREADS, VERR_INVALID_PARAMETER);
+    pWorkers->fTerminate = false;
+    pWorkers->cThreads   = 0;
+
+    int rc = RTCritSectInit(&pWorkers->CritSect);
+    if (RT_SUCCESS(rc))
+    {
+        rc = RTSemEventMultiCreate(&pWorkers->hEvtWork);
+        if (RT_SUCCESS(rc))
+        {
+            rc = RTSemEventMultiCreate(&pWorkers->hEvtDone);
+            if (RT_SUCCESS(rc))
+            {
+                while (pWorkers->cThreads < cThreads)
+                {
+                    rc = RTThreadCreateF(&pWorkers->ahThreads[pWorkers->cThreads], pfnThread, pvUser, 0, enmType,
+                                         RTTHREADFLAGS_WAITABLE, "%s%u", pszName, pWorkers->cThreads);
+                    if (RT_FAILURE(rc))
+                        break;
+                    pWorkers->cThreads++;
+                }
+                if (pWorkers->cThreads > 0)
+                    return VINF_SUCCESS;
+                RTSemEventMultiDestroy(pWorkers->hEvtDone);
+            }
+            RTSemEventMultiDestroy(pWorkers->hEvtWork);
+        }
+        RTCritSectDelete(&pWorkers->CritSect);
+    }
+    return rc;
+}
+
+
+/**
+ * Tells the threads to terminate, waits for them and frees the resources.
+ *
+ * @param   pWorkers        The worker thread set.
+ */
+DECLHIDDEN(void) rtWorkersDelete(PRTWORKERS pWorkers)
+{
+    RTCritSectEnter(&pWorkers->CritSect);
+    pWorkers->fTerminate = true;
+    RTSemEventMultiSignal(pWorkers->hEvtWork);
+    RTCritSectLeave(&pWorkers->CritSect);
+
+    for (uint32_t i = 0; i < pWorkers->cThreads; i++)
+    {
+        int rc = RTThreadWait(pWorkers->ahThreads[i], RT_INDEFINITE_WAIT, NULL);
+        AssertRC(rc);
+    }
+    pWorkers->cThreads = 0;
+
+    RTSemEventMultiDestroy(pWorkers->hEvtDone);
+    pWorkers->hEvtDone = NIL_RTSEMEVENTMULTI;
+    RTSemEventMultiDestroy(pWorkers->hEvtWork);
+    pWorkers->hEvtWork = NIL_RTSEMEVENTMULTI;
+    RTCritSectDelete(&pWorkers->CritSect);
+}
+
+
+/**
+ * Called by a worker thread finding nothing to do, waits for more work or
+ * termination.
+ *
+ * The caller must recheck fTerminate and the queue afterwards.
+ *
+ * @param   pWorkers        The worker thread set.  Caller owns the lock.
+ */
+DECLHIDDEN(void) rtWorkersWaitForWork(PRTWORKERS pWorkers)
+{
+    Assert(RTCritSectIsOwner(&pWorkers->CritSect));
+    if (!pWorkers->fTerminate)
+    {
+        RTSemEventMultiReset(pWorkers->hEvtWork);
+        RTCritSectLeave(&pWorkers->CritSect);
+        RTSemEventMultiWait(pWorkers->hEvtWork, RT_INDEFINITE_WAIT);
+        RTCritSectEnter(&pWorkers->CritSect);
+    }
+}
+
+
+/**
+ * Wakes up the worker threads after queuing work.
+ *
+ * @param   pWorkers        The worker thread set.  Caller owns the lock.
+ */
+DECLHIDDEN(void) rtWorkersSignalWork(PRTWORKERS pWorkers)
+{
+    Assert(RTCritSectIsOwner(&pWorkers->CritSect));
+    RTSemEventMultiSignal(pWorkers->hEvtWork);
+}
+
+
+/**
+ * Waits for a worker thread to complete some work.
+ *
+ * The caller must recheck whatever it is waiting for afterwards.
+ *
+ * @param   pWorkers        The worker thread set.  Caller owns the lock.
+ */
+DECLHIDDEN(void) rtWorkersWaitForDone(PRTWORKERS pWorkers)
+{
+    Assert(RTCritSectIsOwner(&pWorkers->CritSect));
+    RTSemEventMultiReset(pWorkers->hEvtDone);
+    RTCritSectLeave(&pWorkers->CritSect);
+    RTSemEventMultiWait(pWorkers->hEvtDone, RT_INDEFINITE_WAIT);
+    RTCritSectEnter(&pWorkers->CritSect);
+}
+
+
+/**
+ * Called by a worker thread after completing some work.
+ *
+ * @param   pWorkers        The worker thread set.  Caller owns the lock.
+ */
+DECLHIDDEN(void) rtWorkersSignalDone(PRTWORKERS pWorkers)
+{
+    Assert(RTCritSectIsOwner(&pWorkers->CritSect));
+    RTSemEventMultiSignal(pWorkers->hEvtDone);
+}
+
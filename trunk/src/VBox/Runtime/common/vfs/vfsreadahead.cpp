@@ -104,6 +104,9 @@ typedef struct RTVFSREADAHEAD
 
     /** The current file position from the consumer point of view. */
     uint64_t                offConsumer;
+    /** Number of bytes returned to the consumer so far.  Updated atomically
+     * so it can be queried from other threads (RTVfsReadAheadQueryConsumed). */
+    uint64_t volatile       cbConsumed;
 
     /** The end-of-file(/stream) offset.  This is initially UINT64_MAX and later
      *  set when reading past EOF.  */
@@ -334,6 +337,8 @@ static DECLCALLBACK(int) rtVfsReadAhead_Read(void *pvThis, RTFOFF off, PCRTSGBUF
     if (fPokeReader && rc != VINF_EOF && rc != VERR_EOF)
         RTThreadUserSignal(pThis->hThread);
 
+    if (cbTotalRead)
+        ASMAtomicAddU64(&pThis->cbConsumed, cbTotalRead);
     if (pcbRead)
         *pcbRead = cbTotalRead;
     Assert(cbTotalRead <= pSgBuf->paSegs[0].cbSeg);
@@ -827,6 +832,21 @@ RTDECL(int) RTVfsCreateReadAheadForIoStream(RTVFSIOSTREAM hVfsIos, uint32_t fFla
 }
 
 
+RTDECL(int) RTVfsReadAheadQueryConsumed(RTVFSIOSTREAM hVfsIos, uint64_t *pcbConsumed)
+{
+    AssertPtrReturn(pcbConsumed, VERR_INVALID_POINTER);
+    *pcbConsumed = 0;
+
+    PRTVFSREADAHEAD pThis = (PRTVFSREADAHEAD)RTVfsIoStreamToPrivate(hVfsIos, &g_VfsReadAheadIosOps);
+    if (!pThis)
+        pThis = (PRTVFSREADAHEAD)RTVfsIoStreamToPrivate(hVfsIos, &g_VfsReadAheadFileOps.Stream);
+    AssertReturn(pThis, VERR_INVALID_HANDLE);
+
+    *pcbConsumed = ASMAtomicReadU64(&pThis->cbConsumed);
+    return VINF_SUCCESS;
+}
+
+
 RTDECL(int) RTVfsCreateReadAheadForFile(RTVFSFILE hVfsFile, uint32_t fFlags, uint32_t cBuffers, uint32_t cbBuffer,
                                         PRTVFSFILE phVfsFile)
 {
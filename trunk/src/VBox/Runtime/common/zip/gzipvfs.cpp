@@ -32,15 +32,21 @@
 #include <iprt/zip.h>
 
 #include <iprt/assert.h>
+#include <iprt/critsect.h>
 #include <iprt/ctype.h>
 #include <iprt/file.h>
 #include <iprt/err.h>
+#include <iprt/mem.h>
+#include <iprt/mp.h>
 #include <iprt/poll.h>
 #include <iprt/string.h>
+#include <iprt/thread.h>
 #include <iprt/vfslowlevel.h>
 
 #include <zlib.h>
 
+#include "internal/workers.h"
+
 #if defined(RT_OS_OS2) || defined(RT_OS_SOLARIS) || defined(RT_OS_WINDOWS)
 /**
  * Drag in the missing zlib symbols.
@@ -62,6 +68,9 @@ PFNRT g_apfnRTZlibDeps[] =
 *   Structures and Typedefs                                                                                                      *
 *********************************************************************************************************************************/
 #pragma pack(1)
+/**
+ * The gzip member header.
+ */
 typedef struct RTZIPGZIPHDR
 {
     /** RTZIPGZIPHDR_ID1. */
@@ -83,6 +92,8 @@ typedef struct RTZIPGZIPHDR
 } RTZIPGZIPHDR;
 #pragma pack()
 AssertCompileSize(RTZIPGZIPHDR, 10);
+/** Pointer to a gzip header. */
+typedef RTZIPGZIPHDR *PRTZIPGZIPHDR;
 /** Pointer to a const gzip header. */
 typedef RTZIPGZIPHDR const *PCRTZIPGZIPHDR;
 
@@ -134,6 +145,190 @@ typedef RTZIPGZIPHDR const *PCRTZIPGZIPHDR;
 #define RTZIPGZIPHDR_OS_UNKNOWN         UINT8_C(0xff)
 /** @}  */
 
+/** @name Extra field subfield ID of blocked members (RTZIPGZIPCOMP_F_BLOCKED).
+ * @{ */
+#define RTZIPGZIPHDR_XSUB_BLOCKED_ID1   UINT8_C(0x52) /* 'R' */
+#define RTZIPGZIPHDR_XSUB_BLOCKED_ID2   UINT8_C(0x54) /* 'T' */
+/** @}  */
+
+
+#pragma pack(1)
+/**
+ * The header of a blocked gzip member (RTZIPGZIPCOMP_F_BLOCKED).
+ *
+ * This is a regular gzip header with an extra field holding a single 'RT'
+ * subfield, which gives the member size so readers can skip from member to
+ * member without decompressing anything.  All fields are little endian.
+ */
+typedef struct RTZIPGZIPBLOCKHDR
+{
+    /** The gzip header, RTZIPGZIPHDR_FLG_EXTRA being the only flag set. */
+    RTZIPGZIPHDR    Hdr;
+    /** XLEN - The size of the extra field (12). */
+    uint16_t        cbExtra;
+    /** SI1 - RTZIPGZIPHDR_XSUB_BLOCKED_ID1. */
+    uint8_t         bSubId1;
+    /** SI2 - RTZIPGZIPHDR_XSUB_BLOCKED_ID2. */
+    uint8_t         bSubId2;
+    /** LEN - The size of the subfield data (8). */
+    uint16_t        cbSubField;
+    /** The size of the whole member, header and trailer included. */
+    uint32_t        cbMember;
+    /** The size of the uncompressed member data. */
+    uint32_t        cbData;
+} RTZIPGZIPBLOCKHDR;
+#pragma pack()
+AssertCompileSize(RTZIPGZIPBLOCKHDR, 24);
+/** Pointer to a blocked gzip member header. */
+typedef RTZIPGZIPBLOCKHDR *PRTZIPGZIPBLOCKHDR;
+/** Pointer to a const blocked gzip member header. */
+typedef RTZIPGZIPBLOCKHDR const *PCRTZIPGZIPBLOCKHDR;
+
+#pragma pack(1)
+/**
+ * The gzip member trailer.
+ */
+typedef struct RTZIPGZIPTRAILER
+{
+    /** CRC32 of the uncompressed data. */
+    uint32_t        uCrc32;
+    /** ISIZE - The uncompressed size modulo 2^32. */
+    uint32_t        cbData;
+} RTZIPGZIPTRAILER;
+#pragma pack()
+AssertCompileSize(RTZIPGZIPTRAILER, 8);
+/** Pointer to a gzip member trailer. */
+typedef RTZIPGZIPTRAILER *PRTZIPGZIPTRAILER;
+/** Pointer to a const gzip member trailer. */
+typedef RTZIPGZIPTRAILER const *PCRTZIPGZIPTRAILER;
+
+/** The amount of uncompressed data handed to a worker thread at a time. */
+#define RTZIPGZIP_PAR_BLOCK_SIZE        _1M
+/** The deflate window size, i.e. how much of the previous block is used as
+ * dictionary for the next one. */
+#define RTZIPGZIP_PAR_DICT_SIZE         _32K
+/** The max number of worker threads. */
+#define RTZIPGZIP_PAR_MAX_THREADS       16
+AssertCompile(RTZIPGZIP_PAR_MAX_THREADS <= RTWORKERS_MAX_THREADS);
+/** The max number of blocks in flight (two per thread). */
+#define RTZIPGZIP_PAR_MAX_JOBS          (RTZIPGZIP_PAR_MAX_THREADS * 2)
+/** The max uncompressed size of a blocked member we accept.  This is what the
+ * writer puts in one, anything bigger is left to the serial code so the jobs
+ * in flight can't be made to allocate more than a few MB each. */
+#define RTZIPGZIP_BLOCKED_MAX_DATA      RTZIPGZIP_PAR_BLOCK_SIZE
+/** The max size of a blocked member we accept, the deflateBound() of a full
+ * block (below 1/16 expansion at any level) plus header and trailer. */
+#define RTZIPGZIP_BLOCKED_MAX_MEMBER    (RTZIPGZIP_BLOCKED_MAX_DATA + RTZIPGZIP_BLOCKED_MAX_DATA / 16 + _4K)
+
+
+/**
+ * Parallel (de)compression job states.
+ */
+typedef enum RTZIPGZIPJOBSTATE
+{
+    /** Free, or being filled by the compressor. */
+    RTZIPGZIPJOBSTATE_FREE = 0,
+    /** Queued for a worker thread. */
+    RTZIPGZIPJOBSTATE_QUEUED,
+    /** Being processed by a worker thread. */
+    RTZIPGZIPJOBSTATE_BUSY,
+    /** Processed, the output is ready for the stream. */
+    RTZIPGZIPJOBSTATE_DONE
+} RTZIPGZIPJOBSTATE;
+
+/**
+ * A block of data being (de)compressed by a worker thread.
+ */
+typedef struct RTZIPGZIPJOB
+{
+    /** The job state. */
+    RTZIPGZIPJOBSTATE volatile enmState;
+    /** The status of the job (valid when done). */
+    int                 rc;
+    /** Set if this is the last block of the stream (compressor only). */
+    bool                fLast;
+    /** The size of the dictionary in pbDict (compressor only). */
+    uint32_t            cbDict;
+    /** The dictionary, i.e. the tail of the preceding data (compressor only). */
+    uint8_t            *pbDict;
+    /** The input buffer: uncompressed data or a whole gzip member. */
+    uint8_t            *pbIn;
+    /** The amount of input. */
+    size_t              cbIn;
+    /** The size of the input buffer. */
+    size_t              cbInAlloc;
+    /** The output buffer. */
+    uint8_t            *pbOut;
+    /** The amount of output. */
+    size_t              cbOut;
+    /** The size of the output buffer. */
+    size_t              cbOutAlloc;
+    /** How much of the output the stream has consumed (decompressor only). */
+    size_t              offOut;
+    /** The CRC32 of the uncompressed data (compressor only). */
+    uint32_t            uCrc32;
+} RTZIPGZIPJOB;
+/** Pointer to a parallel (de)compression job. */
+typedef RTZIPGZIPJOB *PRTZIPGZIPJOB;
+
+/**
+ * Parallel (de)compression state of a gzip I/O stream.
+ *
+ * The jobs form a ring which is processed in order by the stream owner,
+ * while the worker threads pick up queued jobs in any order.
+ */
+typedef struct RTZIPGZIPPAR
+{
+    /** The worker threads.  The lock protects the job states and the ring
+     * indexes, the done event is signalled when a job completes. */
+    RTWORKERS           Workers;
+    /** Set if decompressing, clear if compressing. */
+    bool                fDecompress;
+    /** Set if writing blocked members (compressor only). */
+    bool                fBlocked;
+    /** The compression level. */
+    uint8_t             uLevel;
+    /** The number of jobs in the ring. */
+    uint32_t            cJobs;
+    /** The oldest job in the ring, the next one to be output. */
+    uint32_t            iHead;
+    /** The number of jobs queued, being processed or done, starting at iHead. */
+    uint32_t            cPending;
+    /** The number of jobs submitted so far. */
+    uint64_t            cSubmitted;
+
+    /** @name Compressor
+     * @{ */
+    /** The CRC32 of the data written so far. */
+    uint32_t            uCrc32;
+    /** The size of the data written so far, modulo 2^32. */
+    uint32_t            cbTotal;
+    /** The size of the tail in abTail. */
+    uint32_t            cbTail;
+    /** The tail of the data submitted so far, the next block's dictionary. */
+    uint8_t             abTail[RTZIPGZIP_PAR_DICT_SIZE];
+    /** @} */
+
+    /** @name Decompressor
+     * @{ */
+    /** Set when there are no more blocked members to read. */
+    bool                fInputEnd;
+    /** Set if a regular gzip member follows, which is left to the serial code. */
+    bool                fForeign;
+    /** The input status to return once the ring is drained. */
+    int                 rcInput;
+    /** The number of bytes in NextHdr. */
+    size_t              cbNextHdr;
+    /** Member header that has been read but not processed yet. */
+    RTZIPGZIPBLOCKHDR   NextHdr;
+    /** @} */
+
+    /** The jobs. */
+    RTZIPGZIPJOB        aJobs[RTZIPGZIP_PAR_MAX_JOBS];
+} RTZIPGZIPPAR;
+/** Pointer to the parallel (de)compression state of a gzip I/O stream. */
+typedef RTZIPGZIPPAR *PRTZIPGZIPPAR;
+
 
 /**
  * The internal data of a GZIP I/O stream.
@@ -146,10 +341,19 @@ typedef struct RTZIPGZIPSTREAM
     bool                fDecompress;
     /** Set if zlib reported a fatal error. */
     bool                fFatalError;
-    /** Set if we've reached the end of the zlib stream. */
+    /** Set if we've reached the end of the zlib stream, or for the
+     * compressor, if RTZipGzipCompressFinish has completed it. */
     bool                fEndOfStream;
+    /** Set if the input has a gzip header and may thus consist of several
+     * members (decompressor only). */
+    bool                fGzipHdr;
+    /** Set if we've reached the end of a gzip member and must check whether
+     * another one follows (decompressor only). */
+    bool                fMemberEnd;
     /** The stream offset for pfnTell, always the uncompressed data. */
     RTFOFF              offStream;
+    /** The parallel (de)compression state, NULL if serial. */
+    PRTZIPGZIPPAR       pPar;
     /** The zlib stream.  */
     z_stream            Zlib;
     /** The data buffer.  */
@@ -169,6 +373,59 @@ typedef struct RTZIPGZIPSTREAM
 typedef RTZIPGZIPSTREAM *PRTZIPGZIPSTREAM;
 
 
+/**
+ * Member index entry of a blocked gzip file.
+ */
+typedef struct RTZIPGZIPMEMBER
+{
+    /** The offset of the member in the gzip file. */
+    uint64_t            offMember;
+    /** The offset of the member data in the uncompressed file. */
+    uint64_t            offData;
+    /** The size of the member. */
+    uint32_t            cbMember;
+    /** The size of the uncompressed member data. */
+    uint32_t            cbData;
+} RTZIPGZIPMEMBER;
+/** Pointer to a member index entry. */
+typedef RTZIPGZIPMEMBER *PRTZIPGZIPMEMBER;
+/** Pointer to a const member index entry. */
+typedef RTZIPGZIPMEMBER const *PCRTZIPGZIPMEMBER;
+
+/**
+ * The internal data of a random access blocked gzip file.
+ */
+typedef struct RTZIPGZIPFILE
+{
+    /** The gzip file. */
+    RTVFSFILE           hVfsFile;
+    /** The current file position (uncompressed). */
+    uint64_t            offFile;
+    /** The uncompressed file size. */
+    uint64_t            cbFile;
+    /** The number of (non-empty) members. */
+    uint32_t            cMembers;
+    /** The member index, sorted by offset. */
+    PRTZIPGZIPMEMBER    paMembers;
+    /** The member in the cache, UINT32_MAX if none. */
+    uint32_t            iCachedMember;
+    /** The uncompressed data of iCachedMember. */
+    uint8_t            *pbCache;
+    /** The size of the pbCache allocation. */
+    size_t              cbCacheAlloc;
+    /** Buffer for reading members. */
+    uint8_t            *pbMember;
+    /** The size of the pbMember allocation. */
+    size_t              cbMemberAlloc;
+    /** Set if Zlib has been initialized. */
+    bool                fZlibInitialized;
+    /** The raw inflate stream. */
+    z_stream            Zlib;
+} RTZIPGZIPFILE;
+/** Pointer to the internal data of a random access blocked gzip file. */
+typedef RTZIPGZIPFILE *PRTZIPGZIPFILE;
+
+
 /*********************************************************************************************************************************
 *   Internal Functions                                                                                                           *
 *********************************************************************************************************************************/
@@ -222,6 +479,671 @@ static int rtZipGzipConvertErrFromZlib(PRTZIPGZIPSTREAM pThis, int rc)
 }
 
 
+/**
+ * Makes sure a buffer is at least the given size, not preserving the content.
+ *
+ * @returns IPRT status code.
+ * @param   ppb             Pointer to the buffer pointer.
+ * @param   pcbAlloc        Pointer to the buffer size.
+ * @param   cbNeeded        The required size.
+ */
+static int rtZipGzipEnsureBuffer(uint8_t **ppb, size_t *pcbAlloc, size_t cbNeeded)
+{
+    if (*pcbAlloc >= cbNeeded)
+        return VINF_SUCCESS;
+    RTMemFree(*ppb);
+    *ppb = (uint8_t *)RTMemAlloc(cbNeeded);
+    if (*ppb)
+    {
+        *pcbAlloc = cbNeeded;
+        return VINF_SUCCESS;
+    }
+    *pcbAlloc = 0;
+    return VERR_NO_MEMORY;
+}
+
+
+/**
+ * Initializes a gzip header the way we write them.
+ *
+ * @param   pHdr            The header to initialize.
+ * @param   uLevel          The compression level.
+ */
+static void rtZipGzipInitHdr(PRTZIPGZIPHDR pHdr, uint8_t uLevel)
+{
+    pHdr->bId1               = RTZIPGZIPHDR_ID1;
+    pHdr->bId2               = RTZIPGZIPHDR_ID2;
+    pHdr->bCompressionMethod = RTZIPGZIPHDR_CM_DEFLATE;
+    pHdr->fFlags             = 0;
+    pHdr->u32ModTime         = 0;
+    pHdr->bXtraFlags         = uLevel >= 9 ? RTZIPGZIPHDR_XFL_DEFLATE_MAX : uLevel == 1 ? RTZIPGZIPHDR_XFL_DEFLATE_FASTEST : 0;
+#ifdef RT_OS_WINDOWS
+    pHdr->bOS                = RTZIPGZIPHDR_OS_NTFS;
+#else
+    pHdr->bOS                = RTZIPGZIPHDR_OS_UNIX;
+#endif
+}
+
+
+/**
+ * Checks if the given header is that of a blocked member we can handle.
+ *
+ * @returns true if it is, false if not.
+ * @param   pHdr            The header to check.
+ */
+static bool rtZipGzipIsBlockHdr(PCRTZIPGZIPBLOCKHDR pHdr)
+{
+    uint32_t const cbMember = RT_LE2H_U32(pHdr->cbMember);
+    return pHdr->Hdr.bId1                == RTZIPGZIPHDR_ID1
+        && pHdr->Hdr.bId2                == RTZIPGZIPHDR_ID2
+        && pHdr->Hdr.bCompressionMethod  == RTZIPGZIPHDR_CM_DEFLATE
+        && pHdr->Hdr.fFlags              == RTZIPGZIPHDR_FLG_EXTRA
+        && RT_LE2H_U16(pHdr->cbExtra)    == sizeof(*pHdr) - RT_UOFFSETOF(RTZIPGZIPBLOCKHDR, bSubId1)
+        && pHdr->bSubId1                 == RTZIPGZIPHDR_XSUB_BLOCKED_ID1
+        && pHdr->bSubId2                 == RTZIPGZIPHDR_XSUB_BLOCKED_ID2
+        && RT_LE2H_U16(pHdr->cbSubField) == sizeof(*pHdr) - RT_UOFFSETOF(RTZIPGZIPBLOCKHDR, cbMember)
+        && cbMember                      >  sizeof(*pHdr) + sizeof(RTZIPGZIPTRAILER)
+        && cbMember                      <= RTZIPGZIP_BLOCKED_MAX_MEMBER
+        && RT_LE2H_U32(pHdr->cbData)     <= RTZIPGZIP_BLOCKED_MAX_DATA;
+}
+
+
+/**
+ * Decompresses a blocked member and checks its trailer.
+ *
+ * @returns IPRT status code.
+ * @param   pZlib           Raw inflate stream to use.
+ * @param   pbMember        The member, starting with a header which has been
+ *                          checked by rtZipGzipIsBlockHdr.
+ * @param   cbMember        The member size.
+ * @param   pbDst           Where to put the data.  Must have room for the
+ *                          uncompressed size given by the header and cannot
+ *                          be NULL.
+ */
+static int rtZipGzipInflateBlock(z_stream *pZlib, uint8_t const *pbMember, size_t cbMember, uint8_t *pbDst)
+{
+    PCRTZIPGZIPBLOCKHDR pHdr     = (PCRTZIPGZIPBLOCKHDR)pbMember;
+    PCRTZIPGZIPTRAILER  pTrailer = (PCRTZIPGZIPTRAILER)&pbMember[cbMember - sizeof(RTZIPGZIPTRAILER)];
+    uint32_t const      cbData   = RT_LE2H_U32(pHdr->cbData);
+    Assert(cbMember == RT_LE2H_U32(pHdr->cbMember));
+
+    int rcZlib = inflateReset(pZlib);
+    if (rcZlib != Z_OK)
+        return VERR_ZIP_ERROR;
+    pZlib->next_in   = (Bytef *)&pbMember[sizeof(*pHdr)];
+    pZlib->avail_in  = (uInt)(cbMember - sizeof(*pHdr) - sizeof(*pTrailer));
+    pZlib->next_out  = pbDst;
+    pZlib->avail_out = cbData;
+    rcZlib = inflate(pZlib, Z_FINISH);
+    if (   rcZlib != Z_STREAM_END
+        || pZlib->avail_in  != 0
+        || pZlib->avail_out != 0
+        || RT_LE2H_U32(pTrailer->cbData) != cbData
+        || RT_LE2H_U32(pTrailer->uCrc32) != crc32(0, pbDst, cbData))
+        return VERR_ZIP_CORRUPTED;
+    return VINF_SUCCESS;
+}
+
+
+/**
+ * Compresses a block on a worker thread.
+ *
+ * Regular blocks are compressed as raw deflate data ending with a sync flush
+ * (the last one with a final block instead), so the stream owner only needs to
+ * concatenate them between a gzip header and trailer.  Blocked members are
+ * complete gzip members.
+ *
+ * @returns IPRT status code.
+ * @param   pPar            The parallel compression state.
+ * @param   pZlib           The worker's raw deflate stream.
+ * @param   pJob            The job.
+ */
+static int rtZipGzipParDeflateJob(PRTZIPGZIPPAR pPar, z_stream *pZlib, PRTZIPGZIPJOB pJob)
+{
+    size_t const offData   = pPar->fBlocked ? sizeof(RTZIPGZIPBLOCKHDR) : 0;
+    size_t const cbTrailer = pPar->fBlocked ? sizeof(RTZIPGZIPTRAILER)  : 0;
+
+    int rcZlib = deflateReset(pZlib);
+    if (rcZlib == Z_OK && pJob->cbDict)
+        rcZlib = deflateSetDictionary(pZlib, pJob->pbDict, pJob->cbDict);
+    if (rcZlib != Z_OK)
+        return VERR_ZIP_ERROR;
+
+    /* The bound covers Z_FINISH, a sync flush adds a few bytes on top of it.
+       Should it still be too small the loop below grows the buffer. */
+    int rc = rtZipGzipEnsureBuffer(&pJob->pbOut, &pJob->cbOutAlloc,
+                                   offData + deflateBound(pZlib, (uLong)pJob->cbIn) + 16 + cbTrailer);
+    if (RT_FAILURE(rc))
+        return rc;
+
+    int const fFlush = pPar->fBlocked || pJob->fLast ? Z_FINISH : Z_SYNC_FLUSH;
+    pZlib->next_in   = pJob->pbIn;
+    pZlib->avail_in  = (uInt)pJob->cbIn;
+    pZlib->next_out  = &pJob->pbOut[offData];
+    pZlib->avail_out = (uInt)(pJob->cbOutAlloc - offData - cbTrailer);
+    for (;;)
+    {
+        rcZlib = deflate(pZlib, fFlush);
+        if (fFlush == Z_FINISH ? rcZlib == Z_STREAM_END : rcZlib == Z_OK && pZlib->avail_out > 0)
+            break;
+        if (rcZlib != Z_OK && rcZlib != Z_BUF_ERROR)
+            return VERR_ZIP_ERROR;
+
+        size_t const cbUsed = (size_t)(pZlib->next_out - pJob->pbOut);
+        size_t const cbNew  = pJob->cbOutAlloc + _64K;
+        uint8_t *pbNew = (uint8_t *)RTMemRealloc(pJob->pbOut, cbNew);
+        if (!pbNew)
+            return VERR_NO_MEMORY;
+        pJob->pbOut      = pbNew;
+        pJob->cbOutAlloc = cbNew;
+        pZlib->next_out  = &pbNew[cbUsed];
+        pZlib->avail_out = (uInt)(cbNew - cbUsed - cbTrailer);
+    }
+
+    pJob->uCrc32 = crc32(0, pJob->pbIn, (uInt)pJob->cbIn);
+    pJob->cbOut  = (size_t)(pZlib->next_out - pJob->pbOut);
+    if (pPar->fBlocked)
+    {
+        PRTZIPGZIPBLOCKHDR pHdr = (PRTZIPGZIPBLOCKHDR)pJob->pbOut;
+        rtZipGzipInitHdr(&pHdr->Hdr, pPar->uLevel);
+        pHdr->Hdr.fFlags = RTZIPGZIPHDR_FLG_EXTRA;
+        pHdr->cbExtra    = RT_H2LE_U16((uint16_t)(sizeof(*pHdr) - RT_UOFFSETOF(RTZIPGZIPBLOCKHDR, bSubId1)));
+        pHdr->bSubId1    = RTZIPGZIPHDR_XSUB_BLOCKED_ID1;
+        pHdr->bSubId2    = RTZIPGZIPHDR_XSUB_BLOCKED_ID2;
+        pHdr->cbSubField = RT_H2LE_U16((uint16_t)(sizeof(*pHdr) - RT_UOFFSETOF(RTZIPGZIPBLOCKHDR, cbMember)));
+        pHdr->cbMember   = RT_H2LE_U32((uint32_t)(pJob->cbOut + cbTrailer));
+        pHdr->cbData     = RT_H2LE_U32((uint32_t)pJob->cbIn);
+
+        PRTZIPGZIPTRAILER pTrailer = (PRTZIPGZIPTRAILER)&pJob->pbOut[pJob->cbOut];
+        pTrailer->uCrc32 = RT_H2LE_U32(pJob->uCrc32);
+        pTrailer->cbData = RT_H2LE_U32((uint32_t)pJob->cbIn);
+        pJob->cbOut     += cbTrailer;
+    }
+    return VINF_SUCCESS;
+}
+
+
+/**
+ * Decompresses a blocked member on a worker thread.
+ *
+ * @returns IPRT status code.
+ * @param   pZlib           The worker's raw inflate stream.
+ * @param   pJob            The job.
+ */
+static int rtZipGzipParInflateJob(z_stream *pZlib, PRTZIPGZIPJOB pJob)
+{
+    size_t const cbData = RT_LE2H_U32(((PCRTZIPGZIPBLOCKHDR)pJob->pbIn)->cbData);
+    pJob->cbOut  = 0;
+    pJob->offOut = 0;
+    int rc = rtZipGzipEnsureBuffer(&pJob->pbOut, &pJob->cbOutAlloc, RT_MAX(cbData, 1));
+    if (RT_SUCCESS(rc))
+    {
+        rc = rtZipGzipInflateBlock(pZlib, pJob->pbIn, pJob->cbIn, pJob->pbOut);
+        if (RT_SUCCESS(rc))
+            pJob->cbOut = cbData;
+    }
+    return rc;
+}
+
+
+/**
+ * @callback_method_impl{FNRTTHREAD, Parallel gzip (de)compression worker.}
+ */
+static DECLCALLBACK(int) rtZipGzipParThread(RTTHREAD hThreadSelf, void *pvUser)
+{
+    PRTZIPGZIPPAR pPar = (PRTZIPGZIPPAR)pvUser;
+    RT_NOREF(hThreadSelf);
+
+    z_stream Zlib;
+    RT_ZERO(Zlib);
+    int rcZlib;
+    if (pPar->fDecompress)
+        rcZlib = inflateInit2(&Zlib, -MAX_WBITS);
+    else
+        rcZlib = deflateInit2(&Zlib, pPar->uLevel, Z_DEFLATED, -MAX_WBITS, 8 /*memLevel*/, Z_DEFAULT_STRATEGY);
+
+    RTCritSectEnter(&pPar->Workers.CritSect);
+    while (!pPar->Workers.fTerminate)
+    {
+        /*
+         * Pick the queued job closest to the head of the ring.
+         */
+        PRTZIPGZIPJOB pJob = NULL;
+        for (uint32_t i = 0; i < pPar->cPending; i++)
+        {
+            PRTZIPGZIPJOB pCur = &pPar->aJobs[(pPar->iHead + i) % pPar->cJobs];
+            if (pCur->enmState == RTZIPGZIPJOBSTATE_QUEUED)
+            {
+                pJob = pCur;
+                break;
+            }
+        }
+        if (!pJob)
+        {
+            rtWorkersWaitForWork(&pPar->Workers);
+            continue;
+        }
+        pJob->enmState = RTZIPGZIPJOBSTATE_BUSY;
+        RTCritSectLeave(&pPar->Workers.CritSect);
+
+        int rc;
+        if (rcZlib != Z_OK)
+            rc = rcZlib == Z_MEM_ERROR ? VERR_ZIP_NO_MEMORY : VERR_ZIP_ERROR;
+        else if (pPar->fDecompress)
+            rc = rtZipGzipParInflateJob(&Zlib, pJob);
+        else
+            rc = rtZipGzipParDeflateJob(pPar, &Zlib, pJob);
+
+        RTCritSectEnter(&pPar->Workers.CritSect);
+        pJob->rc       = rc;
+        pJob->enmState = RTZIPGZIPJOBSTATE_DONE;
+        rtWorkersSignalDone(&pPar->Workers);
+    }
+    RTCritSectLeave(&pPar->Workers.CritSect);
+
+    if (rcZlib == Z_OK)
+    {
+        if (pPar->fDecompress)
+            inflateEnd(&Zlib);
+        else
+            deflateEnd(&Zlib);
+    }
+    return VINF_SUCCESS;
+}
+
+
+/**
+ * Destroys the parallel (de)compression state.
+ *
+ * @param   pPar            The parallel (de)compression state.
+ */
+static void rtZipGzipParDestroy(PRTZIPGZIPPAR pPar)
+{
+    rtWorkersDelete(&pPar->Workers);
+
+    for (uint32_t i = 0; i < RT_ELEMENTS(pPar->aJobs); i++)
+    {
+        RTMemFree(pPar->aJobs[i].pbDict);
+        RTMemFree(pPar->aJobs[i].pbIn);
+        RTMemFree(pPar->aJobs[i].pbOut);
+    }
+    RTMemFree(pPar);
+}
+
+
+/**
+ * Creates the parallel (de)compression state of a gzip I/O stream.
+ *
+ * @returns IPRT status code.
+ * @param   pThis           The gzip I/O stream instance data.
+ * @param   fBlocked        Whether to write blocked members (compressor).
+ * @param   uLevel          The compression level (compressor).
+ */
+static int rtZipGzipParCreate(PRTZIPGZIPSTREAM pThis, bool fBlocked, uint8_t uLevel)
+{
+    PRTZIPGZIPPAR pPar = (PRTZIPGZIPPAR)RTMemAllocZ(sizeof(*pPar));
+    if (!pPar)
+        return VERR_NO_MEMORY;
+    pPar->fDecompress = pThis->fDecompress;
+    pPar->fBlocked    = fBlocked;
+    pPar->uLevel      = uLevel;
+
+    /* Even a single worker helps, as it overlaps with the I/O done by the stream owner. */
+    uint32_t const cThreads = RT_MIN(RT_MAX(RTMpGetOnlineCount(), 1), RTZIPGZIP_PAR_MAX_THREADS);
+    int rc = rtWorkersInit(&pPar->Workers, cThreads, rtZipGzipParThread, pPar, RTTHREADTYPE_DEFAULT, "gzip");
+    if (RT_SUCCESS(rc))
+    {
+        pPar->cJobs = pPar->Workers.cThreads * 2;
+        pThis->pPar = pPar;
+        return VINF_SUCCESS;
+    }
+    RTMemFree(pPar);
+    return rc;
+}
+
+
+/**
+ * Queues a job for the worker threads, adding it to the tail of the ring.
+ *
+ * @param   pPar            The parallel (de)compression state.
+ * @param   pJob            The job, must be at the tail of the ring.
+ */
+static void rtZipGzipParSubmit(PRTZIPGZIPPAR pPar, PRTZIPGZIPJOB pJob)
+{
+    Assert(pJob == &pPar->aJobs[(pPar->iHead + pPar->cPending) % pPar->cJobs]);
+    pJob->rc = VINF_SUCCESS;
+    RTCritSectEnter(&pPar->Workers.CritSect);
+    pJob->enmState = RTZIPGZIPJOBSTATE_QUEUED;
+    pPar->cPending++;
+    pPar->cSubmitted++;
+    rtWorkersSignalWork(&pPar->Workers);
+    RTCritSectLeave(&pPar->Workers.CritSect);
+}
+
+
+/**
+ * Checks if the job at the head of the ring is done, without waiting.
+ *
+ * @returns true if done, false if not or if the ring is empty.
+ * @param   pPar            The parallel (de)compression state.
+ */
+static bool rtZipGzipParIsHeadDone(PRTZIPGZIPPAR pPar)
+{
+    RTCritSectEnter(&pPar->Workers.CritSect);
+    bool const fDone = pPar->cPending > 0 && pPar->aJobs[pPar->iHead].enmState == RTZIPGZIPJOBSTATE_DONE;
+    RTCritSectLeave(&pPar->Workers.CritSect);
+    return fDone;
+}
+
+
+/**
+ * Waits for the job at the head of the ring to be done.
+ *
+ * @returns The head job.
+ * @param   pPar            The parallel (de)compression state.
+ */
+static PRTZIPGZIPJOB rtZipGzipParWaitForHead(PRTZIPGZIPPAR pPar)
+{
+    Assert(pPar->cPending > 0);
+    PRTZIPGZIPJOB pJob = &pPar->aJobs[pPar->iHead];
+    RTCritSectEnter(&pPar->Workers.CritSect);
+    while (pJob->enmState != RTZIPGZIPJOBSTATE_DONE)
+    {
+        rtWorkersWaitForDone(&pPar->Workers);
+    }
+    RTCritSectLeave(&pPar->Workers.CritSect);
+    return pJob;
+}
+
+
+/**
+ * Frees the job at the head of the ring after the stream has consumed it.
+ *
+ * @param   pPar            The parallel (de)compression state.
+ */
+static void rtZipGzipParRetireHead(PRTZIPGZIPPAR pPar)
+{
+    PRTZIPGZIPJOB pJob = &pPar->aJobs[pPar->iHead];
+    RTCritSectEnter(&pPar->Workers.CritSect);
+    Assert(pJob->enmState == RTZIPGZIPJOBSTATE_DONE);
+    pJob->enmState = RTZIPGZIPJOBSTATE_FREE;
+    pJob->cbIn     = 0;
+    pJob->cbOut    = 0;
+    pJob->offOut   = 0;
+    pPar->iHead    = (pPar->iHead + 1) % pPar->cJobs;
+    pPar->cPending--;
+    RTCritSectLeave(&pPar->Workers.CritSect);
+}
+
+
+/**
+ * Writes the output of the job at the head of the ring, waiting for it to
+ * complete if necessary.
+ *
+ * @returns IPRT status code.
+ * @param   pThis           The gzip I/O stream instance data.
+ */
+static int rtZipGzipParWriteHead(PRTZIPGZIPSTREAM pThis)
+{
+    PRTZIPGZIPPAR pPar = pThis->pPar;
+    PRTZIPGZIPJOB pJob = rtZipGzipParWaitForHead(pPar);
+    int rc = pJob->rc;
+    if (RT_SUCCESS(rc) && pJob->cbOut > 0)
+        rc = RTVfsIoStrmWrite(pThis->hVfsIos, pJob->pbOut, pJob->cbOut, true /*fBlocking*/, NULL /*pcbWritten*/);
+    if (RT_FAILURE(rc))
+    {
+        pThis->fFatalError = true;
+        return rc;
+    }
+
+    if (!pPar->fBlocked)
+    {
+        pPar->uCrc32   = crc32_combine(pPar->uCrc32, pJob->uCrc32, (z_off_t)pJob->cbIn);
+        pPar->cbTotal += (uint32_t)pJob->cbIn;
+    }
+    rtZipGzipParRetireHead(pPar);
+    return VINF_SUCCESS;
+}
+
+
+/**
+ * Gets the job the compressor is filling, i.e. the one at the tail of the
+ * ring, writing out the head of the ring first if it's full.
+ *
+ * @returns IPRT status code.
+ * @param   pThis           The gzip I/O stream instance data.
+ * @param   ppJob           Where to return the job.
+ */
+static int rtZipGzipParGetFillJob(PRTZIPGZIPSTREAM pThis, PRTZIPGZIPJOB *ppJob)
+{
+    PRTZIPGZIPPAR pPar = pThis->pPar;
+    while (pPar->cPending >= pPar->cJobs)
+    {
+        int rc = rtZipGzipParWriteHead(pThis);
+        if (RT_FAILURE(rc))
+            return rc;
+    }
+
+    PRTZIPGZIPJOB pJob = &pPar->aJobs[(pPar->iHead + pPar->cPending) % pPar->cJobs];
+    int rc = rtZipGzipEnsureBuffer(&pJob->pbIn, &pJob->cbInAlloc, RTZIPGZIP_PAR_BLOCK_SIZE);
+    if (RT_SUCCESS(rc))
+        *ppJob = pJob;
+    return rc;
+}
+
+
+/**
+ * Submits the job the compressor is filling.
+ *
+ * @returns IPRT status code.
+ * @param   pThis           The gzip I/O stream instance data.
+ * @param   fLast           Set if this is the end of the stream.
+ */
+static int rtZipGzipParSubmitFillJob(PRTZIPGZIPSTREAM pThis, bool fLast)
+{
+    PRTZIPGZIPPAR pPar = pThis->pPar;
+    PRTZIPGZIPJOB pJob;
+    int rc = rtZipGzipParGetFillJob(pThis, &pJob);
+    if (RT_FAILURE(rc))
+        return rc;
+
+    if (pPar->fBlocked)
+    {
+        /* An empty member is only needed when there is no data at all. */
+        if (!pJob->cbIn && pPar->cSubmitted > 0)
+            return VINF_SUCCESS;
+        pJob->cbDict = 0;
+    }
+    else
+    {
+        /*
+         * Prime the block with the tail of the preceding data, then update
+         * the tail for the next block.
+         */
+        if (!pJob->pbDict)
+        {
+            pJob->pbDict = (uint8_t *)RTMemAlloc(RTZIPGZIP_PAR_DICT_SIZE);
+            if (!pJob->pbDict)
+                return VERR_NO_MEMORY;
+        }
+        memcpy(pJob->pbDict, pPar->abTail, pPar->cbTail);
+        pJob->cbDict = pPar->cbTail;
+
+        if (pJob->cbIn >= RTZIPGZIP_PAR_DICT_SIZE)
+        {
+            memcpy(pPar->abTail, &pJob->pbIn[pJob->cbIn - RTZIPGZIP_PAR_DICT_SIZE], RTZIPGZIP_PAR_DICT_SIZE);
+            pPar->cbTail = RTZIPGZIP_PAR_DICT_SIZE;
+        }
+        else
+        {
+            uint32_t const cbKeep = RT_MIN(pPar->cbTail, RTZIPGZIP_PAR_DICT_SIZE - (uint32_t)pJob->cbIn);
+            memmove(pPar->abTail, &pPar->abTail[pPar->cbTail - cbKeep], cbKeep);
+            memcpy(&pPar->abTail[cbKeep], pJob->pbIn, pJob->cbIn);
+            pPar->cbTail = cbKeep + (uint32_t)pJob->cbIn;
+        }
+    }
+
+    pJob->fLast = fLast;
+    rtZipGzipParSubmit(pPar, pJob);
+
+    /* Write out whatever is ready, without waiting. */
+    while (rtZipGzipParIsHeadDone(pPar))
+    {
+        rc = rtZipGzipParWriteHead(pThis);
+        if (RT_FAILURE(rc))
+            return rc;
+    }
+    return VINF_SUCCESS;
+}
+
+
+/**
+ * Flushes the parallel compressor.
+ *
+ * @returns IPRT status code.
+ * @param   pThis           The gzip I/O stream instance data.
+ * @param   fFinish         Set when closing the stream, this ends the deflate
+ *                          stream and writes the gzip trailer.
+ */
+static int rtZipGzipParFlush(PRTZIPGZIPSTREAM pThis, bool fFinish)
+{
+    PRTZIPGZIPPAR pPar = pThis->pPar;
+    if (pThis->fFatalError)
+        return VERR_ZIP_ERROR;
+
+    /* Submit what we've got.  When finishing we need a final deflate block
+       even if there is no more data. */
+    PRTZIPGZIPJOB pJob;
+    int rc = rtZipGzipParGetFillJob(pThis, &pJob);
+    if (RT_SUCCESS(rc) && (pJob->cbIn > 0 || fFinish))
+        rc = rtZipGzipParSubmitFillJob(pThis, fFinish);
+
+    while (RT_SUCCESS(rc) && pPar->cPending > 0)
+        rc = rtZipGzipParWriteHead(pThis);
+
+    if (RT_SUCCESS(rc) && fFinish && !pPar->fBlocked)
+    {
+        RTZIPGZIPTRAILER Trailer;
+        Trailer.uCrc32 = RT_H2LE_U32(pPar->uCrc32);
+        Trailer.cbData = RT_H2LE_U32(pPar->cbTotal);
+        rc = RTVfsIoStrmWrite(pThis->hVfsIos, &Trailer, sizeof(Trailer), true /*fBlocking*/, NULL /*pcbWritten*/);
+        if (RT_FAILURE(rc))
+            pThis->fFatalError = true;
+    }
+    return rc;
+}
+
+
+/**
+ * Writes data to the parallel compressor.
+ *
+ * @returns IPRT status code.
+ * @param   pThis           The gzip I/O stream instance data.
+ * @param   pbSrc           The data to write.
+ * @param   cbToWrite       The number of bytes to write.
+ * @param   pcbWritten      Where to return the number of bytes written.
+ *                          Optional.
+ */
+static int rtZipGzipParWrite(PRTZIPGZIPSTREAM pThis, uint8_t const *pbSrc, size_t cbToWrite, size_t *pcbWritten)
+{
+    int    rc        = pThis->fFatalError ? VERR_ZIP_ERROR : VINF_SUCCESS;
+    size_t cbWritten = 0;
+    while (cbWritten < cbToWrite && RT_SUCCESS(rc))
+    {
+        PRTZIPGZIPJOB pJob;
+        rc = rtZipGzipParGetFillJob(pThis, &pJob);
+        if (RT_FAILURE(rc))
+            break;
+
+        size_t const cbThis = RT_MIN(cbToWrite - cbWritten, RTZIPGZIP_PAR_BLOCK_SIZE - pJob->cbIn);
+        memcpy(&pJob->pbIn[pJob->cbIn], &pbSrc[cbWritten], cbThis);
+        pJob->cbIn += cbThis;
+        cbWritten  += cbThis;
+
+        if (pJob->cbIn >= RTZIPGZIP_PAR_BLOCK_SIZE)
+            rc = rtZipGzipParSubmitFillJob(pThis, false /*fLast*/);
+    }
+
+    pThis->offStream += cbWritten;
+    if (pcbWritten)
+        *pcbWritten = cbWritten;
+    return rc;
+}
+
+
+/**
+ * Reads the next blocked member and queues it for decompression.
+ *
+ * This sets fInputEnd when there are no more blocked members to read, either
+ * because we've reached the end of the input or because something else
+ * follows.
+ *
+ * @param   pThis           The gzip I/O stream instance data.
+ */
+static void rtZipGzipParReadMember(PRTZIPGZIPSTREAM pThis)
+{
+    PRTZIPGZIPPAR pPar = pThis->pPar;
+    Assert(pPar->cPending < pPar->cJobs);
+
+    RTZIPGZIPBLOCKHDR Hdr;
+    size_t            cbHdr = pPar->cbNextHdr;
+    if (cbHdr)
+    {
+        Hdr = pPar->NextHdr;
+        pPar->cbNextHdr = 0;
+    }
+    else
+    {
+        int rc = RTVfsIoStrmRead(pThis->hVfsIos, &Hdr, sizeof(Hdr), true /*fBlocking*/, &cbHdr);
+        if (RT_FAILURE(rc))
+        {
+            pPar->rcInput   = rc;
+            pPar->fInputEnd = true;
+            return;
+        }
+    }
+
+    if (cbHdr == sizeof(Hdr) && rtZipGzipIsBlockHdr(&Hdr))
+    {
+        PRTZIPGZIPJOB pJob     = &pPar->aJobs[(pPar->iHead + pPar->cPending) % pPar->cJobs];
+        size_t const  cbMember = RT_LE2H_U32(Hdr.cbMember);
+        int rc = rtZipGzipEnsureBuffer(&pJob->pbIn, &pJob->cbInAlloc, cbMember);
+        if (RT_SUCCESS(rc))
+        {
+            memcpy(pJob->pbIn, &Hdr, sizeof(Hdr));
+            rc = RTVfsIoStrmRead(pThis->hVfsIos, &pJob->pbIn[sizeof(Hdr)], cbMember - sizeof(Hdr),
+                                 true /*fBlocking*/, NULL /*pcbRead*/);
+            if (rc == VERR_EOF)
+                rc = VERR_ZIP_CORRUPTED;
+        }
+        if (RT_SUCCESS(rc))
+        {
+            pJob->cbIn = cbMember;
+            rtZipGzipParSubmit(pPar, pJob);
+        }
+        else
+        {
+            pPar->rcInput   = rc;
+            pPar->fInputEnd = true;
+        }
+    }
+    else
+    {
+        /* Leave regular gzip members to the serial code and ignore trailing
+           garbage like gzip(1) does. */
+        pPar->fInputEnd = true;
+        if (   cbHdr >= 2
+            && Hdr.Hdr.bId1 == RTZIPGZIPHDR_ID1
+            && Hdr.Hdr.bId2 == RTZIPGZIPHDR_ID2)
+        {
+            pPar->NextHdr   = Hdr;
+            pPar->cbNextHdr = cbHdr;
+            pPar->fForeign  = true;
+        }
+    }
+}
+
+
 /**
  * @interface_method_impl{RTVFSOBJOPS,pfnClose}
  */
@@ -235,12 +1157,21 @@ static DECLCALLBACK(int) rtZipGzip_Close(void *pvThis)
         rc = inflateEnd(&pThis->Zlib);
         if (rc != Z_OK)
             rc = rtZipGzipConvertErrFromZlib(pThis, rc);
+        if (pThis->pPar)
+            rtZipGzipParDestroy(pThis->pPar);
+    }
+    else if (pThis->pPar)
+    {
+        rc = VINF_SUCCESS;
+        if (!pThis->fFatalError && !pThis->fEndOfStream)
+            rc = rtZipGzipParFlush(pThis, true /*fFinish*/);
+        rtZipGzipParDestroy(pThis->pPar);
     }
     else
     {
         /* Flush the compression stream before terminating it. */
         rc = VINF_SUCCESS;
-        if (!pThis->fFatalError)
+        if (!pThis->fFatalError && !pThis->fEndOfStream)
             rc = rtZipGzip_FlushIt(pThis, Z_FINISH);
 
         int rc2 = deflateEnd(&pThis->Zlib);
@@ -248,6 +1179,7 @@ static DECLCALLBACK(int) rtZipGzip_Close(void *pvThis)
             rc = rtZipGzipConvertErrFromZlib(pThis, rc);
     }
 
+    pThis->pPar = NULL;
     RTVfsIoStrmRelease(pThis->hVfsIos);
     pThis->hVfsIos = NIL_RTVFSIOSTREAM;
     RTStrFree(pThis->pszOrgName);
@@ -269,6 +1201,64 @@ static DECLCALLBACK(int) rtZipGzip_QueryInfo(void *pvThis, PRTFSOBJINFO pObjInfo
 }
 
 
+/**
+ * Checks if another gzip member follows the one we just finished.
+ *
+ * This either prepares zlib for the next member or sets fEndOfStream.
+ *
+ * @returns IPRT status code, VINF_TRY_AGAIN if non-blocking and no input
+ *          is available yet.
+ * @param   pThis           The gzip I/O stream instance data.
+ * @param   fBlocking       Whether to block or not.
+ */
+static int rtZipGzipNextMember(PRTZIPGZIPSTREAM pThis, bool fBlocking)
+{
+    Assert(pThis->fMemberEnd);
+
+    /* We need the two ID bytes to decide. */
+    while (pThis->Zlib.avail_in < 2)
+    {
+        size_t const cbLeft = pThis->Zlib.avail_in;
+        if (cbLeft)
+            pThis->abBuffer[0] = *pThis->Zlib.next_in;
+        pThis->Zlib.next_in = &pThis->abBuffer[0];
+
+        pThis->SgSeg.pvSeg = &pThis->abBuffer[cbLeft];
+        pThis->SgSeg.cbSeg = sizeof(pThis->abBuffer) - cbLeft;
+        RTSgBufReset(&pThis->SgBuf);
+        size_t cbReadIn = 0;
+        int rc = RTVfsIoStrmSgRead(pThis->hVfsIos, -1 /*off*/, &pThis->SgBuf, fBlocking, &cbReadIn);
+        pThis->SgSeg.pvSeg = &pThis->abBuffer[0];
+        pThis->SgSeg.cbSeg = sizeof(pThis->abBuffer);
+        RTSgBufReset(&pThis->SgBuf);
+
+        if (rc == VERR_INTERRUPTED)
+            continue;
+        if (RT_FAILURE(rc) || rc == VINF_TRY_AGAIN)
+            return rc;
+        pThis->Zlib.avail_in = (uInt)(cbLeft + cbReadIn);
+        if (!cbReadIn)
+        {
+            pThis->fEndOfStream = true;
+            return VINF_SUCCESS;
+        }
+    }
+
+    /* Like gzip(1) we ignore trailing garbage. */
+    if (   pThis->Zlib.next_in[0] == RTZIPGZIPHDR_ID1
+        && pThis->Zlib.next_in[1] == RTZIPGZIPHDR_ID2)
+    {
+        int rcZlib = inflateReset(&pThis->Zlib);
+        if (rcZlib != Z_OK)
+            return rtZipGzipConvertErrFromZlib(pThis, rcZlib);
+        pThis->fMemberEnd = false;
+    }
+    else
+        pThis->fEndOfStream = true;
+    return VINF_SUCCESS;
+}
+
+
 /**
  * Reads one segment.
  *
@@ -303,6 +1293,24 @@ static int rtZipGzip_ReadOneSeg(PRTZIPGZIPSTREAM pThis, void *pvBuf, size_t cbTo
     while (   pThis->Zlib.avail_out > 0
            || pThis->Zlib.avail_in == 0 /* greedy */)
     {
+        /*
+         * Start on the next member?
+         */
+        if (pThis->fMemberEnd)
+        {
+            rc = rtZipGzipNextMember(pThis, fBlocking);
+            if (rc != VINF_SUCCESS)
+                break;
+            if (pThis->fEndOfStream)
+            {
+                if (pThis->Zlib.avail_out == 0)
+                    rc = VINF_SUCCESS;
+                else
+                    rc = pcbRead ? VINF_EOF : VERR_EOF;
+                break;
+            }
+        }
+
         /*
          * Read more input?
          *
@@ -344,6 +1352,15 @@ static int rtZipGzip_ReadOneSeg(PRTZIPGZIPSTREAM pThis, void *pvBuf, size_t cbTo
         {
             if (rc == Z_STREAM_END)
             {
+                /* Another gzip member may follow (RFC 1952, 2.2). */
+                if (pThis->fGzipHdr)
+                {
+                    pThis->fMemberEnd = true;
+                    rc = VINF_SUCCESS;
+                    if (pThis->Zlib.avail_out > 0)
+                        continue;
+                    break;
+                }
                 pThis->fEndOfStream = true;
                 if (pThis->Zlib.avail_out == 0)
                     rc = VINF_SUCCESS;
@@ -369,6 +1386,88 @@ static int rtZipGzip_ReadOneSeg(PRTZIPGZIPSTREAM pThis, void *pvBuf, size_t cbTo
 }
 
 
+/**
+ * Reads from the parallel decompressor.
+ *
+ * @returns IPRT status code.
+ * @param   pThis           The gzip I/O stream instance data.
+ * @param   pbDst           Where to put the read bytes.
+ * @param   cbToRead        The number of bytes to read.
+ * @param   pcbRead         Where to store the number of bytes actually read.
+ *                          Optional.
+ */
+static int rtZipGzip_ParRead(PRTZIPGZIPSTREAM pThis, uint8_t *pbDst, size_t cbToRead, size_t *pcbRead)
+{
+    PRTZIPGZIPPAR pPar   = pThis->pPar;
+    size_t        cbRead = 0;
+    int           rc     = VINF_SUCCESS;
+    while (cbRead < cbToRead)
+    {
+        /* Keep the workers busy. */
+        while (!pPar->fInputEnd && pPar->cPending < pPar->cJobs)
+            rtZipGzipParReadMember(pThis);
+
+        if (!pPar->cPending)
+        {
+            if (pPar->fForeign)
+            {
+                /*
+                 * A regular gzip member follows, continue serially.
+                 */
+                memcpy(pThis->abBuffer, &pPar->NextHdr, pPar->cbNextHdr);
+                pThis->Zlib.next_in  = &pThis->abBuffer[0];
+                pThis->Zlib.avail_in = (uInt)pPar->cbNextHdr;
+                pThis->fMemberEnd    = false;
+                rtZipGzipParDestroy(pPar);
+                pThis->pPar = NULL;
+
+                int rcZlib = inflateReset(&pThis->Zlib);
+                if (rcZlib == Z_OK)
+                {
+                    size_t cbSerial = 0;
+                    rc = rtZipGzip_ReadOneSeg(pThis, &pbDst[cbRead], cbToRead - cbRead, true /*fBlocking*/, &cbSerial);
+                    pThis->offStream -= cbSerial; /* added below */
+                    cbRead += cbSerial;
+                }
+                else
+                    rc = rtZipGzipConvertErrFromZlib(pThis, rcZlib);
+            }
+            else
+            {
+                rc = pPar->rcInput;
+                if (RT_SUCCESS(rc))
+                {
+                    pThis->fEndOfStream = true;
+                    rc = VINF_EOF;
+                }
+            }
+            break;
+        }
+
+        PRTZIPGZIPJOB pJob = rtZipGzipParWaitForHead(pPar);
+        if (RT_FAILURE(pJob->rc))
+        {
+            pThis->fFatalError = true;
+            rc = pJob->rc;
+            break;
+        }
+        size_t const cbThis = RT_MIN(pJob->cbOut - pJob->offOut, cbToRead - cbRead);
+        memcpy(&pbDst[cbRead], &pJob->pbOut[pJob->offOut], cbThis);
+        pJob->offOut += cbThis;
+        cbRead       += cbThis;
+        if (pJob->offOut >= pJob->cbOut)
+            rtZipGzipParRetireHead(pPar);
+    }
+
+    pThis->offStream += cbRead;
+    if (pcbRead)
+        *pcbRead = cbRead;
+    else if (rc == VINF_EOF)
+        rc = VERR_EOF;
+    return rc;
+}
+
+
 /**
  * @interface_method_impl{RTVFSIOSTREAMOPS,pfnRead}
  */
@@ -381,6 +1480,12 @@ static DECLCALLBACK(int) rtZipGzip_Read(void *pvThis, RTFOFF off, PCRTSGBUF pSgB
         return VERR_ACCESS_DENIED;
     AssertReturn(off == -1 || off == pThis->offStream , VERR_INVALID_PARAMETER);
 
+    if (pThis->pPar)
+    {
+        if (pThis->fEndOfStream)
+            return pcbRead ? VINF_EOF : VERR_EOF;
+        return rtZipGzip_ParRead(pThis, (uint8_t *)pSgBuf->paSegs[0].pvSeg, pSgBuf->paSegs[0].cbSeg, pcbRead);
+    }
     return rtZipGzip_ReadOneSeg(pThis, pSgBuf->paSegs[0].pvSeg, pSgBuf->paSegs[0].cbSeg, fBlocking, pcbRead);
 }
 
@@ -513,8 +1618,13 @@ static DECLCALLBACK(int) rtZipGzip_Write(void *pvThis, RTFOFF off, PCRTSGBUF pSg
     Assert(pSgBuf->cSegs == 1); NOREF(fBlocking);
     if (pThis->fDecompress)
         return VERR_ACCESS_DENIED;
+    if (pThis->fEndOfStream)
+        return VERR_INVALID_STATE;
     AssertReturn(off == -1 || off == pThis->offStream , VERR_INVALID_PARAMETER);
 
+    if (pThis->pPar)
+        return rtZipGzipParWrite(pThis, (uint8_t const *)pSgBuf->paSegs[0].pvSeg, pSgBuf->paSegs[0].cbSeg, pcbWritten);
+
     /*
      * Write out the input buffer. Using a loop here because of potential
      * integer type overflow since avail_in is uInt and cbSeg is size_t.
@@ -599,9 +1709,9 @@ static int rtZipGzip_FlushIt(PRTZIPGZIPSTREAM pThis, uint8_t fFlushType)
 static DECLCALLBACK(int) rtZipGzip_Flush(void *pvThis)
 {
     PRTZIPGZIPSTREAM pThis = (PRTZIPGZIPSTREAM)pvThis;
-    if (!pThis->fDecompress)
+    if (!pThis->fDecompress && !pThis->fEndOfStream)
     {
-        int rc = rtZipGzip_FlushIt(pThis, Z_SYNC_FLUSH);
+        int rc = pThis->pPar ? rtZipGzipParFlush(pThis, false /*fFinish*/) : rtZipGzip_FlushIt(pThis, Z_SYNC_FLUSH);
         if (RT_FAILURE(rc))
             return rc;
     }
@@ -628,13 +1738,14 @@ static DECLCALLBACK(int) rtZipGzip_PollOne(void *pvThis, uint32_t fEvents, RTMSI
     if (pThis->fDecompress)
     {
         fEvents &= ~RTPOLL_EVT_WRITE;
-        if (pThis->Zlib.avail_in > 0)
+        if (   pThis->Zlib.avail_in > 0
+            || (pThis->pPar && rtZipGzipParIsHeadDone(pThis->pPar)))
             fRetEvents = RTPOLL_EVT_READ;
     }
     else
     {
         fEvents &= ~RTPOLL_EVT_READ;
-        if (pThis->Zlib.avail_out > 0)
+        if (pThis->Zlib.avail_out > 0 || pThis->pPar)
             fRetEvents = RTPOLL_EVT_WRITE;
     }
 
@@ -686,7 +1797,7 @@ static RTVFSIOSTREAMOPS g_rtZipGzipOps =
 RTDECL(int) RTZipGzipDecompressIoStream(RTVFSIOSTREAM hVfsIosIn, uint32_t fFlags, PRTVFSIOSTREAM phVfsIosOut)
 {
     AssertPtrReturn(hVfsIosIn, VERR_INVALID_HANDLE);
-    AssertReturn(!(fFlags & ~RTZIPGZIPDECOMP_F_ALLOW_ZLIB_HDR), VERR_INVALID_PARAMETER);
+    AssertReturn(!(fFlags & ~RTZIPGZIPDECOMP_F_VALID_MASK), VERR_INVALID_PARAMETER);
     AssertPtrReturn(phVfsIosOut, VERR_INVALID_POINTER);
 
     uint32_t cRefs = RTVfsIoStrmRetain(hVfsIosIn);
@@ -750,13 +1861,37 @@ RTDECL(int) RTZipGzipDecompressIoStream(RTVFSIOSTREAM hVfsIosIn, uint32_t fFlags
                     pThis->Zlib.next_in  = &pThis->abBuffer[0];
                     if (pHdr)
                     {
-                        pThis->Hdr = *pHdr;
+                        pThis->Hdr      = *pHdr;
+                        pThis->fGzipHdr = true;
                         /* Parse on if there are names or comments. */
                         if (pHdr->fFlags & (RTZIPGZIPHDR_FLG_NAME | RTZIPGZIPHDR_FLG_COMMENT))
                         {
                             /** @todo Can implement this when someone needs the
                              *        name or comment for something useful. */
                         }
+
+                        /* Blocked members can be decompressed in parallel. */
+                        if (   (fFlags & RTZIPGZIPDECOMP_F_PARALLEL)
+                            && pHdr->fFlags == RTZIPGZIPHDR_FLG_EXTRA)
+                        {
+                            size_t cbRead = 0;
+                            rc = RTVfsIoStrmRead(pThis->hVfsIos, &pThis->abBuffer[sizeof(RTZIPGZIPHDR)],
+                                                 sizeof(RTZIPGZIPBLOCKHDR) - sizeof(RTZIPGZIPHDR), true /*fBlocking*/, &cbRead);
+                            if (RT_SUCCESS(rc))
+                            {
+                                pThis->Zlib.avail_in += (uInt)cbRead;
+                                if (   pThis->Zlib.avail_in == sizeof(RTZIPGZIPBLOCKHDR)
+                                    && rtZipGzipIsBlockHdr((PCRTZIPGZIPBLOCKHDR)pThis->abBuffer)
+                                    && RT_SUCCESS(rtZipGzipParCreate(pThis, false /*fBlocked*/, 0 /*uLevel*/)))
+                                {
+                                    /* Hand the header over to the member reader. */
+                                    memcpy(&pThis->pPar->NextHdr, pThis->abBuffer, sizeof(RTZIPGZIPBLOCKHDR));
+                                    pThis->pPar->cbNextHdr = sizeof(RTZIPGZIPBLOCKHDR);
+                                    pThis->Zlib.avail_in   = 0;
+                                }
+                                rc = VINF_SUCCESS;
+                            }
+                        }
                     }
                     if (RT_SUCCESS(rc))
                     {
@@ -776,10 +1911,32 @@ RTDECL(int) RTZipGzipDecompressIoStream(RTVFSIOSTREAM hVfsIosIn, uint32_t fFlags
 }
 
 
+RTDECL(int) RTZipGzipCompressFinish(RTVFSIOSTREAM hVfsIosGzip)
+{
+    PRTZIPGZIPSTREAM pThis = (PRTZIPGZIPSTREAM)RTVfsIoStreamToPrivate(hVfsIosGzip, &g_rtZipGzipOps);
+    AssertReturn(pThis, VERR_INVALID_HANDLE);
+    AssertReturn(!pThis->fDecompress, VERR_ACCESS_DENIED);
+    if (pThis->fEndOfStream)
+        return VINF_SUCCESS;
+    if (pThis->fFatalError)
+        return VERR_ZIP_ERROR;
+
+    int rc = pThis->pPar ? rtZipGzipParFlush(pThis, true /*fFinish*/) : rtZipGzip_FlushIt(pThis, Z_FINISH);
+    if (RT_SUCCESS(rc))
+    {
+        pThis->fEndOfStream = true;
+        rc = RTVfsIoStrmFlush(pThis->hVfsIos);
+    }
+    else
+        pThis->fFatalError = true;
+    return rc;
+}
+
+
 RTDECL(int) RTZipGzipCompressIoStream(RTVFSIOSTREAM hVfsIosDst, uint32_t fFlags, uint8_t uLevel, PRTVFSIOSTREAM phVfsIosZip)
 {
     AssertPtrReturn(hVfsIosDst, VERR_INVALID_HANDLE);
-    AssertReturn(!fFlags, VERR_INVALID_PARAMETER);
+    AssertReturn(!(fFlags & ~RTZIPGZIPCOMP_F_VALID_MASK), VERR_INVALID_PARAMETER);
     AssertPtrReturn(phVfsIosZip, VERR_INVALID_POINTER);
     AssertReturn(uLevel > 0 && uLevel <= 9, VERR_INVALID_PARAMETER);
 
@@ -807,6 +1964,30 @@ RTDECL(int) RTZipGzipCompressIoStream(RTVFSIOSTREAM hVfsIosDst, uint32_t fFlags,
         pThis->Zlib.next_out  = &pThis->abBuffer[0];
         pThis->Zlib.avail_out = sizeof(pThis->abBuffer);
 
+        /*
+         * The parallel compressor uses zlib on the worker threads only and
+         * writes the gzip header and trailer itself, unless every block is
+         * written as a separate member.
+         */
+        if (fFlags & (RTZIPGZIPCOMP_F_PARALLEL | RTZIPGZIPCOMP_F_BLOCKED))
+        {
+            bool const fBlocked = RT_BOOL(fFlags & RTZIPGZIPCOMP_F_BLOCKED);
+            rc = rtZipGzipParCreate(pThis, fBlocked, uLevel);
+            if (RT_SUCCESS(rc) && !fBlocked)
+            {
+                rtZipGzipInitHdr(&pThis->Hdr, uLevel);
+                rc = RTVfsIoStrmWrite(hVfsIosDst, &pThis->Hdr, sizeof(pThis->Hdr), true /*fBlocking*/, NULL /*pcbWritten*/);
+            }
+            if (RT_SUCCESS(rc))
+            {
+                *phVfsIosZip = hVfsIos;
+                return VINF_SUCCESS;
+            }
+            pThis->fFatalError = true;
+            RTVfsIoStrmRelease(hVfsIos);
+            return rc;
+        }
+
         rc = deflateInit2(&pThis->Zlib,
                           uLevel,
                           Z_DEFLATED,
@@ -830,6 +2011,369 @@ RTDECL(int) RTZipGzipCompressIoStream(RTVFSIOSTREAM hVfsIosDst, uint32_t fFlags,
 
 
 
+/**
+ * @interface_method_impl{RTVFSOBJOPS,pfnClose}
+ */
+static DECLCALLBACK(int) rtZipGzipFile_Close(void *pvThis)
+{
+    PRTZIPGZIPFILE pThis = (PRTZIPGZIPFILE)pvThis;
+
+    if (pThis->fZlibInitialized)
+    {
+        inflateEnd(&pThis->Zlib);
+        pThis->fZlibInitialized = false;
+    }
+    RTMemFree(pThis->paMembers);
+    pThis->paMembers = NULL;
+    RTMemFree(pThis->pbCache);
+    pThis->pbCache = NULL;
+    RTMemFree(pThis->pbMember);
+    pThis->pbMember = NULL;
+
+    RTVfsFileRelease(pThis->hVfsFile);
+    pThis->hVfsFile = NIL_RTVFSFILE;
+    return VINF_SUCCESS;
+}
+
+
+/**
+ * @interface_method_impl{RTVFSOBJOPS,pfnQueryInfo}
+ */
+static DECLCALLBACK(int) rtZipGzipFile_QueryInfo(void *pvThis, PRTFSOBJINFO pObjInfo, RTFSOBJATTRADD enmAddAttr)
+{
+    PRTZIPGZIPFILE pThis = (PRTZIPGZIPFILE)pvThis;
+    int rc = RTVfsFileQueryInfo(pThis->hVfsFile, pObjInfo, enmAddAttr);
+    if (RT_SUCCESS(rc))
+        pObjInfo->cbObject = pThis->cbFile;
+    return rc;
+}
+
+
+/**
+ * Loads a member into the cache.
+ *
+ * @returns IPRT status code.
+ * @param   pThis           The blocked gzip file instance data.
+ * @param   iMember         The member to load.
+ */
+static int rtZipGzipFileLoadMember(PRTZIPGZIPFILE pThis, uint32_t iMember)
+{
+    if (pThis->iCachedMember == iMember)
+        return VINF_SUCCESS;
+    pThis->iCachedMember = UINT32_MAX;
+
+    PCRTZIPGZIPMEMBER pMember = &pThis->paMembers[iMember];
+    int rc = rtZipGzipEnsureBuffer(&pThis->pbMember, &pThis->cbMemberAlloc, pMember->cbMember);
+    if (RT_SUCCESS(rc))
+        rc = rtZipGzipEnsureBuffer(&pThis->pbCache, &pThis->cbCacheAlloc, pMember->cbData);
+    if (RT_SUCCESS(rc))
+        rc = RTVfsFileReadAt(pThis->hVfsFile, pMember->offMember, pThis->pbMember, pMember->cbMember, NULL /*pcbRead*/);
+    if (RT_SUCCESS(rc))
+    {
+        /* The index was built from the headers, make sure they didn't change. */
+        PCRTZIPGZIPBLOCKHDR pHdr = (PCRTZIPGZIPBLOCKHDR)pThis->pbMember;
+        if (   rtZipGzipIsBlockHdr(pHdr)
+            && RT_LE2H_U32(pHdr->cbMember) == pMember->cbMember
+            && RT_LE2H_U32(pHdr->cbData)   == pMember->cbData)
+            rc = rtZipGzipInflateBlock(&pThis->Zlib, pThis->pbMember, pMember->cbMember, pThis->pbCache);
+        else
+            rc = VERR_ZIP_CORRUPTED;
+        if (RT_SUCCESS(rc))
+            pThis->iCachedMember = iMember;
+    }
+    return rc;
+}
+
+
+/**
+ * @interface_method_impl{RTVFSIOSTREAMOPS,pfnRead}
+ */
+static DECLCALLBACK(int) rtZipGzipFile_Read(void *pvThis, RTFOFF off, PCRTSGBUF pSgBuf, bool fBlocking, size_t *pcbRead)
+{
+    PRTZIPGZIPFILE pThis = (PRTZIPGZIPFILE)pvThis;
+    AssertReturn(pSgBuf->cSegs == 1, VERR_INTERNAL_ERROR_3);
+    RT_NOREF(fBlocking);
+
+    if (off == -1)
+        off = pThis->offFile;
+    AssertReturn(off >= 0, VERR_INVALID_PARAMETER);
+
+    uint8_t *pbDst    = (uint8_t *)pSgBuf->paSegs[0].pvSeg;
+    size_t   cbToRead = pSgBuf->paSegs[0].cbSeg;
+    size_t   cbRead   = 0;
+    int      rc       = VINF_SUCCESS;
+    uint64_t offCur   = (uint64_t)off;
+    while (cbRead < cbToRead && offCur < pThis->cbFile)
+    {
+        /*
+         * Look up the member, checking the cached one first as reads
+         * usually are sequential.
+         */
+        uint32_t iMember = pThis->iCachedMember;
+        if (   iMember >= pThis->cMembers
+            || offCur <  pThis->paMembers[iMember].offData
+            || offCur >= pThis->paMembers[iMember].offData + pThis->paMembers[iMember].cbData)
+        {
+            uint32_t iFirst = 0;
+            uint32_t iEnd   = pThis->cMembers;
+            for (;;)
+            {
+                iMember = iFirst + (iEnd - iFirst) / 2;
+                PCRTZIPGZIPMEMBER pMember = &pThis->paMembers[iMember];
+                if (offCur < pMember->offData)
+                    iEnd = iMember;
+                else if (offCur >= pMember->offData + pMember->cbData)
+                    iFirst = iMember + 1;
+                else
+                    break;
+                AssertBreakStmt(iFirst < iEnd, rc = VERR_INTERNAL_ERROR_3);
+            }
+            if (RT_FAILURE(rc))
+                break;
+        }
+
+        rc = rtZipGzipFileLoadMember(pThis, iMember);
+        if (RT_FAILURE(rc))
+            break;
+
+        PCRTZIPGZIPMEMBER pMember = &pThis->paMembers[iMember];
+        size_t const offInMember  = (size_t)(offCur - pMember->offData);
+        size_t const cbThis       = RT_MIN(pMember->cbData - offInMember, cbToRead - cbRead);
+        memcpy(&pbDst[cbRead], &pThis->pbCache[offInMember], cbThis);
+        cbRead += cbThis;
+        offCur += cbThis;
+    }
+
+    pThis->offFile = offCur;
+    if (pcbRead)
+    {
+        *pcbRead = cbRead;
+        if (RT_SUCCESS(rc) && cbRead < cbToRead)
+            rc = VINF_EOF;
+    }
+    else if (RT_SUCCESS(rc) && cbRead < cbToRead)
+        rc = VERR_EOF;
+    return rc;
+}
+
+
+/**
+ * @interface_method_impl{RTVFSIOSTREAMOPS,pfnFlush}
+ */
+static DECLCALLBACK(int) rtZipGzipFile_Flush(void *pvThis)
+{
+    RT_NOREF(pvThis);
+    return VINF_SUCCESS;
+}
+
+
+/**
+ * @interface_method_impl{RTVFSIOSTREAMOPS,pfnPollOne}
+ */
+static DECLCALLBACK(int) rtZipGzipFile_PollOne(void *pvThis, uint32_t fEvents, RTMSINTERVAL cMillies, bool fIntr,
+                                               uint32_t *pfRetEvents)
+{
+    PRTZIPGZIPFILE pThis = (PRTZIPGZIPFILE)pvThis;
+    return (int)RTVfsFilePoll(pThis->hVfsFile, fEvents & ~RTPOLL_EVT_WRITE, cMillies, fIntr, pfRetEvents);
+}
+
+
+/**
+ * @interface_method_impl{RTVFSIOSTREAMOPS,pfnTell}
+ */
+static DECLCALLBACK(int) rtZipGzipFile_Tell(void *pvThis, PRTFOFF poffActual)
+{
+    PRTZIPGZIPFILE pThis = (PRTZIPGZIPFILE)pvThis;
+    *poffActual = pThis->offFile;
+    return VINF_SUCCESS;
+}
+
+
+/**
+ * @interface_method_impl{RTVFSFILEOPS,pfnSeek}
+ */
+static DECLCALLBACK(int) rtZipGzipFile_Seek(void *pvThis, RTFOFF offSeek, unsigned uMethod, PRTFOFF poffActual)
+{
+    PRTZIPGZIPFILE pThis = (PRTZIPGZIPFILE)pvThis;
+    RTFOFF offNew;
+    switch (uMethod)
+    {
+        case RTFILE_SEEK_BEGIN:
+            offNew = offSeek;
+            break;
+        case RTFILE_SEEK_END:
+            offNew = (RTFOFF)pThis->cbFile + offSeek;
+            break;
+        case RTFILE_SEEK_CURRENT:
+            offNew = (RTFOFF)pThis->offFile + offSeek;
+            break;
+        default:
+            return VERR_INVALID_PARAMETER;
+    }
+    if (offNew >= 0)
+    {
+        pThis->offFile = offNew;
+        *poffActual    = offNew;
+        return VINF_SUCCESS;
+    }
+    return VERR_NEGATIVE_SEEK;
+}
+
+
+/**
+ * @interface_method_impl{RTVFSFILEOPS,pfnQuerySize}
+ */
+static DECLCALLBACK(int) rtZipGzipFile_QuerySize(void *pvThis, uint64_t *pcbFile)
+{
+    PRTZIPGZIPFILE pThis = (PRTZIPGZIPFILE)pvThis;
+    *pcbFile = pThis->cbFile;
+    return VINF_SUCCESS;
+}
+
+
+/**
+ * The blocked gzip file vtable.
+ */
+static const RTVFSFILEOPS g_rtZipGzipFileOps =
+{
+    { /* Stream */
+        { /* Obj */
+            RTVFSOBJOPS_VERSION,
+            RTVFSOBJTYPE_FILE,
+            "GzipFile",
+            rtZipGzipFile_Close,
+            rtZipGzipFile_QueryInfo,
+            RTVFSOBJOPS_VERSION
+        },
+        RTVFSIOSTREAMOPS_VERSION,
+        RTVFSIOSTREAMOPS_FEAT_NO_SG,
+        rtZipGzipFile_Read,
+        NULL /*Write*/,
+        rtZipGzipFile_Flush,
+        rtZipGzipFile_PollOne,
+        rtZipGzipFile_Tell,
+        NULL /*pfnSkip*/,
+        NULL /*pfnZeroFill*/,
+        RTVFSIOSTREAMOPS_VERSION,
+    },
+    RTVFSFILEOPS_VERSION,
+    0,
+    { /* ObjSet */
+        RTVFSOBJSETOPS_VERSION,
+        RT_OFFSETOF(RTVFSFILEOPS, Stream.Obj) - RT_OFFSETOF(RTVFSFILEOPS, ObjSet),
+        NULL /*SetMode*/,
+        NULL /*SetTimes*/,
+        NULL /*SetOwner*/,
+        RTVFSOBJSETOPS_VERSION
+    },
+    rtZipGzipFile_Seek,
+    rtZipGzipFile_QuerySize,
+    NULL /*SetSize*/,
+    NULL /*QueryMaxSize*/,
+    RTVFSFILEOPS_VERSION
+};
+
+
+/**
+ * Builds the member index of a blocked gzip file by hopping from header to
+ * header.
+ *
+ * @returns IPRT status code.
+ * @param   pThis           The blocked gzip file instance data.
+ */
+static int rtZipGzipFileBuildIndex(PRTZIPGZIPFILE pThis)
+{
+    uint64_t cbGzip;
+    int rc = RTVfsFileGetSize(pThis->hVfsFile, &cbGzip);
+    if (RT_FAILURE(rc))
+        return rc;
+
+    uint32_t cAlloc  = 0;
+    uint64_t offGzip = 0;
+    while (offGzip < cbGzip)
+    {
+        RTZIPGZIPBLOCKHDR Hdr;
+        if (cbGzip - offGzip >= sizeof(Hdr))
+            rc = RTVfsFileReadAt(pThis->hVfsFile, offGzip, &Hdr, sizeof(Hdr), NULL /*pcbRead*/);
+        else
+            RT_ZERO(Hdr);
+        if (RT_FAILURE(rc))
+            return rc;
+        if (!rtZipGzipIsBlockHdr(&Hdr))
+            return offGzip == 0 ? VERR_ZIP_BAD_HEADER : VERR_ZIP_CORRUPTED;
+
+        uint32_t const cbMember = RT_LE2H_U32(Hdr.cbMember);
+        uint32_t const cbData   = RT_LE2H_U32(Hdr.cbData);
+        if (cbMember > cbGzip - offGzip)
+            return VERR_ZIP_CORRUPTED;
+        if (cbData > 0)
+        {
+            if (pThis->cMembers >= cAlloc)
+            {
+                uint32_t const cNew = cAlloc ? cAlloc * 2 : 256;
+                void *pvNew = RTMemRealloc(pThis->paMembers, cNew * sizeof(pThis->paMembers[0]));
+                if (!pvNew)
+                    return VERR_NO_MEMORY;
+                pThis->paMembers = (PRTZIPGZIPMEMBER)pvNew;
+                cAlloc = cNew;
+            }
+            PRTZIPGZIPMEMBER pMember = &pThis->paMembers[pThis->cMembers++];
+            pMember->offMember = offGzip;
+            pMember->offData   = pThis->cbFile;
+            pMember->cbMember  = cbMember;
+            pMember->cbData    = cbData;
+            pThis->cbFile     += cbData;
+        }
+        offGzip += cbMember;
+    }
+    return offGzip > 0 ? VINF_SUCCESS : VERR_ZIP_BAD_HEADER;
+}
+
+
+RTDECL(int) RTZipGzipDecompressFile(RTVFSFILE hVfsFileIn, uint32_t fFlags, PRTVFSFILE phVfsFileGunzip)
+{
+    AssertPtrReturn(hVfsFileIn, VERR_INVALID_HANDLE);
+    AssertReturn(!fFlags, VERR_INVALID_PARAMETER);
+    AssertPtrReturn(phVfsFileGunzip, VERR_INVALID_POINTER);
+
+    uint32_t cRefs = RTVfsFileRetain(hVfsFileIn);
+    AssertReturn(cRefs != UINT32_MAX, VERR_INVALID_HANDLE);
+
+    /*
+     * Create the file object, it has a lock since reads update the cache.
+     */
+    RTVFSFILE      hVfsFile;
+    PRTZIPGZIPFILE pThis;
+    int rc = RTVfsNewFile(&g_rtZipGzipFileOps, sizeof(*pThis), RTFILE_O_READ | RTFILE_O_OPEN | RTFILE_O_DENY_NONE,
+                          NIL_RTVFS, RTVFSLOCK_CREATE_MUTEX, &hVfsFile, (void **)&pThis);
+    if (RT_SUCCESS(rc))
+    {
+        pThis->hVfsFile      = hVfsFileIn;
+        pThis->iCachedMember = UINT32_MAX;
+
+        RT_ZERO(pThis->Zlib);
+        rc = inflateInit2(&pThis->Zlib, -MAX_WBITS);
+        if (rc == Z_OK)
+        {
+            pThis->fZlibInitialized = true;
+            rc = rtZipGzipFileBuildIndex(pThis);
+            if (RT_SUCCESS(rc))
+            {
+                *phVfsFileGunzip = hVfsFile;
+                return VINF_SUCCESS;
+            }
+        }
+        else
+            rc = rc == Z_MEM_ERROR ? VERR_ZIP_NO_MEMORY : VERR_ZIP_ERROR;
+        RTVfsFileRelease(hVfsFile);
+    }
+    else
+        RTVfsFileRelease(hVfsFileIn);
+    return rc;
+}
+
+
+
 /**
  * @interface_method_impl{RTVFSCHAINELEMENTREG,pfnValidate}
  */
@@ -37,6 +37,8 @@
 #include <iprt/err.h>
 #include <iprt/poll.h>
 #include <iprt/file.h>
+#include <iprt/mem.h>
+#include <iprt/semaphore.h>
 #include <iprt/string.h>
 #include <iprt/vfs.h>
 #include <iprt/vfslowlevel.h>
@@ -139,6 +141,52 @@ typedef struct RTZIPTARIOSTREAM
 typedef RTZIPTARIOSTREAM *PRTZIPTARIOSTREAM;
 
 
+/**
+ * The archive file shared by a TAR filesystem stream and the file views it
+ * hands out (RTZIPTAR_R_FILE_VIEWS).
+ *
+ * This is reference counted so the views can outlive the filesystem stream.
+ */
+typedef struct RTZIPTARFILESHARED
+{
+    /** Reference counter. */
+    uint32_t volatile       cRefs;
+    /** Serializes access to hVfsFile.  A positioned read on a plain file may
+     * move the file pointer, so readers on different members must not
+     * interleave. */
+    RTSEMFASTMUTEX          hFastMtx;
+    /** The archive file. */
+    RTVFSFILE               hVfsFile;
+} RTZIPTARFILESHARED;
+/** Pointer to the archive file shared by a TAR stream and its file views. */
+typedef RTZIPTARFILESHARED *PRTZIPTARFILESHARED;
+
+
+/**
+ * Tar file represented as a seekable VFS file view of the archive file.
+ */
+typedef struct RTZIPTARFILEVIEW
+{
+    /** The basic TAR object data.  pTarReader is NULL as the view may outlive
+     *  the filesystem stream. */
+    RTZIPTARBASEOBJ         BaseObj;
+    /** The number of bytes in the file. */
+    RTFOFF                  cbFile;
+    /** The current file position. */
+    RTFOFF                  offFile;
+    /** The offset of the file data in the archive file. */
+    RTFOFF                  offStart;
+    /** The archive file. */
+    PRTZIPTARFILESHARED     pShared;
+    /** The owner name, if present in the header. */
+    char                    szOwner[RT_SIZEOFMEMB(RTZIPTARHDRCOMMON, uname) + 1];
+    /** The group name, if present in the header. */
+    char                    szGroup[RT_SIZEOFMEMB(RTZIPTARHDRCOMMON, gname) + 1];
+} RTZIPTARFILEVIEW;
+/** Pointer to a the private data of a TAR file view. */
+typedef RTZIPTARFILEVIEW *PRTZIPTARFILEVIEW;
+
+
 /**
  * Tar filesystem stream private data.
  */
@@ -151,6 +199,9 @@ typedef struct RTZIPTARFSSTREAM
     RTVFSOBJ                hVfsCurObj;
     /** Pointer to the private data if hVfsCurObj is representing a file. */
     PRTZIPTARIOSTREAM       pCurIosData;
+    /** The archive file when handing out file views (RTZIPTAR_R_FILE_VIEWS),
+     * NULL when reading hVfsIos sequentially. */
+    PRTZIPTARFILESHARED     pShared;
 
     /** The start offset. */
     RTFOFF                  offStart;
@@ -915,7 +966,7 @@ static DECLCALLBACK(int) rtZipTarFssBaseObj_QueryInfo(void *pvThis, PRTFSOBJINFO
             pObjInfo->Attr.enmAdditional         = RTFSOBJATTRADD_UNIX_OWNER;
             pObjInfo->Attr.u.UnixOwner.uid       = pThis->ObjInfo.Attr.u.Unix.uid;
             pObjInfo->Attr.u.UnixOwner.szName[0] = '\0';
-            if (rtZipTarReaderHasUserName(pThis->pTarReader))
+            if (pThis->pTarReader && rtZipTarReaderHasUserName(pThis->pTarReader))
                 RTStrCopy(pObjInfo->Attr.u.UnixOwner.szName, sizeof(pObjInfo->Attr.u.UnixOwner.szName),
                           pThis->pTarReader->Hdr.Common.uname);
             break;
@@ -925,7 +976,7 @@ static DECLCALLBACK(int) rtZipTarFssBaseObj_QueryInfo(void *pvThis, PRTFSOBJINFO
             pObjInfo->Attr.enmAdditional         = RTFSOBJATTRADD_UNIX_GROUP;
             pObjInfo->Attr.u.UnixGroup.gid       = pThis->ObjInfo.Attr.u.Unix.gid;
             pObjInfo->Attr.u.UnixGroup.szName[0] = '\0';
-            if (rtZipTarReaderHasGroupName(pThis->pTarReader))
+            if (pThis->pTarReader && rtZipTarReaderHasGroupName(pThis->pTarReader))
                 RTStrCopy(pObjInfo->Attr.u.UnixGroup.szName, sizeof(pObjInfo->Attr.u.UnixGroup.szName),
                           pThis->pTarReader->Hdr.Common.gname);
             break;
@@ -1113,6 +1164,239 @@ static const RTVFSIOSTREAMOPS g_rtZipTarFssIosOps =
 };
 
 
+/**
+ * Releases a reference to the shared archive file, destroying it when the last
+ * reference goes away.
+ *
+ * @param   pShared             The shared archive file.  NULL is ignored.
+ */
+static void rtZipTarFileSharedRelease(PRTZIPTARFILESHARED pShared)
+{
+    if (pShared)
+    {
+        uint32_t cRefs = ASMAtomicDecU32(&pShared->cRefs);
+        Assert(cRefs < _1M);
+        if (!cRefs)
+        {
+            RTSemFastMutexDestroy(pShared->hFastMtx);
+            pShared->hFastMtx = NIL_RTSEMFASTMUTEX;
+            RTVfsFileRelease(pShared->hVfsFile);
+            pShared->hVfsFile = NIL_RTVFSFILE;
+            RTMemFree(pShared);
+        }
+    }
+}
+
+
+/**
+ * Reads from the shared archive file at the given offset.
+ *
+ * @returns IPRT status code, see RTVfsFileReadAt.
+ * @param   pShared             The shared archive file.
+ * @param   off                 The archive file offset to read at.
+ * @param   pvBuf               Where to return the bytes.
+ * @param   cbToRead            Number of bytes to read.
+ * @param   pcbRead             Where to return the number of bytes read.
+ *                              Optional.
+ */
+static int rtZipTarFileSharedReadAt(PRTZIPTARFILESHARED pShared, RTFOFF off, void *pvBuf, size_t cbToRead, size_t *pcbRead)
+{
+    RTSemFastMutexRequest(pShared->hFastMtx);
+    int rc = RTVfsFileReadAt(pShared->hVfsFile, off, pvBuf, cbToRead, pcbRead);
+    RTSemFastMutexRelease(pShared->hFastMtx);
+    return rc;
+}
+
+
+/**
+ * @interface_method_impl{RTVFSOBJOPS,pfnClose}
+ */
+static DECLCALLBACK(int) rtZipTarFssFile_Close(void *pvThis)
+{
+    PRTZIPTARFILEVIEW pThis = (PRTZIPTARFILEVIEW)pvThis;
+
+    rtZipTarFileSharedRelease(pThis->pShared);
+    pThis->pShared = NULL;
+
+    return rtZipTarFssBaseObj_Close(&pThis->BaseObj);
+}
+
+
+/**
+ * @interface_method_impl{RTVFSOBJOPS,pfnQueryInfo}
+ */
+static DECLCALLBACK(int) rtZipTarFssFile_QueryInfo(void *pvThis, PRTFSOBJINFO pObjInfo, RTFSOBJATTRADD enmAddAttr)
+{
+    PRTZIPTARFILEVIEW pThis = (PRTZIPTARFILEVIEW)pvThis;
+    int rc = rtZipTarFssBaseObj_QueryInfo(&pThis->BaseObj, pObjInfo, enmAddAttr);
+    if (RT_SUCCESS(rc))
+    {
+        if (enmAddAttr == RTFSOBJATTRADD_UNIX_OWNER)
+            RTStrCopy(pObjInfo->Attr.u.UnixOwner.szName, sizeof(pObjInfo->Attr.u.UnixOwner.szName), pThis->szOwner);
+        else if (enmAddAttr == RTFSOBJATTRADD_UNIX_GROUP)
+            RTStrCopy(pObjInfo->Attr.u.UnixGroup.szName, sizeof(pObjInfo->Attr.u.UnixGroup.szName), pThis->szGroup);
+    }
+    return rc;
+}
+
+
+/**
+ * @interface_method_impl{RTVFSIOSTREAMOPS,pfnRead}
+ */
+static DECLCALLBACK(int) rtZipTarFssFile_Read(void *pvThis, RTFOFF off, PCRTSGBUF pSgBuf, bool fBlocking, size_t *pcbRead)
+{
+    PRTZIPTARFILEVIEW pThis = (PRTZIPTARFILEVIEW)pvThis;
+    Assert(pSgBuf->cSegs == 1);
+    RT_NOREF(fBlocking);
+
+    if (off < 0)
+        off = pThis->offFile;
+    if (off >= pThis->cbFile)
+    {
+        if (pcbRead)
+        {
+            *pcbRead = 0;
+            return VINF_EOF;
+        }
+        return VERR_EOF;
+    }
+
+    size_t cbToRead = pSgBuf->paSegs[0].cbSeg;
+    if ((uint64_t)cbToRead > (uint64_t)(pThis->cbFile - off))
+    {
+        if (!pcbRead)
+            return VERR_EOF;
+        cbToRead = (size_t)(pThis->cbFile - off);
+    }
+
+    /*
+     * Read straight from the archive file into the caller's buffer.
+     */
+    size_t cbRead = 0;
+    int rc = rtZipTarFileSharedReadAt(pThis->pShared, pThis->offStart + off, pSgBuf->paSegs[0].pvSeg, cbToRead, &cbRead);
+    if (RT_SUCCESS(rc))
+    {
+        pThis->offFile = off + cbRead;
+        if (pcbRead)
+        {
+            *pcbRead = cbRead;
+            if (cbRead < pSgBuf->paSegs[0].cbSeg)
+                rc = VINF_EOF;
+        }
+        else if (cbRead != cbToRead)
+            rc = VERR_TAR_UNEXPECTED_EOS;
+    }
+    return rc;
+}
+
+
+/**
+ * @interface_method_impl{RTVFSIOSTREAMOPS,pfnPollOne}
+ */
+static DECLCALLBACK(int) rtZipTarFssFile_PollOne(void *pvThis, uint32_t fEvents, RTMSINTERVAL cMillies, bool fIntr,
+                                                 uint32_t *pfRetEvents)
+{
+    PRTZIPTARFILEVIEW pThis = (PRTZIPTARFILEVIEW)pvThis;
+    return (int)RTVfsFilePoll(pThis->pShared->hVfsFile, fEvents & ~RTPOLL_EVT_WRITE, cMillies, fIntr, pfRetEvents);
+}
+
+
+/**
+ * @interface_method_impl{RTVFSIOSTREAMOPS,pfnTell}
+ */
+static DECLCALLBACK(int) rtZipTarFssFile_Tell(void *pvThis, PRTFOFF poffActual)
+{
+    PRTZIPTARFILEVIEW pThis = (PRTZIPTARFILEVIEW)pvThis;
+    *poffActual = pThis->offFile;
+    return VINF_SUCCESS;
+}
+
+
+/**
+ * @interface_method_impl{RTVFSFILEOPS,pfnSeek}
+ */
+static DECLCALLBACK(int) rtZipTarFssFile_Seek(void *pvThis, RTFOFF offSeek, unsigned uMethod, PRTFOFF poffActual)
+{
+    PRTZIPTARFILEVIEW pThis = (PRTZIPTARFILEVIEW)pvThis;
+    RTFOFF offNew;
+    switch (uMethod)
+    {
+        case RTFILE_SEEK_BEGIN:
+            offNew = offSeek;
+            break;
+        case RTFILE_SEEK_END:
+            offNew = pThis->cbFile + offSeek;
+            break;
+        case RTFILE_SEEK_CURRENT:
+            offNew = pThis->offFile + offSeek;
+            break;
+        default:
+            return VERR_INVALID_PARAMETER;
+    }
+    if (offNew >= 0)
+    {
+        pThis->offFile = offNew;
+        *poffActual    = offNew;
+        return VINF_SUCCESS;
+    }
+    return VERR_NEGATIVE_SEEK;
+}
+
+
+/**
+ * @interface_method_impl{RTVFSFILEOPS,pfnQuerySize}
+ */
+static DECLCALLBACK(int) rtZipTarFssFile_QuerySize(void *pvThis, uint64_t *pcbFile)
+{
+    PRTZIPTARFILEVIEW pThis = (PRTZIPTARFILEVIEW)pvThis;
+    *pcbFile = (uint64_t)pThis->cbFile;
+    return VINF_SUCCESS;
+}
+
+
+/**
+ * Tar file view operations.
+ */
+static const RTVFSFILEOPS g_rtZipTarFssFileOps =
+{
+    { /* Stream */
+        { /* Obj */
+            RTVFSOBJOPS_VERSION,
+            RTVFSOBJTYPE_FILE,
+            "TarFsStream::File",
+            rtZipTarFssFile_Close,
+            rtZipTarFssFile_QueryInfo,
+            RTVFSOBJOPS_VERSION
+        },
+        RTVFSIOSTREAMOPS_VERSION,
+        RTVFSIOSTREAMOPS_FEAT_NO_SG,
+        rtZipTarFssFile_Read,
+        rtZipTarFssIos_Write,
+        rtZipTarFssIos_Flush,
+        rtZipTarFssFile_PollOne,
+        rtZipTarFssFile_Tell,
+        NULL /*Skip*/,
+        NULL /*ZeroFill*/,
+        RTVFSIOSTREAMOPS_VERSION,
+    },
+    RTVFSFILEOPS_VERSION,
+    0,
+    { /* ObjSet */
+        RTVFSOBJSETOPS_VERSION,
+        RT_OFFSETOF(RTVFSFILEOPS, Stream.Obj) - RT_OFFSETOF(RTVFSFILEOPS, ObjSet),
+        NULL /*SetMode*/,
+        NULL /*SetTimes*/,
+        NULL /*SetOwner*/,
+        RTVFSOBJSETOPS_VERSION
+    },
+    rtZipTarFssFile_Seek,
+    rtZipTarFssFile_QuerySize,
+    NULL /*SetSize*/,
+    NULL /*QueryMaxSize*/,
+    RTVFSFILEOPS_VERSION
+};
+
+
 /**
  * @interface_method_impl{RTVFSOBJOPS,pfnClose}
  */
@@ -1212,6 +1496,9 @@ static DECLCALLBACK(int) rtZipTarFss_Close(void *pvThis)
     pThis->hVfsCurObj  = NIL_RTVFSOBJ;
     pThis->pCurIosData = NULL;
 
+    rtZipTarFileSharedRelease(pThis->pShared);
+    pThis->pShared = NULL;
+
     RTVfsIoStrmRelease(pThis->hVfsIos);
     pThis->hVfsIos = NIL_RTVFSIOSTREAM;
 
@@ -1263,27 +1550,32 @@ static DECLCALLBACK(int) rtZipTarFss_Next(void *pvThis, char **ppszName, RTVFSOB
         return pThis->rcFatal;
 
     /*
-     * Make sure the input stream is in the right place.
+     * Make sure the input stream is in the right place.  File views read at
+     * explicit offsets and leave the stream position alone.
      */
-    RTFOFF offHdr = RTVfsIoStrmTell(pThis->hVfsIos);
-    while (   offHdr >= 0
-           && offHdr < pThis->offNextHdr)
+    RTFOFF offHdr = pThis->offNextHdr;
+    if (!pThis->pShared)
     {
-        int rc = RTVfsIoStrmSkip(pThis->hVfsIos, pThis->offNextHdr - offHdr);
-        if (RT_FAILURE(rc))
+        offHdr = RTVfsIoStrmTell(pThis->hVfsIos);
+        while (   offHdr >= 0
+               && offHdr < pThis->offNextHdr)
         {
-            /** @todo Ignore if we're at the end of the stream? */
-            return pThis->rcFatal = rc;
+            int rc = RTVfsIoStrmSkip(pThis->hVfsIos, pThis->offNextHdr - offHdr);
+            if (RT_FAILURE(rc))
+            {
+                /** @todo Ignore if we're at the end of the stream? */
+                return pThis->rcFatal = rc;
+            }
+
+            offHdr = RTVfsIoStrmTell(pThis->hVfsIos);
         }
 
-        offHdr = RTVfsIoStrmTell(pThis->hVfsIos);
+        if (offHdr < 0)
+            return pThis->rcFatal = (int)offHdr;
+        if (offHdr > pThis->offNextHdr)
+            return pThis->rcFatal = VERR_INTERNAL_ERROR_3;
     }
 
-    if (offHdr < 0)
-        return pThis->rcFatal = (int)offHdr;
-    if (offHdr > pThis->offNextHdr)
-        return pThis->rcFatal = VERR_INTERNAL_ERROR_3;
-
     /*
      * Consume TAR headers.
      */
@@ -1296,7 +1588,14 @@ static DECLCALLBACK(int) rtZipTarFss_Next(void *pvThis, char **ppszName, RTVFSOB
          */
         RTZIPTARHDR Hdr;
         size_t cbRead;
-        rc = RTVfsIoStrmRead(pThis->hVfsIos, &Hdr, sizeof(Hdr), true /*fBlocking*/, &cbRead);
+        if (!pThis->pShared)
+            rc = RTVfsIoStrmRead(pThis->hVfsIos, &Hdr, sizeof(Hdr), true /*fBlocking*/, &cbRead);
+        else
+        {
+            rc = rtZipTarFileSharedReadAt(pThis->pShared, offHdr + cbHdrs, &Hdr, sizeof(Hdr), &cbRead);
+            if (rc == VINF_SUCCESS && cbRead == 0)
+                rc = VINF_EOF;
+        }
         if (RT_FAILURE(rc))
             return pThis->rcFatal = rc;
         if (rc == VINF_EOF && cbRead == 0)
@@ -1338,10 +1637,50 @@ static DECLCALLBACK(int) rtZipTarFss_Next(void *pvThis, char **ppszName, RTVFSOB
     switch (fType)
     {
         /*
-         * Files are represented by a VFS I/O stream.
+         * Files are represented by a VFS I/O stream, or by a VFS file viewing
+         * the archive file when we've got one.
          */
         case RTFS_TYPE_FILE:
         {
+            if (pThis->pShared)
+            {
+                RTVFSFILE           hVfsFile;
+                PRTZIPTARFILEVIEW   pFileData;
+                rc = RTVfsNewFile(&g_rtZipTarFssFileOps,
+                                  sizeof(*pFileData),
+                                  RTFILE_O_READ | RTFILE_O_DENY_NONE | RTFILE_O_OPEN,
+                                  NIL_RTVFS,
+                                  NIL_RTVFSLOCK,
+                                  &hVfsFile,
+                                  (void **)&pFileData);
+                if (RT_FAILURE(rc))
+                    return pThis->rcFatal = rc;
+
+                pFileData->BaseObj.offHdr    = offHdr;
+                pFileData->BaseObj.pTarReader= NULL;
+                pFileData->BaseObj.ObjInfo   = Info;
+                pFileData->cbFile            = Info.cbObject;
+                pFileData->offFile           = 0;
+                pFileData->offStart          = pThis->offNextHdr;
+                pFileData->pShared           = pThis->pShared;
+                ASMAtomicIncU32(&pThis->pShared->cRefs);
+                pFileData->szOwner[0]        = '\0';
+                pFileData->szGroup[0]        = '\0';
+                if (rtZipTarReaderHasUserName(&pThis->TarReader))
+                    RTStrCopyEx(pFileData->szOwner, sizeof(pFileData->szOwner), pThis->TarReader.Hdr.Common.uname,
+                                sizeof(pThis->TarReader.Hdr.Common.uname));
+                if (rtZipTarReaderHasGroupName(&pThis->TarReader))
+                    RTStrCopyEx(pFileData->szGroup, sizeof(pFileData->szGroup), pThis->TarReader.Hdr.Common.gname,
+                                sizeof(pThis->TarReader.Hdr.Common.gname));
+
+                pThis->offNextHdr += Info.cbAllocated;
+
+                enmType = RTVFSOBJTYPE_FILE;
+                hVfsObj = RTVfsObjFromFile(hVfsFile);
+                RTVfsFileRelease(hVfsFile);
+                break;
+            }
+
             RTVFSIOSTREAM       hVfsIos;
             PRTZIPTARIOSTREAM   pIosData;
             rc = RTVfsNewIoStream(&g_rtZipTarFssIosOps,
@@ -1491,7 +1830,7 @@ RTDECL(int) RTZipTarFsStreamFromIoStream(RTVFSIOSTREAM hVfsIosIn, uint32_t fFlag
     AssertPtrReturn(phVfsFss, VERR_INVALID_HANDLE);
     *phVfsFss = NIL_RTVFSFSSTREAM;
     AssertPtrReturn(hVfsIosIn, VERR_INVALID_HANDLE);
-    AssertReturn(!fFlags, VERR_INVALID_PARAMETER);
+    AssertReturn(!(fFlags & ~RTZIPTAR_R_VALID_MASK), VERR_INVALID_PARAMETER);
 
     RTFOFF const offStart = RTVfsIoStrmTell(hVfsIosIn);
     AssertReturn(offStart >= 0, (int)offStart);
@@ -1511,6 +1850,7 @@ RTDECL(int) RTZipTarFsStreamFromIoStream(RTVFSIOSTREAM hVfsIosIn, uint32_t fFlag
         pThis->hVfsIos              = hVfsIosIn;
         pThis->hVfsCurObj           = NIL_RTVFSOBJ;
         pThis->pCurIosData          = NULL;
+        pThis->pShared              = NULL;
         pThis->offStart             = offStart;
         pThis->offNextHdr           = offStart;
         pThis->fEndOfStream         = false;
@@ -1522,6 +1862,39 @@ RTDECL(int) RTZipTarFsStreamFromIoStream(RTVFSIOSTREAM hVfsIosIn, uint32_t fFlag
         /* Don't check if it's a TAR stream here, do that in the
            rtZipTarFss_Next. */
 
+        /*
+         * Hand out file views if requested and the input is a file.  Quietly
+         * fall back on the I/O stream representation otherwise.
+         */
+        if (fFlags & RTZIPTAR_R_FILE_VIEWS)
+        {
+            RTVFSFILE hVfsFile = RTVfsIoStrmToFile(hVfsIosIn);
+            if (hVfsFile != NIL_RTVFSFILE)
+            {
+                PRTZIPTARFILESHARED pShared = (PRTZIPTARFILESHARED)RTMemAlloc(sizeof(*pShared));
+                if (pShared)
+                {
+                    rc = RTSemFastMutexCreate(&pShared->hFastMtx);
+                    if (RT_SUCCESS(rc))
+                    {
+                        pShared->cRefs    = 1;
+                        pShared->hVfsFile = hVfsFile;
+                        pThis->pShared    = pShared;
+                    }
+                    else
+                        RTMemFree(pShared);
+                }
+                else
+                    rc = VERR_NO_MEMORY;
+                if (RT_FAILURE(rc))
+                {
+                    RTVfsFileRelease(hVfsFile);
+                    RTVfsFsStrmRelease(hVfsFss);
+                    return rc;
+                }
+            }
+        }
+
         *phVfsFss = hVfsFss;
         return VINF_SUCCESS;
     }
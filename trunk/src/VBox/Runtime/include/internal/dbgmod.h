@@ -608,8 +608,11 @@ typedef struct RTDBGMODINT
     uint32_t            fDeferredFailed : 1;
     /** Set if the debug info is based on image exports and segments. */
     uint32_t            fExports : 1;
+    /** Set if the debug info should be loaded in full when opening the module
+     * (RTDBGCFG_FLAGS_NO_LAZY_LOADING). */
+    uint32_t            fNoLazyLoading : 1;
     /** Alignment padding. */
-    uint32_t            fPadding1 : 29;
+    uint32_t            fPadding1 : 28;
 #if ARCH_BITS == 64
     uint32_t            u32Padding2;
 #endif
@@ -0,0 +1,86 @@
+/* $Id$ */
+/** @file
+ * IPRT - Internal worker thread set header.
+ */
+
+/*
+ * Copyright (C) 2017 Oracle Corporation
+ *
+ * This file is part of VirtualBox Open Source Edition (OSE), as
+ * available from http://www.virtualbox.org. This file is free software;
+ * you can redistribute it and/or modify it under the terms of the GNU
+ * General Public License (GPL) as published by the Free Software
+ * Foundation, in version 2 as it comes in the "COPYING" file of the
+ * VirtualBox OSE distribution. VirtualBox OSE is distributed in the
+ * hope that it will be useful, but WITHOUT ANY WARRANTY of any kind.
+ *
+ * The contents of this file may alternatively be used under the terms
+ * of the Common Development and Distribution License Version 1.0
+ * (CDDL) only, as it comes in the "COPYING.CDDL" file of the
+ * VirtualBox OSE distribution, in which case the provisions of the
+ * CDDL are applicable instead of those of the GPL.
+ *
+ * You may elect to license modified versions of this file under the
+ * terms and conditions of either the GPL or the CDDL or both.
+ */
+
+#ifndef ___internal_workers_h
+#define ___internal_workers_h
+
+#include <iprt/types.h>
+#include <iprt/critsect.h>
+#include <iprt/thread.h>
+
+
+RT_C_DECLS_BEGIN
+
+/** The max number of threads in a worker thread set. */
+#define RTWORKERS_MAX_THREADS       16
+
+/**
+ * A set of worker threads picking work off a queue owned by the user.
+ *
+ * The user keeps the queue in its own structure and protects it with
+ * CritSect.  The worker threads loop like this, with the lock held:
+ * @code
+    while (!pWorkers->fTerminate)
+    {
+        // pick work, if none: rtWorkersWaitForWork(pWorkers); continue;
+        // leave the lock, do the work, enter the lock, rtWorkersSignalDone(pWorkers);
+    }
+ * @endcode
+ *
+ * fTerminate is only changed while owning CritSect, and the work event is
+ * only reset while owning it, so the termination signal cannot get lost
+ * between a thread checking the queue and going to sleep.
+ */
+typedef struct RTWORKERS
+{
+    /** Protects fTerminate and the user's work queue. */
+    RTCRITSECT          CritSect;
+    /** Signalled when work is queued or the threads should terminate. */
+    RTSEMEVENTMULTI     hEvtWork;
+    /** Signalled when a worker thread completes some work. */
+    RTSEMEVENTMULTI     hEvtDone;
+    /** Set when the threads should terminate.  Protected by CritSect. */
+    bool                fTerminate;
+    /** The number of threads. */
+    uint32_t            cThreads;
+    /** The threads. */
+    RTTHREAD            ahThreads[RTWORKERS_MAX_THREADS];
+} RTWORKERS;
+/** Pointer to a worker thread set. */
+typedef RTWORKERS *PRTWORKERS;
+
+DECLHIDDEN(int)  rtWorkersInit(PRTWORKERS pWorkers, uint32_t cThreads, PFNRTTHREAD pfnThread, void *pvUser,
+                               RTTHREADTYPE enmType, const char *pszName);
+DECLHIDDEN(void) rtWorkersDelete(PRTWORKERS pWorkers);
+DECLHIDDEN(void) rtWorkersWaitForWork(PRTWORKERS pWorkers);
+DECLHIDDEN(void) rtWorkersSignalWork(PRTWORKERS pWorkers);
+DECLHIDDEN(void) rtWorkersWaitForDone(PRTWORKERS pWorkers);
+DECLHIDDEN(void) rtWorkersSignalDone(PRTWORKERS pWorkers);
+
+RT_C_DECLS_END
+
+#endif
+
@@ -34,6 +34,7 @@
 #include <iprt/log.h>
 #include <iprt/param.h>
 #include <iprt/path.h>
+#include <iprt/sha.h>
 #include <iprt/cpp/lock.h>
 #include <iprt/cpp/xml.h>
 
@@ -2204,6 +2205,40 @@ void XmlFileWriter::write(const char *pcszFilename, bool fSafe)
     }
 }
 
+int XmlFileWriter::digest(uint8_t *pabDigest)
+{
+    AssertPtrReturn(pabDigest, VERR_INVALID_POINTER);
+
+    RTSHA256CONTEXT Ctx;
+    RTSha256Init(&Ctx);
+
+    GlobalLock lock;
+
+    /* serialize exactly like writeInternal does */
+    xmlIndentTreeOutput = 1;
+    xmlTreeIndentString = "  ";
+    xmlSaveNoEmptyTags = 0;
+
+    xmlSaveCtxtPtr saveCtxt = xmlSaveToIO(DigestCallback, CloseCallback, &Ctx, NULL, XML_SAVE_FORMAT);
+    if (!saveCtxt)
+        return VERR_NO_MEMORY;
+
+    long rcXml = xmlSaveDoc(saveCtxt, m->pDoc->m->plibDocument);
+    xmlSaveClose(saveCtxt);
+    if (rcXml == -1)
+        return VERR_GENERAL_FAILURE;
+
+    RTSha256Final(&Ctx, pabDigest);
+    return VINF_SUCCESS;
+}
+
+/*static*/ int XmlFileWriter::DigestCallback(void *pvUser, const char *pachBuf, int cbToWrite)
+{
+    if (cbToWrite > 0)
+        RTSha256Update((PRTSHA256CONTEXT)pvUser, pachBuf, (size_t)cbToWrite);
+    return cbToWrite;
+}
+
 int XmlFileWriter::WriteCallback(void *aCtxt, const char *aBuf, int aLen)
 {
     WriteContext *pContext = static_cast<WriteContext*>(aCtxt);
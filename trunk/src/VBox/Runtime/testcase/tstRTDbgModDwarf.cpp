@@ -0,0 +1,284 @@
+/* $Id$ */
+/** @file
+ * IPRT Testcase - Debug module loading and lookup performance, on demand vs. up front loading.
+ */
+
+/*
+ * Copyright (C) 2017 Oracle Corporation
+ *
+ * This file is part of VirtualBox Open Source Edition (OSE), as
+ * available from http://www.virtualbox.org. This file is free software;
+ * you can redistribute it and/or modify it under the terms of the GNU
+ * General Public License (GPL) as published by the Free Software
+ * Foundation, in version 2 as it comes in the "COPYING" file of the
+ * VirtualBox OSE distribution. VirtualBox OSE is distributed in the
+ * hope that it will be useful, but WITHOUT ANY WARRANTY of any kind.
+ *
+ * The contents of this file may alternatively be used under the terms
+ * of the Common Development and Distribution License Version 1.0
+ * (CDDL) only, as it comes in the "COPYING.CDDL" file of the
+ * VirtualBox OSE distribution, in which case the provisions of the
+ * CDDL are applicable instead of those of the GPL.
+ *
+ * You may elect to license modified versions of this file under the
+ * terms and conditions of either the GPL or the CDDL or both.
+ */
+
+
+/*********************************************************************************************************************************
+*   Header Files                                                                                                                 *
+*********************************************************************************************************************************/
+#include <iprt/dbg.h>
+
+#include <iprt/err.h>
+#include <iprt/path.h>
+#include <iprt/process.h>
+#include <iprt/rand.h>
+#include <iprt/string.h>
+#include <iprt/test.h>
+#include <iprt/time.h>
+
+
+/*********************************************************************************************************************************
+*   Defined Constants And Macros                                                                                                 *
+*********************************************************************************************************************************/
+/** Number of random addresses to look up. */
+#define TST_LOOKUPS     1000
+/** Number of symbol names to look up. */
+#define TST_NAMES       100
+
+
+/**
+ * Times opening an image with debug info and doing lookups in it.
+ *
+ * The lookups at random addresses are done twice, the first round includes
+ * loading whatever debug info is needed, the second shows the lookup cost
+ * itself.  Finally everything is loaded by asking for the counts.
+ *
+ * @param   pszFilename     The image, e.g. a vmlinux with full debug info.
+ */
+static void tstBenchImage(const char *pszFilename)
+{
+    RTTestISub(RTPathFilename(pszFilename));
+
+    uint64_t nsStart = RTTimeNanoTS();
+    RTDBGMOD hDbgMod;
+    int rc = RTDbgModCreateFromImage(&hDbgMod, pszFilename, NULL, RTLDRARCH_WHATEVER, NIL_RTDBGCFG);
+    if (RT_FAILURE(rc))
+    {
+        RTTestIFailed("RTDbgModCreateFromImage(,%s,) -> %Rrc", pszFilename, rc);
+        return;
+    }
+    RTTestIValue("open", RTTimeNanoTS() - nsStart, RTTESTUNIT_NS);
+
+    RTUINTPTR const cbImage = RTDbgModImageSize(hDbgMod);
+    RTTESTI_CHECK_RETV(cbImage > 0);
+    static RTUINTPTR s_auRvas[TST_LOOKUPS];
+    for (unsigned i = 0; i < RT_ELEMENTS(s_auRvas); i++)
+        s_auRvas[i] = RTRandU64Ex(0, cbImage - 1);
+
+    static char s_aszNames[TST_NAMES][RTDBG_SYMBOL_NAME_LENGTH];
+    unsigned    cNames = 0;
+    for (unsigned iRound = 0; iRound < 2; iRound++)
+    {
+        unsigned cHits = 0;
+        nsStart = RTTimeNanoTS();
+        for (unsigned i = 0; i < RT_ELEMENTS(s_auRvas); i++)
+        {
+            RTDBGSYMBOL SymInfo;
+            RTINTPTR    offDisp;
+            rc = RTDbgModSymbolByAddr(hDbgMod, RTDBGSEGIDX_RVA, s_auRvas[i], RTDBGSYMADDR_FLAGS_LESS_OR_EQUAL,
+                                      &offDisp, &SymInfo);
+            if (RT_SUCCESS(rc))
+            {
+                cHits++;
+                if (!iRound && cNames < RT_ELEMENTS(s_aszNames))
+                    RTStrCopy(s_aszNames[cNames++], sizeof(s_aszNames[0]), SymInfo.szName);
+            }
+        }
+        RTTestIValue(iRound ? "symbol by addr" : "symbol by addr, cold",
+                     (RTTimeNanoTS() - nsStart) / RT_ELEMENTS(s_auRvas), RTTESTUNIT_NS_PER_CALL);
+        if (!iRound)
+            RTTestIValue("symbol hits", cHits, RTTESTUNIT_OCCURRENCES);
+
+        cHits = 0;
+        nsStart = RTTimeNanoTS();
+        for (unsigned i = 0; i < RT_ELEMENTS(s_auRvas); i++)
+        {
+            RTDBGLINE LineInfo;
+            RTINTPTR  offDisp;
+            if (RT_SUCCESS(RTDbgModLineByAddr(hDbgMod, RTDBGSEGIDX_RVA, s_auRvas[i], &offDisp, &LineInfo)))
+                cHits++;
+        }
+        RTTestIValue(iRound ? "line by addr" : "line by addr, cold",
+                     (RTTimeNanoTS() - nsStart) / RT_ELEMENTS(s_auRvas), RTTESTUNIT_NS_PER_CALL);
+        if (!iRound)
+            RTTestIValue("line hits", cHits, RTTESTUNIT_OCCURRENCES);
+    }
+
+    /* The names we found must resolve. */
+    if (cNames)
+    {
+        nsStart = RTTimeNanoTS();
+        for (unsigned i = 0; i < cNames; i++)
+        {
+            RTDBGSYMBOL SymInfo;
+            rc = RTDbgModSymbolByName(hDbgMod, s_aszNames[i], &SymInfo);
+            if (RT_FAILURE(rc))
+                RTTestIFailed("RTDbgModSymbolByName(,%s,) -> %Rrc", s_aszNames[i], rc);
+        }
+        RTTestIValue("symbol by name", (RTTimeNanoTS() - nsStart) / cNames, RTTESTUNIT_NS_PER_CALL);
+    }
+
+    /* The counts require everything to be loaded. */
+    nsStart = RTTimeNanoTS();
+    uint32_t const cSymbols = RTDbgModSymbolCount(hDbgMod);
+    uint32_t const cLines   = RTDbgModLineCount(hDbgMod);
+    RTTestIValue("load everything", RTTimeNanoTS() - nsStart, RTTESTUNIT_NS);
+    RTTestIValue("symbols", cSymbols, RTTESTUNIT_OCCURRENCES);
+    RTTestIValue("lines", cLines, RTTESTUNIT_OCCURRENCES);
+
+    RTDbgModRelease(hDbgMod);
+}
+
+
+/**
+ * Gets the RVA of a symbol returned by a lookup.
+ */
+static RTUINTPTR tstSymRva(RTDBGMOD hDbgMod, PCRTDBGSYMBOL pSymInfo)
+{
+    return RTDbgModSegmentRva(hDbgMod, pSymInfo->iSeg) + pSymInfo->Value;
+}
+
+
+/**
+ * Checks that lookups with the debug info loaded on demand give the same
+ * results as when everything is loaded up front.
+ *
+ * A name defined by more than one compilation unit may legitimately resolve
+ * differently, as only the first unit loaded gets to add it.
+ *
+ * @param   pszFilename     The image.
+ */
+static void tstCompareLazyEager(const char *pszFilename)
+{
+    RTTestISubF("%s: on demand vs up front", RTPathFilename(pszFilename));
+
+    RTDBGCFG hDbgCfg;
+    RTTESTI_CHECK_RC_RETV(RTDbgCfgCreate(&hDbgCfg, NULL, false /*fNativePaths*/), VINF_SUCCESS);
+    RTTESTI_CHECK_RC(RTDbgCfgChangeUInt(hDbgCfg, RTDBGCFGPROP_FLAGS, RTDBGCFGOP_SET, RTDBGCFG_FLAGS_NO_LAZY_LOADING),
+                     VINF_SUCCESS);
+    RTDBGMOD hEager = NIL_RTDBGMOD;
+    RTTESTI_CHECK_RC(RTDbgModCreateFromImage(&hEager, pszFilename, NULL, RTLDRARCH_WHATEVER, hDbgCfg), VINF_SUCCESS);
+    RTDbgCfgRelease(hDbgCfg);
+    RTDBGMOD hLazy = NIL_RTDBGMOD;
+    RTTESTI_CHECK_RC(RTDbgModCreateFromImage(&hLazy, pszFilename, NULL, RTLDRARCH_WHATEVER, NIL_RTDBGCFG), VINF_SUCCESS);
+    RTDBGMOD hLazyByName = NIL_RTDBGMOD;
+    RTTESTI_CHECK_RC(RTDbgModCreateFromImage(&hLazyByName, pszFilename, NULL, RTLDRARCH_WHATEVER, NIL_RTDBGCFG),
+                     VINF_SUCCESS);
+
+    RTUINTPTR const cbImage = hEager != NIL_RTDBGMOD ? RTDbgModImageSize(hEager) : 0;
+    if (RTTestIErrorCount() == 0 && cbImage > 0)
+    {
+        /*
+         * Symbols by address, collecting the names that matched.
+         */
+        static char s_aszNames[TST_NAMES][RTDBG_SYMBOL_NAME_LENGTH];
+        unsigned    cNames = 0;
+        unsigned    cDuplicates = 0;
+        for (unsigned i = 0; i < TST_LOOKUPS; i++)
+        {
+            RTUINTPTR const uRva = RTRandU64Ex(0, cbImage - 1);
+            RTDBGSYMBOL     LazySym, EagerSym;
+            RTINTPTR        offLazyDisp = 0, offEagerDisp = 0;
+            int rcLazy  = RTDbgModSymbolByAddr(hLazy, RTDBGSEGIDX_RVA, uRva, RTDBGSYMADDR_FLAGS_LESS_OR_EQUAL,
+                                               &offLazyDisp, &LazySym);
+            int rcEager = RTDbgModSymbolByAddr(hEager, RTDBGSEGIDX_RVA, uRva, RTDBGSYMADDR_FLAGS_LESS_OR_EQUAL,
+                                               &offEagerDisp, &EagerSym);
+            if (RT_FAILURE(rcLazy) && RT_FAILURE(rcEager))
+                continue;
+            if (   RT_SUCCESS(rcLazy)
+                && RT_SUCCESS(rcEager)
+                && offLazyDisp == offEagerDisp
+                && !strcmp(LazySym.szName, EagerSym.szName))
+            {
+                if (cNames < RT_ELEMENTS(s_aszNames))
+                    RTStrCopy(s_aszNames[cNames++], sizeof(s_aszNames[0]), LazySym.szName);
+                continue;
+            }
+
+            RTDBGSYMBOL DupSym;
+            if (   RT_SUCCESS(rcLazy)
+                && RT_SUCCESS(RTDbgModSymbolByName(hEager, LazySym.szName, &DupSym))
+                && tstSymRva(hEager, &DupSym) != tstSymRva(hLazy, &LazySym))
+                cDuplicates++;
+            else
+                RTTestIFailed("RVA %#RTptr: on demand %Rrc %s%+RTptr, up front %Rrc %s%+RTptr", uRva,
+                              rcLazy, RT_SUCCESS(rcLazy) ? LazySym.szName : "", offLazyDisp,
+                              rcEager, RT_SUCCESS(rcEager) ? EagerSym.szName : "", offEagerDisp);
+        }
+        RTTestIValue("duplicate names", cDuplicates, RTTESTUNIT_OCCURRENCES);
+
+        /*
+         * Symbols by name, using a module that hasn't loaded anything yet.
+         */
+        for (unsigned i = 0; i < cNames; i++)
+        {
+            RTDBGSYMBOL LazySym, EagerSym;
+            int rcLazy  = RTDbgModSymbolByName(hLazyByName, s_aszNames[i], &LazySym);
+            int rcEager = RTDbgModSymbolByName(hEager, s_aszNames[i], &EagerSym);
+            if (   RT_FAILURE(rcLazy)
+                || RT_FAILURE(rcEager)
+                || tstSymRva(hLazyByName, &LazySym) != tstSymRva(hEager, &EagerSym))
+                RTTestIFailed("%s: on demand %Rrc %#RTptr, up front %Rrc %#RTptr", s_aszNames[i],
+                              rcLazy, RT_SUCCESS(rcLazy) ? tstSymRva(hLazyByName, &LazySym) : 0,
+                              rcEager, RT_SUCCESS(rcEager) ? tstSymRva(hEager, &EagerSym) : 0);
+        }
+
+        /*
+         * Everything loaded, including the image symbols.
+         */
+        RTTESTI_CHECK_MSG(RTDbgModSymbolCount(hLazyByName) == RTDbgModSymbolCount(hEager),
+                          ("%u vs %u symbols\n", RTDbgModSymbolCount(hLazyByName), RTDbgModSymbolCount(hEager)));
+        RTTESTI_CHECK_MSG(RTDbgModLineCount(hLazyByName) == RTDbgModLineCount(hEager),
+                          ("%u vs %u lines\n", RTDbgModLineCount(hLazyByName), RTDbgModLineCount(hEager)));
+    }
+
+    RTDbgModRelease(hLazyByName);
+    RTDbgModRelease(hLazy);
+    RTDbgModRelease(hEager);
+}
+
+
+int main(int argc, char **argv)
+{
+    RTTEST hTest;
+    RTEXITCODE rcExit = RTTestInitAndCreate("tstRTDbgModDwarf", &hTest);
+    if (rcExit != RTEXITCODE_SUCCESS)
+        return rcExit;
+    RTTestBanner(hTest);
+
+    /*
+     * Takes the images to examine on the command line, defaulting to ourselves.
+     */
+    if (argc > 1)
+        for (int i = 1; i < argc; i++)
+        {
+            tstCompareLazyEager(argv[i]);
+            tstBenchImage(argv[i]);
+        }
+    else
+    {
+        char szExecPath[RTPATH_MAX];
+        if (RTProcGetExecutablePath(szExecPath, sizeof(szExecPath)))
+        {
+            tstCompareLazyEager(szExecPath);
+            tstBenchImage(szExecPath);
+        }
+        else
+            RTTestIFailed("RTProcGetExecutablePath failed");
+    }
+
+    return RTTestSummaryAndDestroy(hTest);
+}
+
@@ -29,15 +29,79 @@
 *   Header Files                                                                                                                 *
 *********************************************************************************************************************************/
 #include <iprt/vfs.h>
+#include <iprt/dir.h>
+#include <iprt/env.h>
 #include <iprt/err.h>
+#include <iprt/fsvfs.h>
+#include <iprt/getopt.h>
 #include <iprt/test.h>
 #include <iprt/file.h>
+#include <iprt/handle.h>
+#include <iprt/mem.h>
+#include <iprt/path.h>
+#include <iprt/process.h>
+#include <iprt/rand.h>
 #include <iprt/string.h>
+#include <iprt/time.h>
+
+
+/*********************************************************************************************************************************
+*   Defined Constants And Macros                                                                                                 *
+*********************************************************************************************************************************/
+/** The size of the FAT32 image used for benchmarking. */
+#define TST_FAT_IMAGE_SIZE      (_1G + _512M)
+/** The size of the large file in the FAT32 benchmark. */
+#define TST_FAT_FILE_SIZE       (128 * _1M)
+/** The size of the FAT32 image used for the quick check.  With 512 byte
+ *  clusters this gives a FAT of about 770KB, which is large enough to be
+ *  cached in pieces (more than 512KB) and to make the volume FAT32. */
+#define TST_FAT_QUICK_IMAGE_SIZE (_64M + _32M)
+/** The size of the large file in the quick FAT32 check. */
+#define TST_FAT_QUICK_FILE_SIZE _4M
+/** The I/O size for the sequential parts of the FAT32 benchmark. */
+#define TST_FAT_SEQ_IO_SIZE     _64K
+/** The I/O size for the random parts of the FAT32 benchmark. */
+#define TST_FAT_RND_IO_SIZE     _4K
+/** Number of small files to create in the FAT32 benchmark. */
+#define TST_FAT_SMALL_FILES     48
+/** The read size used by the walk benchmark. */
+#define TST_WALK_IO_SIZE        _64K
+/** The size of the ext4 image generated for the quick check. */
+#define TST_EXT_IMAGE_SIZE      "16M"
+/** The size of the large file in the ext4 check, a bit more than 3MB so it
+ *  needs several extents worth of blocks and doesn't end on a block boundary. */
+#define TST_EXT_BIG_FILE_SIZE   (_2M + _1M + 1020)
+/** Number of files in the directory of the ext4 check that gets a hash tree
+ *  index. */
+#define TST_EXT_MANY_FILES      500
 
 
 /*********************************************************************************************************************************
 *   Structures and Typedefs                                                                                                      *
 *********************************************************************************************************************************/
+/**
+ * Statistics gathered by the image walk benchmark.
+ */
+typedef struct TSTRTFSWALKSTATS
+{
+    /** Number of directories opened. */
+    uint64_t    cDirs;
+    /** Number of regular files opened. */
+    uint64_t    cFiles;
+    /** Number of other entries (symlinks, devices, ...). */
+    uint64_t    cOthers;
+    /** Bytes of file data read. */
+    uint64_t    cbRead;
+    /** Nanoseconds spent opening files and directories. */
+    uint64_t    cNsOpen;
+    /** Nanoseconds spent reading directories. */
+    uint64_t    cNsReadDir;
+    /** Nanoseconds spent reading file data. */
+    uint64_t    cNsRead;
+} TSTRTFSWALKSTATS;
+/** Pointer to walk benchmark statistics. */
+typedef TSTRTFSWALKSTATS *PTSTRTFSWALKSTATS;
+
 
 static int tstRTFilesystem(RTTEST hTest, RTVFSFILE hVfsFile)
 {
@@ -94,6 +158,607 @@ static int tstRTFilesystem(RTTEST hTest, RTVFSFILE hVfsFile)
     return rc;
 }
 
+
+/**
+ * Fills @a pvBuf with a pattern identifying the file offset @a off.
+ */
+static void tstRTFsFatFillPattern(void *pvBuf, size_t cb, uint64_t off)
+{
+    uint32_t *pu32 = (uint32_t *)pvBuf;
+    for (size_t i = 0; i < cb / sizeof(uint32_t); i++)
+        pu32[i] = (uint32_t)(off / sizeof(uint32_t) + i) ^ UINT32_C(0x5a5aa5a5);
+}
+
+
+/**
+ * Checks the pattern written by tstRTFsFatFillPattern.
+ */
+static bool tstRTFsFatCheckPattern(void const *pvBuf, size_t cb, uint64_t off)
+{
+    uint32_t const *pu32 = (uint32_t const *)pvBuf;
+    for (size_t i = 0; i < cb / sizeof(uint32_t); i++)
+        if (pu32[i] != ((uint32_t)(off / sizeof(uint32_t) + i) ^ UINT32_C(0x5a5aa5a5)))
+            return false;
+    return true;
+}
+
+
+/**
+ * Sequential and random file access on a FAT32 image, plus a bunch of small
+ * files for the FAT and directory metadata paths.
+ *
+ * The image is remounted before reading, so everything read back has gone thru
+ * the FAT and directory write-back caches.
+ *
+ * @param   hTest       The test handle.
+ * @param   fBenchmark  Whether to use a large image and report the timings,
+ *                      or just do a quick check on a small image.
+ */
+static void tstRTFsFatBenchmark(RTTEST hTest, bool fBenchmark)
+{
+    RTTestSub(hTest, fBenchmark ? "FAT32 benchmark" : "FAT32");
+    uint64_t const cbImage            = fBenchmark ? TST_FAT_IMAGE_SIZE : TST_FAT_QUICK_IMAGE_SIZE;
+    uint32_t const cbBigFile          = fBenchmark ? TST_FAT_FILE_SIZE  : TST_FAT_QUICK_FILE_SIZE;
+    uint16_t const cSectorsPerCluster = fBenchmark ? 8 : 1;
+    uint32_t const cRandomReads       = fBenchmark ? 4096 : 256;
+
+    char     szImage[RTPATH_MAX];
+    RTFILE   hFile;
+    int rc = RTFileOpenTemp(&hFile, szImage, sizeof(szImage), RTFILE_O_CREATE | RTFILE_O_READWRITE | RTFILE_O_DENY_NONE);
+    if (RT_FAILURE(rc))
+    {
+        RTTestSkipped(hTest, "RTFileOpenTemp -> %Rrc", rc);
+        return;
+    }
+    RTVFSFILE hVfsImg = NIL_RTVFSFILE;
+    rc = RTVfsFileFromRTFile(hFile, RTFILE_O_READWRITE | RTFILE_O_DENY_NONE | RTFILE_O_OPEN, false /*fLeaveOpen*/, &hVfsImg);
+    RTTESTI_CHECK_RC_OK(rc);
+    if (RT_FAILURE(rc))
+        RTFileClose(hFile);
+    if (RT_SUCCESS(rc))
+        RTTESTI_CHECK_RC_OK(rc = RTVfsFileSetSize(hVfsImg, cbImage, RTVFSFILE_SIZE_F_NORMAL));
+    if (RT_SUCCESS(rc))
+        RTTESTI_CHECK_RC_OK(rc = RTFsFatVolFormat(hVfsImg, 0, 0, RTFSFATVOL_FMT_F_QUICK, 512, cSectorsPerCluster, RTFSFATTYPE_FAT32,
+                                                  0, 0, 0, 0, 0, NULL));
+    uint8_t *pbBuf = (uint8_t *)RTMemAlloc(TST_FAT_SEQ_IO_SIZE);
+    if (!pbBuf && RT_SUCCESS(rc))
+    {
+        RTTestFailed(hTest, "Out of memory");
+        rc = VERR_NO_MEMORY;
+    }
+
+    /*
+     * Write the large file sequentially and create the small files.
+     */
+    RTVFS hVfs = NIL_RTVFS;
+    if (RT_SUCCESS(rc))
+        RTTESTI_CHECK_RC_OK(rc = RTFsFatVolOpen(hVfsImg, false /*fReadOnly*/, 0 /*offBootSector*/, &hVfs, NULL));
+    if (RT_SUCCESS(rc))
+    {
+        RTVFSFILE hVfsFile;
+        RTTESTI_CHECK_RC_OK(rc = RTVfsFileOpen(hVfs, "/BIG.BIN", RTFILE_O_CREATE | RTFILE_O_READWRITE | RTFILE_O_DENY_NONE,
+                                               &hVfsFile));
+        if (RT_SUCCESS(rc))
+        {
+            uint64_t nsStart = RTTimeNanoTS();
+            for (uint32_t off = 0; off < cbBigFile && RT_SUCCESS(rc); off += TST_FAT_SEQ_IO_SIZE)
+            {
+                tstRTFsFatFillPattern(pbBuf, TST_FAT_SEQ_IO_SIZE, off);
+                RTTESTI_CHECK_RC_OK(rc = RTVfsFileWrite(hVfsFile, pbBuf, TST_FAT_SEQ_IO_SIZE, NULL));
+            }
+            RTTESTI_CHECK_RC_OK(RTVfsFileFlush(hVfsFile));
+            uint64_t cNsElapsed = RT_MAX(RTTimeNanoTS() - nsStart, 1);
+            if (fBenchmark)
+                RTTestValue(hTest, "Sequential write", (uint64_t)cbBigFile * RT_NS_1SEC / cNsElapsed,
+                            RTTESTUNIT_BYTES_PER_SEC);
+            RTVfsFileRelease(hVfsFile);
+        }
+
+        uint64_t nsStart = RTTimeNanoTS();
+        for (uint32_t i = 0; i < TST_FAT_SMALL_FILES && RT_SUCCESS(rc); i++)
+        {
+            char szName[32];
+            RTStrPrintf(szName, sizeof(szName), "/SMALL%03u.DAT", i);
+            RTTESTI_CHECK_RC_OK(rc = RTVfsFileOpen(hVfs, szName, RTFILE_O_CREATE | RTFILE_O_READWRITE | RTFILE_O_DENY_NONE,
+                                                   &hVfsFile));
+            if (RT_SUCCESS(rc))
+            {
+                tstRTFsFatFillPattern(pbBuf, TST_FAT_RND_IO_SIZE, i);
+                RTTESTI_CHECK_RC_OK(rc = RTVfsFileWrite(hVfsFile, pbBuf, TST_FAT_RND_IO_SIZE, NULL));
+                RTVfsFileRelease(hVfsFile);
+            }
+        }
+        if (fBenchmark)
+            RTTestValue(hTest, "Small file create", (RTTimeNanoTS() - nsStart) / TST_FAT_SMALL_FILES,
+                        RTTESTUNIT_NS_PER_OCCURRENCE);
+
+        RTVfsRelease(hVfs);
+        hVfs = NIL_RTVFS;
+    }
+
+    /*
+     * Remount read-only and read it all back.
+     */
+    if (RT_SUCCESS(rc))
+        RTTESTI_CHECK_RC_OK(rc = RTFsFatVolOpen(hVfsImg, true /*fReadOnly*/, 0 /*offBootSector*/, &hVfs, NULL));
+    if (RT_SUCCESS(rc))
+    {
+        RTVFSFILE hVfsFile;
+        RTTESTI_CHECK_RC_OK(rc = RTVfsFileOpen(hVfs, "/BIG.BIN", RTFILE_O_OPEN | RTFILE_O_READ | RTFILE_O_DENY_NONE, &hVfsFile));
+        if (RT_SUCCESS(rc))
+        {
+            uint64_t cbFile = 0;
+            RTTESTI_CHECK_RC_OK(RTVfsFileGetSize(hVfsFile, &cbFile));
+            RTTESTI_CHECK(cbFile == cbBigFile);
+
+            uint64_t nsStart = RTTimeNanoTS();
+            for (uint32_t off = 0; off < cbBigFile && RT_SUCCESS(rc); off += TST_FAT_SEQ_IO_SIZE)
+            {
+                RTTESTI_CHECK_RC_OK(rc = RTVfsFileRead(hVfsFile, pbBuf, TST_FAT_SEQ_IO_SIZE, NULL));
+                RTTESTI_CHECK(tstRTFsFatCheckPattern(pbBuf, TST_FAT_SEQ_IO_SIZE, off));
+            }
+            uint64_t cNsElapsed = RT_MAX(RTTimeNanoTS() - nsStart, 1);
+            if (fBenchmark)
+                RTTestValue(hTest, "Sequential read", (uint64_t)cbBigFile * RT_NS_1SEC / cNsElapsed,
+                            RTTESTUNIT_BYTES_PER_SEC);
+
+            nsStart = RTTimeNanoTS();
+            for (uint32_t i = 0; i < cRandomReads && RT_SUCCESS(rc); i++)
+            {
+                uint32_t off = RTRandU32Ex(0, cbBigFile / TST_FAT_RND_IO_SIZE - 1) * TST_FAT_RND_IO_SIZE;
+                RTTESTI_CHECK_RC_OK(rc = RTVfsFileReadAt(hVfsFile, off, pbBuf, TST_FAT_RND_IO_SIZE, NULL));
+                RTTESTI_CHECK(tstRTFsFatCheckPattern(pbBuf, TST_FAT_RND_IO_SIZE, off));
+            }
+            if (fBenchmark)
+                RTTestValue(hTest, "Random read", (RTTimeNanoTS() - nsStart) / cRandomReads, RTTESTUNIT_NS_PER_OCCURRENCE);
+            RTVfsFileRelease(hVfsFile);
+        }
+
+        for (uint32_t i = 0; i < TST_FAT_SMALL_FILES && RT_SUCCESS(rc); i++)
+        {
+            char szName[32];
+            RTStrPrintf(szName, sizeof(szName), "/SMALL%03u.DAT", i);
+            RTTESTI_CHECK_RC_OK(rc = RTVfsFileOpen(hVfs, szName, RTFILE_O_OPEN | RTFILE_O_READ | RTFILE_O_DENY_NONE, &hVfsFile));
+            if (RT_SUCCESS(rc))
+            {
+                RTTESTI_CHECK_RC_OK(rc = RTVfsFileRead(hVfsFile, pbBuf, TST_FAT_RND_IO_SIZE, NULL));
+                RTTESTI_CHECK(tstRTFsFatCheckPattern(pbBuf, TST_FAT_RND_IO_SIZE, i));
+                RTVfsFileRelease(hVfsFile);
+            }
+        }
+        RTVfsRelease(hVfs);
+    }
+
+    RTMemFree(pbBuf);
+    RTVfsFileRelease(hVfsImg);
+    RTFileDelete(szImage);
+}
+
+
+/**
+ * Recursively walks a directory, opening and reading all regular files.
+ *
+ * @returns IPRT status code.
+ * @param   hVfsDir     The directory to walk.
+ * @param   pStats      The statistics to update.
+ * @param   pbBuf       Read buffer, TST_WALK_IO_SIZE bytes.
+ * @param   cDepth      Recursion depth.
+ */
+static int tstRTFsWalkDir(RTVFSDIR hVfsDir, PTSTRTFSWALKSTATS pStats, uint8_t *pbBuf, unsigned cDepth)
+{
+    union
+    {
+        RTDIRENTRYEX    Entry;
+        uint8_t         abPadding[RT_UOFFSETOF(RTDIRENTRYEX, szName) + 260];
+    } uBuf;
+
+    int rc = VINF_SUCCESS;
+    for (;;)
+    {
+        size_t   cbEntry = sizeof(uBuf);
+        uint64_t nsStart = RTTimeNanoTS();
+        int rc2 = RTVfsDirReadEx(hVfsDir, &uBuf.Entry, &cbEntry, RTFSOBJATTRADD_UNIX);
+        pStats->cNsReadDir += RTTimeNanoTS() - nsStart;
+        if (rc2 == VERR_NO_MORE_FILES)
+            break;
+        if (RT_FAILURE(rc2))
+        {
+            RTTestIFailed("RTVfsDirReadEx -> %Rrc", rc2);
+            return rc2;
+        }
+        if (RTDirEntryExIsStdDotLink(&uBuf.Entry))
+            continue;
+
+        if (RTFS_IS_DIRECTORY(uBuf.Entry.Info.Attr.fMode))
+        {
+            if (cDepth >= 64)
+                continue;
+            RTVFSDIR hVfsSubDir;
+            nsStart = RTTimeNanoTS();
+            rc2 = RTVfsDirOpenDir(hVfsDir, uBuf.Entry.szName, 0 /*fFlags*/, &hVfsSubDir);
+            pStats->cNsOpen += RTTimeNanoTS() - nsStart;
+            if (RT_SUCCESS(rc2))
+            {
+                pStats->cDirs++;
+                rc2 = tstRTFsWalkDir(hVfsSubDir, pStats, pbBuf, cDepth + 1);
+                RTVfsDirRelease(hVfsSubDir);
+            }
+            else
+                RTTestIFailed("RTVfsDirOpenDir(,%s,) -> %Rrc", uBuf.Entry.szName, rc2);
+        }
+        else if (RTFS_IS_FILE(uBuf.Entry.Info.Attr.fMode))
+        {
+            RTVFSFILE hVfsFile;
+            nsStart = RTTimeNanoTS();
+            rc2 = RTVfsDirOpenFile(hVfsDir, uBuf.Entry.szName, RTFILE_O_OPEN | RTFILE_O_READ | RTFILE_O_DENY_NONE, &hVfsFile);
+            pStats->cNsOpen += RTTimeNanoTS() - nsStart;
+            if (RT_SUCCESS(rc2))
+            {
+                pStats->cFiles++;
+                nsStart = RTTimeNanoTS();
+                for (;;)
+                {
+                    size_t cbRead = 0;
+                    rc2 = RTVfsFileRead(hVfsFile, pbBuf, TST_WALK_IO_SIZE, &cbRead);
+                    pStats->cbRead += cbRead;
+                    if (RT_FAILURE(rc2) || rc2 == VINF_EOF || cbRead == 0)
+                        break;
+                }
+                pStats->cNsRead += RTTimeNanoTS() - nsStart;
+                if (RT_FAILURE(rc2))
+                    RTTestIFailed("RTVfsFileRead(%s) -> %Rrc", uBuf.Entry.szName, rc2);
+                RTVfsFileRelease(hVfsFile);
+            }
+            else
+                RTTestIFailed("RTVfsDirOpenFile(,%s,) -> %Rrc", uBuf.Entry.szName, rc2);
+        }
+        else
+            pStats->cOthers++;
+
+        if (RT_FAILURE(rc2) && RT_SUCCESS(rc))
+            rc = rc2;
+    }
+    return rc;
+}
+
+
+/**
+ * Mounts the image read-only and walks the whole directory tree, reading every
+ * regular file.
+ *
+ * This is mainly for benchmarking the metadata paths of the readers.  For ext4
+ * a suitable image with hash tree indexed directories can be generated with:
+ * @verbatim
+   mke2fs -t ext4 -d <populated-dir> ext4.img 4G
+   e2fsck -fyD ext4.img
+   @endverbatim
+ */
+static int tstRTFsWalkBenchmark(RTTEST hTest, RTVFSFILE hVfsFile)
+{
+    RTTestSub(hTest, "Walk benchmark");
+
+    RTVFS hVfs = NIL_RTVFS;
+    int rc = RTVfsMountVol(hVfsFile, RTVFSMNT_F_READ_ONLY, &hVfs, NULL);
+    if (RT_FAILURE(rc))
+    {
+        RTTestIFailed("RTVfsMountVol -> %Rrc", rc);
+        return rc;
+    }
+
+    uint8_t *pbBuf = (uint8_t *)RTMemAlloc(TST_WALK_IO_SIZE);
+    RTVFSDIR hVfsRoot;
+    if (pbBuf)
+        rc = RTVfsOpenRoot(hVfs, &hVfsRoot);
+    else
+        rc = VERR_NO_MEMORY;
+    if (RT_SUCCESS(rc))
+    {
+        TSTRTFSWALKSTATS Stats;
+        RT_ZERO(Stats);
+        uint64_t const nsStart = RTTimeNanoTS();
+        rc = tstRTFsWalkDir(hVfsRoot, &Stats, pbBuf, 0);
+        uint64_t const cNsElapsed = RT_MAX(RTTimeNanoTS() - nsStart, 1);
+        RTVfsDirRelease(hVfsRoot);
+
+        RTTestValue(hTest, "Directories", Stats.cDirs, RTTESTUNIT_OCCURRENCES);
+        RTTestValue(hTest, "Files", Stats.cFiles, RTTESTUNIT_OCCURRENCES);
+        RTTestValue(hTest, "Other entries", Stats.cOthers, RTTESTUNIT_OCCURRENCES);
+        RTTestValue(hTest, "Total time", cNsElapsed, RTTESTUNIT_NS);
+        RTTestValue(hTest, "Directory reading", Stats.cNsReadDir, RTTESTUNIT_NS);
+        RTTestValue(hTest, "Opening", Stats.cNsOpen, RTTESTUNIT_NS);
+        if (Stats.cFiles + Stats.cDirs)
+            RTTestValue(hTest, "Open", Stats.cNsOpen / (Stats.cFiles + Stats.cDirs), RTTESTUNIT_NS_PER_OCCURRENCE);
+        /* Bytes times nanoseconds overflows for large images, and dividing
+           first loses too much precision for small ones. */
+        RTTestValue(hTest, "File read", (uint64_t)((double)Stats.cbRead * RT_NS_1SEC / RT_MAX(Stats.cNsRead, 1)),
+                    RTTESTUNIT_BYTES_PER_SEC);
+    }
+    else
+        RTTestIFailed("RTVfsOpenRoot -> %Rrc", rc);
+
+    RTMemFree(pbBuf);
+    RTVfsRelease(hVfs);
+    return rc;
+}
+
+
+/**
+ * Runs a tool with its output going to the bit bucket.
+ *
+ * @returns IPRT status code.
+ * @param   papszArgs   The arguments, the first one being the tool name.
+ * @param   piExitCode  Where to return the exit code, -1 if it didn't exit
+ *                      normally.
+ */
+static int tstRTFsRunTool(const char **papszArgs, int *piExitCode)
+{
+    RTHANDLE hNull;
+    hNull.enmType = RTHANDLETYPE_FILE;
+    int rc = RTFileOpenBitBucket(&hNull.u.hFile, RTFILE_O_WRITE);
+    if (RT_FAILURE(rc))
+        return rc;
+
+    /* The e2fsprogs tools usually live in sbin, which often isn't in the PATH. */
+    static const char * const s_apszDirs[] = { NULL, "/sbin", "/usr/sbin" };
+    for (unsigned i = 0; i < RT_ELEMENTS(s_apszDirs); i++)
+    {
+        char szExec[RTPATH_MAX];
+        if (s_apszDirs[i])
+            rc = RTPathJoin(szExec, sizeof(szExec), s_apszDirs[i], papszArgs[0]);
+        else
+            rc = RTStrCopy(szExec, sizeof(szExec), papszArgs[0]);
+        if (RT_FAILURE(rc))
+            break;
+
+        RTPROCESS hProcess;
+        rc = RTProcCreateEx(szExec, papszArgs, RTENV_DEFAULT, s_apszDirs[i] ? 0 : RTPROC_FLAGS_SEARCH_PATH,
+                            NULL /*phStdIn*/, &hNull, &hNull, NULL /*pszAsUser*/, NULL /*pszPassword*/, &hProcess);
+        if (RT_SUCCESS(rc))
+        {
+            RTPROCSTATUS Status;
+            rc = RTProcWait(hProcess, RTPROCWAIT_FLAGS_BLOCK, &Status);
+            if (RT_SUCCESS(rc))
+                *piExitCode = Status.enmReason == RTPROCEXITREASON_NORMAL ? Status.iStatus : -1;
+            break;
+        }
+    }
+
+    RTFileClose(hNull.u.hFile);
+    return rc;
+}
+
+
+/**
+ * Creates a file for the ext4 check.
+ *
+ * @returns IPRT status code.
+ * @param   pszDir      The directory.
+ * @param   pszName     The file name.
+ * @param   pvData      The file content.
+ * @param   cbData      The size of the file content.
+ */
+static int tstRTFsExtCreateFile(const char *pszDir, const char *pszName, void const *pvData, size_t cbData)
+{
+    char szPath[RTPATH_MAX];
+    int rc = RTPathJoin(szPath, sizeof(szPath), pszDir, pszName);
+    if (RT_SUCCESS(rc))
+    {
+        RTFILE hFile;
+        rc = RTFileOpen(&hFile, szPath, RTFILE_O_CREATE | RTFILE_O_WRITE | RTFILE_O_DENY_NONE);
+        if (RT_SUCCESS(rc))
+        {
+            if (cbData)
+                rc = RTFileWrite(hFile, pvData, cbData, NULL);
+            int rc2 = RTFileClose(hFile);
+            if (RT_SUCCESS(rc))
+                rc = rc2;
+        }
+    }
+    return rc;
+}
+
+
+/**
+ * Populates the directory tree the ext4 check image is generated from.
+ *
+ * @returns IPRT status code.
+ * @param   pszDir      The (empty) directory to populate.
+ * @param   pbBig       The content of the big file, TST_EXT_BIG_FILE_SIZE
+ *                      bytes.
+ * @param   pcbTotal    Where to return the total size of all the files.
+ */
+static int tstRTFsExtPopulate(const char *pszDir, uint8_t const *pbBig, uint64_t *pcbTotal)
+{
+    *pcbTotal = TST_EXT_BIG_FILE_SIZE + 1000 + 4096;
+    char szPath[RTPATH_MAX];
+    int rc = tstRTFsExtCreateFile(pszDir, "big.dat", pbBig, TST_EXT_BIG_FILE_SIZE);
+    if (RT_SUCCESS(rc))
+        rc = tstRTFsExtCreateFile(pszDir, "small.dat", pbBig, 1000);
+    if (RT_SUCCESS(rc))
+        rc = tstRTFsExtCreateFile(pszDir, "empty", NULL, 0);
+
+    if (RT_SUCCESS(rc))
+        rc = RTPathJoin(szPath, sizeof(szPath), pszDir, "deep/a/b/c/d");
+    if (RT_SUCCESS(rc))
+        rc = RTDirCreateFullPath(szPath, 0755);
+    if (RT_SUCCESS(rc))
+        rc = tstRTFsExtCreateFile(szPath, "leaf.dat", pbBig, 4096);
+
+    if (RT_SUCCESS(rc))
+        rc = RTPathJoin(szPath, sizeof(szPath), pszDir, "many");
+    if (RT_SUCCESS(rc))
+        rc = RTDirCreate(szPath, 0755, 0);
+    for (uint32_t i = 0; i < TST_EXT_MANY_FILES && RT_SUCCESS(rc); i++)
+    {
+        char szName[64];
+        char szContent[32];
+        RTStrPrintf(szName, sizeof(szName), "file-with-a-somewhat-longer-name-%04u.txt", i);
+        size_t const cchContent = RTStrPrintf(szContent, sizeof(szContent), "%u\n", i);
+        rc = tstRTFsExtCreateFile(szPath, szName, szContent, cchContent);
+        *pcbTotal += cchContent;
+    }
+    return rc;
+}
+
+
+/**
+ * Checks the content of a file on the ext4 check image.
+ *
+ * @param   hVfs        The mounted image.
+ * @param   pszPath     The path of the file.
+ * @param   pvExpected  The expected content.
+ * @param   cbExpected  The expected size.
+ */
+static void tstRTFsExtCheckFile(RTVFS hVfs, const char *pszPath, void const *pvExpected, size_t cbExpected)
+{
+    RTVFSFILE hVfsFile;
+    int rc = RTVfsFileOpen(hVfs, pszPath, RTFILE_O_OPEN | RTFILE_O_READ | RTFILE_O_DENY_NONE, &hVfsFile);
+    if (RT_FAILURE(rc))
+    {
+        RTTestIFailed("RTVfsFileOpen(,%s,) -> %Rrc", pszPath, rc);
+        return;
+    }
+
+    uint64_t cbFile = 0;
+    RTTESTI_CHECK_RC_OK(RTVfsFileGetSize(hVfsFile, &cbFile));
+    RTTESTI_CHECK_MSG(cbFile == cbExpected, ("%s: %RU64, expected %zu\n", pszPath, cbFile, cbExpected));
+
+    uint8_t *pbBuf = (uint8_t *)RTMemAlloc(cbExpected + 1);
+    if (pbBuf)
+    {
+        size_t cbRead = 0;
+        rc = RTVfsFileRead(hVfsFile, pbBuf, cbExpected + 1, &cbRead);
+        if (RT_SUCCESS(rc))
+            RTTESTI_CHECK_MSG(cbRead == cbExpected && !memcmp(pbBuf, pvExpected, cbExpected),
+                              ("%s: content mismatch (cbRead=%zu)\n", pszPath, cbRead));
+        else
+            RTTestIFailed("RTVfsFileRead(%s) -> %Rrc", pszPath, rc);
+        RTMemFree(pbBuf);
+    }
+    else
+        RTTestIFailed("Out of memory");
+    RTVfsFileRelease(hVfsFile);
+}
+
+
+/**
+ * Generates a small ext4 image with mke2fs and checks that all of it can be
+ * walked and read.
+ *
+ * The image has an extent mapped file of a few MB, a deep directory chain and
+ * a directory big enough for e2fsck -D to give it a hash tree index.  Skipped
+ * when mke2fs isn't available or too old for populating the image (-d).
+ *
+ * @param   hTest       The test handle.
+ */
+static void tstRTFsExtCheck(RTTEST hTest)
+{
+    RTTestSub(hTest, "ext4");
+
+    char szDir[RTPATH_MAX];
+    int rc = RTPathTemp(szDir, sizeof(szDir));
+    if (RT_SUCCESS(rc))
+        rc = RTPathAppend(szDir, sizeof(szDir), "tstRTFilesystem-ext4-XXXXXX");
+    if (RT_SUCCESS(rc))
+        rc = RTDirCreateTemp(szDir, 0700);
+    if (RT_FAILURE(rc))
+    {
+        RTTestSkipped(hTest, "Creating temporary directory failed: %Rrc", rc);
+        return;
+    }
+    char szImage[RTPATH_MAX];
+    RTStrPrintf(szImage, sizeof(szImage), "%s.img", szDir);
+
+    uint8_t *pbBig = (uint8_t *)RTMemAlloc(TST_EXT_BIG_FILE_SIZE);
+    if (pbBig)
+    {
+        tstRTFsFatFillPattern(pbBig, TST_EXT_BIG_FILE_SIZE, 0);
+        uint64_t cbTotal = 0;
+        RTTESTI_CHECK_RC_OK(rc = tstRTFsExtPopulate(szDir, pbBig, &cbTotal));
+        if (RT_SUCCESS(rc))
+        {
+            /*
+             * Generate the image, building the directory indexes with e2fsck
+             * (which exits with 1 when it changed something).
+             */
+            int iExitCode = -1;
+            const char *apszMkfs[] = { "mke2fs", "-q", "-F", "-t", "ext4", "-d", szDir, szImage, TST_EXT_IMAGE_SIZE, NULL };
+            rc = tstRTFsRunTool(apszMkfs, &iExitCode);
+            if (RT_FAILURE(rc) || iExitCode != 0)
+                RTTestSkipped(hTest, "mke2fs failed or isn't available: %Rrc, exit code %d", rc, iExitCode);
+            else
+            {
+                const char *apszFsck[] = { "e2fsck", "-f", "-y", "-D", szImage, NULL };
+                rc = tstRTFsRunTool(apszFsck, &iExitCode);
+                if (RT_FAILURE(rc) || (iExitCode != 0 && iExitCode != 1))
+                    RTTestPrintf(hTest, RTTESTLVL_ALWAYS, "e2fsck -D failed (%Rrc, exit code %d), no directory index\n",
+                                 rc, iExitCode);
+
+                /*
+                 * Mount it, walk it and check some files.
+                 */
+                RTVFSFILE hVfsImg;
+                RTTESTI_CHECK_RC_OK(rc = RTVfsFileOpenNormal(szImage, RTFILE_O_OPEN | RTFILE_O_READ | RTFILE_O_DENY_NONE,
+                                                             &hVfsImg));
+                if (RT_SUCCESS(rc))
+                {
+                    RTVFS hVfs;
+                    RTTESTI_CHECK_RC_OK(rc = RTVfsMountVol(hVfsImg, RTVFSMNT_F_READ_ONLY, &hVfs, NULL));
+                    if (RT_SUCCESS(rc))
+                    {
+                        uint8_t *pbBuf = (uint8_t *)RTMemAlloc(TST_WALK_IO_SIZE);
+                        RTVFSDIR hVfsRoot;
+                        if (pbBuf && RT_SUCCESS(rc = RTVfsOpenRoot(hVfs, &hVfsRoot)))
+                        {
+                            TSTRTFSWALKSTATS Stats;
+                            RT_ZERO(Stats);
+                            RTTESTI_CHECK_RC_OK(tstRTFsWalkDir(hVfsRoot, &Stats, pbBuf, 0));
+                            RTVfsDirRelease(hVfsRoot);
+                            RTTESTI_CHECK_MSG(Stats.cFiles == TST_EXT_MANY_FILES + 4,
+                                              ("cFiles=%RU64, expected %u\n", Stats.cFiles, TST_EXT_MANY_FILES + 4));
+                            RTTESTI_CHECK_MSG(Stats.cDirs >= 6, ("cDirs=%RU64\n", Stats.cDirs));
+                            RTTESTI_CHECK_MSG(Stats.cbRead == cbTotal,
+                                              ("cbRead=%RU64, expected %RU64\n", Stats.cbRead, cbTotal));
+                        }
+                        else
+                            RTTestIFailed("RTVfsOpenRoot -> %Rrc", pbBuf ? rc : VERR_NO_MEMORY);
+                        RTMemFree(pbBuf);
+
+                        tstRTFsExtCheckFile(hVfs, "big.dat", pbBig, TST_EXT_BIG_FILE_SIZE);
+                        tstRTFsExtCheckFile(hVfs, "small.dat", pbBig, 1000);
+                        tstRTFsExtCheckFile(hVfs, "empty", pbBig, 0);
+                        tstRTFsExtCheckFile(hVfs, "deep/a/b/c/d/leaf.dat", pbBig, 4096);
+                        static uint32_t const s_aiFiles[] = { 0, 7, 123, 321, TST_EXT_MANY_FILES - 1 };
+                        for (unsigned i = 0; i < RT_ELEMENTS(s_aiFiles); i++)
+                        {
+                            char szPath[80];
+                            char szContent[32];
+                            RTStrPrintf(szPath, sizeof(szPath), "many/file-with-a-somewhat-longer-name-%04u.txt", s_aiFiles[i]);
+                            size_t const cchContent = RTStrPrintf(szContent, sizeof(szContent), "%u\n", s_aiFiles[i]);
+                            tstRTFsExtCheckFile(hVfs, szPath, szContent, cchContent);
+                        }
+
+                        RTVFSDIR hVfsDir;
+                        rc = RTVfsDirOpen(hVfs, "many/no-such-file.txt", 0 /*fFlags*/, &hVfsDir);
+                        RTTESTI_CHECK_MSG(RT_FAILURE(rc), ("%Rrc\n", rc));
+                        if (RT_SUCCESS(rc))
+                            RTVfsDirRelease(hVfsDir);
+                        RTVfsRelease(hVfs);
+                    }
+                    RTVfsFileRelease(hVfsImg);
+                }
+            }
+        }
+        RTMemFree(pbBig);
+    }
+    else
+        RTTestIFailed("Out of memory");
+
+    RTFileDelete(szImage);
+    RTDirRemoveRecursive(szDir, RTDIRRMREC_F_CONTENT_AND_DIR);
+}
+
+
 int main(int argc, char **argv)
 {
     /*
@@ -106,18 +771,50 @@ int main(int argc, char **argv)
     RTTestBanner(hTest);
 
     /*
-     * If no args, display usage.
+     * Parse the command line.  Without an image, we do the FAT checks.
      */
-    if (argc < 2)
+    static const RTGETOPTDEF s_aOptions[] =
+    {
+        { "--benchmark",    'b', RTGETOPT_REQ_NOTHING },
+    };
+    bool        fBenchmark = false;
+    const char *pszImage   = NULL;
+    RTGETOPTSTATE GetState;
+    RTGetOptInit(&GetState, argc, argv, s_aOptions, RT_ELEMENTS(s_aOptions), 1, RTGETOPTINIT_FLAGS_OPTS_FIRST);
+    RTGETOPTUNION ValueUnion;
+    int chOpt;
+    while ((chOpt = RTGetOpt(&GetState, &ValueUnion)) != 0)
+    {
+        switch (chOpt)
+        {
+            case 'b':
+                fBenchmark = true;
+                break;
+
+            case VINF_GETOPT_NOT_OPTION:
+                if (!pszImage)
+                {
+                    pszImage = ValueUnion.psz;
+                    break;
+                }
+                RT_FALL_THRU();
+            default:
+                RTTestPrintf(hTest, RTTESTLVL_ALWAYS, "Syntax: %s [--benchmark] [image]\n", argv[0]);
+                return RTGetOptPrintError(chOpt, &ValueUnion);
+        }
+    }
+
+    if (!pszImage)
     {
-        RTTestPrintf(hTest, RTTESTLVL_ALWAYS, "Syntax: %s <image>\n", argv[0]);
-        return RTTestSkipAndDestroy(hTest, "Missing required arguments\n");
+        tstRTFsFatBenchmark(hTest, fBenchmark);
+        tstRTFsExtCheck(hTest);
+        return RTTestSummaryAndDestroy(hTest);
     }
 
     /* Open image. */
     RTFILE hFile;
     RTVFSFILE hVfsFile;
-    rc = RTFileOpen(&hFile, argv[1], RTFILE_O_OPEN | RTFILE_O_DENY_NONE | RTFILE_O_READ);
+    rc = RTFileOpen(&hFile, pszImage, RTFILE_O_OPEN | RTFILE_O_DENY_NONE | RTFILE_O_READ);
     if (RT_FAILURE(rc))
     {
         RTTestIFailed("RTFileOpen -> %Rrc", rc);
@@ -135,6 +832,12 @@ int main(int argc, char **argv)
 
     RTTESTI_CHECK(rc == VINF_SUCCESS);
 
+    if (fBenchmark)
+    {
+        rc = tstRTFsWalkBenchmark(hTest, hVfsFile);
+        RTTESTI_CHECK(rc == VINF_SUCCESS);
+    }
+
     RTVfsFileRelease(hVfsFile);
 
     /*
@@ -0,0 +1,294 @@
+/* $Id$ */
+/** @file
+ * IPRT Testcase - RTLogBinLoggerEx.
+ */
+
+/*
+ * Copyright (C) 2010-2017 Oracle Corporation
+ *
+ * This file is part of VirtualBox Open Source Edition (OSE), as
+ * available from http://www.virtualbox.org. This file is free software;
+ * you can redistribute it and/or modify it under the terms of the GNU
+ * General Public License (GPL) as published by the Free Software
+ * Foundation, in version 2 as it comes in the "COPYING" file of the
+ * VirtualBox OSE distribution. VirtualBox OSE is distributed in the
+ * hope that it will be useful, but WITHOUT ANY WARRANTY of any kind.
+ *
+ * The contents of this file may alternatively be used under the terms
+ * of the Common Development and Distribution License Version 1.0
+ * (CDDL) only, as it comes in the "COPYING.CDDL" file of the
+ * VirtualBox OSE distribution, in which case the provisions of the
+ * CDDL are applicable instead of those of the GPL.
+ *
+ * You may elect to license modified versions of this file under the
+ * terms and conditions of either the GPL or the CDDL or both.
+ */
+
+
+/*********************************************************************************************************************************
+*   Header Files                                                                                                                 *
+*********************************************************************************************************************************/
+#include <iprt/log.h>
+
+#include <iprt/asm.h>
+#include <iprt/err.h>
+#include <iprt/file.h>
+#include <iprt/path.h>
+#include <iprt/semaphore.h>
+#include <iprt/string.h>
+#include <iprt/test.h>
+#include <iprt/thread.h>
+#include <iprt/time.h>
+
+
+/*********************************************************************************************************************************
+*   Structures and Typedefs                                                                                                      *
+*********************************************************************************************************************************/
+typedef struct TST2THREAD
+{
+    RTTHREAD            hThread;
+    RTSEMEVENTMULTI     hEvt;
+    PRTLOGGER           pLogger;
+    uint64_t volatile   cRecords;
+    bool                fBinary;
+} TST2THREAD, *PTST2THREAD;
+
+
+/*********************************************************************************************************************************
+*   Global Variables                                                                                                             *
+*********************************************************************************************************************************/
+/** Stop indicator for tst2 threads.  */
+static bool volatile        g_fTst2Stop;
+
+
+/**
+ * Checks that records end up in the log in order and that overflows are
+ * reported.
+ */
+static void tst1(void)
+{
+    RTTestISub("Basics");
+
+    char szFile[RTPATH_MAX];
+    RTTESTI_CHECK_RC_RETV(RTPathTemp(szFile, sizeof(szFile)), VINF_SUCCESS);
+    RTTESTI_CHECK_RC_RETV(RTPathAppend(szFile, sizeof(szFile), "tstRTLogBin-1.log"), VINF_SUCCESS);
+    RTFileDelete(szFile);
+
+    PRTLOGGER pLogger;
+    RTTESTI_CHECK_RC_RETV(RTLogCreate(&pLogger, 0 /*fFlags*/, NULL, NULL, 0, NULL, RTLOGDEST_FILE, "%s", szFile),
+                          VINF_SUCCESS);
+    RTTESTI_CHECK_RC(RTLogBinEnable(pLogger, 3 /* too small */, RT_INDEFINITE_WAIT), VERR_OUT_OF_RANGE);
+    RTTESTI_CHECK_RC(RTLogBinEnable(pLogger, 24 /* not power of two */, RT_INDEFINITE_WAIT), VERR_INVALID_PARAMETER);
+    RTTESTI_CHECK_RC(RTLogBinEnable(pLogger, 16, RT_INDEFINITE_WAIT), VINF_SUCCESS);
+    RTTESTI_CHECK_RC(RTLogBinEnable(pLogger, 16, RT_INDEFINITE_WAIT), VERR_WRONG_ORDER);
+
+    RTLogBinLoggerEx(pLogger, 0, ~0U, "first %RU64\n", RTLOGBINARGS1(RTLOGBINARG_U64), UINT64_C(1));
+    RTLogBinLoggerEx(pLogger, 0, ~0U, "second %#RX64 %RI64\n", RTLOGBINARGS2(RTLOGBINARG_U64, RTLOGBINARG_U64),
+                     UINT64_C(0x1234), (uint64_t)-42);
+    RTLogBinLoggerEx(pLogger, 0, ~0U, "third %s\n", RTLOGBINARGS1(RTLOGBINARG_PTR), "static string");
+    RTLogBinLoggerEx(pLogger, 0, ~0U, "fourth %u%% %s %#x %RU64 %p\n",
+                     RTLOGBINARGS5(RTLOGBINARG_U32, RTLOGBINARG_PTR, RTLOGBINARG_U32, RTLOGBINARG_U64, RTLOGBINARG_PTR),
+                     42U, "mixed", 0x1000U, UINT64_C(0x123456789), (void *)NULL);
+    RTLogFlush(pLogger);
+
+    /* Overflow the 16 entry buffer. */
+    for (uint64_t i = 0; i < 20; i++)
+        RTLogBinLoggerEx(pLogger, 0, ~0U, "overflow %RU64\n", RTLOGBINARGS1(RTLOGBINARG_U64), i);
+    RTTESTI_CHECK_RC(RTLogDestroy(pLogger), VINF_SUCCESS);
+
+    void  *pvFile;
+    size_t cbFile;
+    RTTESTI_CHECK_RC_RETV(RTFileReadAll(szFile, &pvFile, &cbFile), VINF_SUCCESS);
+    char *pszFile = RTStrDupN((const char *)pvFile, cbFile);
+    RTFileReadAllFree(pvFile, cbFile);
+    RTTESTI_CHECK_RETV(pszFile != NULL);
+
+    const char *pszFirst  = strstr(pszFile, "first 1\n");
+    const char *pszSecond = strstr(pszFile, "second 0x1234 -42\n");
+    const char *pszThird  = strstr(pszFile, "third static string\n");
+    const char *pszFourth = strstr(pszFile, "fourth 42% mixed 0x1000 4886718345 ");
+    RTTESTI_CHECK(pszFirst && pszSecond && pszThird && pszFirst < pszSecond && pszSecond < pszThird);
+    RTTESTI_CHECK(pszFourth && pszThird < pszFourth);
+    RTTESTI_CHECK(strstr(pszFile, "overflow 15\n") != NULL);
+    RTTESTI_CHECK(strstr(pszFile, "overflow 16\n") == NULL);
+    RTTESTI_CHECK(strstr(pszFile, "Dropped 4 records") != NULL);
+
+    RTStrFree(pszFile);
+    RTFileDelete(szFile);
+}
+
+
+static DECLCALLBACK(int) tst3Thread(RTTHREAD hThreadSelf, void *pvArg)
+{
+    RT_NOREF_PV(hThreadSelf);
+    RTLogBinLoggerEx((PRTLOGGER)pvArg, 0, ~0U, "producer %u %u\n", RTLOGBINARGS2(RTLOGBINARG_U32, RTLOGBINARG_U32), 1U, 2U);
+    return VINF_SUCCESS;
+}
+
+
+/**
+ * Checks that a record is prefixed with the thread that logged it rather than
+ * the one draining the buffers.
+ */
+static void tst3(void)
+{
+    RTTestISub("Prefix");
+
+    char szFile[RTPATH_MAX];
+    RTTESTI_CHECK_RC_RETV(RTPathTemp(szFile, sizeof(szFile)), VINF_SUCCESS);
+    RTTESTI_CHECK_RC_RETV(RTPathAppend(szFile, sizeof(szFile), "tstRTLogBin-3.log"), VINF_SUCCESS);
+    RTFileDelete(szFile);
+
+    PRTLOGGER pLogger;
+    RTTESTI_CHECK_RC_RETV(RTLogCreate(&pLogger, RTLOGFLAGS_PREFIX_THREAD, NULL, NULL, 0, NULL, RTLOGDEST_FILE, "%s", szFile),
+                          VINF_SUCCESS);
+    RTTESTI_CHECK_RC(RTLogBinEnable(pLogger, 16, RT_INDEFINITE_WAIT), VINF_SUCCESS);
+
+    RTTHREAD hThread;
+    RTTESTI_CHECK_RC(RTThreadCreate(&hThread, tst3Thread, pLogger, 0, RTTHREADTYPE_DEFAULT, RTTHREADFLAGS_WAITABLE,
+                                    "tst3prod"), VINF_SUCCESS);
+    RTTESTI_CHECK_RC(RTThreadWait(hThread, RT_INDEFINITE_WAIT, NULL), VINF_SUCCESS);
+    RTTESTI_CHECK_RC(RTLogDestroy(pLogger), VINF_SUCCESS);
+
+    void  *pvFile;
+    size_t cbFile;
+    RTTESTI_CHECK_RC_RETV(RTFileReadAll(szFile, &pvFile, &cbFile), VINF_SUCCESS);
+    char *pszFile = RTStrDupN((const char *)pvFile, cbFile);
+    RTFileReadAllFree(pvFile, cbFile);
+    RTTESTI_CHECK_RETV(pszFile != NULL);
+
+    char *pszLine = strstr(pszFile, "producer 1 2\n");
+    RTTESTI_CHECK(pszLine != NULL);
+    if (pszLine)
+    {
+        *pszLine = '\0';
+        char *pszStart = strrchr(pszFile, '\n');
+        pszStart = pszStart ? pszStart + 1 : pszFile;
+        RTTESTI_CHECK_MSG(strstr(pszStart, "tst3prod") != NULL, ("'%s'\n", pszStart));
+    }
+
+    RTStrFree(pszFile);
+    RTFileDelete(szFile);
+}
+
+
+static DECLCALLBACK(int) tst2Thread(RTTHREAD hThreadSelf, void *pvArg)
+{
+    PTST2THREAD pThread  = (PTST2THREAD)pvArg;
+    PRTLOGGER   pLogger  = pThread->pLogger;
+    uint64_t    cRecords = 0;
+    RT_NOREF_PV(hThreadSelf);
+
+    /* wait for the kick-off */
+    RTTESTI_CHECK_RC_OK(RTSemEventMultiWait(pThread->hEvt, RT_INDEFINITE_WAIT));
+
+    /* do the work */
+    if (pThread->fBinary)
+        while (!g_fTst2Stop)
+        {
+            for (unsigned i = 0; i < 64; i++)
+                RTLogBinLoggerEx(pLogger, 0, ~0U, "tst2 %p %RU64\n", RTLOGBINARGS2(RTLOGBINARG_PTR, RTLOGBINARG_U64),
+                                 pThread, cRecords + i);
+            cRecords += 64;
+        }
+    else
+        while (!g_fTst2Stop)
+        {
+            for (unsigned i = 0; i < 64; i++)
+                RTLogLoggerEx(pLogger, 0, ~0U, "tst2 %p %RU64\n", pThread, cRecords + i);
+            cRecords += 64;
+        }
+
+    /* report back the status */
+    pThread->cRecords = cRecords;
+    return VINF_SUCCESS;
+}
+
+/**
+ * Time constrained benchmark with N threads logging to the ring buffer.
+ */
+static void tst2(uint32_t cThreads, bool fBinary, uint32_t cSecs)
+{
+    RTTestISubF("Benchmark - %u threads, %u secs, %s", cThreads, cSecs, fBinary ? "RTLogBinLoggerEx" : "RTLogLoggerEx");
+
+    PRTLOGGER pLogger;
+    RTTESTI_CHECK_RC_RETV(RTLogCreate(&pLogger, 0 /*fFlags*/, NULL, NULL, 0, NULL, RTLOGDEST_RINGBUF, NULL), VINF_SUCCESS);
+    if (fBinary)
+        RTTESTI_CHECK_RC_RETV(RTLogBinEnable(pLogger, _16K, 10 /*ms*/), VINF_SUCCESS);
+
+    RTSEMEVENTMULTI hEvt;
+    RTTESTI_CHECK_RC_OK_RETV(RTSemEventMultiCreate(&hEvt));
+
+    TST2THREAD aThreads[64];
+    RTTESTI_CHECK_RETV(cThreads < RT_ELEMENTS(aThreads));
+
+    ASMAtomicWriteBool(&g_fTst2Stop, false);
+    for (uint32_t i = 0; i < cThreads; i++)
+    {
+        aThreads[i].hThread  = NIL_RTTHREAD;
+        aThreads[i].hEvt     = hEvt;
+        aThreads[i].pLogger  = pLogger;
+        aThreads[i].cRecords = 0;
+        aThreads[i].fBinary  = fBinary;
+        RTTESTI_CHECK_RC_OK_RETV(RTThreadCreateF(&aThreads[i].hThread, tst2Thread, &aThreads[i], 0,
+                                                 RTTHREADTYPE_DEFAULT, RTTHREADFLAGS_WAITABLE, "tst2-%u", i));
+    }
+
+    /*
+     * Start the race.
+     */
+    RTTimeNanoTS(); /* warmup */
+
+    uint64_t uStartTS = RTTimeNanoTS();
+    RTTESTI_CHECK_RC_OK_RETV(RTSemEventMultiSignal(hEvt));
+    RTThreadSleep(cSecs * 1000);
+    ASMAtomicWriteBool(&g_fTst2Stop, true);
+    for (uint32_t i = 0; i < cThreads; i++)
+        RTTESTI_CHECK_RC_OK_RETV(RTThreadWait(aThreads[i].hThread, 60*1000, NULL));
+    uint64_t cElapsedNS = RTTimeNanoTS() - uStartTS;
+
+    /*
+     * Sum up the counts.  The ns per record is the wall time each thread
+     * spent per record, i.e. what the caller sees under contention.
+     */
+    uint64_t cRecords = 0;
+    for (uint32_t i = 0; i < cThreads; i++)
+        cRecords += aThreads[i].cRecords;
+    if (cRecords)
+        RTTestIValueF(cElapsedNS * cThreads / cRecords, RTTESTUNIT_NS_PER_CALL, "%s/%u",
+                      fBinary ? "binary" : "formatted", cThreads);
+
+    /* clean up */
+    RTTESTI_CHECK_RC(RTLogDestroy(pLogger), VINF_SUCCESS);
+    RTTESTI_CHECK_RC_OK(RTSemEventMultiDestroy(hEvt));
+}
+
+
+int main(int argc, char **argv)
+{
+    RT_NOREF_PV(argv);
+
+    RTTEST hTest;
+    int rc = RTTestInitAndCreate("tstRTLogBin", &hTest);
+    if (rc)
+        return rc;
+    RTTestBanner(hTest);
+
+    tst1();
+    tst3();
+    if (RTTestIErrorCount() == 0)
+    {
+        uint32_t cSecs = argc == 1 ? 1 : 5;
+        static uint32_t const s_acThreads[] = { 1, 2, 4, 8 };
+        for (unsigned i = 0; i < RT_ELEMENTS(s_acThreads); i++)
+        {
+            tst2(s_acThreads[i], false /*fBinary*/, cSecs);
+            tst2(s_acThreads[i], true  /*fBinary*/, cSecs);
+        }
+    }
+
+    /*
+     * Summary.
+     */
+    return RTTestSummaryAndDestroy(hTest);
+}
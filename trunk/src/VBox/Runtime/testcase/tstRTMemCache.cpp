@@ -197,6 +197,86 @@ static void tst2(void)
 }
 
 
+/** Constructor for tst4. */
+static DECLCALLBACK(int) tst4Ctor(RTMEMCACHE hMemCache, void *pvObj, void *pvUser)
+{
+    RT_NOREF_PV(hMemCache);
+    ASMAtomicIncU32((uint32_t volatile *)pvUser);
+    *(uint32_t *)pvObj = UINT32_C(0x19570310);
+    return VINF_SUCCESS;
+}
+
+
+/**
+ * Test the magazine layer.
+ */
+static void tst4(void)
+{
+    RTTestISub("Magazines");
+
+    uint32_t volatile cCtors = 0;
+    uint32_t const    cMax   = 1000;
+    RTMEMCACHE        hMemCache;
+    RTTESTI_CHECK_RC_RETV(RTMemCacheCreate(&hMemCache, 64, 0 /*cbAlignment*/, cMax, tst4Ctor, NULL, (void *)&cCtors,
+                                           0 /*fFlags*/), VINF_SUCCESS);
+
+    RTMEMCACHESTATS Stats;
+    RTTESTI_CHECK_RC(RTMemCacheQueryStats(hMemCache, &Stats), VINF_SUCCESS);
+    RTTESTI_CHECK(Stats.cSlots > 0);
+    RTTESTI_CHECK(Stats.cbObject >= 64);
+
+    /*
+     * Allocate everything a couple of times.  The second and later rounds
+     * are served from the magazines until they run dry and have to be reaped
+     * for the last few objects.
+     */
+    static void    *s_apv[2048];
+    uint32_t        cFirst = 0;
+    for (uint32_t iLoop = 0; iLoop < 4; iLoop++)
+    {
+        uint32_t cAllocated = 0;
+        int      rc;
+        while (cAllocated < RT_ELEMENTS(s_apv))
+        {
+            rc = RTMemCacheAllocEx(hMemCache, &s_apv[cAllocated]);
+            if (RT_FAILURE(rc))
+                break;
+            RTTESTI_CHECK(*(uint32_t *)s_apv[cAllocated] == UINT32_C(0x19570310));
+            cAllocated++;
+        }
+        RTTESTI_CHECK_RC(rc, VERR_MEM_CACHE_MAX_SIZE);
+        if (iLoop == 0)
+        {
+            cFirst = cAllocated;
+            RTTESTI_CHECK(cFirst >= cMax);
+        }
+        else
+            RTTESTI_CHECK_MSG(cAllocated == cFirst, ("cAllocated=%u cFirst=%u\n", cAllocated, cFirst));
+
+        RTTESTI_CHECK_RC(RTMemCacheQueryStats(hMemCache, &Stats), VINF_SUCCESS);
+        RTTESTI_CHECK(Stats.cInMagazines == 0);
+        RTTESTI_CHECK(Stats.cFree == 0);
+
+        for (uint32_t i = 0; i < cAllocated; i++)
+            RTMemCacheFree(hMemCache, s_apv[i]);
+
+        RTTESTI_CHECK_RC(RTMemCacheQueryStats(hMemCache, &Stats), VINF_SUCCESS);
+        RTTESTI_CHECK(Stats.cInMagazines + Stats.cFree == Stats.cTotal);
+        RTTESTI_CHECK(Stats.cInMagazines > 0);
+    }
+
+    RTTESTI_CHECK_RC(RTMemCacheQueryStats(hMemCache, &Stats), VINF_SUCCESS);
+    RTTESTI_CHECK(Stats.cAllocs == (uint64_t)cFirst * 4);
+    RTTESTI_CHECK(Stats.cFrees  == (uint64_t)cFirst * 4);
+    RTTESTI_CHECK(Stats.cMagazineAllocs > 0);
+    RTTESTI_CHECK(Stats.cMagazineFrees > 0);
+    RTTESTI_CHECK(Stats.cReaps >= 4);
+    RTTESTI_CHECK(cCtors == Stats.cTotal);
+
+    RTTESTI_CHECK_RC(RTMemCacheDestroy(hMemCache), VINF_SUCCESS);
+}
+
+
 /**
  * Thread that allocates
  * @returns
@@ -273,7 +353,7 @@ static void tst3(uint32_t cThreads, uint32_t cbObject, int iMethod, uint32_t cSe
     RTTESTI_CHECK_RC_OK_RETV(RTSemEventMultiCreate(&hEvt));
 
     TST3THREAD aThreads[64];
-    RTTESTI_CHECK_RETV(cThreads < RT_ELEMENTS(aThreads));
+    RTTESTI_CHECK_RETV(cThreads <= RT_ELEMENTS(aThreads));
 
     ASMAtomicWriteBool(&g_fTst3Stop, false);
     for (uint32_t i = 0; i < cThreads; i++)
@@ -307,9 +387,23 @@ static void tst3(uint32_t cThreads, uint32_t cbObject, int iMethod, uint32_t cSe
     for (uint32_t i = 0; i < cThreads; i++)
         cIterations += aThreads[i].cIterations;
 
+    uint64_t const cPerSec = (uint64_t)((long double)cIterations * 1000000000.0 / cElapsedNS);
     RTTestIPrintf(RTTESTLVL_ALWAYS, "%'8u iterations per second, %'llu ns on avg\n",
-                  (unsigned)((long double)cIterations * 1000000000.0 / cElapsedNS),
-                  cElapsedNS / cIterations);
+                  (unsigned)cPerSec, cElapsedNS / RT_MAX(cIterations, 1));
+    RTTestIValueF(cPerSec, RTTESTUNIT_CALLS_PER_SEC, "%s %u threads %u bytes",
+                  iMethod == 0 ? "RTMemCache" : "RTMemAlloc", cThreads, cbObject);
+
+    if (iMethod == 0)
+    {
+        RTMEMCACHESTATS Stats;
+        RTTESTI_CHECK_RC(RTMemCacheQueryStats(g_hMemCache, &Stats), VINF_SUCCESS);
+        RTTESTI_CHECK(Stats.cAllocs == cIterations);
+        RTTESTI_CHECK(Stats.cFrees  == cIterations);
+        RTTestIPrintf(RTTESTLVL_ALWAYS,
+                      "magazines: %'llu allocs, %'llu frees, %'llu depot exchanges, %'llu busy, %u magazines, %u slots\n",
+                      Stats.cMagazineAllocs, Stats.cMagazineFrees, Stats.cDepotExchanges, Stats.cSlotBusy,
+                      Stats.cMagazines, Stats.cSlots);
+    }
 
     /* clean up */
     RTTESTI_CHECK_RC(RTMemCacheDestroy(g_hMemCache), VINF_SUCCESS);
@@ -336,6 +430,7 @@ int main(int argc, char **argv)
 
     tst1();
     tst2();
+    tst4();
     if (RTTestIErrorCount() == 0)
     {
         uint32_t cSecs = argc == 1 ? 5 : 2;
@@ -354,6 +449,10 @@ int main(int argc, char **argv)
         tst3AllMethods(     3,     1, cSecs);
 
         tst3AllMethods(    16,    32, cSecs);
+
+        /* Scaling. */
+        for (uint32_t cThreads = 1; cThreads <= 64; cThreads *= 2)
+            tst3AllMethods(cThreads,   64, 1);
     }
 
     /*
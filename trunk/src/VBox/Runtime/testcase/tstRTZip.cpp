@@ -37,8 +37,31 @@
 #include <iprt/mem.h>
 #include <iprt/message.h>
 #include <iprt/param.h>
+#include <iprt/path.h>
+#include <iprt/rand.h>
+#include <iprt/sha.h>
 #include <iprt/string.h>
 #include <iprt/test.h>
+#include <iprt/thread.h>
+#include <iprt/time.h>
+#include <iprt/vfs.h>
+
+
+/*********************************************************************************************************************************
+*   Global Variables                                                                                                             *
+*********************************************************************************************************************************/
+/** The gzip flag combinations tested. */
+static const struct
+{
+    uint32_t    fComp;
+    uint32_t    fDecomp;
+    const char *pszName;
+} g_aGzipModes[] =
+{
+    { 0,                        0,                          "serial" },
+    { RTZIPGZIPCOMP_F_PARALLEL, 0,                          "parallel" },
+    { RTZIPGZIPCOMP_F_BLOCKED,  RTZIPGZIPDECOMP_F_PARALLEL, "blocked" },
+};
 
 
 static void testFile(const char *pszFilename)
@@ -61,6 +84,672 @@ static void testFile(const char *pszFilename)
 }
 
 
+/**
+ * Fills a buffer with semi-compressible data.
+ *
+ * The content only depends on the offset, so it can be regenerated for
+ * verifying the decompressed data.
+ *
+ * @param   pb              The buffer.
+ * @param   cb              The buffer size, multiple of 4K.
+ * @param   off             The offset of the buffer in the data stream,
+ *                          multiple of 4K.
+ */
+static void tstRTZipGzipFill(uint8_t *pb, size_t cb, uint64_t off)
+{
+    static const char * const s_apszWords[] =
+    {
+        "gzip ", "deflate ", "block ", "member ", "stream ", "worker ", "thread ", "window ",
+        "crc32 ", "offset ", "index ", "header\n", "trailer\n", "0x1f8b ", "vbox ", "iprt ",
+    };
+    for (size_t offPage = 0; offPage < cb; offPage += _4K, off += _4K)
+    {
+        uint64_t uState = (off >> 12) * UINT64_C(0x9e3779b97f4a7c15) + 1;
+        uint8_t *pbPage = &pb[offPage];
+        if ((uState >> 40) % 8 == 0)
+        {
+            /* Incompressible page. */
+            for (size_t i = 0; i < _4K; i += sizeof(uint64_t))
+            {
+                uState = uState * UINT64_C(6364136223846793005) + UINT64_C(1442695040888963407);
+                memcpy(&pbPage[i], &uState, sizeof(uState));
+            }
+        }
+        else
+        {
+            /* Text page. */
+            size_t i = 0;
+            while (i < _4K)
+            {
+                uState = uState * UINT64_C(6364136223846793005) + UINT64_C(1442695040888963407);
+                const char *pszWord = s_apszWords[(uState >> 33) % RT_ELEMENTS(s_apszWords)];
+                size_t const cchWord = RT_MIN(strlen(pszWord), _4K - i);
+                memcpy(&pbPage[i], pszWord, cchWord);
+                i += cchWord;
+            }
+        }
+    }
+}
+
+
+/**
+ * Compresses and decompresses a buffer in all the gzip modes.
+ *
+ * @param   cbData          The amount of data to test with.
+ */
+static void tstRTZipGzip(size_t cbData)
+{
+    RTTestISubF("gzip - %zu bytes", cbData);
+
+    size_t const cbAlloc = RT_ALIGN_Z(cbData + 1, _4K);
+    uint8_t *pbData = (uint8_t *)RTMemAlloc(cbAlloc);
+    uint8_t *pbOut  = (uint8_t *)RTMemAlloc(cbAlloc);
+    RTTESTI_CHECK_RETV(pbData && pbOut);
+    tstRTZipGzipFill(pbData, cbAlloc, 0);
+
+    for (unsigned iMode = 0; iMode < RT_ELEMENTS(g_aGzipModes); iMode++)
+    {
+        /*
+         * Compress it in odd sized chunks, flushing once in a while.
+         */
+        RTVFSFILE hVfsFileGz;
+        RTTESTI_CHECK_RC_RETV(RTVfsMemFileCreate(NIL_RTVFSIOSTREAM, cbData / 2, &hVfsFileGz), VINF_SUCCESS);
+        RTVFSIOSTREAM hVfsIosGz = RTVfsFileToIoStream(hVfsFileGz);
+
+        RTVFSIOSTREAM hVfsIos;
+        int rc = RTZipGzipCompressIoStream(hVfsIosGz, g_aGzipModes[iMode].fComp, 6, &hVfsIos);
+        RTTESTI_CHECK_RC(rc, VINF_SUCCESS);
+        if (RT_SUCCESS(rc))
+        {
+            size_t off = 0;
+            for (unsigned i = 0; off < cbData && RT_SUCCESS(rc); i++)
+            {
+                size_t const cbThis = RT_MIN(cbData - off, (size_t)(i % 7) * _256K + 4093);
+                rc = RTVfsIoStrmWrite(hVfsIos, &pbData[off], cbThis, true /*fBlocking*/, NULL);
+                off += cbThis;
+                if (i % 16 == 15 && RT_SUCCESS(rc))
+                    rc = RTVfsIoStrmFlush(hVfsIos);
+            }
+            RTTESTI_CHECK_RC(rc, VINF_SUCCESS);
+            RTTESTI_CHECK(RTVfsIoStrmRelease(hVfsIos) == 0);
+        }
+
+        uint64_t cbGz = 0;
+        RTTESTI_CHECK_RC(RTVfsFileGetSize(hVfsFileGz, &cbGz), VINF_SUCCESS);
+        RTTestIPrintf(RTTESTLVL_ALWAYS, "%-8s: %zu -> %RU64 bytes\n", g_aGzipModes[iMode].pszName, cbData, cbGz);
+
+        /*
+         * Decompress it serially and with the mode specific flags.
+         */
+        for (unsigned iPass = 0; iPass < 2 && RT_SUCCESS(rc); iPass++)
+        {
+            RTTESTI_CHECK_RC(RTVfsFileSeek(hVfsFileGz, 0, RTFILE_SEEK_BEGIN, NULL), VINF_SUCCESS);
+            rc = RTZipGzipDecompressIoStream(hVfsIosGz, iPass ? g_aGzipModes[iMode].fDecomp : 0, &hVfsIos);
+            RTTESTI_CHECK_RC(rc, VINF_SUCCESS);
+            if (RT_SUCCESS(rc))
+            {
+                size_t cbRead = 0;
+                size_t off    = 0;
+                do
+                {
+                    rc = RTVfsIoStrmRead(hVfsIos, &pbOut[off], RT_MIN(cbData + 1 - off, _1M - 17), true /*fBlocking*/, &cbRead);
+                    off += cbRead;
+                } while (rc == VINF_SUCCESS && off <= cbData);
+                RTTESTI_CHECK_RC(rc, VINF_EOF);
+                RTTESTI_CHECK_MSG(off == cbData, ("%zu vs %zu\n", off, cbData));
+                RTTESTI_CHECK(memcmp(pbOut, pbData, RT_MIN(off, cbData)) == 0);
+                RTVfsIoStrmRelease(hVfsIos);
+            }
+        }
+
+        /*
+         * Random access.
+         */
+        if (g_aGzipModes[iMode].fComp & RTZIPGZIPCOMP_F_BLOCKED)
+        {
+            RTVFSFILE hVfsFile;
+            rc = RTZipGzipDecompressFile(hVfsFileGz, 0, &hVfsFile);
+            RTTESTI_CHECK_RC(rc, VINF_SUCCESS);
+            if (RT_SUCCESS(rc))
+            {
+                uint64_t cbFile = 0;
+                RTTESTI_CHECK_RC(RTVfsFileGetSize(hVfsFile, &cbFile), VINF_SUCCESS);
+                RTTESTI_CHECK(cbFile == cbData);
+                for (unsigned i = 0; i < 256; i++)
+                {
+                    size_t const offRead = (size_t)RTRandU64Ex(0, cbData);
+                    size_t const cbRead  = (size_t)RTRandU32Ex(0, i & 1 ? _4K : _2M);
+                    size_t       cbActual = 0;
+                    rc = RTVfsFileReadAt(hVfsFile, offRead, pbOut, cbRead, &cbActual);
+                    size_t const cbExpect = RT_MIN(cbRead, cbData - offRead);
+                    RTTESTI_CHECK_RC(rc, cbExpect < cbRead ? VINF_EOF : VINF_SUCCESS);
+                    RTTESTI_CHECK(cbActual == cbExpect);
+                    RTTESTI_CHECK(memcmp(pbOut, &pbData[offRead], RT_MIN(cbActual, cbExpect)) == 0);
+                }
+                RTVfsFileRelease(hVfsFile);
+            }
+        }
+        else
+        {
+            RTVFSFILE hVfsFile = NIL_RTVFSFILE;
+            RTTESTI_CHECK_RC(RTZipGzipDecompressFile(hVfsFileGz, 0, &hVfsFile), VERR_ZIP_BAD_HEADER);
+        }
+
+        RTVfsIoStrmRelease(hVfsIosGz);
+        RTVfsFileRelease(hVfsFileGz);
+    }
+
+    RTMemFree(pbOut);
+    RTMemFree(pbData);
+}
+
+
+/**
+ * Checks that the parallel decompressor falls back on the serial code when a
+ * regular gzip member follows blocked ones.
+ */
+static void tstRTZipGzipForeign(void)
+{
+    RTTestISub("gzip - blocked and regular members");
+
+    /* Blocked, regular and blocked again, each member set getting its own
+       compressor instance so they end up concatenated like cat(1) would. */
+    static const struct
+    {
+        uint32_t fComp;
+        size_t   cb;
+    } s_aParts[] =
+    {
+        { RTZIPGZIPCOMP_F_BLOCKED,  _2M + _1M + 4093 },
+        { 0,                        _1M + 777 },
+        { RTZIPGZIPCOMP_F_BLOCKED,  _1M + 12345 },
+    };
+    size_t cbData = 0;
+    for (unsigned i = 0; i < RT_ELEMENTS(s_aParts); i++)
+        cbData += s_aParts[i].cb;
+
+    size_t const cbAlloc = RT_ALIGN_Z(cbData + 1, _4K);
+    uint8_t *pbData = (uint8_t *)RTMemAlloc(cbAlloc);
+    uint8_t *pbOut  = (uint8_t *)RTMemAlloc(cbAlloc);
+    RTTESTI_CHECK_RETV(pbData && pbOut);
+    tstRTZipGzipFill(pbData, cbAlloc, 0);
+
+    RTVFSFILE hVfsFileGz;
+    RTTESTI_CHECK_RC_RETV(RTVfsMemFileCreate(NIL_RTVFSIOSTREAM, cbData / 2, &hVfsFileGz), VINF_SUCCESS);
+    RTVFSIOSTREAM hVfsIosGz = RTVfsFileToIoStream(hVfsFileGz);
+
+    int    rc  = VINF_SUCCESS;
+    size_t off = 0;
+    for (unsigned i = 0; i < RT_ELEMENTS(s_aParts) && RT_SUCCESS(rc); i++)
+    {
+        RTVFSIOSTREAM hVfsIos;
+        rc = RTZipGzipCompressIoStream(hVfsIosGz, s_aParts[i].fComp, 6, &hVfsIos);
+        RTTESTI_CHECK_RC(rc, VINF_SUCCESS);
+        if (RT_SUCCESS(rc))
+        {
+            rc = RTVfsIoStrmWrite(hVfsIos, &pbData[off], s_aParts[i].cb, true /*fBlocking*/, NULL);
+            RTTESTI_CHECK_RC(rc, VINF_SUCCESS);
+            RTTESTI_CHECK(RTVfsIoStrmRelease(hVfsIos) == 0);
+        }
+        off += s_aParts[i].cb;
+    }
+
+    /*
+     * Decompress it serially and in parallel.
+     */
+    for (unsigned iPass = 0; iPass < 2 && RT_SUCCESS(rc); iPass++)
+    {
+        RTTESTI_CHECK_RC(RTVfsFileSeek(hVfsFileGz, 0, RTFILE_SEEK_BEGIN, NULL), VINF_SUCCESS);
+        RTVFSIOSTREAM hVfsIos;
+        rc = RTZipGzipDecompressIoStream(hVfsIosGz, iPass ? RTZIPGZIPDECOMP_F_PARALLEL : 0, &hVfsIos);
+        RTTESTI_CHECK_RC(rc, VINF_SUCCESS);
+        if (RT_SUCCESS(rc))
+        {
+            size_t cbRead = 0;
+            off = 0;
+            do
+            {
+                rc = RTVfsIoStrmRead(hVfsIos, &pbOut[off], RT_MIN(cbData + 1 - off, _256K + 3), true /*fBlocking*/, &cbRead);
+                off += cbRead;
+            } while (rc == VINF_SUCCESS && off <= cbData);
+            RTTESTI_CHECK_RC(rc, VINF_EOF);
+            RTTESTI_CHECK_MSG(off == cbData, ("%zu vs %zu\n", off, cbData));
+            RTTESTI_CHECK(memcmp(pbOut, pbData, RT_MIN(off, cbData)) == 0);
+            RTVfsIoStrmRelease(hVfsIos);
+        }
+    }
+
+    RTVfsIoStrmRelease(hVfsIosGz);
+    RTVfsFileRelease(hVfsFileGz);
+    RTMemFree(pbOut);
+    RTMemFree(pbData);
+}
+
+
+/**
+ * Benchmarks the gzip modes, going thru a temporary file so multi-GB inputs
+ * can be used.
+ *
+ * @param   cMiB            The amount of data to compress in MiB.
+ * @param   pszTmpFile      The temporary file.
+ */
+static void tstRTZipGzipBenchmark(uint64_t cMiB, const char *pszTmpFile)
+{
+    RTTestISubF("gzip benchmark - %RU64 MiB", cMiB);
+
+    uint64_t const cbData = cMiB * _1M;
+    size_t   const cbBuf  = _1M;
+    uint8_t *pbBuf = (uint8_t *)RTMemAlloc(cbBuf);
+    uint8_t *pbRef = (uint8_t *)RTMemAlloc(cbBuf);
+    RTTESTI_CHECK_RETV(pbBuf && pbRef);
+
+    for (unsigned iMode = 0; iMode < RT_ELEMENTS(g_aGzipModes); iMode++)
+    {
+        const char * const pszMode = g_aGzipModes[iMode].pszName;
+
+        /*
+         * Compress.
+         */
+        RTVFSIOSTREAM hVfsIosFile;
+        int rc = RTVfsIoStrmOpenNormal(pszTmpFile, RTFILE_O_WRITE | RTFILE_O_CREATE_REPLACE | RTFILE_O_DENY_NONE, &hVfsIosFile);
+        RTTESTI_CHECK_RC_BREAK(rc, VINF_SUCCESS);
+        RTVFSIOSTREAM hVfsIos;
+        rc = RTZipGzipCompressIoStream(hVfsIosFile, g_aGzipModes[iMode].fComp, 6, &hVfsIos);
+        RTVfsIoStrmRelease(hVfsIosFile);
+        RTTESTI_CHECK_RC_BREAK(rc, VINF_SUCCESS);
+
+        uint64_t cNsGen = 0;
+        uint64_t nsStart = RTTimeNanoTS();
+        for (uint64_t off = 0; off < cbData && RT_SUCCESS(rc); off += cbBuf)
+        {
+            uint64_t const nsGen = RTTimeNanoTS();
+            tstRTZipGzipFill(pbBuf, cbBuf, off);
+            cNsGen += RTTimeNanoTS() - nsGen;
+            rc = RTVfsIoStrmWrite(hVfsIos, pbBuf, cbBuf, true /*fBlocking*/, NULL);
+        }
+        RTTESTI_CHECK_RC(rc, VINF_SUCCESS);
+        RTTESTI_CHECK(RTVfsIoStrmRelease(hVfsIos) == 0);
+        uint64_t const cNsComp = RTTimeNanoTS() - nsStart - cNsGen;
+
+        uint64_t cbGz = 0;
+        RTFileQuerySize(pszTmpFile, &cbGz);
+        RTTestIValueF(cbData / RT_MAX(cNsComp / RT_NS_1MS, 1) * RT_MS_1SEC, RTTESTUNIT_BYTES_PER_SEC, "%s compress", pszMode);
+        RTTestIValueF(cbGz * 10000 / RT_MAX(cbData, 1), RTTESTUNIT_PCT, "%s ratio", pszMode);
+
+        /*
+         * Decompress and verify.
+         */
+        for (unsigned iPass = 0; iPass < 2; iPass++)
+        {
+            uint32_t const fDecomp = iPass ? g_aGzipModes[iMode].fDecomp : 0;
+            if (iPass && !fDecomp)
+                continue;
+            rc = RTVfsIoStrmOpenNormal(pszTmpFile, RTFILE_O_READ | RTFILE_O_OPEN | RTFILE_O_DENY_NONE, &hVfsIosFile);
+            RTTESTI_CHECK_RC_BREAK(rc, VINF_SUCCESS);
+            rc = RTZipGzipDecompressIoStream(hVfsIosFile, fDecomp, &hVfsIos);
+            RTVfsIoStrmRelease(hVfsIosFile);
+            RTTESTI_CHECK_RC_BREAK(rc, VINF_SUCCESS);
+
+            uint64_t cNsCheck = 0;
+            nsStart = RTTimeNanoTS();
+            for (uint64_t off = 0; off < cbData && RT_SUCCESS(rc); off += cbBuf)
+            {
+                rc = RTVfsIoStrmRead(hVfsIos, pbBuf, cbBuf, true /*fBlocking*/, NULL);
+                uint64_t const nsCheck = RTTimeNanoTS();
+                tstRTZipGzipFill(pbRef, cbBuf, off);
+                if (RT_SUCCESS(rc) && memcmp(pbBuf, pbRef, cbBuf))
+                {
+                    RTTestIFailed("%s: Mismatch in the MiB at %#RX64", pszMode, off);
+                    rc = VERR_MISMATCH;
+                }
+                cNsCheck += RTTimeNanoTS() - nsCheck;
+            }
+            RTTESTI_CHECK_RC(rc, VINF_SUCCESS);
+            RTVfsIoStrmRelease(hVfsIos);
+            uint64_t const cNsDecomp = RTTimeNanoTS() - nsStart - cNsCheck;
+            RTTestIValueF(cbData / RT_MAX(cNsDecomp / RT_NS_1MS, 1) * RT_MS_1SEC, RTTESTUNIT_BYTES_PER_SEC,
+                          "%s decompress%s", pszMode, fDecomp ? " parallel" : "");
+        }
+
+        /*
+         * Random 4K reads.
+         */
+        if ((g_aGzipModes[iMode].fComp & RTZIPGZIPCOMP_F_BLOCKED) && cbData >= _4K)
+        {
+            RTVFSFILE hVfsFileGz;
+            rc = RTVfsFileOpenNormal(pszTmpFile, RTFILE_O_READ | RTFILE_O_OPEN | RTFILE_O_DENY_NONE, &hVfsFileGz);
+            RTTESTI_CHECK_RC_BREAK(rc, VINF_SUCCESS);
+            RTVFSFILE hVfsFile;
+            nsStart = RTTimeNanoTS();
+            rc = RTZipGzipDecompressFile(hVfsFileGz, 0, &hVfsFile);
+            RTVfsFileRelease(hVfsFileGz);
+            RTTESTI_CHECK_RC_BREAK(rc, VINF_SUCCESS);
+            RTTestIValueF(RTTimeNanoTS() - nsStart, RTTESTUNIT_NS, "%s index", pszMode);
+
+            unsigned const cReads = 1024;
+            nsStart = RTTimeNanoTS();
+            for (unsigned i = 0; i < cReads && RT_SUCCESS(rc); i++)
+            {
+                uint64_t const off = RTRandU64Ex(0, cbData / _4K - 1) * _4K;
+                rc = RTVfsFileReadAt(hVfsFile, off, pbBuf, _4K, NULL);
+            }
+            RTTESTI_CHECK_RC(rc, VINF_SUCCESS);
+            RTTestIValueF((RTTimeNanoTS() - nsStart) / cReads, RTTESTUNIT_NS_PER_CALL, "%s random 4K read", pszMode);
+            RTVfsFileRelease(hVfsFile);
+        }
+    }
+
+    RTFileDelete(pszTmpFile);
+    RTMemFree(pbRef);
+    RTMemFree(pbBuf);
+}
+
+
+/**
+ * Creates an OVA like TAR archive with an OVF descriptor followed by disk
+ * images filled by tstRTZipGzipFill.
+ *
+ * @returns IPRT status code.
+ * @param   hVfsIosTar      Where to write the archive.
+ * @param   cDisks          Number of disk images.
+ * @param   cbDisk          The size of each disk image.
+ */
+static int tstRTZipTarCreateOva(RTVFSIOSTREAM hVfsIosTar, unsigned cDisks, uint64_t cbDisk)
+{
+    RTVFSFSSTREAM hVfsFss;
+    int rc = RTZipTarFsStreamToIoStream(hVfsIosTar, RTZIPTARFORMAT_DEFAULT, 0 /*fFlags*/, &hVfsFss);
+    if (RT_FAILURE(rc))
+        return rc;
+
+    static const char s_szOvf[] = "<?xml version=\"1.0\"?>\n<Envelope/>\n";
+    RTVFSIOSTREAM hVfsIos;
+    rc = RTVfsFsStrmPushFile(hVfsFss, "appliance.ovf", sizeof(s_szOvf) - 1, NULL, 0, 0 /*fFlags*/, &hVfsIos);
+    if (RT_SUCCESS(rc))
+    {
+        rc = RTVfsIoStrmWrite(hVfsIos, s_szOvf, sizeof(s_szOvf) - 1, true /*fBlocking*/, NULL);
+        RTVfsIoStrmRelease(hVfsIos);
+    }
+
+    size_t const cbBuf = _1M;
+    uint8_t *pbBuf = (uint8_t *)RTMemAlloc(cbBuf);
+    if (!pbBuf)
+        rc = VERR_NO_MEMORY;
+    for (unsigned iDisk = 0; iDisk < cDisks && RT_SUCCESS(rc); iDisk++)
+    {
+        char szName[32];
+        RTStrPrintf(szName, sizeof(szName), "appliance-disk%u.vmdk", iDisk + 1);
+        rc = RTVfsFsStrmPushFile(hVfsFss, szName, cbDisk, NULL, 0, 0 /*fFlags*/, &hVfsIos);
+        if (RT_SUCCESS(rc))
+        {
+            uint64_t const offBase = (uint64_t)iDisk * RT_ALIGN_64(cbDisk, _4K);
+            for (uint64_t off = 0; off < cbDisk && RT_SUCCESS(rc); off += cbBuf)
+            {
+                tstRTZipGzipFill(pbBuf, cbBuf, offBase + off);
+                rc = RTVfsIoStrmWrite(hVfsIos, pbBuf, (size_t)RT_MIN(cbBuf, cbDisk - off), true /*fBlocking*/, NULL);
+            }
+            RTVfsIoStrmRelease(hVfsIos);
+        }
+    }
+    RTMemFree(pbBuf);
+
+    int rc2 = RTVfsFsStrmEnd(hVfsFss);
+    if (RT_SUCCESS(rc))
+        rc = rc2;
+    RTVfsFsStrmRelease(hVfsFss);
+    return rc;
+}
+
+
+/**
+ * Reads an OVA like TAR archive, with and without file views.
+ */
+static void tstRTZipTar(void)
+{
+    RTTestISub("tar");
+
+    unsigned const cDisks = 3;
+    uint64_t const cbDisk = _1M + 4321;
+    uint64_t const cbSlot = RT_ALIGN_64(cbDisk, _4K);
+    size_t   const cbData = (size_t)(cDisks * cbSlot);
+    uint8_t *pbData = (uint8_t *)RTMemAlloc(cbData);
+    uint8_t *pbOut  = (uint8_t *)RTMemAlloc((size_t)cbDisk + 1);
+    RTTESTI_CHECK_RETV(pbData && pbOut);
+    tstRTZipGzipFill(pbData, cbData, 0);
+
+    RTVFSFILE hVfsFileTar;
+    RTTESTI_CHECK_RC_RETV(RTVfsMemFileCreate(NIL_RTVFSIOSTREAM, cbData + _64K, &hVfsFileTar), VINF_SUCCESS);
+    RTVFSIOSTREAM hVfsIosTar = RTVfsFileToIoStream(hVfsFileTar);
+    RTTESTI_CHECK_RC(tstRTZipTarCreateOva(hVfsIosTar, cDisks, cbDisk), VINF_SUCCESS);
+
+    for (unsigned iPass = 0; iPass < 2; iPass++)
+    {
+        uint32_t const fFlags = iPass ? RTZIPTAR_R_FILE_VIEWS : 0;
+        RTTESTI_CHECK_RC_BREAK(RTVfsFileSeek(hVfsFileTar, 0, RTFILE_SEEK_BEGIN, NULL), VINF_SUCCESS);
+        RTVFSFSSTREAM hVfsFss;
+        int rc = RTZipTarFsStreamFromIoStream(hVfsIosTar, fFlags, &hVfsFss);
+        RTTESTI_CHECK_RC_BREAK(rc, VINF_SUCCESS);
+
+        /*
+         * Walk the archive, reading each disk sequentially.  With views the
+         * handles are kept around for random access after the walk.
+         */
+        RTVFSFILE ahVfsFiles[cDisks];
+        unsigned  cEntries = 0;
+        for (;;)
+        {
+            char        *pszName;
+            RTVFSOBJTYPE enmType;
+            RTVFSOBJ     hVfsObj;
+            rc = RTVfsFsStrmNext(hVfsFss, &pszName, &enmType, &hVfsObj);
+            if (RT_FAILURE(rc))
+            {
+                RTTESTI_CHECK_RC(rc, VERR_EOF);
+                break;
+            }
+            RTTESTI_CHECK(enmType == (iPass ? RTVFSOBJTYPE_FILE : RTVFSOBJTYPE_IO_STREAM));
+
+            RTFSOBJINFO ObjInfo;
+            RTTESTI_CHECK_RC(RTVfsObjQueryInfo(hVfsObj, &ObjInfo, RTFSOBJATTRADD_UNIX_OWNER), VINF_SUCCESS);
+            RTTESTI_CHECK_MSG(!strcmp(ObjInfo.Attr.u.UnixOwner.szName, "someone"), ("%s\n", ObjInfo.Attr.u.UnixOwner.szName));
+
+            if (cEntries > 0 && cEntries <= cDisks)
+            {
+                RTVFSIOSTREAM hVfsIos = RTVfsObjToIoStream(hVfsObj);
+                size_t cbRead = 0;
+                rc = RTVfsIoStrmRead(hVfsIos, pbOut, (size_t)cbDisk + 1, true /*fBlocking*/, &cbRead);
+                RTTESTI_CHECK_RC(rc, VINF_EOF);
+                RTTESTI_CHECK_MSG(cbRead == cbDisk, ("%zu\n", cbRead));
+                RTTESTI_CHECK(memcmp(pbOut, &pbData[(cEntries - 1) * cbSlot], (size_t)RT_MIN(cbRead, cbDisk)) == 0);
+                RTVfsIoStrmRelease(hVfsIos);
+
+                if (iPass)
+                    ahVfsFiles[cEntries - 1] = RTVfsObjToFile(hVfsObj);
+            }
+            cEntries++;
+            RTVfsObjRelease(hVfsObj);
+            RTStrFree(pszName);
+        }
+        RTTESTI_CHECK_MSG(cEntries == cDisks + 1, ("%u\n", cEntries));
+        RTTESTI_CHECK(RTVfsFsStrmRelease(hVfsFss) == 0);
+
+        /*
+         * Random reads from the views after the stream is gone.
+         */
+        if (iPass && cEntries == cDisks + 1)
+        {
+            for (unsigned iDisk = 0; iDisk < cDisks; iDisk++)
+            {
+                uint64_t cbFile = 0;
+                RTTESTI_CHECK_RC(RTVfsFileGetSize(ahVfsFiles[iDisk], &cbFile), VINF_SUCCESS);
+                RTTESTI_CHECK(cbFile == cbDisk);
+            }
+            for (unsigned i = 0; i < 256; i++)
+            {
+                unsigned const iDisk    = i % cDisks;
+                size_t const   offRead  = (size_t)RTRandU64Ex(0, cbDisk);
+                size_t const   cbRead   = (size_t)RTRandU32Ex(0, i & 1 ? _4K : _256K);
+                size_t         cbActual = 0;
+                rc = RTVfsFileReadAt(ahVfsFiles[iDisk], offRead, pbOut, cbRead, &cbActual);
+                size_t const cbExpect = (size_t)RT_MIN(cbRead, cbDisk - offRead);
+                RTTESTI_CHECK_RC(rc, cbExpect < cbRead ? VINF_EOF : VINF_SUCCESS);
+                RTTESTI_CHECK(cbActual == cbExpect);
+                RTTESTI_CHECK(memcmp(pbOut, &pbData[iDisk * cbSlot + offRead], RT_MIN(cbActual, cbExpect)) == 0);
+            }
+            for (unsigned iDisk = 0; iDisk < cDisks; iDisk++)
+                RTTESTI_CHECK(RTVfsFileRelease(ahVfsFiles[iDisk]) == 0);
+        }
+    }
+
+    RTVfsIoStrmRelease(hVfsIosTar);
+    RTTESTI_CHECK(RTVfsFileRelease(hVfsFileTar) == 0);
+    RTMemFree(pbOut);
+    RTMemFree(pbData);
+}
+
+
+/**
+ * Disk image reader for tstRTZipTarBenchmark, hashing the image like the
+ * appliance import does when verifying the manifest.
+ */
+typedef struct TSTRTZIPTARREADER
+{
+    RTVFSIOSTREAM   hVfsIos;
+    int             rc;
+    uint8_t         abDigest[RTSHA256_HASH_SIZE];
+} TSTRTZIPTARREADER;
+
+
+/**
+ * Reads and hashes one disk image.
+ *
+ * @returns IPRT status code.
+ * @param   pReader         The reader.
+ */
+static int tstRTZipTarBenchmarkRead(TSTRTZIPTARREADER *pReader)
+{
+    size_t const cbBuf = _1M;
+    uint8_t *pbBuf = (uint8_t *)RTMemAlloc(cbBuf);
+    if (!pbBuf)
+        return pReader->rc = VERR_NO_MEMORY;
+
+    RTSHA256CONTEXT Ctx;
+    RTSha256Init(&Ctx);
+    int rc;
+    for (;;)
+    {
+        size_t cbRead = 0;
+        rc = RTVfsIoStrmRead(pReader->hVfsIos, pbBuf, cbBuf, true /*fBlocking*/, &cbRead);
+        if (RT_FAILURE(rc))
+            break;
+        RTSha256Update(&Ctx, pbBuf, cbRead);
+        if (rc == VINF_EOF)
+        {
+            rc = VINF_SUCCESS;
+            break;
+        }
+    }
+    RTSha256Final(&Ctx, pReader->abDigest);
+
+    RTMemFree(pbBuf);
+    return pReader->rc = rc;
+}
+
+
+/**
+ * @callback_method_impl{FNRTTHREAD, tstRTZipTarBenchmarkRead wrapper}
+ */
+static DECLCALLBACK(int) tstRTZipTarBenchmarkThread(RTTHREAD hSelf, void *pvUser)
+{
+    RT_NOREF(hSelf);
+    return tstRTZipTarBenchmarkRead((TSTRTZIPTARREADER *)pvUser);
+}
+
+
+/**
+ * Benchmarks reading an OVA like archive the way the appliance import does it,
+ * sequentially thru the TAR stream and with all the disk images read in
+ * parallel thru file views.
+ *
+ * @param   cMiB            The total size of the disk images in MiB.
+ * @param   pszTmpFile      The temporary file.
+ */
+static void tstRTZipTarBenchmark(uint64_t cMiB, const char *pszTmpFile)
+{
+    unsigned const cDisks = 4;
+    RTTestISubF("tar benchmark - %u x %RU64 MiB", cDisks, cMiB / cDisks);
+
+    uint64_t const cbDisk = RT_MAX(cMiB / cDisks, 1) * _1M;
+    RTVFSIOSTREAM hVfsIosTar;
+    int rc = RTVfsIoStrmOpenNormal(pszTmpFile, RTFILE_O_WRITE | RTFILE_O_CREATE_REPLACE | RTFILE_O_DENY_NONE, &hVfsIosTar);
+    RTTESTI_CHECK_RC_RETV(rc, VINF_SUCCESS);
+    rc = tstRTZipTarCreateOva(hVfsIosTar, cDisks, cbDisk);
+    RTVfsIoStrmRelease(hVfsIosTar);
+    RTTESTI_CHECK_RC_RETV(rc, VINF_SUCCESS);
+
+    uint8_t abDigests[cDisks][RTSHA256_HASH_SIZE];
+    for (unsigned iPass = 0; iPass < 2; iPass++)
+    {
+        rc = RTVfsIoStrmOpenNormal(pszTmpFile, RTFILE_O_READ | RTFILE_O_OPEN | RTFILE_O_DENY_NONE, &hVfsIosTar);
+        RTTESTI_CHECK_RC_BREAK(rc, VINF_SUCCESS);
+        uint64_t const nsStart = RTTimeNanoTS();
+        RTVFSFSSTREAM hVfsFss;
+        rc = RTZipTarFsStreamFromIoStream(hVfsIosTar, iPass ? RTZIPTAR_R_FILE_VIEWS : 0, &hVfsFss);
+        RTVfsIoStrmRelease(hVfsIosTar);
+        RTTESTI_CHECK_RC_BREAK(rc, VINF_SUCCESS);
+
+        TSTRTZIPTARREADER aReaders[cDisks];
+        RTTHREAD          ahThreads[cDisks];
+        unsigned          cReaders = 0;
+        for (;;)
+        {
+            char        *pszName;
+            RTVFSOBJ     hVfsObj;
+            rc = RTVfsFsStrmNext(hVfsFss, &pszName, NULL, &hVfsObj);
+            if (RT_FAILURE(rc))
+                break;
+            if (RTStrStartsWith(pszName, "appliance-disk") && cReaders < cDisks)
+            {
+                TSTRTZIPTARREADER *pReader = &aReaders[cReaders];
+                pReader->hVfsIos = RTVfsObjToIoStream(hVfsObj);
+                pReader->rc      = VERR_INTERNAL_ERROR;
+                ahThreads[cReaders] = NIL_RTTHREAD;
+                if (!iPass)
+                    tstRTZipTarBenchmarkRead(pReader);
+                else
+                    RTThreadCreateF(&ahThreads[cReaders], tstRTZipTarBenchmarkThread, pReader, 0, RTTHREADTYPE_DEFAULT,
+                                    RTTHREADFLAGS_WAITABLE, "tar%u", cReaders);
+                cReaders++;
+            }
+            RTVfsObjRelease(hVfsObj);
+            RTStrFree(pszName);
+        }
+        RTTESTI_CHECK_RC(rc, VERR_EOF);
+        RTVfsFsStrmRelease(hVfsFss);
+
+        for (unsigned i = 0; i < cReaders; i++)
+        {
+            if (ahThreads[i] != NIL_RTTHREAD)
+                RTThreadWait(ahThreads[i], RT_INDEFINITE_WAIT, NULL);
+            else if (iPass)
+                tstRTZipTarBenchmarkRead(&aReaders[i]);
+            RTTESTI_CHECK_RC(aReaders[i].rc, VINF_SUCCESS);
+            RTVfsIoStrmRelease(aReaders[i].hVfsIos);
+            if (!iPass)
+                memcpy(abDigests[i], aReaders[i].abDigest, sizeof(abDigests[i]));
+            else
+                RTTESTI_CHECK(!memcmp(abDigests[i], aReaders[i].abDigest, sizeof(abDigests[i])));
+        }
+        RTTESTI_CHECK(cReaders == cDisks);
+
+        uint64_t const cNsElapsed = RTTimeNanoTS() - nsStart;
+        RTTestIValueF(cDisks * cbDisk / RT_MAX(cNsElapsed / RT_NS_1MS, 1) * RT_MS_1SEC, RTTESTUNIT_BYTES_PER_SEC,
+                      iPass ? "tar file views, parallel" : "tar stream");
+    }
+
+    RTFileDelete(pszTmpFile);
+}
+
+
 int main(int argc, char **argv)
 {
     RTTEST hTest;
@@ -69,14 +758,43 @@ int main(int argc, char **argv)
         return rc;
     RTTestBanner(hTest);
 
-    if (argc > 1)
+    if (argc > 1 && !strcmp(argv[1], "--benchmark"))
+    {
+        /* tstRTZip --benchmark [MiB [tmpfile]] */
+        uint64_t cMiB = 256;
+        if (argc > 2)
+        {
+            rc = RTStrToUInt64Full(argv[2], 0, &cMiB);
+            if (rc != VINF_SUCCESS || cMiB == 0)
+                return RTMsgErrorExit(RTEXITCODE_SYNTAX, "Invalid size: %s", argv[2]);
+        }
+        char szTmpFile[RTPATH_MAX];
+        if (argc > 3)
+            rc = RTStrCopy(szTmpFile, sizeof(szTmpFile), argv[3]);
+        else
+        {
+            rc = RTPathTemp(szTmpFile, sizeof(szTmpFile));
+            if (RT_SUCCESS(rc))
+                rc = RTPathAppend(szTmpFile, sizeof(szTmpFile), "tstRTZip-benchmark.tmp");
+        }
+        if (RT_FAILURE(rc))
+            return RTMsgErrorExit(RTEXITCODE_FAILURE, "Bad temporary file: %Rrc", rc);
+        tstRTZipGzipBenchmark(cMiB, szTmpFile);
+        tstRTZipTarBenchmark(cMiB, szTmpFile);
+    }
+    else if (argc > 1)
     {
         for (int i = 1; i < argc; i++)
             testFile(argv[i]);
     }
     else
     {
-        /** @todo testcase */
+        tstRTZipGzip(0);
+        tstRTZipGzip(1);
+        tstRTZipGzip(_1M);
+        tstRTZipGzip(_16M + 12345);
+        tstRTZipGzipForeign();
+        tstRTZipTar();
     }
 
     /*
@@ -0,0 +1,420 @@
+/* $Id$ */
+/** @file
+ * Testcase for the NBD server of vbox-img.
+ *
+ * Starts "vbox-img serve" on a raw image and talks NBD to it over a local IPC
+ * socket: plain reads, pipelined overlapping unaligned writes (which must be
+ * applied in order), error replies, flush, and a check of the image file
+ * contents after disconnecting.
+ */
+
+/*
+ * Copyright (C) 2017 Oracle Corporation
+ *
+ * This file is part of VirtualBox Open Source Edition (OSE), as
+ * available from http://www.virtualbox.org. This file is free software;
+ * you can redistribute it and/or modify it under the terms of the GNU
+ * General Public License (GPL) as published by the Free Software
+ * Foundation, in version 2 as it comes in the "COPYING" file of the
+ * VirtualBox OSE distribution. VirtualBox OSE is distributed in the
+ * hope that it will be useful, but WITHOUT ANY WARRANTY of any kind.
+ */
+
+
+/*********************************************************************************************************************************
+*   Header Files                                                                                                                 *
+*********************************************************************************************************************************/
+#include <VBox/err.h>
+#include <iprt/asm.h>
+#include <iprt/dir.h>
+#include <iprt/env.h>
+#include <iprt/file.h>
+#include <iprt/localipc.h>
+#include <iprt/mem.h>
+#include <iprt/path.h>
+#include <iprt/process.h>
+#include <iprt/string.h>
+#include <iprt/test.h>
+#include <iprt/thread.h>
+
+
+/*********************************************************************************************************************************
+*   Defined Constants And Macros                                                                                                 *
+*********************************************************************************************************************************/
+/** The file name of vbox-img. */
+#ifdef RT_OS_WINDOWS
+# define TST_VBOX_IMG_NAME      "vbox-img.exe"
+#else
+# define TST_VBOX_IMG_NAME      "vbox-img"
+#endif
+/** The image size. */
+#define TST_DISK_SIZE           _8M
+/** Number of pipelined writes. */
+#define TST_WRITES              32
+/** Offset of the first pipelined write. */
+#define TST_WRITE_OFF           1000
+/** Distance between the pipelined writes. */
+#define TST_WRITE_STRIDE        37
+/** Size of each pipelined write. */
+#define TST_WRITE_SIZE          5000
+
+/** @name The bits of the NBD protocol we need.
+ * @{ */
+#define NBD_MAGIC               UINT64_C(0x4e42444d41474943)
+#define NBD_OPT_MAGIC           UINT64_C(0x49484156454f5054)
+#define NBD_OPT_REPLY_MAGIC     UINT64_C(0x0003e889045565a9)
+#define NBD_REQUEST_MAGIC       UINT32_C(0x25609513)
+#define NBD_SIMPLE_REPLY_MAGIC  UINT32_C(0x67446698)
+#define NBD_FLAG_C_FIXED_NEWSTYLE RT_BIT_32(0)
+#define NBD_FLAG_C_NO_ZEROES    RT_BIT_32(1)
+#define NBD_OPT_GO              7
+#define NBD_REP_ACK             UINT32_C(1)
+#define NBD_REP_INFO            UINT32_C(3)
+#define NBD_INFO_EXPORT         0
+#define NBD_CMD_READ            0
+#define NBD_CMD_WRITE           1
+#define NBD_CMD_DISC            2
+#define NBD_CMD_FLUSH           3
+#define NBD_EINVAL              22
+/** @} */
+
+
+/*********************************************************************************************************************************
+*   Global Variables                                                                                                             *
+*********************************************************************************************************************************/
+static RTLOCALIPCSESSION g_hSession = NIL_RTLOCALIPCSESSION;
+
+
+static uint8_t tstPatternByte(uint64_t off)
+{
+    return (uint8_t)(off ^ (off >> 8) ^ (off >> 16));
+}
+
+
+static int tstRead(void *pvBuf, size_t cb)
+{
+    return RTLocalIpcSessionRead(g_hSession, pvBuf, cb, NULL);
+}
+
+
+/**
+ * Sends a transmission request, with the payload for writes.
+ */
+static int tstSendReq(uint16_t uCmd, uint64_t u64Handle, uint64_t off, uint32_t cb, const void *pvData)
+{
+    uint8_t  abReq[28];
+    uint32_t u32 = RT_H2BE_U32(NBD_REQUEST_MAGIC);
+    memcpy(&abReq[0], &u32, sizeof(u32));
+    uint16_t const au16[2] = { 0, RT_H2BE_U16(uCmd) };
+    memcpy(&abReq[4], au16, sizeof(au16));
+    memcpy(&abReq[8], &u64Handle, sizeof(u64Handle));
+    uint64_t u64 = RT_H2BE_U64(off);
+    memcpy(&abReq[16], &u64, sizeof(u64));
+    u32 = RT_H2BE_U32(cb);
+    memcpy(&abReq[24], &u32, sizeof(u32));
+    int rc = RTLocalIpcSessionWrite(g_hSession, abReq, sizeof(abReq));
+    if (RT_SUCCESS(rc) && uCmd == NBD_CMD_WRITE)
+        rc = RTLocalIpcSessionWrite(g_hSession, pvData, cb);
+    return rc;
+}
+
+
+/**
+ * Receives a simple reply header.
+ */
+static int tstRecvReply(uint64_t *pu64Handle, uint32_t *puErr)
+{
+    uint8_t abReply[16];
+    int rc = tstRead(abReply, sizeof(abReply));
+    if (RT_FAILURE(rc))
+        return rc;
+    uint32_t u32;
+    memcpy(&u32, &abReply[0], sizeof(u32));
+    if (RT_BE2H_U32(u32) != NBD_SIMPLE_REPLY_MAGIC)
+        return VERR_INVALID_MAGIC;
+    memcpy(&u32, &abReply[4], sizeof(u32));
+    *puErr = RT_BE2H_U32(u32);
+    memcpy(pu64Handle, &abReply[8], sizeof(*pu64Handle));
+    return VINF_SUCCESS;
+}
+
+
+/**
+ * Does the handshake, selecting the default export with NBD_OPT_GO.
+ */
+static int tstNegotiate(uint64_t *pcbDisk)
+{
+    uint8_t abHello[18];
+    int rc = tstRead(abHello, sizeof(abHello));
+    if (RT_FAILURE(rc))
+        return rc;
+    uint64_t u64;
+    memcpy(&u64, &abHello[0], sizeof(u64));
+    if (RT_BE2H_U64(u64) != NBD_MAGIC)
+        return VERR_INVALID_MAGIC;
+
+    uint32_t u32 = RT_H2BE_U32(NBD_FLAG_C_FIXED_NEWSTYLE | NBD_FLAG_C_NO_ZEROES);
+    rc = RTLocalIpcSessionWrite(g_hSession, &u32, sizeof(u32));
+    if (RT_FAILURE(rc))
+        return rc;
+
+    /* NBD_OPT_GO with the empty (default) name and no info requests. */
+    uint8_t abOpt[16 + 6];
+    RT_ZERO(abOpt);
+    u64 = RT_H2BE_U64(NBD_OPT_MAGIC);
+    memcpy(&abOpt[0], &u64, sizeof(u64));
+    uint32_t const au32[2] = { RT_H2BE_U32(NBD_OPT_GO), RT_H2BE_U32(6) };
+    memcpy(&abOpt[8], au32, sizeof(au32));
+    rc = RTLocalIpcSessionWrite(g_hSession, abOpt, sizeof(abOpt));
+    if (RT_FAILURE(rc))
+        return rc;
+
+    *pcbDisk = 0;
+    for (;;)
+    {
+        uint8_t abRepHdr[20];
+        rc = tstRead(abRepHdr, sizeof(abRepHdr));
+        if (RT_FAILURE(rc))
+            return rc;
+        memcpy(&u64, &abRepHdr[0], sizeof(u64));
+        if (RT_BE2H_U64(u64) != NBD_OPT_REPLY_MAGIC)
+            return VERR_INVALID_MAGIC;
+        uint32_t au32Rep[3];
+        memcpy(au32Rep, &abRepHdr[8], sizeof(au32Rep));
+        uint32_t const uType  = RT_BE2H_U32(au32Rep[1]);
+        uint32_t const cbData = RT_BE2H_U32(au32Rep[2]);
+        uint8_t abData[256];
+        if (cbData > sizeof(abData))
+            return VERR_BUFFER_OVERFLOW;
+        if (cbData)
+        {
+            rc = tstRead(abData, cbData);
+            if (RT_FAILURE(rc))
+                return rc;
+        }
+
+        if (uType == NBD_REP_ACK)
+            return *pcbDisk ? VINF_SUCCESS : VERR_INVALID_STATE;
+        if (uType == NBD_REP_INFO && cbData >= 10)
+        {
+            uint16_t u16;
+            memcpy(&u16, &abData[0], sizeof(u16));
+            if (RT_BE2H_U16(u16) == NBD_INFO_EXPORT)
+            {
+                memcpy(&u64, &abData[2], sizeof(u64));
+                *pcbDisk = RT_BE2H_U64(u64);
+            }
+        }
+        else if (uType != NBD_REP_INFO)
+            return VERR_NOT_SUPPORTED;
+    }
+}
+
+
+/**
+ * Reads from the export, expecting success.
+ */
+static int tstReadExport(uint64_t off, void *pvBuf, uint32_t cb)
+{
+    int rc = tstSendReq(NBD_CMD_READ, UINT64_C(0x1234), off, cb, NULL);
+    if (RT_FAILURE(rc))
+        return rc;
+    uint64_t u64Handle;
+    uint32_t uErr;
+    rc = tstRecvReply(&u64Handle, &uErr);
+    if (RT_FAILURE(rc))
+        return rc;
+    if (u64Handle != UINT64_C(0x1234) || uErr != 0)
+        return VERR_IO_GEN_FAILURE;
+    return tstRead(pvBuf, cb);
+}
+
+
+static void tstTransmission(uint64_t cbDisk, uint8_t *pbShadow)
+{
+    uint8_t *pbBuf = (uint8_t *)RTMemAlloc(_64K);
+    RTTESTI_CHECK_RETV(pbBuf != NULL);
+
+    RTTestISub("Read");
+    RTTESTI_CHECK(cbDisk == TST_DISK_SIZE);
+    for (uint64_t off = 0; off < TST_DISK_SIZE; off += _1M + 123)
+    {
+        uint32_t const cb = (uint32_t)RT_MIN(_64K, TST_DISK_SIZE - off);
+        RTTESTI_CHECK_RC_BREAK(tstReadExport(off, pbBuf, cb), VINF_SUCCESS);
+        if (memcmp(pbBuf, &pbShadow[off], cb))
+        {
+            RTTestIFailed("Data mismatch reading %#x bytes at %#RX64", cb, off);
+            break;
+        }
+    }
+
+    /*
+     * Overlapping unaligned writes sent back to back.  The server must not
+     * run them concurrently, so the result is as if applied in order.
+     */
+    RTTestISub("Pipelined overlapping writes");
+    for (uint32_t i = 0; i < TST_WRITES; i++)
+    {
+        uint64_t const off = TST_WRITE_OFF + i * TST_WRITE_STRIDE;
+        memset(&pbShadow[off], 0x80 + i, TST_WRITE_SIZE);
+        RTTESTI_CHECK_RC_BREAK(tstSendReq(NBD_CMD_WRITE, i, off, TST_WRITE_SIZE, &pbShadow[off]), VINF_SUCCESS);
+    }
+    uint32_t fHandles = 0;
+    for (uint32_t i = 0; i < TST_WRITES && RTTestIErrorCount() == 0; i++)
+    {
+        uint64_t u64Handle;
+        uint32_t uErr = UINT32_MAX;
+        RTTESTI_CHECK_RC_BREAK(tstRecvReply(&u64Handle, &uErr), VINF_SUCCESS);
+        RTTESTI_CHECK_MSG(uErr == 0, ("handle %RU64: error %u\n", u64Handle, uErr));
+        RTTESTI_CHECK_MSG_BREAK(u64Handle < TST_WRITES && !(fHandles & RT_BIT_32(u64Handle)),
+                                ("unexpected handle %#RX64\n", u64Handle));
+        fHandles |= RT_BIT_32(u64Handle);
+    }
+    uint32_t const cbWritten = (TST_WRITES - 1) * TST_WRITE_STRIDE + TST_WRITE_SIZE;
+    if (RTTestIErrorCount() == 0)
+    {
+        RTTESTI_CHECK_RC(tstReadExport(TST_WRITE_OFF, pbBuf, cbWritten), VINF_SUCCESS);
+        RTTESTI_CHECK(!memcmp(pbBuf, &pbShadow[TST_WRITE_OFF], cbWritten));
+    }
+
+    RTTestISub("Errors and flush");
+    if (RTTestIErrorCount() == 0)
+    {
+        uint64_t u64Handle;
+        uint32_t uErr = 0;
+        RTTESTI_CHECK_RC(tstSendReq(NBD_CMD_READ, 42, TST_DISK_SIZE - 16, 32, NULL), VINF_SUCCESS);
+        RTTESTI_CHECK_RC(tstRecvReply(&u64Handle, &uErr), VINF_SUCCESS);
+        RTTESTI_CHECK(u64Handle == 42);
+        RTTESTI_CHECK(uErr == NBD_EINVAL);
+
+        RTTESTI_CHECK_RC(tstSendReq(NBD_CMD_FLUSH, 43, 0, 0, NULL), VINF_SUCCESS);
+        RTTESTI_CHECK_RC(tstRecvReply(&u64Handle, &uErr), VINF_SUCCESS);
+        RTTESTI_CHECK(u64Handle == 43);
+        RTTESTI_CHECK(uErr == 0);
+    }
+
+    RTTESTI_CHECK_RC(tstSendReq(NBD_CMD_DISC, 44, 0, 0, NULL), VINF_SUCCESS);
+    RTMemFree(pbBuf);
+}
+
+
+int main(int argc, char **argv)
+{
+    RTTEST hTest;
+    RTEXITCODE rcExit = RTTestInitAndCreate("tstVDNbd", &hTest);
+    if (rcExit != RTEXITCODE_SUCCESS)
+        return rcExit;
+    RTTestBanner(hTest);
+
+    /*
+     * Find vbox-img, it lives in the directory above the testcases unless
+     * given on the command line.
+     */
+    char szVBoxImg[RTPATH_MAX];
+    if (argc > 1)
+        RTStrCopy(szVBoxImg, sizeof(szVBoxImg), argv[1]);
+    else
+    {
+        RTPathExecDir(szVBoxImg, sizeof(szVBoxImg));
+        RTPathAppend(szVBoxImg, sizeof(szVBoxImg), TST_VBOX_IMG_NAME);
+        if (!RTFileExists(szVBoxImg))
+        {
+            RTPathExecDir(szVBoxImg, sizeof(szVBoxImg));
+            RTPathAppend(szVBoxImg, sizeof(szVBoxImg), ".." RTPATH_SLASH_STR TST_VBOX_IMG_NAME);
+        }
+    }
+    if (!RTFileExists(szVBoxImg))
+        return RTTestSkipAndDestroy(hTest, "vbox-img not found (%s)", szVBoxImg);
+
+    /*
+     * Create a raw image with a known pattern, keeping a shadow copy.
+     */
+    char szDir[RTPATH_MAX];
+    RTTESTI_CHECK_RC_RET(RTPathTemp(szDir, sizeof(szDir)), VINF_SUCCESS, RTTestSummaryAndDestroy(hTest));
+    RTTESTI_CHECK_RC_RET(RTPathAppend(szDir, sizeof(szDir), "tstVDNbd-XXXXXX"), VINF_SUCCESS, RTTestSummaryAndDestroy(hTest));
+    RTTESTI_CHECK_RC_RET(RTDirCreateTemp(szDir, 0700), VINF_SUCCESS, RTTestSummaryAndDestroy(hTest));
+    char szImage[RTPATH_MAX];
+    RTStrPrintf(szImage, sizeof(szImage), "%s" RTPATH_SLASH_STR "disk.img", szDir);
+    char szSocket[RTPATH_MAX];
+    RTStrPrintf(szSocket, sizeof(szSocket), "%s" RTPATH_SLASH_STR "nbd.sock", szDir);
+
+    uint8_t *pbShadow = (uint8_t *)RTMemAlloc(TST_DISK_SIZE);
+    RTTESTI_CHECK(pbShadow != NULL);
+    if (pbShadow)
+    {
+        for (uint32_t off = 0; off < TST_DISK_SIZE; off++)
+            pbShadow[off] = tstPatternByte(off);
+        RTFILE hFile;
+        int rc = RTFileOpen(&hFile, szImage, RTFILE_O_WRITE | RTFILE_O_CREATE | RTFILE_O_DENY_NONE);
+        RTTESTI_CHECK_RC(rc, VINF_SUCCESS);
+        if (RT_SUCCESS(rc))
+        {
+            RTTESTI_CHECK_RC(RTFileWrite(hFile, pbShadow, TST_DISK_SIZE, NULL), VINF_SUCCESS);
+            RTFileClose(hFile);
+        }
+    }
+
+    /*
+     * Start the server and connect, it takes a moment to start listening.
+     */
+    RTPROCESS hProcess = NIL_RTPROCESS;
+    if (RTTestIErrorCount() == 0)
+    {
+        const char *apszArgs[] =
+        {
+            szVBoxImg, "serve", "--filename", szImage, "--format", "RAW", "--unix", szSocket, "--readwrite", NULL
+        };
+        RTTESTI_CHECK_RC(RTProcCreate(szVBoxImg, apszArgs, RTENV_DEFAULT, 0 /*fFlags*/, &hProcess), VINF_SUCCESS);
+    }
+    if (RTTestIErrorCount() == 0)
+    {
+        int rc = VERR_TIMEOUT;
+        for (unsigned i = 0; i < 100; i++)
+        {
+            rc = RTLocalIpcSessionConnect(&g_hSession, szSocket, RTLOCALIPC_FLAGS_NATIVE_NAME);
+            if (RT_SUCCESS(rc))
+                break;
+            RTThreadSleep(100);
+        }
+        RTTESTI_CHECK_RC(rc, VINF_SUCCESS);
+    }
+
+    if (RTTestIErrorCount() == 0)
+    {
+        RTTestISub("Negotiation");
+        uint64_t cbDisk = 0;
+        RTTESTI_CHECK_RC(tstNegotiate(&cbDisk), VINF_SUCCESS);
+        if (RTTestIErrorCount() == 0)
+            tstTransmission(cbDisk, pbShadow);
+    }
+    if (g_hSession != NIL_RTLOCALIPCSESSION)
+        RTLocalIpcSessionClose(g_hSession);
+
+    /*
+     * Stop the server (it serves until killed) and check the image itself.
+     */
+    if (hProcess != NIL_RTPROCESS)
+    {
+        RTProcTerminate(hProcess);
+        RTPROCSTATUS ProcStatus;
+        RTProcWait(hProcess, RTPROCWAIT_FLAGS_BLOCK, &ProcStatus);
+    }
+    if (RTTestIErrorCount() == 0)
+    {
+        RTTestISub("Image contents");
+        void  *pvFile = NULL;
+        size_t cbFile = 0;
+        int rc = RTFileReadAll(szImage, &pvFile, &cbFile);
+        RTTESTI_CHECK_RC(rc, VINF_SUCCESS);
+        if (RT_SUCCESS(rc))
+        {
+            RTTESTI_CHECK(cbFile == TST_DISK_SIZE);
+            RTTESTI_CHECK(cbFile == TST_DISK_SIZE && !memcmp(pvFile, pbShadow, TST_DISK_SIZE));
+            RTFileReadAllFree(pvFile, cbFile);
+        }
+    }
+
+    RTMemFree(pbShadow);
+    RTDirRemoveRecursive(szDir, RTDIRRMREC_F_CONTENT_AND_DIR);
+    return RTTestSummaryAndDestroy(hTest);
+}
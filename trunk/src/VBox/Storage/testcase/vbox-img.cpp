@@ -23,6 +23,7 @@
 #include <VBox/err.h>
 #include <VBox/version.h>
 #include <iprt/initterm.h>
+#include <iprt/aiomgr.h>
 #include <iprt/asm.h>
 #include <iprt/buildconfig.h>
 #include <iprt/fsvfs.h>
@@ -36,6 +37,15 @@
 #include <iprt/assert.h>
 #include <iprt/dvm.h>
 #include <iprt/vfs.h>
+#include <iprt/critsect.h>
+#include <iprt/file.h>
+#include <iprt/list.h>
+#include <iprt/localipc.h>
+#include <iprt/mem.h>
+#include <iprt/semaphore.h>
+#include <iprt/sg.h>
+#include <iprt/tcp.h>
+#include <iprt/thread.h>
 
 
 /*********************************************************************************************************************************
@@ -100,7 +110,15 @@ static void printUsage(PRTSTREAM pStrm)
                  "   clearcomment --filename <filename>\n"
                  "\n"
                  "   resize       --filename <filename>\n"
-                 "                --size <new size>\n",
+                 "                --size <new size>\n"
+                 "\n"
+                 "   serve        --filename <filename> [--filename <diff> ...]\n"
+                 "                [--format VDI|VMDK|VHD|...]\n"
+                 "                [--readwrite]\n"
+                 "                [--name <export name>]\n"
+                 "                [--address <address>] (default: localhost)\n"
+                 "                [--port <port>] (default: 10809)\n"
+                 "                [--unix <socket path>]\n",
                  g_pszProgName);
 }
 
@@ -2043,6 +2061,1394 @@ static int handleClearResize(HandlerArg *a)
 }
 
 
+/*
+ * NBD export server.
+ *
+ * Implements the server side of the fixed newstyle NBD protocol on top of the
+ * asynchronous VD API.  Every connection has a thread reading and submitting
+ * requests and a thread sending the replies as the requests complete, so a
+ * client can keep many requests in flight.  All connections share the disk.
+ */
+
+/** @name NBD protocol constants.
+ * @{ */
+#define NBD_MAGIC                       UINT64_C(0x4e42444d41474943) /* "NBDMAGIC" */
+#define NBD_OPT_MAGIC                   UINT64_C(0x49484156454f5054) /* "IHAVEOPT" */
+#define NBD_OPT_REPLY_MAGIC             UINT64_C(0x0003e889045565a9)
+#define NBD_REQUEST_MAGIC               UINT32_C(0x25609513)
+#define NBD_SIMPLE_REPLY_MAGIC          UINT32_C(0x67446698)
+#define NBD_STRUCTURED_REPLY_MAGIC      UINT32_C(0x668e33ef)
+
+#define NBD_FLAG_FIXED_NEWSTYLE         RT_BIT_32(0)
+#define NBD_FLAG_NO_ZEROES              RT_BIT_32(1)
+#define NBD_FLAG_C_FIXED_NEWSTYLE       RT_BIT_32(0)
+#define NBD_FLAG_C_NO_ZEROES            RT_BIT_32(1)
+
+#define NBD_FLAG_HAS_FLAGS              RT_BIT_32(0)
+#define NBD_FLAG_READ_ONLY              RT_BIT_32(1)
+#define NBD_FLAG_SEND_FLUSH             RT_BIT_32(2)
+#define NBD_FLAG_CAN_MULTI_CONN         RT_BIT_32(8)
+
+#define NBD_OPT_EXPORT_NAME             1
+#define NBD_OPT_ABORT                   2
+#define NBD_OPT_LIST                    3
+#define NBD_OPT_INFO                    6
+#define NBD_OPT_GO                      7
+#define NBD_OPT_STRUCTURED_REPLY        8
+#define NBD_OPT_LIST_META_CONTEXT       9
+#define NBD_OPT_SET_META_CONTEXT        10
+
+#define NBD_REP_ACK                     UINT32_C(1)
+#define NBD_REP_SERVER                  UINT32_C(2)
+#define NBD_REP_INFO                    UINT32_C(3)
+#define NBD_REP_META_CONTEXT            UINT32_C(4)
+#define NBD_REP_ERR_UNSUP               UINT32_C(0x80000001)
+#define NBD_REP_ERR_INVALID             UINT32_C(0x80000003)
+#define NBD_REP_ERR_UNKNOWN             UINT32_C(0x80000006)
+
+#define NBD_INFO_EXPORT                 0
+#define NBD_INFO_BLOCK_SIZE             3
+
+#define NBD_CMD_READ                    0
+#define NBD_CMD_WRITE                   1
+#define NBD_CMD_DISC                    2
+#define NBD_CMD_FLUSH                   3
+#define NBD_CMD_BLOCK_STATUS            7
+
+#define NBD_CMD_FLAG_REQ_ONE            RT_BIT_32(3)
+
+#define NBD_REPLY_FLAG_DONE             RT_BIT_32(0)
+#define NBD_REPLY_TYPE_OFFSET_DATA      1
+#define NBD_REPLY_TYPE_BLOCK_STATUS     5
+#define NBD_REPLY_TYPE_ERROR            UINT16_C(0x8001)
+
+#define NBD_STATE_ZERO                  RT_BIT_32(1)
+
+#define NBD_EPERM                       1
+#define NBD_EIO                         5
+#define NBD_ENOMEM                      12
+#define NBD_EINVAL                      22
+#define NBD_ENOSPC                      28
+/** @} */
+
+/** The default NBD port. */
+#define VBOXIMG_NBD_PORT                10809
+/** The largest read or write request accepted. */
+#define VBOXIMG_NBD_MAX_REQ             _32M
+/** The most data looked at for a block status request. */
+#define VBOXIMG_NBD_MAX_STATUS          _4M
+/** The block status granularity. */
+#define VBOXIMG_NBD_STATUS_BLOCK        _4K
+/** The number of requests a connection may have in flight. */
+#define VBOXIMG_NBD_MAX_IN_FLIGHT       64
+/** Space reserved in front of the request data for the reply header. */
+#define VBOXIMG_NBD_REPLY_HDR_MAX       32
+/** The context ID of base:allocation. */
+#define VBOXIMG_NBD_CTX_BASE_ALLOCATION 1
+/** The granularity of write range locks.  VD writes partial allocation blocks
+ * as a read-modify-write of the whole block, so concurrent writes touching the
+ * same block must be serialized.  This covers the largest block size of the
+ * formats (VHD). */
+#define VBOXIMG_NBD_WRITE_LOCK_GRANULE  _2M
+
+/** The exported disk, shared by all connections. */
+typedef struct VBOXIMGNBDEXPORT
+{
+    /** The disk container. */
+    PVDISK          pDisk;
+    /** The disk size. */
+    uint64_t        cbDisk;
+    /** The export name. */
+    const char     *pszName;
+    /** Whether writing is allowed. */
+    bool            fReadOnly;
+    /** Protects the write range lock lists. */
+    RTCRITSECT      RangeCritSect;
+    /** Writes in progress (VBOXIMGNBDREQ::RangeNode). */
+    RTLISTANCHOR    WriteRanges;
+    /** Connections waiting for a write range (VBOXIMGNBDCONN::RangeWaitNode). */
+    RTLISTANCHOR    RangeWaiters;
+} VBOXIMGNBDEXPORT;
+typedef VBOXIMGNBDEXPORT *PVBOXIMGNBDEXPORT;
+
+/** One NBD connection. */
+typedef struct VBOXIMGNBDCONN
+{
+    /** The export. */
+    PVBOXIMGNBDEXPORT           pExport;
+    /** The TCP socket, NIL_RTSOCKET for local IPC. */
+    RTSOCKET                    hSocket;
+    /** The local IPC session, NIL_RTLOCALIPCSESSION for TCP. */
+    RTLOCALIPCSESSION           hSession;
+    /** Whether structured replies were negotiated. */
+    bool                        fStructuredReplies;
+    /** Whether the base:allocation meta context was selected. */
+    bool                        fBaseAllocation;
+    /** Protects the members below. */
+    RTCRITSECT                  CritSect;
+    /** Completed requests waiting for their reply to be sent. */
+    struct VBOXIMGNBDREQ       *pReplyHead;
+    /** Tail of the reply queue. */
+    struct VBOXIMGNBDREQ       *pReplyTail;
+    /** Number of requests submitted and not yet replied to. */
+    uint32_t                    cReqsActive;
+    /** Set when the reader is done, the sender quits once all replies are out. */
+    bool                        fShutdown;
+    /** Signalled when a reply is queued or on shutdown. */
+    RTSEMEVENT                  hEvtReply;
+    /** Signalled when a reply was sent or a write range was unlocked, wakes up
+     * the reader. */
+    RTSEMEVENT                  hEvtSent;
+    /** Node in VBOXIMGNBDEXPORT::RangeWaiters while waiting for a write range. */
+    RTLISTNODE                  RangeWaitNode;
+} VBOXIMGNBDCONN;
+typedef VBOXIMGNBDCONN *PVBOXIMGNBDCONN;
+
+/** One NBD transmission request. */
+typedef struct VBOXIMGNBDREQ
+{
+    /** Next in the reply queue. */
+    struct VBOXIMGNBDREQ       *pNext;
+    /** The connection. */
+    PVBOXIMGNBDCONN             pConn;
+    /** The command. */
+    uint16_t                    uCmd;
+    /** The command flags. */
+    uint16_t                    fCmd;
+    /** The handle to echo back. */
+    uint64_t                    u64Handle;
+    /** The disk offset. */
+    uint64_t                    off;
+    /** The transfer size. */
+    uint32_t                    cb;
+    /** The result. */
+    int                         rc;
+    /** Start of the locked write range, aligned to VBOXIMG_NBD_WRITE_LOCK_GRANULE. */
+    uint64_t                    offLockFirst;
+    /** End of the locked write range (exclusive), aligned likewise. */
+    uint64_t                    offLockEnd;
+    /** Node in VBOXIMGNBDEXPORT::WriteRanges, valid when fRangeLocked is set. */
+    RTLISTNODE                  RangeNode;
+    /** Whether the request holds a write range lock. */
+    bool                        fRangeLocked;
+    /** The S/G buffer describing the data. */
+    RTSGBUF                     SgBuf;
+    /** The data segment. */
+    RTSGSEG                     Seg;
+    /** The buffer, with VBOXIMG_NBD_REPLY_HDR_MAX bytes for the reply header
+     * in front of the data. */
+    uint8_t                    *pbBuf;
+} VBOXIMGNBDREQ;
+typedef VBOXIMGNBDREQ *PVBOXIMGNBDREQ;
+
+/** Image file handle of the asynchronous I/O interface. */
+typedef struct VBOXIMGNBDSTORAGE
+{
+    /** The file. */
+    RTFILE                      hFile;
+    /** The file handle of the I/O manager. */
+    RTAIOMGRFILE                hAioMgrFile;
+    /** The VD completion callback. */
+    PFNVDCOMPLETED              pfnCompleted;
+} VBOXIMGNBDSTORAGE;
+typedef VBOXIMGNBDSTORAGE *PVBOXIMGNBDSTORAGE;
+
+/** A transfer submitted to the I/O manager. */
+typedef struct VBOXIMGNBDAIOREQ
+{
+    /** The VD completion argument, for asynchronous transfers. */
+    void                       *pvCompletion;
+    /** Event to signal for synchronous transfers, NIL_RTSEMEVENT otherwise. */
+    RTSEMEVENT                  hEvtSync;
+    /** The status of a synchronous transfer. */
+    int                         rcSync;
+} VBOXIMGNBDAIOREQ;
+typedef VBOXIMGNBDAIOREQ *PVBOXIMGNBDAIOREQ;
+
+/** The I/O manager shared by all image files. */
+static RTAIOMGR g_hNbdAioMgr = NIL_RTAIOMGR;
+
+
+static DECLCALLBACK(void) nbdAioComplete(RTAIOMGRFILE hAioMgrFile, int rcReq, void *pvUser)
+{
+    PVBOXIMGNBDSTORAGE pStorage = (PVBOXIMGNBDSTORAGE)RTAioMgrFileGetUser(hAioMgrFile);
+    PVBOXIMGNBDAIOREQ  pAioReq  = (PVBOXIMGNBDAIOREQ)pvUser;
+    if (pAioReq->hEvtSync != NIL_RTSEMEVENT)
+    {
+        pAioReq->rcSync = rcReq;
+        RTSemEventSignal(pAioReq->hEvtSync); /* The waiter owns pAioReq from here on. */
+    }
+    else
+    {
+        void *pvCompletion = pAioReq->pvCompletion;
+        RTMemFree(pAioReq);
+        pStorage->pfnCompleted(pvCompletion, rcReq);
+    }
+}
+
+/**
+ * Submits a transfer to the I/O manager.
+ *
+ * The image files are opened for asynchronous, uncached I/O, so the
+ * synchronous callbacks go through the I/O manager too, which takes care of
+ * any alignment restrictions.
+ */
+static int nbdAioSubmit(PVBOXIMGNBDSTORAGE pStorage, VDIOREQTYPE enmType, uint64_t off,
+                        PCRTSGSEG paSegs, size_t cSegs, size_t cb, void *pvCompletion)
+{
+    RTSGBUF SgBuf;
+    if (paSegs)
+        RTSgBufInit(&SgBuf, paSegs, cSegs);
+
+    VBOXIMGNBDAIOREQ SyncReq;
+    PVBOXIMGNBDAIOREQ pAioReq = &SyncReq;
+    int rc;
+    if (!pvCompletion)
+    {
+        SyncReq.pvCompletion = NULL;
+        SyncReq.rcSync       = VERR_INTERNAL_ERROR;
+        rc = RTSemEventCreate(&SyncReq.hEvtSync);
+        if (RT_FAILURE(rc))
+            return rc;
+    }
+    else
+    {
+        pAioReq = (PVBOXIMGNBDAIOREQ)RTMemAlloc(sizeof(*pAioReq));
+        if (!pAioReq)
+            return VERR_NO_MEMORY;
+        pAioReq->pvCompletion = pvCompletion;
+        pAioReq->hEvtSync     = NIL_RTSEMEVENT;
+    }
+
+    if (enmType == VDIOREQTYPE_READ)
+        rc = RTAioMgrFileRead(pStorage->hAioMgrFile, off, &SgBuf, cb, pAioReq);
+    else if (enmType == VDIOREQTYPE_WRITE)
+        rc = RTAioMgrFileWrite(pStorage->hAioMgrFile, off, &SgBuf, cb, pAioReq);
+    else
+        rc = RTAioMgrFileFlush(pStorage->hAioMgrFile, pAioReq);
+
+    if (!pvCompletion)
+    {
+        if (RT_SUCCESS(rc))
+        {
+            RTSemEventWait(SyncReq.hEvtSync, RT_INDEFINITE_WAIT);
+            rc = SyncReq.rcSync;
+        }
+        RTSemEventDestroy(SyncReq.hEvtSync);
+    }
+    else if (RT_SUCCESS(rc))
+        rc = VERR_VD_ASYNC_IO_IN_PROGRESS;
+    else
+        RTMemFree(pAioReq);
+    return rc;
+}
+
+static DECLCALLBACK(int) nbdIoOpen(void *pvUser, const char *pszLocation, uint32_t fOpen, PFNVDCOMPLETED pfnCompleted,
+                                   void **ppStorage)
+{
+    RT_NOREF(pvUser);
+    PVBOXIMGNBDSTORAGE pStorage = (PVBOXIMGNBDSTORAGE)RTMemAllocZ(sizeof(*pStorage));
+    if (!pStorage)
+        return VERR_NO_MEMORY;
+
+    int rc = RTFileOpen(&pStorage->hFile, pszLocation, fOpen | RTFILE_O_ASYNC_IO | RTFILE_O_NO_CACHE);
+    if (rc == VERR_INVALID_PARAMETER) /* Some file systems don't do uncached I/O. */
+        rc = RTFileOpen(&pStorage->hFile, pszLocation, fOpen | RTFILE_O_ASYNC_IO);
+    if (RT_SUCCESS(rc))
+    {
+        rc = RTAioMgrFileCreate(g_hNbdAioMgr, pStorage->hFile, nbdAioComplete, pStorage, &pStorage->hAioMgrFile);
+        if (RT_SUCCESS(rc))
+        {
+            pStorage->pfnCompleted = pfnCompleted;
+            *ppStorage = pStorage;
+            return VINF_SUCCESS;
+        }
+        RTFileClose(pStorage->hFile);
+    }
+    RTMemFree(pStorage);
+    return rc;
+}
+
+static DECLCALLBACK(int) nbdIoClose(void *pvUser, void *pStorage)
+{
+    RT_NOREF(pvUser);
+    PVBOXIMGNBDSTORAGE pThis = (PVBOXIMGNBDSTORAGE)pStorage;
+    RTAioMgrFileRelease(pThis->hAioMgrFile);
+    int rc = RTFileClose(pThis->hFile);
+    RTMemFree(pThis);
+    return rc;
+}
+
+static DECLCALLBACK(int) nbdIoDelete(void *pvUser, const char *pcszFilename)
+{
+    RT_NOREF(pvUser);
+    return RTFileDelete(pcszFilename);
+}
+
+static DECLCALLBACK(int) nbdIoMove(void *pvUser, const char *pcszSrc, const char *pcszDst, unsigned fMove)
+{
+    RT_NOREF(pvUser);
+    return RTFileMove(pcszSrc, pcszDst, fMove);
+}
+
+static DECLCALLBACK(int) nbdIoGetFreeSpace(void *pvUser, const char *pcszFilename, int64_t *pcbFreeSpace)
+{
+    RT_NOREF(pvUser);
+    RTFOFF cbFree = 0;
+    int rc = RTFsQuerySizes(pcszFilename, NULL, &cbFree, NULL, NULL);
+    if (RT_SUCCESS(rc))
+        *pcbFreeSpace = cbFree;
+    return rc;
+}
+
+static DECLCALLBACK(int) nbdIoGetModificationTime(void *pvUser, const char *pcszFilename, PRTTIMESPEC pModificationTime)
+{
+    RT_NOREF(pvUser);
+    RTFSOBJINFO Info;
+    int rc = RTPathQueryInfo(pcszFilename, &Info, RTFSOBJATTRADD_NOTHING);
+    if (RT_SUCCESS(rc))
+        *pModificationTime = Info.ModificationTime;
+    return rc;
+}
+
+static DECLCALLBACK(int) nbdIoGetSize(void *pvUser, void *pStorage, uint64_t *pcbSize)
+{
+    RT_NOREF(pvUser);
+    return RTFileGetSize(((PVBOXIMGNBDSTORAGE)pStorage)->hFile, pcbSize);
+}
+
+static DECLCALLBACK(int) nbdIoSetSize(void *pvUser, void *pStorage, uint64_t cbSize)
+{
+    RT_NOREF(pvUser);
+    return RTFileSetSize(((PVBOXIMGNBDSTORAGE)pStorage)->hFile, cbSize);
+}
+
+static DECLCALLBACK(int) nbdIoSetAllocationSize(void *pvUser, void *pStorage, uint64_t cbSize, uint32_t fFlags)
+{
+    RT_NOREF(pvUser, pStorage, cbSize, fFlags);
+    return VERR_NOT_SUPPORTED;
+}
+
+static DECLCALLBACK(int) nbdIoReadSync(void *pvUser, void *pStorage, uint64_t off, void *pvBuf, size_t cbRead,
+                                       size_t *pcbRead)
+{
+    RT_NOREF(pvUser);
+    RTSGSEG Seg = { pvBuf, cbRead };
+    int rc = nbdAioSubmit((PVBOXIMGNBDSTORAGE)pStorage, VDIOREQTYPE_READ, off, &Seg, 1, cbRead, NULL);
+    if (RT_SUCCESS(rc) && pcbRead)
+        *pcbRead = cbRead;
+    return rc;
+}
+
+static DECLCALLBACK(int) nbdIoWriteSync(void *pvUser, void *pStorage, uint64_t off, const void *pvBuf, size_t cbWrite,
+                                        size_t *pcbWritten)
+{
+    RT_NOREF(pvUser);
+    RTSGSEG Seg = { (void *)pvBuf, cbWrite };
+    int rc = nbdAioSubmit((PVBOXIMGNBDSTORAGE)pStorage, VDIOREQTYPE_WRITE, off, &Seg, 1, cbWrite, NULL);
+    if (RT_SUCCESS(rc) && pcbWritten)
+        *pcbWritten = cbWrite;
+    return rc;
+}
+
+static DECLCALLBACK(int) nbdIoFlushSync(void *pvUser, void *pStorage)
+{
+    RT_NOREF(pvUser);
+    return nbdAioSubmit((PVBOXIMGNBDSTORAGE)pStorage, VDIOREQTYPE_FLUSH, 0, NULL, 0, 0, NULL);
+}
+
+static DECLCALLBACK(int) nbdIoReadAsync(void *pvUser, void *pStorage, uint64_t off, PCRTSGSEG paSegments, size_t cSegments,
+                                        size_t cbRead, void *pvCompletion, void **ppTask)
+{
+    RT_NOREF(pvUser, ppTask);
+    return nbdAioSubmit((PVBOXIMGNBDSTORAGE)pStorage, VDIOREQTYPE_READ, off, paSegments, cSegments, cbRead,
+                        pvCompletion);
+}
+
+static DECLCALLBACK(int) nbdIoWriteAsync(void *pvUser, void *pStorage, uint64_t off, PCRTSGSEG paSegments, size_t cSegments,
+                                         size_t cbWrite, void *pvCompletion, void **ppTask)
+{
+    RT_NOREF(pvUser, ppTask);
+    return nbdAioSubmit((PVBOXIMGNBDSTORAGE)pStorage, VDIOREQTYPE_WRITE, off, paSegments, cSegments, cbWrite,
+                        pvCompletion);
+}
+
+static DECLCALLBACK(int) nbdIoFlushAsync(void *pvUser, void *pStorage, void *pvCompletion, void **ppTask)
+{
+    RT_NOREF(pvUser, ppTask);
+    return nbdAioSubmit((PVBOXIMGNBDSTORAGE)pStorage, VDIOREQTYPE_FLUSH, 0, NULL, 0, 0, pvCompletion);
+}
+
+
+static int nbdRead(PVBOXIMGNBDCONN pConn, void *pvBuf, size_t cb)
+{
+    if (pConn->hSocket != NIL_RTSOCKET)
+        return RTTcpRead(pConn->hSocket, pvBuf, cb, NULL);
+    return RTLocalIpcSessionRead(pConn->hSession, pvBuf, cb, NULL);
+}
+
+static int nbdWrite(PVBOXIMGNBDCONN pConn, const void *pvBuf, size_t cb)
+{
+    if (pConn->hSocket != NIL_RTSOCKET)
+        return RTTcpWrite(pConn->hSocket, pvBuf, cb);
+    return RTLocalIpcSessionWrite(pConn->hSession, pvBuf, cb);
+}
+
+/** Reads and drops @a cb bytes, for payloads we won't process. */
+static int nbdSkip(PVBOXIMGNBDCONN pConn, uint64_t cb)
+{
+    uint8_t abBuf[_4K];
+    while (cb > 0)
+    {
+        size_t cbThis = (size_t)RT_MIN(cb, sizeof(abBuf));
+        int rc = nbdRead(pConn, abBuf, cbThis);
+        if (RT_FAILURE(rc))
+            return rc;
+        cb -= cbThis;
+    }
+    return VINF_SUCCESS;
+}
+
+/** Sends an option reply. */
+static int nbdOptReply(PVBOXIMGNBDCONN pConn, uint32_t uOpt, uint32_t uReply, const void *pvData, uint32_t cbData)
+{
+    uint8_t abReply[20 + 256];
+    AssertReturn(cbData <= sizeof(abReply) - 20, VERR_BUFFER_OVERFLOW);
+    uint64_t const u64Magic = RT_H2BE_U64(NBD_OPT_REPLY_MAGIC);
+    uint32_t const au32Hdr[3] = { RT_H2BE_U32(uOpt), RT_H2BE_U32(uReply), RT_H2BE_U32(cbData) };
+    memcpy(&abReply[0], &u64Magic, sizeof(u64Magic));
+    memcpy(&abReply[8], au32Hdr, sizeof(au32Hdr));
+    if (cbData)
+        memcpy(&abReply[20], pvData, cbData);
+    return nbdWrite(pConn, abReply, 20 + cbData);
+}
+
+/** Sends the NBD_INFO_EXPORT information of NBD_OPT_INFO and NBD_OPT_GO. */
+static int nbdOptReplyInfo(PVBOXIMGNBDCONN pConn, uint32_t uOpt)
+{
+    PVBOXIMGNBDEXPORT pExport = pConn->pExport;
+    uint16_t const fFlags = NBD_FLAG_HAS_FLAGS | NBD_FLAG_SEND_FLUSH | NBD_FLAG_CAN_MULTI_CONN
+                          | (pExport->fReadOnly ? NBD_FLAG_READ_ONLY : 0);
+    uint8_t abInfo[12];
+    uint16_t u16 = RT_H2BE_U16(NBD_INFO_EXPORT);
+    uint64_t u64 = RT_H2BE_U64(pExport->cbDisk);
+    memcpy(&abInfo[0], &u16, sizeof(u16));
+    memcpy(&abInfo[2], &u64, sizeof(u64));
+    u16 = RT_H2BE_U16(fFlags);
+    memcpy(&abInfo[10], &u16, sizeof(u16));
+    int rc = nbdOptReply(pConn, uOpt, NBD_REP_INFO, abInfo, sizeof(abInfo));
+    if (RT_SUCCESS(rc))
+    {
+        /* Minimum, preferred and maximum request sizes. */
+        uint8_t abBlockSize[14];
+        uint32_t const au32[3] = { RT_H2BE_U32(1), RT_H2BE_U32(_64K), RT_H2BE_U32(VBOXIMG_NBD_MAX_REQ) };
+        u16 = RT_H2BE_U16(NBD_INFO_BLOCK_SIZE);
+        memcpy(&abBlockSize[0], &u16, sizeof(u16));
+        memcpy(&abBlockSize[2], au32, sizeof(au32));
+        rc = nbdOptReply(pConn, uOpt, NBD_REP_INFO, abBlockSize, sizeof(abBlockSize));
+    }
+    return rc;
+}
+
+/** Checks whether the client asked for our export. */
+static bool nbdIsOurExport(PVBOXIMGNBDCONN pConn, const char *pchName, size_t cchName)
+{
+    /* The empty name selects the default export, which is the only one. */
+    return    !cchName
+           || (   cchName == strlen(pConn->pExport->pszName)
+               && !memcmp(pchName, pConn->pExport->pszName, cchName));
+}
+
+/**
+ * Handles NBD_OPT_LIST_META_CONTEXT and NBD_OPT_SET_META_CONTEXT.  The only
+ * context we know is base:allocation.
+ */
+static int nbdOptMetaContext(PVBOXIMGNBDCONN pConn, uint32_t uOpt, const uint8_t *pbData, uint32_t cbData)
+{
+    static const char s_szBaseAllocation[] = "base:allocation";
+
+    /* Export name length, export name, query count, queries. */
+    uint32_t u32;
+    if (cbData < 4)
+        return nbdOptReply(pConn, uOpt, NBD_REP_ERR_INVALID, NULL, 0);
+    memcpy(&u32, pbData, sizeof(u32));
+    uint32_t const cchName = RT_BE2H_U32(u32);
+    if (cchName > cbData - 4 || cbData - 4 - cchName < 4)
+        return nbdOptReply(pConn, uOpt, NBD_REP_ERR_INVALID, NULL, 0);
+    if (!nbdIsOurExport(pConn, (const char *)&pbData[4], cchName))
+        return nbdOptReply(pConn, uOpt, NBD_REP_ERR_UNKNOWN, NULL, 0);
+    if (uOpt == NBD_OPT_SET_META_CONTEXT && !pConn->fStructuredReplies)
+        return nbdOptReply(pConn, uOpt, NBD_REP_ERR_INVALID, NULL, 0);
+
+    uint32_t off = 4 + cchName;
+    memcpy(&u32, &pbData[off], sizeof(u32));
+    uint32_t cQueries = RT_BE2H_U32(u32);
+    off += 4;
+
+    bool fMatch = uOpt == NBD_OPT_LIST_META_CONTEXT && cQueries == 0; /* Listing everything. */
+    for (uint32_t i = 0; i < cQueries; i++)
+    {
+        if (cbData - off < 4)
+            return nbdOptReply(pConn, uOpt, NBD_REP_ERR_INVALID, NULL, 0);
+        memcpy(&u32, &pbData[off], sizeof(u32));
+        uint32_t const cchQuery = RT_BE2H_U32(u32);
+        off += 4;
+        if (cchQuery > cbData - off)
+            return nbdOptReply(pConn, uOpt, NBD_REP_ERR_INVALID, NULL, 0);
+        const char *pchQuery = (const char *)&pbData[off];
+        if (   (cchQuery == sizeof(s_szBaseAllocation) - 1 && !memcmp(pchQuery, s_szBaseAllocation, cchQuery))
+            || (   uOpt == NBD_OPT_LIST_META_CONTEXT
+                && cchQuery == sizeof("base:") - 1 && !memcmp(pchQuery, "base:", cchQuery)))
+            fMatch = true;
+        off += cchQuery;
+    }
+
+    if (uOpt == NBD_OPT_SET_META_CONTEXT)
+        pConn->fBaseAllocation = fMatch;
+    if (fMatch)
+    {
+        uint8_t abCtx[4 + sizeof(s_szBaseAllocation) - 1];
+        u32 = RT_H2BE_U32(VBOXIMG_NBD_CTX_BASE_ALLOCATION);
+        memcpy(&abCtx[0], &u32, sizeof(u32));
+        memcpy(&abCtx[4], s_szBaseAllocation, sizeof(s_szBaseAllocation) - 1);
+        int rc = nbdOptReply(pConn, uOpt, NBD_REP_META_CONTEXT, abCtx, sizeof(abCtx));
+        if (RT_FAILURE(rc))
+            return rc;
+    }
+    return nbdOptReply(pConn, uOpt, NBD_REP_ACK, NULL, 0);
+}
+
+/**
+ * Does the handshake and option haggling.
+ *
+ * @returns VINF_SUCCESS when entering the transmission phase, VINF_EOF if the
+ *          client went away or aborted, failure status otherwise.
+ */
+static int nbdNegotiate(PVBOXIMGNBDCONN pConn)
+{
+    uint8_t abHello[18];
+    uint64_t u64 = RT_H2BE_U64(NBD_MAGIC);
+    memcpy(&abHello[0], &u64, sizeof(u64));
+    u64 = RT_H2BE_U64(NBD_OPT_MAGIC);
+    memcpy(&abHello[8], &u64, sizeof(u64));
+    uint16_t u16 = RT_H2BE_U16(NBD_FLAG_FIXED_NEWSTYLE | NBD_FLAG_NO_ZEROES);
+    memcpy(&abHello[16], &u16, sizeof(u16));
+    int rc = nbdWrite(pConn, abHello, sizeof(abHello));
+    if (RT_FAILURE(rc))
+        return rc;
+
+    uint32_t fClient;
+    rc = nbdRead(pConn, &fClient, sizeof(fClient));
+    if (RT_FAILURE(rc))
+        return rc;
+    fClient = RT_BE2H_U32(fClient);
+    if (!(fClient & NBD_FLAG_C_FIXED_NEWSTYLE))
+        return VERR_NOT_SUPPORTED;
+
+    uint8_t abData[_4K];
+    for (;;)
+    {
+        uint8_t abOpt[16];
+        rc = nbdRead(pConn, abOpt, sizeof(abOpt));
+        if (RT_FAILURE(rc))
+            return rc;
+        uint32_t au32[2];
+        memcpy(&u64, &abOpt[0], sizeof(u64));
+        memcpy(au32, &abOpt[8], sizeof(au32));
+        if (RT_BE2H_U64(u64) != NBD_OPT_MAGIC)
+            return VERR_INVALID_MAGIC;
+        uint32_t const uOpt   = RT_BE2H_U32(au32[0]);
+        uint32_t const cbData = RT_BE2H_U32(au32[1]);
+
+        if (cbData > sizeof(abData))
+        {
+            rc = nbdSkip(pConn, cbData);
+            if (RT_SUCCESS(rc))
+                rc = nbdOptReply(pConn, uOpt, NBD_REP_ERR_INVALID, NULL, 0);
+            if (RT_FAILURE(rc))
+                return rc;
+            continue;
+        }
+        if (cbData)
+        {
+            rc = nbdRead(pConn, abData, cbData);
+            if (RT_FAILURE(rc))
+                return rc;
+        }
+
+        switch (uOpt)
+        {
+            case NBD_OPT_EXPORT_NAME:
+            {
+                if (!nbdIsOurExport(pConn, (const char *)abData, cbData))
+                    return VERR_NOT_FOUND; /* No way to say no but hanging up. */
+                PVBOXIMGNBDEXPORT pExport = pConn->pExport;
+                uint8_t abReply[10 + 124];
+                RT_ZERO(abReply);
+                u64 = RT_H2BE_U64(pExport->cbDisk);
+                memcpy(&abReply[0], &u64, sizeof(u64));
+                u16 = RT_H2BE_U16(NBD_FLAG_HAS_FLAGS | NBD_FLAG_SEND_FLUSH | NBD_FLAG_CAN_MULTI_CONN
+                                  | (pExport->fReadOnly ? NBD_FLAG_READ_ONLY : 0));
+                memcpy(&abReply[8], &u16, sizeof(u16));
+                return nbdWrite(pConn, abReply, fClient & NBD_FLAG_C_NO_ZEROES ? 10 : sizeof(abReply));
+            }
+
+            case NBD_OPT_ABORT:
+                nbdOptReply(pConn, uOpt, NBD_REP_ACK, NULL, 0);
+                return VINF_EOF;
+
+            case NBD_OPT_LIST:
+            {
+                size_t const cchName = strlen(pConn->pExport->pszName);
+                uint8_t abServer[4 + 252];
+                if (cbData || cchName > sizeof(abServer) - 4)
+                {
+                    rc = nbdOptReply(pConn, uOpt, NBD_REP_ERR_INVALID, NULL, 0);
+                    break;
+                }
+                uint32_t u32 = RT_H2BE_U32((uint32_t)cchName);
+                memcpy(&abServer[0], &u32, sizeof(u32));
+                memcpy(&abServer[4], pConn->pExport->pszName, cchName);
+                rc = nbdOptReply(pConn, uOpt, NBD_REP_SERVER, abServer, 4 + (uint32_t)cchName);
+                if (RT_SUCCESS(rc))
+                    rc = nbdOptReply(pConn, uOpt, NBD_REP_ACK, NULL, 0);
+                break;
+            }
+
+            case NBD_OPT_INFO:
+            case NBD_OPT_GO:
+            {
+                /* Name length, name, number of info requests, info requests.  We always send the same. */
+                uint32_t u32;
+                memcpy(&u32, abData, sizeof(u32));
+                uint32_t const cchName = RT_BE2H_U32(u32);
+                if (cbData < 6 || cchName > cbData - 6)
+                    rc = nbdOptReply(pConn, uOpt, NBD_REP_ERR_INVALID, NULL, 0);
+                else if (!nbdIsOurExport(pConn, (const char *)&abData[4], cchName))
+                    rc = nbdOptReply(pConn, uOpt, NBD_REP_ERR_UNKNOWN, NULL, 0);
+                else
+                {
+                    rc = nbdOptReplyInfo(pConn, uOpt);
+                    if (RT_SUCCESS(rc))
+                        rc = nbdOptReply(pConn, uOpt, NBD_REP_ACK, NULL, 0);
+                    if (RT_SUCCESS(rc) && uOpt == NBD_OPT_GO)
+                        return VINF_SUCCESS;
+                }
+                break;
+            }
+
+            case NBD_OPT_STRUCTURED_REPLY:
+                if (cbData)
+                    rc = nbdOptReply(pConn, uOpt, NBD_REP_ERR_INVALID, NULL, 0);
+                else
+                {
+                    pConn->fStructuredReplies = true;
+                    rc = nbdOptReply(pConn, uOpt, NBD_REP_ACK, NULL, 0);
+                }
+                break;
+
+            case NBD_OPT_LIST_META_CONTEXT:
+            case NBD_OPT_SET_META_CONTEXT:
+                rc = nbdOptMetaContext(pConn, uOpt, abData, cbData);
+                break;
+
+            default:
+                rc = nbdOptReply(pConn, uOpt, NBD_REP_ERR_UNSUP, NULL, 0);
+                break;
+        }
+        if (RT_FAILURE(rc))
+            return rc;
+    }
+}
+
+/** Converts a status code to an NBD error. */
+static uint32_t nbdErrFromRc(int rc)
+{
+    switch (rc)
+    {
+        case VERR_NO_MEMORY:            return NBD_ENOMEM;
+        case VERR_DISK_FULL:            return NBD_ENOSPC;
+        case VERR_WRITE_PROTECT:
+        case VERR_VD_IMAGE_READ_ONLY:   return NBD_EPERM;
+        case VERR_INVALID_PARAMETER:    return NBD_EINVAL;
+        default:                        return NBD_EIO;
+    }
+}
+
+/**
+ * Sends the reply of a completed request.
+ */
+static int nbdSendReply(PVBOXIMGNBDCONN pConn, PVBOXIMGNBDREQ pReq)
+{
+    uint8_t *pbData = pReq->pbBuf ? pReq->pbBuf + VBOXIMG_NBD_REPLY_HDR_MAX : NULL;
+    uint64_t const u64Handle = pReq->u64Handle; /* Opaque, sent back as is. */
+    uint32_t u32;
+    uint16_t u16;
+    uint64_t u64;
+
+    if (!pConn->fStructuredReplies || (pReq->uCmd != NBD_CMD_READ && pReq->uCmd != NBD_CMD_BLOCK_STATUS))
+    {
+        /* Simple reply, followed by the data for successful reads. */
+        uint32_t const cbData = RT_SUCCESS(pReq->rc) && pReq->uCmd == NBD_CMD_READ ? pReq->cb : 0;
+        uint8_t        abHdr[16];
+        uint8_t       *pbHdr  = cbData ? pbData - sizeof(abHdr) : abHdr;
+        u32 = RT_H2BE_U32(NBD_SIMPLE_REPLY_MAGIC);
+        memcpy(&pbHdr[0], &u32, sizeof(u32));
+        u32 = RT_H2BE_U32(RT_SUCCESS(pReq->rc) ? 0 : nbdErrFromRc(pReq->rc));
+        memcpy(&pbHdr[4], &u32, sizeof(u32));
+        memcpy(&pbHdr[8], &u64Handle, sizeof(u64Handle));
+        return nbdWrite(pConn, pbHdr, sizeof(abHdr) + cbData);
+    }
+
+    /* Structured reply, a single chunk. */
+    uint8_t  abChunk[20 + 8 * 2 + 6];
+    uint8_t *pbHdr   = abChunk;
+    uint16_t uType;
+    uint32_t cbChunk;
+    uint32_t cbExtra = 0;
+    uint8_t *pbExtra = NULL;
+    if (RT_FAILURE(pReq->rc))
+    {
+        uType   = NBD_REPLY_TYPE_ERROR;
+        cbChunk = 6;
+        u32 = RT_H2BE_U32(nbdErrFromRc(pReq->rc));
+        memcpy(&abChunk[20], &u32, sizeof(u32));
+        u16 = 0; /* No message. */
+        memcpy(&abChunk[24], &u16, sizeof(u16));
+    }
+    else if (pReq->uCmd == NBD_CMD_READ)
+    {
+        uType   = NBD_REPLY_TYPE_OFFSET_DATA;
+        cbChunk = 8 + pReq->cb;
+        pbHdr   = pbData - 28;
+        u64 = RT_H2BE_U64(pReq->off);
+        memcpy(&pbHdr[20], &u64, sizeof(u64));
+    }
+    else
+    {
+        /*
+         * Block status.  VD doesn't tell which blocks are allocated, so the
+         * data was read and the status tells the client where it is zero,
+         * which is what lets it skip them.
+         */
+        uint32_t const cDescsMax = pReq->fCmd & NBD_CMD_FLAG_REQ_ONE ? 1 : pReq->cb / VBOXIMG_NBD_STATUS_BLOCK + 2;
+        pbExtra = (uint8_t *)RTMemAlloc(cDescsMax * 8);
+        if (!pbExtra)
+        {
+            pReq->rc = VERR_NO_MEMORY;
+            return nbdSendReply(pConn, pReq);
+        }
+
+        uint32_t cDescs = 0;
+        uint32_t off    = 0;
+        while (off < pReq->cb && cDescs < cDescsMax)
+        {
+            uint32_t cbBlock = VBOXIMG_NBD_STATUS_BLOCK - (uint32_t)((pReq->off + off) % VBOXIMG_NBD_STATUS_BLOCK);
+            cbBlock = RT_MIN(cbBlock, pReq->cb - off);
+            bool const fZero = ASMMemIsZero(&pbData[off], cbBlock);
+            uint32_t cbRun = cbBlock;
+            while (off + cbRun < pReq->cb)
+            {
+                cbBlock = RT_MIN(VBOXIMG_NBD_STATUS_BLOCK, pReq->cb - off - cbRun);
+                if (ASMMemIsZero(&pbData[off + cbRun], cbBlock) != fZero)
+                    break;
+                cbRun += cbBlock;
+            }
+
+            uint32_t const au32Desc[2] = { RT_H2BE_U32(cbRun), RT_H2BE_U32(fZero ? NBD_STATE_ZERO : 0) };
+            memcpy(&pbExtra[cDescs * 8], au32Desc, sizeof(au32Desc));
+            cDescs++;
+            off += cbRun;
+        }
+
+        uType   = NBD_REPLY_TYPE_BLOCK_STATUS;
+        cbExtra = cDescs * 8;
+        cbChunk = 4 + cbExtra;
+        u32 = RT_H2BE_U32(VBOXIMG_NBD_CTX_BASE_ALLOCATION);
+        memcpy(&abChunk[20], &u32, sizeof(u32));
+    }
+
+    u32 = RT_H2BE_U32(NBD_STRUCTURED_REPLY_MAGIC);
+    memcpy(&pbHdr[0], &u32, sizeof(u32));
+    u16 = RT_H2BE_U16(NBD_REPLY_FLAG_DONE);
+    memcpy(&pbHdr[4], &u16, sizeof(u16));
+    u16 = RT_H2BE_U16(uType);
+    memcpy(&pbHdr[6], &u16, sizeof(u16));
+    memcpy(&pbHdr[8], &u64Handle, sizeof(u64Handle));
+    u32 = RT_H2BE_U32(cbChunk);
+    memcpy(&pbHdr[16], &u32, sizeof(u32));
+
+    int rc;
+    if (uType == NBD_REPLY_TYPE_OFFSET_DATA)
+        rc = nbdWrite(pConn, pbHdr, 20 + cbChunk);
+    else
+    {
+        rc = nbdWrite(pConn, abChunk, 20 + cbChunk - cbExtra);
+        if (RT_SUCCESS(rc) && cbExtra)
+            rc = nbdWrite(pConn, pbExtra, cbExtra);
+    }
+    RTMemFree(pbExtra);
+    return rc;
+}
+
+/**
+ * Waits until no other write in progress touches the allocation blocks the
+ * write request covers, then locks them.
+ */
+static void nbdWriteRangeLock(PVBOXIMGNBDCONN pConn, PVBOXIMGNBDREQ pReq)
+{
+    PVBOXIMGNBDEXPORT pExport = pConn->pExport;
+    pReq->offLockFirst = pReq->off & ~(uint64_t)(VBOXIMG_NBD_WRITE_LOCK_GRANULE - 1);
+    pReq->offLockEnd   = RT_ALIGN_64(pReq->off + pReq->cb, VBOXIMG_NBD_WRITE_LOCK_GRANULE);
+
+    RTCritSectEnter(&pExport->RangeCritSect);
+    for (;;)
+    {
+        bool fOverlap = false;
+        PVBOXIMGNBDREQ pOther;
+        RTListForEach(&pExport->WriteRanges, pOther, VBOXIMGNBDREQ, RangeNode)
+        {
+            if (   pOther->offLockFirst < pReq->offLockEnd
+                && pReq->offLockFirst < pOther->offLockEnd)
+            {
+                fOverlap = true;
+                break;
+            }
+        }
+        if (!fOverlap)
+            break;
+
+        /* The unlocker signals all waiters while holding the lock, and the
+           event remembers the signal if we're not waiting yet. */
+        RTListAppend(&pExport->RangeWaiters, &pConn->RangeWaitNode);
+        RTCritSectLeave(&pExport->RangeCritSect);
+        RTSemEventWait(pConn->hEvtSent, RT_INDEFINITE_WAIT);
+        RTCritSectEnter(&pExport->RangeCritSect);
+        RTListNodeRemove(&pConn->RangeWaitNode);
+    }
+    RTListAppend(&pExport->WriteRanges, &pReq->RangeNode);
+    pReq->fRangeLocked = true;
+    RTCritSectLeave(&pExport->RangeCritSect);
+}
+
+/**
+ * Unlocks the write range of a request, if it holds one.
+ */
+static void nbdWriteRangeUnlock(PVBOXIMGNBDREQ pReq)
+{
+    if (!pReq->fRangeLocked)
+        return;
+    PVBOXIMGNBDEXPORT pExport = pReq->pConn->pExport;
+    RTCritSectEnter(&pExport->RangeCritSect);
+    RTListNodeRemove(&pReq->RangeNode);
+    pReq->fRangeLocked = false;
+    PVBOXIMGNBDCONN pWaiter;
+    RTListForEach(&pExport->RangeWaiters, pWaiter, VBOXIMGNBDCONN, RangeWaitNode)
+    {
+        RTSemEventSignal(pWaiter->hEvtSent);
+    }
+    RTCritSectLeave(&pExport->RangeCritSect);
+}
+
+/**
+ * Frees a request which never made it to the reply queue and releases its
+ * slot.  @a pReq may be NULL.
+ */
+static void nbdReqAbort(PVBOXIMGNBDCONN pConn, PVBOXIMGNBDREQ pReq)
+{
+    if (pReq)
+    {
+        Assert(!pReq->fRangeLocked);
+        if (pReq->pbBuf)
+            RTMemPageFree(pReq->pbBuf, pReq->cb + VBOXIMG_NBD_REPLY_HDR_MAX);
+        RTMemFree(pReq);
+    }
+    RTCritSectEnter(&pConn->CritSect);
+    pConn->cReqsActive--;
+    RTCritSectLeave(&pConn->CritSect);
+    RTSemEventSignal(pConn->hEvtSent);
+}
+
+/**
+ * Queues a completed request for the sender thread.
+ */
+static void nbdReqComplete(PVBOXIMGNBDREQ pReq, int rc)
+{
+    PVBOXIMGNBDCONN pConn = pReq->pConn;
+    nbdWriteRangeUnlock(pReq);
+    pReq->rc    = rc;
+    pReq->pNext = NULL;
+    RTCritSectEnter(&pConn->CritSect);
+    if (pConn->pReplyTail)
+        pConn->pReplyTail->pNext = pReq;
+    else
+        pConn->pReplyHead = pReq;
+    pConn->pReplyTail = pReq;
+    RTCritSectLeave(&pConn->CritSect);
+    RTSemEventSignal(pConn->hEvtReply);
+}
+
+static DECLCALLBACK(void) nbdReqCompleteAsync(void *pvUser1, void *pvUser2, int rcReq)
+{
+    RT_NOREF(pvUser2);
+    nbdReqComplete((PVBOXIMGNBDREQ)pvUser1, rcReq);
+}
+
+/**
+ * The sender thread of a connection.
+ */
+static DECLCALLBACK(int) nbdSendThread(RTTHREAD hThread, void *pvUser)
+{
+    RT_NOREF(hThread);
+    PVBOXIMGNBDCONN pConn = (PVBOXIMGNBDCONN)pvUser;
+    int rc = VINF_SUCCESS;
+    for (;;)
+    {
+        RTCritSectEnter(&pConn->CritSect);
+        PVBOXIMGNBDREQ pReq = pConn->pReplyHead;
+        pConn->pReplyHead = pConn->pReplyTail = NULL;
+        bool const fDone = !pReq && pConn->fShutdown && !pConn->cReqsActive;
+        RTCritSectLeave(&pConn->CritSect);
+        if (fDone)
+            break;
+        if (!pReq)
+        {
+            RTSemEventWait(pConn->hEvtReply, RT_INDEFINITE_WAIT);
+            continue;
+        }
+
+        while (pReq)
+        {
+            PVBOXIMGNBDREQ pNext = pReq->pNext;
+            if (RT_SUCCESS(rc)) /* Keep draining after errors so the reader doesn't get stuck. */
+                rc = nbdSendReply(pConn, pReq);
+            RTMemPageFree(pReq->pbBuf, pReq->cb + VBOXIMG_NBD_REPLY_HDR_MAX);
+            RTMemFree(pReq);
+            pReq = pNext;
+
+            RTCritSectEnter(&pConn->CritSect);
+            pConn->cReqsActive--;
+            RTCritSectLeave(&pConn->CritSect);
+            RTSemEventSignal(pConn->hEvtSent);
+        }
+    }
+    return rc;
+}
+
+/**
+ * Reads and submits requests until the client disconnects.
+ */
+static int nbdTransmission(PVBOXIMGNBDCONN pConn)
+{
+    PVBOXIMGNBDEXPORT pExport = pConn->pExport;
+    for (;;)
+    {
+        uint8_t abReq[28];
+        int rc = nbdRead(pConn, abReq, sizeof(abReq));
+        if (RT_FAILURE(rc))
+            return rc;
+
+        uint32_t u32;
+        uint16_t au16[2];
+        uint64_t u64Handle, u64;
+        memcpy(&u32, &abReq[0], sizeof(u32));
+        memcpy(au16, &abReq[4], sizeof(au16));
+        memcpy(&u64Handle, &abReq[8], sizeof(u64Handle));
+        memcpy(&u64, &abReq[16], sizeof(u64));
+        if (RT_BE2H_U32(u32) != NBD_REQUEST_MAGIC)
+            return VERR_INVALID_MAGIC;
+        uint16_t const fCmd = RT_BE2H_U16(au16[0]);
+        uint16_t const uCmd = RT_BE2H_U16(au16[1]);
+        uint64_t const off  = RT_BE2H_U64(u64);
+        memcpy(&u32, &abReq[24], sizeof(u32));
+        uint32_t cb = RT_BE2H_U32(u32);
+
+        if (uCmd == NBD_CMD_DISC)
+            return VINF_SUCCESS;
+
+        /* The payload of a write we can't take would have to be drained to stay
+           in sync with the client, so drop the connection instead. */
+        if (uCmd == NBD_CMD_WRITE && cb > VBOXIMG_NBD_MAX_REQ)
+            return VERR_TOO_MUCH_DATA;
+
+        /* Wait for a free slot. */
+        for (;;)
+        {
+            RTCritSectEnter(&pConn->CritSect);
+            bool const fFree = pConn->cReqsActive < VBOXIMG_NBD_MAX_IN_FLIGHT;
+            if (fFree)
+                pConn->cReqsActive++;
+            RTCritSectLeave(&pConn->CritSect);
+            if (fFree)
+                break;
+            RTSemEventWait(pConn->hEvtSent, RT_INDEFINITE_WAIT);
+        }
+
+        PVBOXIMGNBDREQ pReq = (PVBOXIMGNBDREQ)RTMemAllocZ(sizeof(*pReq));
+        if (!pReq)
+        {
+            nbdReqAbort(pConn, NULL);
+            return VERR_NO_MEMORY;
+        }
+        pReq->pConn     = pConn;
+        pReq->uCmd      = uCmd;
+        pReq->fCmd      = fCmd;
+        pReq->u64Handle = u64Handle;
+        pReq->off       = off;
+
+        /* Validate. */
+        int rcReq = VINF_SUCCESS;
+        switch (uCmd)
+        {
+            case NBD_CMD_READ:
+            case NBD_CMD_WRITE:
+                if (   !cb
+                    || cb > VBOXIMG_NBD_MAX_REQ
+                    || off > pExport->cbDisk
+                    || cb > pExport->cbDisk - off)
+                    rcReq = VERR_INVALID_PARAMETER;
+                else if (uCmd == NBD_CMD_WRITE && pExport->fReadOnly)
+                    rcReq = VERR_WRITE_PROTECT;
+                break;
+            case NBD_CMD_BLOCK_STATUS:
+                if (   !pConn->fBaseAllocation
+                    || !cb
+                    || off > pExport->cbDisk
+                    || cb > pExport->cbDisk - off)
+                    rcReq = VERR_INVALID_PARAMETER;
+                else
+                    cb = RT_MIN(cb, VBOXIMG_NBD_MAX_STATUS); /* The client asks again for the rest. */
+                break;
+            case NBD_CMD_FLUSH:
+                cb = 0;
+                break;
+            default:
+                rcReq = VERR_NOT_SUPPORTED;
+                cb = 0;
+                break;
+        }
+
+        if (cb && (RT_SUCCESS(rcReq) || uCmd == NBD_CMD_WRITE))
+        {
+            pReq->pbBuf = (uint8_t *)RTMemPageAlloc(cb + VBOXIMG_NBD_REPLY_HDR_MAX);
+            if (pReq->pbBuf)
+                pReq->cb = cb;
+            else if (uCmd == NBD_CMD_WRITE)
+            {
+                nbdReqAbort(pConn, pReq);
+                return VERR_NO_MEMORY; /* Can't consume the payload. */
+            }
+            else
+                rcReq = VERR_NO_MEMORY;
+        }
+        if (uCmd == NBD_CMD_WRITE && cb)
+        {
+            rc = nbdRead(pConn, pReq->pbBuf + VBOXIMG_NBD_REPLY_HDR_MAX, cb);
+            if (RT_FAILURE(rc))
+            {
+                nbdReqAbort(pConn, pReq);
+                return rc;
+            }
+        }
+        if (RT_FAILURE(rcReq))
+        {
+            nbdReqComplete(pReq, rcReq);
+            continue;
+        }
+
+        /* Submit. */
+        pReq->Seg.pvSeg = pReq->pbBuf ? pReq->pbBuf + VBOXIMG_NBD_REPLY_HDR_MAX : NULL;
+        pReq->Seg.cbSeg = pReq->cb;
+        RTSgBufInit(&pReq->SgBuf, &pReq->Seg, 1);
+        if (uCmd == NBD_CMD_READ || uCmd == NBD_CMD_BLOCK_STATUS)
+            rc = VDAsyncRead(pExport->pDisk, off, cb, &pReq->SgBuf, nbdReqCompleteAsync, pReq, NULL);
+        else if (uCmd == NBD_CMD_WRITE)
+        {
+            nbdWriteRangeLock(pConn, pReq);
+            rc = VDAsyncWrite(pExport->pDisk, off, cb, &pReq->SgBuf, nbdReqCompleteAsync, pReq, NULL);
+        }
+        else
+            rc = VDAsyncFlush(pExport->pDisk, nbdReqCompleteAsync, pReq, NULL);
+        if (rc == VINF_VD_ASYNC_IO_FINISHED)
+            nbdReqComplete(pReq, VINF_SUCCESS);
+        else if (rc != VERR_VD_ASYNC_IO_IN_PROGRESS)
+            nbdReqComplete(pReq, rc);
+    }
+}
+
+/**
+ * The thread serving one connection.
+ */
+static DECLCALLBACK(int) nbdConnThread(RTTHREAD hThread, void *pvUser)
+{
+    RT_NOREF(hThread);
+    PVBOXIMGNBDCONN pConn = (PVBOXIMGNBDCONN)pvUser;
+
+    int rc = nbdNegotiate(pConn);
+    if (rc == VINF_SUCCESS)
+    {
+        RTTHREAD hThreadSend;
+        rc = RTThreadCreate(&hThreadSend, nbdSendThread, pConn, 0, RTTHREADTYPE_IO, RTTHREADFLAGS_WAITABLE, "NbdSend");
+        if (RT_SUCCESS(rc))
+        {
+            rc = nbdTransmission(pConn);
+
+            /* Let the sender finish the replies of the requests still in flight. */
+            RTCritSectEnter(&pConn->CritSect);
+            pConn->fShutdown = true;
+            RTCritSectLeave(&pConn->CritSect);
+            RTSemEventSignal(pConn->hEvtReply);
+            RTThreadWait(hThreadSend, RT_INDEFINITE_WAIT, NULL);
+        }
+    }
+    if (RT_FAILURE(rc) && rc != VERR_NET_CONNECTION_RESET_BY_PEER && rc != VERR_BROKEN_PIPE)
+        RTMsgError("NBD connection failed: %Rrc\n", rc);
+
+    if (pConn->hSocket != NIL_RTSOCKET)
+        RTTcpServerDisconnectClient2(pConn->hSocket);
+    else
+        RTLocalIpcSessionClose(pConn->hSession);
+    RTSemEventDestroy(pConn->hEvtReply);
+    RTSemEventDestroy(pConn->hEvtSent);
+    RTCritSectDelete(&pConn->CritSect);
+    RTMemFree(pConn);
+    return rc;
+}
+
+/**
+ * Sets up a new connection and starts serving it.
+ */
+static int nbdConnStart(PVBOXIMGNBDEXPORT pExport, RTSOCKET hSocket, RTLOCALIPCSESSION hSession)
+{
+    PVBOXIMGNBDCONN pConn = (PVBOXIMGNBDCONN)RTMemAllocZ(sizeof(*pConn));
+    int rc = VERR_NO_MEMORY;
+    if (pConn)
+    {
+        pConn->pExport  = pExport;
+        pConn->hSocket  = hSocket;
+        pConn->hSession = hSession;
+        rc = RTCritSectInit(&pConn->CritSect);
+        if (RT_SUCCESS(rc))
+        {
+            rc = RTSemEventCreate(&pConn->hEvtReply);
+            if (RT_SUCCESS(rc))
+            {
+                rc = RTSemEventCreate(&pConn->hEvtSent);
+                if (RT_SUCCESS(rc))
+                {
+                    rc = RTThreadCreate(NULL, nbdConnThread, pConn, 0, RTTHREADTYPE_IO, 0, "NbdConn");
+                    if (RT_SUCCESS(rc))
+                        return VINF_SUCCESS;
+                    RTSemEventDestroy(pConn->hEvtSent);
+                }
+                RTSemEventDestroy(pConn->hEvtReply);
+            }
+            RTCritSectDelete(&pConn->CritSect);
+        }
+        RTMemFree(pConn);
+    }
+
+    if (hSocket != NIL_RTSOCKET)
+        RTTcpServerDisconnectClient2(hSocket);
+    else
+        RTLocalIpcSessionClose(hSession);
+    return rc;
+}
+
+
+static int handleServe(HandlerArg *a)
+{
+    const char *apszFilenames[16];
+    unsigned    cFilenames = 0;
+    const char *pszFormat  = NULL;
+    const char *pszName    = "";
+    const char *pszAddress = "localhost";
+    const char *pszUnix    = NULL;
+    uint32_t    uPort      = VBOXIMG_NBD_PORT;
+    bool        fReadOnly  = true;
+
+    /* Parse the command line. */
+    static const RTGETOPTDEF s_aOptions[] =
+    {
+        { "--filename",  'f', RTGETOPT_REQ_STRING },
+        { "--format",    'o', RTGETOPT_REQ_STRING },
+        { "--name",      'n', RTGETOPT_REQ_STRING },
+        { "--address",   'a', RTGETOPT_REQ_STRING },
+        { "--port",      'p', RTGETOPT_REQ_UINT32 },
+        { "--unix",      'u', RTGETOPT_REQ_STRING },
+        { "--readwrite", 'w', RTGETOPT_REQ_NOTHING }
+    };
+    int ch;
+    RTGETOPTUNION ValueUnion;
+    RTGETOPTSTATE GetState;
+    RTGetOptInit(&GetState, a->argc, a->argv, s_aOptions, RT_ELEMENTS(s_aOptions), 0, 0 /* fFlags */);
+    while ((ch = RTGetOpt(&GetState, &ValueUnion)))
+    {
+        switch (ch)
+        {
+            case 'f':   // --filename
+                if (cFilenames >= RT_ELEMENTS(apszFilenames))
+                    return errorSyntax("Too many --filename options\n");
+                apszFilenames[cFilenames++] = ValueUnion.psz;
+                break;
+
+            case 'o':   // --format
+                pszFormat = ValueUnion.psz;
+                break;
+
+            case 'n':   // --name
+                pszName = ValueUnion.psz;
+                break;
+
+            case 'a':   // --address
+                pszAddress = ValueUnion.psz;
+                break;
+
+            case 'p':   // --port
+                uPort = ValueUnion.u32;
+                break;
+
+            case 'u':   // --unix
+                pszUnix = ValueUnion.psz;
+                break;
+
+            case 'w':   // --readwrite
+                fReadOnly = false;
+                break;
+
+            default:
+                ch = RTGetOptPrintError(ch, &ValueUnion);
+                printUsage(g_pStdErr);
+                return ch;
+        }
+    }
+
+    /* Check for mandatory parameters. */
+    if (!cFilenames)
+        return errorSyntax("Mandatory --filename option missing\n");
+
+    int rc = RTAioMgrCreate(&g_hNbdAioMgr, 1024);
+    if (RT_FAILURE(rc))
+        return errorRuntime("Error creating the async I/O manager: %Rrc\n", rc);
+
+    VDINTERFACEIO IfIo;
+    RT_ZERO(IfIo);
+    IfIo.pfnOpen                = nbdIoOpen;
+    IfIo.pfnClose               = nbdIoClose;
+    IfIo.pfnDelete              = nbdIoDelete;
+    IfIo.pfnMove                = nbdIoMove;
+    IfIo.pfnGetFreeSpace        = nbdIoGetFreeSpace;
+    IfIo.pfnGetModificationTime = nbdIoGetModificationTime;
+    IfIo.pfnGetSize             = nbdIoGetSize;
+    IfIo.pfnSetSize             = nbdIoSetSize;
+    IfIo.pfnSetAllocationSize   = nbdIoSetAllocationSize;
+    IfIo.pfnReadSync            = nbdIoReadSync;
+    IfIo.pfnWriteSync           = nbdIoWriteSync;
+    IfIo.pfnFlushSync           = nbdIoFlushSync;
+    IfIo.pfnReadAsync           = nbdIoReadAsync;
+    IfIo.pfnWriteAsync          = nbdIoWriteAsync;
+    IfIo.pfnFlushAsync          = nbdIoFlushAsync;
+    PVDINTERFACE pIfsImage = NULL;
+    VDInterfaceAdd(&IfIo.Core, "vbox-img_NbdIo", VDINTERFACETYPE_IO, NULL, sizeof(VDINTERFACEIO), &pIfsImage);
+
+    /* Open the image chain, base image first. */
+    PVDISK pDisk = NULL;
+    for (unsigned i = 0; i < cFilenames; i++)
+    {
+        char  *pszImageFormat = NULL;
+        VDTYPE enmType = VDTYPE_HDD;
+        if (!pszFormat)
+        {
+            rc = VDGetFormat(NULL, NULL, apszFilenames[i], &pszImageFormat, &enmType);
+            if (RT_FAILURE(rc))
+            {
+                rc = errorSyntax("Format autodetect failed for '%s': %Rrc\n", apszFilenames[i], rc);
+                break;
+            }
+        }
+        if (!pDisk)
+        {
+            rc = VDCreate(pVDIfs, enmType, &pDisk);
+            if (RT_FAILURE(rc))
+            {
+                RTStrFree(pszImageFormat);
+                rc = errorRuntime("Error while creating the virtual disk container: %Rrf (%Rrc)\n", rc, rc);
+                break;
+            }
+        }
+
+        rc = VDOpen(pDisk, pszFormat ? pszFormat : pszImageFormat, apszFilenames[i],
+                    VD_OPEN_FLAGS_ASYNC_IO | (fReadOnly ? VD_OPEN_FLAGS_READONLY : VD_OPEN_FLAGS_NORMAL), pIfsImage);
+        RTStrFree(pszImageFormat);
+        if (RT_FAILURE(rc))
+        {
+            rc = errorRuntime("Error while opening the image '%s': %Rrf (%Rrc)\n", apszFilenames[i], rc, rc);
+            break;
+        }
+    }
+
+    if (rc == VINF_SUCCESS)
+    {
+        VBOXIMGNBDEXPORT Export;
+        Export.pDisk     = pDisk;
+        Export.cbDisk    = VDGetSize(pDisk, VD_LAST_IMAGE);
+        Export.pszName   = pszName;
+        Export.fReadOnly = fReadOnly;
+        RTListInit(&Export.WriteRanges);
+        RTListInit(&Export.RangeWaiters);
+        rc = RTCritSectInit(&Export.RangeCritSect);
+        if (RT_SUCCESS(rc))
+        {
+            /* Serve until killed. */
+            if (pszUnix)
+            {
+                RTLOCALIPCSERVER hServer;
+                rc = RTLocalIpcServerCreate(&hServer, pszUnix, RTLOCALIPC_FLAGS_NATIVE_NAME);
+                if (RT_SUCCESS(rc))
+                {
+                    RTPrintf("Serving %'RU64 bytes on %s\n", Export.cbDisk, pszUnix);
+                    for (;;)
+                    {
+                        RTLOCALIPCSESSION hSession;
+                        rc = RTLocalIpcServerListen(hServer, &hSession);
+                        if (RT_FAILURE(rc))
+                            break;
+                        nbdConnStart(&Export, NIL_RTSOCKET, hSession);
+                    }
+                    RTLocalIpcServerDestroy(hServer);
+                }
+            }
+            else
+            {
+                PRTTCPSERVER pServer;
+                rc = RTTcpServerCreateEx(pszAddress, uPort, &pServer);
+                if (RT_SUCCESS(rc))
+                {
+                    RTPrintf("Serving %'RU64 bytes on %s:%u\n", Export.cbDisk, pszAddress, uPort);
+                    for (;;)
+                    {
+                        RTSOCKET hSocket;
+                        rc = RTTcpServerListen2(pServer, &hSocket);
+                        if (RT_FAILURE(rc))
+                            break;
+                        RTTcpSetSendCoalescing(hSocket, false);
+                        nbdConnStart(&Export, hSocket, NIL_RTLOCALIPCSESSION);
+                    }
+                    RTTcpServerDestroy(pServer);
+                }
+            }
+            RTCritSectDelete(&Export.RangeCritSect);
+        }
+        rc = errorRuntime("Error while serving: %Rrc\n", rc);
+    }
+
+    if (pDisk)
+        VDDestroy(pDisk);
+    RTAioMgrRelease(g_hNbdAioMgr);
+    return rc;
+}
+
+
 int main(int argc, char *argv[])
 {
     int exitcode = 0;
@@ -2137,6 +3543,7 @@ int main(int argc, char *argv[])
         { "repair",       handleRepair       },
         { "clearcomment", handleClearComment },
         { "resize",       handleClearResize  },
+        { "serve",        handleServe        },
         { NULL,           NULL               }
     };
 
@@ -836,6 +836,7 @@ int pgmPhysAllocPage(PVM pVM, PPGMPAGE pPage, RTGCPHYS GCPhys)
              GCPhys, pVM->pgm.s.aHandyPages[iHandyPage].idPage, HCPhys));
         STAM_COUNTER_INC(&pVM->pgm.s.CTX_SUFF(pStats)->CTX_MID_Z(Stat,PageReplaceShared));
         pVM->pgm.s.cSharedPages--;
+        pVM->pgm.s.cSharedPageCowBreaks++;
 
         /* Grab the address of the page so we can make a copy later on. (safe) */
         rc = pgmPhysPageMapReadOnly(pVM, pPage, GCPhys, &pvSharedPage);
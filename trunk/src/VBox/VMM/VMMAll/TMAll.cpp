@@ -360,7 +360,7 @@ DECLINLINE(bool) tmTimerTryWithLink(PTMTIMER pTimer, TMTIMERSTATE enmStateNew, T
 
 
 /**
- * Links a timer into the active list of a timer queue.
+ * Links a timer into the active heap of a timer queue.
  *
  * @param   pQueue          The queue.
  * @param   pTimer          The timer.
@@ -372,44 +372,27 @@ DECL_FORCE_INLINE(void) tmTimerQueueLinkActive(PTMTIMERQUEUE pQueue, PTMTIMER pT
 {
     Assert(!pTimer->offNext);
     Assert(!pTimer->offPrev);
+    Assert(!pTimer->offChild);
     Assert(pTimer->enmState == TMTIMERSTATE_ACTIVE || pTimer->enmClock != TMCLOCK_VIRTUAL_SYNC); /* (active is not a stable state) */
+    Assert(pTimer->u64Expire == u64Expire);
 
-    PTMTIMER pCur = TMTIMER_GET_HEAD(pQueue);
-    if (pCur)
+    pQueue->cActive++;
+    PTMTIMER pHead = TMTIMER_GET_HEAD(pQueue);
+    if (pHead)
     {
-        for (;; pCur = TMTIMER_GET_NEXT(pCur))
+        PTMTIMER pNewHead = tmTimerHeapMeld(pHead, pTimer);
+        if (pNewHead != pHead)
         {
-            if (pCur->u64Expire > u64Expire)
-            {
-                const PTMTIMER pPrev = TMTIMER_GET_PREV(pCur);
-                TMTIMER_SET_NEXT(pTimer, pCur);
-                TMTIMER_SET_PREV(pTimer, pPrev);
-                if (pPrev)
-                    TMTIMER_SET_NEXT(pPrev, pTimer);
-                else
-                {
-                    TMTIMER_SET_HEAD(pQueue, pTimer);
-                    ASMAtomicWriteU64(&pQueue->u64Expire, u64Expire);
-                    DBGFTRACE_U64_TAG2(pTimer->CTX_SUFF(pVM), u64Expire, "tmTimerQueueLinkActive head", R3STRING(pTimer->pszDesc));
-                }
-                TMTIMER_SET_PREV(pCur, pTimer);
-                return;
-            }
-            if (!pCur->offNext)
-            {
-                TMTIMER_SET_NEXT(pCur, pTimer);
-                TMTIMER_SET_PREV(pTimer, pCur);
-                DBGFTRACE_U64_TAG2(pTimer->CTX_SUFF(pVM), u64Expire, "tmTimerQueueLinkActive tail", R3STRING(pTimer->pszDesc));
-                return;
-            }
+            tmTimerQueueSetHead(pQueue, pNewHead);
+            DBGFTRACE_U64_TAG2(pTimer->CTX_SUFF(pVM), u64Expire, "tmTimerQueueLinkActive head", R3STRING(pTimer->pszDesc));
         }
     }
     else
     {
-        TMTIMER_SET_HEAD(pQueue, pTimer);
-        ASMAtomicWriteU64(&pQueue->u64Expire, u64Expire);
+        tmTimerQueueSetHead(pQueue, pTimer);
         DBGFTRACE_U64_TAG2(pTimer->CTX_SUFF(pVM), u64Expire, "tmTimerQueueLinkActive empty", R3STRING(pTimer->pszDesc));
     }
+    NOREF(u64Expire);
 }
 
 
@@ -448,7 +431,7 @@ DECLINLINE(void) tmTimerQueueScheduleOne(PTMTIMERQUEUE pQueue, PTMTIMER pTimer)
              * Schedule timer (insert into the active list).
              */
             case TMTIMERSTATE_PENDING_SCHEDULE:
-                Assert(!pTimer->offNext); Assert(!pTimer->offPrev);
+                Assert(!pTimer->offNext); Assert(!pTimer->offPrev); Assert(!pTimer->offChild);
                 if (RT_UNLIKELY(!tmTimerTry(pTimer, TMTIMERSTATE_ACTIVE, TMTIMERSTATE_PENDING_SCHEDULE)))
                     break; /* retry */
                 tmTimerQueueLinkActive(pQueue, pTimer, pTimer->u64Expire);
@@ -467,7 +450,7 @@ DECLINLINE(void) tmTimerQueueScheduleOne(PTMTIMERQUEUE pQueue, PTMTIMER pTimer)
              * Stop the timer (not on the active list).
              */
             case TMTIMERSTATE_PENDING_STOP_SCHEDULE:
-                Assert(!pTimer->offNext); Assert(!pTimer->offPrev);
+                Assert(!pTimer->offNext); Assert(!pTimer->offPrev); Assert(!pTimer->offChild);
                 if (RT_UNLIKELY(!tmTimerTry(pTimer, TMTIMERSTATE_STOPPED, TMTIMERSTATE_PENDING_STOP_SCHEDULE)))
                     break;
                 return;
@@ -574,11 +557,22 @@ void tmTimerQueuesSanityChecks(PVM pVM, const char *pszWhere)
                 continue;
             fHaveVirtualSyncLock = true;
         }
-        PTMTIMER pPrev = NULL;
-        for (PTMTIMER pCur = TMTIMER_GET_HEAD(pQueue); pCur; pPrev = pCur, pCur = TMTIMER_GET_NEXT(pCur))
+        PTMTIMER const pHead   = TMTIMER_GET_HEAD(pQueue);
+        uint32_t       cActive = 0;
+        AssertMsg(!pHead || (!pHead->offNext && !pHead->offPrev), ("%s: head %p has siblings\n", pszWhere, pHead));
+        AssertMsg(pQueue->u64Expire == (pHead ? pHead->u64Expire : INT64_MAX),
+                  ("%s: %'RU64 vs %'RU64\n", pszWhere, pQueue->u64Expire, pHead ? pHead->u64Expire : INT64_MAX));
+        for (PTMTIMER pCur = pHead; pCur; pCur = tmTimerQueueWalkNext(pCur))
         {
+            cActive++;
             AssertMsg((int)pCur->enmClock == i, ("%s: %d != %d\n", pszWhere, pCur->enmClock, i));
-            AssertMsg(TMTIMER_GET_PREV(pCur) == pPrev, ("%s: %p != %p\n", pszWhere, TMTIMER_GET_PREV(pCur), pPrev));
+            PTMTIMER const pChild = TMTIMER_GET_CHILD(pCur);
+            AssertMsg(!pChild || TMTIMER_GET_PREV(pChild) == pCur, ("%s: %p != %p\n", pszWhere, TMTIMER_GET_PREV(pChild), pCur));
+            PTMTIMER const pNext  = TMTIMER_GET_NEXT(pCur);
+            AssertMsg(!pNext || TMTIMER_GET_PREV(pNext) == pCur, ("%s: %p != %p\n", pszWhere, TMTIMER_GET_PREV(pNext), pCur));
+            for (PTMTIMER pSub = pChild; pSub; pSub = TMTIMER_GET_NEXT(pSub))
+                AssertMsg(pSub->u64Expire >= pCur->u64Expire,
+                          ("%s: heap order %'RU64 < %'RU64\n", pszWhere, pSub->u64Expire, pCur->u64Expire));
             TMTIMERSTATE enmState = pCur->enmState;
             switch (enmState)
             {
@@ -596,6 +590,7 @@ void tmTimerQueuesSanityChecks(PVM pVM, const char *pszWhere)
                     break;
             }
         }
+        AssertMsg(cActive == pQueue->cActive, ("%s: %u != %u\n", pszWhere, cActive, pQueue->cActive));
     }
 
 
@@ -621,7 +616,7 @@ void tmTimerQueuesSanityChecks(PVM pVM, const char *pszWhere)
                     PTMTIMERR3 pCurAct = TMTIMER_GET_HEAD(&pVM->tm.s.CTX_SUFF(paTimerQueues)[pCur->enmClock]);
                     Assert(pCur->offPrev || pCur == pCurAct);
                     while (pCurAct && pCurAct != pCur)
-                        pCurAct = TMTIMER_GET_NEXT(pCurAct);
+                        pCurAct = tmTimerQueueWalkNext(pCurAct);
                     Assert(pCurAct == pCur);
                 }
                 break;
@@ -634,13 +629,15 @@ void tmTimerQueuesSanityChecks(PVM pVM, const char *pszWhere)
                 {
                     Assert(!pCur->offNext);
                     Assert(!pCur->offPrev);
+                    Assert(!pCur->offChild);
                     for (PTMTIMERR3 pCurAct = TMTIMER_GET_HEAD(&pVM->tm.s.CTX_SUFF(paTimerQueues)[pCur->enmClock]);
                           pCurAct;
-                          pCurAct = TMTIMER_GET_NEXT(pCurAct))
+                          pCurAct = tmTimerQueueWalkNext(pCurAct))
                     {
                         Assert(pCurAct != pCur);
                         Assert(TMTIMER_GET_NEXT(pCurAct) != pCur);
                         Assert(TMTIMER_GET_PREV(pCurAct) != pCur);
+                        Assert(TMTIMER_GET_CHILD(pCurAct) != pCur);
                     }
                 }
                 break;
@@ -1119,6 +1116,7 @@ static int tmTimerSetOptimizedStart(PVM pVM, PTMTIMER pTimer, uint64_t u64Expire
 {
     Assert(!pTimer->offPrev);
     Assert(!pTimer->offNext);
+    Assert(!pTimer->offChild);
     Assert(pTimer->enmState == TMTIMERSTATE_ACTIVE);
 
     TMCLOCK const enmClock = pTimer->enmClock;
@@ -1301,6 +1299,7 @@ VMMDECL(int) TMTimerSet(PTMTIMER pTimer, uint64_t u64Expire)
                 {
                     Assert(!pTimer->offPrev);
                     Assert(!pTimer->offNext);
+                    Assert(!pTimer->offChild);
                     pTimer->u64Expire = u64Expire;
                     TM_SET_STATE(pTimer, TMTIMERSTATE_PENDING_SCHEDULE);
                     tmSchedule(pTimer);
@@ -1423,6 +1422,7 @@ static int tmTimerSetRelativeOptimizedStart(PVM pVM, PTMTIMER pTimer, uint64_t c
 {
     Assert(!pTimer->offPrev);
     Assert(!pTimer->offNext);
+    Assert(!pTimer->offChild);
     Assert(pTimer->enmState == TMTIMERSTATE_ACTIVE);
 
     /*
@@ -1623,6 +1623,7 @@ VMMDECL(int) TMTimerSetRelative(PTMTIMER pTimer, uint64_t cTicksToNext, uint64_t
                 {
                     Assert(!pTimer->offPrev);
                     Assert(!pTimer->offNext);
+                    Assert(!pTimer->offChild);
                     pTimer->u64Expire = cTicksToNext + tmTimerSetRelativeNowWorker(pVM, enmClock, pu64Now);
                     Log2(("TMTimerSetRelative: %p:{.enmState=%s, .pszDesc='%s', .u64Expire=%'RU64} cRetries=%d [EXP/STOP]\n",
                           pTimer, tmTimerState(enmState), R3STRING(pTimer->pszDesc), pTimer->u64Expire, cRetries));
@@ -2480,7 +2481,7 @@ static uint32_t tmGetFrequencyHint(PVM pVM)
             for (int i = 0; i < TMCLOCK_MAX; i++)
             {
                 PTMTIMERQUEUE pQueue = &pVM->tm.s.CTX_SUFF(paTimerQueues)[i];
-                for (PTMTIMER pCur = TMTIMER_GET_HEAD(pQueue); pCur; pCur = TMTIMER_GET_NEXT(pCur))
+                for (PTMTIMER pCur = TMTIMER_GET_HEAD(pQueue); pCur; pCur = tmTimerQueueWalkNext(pCur))
                 {
                     uint32_t uHzHint = ASMAtomicUoReadU32(&pCur->uHzHint);
                     if (uHzHint > uMaxHzHint)
@@ -161,9 +161,7 @@
 #include <VBox/err.h>
 #include <iprt/asm.h>
 #include <iprt/avl.h>
-#ifdef VBOX_STRICT
-# include <iprt/crc.h>
-#endif
+#include <iprt/crc.h>
 #include <iprt/critsect.h>
 #include <iprt/list.h>
 #include <iprt/mem.h>
@@ -480,6 +478,30 @@ typedef struct GMMCHUNKTLB
 typedef GMMCHUNKTLB *PGMMCHUNKTLB;
 
 
+/**
+ * An entry in the content hash index used by the page deduplication scanner.
+ *
+ * The entry either refers to a shared page that other VMs can merge with, or
+ * to a private page that has been seen with this content and is a candidate
+ * for becoming shared should another VM turn up with an identical page.  The
+ * entries are not kept in sync with page state changes; they are validated
+ * (page state + full compare) when looked up.
+ */
+typedef struct GMMDEDUPENTRY
+{
+    /** The content hash of the page when the entry was recorded. */
+    uint32_t        uHash;
+    /** The page ID, NIL_GMM_PAGEID if the entry is unused. */
+    uint32_t        idPage;
+} GMMDEDUPENTRY;
+/** Pointer to a content hash index entry. */
+typedef GMMDEDUPENTRY *PGMMDEDUPENTRY;
+
+/** The number of entries in the content hash index (GMM::paDedupEntries).
+ * Must be a power of two. */
+#define GMM_DEDUP_ENTRIES       _512K
+
+
 /**
  * The GMM instance data.
  */
@@ -517,6 +539,11 @@ typedef struct GMM
     /** Sharable modules (count of nodes in pGlobalSharedModuleTree). */
     uint32_t            cShareableModules;
 
+    /** The content hash index used by the page deduplication scanner.
+     * Direct mapped on the low bits of the hash, GMM_DEDUP_ENTRIES entries.
+     * Allocated the first time a VM scans its pages. */
+    PGMMDEDUPENTRY      paDedupEntries;
+
     /** The chunk list.  For simplifying the cleanup process. */
     RTLISTANCHOR        ChunkList;
 
@@ -538,6 +565,12 @@ typedef struct GMM
     /** The number of pages that are shared that has been left behind by
      * VMs not doing proper cleanups. */
     uint64_t            cLeftBehindSharedPages;
+    /** The number of private pages replaced by an identical shared page by the
+     * deduplication scanner. */
+    uint64_t            cDedupMergedPages;
+    /** The number of shared pages VMs have replaced by private copies after
+     * writing to them. */
+    uint64_t            cSharedPageCowBreaks;
     /** The number of allocation chunks.
      * (The number of pages we've allocated from the host can be derived from this.) */
     uint32_t            cChunks;
@@ -888,6 +921,10 @@ GMMR0DECL(void) GMMR0Term(void)
     /* Free any chunks still hanging around. */
     RTAvlU32Destroy(&pGMM->pChunks, gmmR0TermDestroyChunk, pGMM);
 
+    /* The deduplication index. */
+    RTMemFree(pGMM->paDedupEntries);
+    pGMM->paDedupEntries = NULL;
+
     /* Destroy the chunk locks. */
     for (unsigned iMtx = 0; iMtx < RT_ELEMENTS(pGMM->aChunkMtx); iMtx++)
     {
@@ -2851,6 +2888,7 @@ GMMR0DECL(int) GMMR0AllocateHandyPages(PGVM pGVM, PVM pVM, VMCPUID idCpu, uint32
                             Assert(pGVM->gmm.s.Stats.Allocated.cBasePages);
 
                             Log(("GMMR0AllocateHandyPages: free shared page %x cRefs=%d\n", paPages[iPage].idSharedPage, pPage->Shared.cRefs));
+                            pGMM->cSharedPageCowBreaks++;
                             pGVM->gmm.s.Stats.cSharedPages--;
                             pGVM->gmm.s.Stats.Allocated.cBasePages--;
                             if (!--pPage->Shared.cRefs)
@@ -5199,6 +5237,257 @@ GMMR0DECL(int) GMMR0CheckSharedModules(PGVM pGVM, PVM pVM, VMCPUID idCpu)
 #endif
 }
 
+#ifdef VBOX_WITH_PAGE_SHARING
+
+/**
+ * Calculates the content hash of a page for the deduplication index.
+ *
+ * @returns The hash, never zero (zero means unknown to the callers).
+ * @param   pbPage      The page.
+ */
+DECLINLINE(uint32_t) gmmR0DedupCalcHash(uint8_t const *pbPage)
+{
+    uint32_t const uHash = RTCrc32(pbPage, PAGE_SIZE);
+    return uHash ? uHash : UINT32_C(0x19540414);
+}
+
+
+/**
+ * Compares a page of the calling VM with a page that may belong to another
+ * VM or be shared.
+ *
+ * The other page is accessed through a temporary read-only ring-0 mapping of
+ * just that page, so it never becomes visible in the calling VM process.
+ *
+ * @returns true if identical, false if not or if the page couldn't be mapped.
+ * @param   pChunk          The chunk containing the other page.
+ * @param   idOtherPage     The ID of the other page.
+ * @param   pbLocalPage     The page of the calling VM.
+ */
+static bool gmmR0DedupComparePage(PGMMCHUNK pChunk, uint32_t idOtherPage, uint8_t const *pbLocalPage)
+{
+    RTR0MEMOBJ hMapObj;
+    int rc = RTR0MemObjMapKernelEx(&hMapObj, pChunk->hMemObj, (void *)-1, 0, RTMEM_PROT_READ,
+                                   (size_t)(idOtherPage & GMM_PAGEID_IDX_MASK) << PAGE_SHIFT, PAGE_SIZE);
+    if (RT_FAILURE(rc))
+        return false;
+    bool const fIdentical = !memcmp(RTR0MemObjAddress(hMapObj), pbLocalPage, PAGE_SIZE);
+    RTR0MemObjFree(hMapObj, false /*fFreeMappings*/);
+    return fIdentical;
+}
+
+
+/**
+ * Checks a private page of the calling VM for duplicates in the content hash
+ * index, merging it with or turning it into a shared page when possible.
+ *
+ * This is the content based counterpart to GMMR0SharedModuleCheckPage.  A page
+ * is only considered once its content hash is the same as during the previous
+ * scan, so pages being actively written to are left alone.  A stable page is
+ * then looked up in the index:
+ *  - If an identical shared page exists, the VM page is freed and the shared
+ *    page is returned in the descriptor.
+ *  - If an identical private page of another VM exists, the VM page is
+ *    converted to a shared page and takes over the index entry so the other
+ *    VM will merge with it when it scans that page the next time.
+ *  - Otherwise the page is recorded in the index as a candidate and left
+ *    private, so unique pages never get copy-on-write protected.
+ *
+ * @remarks ASSUMES the caller has acquired the GMM semaphore!!
+ *
+ * @returns VBox status code.
+ * @param   pGVM        Pointer to the GVM instance data.
+ * @param   pPageDesc   Page descriptor.  On return idPage is NIL_GMM_PAGEID
+ *                      if the page wasn't changed, and uHash is updated.
+ */
+GMMR0DECL(int) GMMR0DedupCheckPage(PGVM pGVM, PGMMDEDUPPAGEDESC pPageDesc)
+{
+    PGMM pGMM;
+    GMM_GET_VALID_INSTANCE(pGMM, VERR_GMM_INSTANCE);
+    AssertReturn(pGMM->paDedupEntries, VERR_GMM_IS_NOT_SANE);
+
+    uint32_t const idPage    = pPageDesc->idPage;
+    uint32_t const uPrevHash = pPageDesc->uHash;
+    pPageDesc->idPage = NIL_GMM_PAGEID;
+    pPageDesc->uHash  = 0;
+
+    PGMMPAGE pPage = gmmR0GetPage(pGMM, idPage);
+    AssertMsgReturn(pPage, ("idPage=%#x (GCPhys=%RGp)\n", idPage, pPageDesc->GCPhys), VERR_PGM_PHYS_INVALID_PAGE_ID);
+    AssertMsgReturn(GMM_PAGE_IS_PRIVATE(pPage), ("idPage=%#x (GCPhys=%RGp)\n", idPage, pPageDesc->GCPhys),
+                    VERR_GMM_PAGE_NOT_PRIVATE);
+    AssertMsgReturn(pPage->Private.hGVM == pGVM->hSelf, ("idPage=%#x hGVM=%#x hSelf=%#x\n", idPage, pPage->Private.hGVM, pGVM->hSelf),
+                    VERR_GMM_NOT_PAGE_OWNER);
+
+    /*
+     * Hash the page.  If the ring-3 chunk cache has unmapped the chunk, just
+     * skip it for now; it'll be picked up again once it's been mapped.
+     */
+    PGMMCHUNK pChunk = gmmR0GetChunk(pGMM, idPage >> GMM_CHUNKID_SHIFT);
+    AssertReturn(pChunk, VERR_PGM_PHYS_INVALID_PAGE_ID); /* can't fail as gmmR0GetPage succeeded. */
+    uint8_t *pbChunk;
+    if (!gmmR0IsChunkMapped(pGMM, pGVM, pChunk, (PRTR3PTR)&pbChunk))
+        return VINF_SUCCESS;
+    uint8_t const *pbLocalPage = pbChunk + ((idPage & GMM_PAGEID_IDX_MASK) << PAGE_SHIFT);
+
+    uint32_t const uHash = gmmR0DedupCalcHash(pbLocalPage);
+    pPageDesc->uHash = uHash;
+    if (uHash != uPrevHash)
+        return VINF_SUCCESS;
+
+    /*
+     * Look it up in the index.
+     */
+    PGMMDEDUPENTRY pEntry = &pGMM->paDedupEntries[uHash & (GMM_DEDUP_ENTRIES - 1)];
+    if (   pEntry->idPage != NIL_GMM_PAGEID
+        && pEntry->idPage != idPage
+        && pEntry->uHash  == uHash)
+    {
+        uint32_t const idOtherPage = pEntry->idPage;
+        PGMMPAGE       pOtherPage  = gmmR0GetPage(pGMM, idOtherPage);
+        PGMMCHUNK      pOtherChunk = gmmR0GetChunk(pGMM, idOtherPage >> GMM_CHUNKID_SHIFT);
+        if (pOtherPage && pOtherChunk)
+        {
+            if (GMM_PAGE_IS_SHARED(pOtherPage))
+            {
+                /*
+                 * Existing shared page.  Compare it via ring-0, PGM maps
+                 * the chunk itself once the merged page gets accessed.
+                 */
+                if (pOtherPage->Shared.cRefs >= UINT16_MAX - 1)
+                    return VINF_SUCCESS;
+
+                if (gmmR0DedupComparePage(pOtherChunk, idOtherPage, pbLocalPage))
+                {
+                    Log(("GMMR0DedupCheckPage: merging %#x (GCPhys=%RGp) with shared page %#x\n", idPage, pPageDesc->GCPhys, idOtherPage));
+                    GMMFREEPAGEDESC PageDesc;
+                    PageDesc.idPage = idPage;
+                    int rc = gmmR0FreePages(pGMM, pGVM, 1, &PageDesc, GMMACCOUNT_BASE);
+                    AssertRCReturn(rc, rc);
+
+                    gmmR0UseSharedPage(pGMM, pGVM, pOtherPage);
+                    pGMM->cDedupMergedPages++;
+
+                    pPageDesc->HCPhys = ((uint64_t)pOtherPage->Shared.pfn) << PAGE_SHIFT;
+                    pPageDesc->idPage = idOtherPage;
+                    return VINF_SUCCESS;
+                }
+
+                /* Some other page with the same hash, leave the entry alone. */
+                return VINF_SUCCESS;
+            }
+
+            if (   GMM_PAGE_IS_PRIVATE(pOtherPage)
+                && pOtherPage->Private.hGVM != pGVM->hSelf)
+            {
+                /*
+                 * A candidate page of another VM.  Its content isn't stable,
+                 * but it only serves as a hint here; the other VM merges
+                 * with full compare.
+                 */
+                if (gmmR0DedupComparePage(pOtherChunk, idOtherPage, pbLocalPage))
+                {
+                    Log(("GMMR0DedupCheckPage: converting %#x (GCPhys=%RGp) to shared, duplicate of %#x\n",
+                         idPage, pPageDesc->GCPhys, idOtherPage));
+                    GMMSHAREDPAGEDESC SharedDesc;
+                    SharedDesc.HCPhys            = pPageDesc->HCPhys;
+                    SharedDesc.GCPhys            = pPageDesc->GCPhys;
+                    SharedDesc.idPage            = idPage;
+                    SharedDesc.u32StrictChecksum = 0;
+                    gmmR0ConvertToSharedPage(pGMM, pGVM, pPageDesc->HCPhys, idPage, pPage, &SharedDesc);
+
+                    pEntry->idPage    = idPage;
+                    pPageDesc->idPage = idPage;
+                    return VINF_SUCCESS;
+                }
+            }
+        }
+    }
+
+    /*
+     * Record the page as a candidate.
+     */
+    pEntry->uHash  = uHash;
+    pEntry->idPage = idPage;
+    return VINF_SUCCESS;
+}
+
+#endif /* VBOX_WITH_PAGE_SHARING */
+
+/**
+ * Scans a range of guest pages for content that is identical to pages of this
+ * or other VMs and shares them copy-on-write.
+ *
+ * The caller (PGM) owns the PGM lock and keeps the other EMTs out while this
+ * is being done.
+ *
+ * @returns VBox status code.
+ * @retval  VERR_NOT_SUPPORTED if page sharing isn't possible in the current
+ *          allocation mode.
+ * @param   pGVM        The global (ring-0) VM structure.
+ * @param   pVM         The cross context VM structure.
+ * @param   idCpu       The calling EMT number.
+ * @param   pReq        Pointer to the request packet.
+ * @thread  EMT(idCpu)
+ */
+GMMR0DECL(int) GMMR0DedupScanPagesReq(PGVM pGVM, PVM pVM, VMCPUID idCpu, PGMMDEDUPSCANREQ pReq)
+{
+#ifdef VBOX_WITH_PAGE_SHARING
+    /*
+     * Validate input and get the basics.
+     */
+    AssertPtrReturn(pReq, VERR_INVALID_POINTER);
+    AssertMsgReturn(pReq->cPages > 0 && pReq->cPages <= GMM_DEDUP_SCAN_MAX_PAGES, ("%#x\n", pReq->cPages), VERR_INVALID_PARAMETER);
+    AssertMsgReturn(pReq->Hdr.cbReq == RT_UOFFSETOF(GMMDEDUPSCANREQ, auHashes[pReq->cPages]),
+                    ("%#x != %#x\n", pReq->Hdr.cbReq, RT_UOFFSETOF(GMMDEDUPSCANREQ, auHashes[pReq->cPages])),
+                    VERR_INVALID_PARAMETER);
+    AssertMsgReturn(!(pReq->GCPhysFirst & PAGE_OFFSET_MASK), ("%RGp\n", pReq->GCPhysFirst), VERR_INVALID_PARAMETER);
+
+    PGMM pGMM;
+    GMM_GET_VALID_INSTANCE(pGMM, VERR_GMM_INSTANCE);
+    int rc = GVMMR0ValidateGVMandVMandEMT(pGVM, pVM, idCpu);
+    if (RT_FAILURE(rc))
+        return rc;
+    if (pGMM->fLegacyAllocationMode || pGMM->fBoundMemoryMode)
+        return VERR_NOT_SUPPORTED;
+
+    /*
+     * Take the semaphore, allocate the index on first use and let PGM do the
+     * walking.
+     */
+    gmmR0MutexAcquire(pGMM);
+    if (GMM_CHECK_SANITY_UPON_ENTERING(pGMM))
+    {
+        if (!pGMM->paDedupEntries)
+        {
+            PGMMDEDUPENTRY paEntries = (PGMMDEDUPENTRY)RTMemAlloc(GMM_DEDUP_ENTRIES * sizeof(paEntries[0]));
+            if (paEntries)
+            {
+                for (uint32_t i = 0; i < GMM_DEDUP_ENTRIES; i++)
+                {
+                    paEntries[i].uHash  = 0;
+                    paEntries[i].idPage = NIL_GMM_PAGEID;
+                }
+                pGMM->paDedupEntries = paEntries;
+            }
+            else
+                rc = VERR_NO_MEMORY;
+        }
+        if (RT_SUCCESS(rc))
+            rc = PGMR0DedupScanPages(pVM, pGVM, idCpu, pReq);
+
+        GMM_CHECK_SANITY_UPON_LEAVING(pGMM);
+    }
+    else
+        rc = VERR_GMM_IS_NOT_SANE;
+
+    gmmR0MutexRelease(pGMM);
+    return rc;
+#else
+    RT_NOREF(pGVM, pVM, idCpu, pReq);
+    return VERR_NOT_IMPLEMENTED;
+#endif
+}
+
 #if defined(VBOX_STRICT) && HC_ARCH_BITS == 64
 
 /**
@@ -5365,11 +5654,12 @@ GMMR0DECL(int) GMMR0QueryStatistics(PGMMSTATS pStats, PSUPDRVSESSION pSession, P
     pStats->cSharedPages                = pGMM->cSharedPages;
     pStats->cDuplicatePages             = pGMM->cDuplicatePages;
     pStats->cLeftBehindSharedPages      = pGMM->cLeftBehindSharedPages;
+    pStats->cDedupMergedPages           = pGMM->cDedupMergedPages;
+    pStats->cSharedPageCowBreaks        = pGMM->cSharedPageCowBreaks;
     pStats->cBalloonedPages             = pGMM->cBalloonedPages;
     pStats->cChunks                     = pGMM->cChunks;
     pStats->cFreedChunks                = pGMM->cFreedChunks;
     pStats->cShareableModules           = pGMM->cShareableModules;
-    RT_ZERO(pStats->au64Reserved);
 
     /*
      * Copy out the VM statistics.
@@ -166,5 +166,126 @@ VMMR0DECL(int) PGMR0SharedModuleCheck(PVM pVM, PGVM pGVM, VMCPUID idCpu, PGMMSHA
 
     return rc;
 }
+
+
+/**
+ * Scans a range of guest physical pages for content that can be shared with
+ * other pages in this or other VMs.
+ *
+ * This is called by GMMR0DedupScanPagesReq with the GMM lock held.  The PGM
+ * lock shall be taken prior to calling into ring-0.
+ *
+ * @returns VBox status code.
+ * @param   pVM                 The cross context VM structure.
+ * @param   pGVM                Pointer to the GVM instance data.
+ * @param   idCpu               The ID of the calling virtual CPU.
+ * @param   pReq                The scan request.  The page hashes and the
+ *                              statistics are updated.
+ */
+VMMR0DECL(int) PGMR0DedupScanPages(PVM pVM, PGVM pGVM, VMCPUID idCpu, PGMMDEDUPSCANREQ pReq)
+{
+    PVMCPU              pVCpu         = &pVM->aCpus[idCpu];
+    int                 rc            = VINF_SUCCESS;
+    bool                fFlushTLBs    = false;
+    bool                fFlushRemTLBs = false;
+    GMMDEDUPPAGEDESC    PageDesc;
+
+    PGM_LOCK_ASSERT_OWNER(pVM);     /* This cannot fail as we grab the lock in pgmR3DedupScanRendezvous before calling into ring-0. */
+
+    pReq->cStablePages    = 0;
+    pReq->cNewSharedPages = 0;
+    pReq->cMergedPages    = 0;
+
+    for (uint32_t iPage = 0; iPage < pReq->cPages; iPage++)
+    {
+        RTGCPHYS const GCPhys = pReq->GCPhysFirst + ((RTGCPHYS)iPage << PAGE_SHIFT);
+
+        /*
+         * Only plain, unlocked and unmonitored RAM pages backed by a private
+         * 4KB page qualify.
+         */
+        PPGMPAGE pPage = pgmPhysGetPage(pVM, GCPhys);
+        if (    !pPage
+            ||  PGM_PAGE_GET_TYPE(pPage) != PGMPAGETYPE_RAM
+            ||  PGM_PAGE_GET_STATE(pPage) != PGM_PAGE_STATE_ALLOCATED
+            ||  PGM_PAGE_GET_PDE_TYPE(pPage) == PGM_PAGE_PDE_TYPE_PDE
+            ||  PGM_PAGE_HAS_ACTIVE_HANDLERS(pPage)
+            ||  PGM_PAGE_GET_READ_LOCKS(pPage) != 0
+            ||  PGM_PAGE_GET_WRITE_LOCKS(pPage) != 0)
+        {
+            pReq->auHashes[iPage] = 0;
+            continue;
+        }
+
+        PageDesc.idPage = PGM_PAGE_GET_PAGEID(pPage);
+        PageDesc.HCPhys = PGM_PAGE_GET_HCPHYS(pPage);
+        PageDesc.GCPhys = GCPhys;
+        PageDesc.uHash  = pReq->auHashes[iPage];
+
+        rc = GMMR0DedupCheckPage(pGVM, &PageDesc);
+        if (RT_FAILURE(rc))
+            break;
+
+        if (PageDesc.uHash == pReq->auHashes[iPage])
+            pReq->cStablePages++;
+        pReq->auHashes[iPage] = PageDesc.uHash;
+
+        /*
+         * Any change for this page?
+         */
+        if (PageDesc.idPage != NIL_GMM_PAGEID)
+        {
+            Log(("PGMR0DedupScanPages: shared page phys=%RGp host %RHp->%RHp\n", GCPhys, PGM_PAGE_GET_HCPHYS(pPage), PageDesc.HCPhys));
+
+            /* Page was either replaced by an existing shared version of it or
+               converted into a shared page, so clear all references to it so
+               it'll be mapped read-only from now on. */
+            bool fFlush = false;
+            rc = pgmPoolTrackUpdateGCPhys(pVM, GCPhys, pPage, true /* clear the entries */, &fFlush);
+            Assert(   rc == VINF_SUCCESS
+                   || (   VMCPU_FF_IS_SET(pVCpu, VMCPU_FF_PGM_SYNC_CR3)
+                       && (pVCpu->pgm.s.fSyncFlags & PGM_SYNC_CLEAR_PGM_POOL)));
+            if (rc == VINF_SUCCESS)
+                fFlushTLBs |= fFlush;
+            fFlushRemTLBs = true;
+            rc = VINF_SUCCESS;
+
+            if (PageDesc.HCPhys != PGM_PAGE_GET_HCPHYS(pPage))
+            {
+                /* Update the physical address and page id now. */
+                PGM_PAGE_SET_HCPHYS(pVM, pPage, PageDesc.HCPhys);
+                PGM_PAGE_SET_PAGEID(pVM, pPage, PageDesc.idPage);
+
+                /* Invalidate page map TLB entry for this page too. */
+                pgmPhysInvalidatePageMapTLBEntry(pVM, GCPhys);
+                pVM->pgm.s.cReusedSharedPages++;
+                pReq->cMergedPages++;
+            }
+            else
+                pReq->cNewSharedPages++;
+
+            pVM->pgm.s.cSharedPages++;
+            pVM->pgm.s.cPrivatePages--;
+            PGM_PAGE_SET_STATE(pVM, pPage, PGM_PAGE_STATE_SHARED);
+
+# ifdef VBOX_STRICT /* check sum hack */
+            pPage->s.u2Unused0 = PageDesc.uHash        & 3;
+            pPage->s.u2Unused1 = (PageDesc.uHash >> 8) & 3;
+# endif
+        }
+    }
+
+    /*
+     * Do TLB flushing if necessary.
+     */
+    if (fFlushTLBs)
+        PGM_INVL_ALL_VCPU_TLBS(pVM);
+
+    if (fFlushRemTLBs)
+        for (VMCPUID idCurCpu = 0; idCurCpu < pVM->cCpus; idCurCpu++)
+            CPUMSetChangedFlags(&pVM->aCpus[idCurCpu], CPUM_CHANGED_GLOBAL_TLB_FLUSH);
+
+    return rc;
+}
 #endif /* VBOX_WITH_PAGE_SHARING */
 
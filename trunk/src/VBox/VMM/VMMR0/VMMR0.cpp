@@ -1788,6 +1788,15 @@ static int vmmR0EntryExWorker(PGVM pGVM, PVM pVM, VMCPUID idCpu, VMMR0OPERATION
             VMM_CHECK_SMAP_CHECK2(pVM, RT_NOTHING);
             break;
         }
+
+        case VMMR0_DO_GMM_DEDUP_SCAN_PAGES:
+            if (idCpu == NIL_VMCPUID)
+                return VERR_INVALID_CPU_ID;
+            if (u64Arg)
+                return VERR_INVALID_PARAMETER;
+            rc = GMMR0DedupScanPagesReq(pGVM, pVM, idCpu, (PGMMDEDUPSCANREQ)pReqHdr);
+            VMM_CHECK_SMAP_CHECK2(pVM, RT_NOTHING);
+            break;
 #endif
 
 #if defined(VBOX_STRICT) && HC_ARCH_BITS == 64
@@ -50,8 +50,12 @@
 *********************************************************************************************************************************/
 #define LOG_GROUP LOG_GROUP_DBGF
 #include <iprt/param.h>
+#include <iprt/asm.h>
 #include <iprt/file.h>
 #include <iprt/mem.h>
+#include <iprt/vfs.h>
+#include <iprt/zero.h>
+#include <iprt/zip.h>
 #include <iprt/formats/elf64.h>
 
 #include "DBGFInternal.h"
@@ -75,6 +79,9 @@
 *********************************************************************************************************************************/
 #define DBGFLOG_NAME           "DBGFCoreWrite"
 
+/** The number of guest pages to read before writing them out in one go. */
+#define DBGFCORE_CHUNK_PAGES    256
+
 
 /*********************************************************************************************************************************
 *   Global Variables                                                                                                             *
@@ -90,33 +97,150 @@ static const char *g_pcszCoreVBoxCpu  = "VBCPU";
 /*********************************************************************************************************************************
 *   Structures and Typedefs                                                                                                      *
 *********************************************************************************************************************************/
+/**
+ * Guest core output.
+ *
+ * The core file is either written directly to the file, leaving holes where
+ * the guest memory is zero, or through a gzip compressor.
+ */
+typedef struct DBGFCOREOUTPUT
+{
+    /** The file handle. */
+    RTFILE          hFile;
+    /** The gzip compressor stream, NIL_RTVFSIOSTREAM if writing to the file
+     *  directly. */
+    RTVFSIOSTREAM   hVfsIosGzip;
+    /** The current (uncompressed) output offset. */
+    uint64_t        off;
+    /** Number of zero bytes skipped or compressed. */
+    uint64_t        cbZero;
+} DBGFCOREOUTPUT;
+/** Pointer to the guest core output. */
+typedef DBGFCOREOUTPUT *PDBGFCOREOUTPUT;
+
+
+/**
+ * A memory range going into the core file.
+ */
+typedef struct DBGFCORERANGE
+{
+    /** The first address of the range. */
+    RTGCPHYS    GCPhysStart;
+    /** The last address of the range. */
+    RTGCPHYS    GCPhysEnd;
+    /** Whether this is a pure MMIO range, which takes up no space in the file. */
+    bool        fIsMmio;
+} DBGFCORERANGE;
+/** Pointer to a core memory range. */
+typedef DBGFCORERANGE *PDBGFCORERANGE;
+
+
 /**
  * Guest core writer data.
  *
- * Used to pass parameters from DBGFR3CoreWrite to dbgfR3CoreWriteRendezvous().
+ * Used to pass parameters from DBGFR3CoreWriteEx to dbgfR3CoreWriteRendezvous().
  */
 typedef struct DBGFCOREDATA
 {
-    /** The name of the file to write the file to. */
-    const char *pszFilename;
-    /** Whether to replace (/overwrite) any existing file. */
-    bool        fReplaceFile;
+    /** The output. */
+    PDBGFCOREOUTPUT pOut;
+    /** DBGFCOREWRITE_F_XXX. */
+    uint32_t        fFlags;
+    /** Number of memory ranges. */
+    uint16_t        cMemRanges;
+    /** The memory ranges, collected by the rendezvous so the memory can be
+     *  written after it in live mode. */
+    PDBGFCORERANGE  paMemRanges;
 } DBGFCOREDATA;
 /** Pointer to the guest core writer data.  */
 typedef DBGFCOREDATA *PDBGFCOREDATA;
 
 
 
+/**
+ * Writes to the core file at the current offset.
+ *
+ * @returns IPRT status code.
+ * @param   pOut            The output.
+ * @param   pvBuf           What to write.
+ * @param   cbBuf           How much to write.
+ */
+static int dbgfR3CoreOutWrite(PDBGFCOREOUTPUT pOut, const void *pvBuf, size_t cbBuf)
+{
+    int rc;
+    if (pOut->hVfsIosGzip != NIL_RTVFSIOSTREAM)
+        rc = RTVfsIoStrmWrite(pOut->hVfsIosGzip, pvBuf, cbBuf, true /*fBlocking*/, NULL /*pcbWritten*/);
+    else
+        rc = RTFileWriteAt(pOut->hFile, pOut->off, pvBuf, cbBuf, NULL /*pcbWritten*/);
+    if (RT_SUCCESS(rc))
+        pOut->off += cbBuf;
+    return rc;
+}
+
+
+/**
+ * Advances the core file over zero bytes.
+ *
+ * Plain files get a hole, which most file systems don't allocate any space
+ * for, the gzip compressor has to be fed the zeros.
+ *
+ * @returns IPRT status code.
+ * @param   pOut            The output.
+ * @param   cb              Number of zero bytes.
+ */
+static int dbgfR3CoreOutZero(PDBGFCOREOUTPUT pOut, uint64_t cb)
+{
+    pOut->cbZero += cb;
+    if (pOut->hVfsIosGzip == NIL_RTVFSIOSTREAM)
+    {
+        pOut->off += cb;
+        return VINF_SUCCESS;
+    }
+
+    while (cb > 0)
+    {
+        size_t const cbToWrite = (size_t)RT_MIN(cb, sizeof(g_abRTZero64K));
+        int rc = dbgfR3CoreOutWrite(pOut, g_abRTZero64K, cbToWrite);
+        if (RT_FAILURE(rc))
+            return rc;
+        cb -= cbToWrite;
+    }
+    return VINF_SUCCESS;
+}
+
+
+/**
+ * Completes the core file.
+ *
+ * @returns IPRT status code.
+ * @param   pOut            The output.
+ */
+static int dbgfR3CoreOutFinish(PDBGFCOREOUTPUT pOut)
+{
+    if (pOut->hVfsIosGzip != NIL_RTVFSIOSTREAM)
+    {
+        /* Write the trailer here, releasing the stream would drop any error. */
+        int rc = RTZipGzipCompressFinish(pOut->hVfsIosGzip);
+        RTVfsIoStrmRelease(pOut->hVfsIosGzip);
+        pOut->hVfsIosGzip = NIL_RTVFSIOSTREAM;
+        return rc;
+    }
+    /* The file may end with a hole. */
+    return RTFileSetSize(pOut->hFile, pOut->off);
+}
+
+
+
 /**
  * ELF function to write 64-bit ELF header.
  *
- * @param   hFile           The file to write to.
+ * @param   pOut            The output.
  * @param   cProgHdrs       Number of program headers.
  * @param   cSecHdrs        Number of section headers.
  *
  * @return IPRT status code.
  */
-static int Elf64WriteElfHdr(RTFILE hFile, uint16_t cProgHdrs, uint16_t cSecHdrs)
+static int Elf64WriteElfHdr(PDBGFCOREOUTPUT pOut, uint16_t cProgHdrs, uint16_t cSecHdrs)
 {
     Elf64_Ehdr ElfHdr;
     RT_ZERO(ElfHdr);
@@ -141,14 +265,14 @@ static int Elf64WriteElfHdr(RTFILE hFile, uint16_t cProgHdrs, uint16_t cSecHdrs)
     ElfHdr.e_phentsize       = sizeof(Elf64_Phdr);
     ElfHdr.e_shentsize       = sizeof(Elf64_Shdr);
 
-    return RTFileWrite(hFile, &ElfHdr, sizeof(ElfHdr), NULL /* all */);
+    return dbgfR3CoreOutWrite(pOut, &ElfHdr, sizeof(ElfHdr));
 }
 
 
 /**
  * ELF function to write 64-bit program header.
  *
- * @param   hFile           The file to write to.
+ * @param   pOut            The output.
  * @param   Type            Type of program header (PT_*).
  * @param   fFlags          Flags (access permissions, PF_*).
  * @param   offFileData     File offset of contents.
@@ -158,7 +282,7 @@ static int Elf64WriteElfHdr(RTFILE hFile, uint16_t cProgHdrs, uint16_t cSecHdrs)
  *
  * @return IPRT status code.
  */
-static int Elf64WriteProgHdr(RTFILE hFile, uint32_t Type, uint32_t fFlags, uint64_t offFileData, uint64_t cbFileData,
+static int Elf64WriteProgHdr(PDBGFCOREOUTPUT pOut, uint32_t Type, uint32_t fFlags, uint64_t offFileData, uint64_t cbFileData,
                              uint64_t cbMemData, RTGCPHYS Phys)
 {
     Elf64_Phdr ProgHdr;
@@ -170,7 +294,7 @@ static int Elf64WriteProgHdr(RTFILE hFile, uint32_t Type, uint32_t fFlags, uint6
     ProgHdr.p_memsz  = cbMemData;
     ProgHdr.p_paddr  = Phys;
 
-    return RTFileWrite(hFile, &ProgHdr, sizeof(ProgHdr), NULL /* all */);
+    return dbgfR3CoreOutWrite(pOut, &ProgHdr, sizeof(ProgHdr));
 }
 
 
@@ -198,7 +322,7 @@ static uint64_t Elf64NoteSectionSize(const char *pszName, uint64_t cbData)
 /**
  * Elf function to write 64-bit note header.
  *
- * @param   hFile       The file to write to.
+ * @param   pOut        The output.
  * @param   Type        Type of this section.
  * @param   pszName     Name of this section.
  * @param   pvData      Opaque pointer to the data, if NULL only computes size.
@@ -206,7 +330,7 @@ static uint64_t Elf64NoteSectionSize(const char *pszName, uint64_t cbData)
  *
  * @returns IPRT status code.
  */
-static int Elf64WriteNoteHdr(RTFILE hFile, uint16_t Type, const char *pszName, const void *pvData, uint64_t cbData)
+static int Elf64WriteNoteHdr(PDBGFCOREOUTPUT pOut, uint16_t Type, const char *pszName, const void *pvData, uint64_t cbData)
 {
     AssertReturn(pvData, VERR_INVALID_POINTER);
     AssertReturn(cbData > 0, VERR_NO_DATA);
@@ -250,41 +374,41 @@ static int Elf64WriteNoteHdr(RTFILE hFile, uint16_t Type, const char *pszName, c
     /*
      * Write note header.
      */
-    int rc = RTFileWrite(hFile, &ElfNoteHdr, sizeof(ElfNoteHdr), NULL /* all */);
+    int rc = dbgfR3CoreOutWrite(pOut, &ElfNoteHdr, sizeof(ElfNoteHdr));
     if (RT_SUCCESS(rc))
     {
         /*
          * Write note name.
          */
-        rc = RTFileWrite(hFile, szNoteName, cbName, NULL /* all */);
+        rc = dbgfR3CoreOutWrite(pOut, szNoteName, cbName);
         if (RT_SUCCESS(rc))
         {
             /*
              * Write note name padding if required.
              */
             if (cbNameAlign > cbName)
-                rc = RTFileWrite(hFile, s_achPad, cbNameAlign - cbName, NULL);
+                rc = dbgfR3CoreOutWrite(pOut, s_achPad, cbNameAlign - cbName);
 
             if (RT_SUCCESS(rc))
             {
                 /*
                  * Write note data.
                  */
-                rc = RTFileWrite(hFile, pvData, cbData, NULL /* all */);
+                rc = dbgfR3CoreOutWrite(pOut, pvData, cbData);
                 if (RT_SUCCESS(rc))
                 {
                     /*
                      * Write note data padding if required.
                      */
                     if (cbDataAlign > cbData)
-                        rc = RTFileWrite(hFile, s_achPad, cbDataAlign - cbData, NULL /* all*/);
+                        rc = dbgfR3CoreOutWrite(pOut, s_achPad, cbDataAlign - cbData);
                 }
             }
         }
     }
 
     if (RT_FAILURE(rc))
-        LogRel((DBGFLOG_NAME ": RTFileWrite failed. rc=%Rrc pszName=%s cbName=%u cbNameAlign=%u cbData=%u cbDataAlign=%u\n",
+        LogRel((DBGFLOG_NAME ": dbgfR3CoreOutWrite failed. rc=%Rrc pszName=%s cbName=%u cbNameAlign=%u cbData=%u cbDataAlign=%u\n",
                 rc, pszName, cbName, cbNameAlign, cbData, cbDataAlign));
 
     return rc;
@@ -388,14 +512,18 @@ static void dbgfR3GetCoreCpu(PVMCPU pVCpu, PDBGFCORECPU pDbgfCpu)
 
 
 /**
- * Worker function for dbgfR3CoreWrite() which does the writing.
+ * Worker function for dbgfR3CoreWriteRendezvous() which writes everything
+ * but the guest memory.
  *
  * @returns VBox status code
  * @param   pVM                 The cross context VM structure.
- * @param   hFile               The file to write to.  Caller closes this.
+ * @param   pDbgfData           The core writer data.  The memory ranges are
+ *                              collected here.
  */
-static int dbgfR3CoreWriteWorker(PVM pVM, RTFILE hFile)
+static int dbgfR3CoreWriteHeaders(PVM pVM, PDBGFCOREDATA pDbgfData)
 {
+    PDBGFCOREOUTPUT pOut = pDbgfData->pOut;
+
     /*
      * Collect core information.
      */
@@ -414,10 +542,19 @@ static int dbgfR3CoreWriteWorker(PVM pVM, RTFILE hFile)
 
     Log((DBGFLOG_NAME ": CoreDescriptor Version=%u Revision=%u\n", CoreDescriptor.u32VBoxVersion, CoreDescriptor.u32VBoxRevision));
 
+    PDBGFCORERANGE paMemRanges = (PDBGFCORERANGE)RTMemAllocZ(sizeof(paMemRanges[0]) * RT_MAX(cMemRanges, 1));
+    if (RT_UNLIKELY(!paMemRanges))
+    {
+        LogRel((DBGFLOG_NAME ": Failed to alloc memory range table for %u ranges\n", cMemRanges));
+        return VERR_NO_MEMORY;
+    }
+    pDbgfData->paMemRanges = paMemRanges;
+    pDbgfData->cMemRanges  = cMemRanges;
+
     /*
      * Compute the file layout (see pg_dbgf_vmcore).
      */
-    uint64_t const offElfHdr          = RTFileTell(hFile);
+    uint64_t const offElfHdr          = pOut->off;
     uint64_t const offNoteSection     = offElfHdr         + sizeof(Elf64_Ehdr);
     uint64_t const offLoadSections    = offNoteSection    + sizeof(Elf64_Phdr);
     uint64_t const cbLoadSections     = cMemRanges * sizeof(Elf64_Phdr);
@@ -433,7 +570,7 @@ static int dbgfR3CoreWriteWorker(PVM pVM, RTFILE hFile)
     /*
      * Write ELF header.
      */
-    int rc = Elf64WriteElfHdr(hFile, cProgHdrs, 0 /* cSecHdrs */);
+    int rc = Elf64WriteElfHdr(pOut, cProgHdrs, 0 /* cSecHdrs */);
     if (RT_FAILURE(rc))
     {
         LogRel((DBGFLOG_NAME ": Elf64WriteElfHdr failed. rc=%Rrc\n", rc));
@@ -443,8 +580,8 @@ static int dbgfR3CoreWriteWorker(PVM pVM, RTFILE hFile)
     /*
      * Write PT_NOTE program header.
      */
-    Assert(RTFileTell(hFile) == offNoteSection);
-    rc = Elf64WriteProgHdr(hFile, PT_NOTE, PF_R,
+    Assert(pOut->off == offNoteSection);
+    rc = Elf64WriteProgHdr(pOut, PT_NOTE, PF_R,
                            offNoteSectionData,  /* file offset to contents */
                            cbNoteSectionData,   /* size in core file */
                            cbNoteSectionData,   /* size in memory */
@@ -458,31 +595,29 @@ static int dbgfR3CoreWriteWorker(PVM pVM, RTFILE hFile)
     /*
      * Write PT_LOAD program header for each memory range.
      */
-    Assert(RTFileTell(hFile) == offLoadSections);
+    Assert(pOut->off == offLoadSections);
     uint64_t offMemRange = offMemory;
     for (uint16_t iRange = 0; iRange < cMemRanges; iRange++)
     {
-        RTGCPHYS    GCPhysStart;
-        RTGCPHYS    GCPhysEnd;
-        bool        fIsMmio;
-        rc = PGMR3PhysGetRange(pVM, iRange, &GCPhysStart, &GCPhysEnd, NULL /* pszDesc */, &fIsMmio);
+        PDBGFCORERANGE pRange = &paMemRanges[iRange];
+        rc = PGMR3PhysGetRange(pVM, iRange, &pRange->GCPhysStart, &pRange->GCPhysEnd, NULL /* pszDesc */, &pRange->fIsMmio);
         if (RT_FAILURE(rc))
         {
             LogRel((DBGFLOG_NAME ": PGMR3PhysGetRange failed for iRange(%u) rc=%Rrc\n", iRange, rc));
             return rc;
         }
 
-        uint64_t cbMemRange  = GCPhysEnd - GCPhysStart + 1;
-        uint64_t cbFileRange = fIsMmio ? 0 : cbMemRange;
+        uint64_t cbMemRange  = pRange->GCPhysEnd - pRange->GCPhysStart + 1;
+        uint64_t cbFileRange = pRange->fIsMmio ? 0 : cbMemRange;
 
         Log((DBGFLOG_NAME ": PGMR3PhysGetRange iRange=%u GCPhysStart=%#x GCPhysEnd=%#x cbMemRange=%u\n",
-             iRange, GCPhysStart, GCPhysEnd, cbMemRange));
+             iRange, pRange->GCPhysStart, pRange->GCPhysEnd, cbMemRange));
 
-        rc = Elf64WriteProgHdr(hFile, PT_LOAD, PF_R,
+        rc = Elf64WriteProgHdr(pOut, PT_LOAD, PF_R,
                                offMemRange,                         /* file offset to contents */
                                cbFileRange,                         /* size in core file */
                                cbMemRange,                          /* size in memory */
-                               GCPhysStart);                        /* physical address */
+                               pRange->GCPhysStart);                /* physical address */
         if (RT_FAILURE(rc))
         {
             LogRel((DBGFLOG_NAME ": Elf64WriteProgHdr failed for memory range(%u) cbFileRange=%u cbMemRange=%u rc=%Rrc\n",
@@ -496,8 +631,8 @@ static int dbgfR3CoreWriteWorker(PVM pVM, RTFILE hFile)
     /*
      * Write the Core descriptor note header and data.
      */
-    Assert(RTFileTell(hFile) == offCoreDescriptor);
-    rc = Elf64WriteNoteHdr(hFile, NT_VBOXCORE, g_pcszCoreVBoxCore, &CoreDescriptor, sizeof(CoreDescriptor));
+    Assert(pOut->off == offCoreDescriptor);
+    rc = Elf64WriteNoteHdr(pOut, NT_VBOXCORE, g_pcszCoreVBoxCore, &CoreDescriptor, sizeof(CoreDescriptor));
     if (RT_FAILURE(rc))
     {
         LogRel((DBGFLOG_NAME ": Elf64WriteNoteHdr failed for Note '%s' rc=%Rrc\n", g_pcszCoreVBoxCore, rc));
@@ -508,7 +643,7 @@ static int dbgfR3CoreWriteWorker(PVM pVM, RTFILE hFile)
      * Write the CPU context note headers and data.
      * We allocate the DBGFCORECPU struct. rather than using the stack as it can be pretty large due to X86XSAVEAREA.
      */
-    Assert(RTFileTell(hFile) == offCpuDumps);
+    Assert(pOut->off == offCpuDumps);
     PDBGFCORECPU pDbgfCoreCpu = (PDBGFCORECPU)RTMemAlloc(sizeof(*pDbgfCoreCpu));
     if (RT_UNLIKELY(!pDbgfCoreCpu))
     {
@@ -522,7 +657,7 @@ static int dbgfR3CoreWriteWorker(PVM pVM, RTFILE hFile)
         RT_BZERO(pDbgfCoreCpu, sizeof(*pDbgfCoreCpu));
         dbgfR3GetCoreCpu(pVCpu, pDbgfCoreCpu);
 
-        rc = Elf64WriteNoteHdr(hFile, NT_VBOXCPU, g_pcszCoreVBoxCpu, pDbgfCoreCpu, sizeof(*pDbgfCoreCpu));
+        rc = Elf64WriteNoteHdr(pOut, NT_VBOXCPU, g_pcszCoreVBoxCpu, pDbgfCoreCpu, sizeof(*pDbgfCoreCpu));
         if (RT_FAILURE(rc))
         {
             LogRel((DBGFLOG_NAME ": Elf64WriteNoteHdr failed for vCPU[%u] rc=%Rrc\n", iCpu, rc));
@@ -533,59 +668,105 @@ static int dbgfR3CoreWriteWorker(PVM pVM, RTFILE hFile)
     RTMemFree(pDbgfCoreCpu);
     pDbgfCoreCpu = NULL;
 
-    /*
-     * Write memory ranges.
-     */
-    Assert(RTFileTell(hFile) == offMemory);
-    for (uint16_t iRange = 0; iRange < cMemRanges; iRange++)
+    Assert(pOut->off == offMemory);
+    return rc;
+}
+
+
+/**
+ * Worker function for DBGFR3CoreWriteEx() which writes the guest memory.
+ *
+ * Pages PGM knows to be zero or ballooned are not read at all, and together
+ * with pages that turn out to contain only zeros they are left as holes in the
+ * file.  The other pages are collected and written in chunks.
+ *
+ * @returns VBox status code
+ * @param   pVM                 The cross context VM structure.
+ * @param   pDbgfData           The core writer data.
+ */
+static int dbgfR3CoreWriteMemory(PVM pVM, PDBGFCOREDATA pDbgfData)
+{
+    PDBGFCOREOUTPUT pOut = pDbgfData->pOut;
+
+    uint8_t *pbChunk = (uint8_t *)RTMemPageAlloc(DBGFCORE_CHUNK_PAGES * PAGE_SIZE);
+    if (RT_UNLIKELY(!pbChunk))
     {
-        RTGCPHYS GCPhysStart;
-        RTGCPHYS GCPhysEnd;
-        bool     fIsMmio;
-        rc = PGMR3PhysGetRange(pVM, iRange, &GCPhysStart, &GCPhysEnd, NULL /* pszDesc */, &fIsMmio);
-        if (RT_FAILURE(rc))
-        {
-            LogRel((DBGFLOG_NAME ": PGMR3PhysGetRange(2) failed for iRange(%u) rc=%Rrc\n", iRange, rc));
-            return rc;
-        }
+        LogRel((DBGFLOG_NAME ": Failed to alloc %u bytes for the memory chunk buffer\n", DBGFCORE_CHUNK_PAGES * PAGE_SIZE));
+        return VERR_NO_MEMORY;
+    }
 
-        if (fIsMmio)
+    int rc = VINF_SUCCESS;
+    for (uint16_t iRange = 0; iRange < pDbgfData->cMemRanges && RT_SUCCESS(rc); iRange++)
+    {
+        PDBGFCORERANGE pRange = &pDbgfData->paMemRanges[iRange];
+        if (pRange->fIsMmio)
             continue;
 
         /*
-         * Write page-by-page of this memory range.
+         * Write this memory range a chunk at a time.
          *
          * The read function may fail on MMIO ranges, we write these as zero
          * pages for now (would be nice to have the VGA bits there though).
          */
-        uint64_t cbMemRange  = GCPhysEnd - GCPhysStart + 1;
+        uint64_t cbMemRange  = pRange->GCPhysEnd - pRange->GCPhysStart + 1;
         uint64_t cPages      = cbMemRange >> PAGE_SHIFT;
-        for (uint64_t iPage = 0; iPage < cPages; iPage++)
+        for (uint64_t iPage = 0; iPage < cPages && RT_SUCCESS(rc); iPage += DBGFCORE_CHUNK_PAGES)
         {
-            uint8_t abPage[PAGE_SIZE];
-            rc = PGMPhysSimpleReadGCPhys(pVM, abPage, GCPhysStart + (iPage << PAGE_SHIFT),  sizeof(abPage));
-            if (RT_FAILURE(rc))
+            RTGCPHYS const GCPhysChunk = pRange->GCPhysStart + (iPage << PAGE_SHIFT);
+            uint32_t const cChunkPages = (uint32_t)RT_MIN(cPages - iPage, DBGFCORE_CHUNK_PAGES);
+            uint64_t       bmZero[DBGFCORE_CHUNK_PAGES / 64];
+            if (RT_FAILURE(PGMR3PhysQueryZeroPages(pVM, GCPhysChunk, cChunkPages, bmZero)))
+                RT_ZERO(bmZero);
+
+            size_t cbPending = 0;
+            for (uint32_t iChunkPage = 0; iChunkPage < cChunkPages; iChunkPage++)
             {
-                if (rc != VERR_PGM_PHYS_PAGE_RESERVED)
-                    LogRel((DBGFLOG_NAME ": PGMPhysRead failed for iRange=%u iPage=%u. rc=%Rrc. Ignoring...\n", iRange, iPage, rc));
-                RT_ZERO(abPage);
-            }
+                bool fZero = ASMBitTest(bmZero, iChunkPage);
+                if (!fZero)
+                {
+                    uint8_t *pbPage = &pbChunk[cbPending];
+                    int rc2 = PGMPhysSimpleReadGCPhys(pVM, pbPage, GCPhysChunk + ((RTGCPHYS)iChunkPage << PAGE_SHIFT), PAGE_SIZE);
+                    if (RT_FAILURE(rc2))
+                    {
+                        if (rc2 != VERR_PGM_PHYS_PAGE_RESERVED)
+                            LogRel((DBGFLOG_NAME ": PGMPhysRead failed for iRange=%u iPage=%u. rc=%Rrc. Ignoring...\n",
+                                    iRange, iPage + iChunkPage, rc2));
+                        fZero = true;
+                    }
+                    else
+                        fZero = ASMMemIsZeroPage(pbPage);
+                }
 
-            rc = RTFileWrite(hFile, abPage, sizeof(abPage), NULL /* all */);
-            if (RT_FAILURE(rc))
-            {
-                LogRel((DBGFLOG_NAME ": RTFileWrite failed. iRange=%u iPage=%u rc=%Rrc\n", iRange, iPage, rc));
-                return rc;
+                if (!fZero)
+                    cbPending += PAGE_SIZE;
+                else
+                {
+                    if (cbPending)
+                    {
+                        rc = dbgfR3CoreOutWrite(pOut, pbChunk, cbPending);
+                        cbPending = 0;
+                        if (RT_FAILURE(rc))
+                            break;
+                    }
+                    rc = dbgfR3CoreOutZero(pOut, PAGE_SIZE);
+                    if (RT_FAILURE(rc))
+                        break;
+                }
             }
+            if (cbPending && RT_SUCCESS(rc))
+                rc = dbgfR3CoreOutWrite(pOut, pbChunk, cbPending);
+            if (RT_FAILURE(rc))
+                LogRel((DBGFLOG_NAME ": Writing memory failed. iRange=%u iPage=%u rc=%Rrc\n", iRange, iPage, rc));
         }
     }
 
+    RTMemPageFree(pbChunk, DBGFCORE_CHUNK_PAGES * PAGE_SIZE);
     return rc;
 }
 
 
 /**
- * EMT Rendezvous worker function for DBGFR3CoreWrite().
+ * EMT Rendezvous worker function for DBGFR3CoreWriteEx().
  *
  * @param   pVM              The cross context VM structure.
  * @param   pVCpu            The cross context virtual CPU structure of the calling EMT.
@@ -605,21 +786,13 @@ static DECLCALLBACK(VBOXSTRICTRC) dbgfR3CoreWriteRendezvous(PVM pVM, PVMCPU pVCp
     PDBGFCOREDATA pDbgfData = (PDBGFCOREDATA)pvData;
 
     /*
-     * Create the core file.
+     * Write the headers and the CPU states, and unless we're doing a live
+     * dump, the memory too.
      */
-    uint32_t fFlags = (pDbgfData->fReplaceFile ? RTFILE_O_CREATE_REPLACE : RTFILE_O_CREATE)
-                    | RTFILE_O_WRITE
-                    | RTFILE_O_DENY_ALL
-                    | (0600 << RTFILE_O_CREATE_MODE_SHIFT);
-    RTFILE   hFile;
-    int rc = RTFileOpen(&hFile, pDbgfData->pszFilename, fFlags);
-    if (RT_SUCCESS(rc))
-    {
-        rc = dbgfR3CoreWriteWorker(pVM, hFile);
-        RTFileClose(hFile);
-    }
-    else
-        LogRel((DBGFLOG_NAME ": RTFileOpen failed for '%s' rc=%Rrc\n", pDbgfData->pszFilename, rc));
+    int rc = dbgfR3CoreWriteHeaders(pVM, pDbgfData);
+    if (   RT_SUCCESS(rc)
+        && !(pDbgfData->fFlags & DBGFCOREWRITE_F_LIVE))
+        rc = dbgfR3CoreWriteMemory(pVM, pDbgfData);
     return rc;
 }
 
@@ -638,25 +811,88 @@ static DECLCALLBACK(VBOXSTRICTRC) dbgfR3CoreWriteRendezvous(PVM pVM, PVMCPU pVCp
  *          only synchronizes EMTs.
  */
 VMMR3DECL(int) DBGFR3CoreWrite(PUVM pUVM, const char *pszFilename, bool fReplaceFile)
+{
+    return DBGFR3CoreWriteEx(pUVM, pszFilename, fReplaceFile ? DBGFCOREWRITE_F_REPLACE : 0);
+}
+
+
+/**
+ * Write core dump of the guest, extended version.
+ *
+ * @returns VBox status code.
+ * @param   pUVM                The user mode VM handle.
+ * @param   pszFilename         The name of the file to which the guest core
+ *                              dump should be written.
+ * @param   fFlags              DBGFCOREWRITE_F_XXX.
+ *
+ * @remarks The VM may need to be suspended before calling this function in
+ *          order to truly stop all device threads and drivers. This function
+ *          only synchronizes EMTs, and with DBGFCOREWRITE_F_LIVE only while
+ *          collecting the CPU states.
+ */
+VMMR3DECL(int) DBGFR3CoreWriteEx(PUVM pUVM, const char *pszFilename, uint32_t fFlags)
 {
     UVM_ASSERT_VALID_EXT_RETURN(pUVM, VERR_INVALID_VM_HANDLE);
     PVM pVM = pUVM->pVM;
     VM_ASSERT_VALID_EXT_RETURN(pVM, VERR_INVALID_VM_HANDLE);
     AssertReturn(pszFilename, VERR_INVALID_HANDLE);
+    AssertReturn(!(fFlags & ~DBGFCOREWRITE_F_VALID_MASK), VERR_INVALID_FLAGS);
+
+    /*
+     * Create the core file.
+     */
+    uint64_t fOpen = ((fFlags & DBGFCOREWRITE_F_REPLACE) ? RTFILE_O_CREATE_REPLACE : RTFILE_O_CREATE)
+                   | RTFILE_O_WRITE
+                   | RTFILE_O_DENY_ALL
+                   | (0600 << RTFILE_O_CREATE_MODE_SHIFT);
+    DBGFCOREOUTPUT Out;
+    RT_ZERO(Out);
+    Out.hVfsIosGzip = NIL_RTVFSIOSTREAM;
+    int rc = RTFileOpen(&Out.hFile, pszFilename, fOpen);
+    if (RT_FAILURE(rc))
+    {
+        LogRel((DBGFLOG_NAME ": RTFileOpen failed for '%s' rc=%Rrc\n", pszFilename, rc));
+        return rc;
+    }
+
+    if (fFlags & DBGFCOREWRITE_F_GZIP)
+    {
+        RTVFSIOSTREAM hVfsIosFile;
+        rc = RTVfsIoStrmFromRTFile(Out.hFile, fOpen, true /*fLeaveOpen*/, &hVfsIosFile);
+        if (RT_SUCCESS(rc))
+        {
+            rc = RTZipGzipCompressIoStream(hVfsIosFile, 0 /*fFlags*/, 6 /*uLevel*/, &Out.hVfsIosGzip);
+            RTVfsIoStrmRelease(hVfsIosFile);
+        }
+        if (RT_FAILURE(rc))
+            LogRel((DBGFLOG_NAME ": Failed to create gzip stream for '%s' rc=%Rrc\n", pszFilename, rc));
+    }
 
     /*
      * Pass the core write request down to EMT rendezvous which makes sure
      * other EMTs, if any, are not running. IO threads could still be running
-     * but we don't care about them.
+     * but we don't care about them.  In live mode the memory is written
+     * afterwards, on this thread, while the EMTs keep going.
      */
     DBGFCOREDATA CoreData;
     RT_ZERO(CoreData);
-    CoreData.pszFilename  = pszFilename;
-    CoreData.fReplaceFile = fReplaceFile;
+    CoreData.pOut   = &Out;
+    CoreData.fFlags = fFlags;
+    if (RT_SUCCESS(rc))
+        rc = VMMR3EmtRendezvous(pVM, VMMEMTRENDEZVOUS_FLAGS_TYPE_ONCE, dbgfR3CoreWriteRendezvous, &CoreData);
+    if (   RT_SUCCESS(rc)
+        && (fFlags & DBGFCOREWRITE_F_LIVE))
+        rc = dbgfR3CoreWriteMemory(pVM, &CoreData);
+    if (RT_SUCCESS(rc))
+        rc = dbgfR3CoreOutFinish(&Out);
+    RTMemFree(CoreData.paMemRanges);
+
+    RTVfsIoStrmRelease(Out.hVfsIosGzip);
+    RTFileClose(Out.hFile);
 
-    int rc = VMMR3EmtRendezvous(pVM, VMMEMTRENDEZVOUS_FLAGS_TYPE_ONCE, dbgfR3CoreWriteRendezvous, &CoreData);
     if (RT_SUCCESS(rc))
-        LogRel((DBGFLOG_NAME ": Successfully wrote guest core dump '%s'\n", pszFilename));
+        LogRel((DBGFLOG_NAME ": Successfully wrote guest core dump '%s' (%'RU64 bytes, %'RU64 of them zero)\n",
+                pszFilename, Out.off, Out.cbZero));
     else
         LogRel((DBGFLOG_NAME ": Failed to write guest core dump '%s'. rc=%Rrc\n", pszFilename, rc));
     return rc;
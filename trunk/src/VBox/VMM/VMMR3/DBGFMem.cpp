@@ -135,6 +135,119 @@ VMMR3DECL(int) DBGFR3MemScan(PUVM pUVM, VMCPUID idCpu, PCDBGFADDRESS pAddress, R
 }
 
 
+/**
+ * Scan guest memory for any of a set of byte strings.
+ *
+ * @returns VBox status code.
+ * @param   pUVM        The user mode VM handle.
+ * @param   idCpu       The ID of the CPU context to search in.
+ * @param   pAddress    Where to start searching.
+ * @param   pcbRange    The number of bytes to scan. Passed as a pointer because
+ *                      it may be 64-bit.
+ * @param   puAlign     The alignment restriction imposed on the search result.
+ * @param   paNeedles   What to search for.
+ * @param   cNeedles    The number of needles.
+ * @param   pHitAddress Where to put the address of the first hit.
+ * @param   piNeedle    Where to put the index of the needle found.
+ */
+static DECLCALLBACK(int) dbgfR3MemScanMulti(PUVM pUVM, VMCPUID idCpu, PCDBGFADDRESS pAddress, PCRTGCUINTPTR pcbRange,
+                                            RTGCUINTPTR *puAlign, PCDBGFMEMSCANNEEDLE paNeedles, uint32_t cNeedles,
+                                            PDBGFADDRESS pHitAddress, uint32_t *piNeedle)
+{
+    PVM pVM = pUVM->pVM;
+    VM_ASSERT_VALID_EXT_RETURN(pVM, VERR_INVALID_VM_HANDLE);
+    Assert(idCpu == VMMGetCpuId(pVM));
+
+    /*
+     * Validate the input we use, PGM does the rest.
+     */
+    RTGCUINTPTR cbRange = *pcbRange;
+    if (!DBGFR3AddrIsValid(pUVM, pAddress))
+        return VERR_INVALID_POINTER;
+    if (!VALID_PTR(pHitAddress))
+        return VERR_INVALID_POINTER;
+    if (DBGFADDRESS_IS_HMA(pAddress))
+        return VERR_INVALID_POINTER;
+
+    /*
+     * Select DBGF worker by addressing mode.
+     */
+    int     rc;
+    PVMCPU  pVCpu   = VMMGetCpuById(pVM, idCpu);
+    PGMMODE enmMode = PGMGetGuestMode(pVCpu);
+    if (    enmMode == PGMMODE_REAL
+        ||  enmMode == PGMMODE_PROTECTED
+        ||  DBGFADDRESS_IS_PHYS(pAddress)
+        )
+    {
+        RTGCPHYS GCPhysAlign = *puAlign;
+        if (GCPhysAlign != *puAlign)
+            return VERR_OUT_OF_RANGE;
+        RTGCPHYS PhysHit;
+        rc = PGMR3DbgScanPhysicalMulti(pVM, pAddress->FlatPtr, cbRange, GCPhysAlign, paNeedles, cNeedles, &PhysHit, piNeedle);
+        if (RT_SUCCESS(rc))
+            DBGFR3AddrFromPhys(pUVM, pHitAddress, PhysHit);
+    }
+    else
+    {
+#if GC_ARCH_BITS > 32
+        if (    (   pAddress->FlatPtr >= _4G
+                 || pAddress->FlatPtr + cbRange > _4G)
+            &&  enmMode != PGMMODE_AMD64
+            &&  enmMode != PGMMODE_AMD64_NX)
+            return VERR_DBGF_MEM_NOT_FOUND;
+#endif
+        RTGCUINTPTR GCPtrHit;
+        rc = PGMR3DbgScanVirtualMulti(pVM, pVCpu, pAddress->FlatPtr, cbRange, *puAlign, paNeedles, cNeedles,
+                                      &GCPtrHit, piNeedle);
+        if (RT_SUCCESS(rc))
+            DBGFR3AddrFromFlat(pUVM, pHitAddress, GCPtrHit);
+    }
+
+    return rc;
+}
+
+
+/**
+ * Scan guest memory for any of a set of exact byte strings in one go.
+ *
+ * This walks the memory once instead of once per needle, so it is much
+ * cheaper than calling DBGFR3MemScan repeatedly when hunting for one of
+ * several markers.
+ *
+ * @returns VBox status codes:
+ * @retval  VINF_SUCCESS and *pHitAddress + *piNeedle on success.
+ * @retval  VERR_DBGF_MEM_NOT_FOUND if not found.
+ * @retval  VERR_INVALID_POINTER if any of the pointer arguments are invalid.
+ * @retval  VERR_INVALID_ARGUMENT if any other arguments are invalid.
+ *
+ * @param   pUVM        The user mode VM handle.
+ * @param   idCpu       The ID of the CPU context to search in.
+ * @param   pAddress    Where to start searching.
+ * @param   cbRange     The number of bytes to scan.
+ * @param   uAlign      The alignment restriction imposed on the result.
+ *                      Usually set to 1.
+ * @param   paNeedles   What to search for - exact search.  Max 256 bytes each.
+ * @param   cNeedles    The number of needles. Max 64.
+ * @param   pHitAddress Where to put the address of the first hit of any
+ *                      of the needles.
+ * @param   piNeedle    Where to put the index of the needle found.  If several
+ *                      match at the same address, the first one in
+ *                      @a paNeedles is returned.
+ *
+ * @thread  Any thread.
+ */
+VMMR3DECL(int) DBGFR3MemScanMulti(PUVM pUVM, VMCPUID idCpu, PCDBGFADDRESS pAddress, RTGCUINTPTR cbRange, RTGCUINTPTR uAlign,
+                                  PCDBGFMEMSCANNEEDLE paNeedles, uint32_t cNeedles, PDBGFADDRESS pHitAddress,
+                                  uint32_t *piNeedle)
+{
+    UVM_ASSERT_VALID_EXT_RETURN(pUVM, VERR_INVALID_VM_HANDLE);
+    AssertReturn(idCpu < pUVM->cCpus, VERR_INVALID_CPU_ID);
+    return VMR3ReqPriorityCallWaitU(pUVM, idCpu, (PFNRT)dbgfR3MemScanMulti, 9,
+                                    pUVM, idCpu, pAddress, &cbRange, &uAlign, paNeedles, cNeedles, pHitAddress, piNeedle);
+}
+
+
 /**
  * Read guest memory.
  *
@@ -429,6 +429,17 @@ GMMR3DECL(int)  GMMR3CheckSharedModules(PVM pVM)
 }
 
 
+/**
+ * @see GMMR0DedupScanPagesReq
+ */
+GMMR3DECL(int)  GMMR3DedupScanPages(PVM pVM, PGMMDEDUPSCANREQ pReq)
+{
+    pReq->Hdr.u32Magic = SUPVMMR0REQHDR_MAGIC;
+    pReq->Hdr.cbReq    = RT_OFFSETOF(GMMDEDUPSCANREQ, auHashes[pReq->cPages]);
+    return VMMR3CallR0(pVM, VMMR0_DO_GMM_DEDUP_SCAN_PAGES, 0, &pReq->Hdr);
+}
+
+
 #if defined(VBOX_STRICT) && HC_ARCH_BITS == 64
 /**
  * @see GMMR0FindDuplicatePage
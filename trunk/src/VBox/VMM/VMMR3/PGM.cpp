@@ -1751,6 +1751,12 @@ static int pgmR3InitStats(PVM pVM)
     STAM_REL_REG(pVM, &pPGM->StatLargePageRecheck,               STAMTYPE_COUNTER, "/PGM/LargePage/Recheck",             STAMUNIT_OCCURENCES, "The number of times we've rechecked a disabled large page.");
 
     STAM_REL_REG(pVM, &pPGM->StatShModCheck,                     STAMTYPE_PROFILE, "/PGM/ShMod/Check",                   STAMUNIT_TICKS_PER_CALL, "Profiles the shared module checking.");
+    STAM_REL_REG(pVM, &pPGM->cSharedPageCowBreaks,               STAMTYPE_U32,     "/PGM/Page/cSharedPageCowBreaks",     STAMUNIT_COUNT,     "The number of shared pages replaced by private copies on write.");
+    STAM_REL_REG(pVM, &pPGM->StatDedupScan,                      STAMTYPE_PROFILE, "/PGM/Dedup/Scan",                    STAMUNIT_TICKS_PER_CALL, "Profiles the content deduplication scans.");
+    STAM_REL_REG(pVM, &pPGM->StatDedupScannedPages,              STAMTYPE_COUNTER, "/PGM/Dedup/ScannedPages",            STAMUNIT_PAGES,     "Pages looked at by the deduplication scanner.");
+    STAM_REL_REG(pVM, &pPGM->StatDedupStablePages,               STAMTYPE_COUNTER, "/PGM/Dedup/StablePages",             STAMUNIT_PAGES,     "Scanned pages whose content hadn't changed since the previous scan.");
+    STAM_REL_REG(pVM, &pPGM->StatDedupNewSharedPages,            STAMTYPE_COUNTER, "/PGM/Dedup/NewSharedPages",          STAMUNIT_PAGES,     "Pages converted into new shared pages.");
+    STAM_REL_REG(pVM, &pPGM->StatDedupMergedPages,               STAMTYPE_COUNTER, "/PGM/Dedup/MergedPages",             STAMUNIT_PAGES,     "Pages replaced by an existing identical shared page (memory saved).");
 
     /* Live save */
     STAM_REL_REG_USED(pVM, &pPGM->LiveSave.fActive,              STAMTYPE_U8,      "/PGM/LiveSave/fActive",              STAMUNIT_COUNT,     "Active or not.");
@@ -2272,6 +2278,14 @@ VMMR3DECL(int) PGMR3InitFinalize(PVM pVM)
     if (pVM->pgm.s.fRamPreAlloc)
         rc = pgmR3PhysRamPreAllocate(pVM);
 
+#ifdef VBOX_WITH_PAGE_SHARING
+    /*
+     * Start the content based page deduplication scanner if configured.
+     */
+    if (RT_SUCCESS(rc))
+        rc = pgmR3DedupInit(pVM);
+#endif
+
     //pgmLogState(pVM);
     LogRel(("PGM: PGMR3InitFinalize: 4 MB PSE mask %RGp\n", pVM->pgm.s.GCPhys4MBPSEMask));
     return rc;
@@ -2720,6 +2734,9 @@ VMMR3DECL(int) PGMR3Term(PVM pVM)
     pgmR3PhysRamTerm(pVM);
     pgmR3PhysRomTerm(pVM);
     pgmUnlock(pVM);
+#ifdef VBOX_WITH_PAGE_SHARING
+    pgmR3DedupTerm(pVM);
+#endif
 
     PGMDeregisterStringFormatTypes();
     return PDMR3CritSectDelete(&pVM->pgm.s.CritSectX);
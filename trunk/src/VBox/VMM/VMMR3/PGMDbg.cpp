@@ -21,6 +21,7 @@
 *********************************************************************************************************************************/
 #define LOG_GROUP LOG_GROUP_PGM
 #include <VBox/vmm/pgm.h>
+#include <VBox/vmm/dbgf.h>
 #include <VBox/vmm/stam.h>
 #include "PGMInternal.h"
 #include <VBox/vmm/vm.h>
@@ -32,6 +33,10 @@
 #include <VBox/log.h>
 #include <VBox/param.h>
 #include <VBox/err.h>
+#ifdef RT_ARCH_AMD64
+/* SSE2 is part of the AMD64 base line, so no run-time detection needed. */
+# include <emmintrin.h>
+#endif
 
 
 /*********************************************************************************************************************************
@@ -40,6 +45,10 @@
 /** The max needle size that we will bother searching for
  * This must not be more than half a page! */
 #define MAX_NEEDLE_SIZE     256
+/** The max number of needles the multi needle scanners accept. */
+#define MAX_NEEDLES         64
+/** The max number of distinct first needle bytes the SSE2 code handles. */
+#define MAX_SIMD_FIRST_BYTES 4
 
 
 /*********************************************************************************************************************************
@@ -94,6 +103,50 @@ typedef struct PGMR3DUMPHIERARCHYSTATE
 typedef PGMR3DUMPHIERARCHYSTATE *PPGMR3DUMPHIERARCHYSTATE;
 
 
+/**
+ * State of a multi needle scan.
+ *
+ * This does the scanning for all the needles in a single pass over the
+ * memory.  Candidate positions are found by looking for the first bytes of
+ * the needles, and the needles sharing a first byte are chained together.
+ */
+typedef struct PGMR3DBGSCANMULTI
+{
+    /** The needles. */
+    PCDBGFMEMSCANNEEDLE paNeedles;
+    /** The number of needles. */
+    uint32_t            cNeedles;
+    /** The needle alignment. */
+    uint32_t            uAlign;
+    /** The length of the longest needle. */
+    uint32_t            cbMaxNeedle;
+    /** Set if any of the needles is all zeros, so zero pages must be scanned. */
+    bool                fAllZero;
+    /** The number of distinct first bytes. */
+    uint8_t             cFirstBytes;
+    /** The distinct first bytes. */
+    uint8_t             abFirstBytes[MAX_NEEDLES];
+    /** The first needle for each first byte value, UINT8_MAX if none. */
+    uint8_t             aiFirstNeedle[256];
+    /** The next needle with the same first byte, UINT8_MAX if none. */
+    uint8_t             aiNextNeedle[MAX_NEEDLES];
+    /** The number of bytes carried over from the end of the previous page. */
+    uint32_t            cbCarry;
+    /** The carried over bytes followed by the start of the current page, for
+     * finding matches crossing the page boundrary. */
+    uint8_t             abCarry[MAX_NEEDLE_SIZE * 2];
+    /** Set if a match in the tail of the previous page was held back because
+     * a needle starting before it runs into the current page. */
+    bool                fHeldBack;
+    /** The page offset of the held back match. */
+    uint32_t            offHeldBack;
+    /** The needle of the held back match. */
+    uint32_t            iHeldBack;
+} PGMR3DBGSCANMULTI;
+/** Pointer to the state of a multi needle scan. */
+typedef PGMR3DBGSCANMULTI *PPGMR3DBGSCANMULTI;
+
+
 /**
  * Assembly scanning function.
  *
@@ -617,6 +670,302 @@ static void pgmR3DbgSelectMemScanFunction(PFNPGMR3DBGFIXEDMEMSCAN *ppfnMemScan,
 }
 
 
+/**
+ * Validates the needles and initializes the multi needle scan state.
+ *
+ * @returns VBox status code.
+ * @param   pState          The state to initialize.
+ * @param   paNeedles       The needles.
+ * @param   cNeedles        The number of needles.
+ * @param   uAlign          The needle alignment, a power of two.
+ */
+static int pgmR3DbgScanMultiInit(PPGMR3DBGSCANMULTI pState, PCDBGFMEMSCANNEEDLE paNeedles, uint32_t cNeedles, uint32_t uAlign)
+{
+    if (!VALID_PTR(paNeedles))
+        return VERR_INVALID_POINTER;
+    if (!cNeedles || cNeedles > MAX_NEEDLES)
+        return VERR_INVALID_PARAMETER;
+
+    pState->paNeedles   = paNeedles;
+    pState->cNeedles    = cNeedles;
+    pState->uAlign      = uAlign;
+    pState->cbMaxNeedle = 0;
+    pState->fAllZero    = false;
+    pState->cFirstBytes = 0;
+    pState->cbCarry     = 0;
+    pState->fHeldBack   = false;
+    memset(pState->aiFirstNeedle, UINT8_MAX, sizeof(pState->aiFirstNeedle));
+
+    /* Build the chains backwards so they end up in needle order. */
+    uint32_t i = cNeedles;
+    while (i-- > 0)
+    {
+        uint8_t const *pabNeedle = (uint8_t const *)paNeedles[i].pvNeedle;
+        size_t const   cbNeedle  = paNeedles[i].cbNeedle;
+        if (!VALID_PTR(pabNeedle))
+            return VERR_INVALID_POINTER;
+        if (!cbNeedle || cbNeedle > MAX_NEEDLE_SIZE)
+            return VERR_INVALID_PARAMETER;
+
+        pState->cbMaxNeedle = RT_MAX(pState->cbMaxNeedle, (uint32_t)cbNeedle);
+        if (!pState->fAllZero)
+            pState->fAllZero = ASMMemIsZero(pabNeedle, cbNeedle);
+
+        if (pState->aiFirstNeedle[pabNeedle[0]] == UINT8_MAX)
+            pState->abFirstBytes[pState->cFirstBytes++] = pabNeedle[0];
+        pState->aiNextNeedle[i] = pState->aiFirstNeedle[pabNeedle[0]];
+        pState->aiFirstNeedle[pabNeedle[0]] = (uint8_t)i;
+    }
+    return VINF_SUCCESS;
+}
+
+
+/**
+ * Checks whether any of the needles matches at the given position.
+ *
+ * @returns true and *piNeedle on match, false if not.
+ * @param   pState          The multi needle scan state.
+ * @param   pb              The candidate position.
+ * @param   cbLeft          The number of bytes available at @a pb.
+ * @param   piNeedle        Where to return the index of the matching needle.
+ */
+DECLINLINE(bool) pgmR3DbgScanMultiMatch(PPGMR3DBGSCANMULTI pState, const uint8_t *pb, size_t cbLeft, uint32_t *piNeedle)
+{
+    for (uint32_t i = pState->aiFirstNeedle[*pb]; i != UINT8_MAX; i = pState->aiNextNeedle[i])
+    {
+        size_t const cbNeedle = pState->paNeedles[i].cbNeedle;
+        if (   cbNeedle <= cbLeft
+            && !memcmp(pb + 1, (uint8_t const *)pState->paNeedles[i].pvNeedle + 1, cbNeedle - 1))
+        {
+            *piNeedle = i;
+            return true;
+        }
+    }
+    return false;
+}
+
+
+/**
+ * Carries the tail of the page over to the next one if the search continues
+ * there and a needle can start in it.
+ *
+ * @param   pState          The multi needle scan state.
+ * @param   pbPage          Pointer to the current page.
+ * @param   offEnd          The page offset the search of the page ends at.
+ * @param   cb              The number of bytes searched in the page.
+ */
+DECLINLINE(void) pgmR3DbgScanMultiCarry(PPGMR3DBGSCANMULTI pState, const uint8_t *pbPage, uint32_t offEnd, uint32_t cb)
+{
+    if (   offEnd == PAGE_SIZE
+        && pState->uAlign < PAGE_SIZE
+        && pState->cbMaxNeedle > 1)
+    {
+        uint32_t const cbNewCarry = RT_MIN(pState->cbMaxNeedle - 1, cb);
+        memcpy(pState->abCarry, &pbPage[PAGE_SIZE - cbNewCarry], cbNewCarry);
+        pState->cbCarry = cbNewCarry;
+    }
+}
+
+
+/**
+ * Checks whether a match in the tail of a page has to be held back because a
+ * needle starting before it runs past the end of the page and may still
+ * match.  The same goes for a lower needle index at the match position.
+ *
+ * A held back match is among the bytes carried over to the next page, so the
+ * scan of that page finds it again in the right order.  Should the next page
+ * not be scanned, pgmR3DbgScanMultiEnd returns it.
+ *
+ * @returns true if held back, false if the match can be returned.
+ * @param   pState          The multi needle scan state.
+ * @param   pbPage          Pointer to the current page.
+ * @param   offPage         The page offset the search started at.
+ * @param   cb              The number of bytes searched in the page.
+ * @param   offHit          The page offset of the match.
+ * @param   iNeedle         The needle that matched.
+ */
+static bool pgmR3DbgScanMultiHoldBack(PPGMR3DBGSCANMULTI pState, const uint8_t *pbPage, uint32_t offPage, uint32_t cb,
+                                      uint32_t offHit, uint32_t iNeedle)
+{
+    uint32_t const offEnd = offPage + cb;
+    if (   offEnd != PAGE_SIZE
+        || pState->uAlign >= PAGE_SIZE
+        || offHit + pState->cbMaxNeedle <= PAGE_SIZE)
+        return false;
+
+    uint32_t off = RT_ALIGN_32(RT_MAX(offPage, PAGE_SIZE + 1 - pState->cbMaxNeedle), pState->uAlign);
+    for (; off <= offHit; off += pState->uAlign)
+    {
+        uint32_t const cbLeft = PAGE_SIZE - off;
+        for (uint32_t i = pState->aiFirstNeedle[pbPage[off]];
+             i != UINT8_MAX && (off < offHit || i < iNeedle);
+             i = pState->aiNextNeedle[i])
+            if (   pState->paNeedles[i].cbNeedle > cbLeft
+                && !memcmp(&pbPage[off], pState->paNeedles[i].pvNeedle, cbLeft))
+            {
+                pState->fHeldBack   = true;
+                pState->offHeldBack = offHit;
+                pState->iHeldBack   = iNeedle;
+                pgmR3DbgScanMultiCarry(pState, pbPage, offEnd, cb);
+                return true;
+            }
+    }
+    return false;
+}
+
+
+/**
+ * Ends a run of adjacent pages, i.e. the bytes carried over aren't going to
+ * be used because the page following the last scanned one isn't scanned.
+ *
+ * @returns true and *poffHit + *piNeedle if a match was held back, false if not.
+ * @param   pState          The multi needle scan state.
+ * @param   poffHit         Where to return the offset of the held back match
+ *                          relative to the page following the last scanned one
+ *                          (i.e. negative).
+ * @param   piNeedle        Where to return the index of the matching needle.
+ */
+static bool pgmR3DbgScanMultiEnd(PPGMR3DBGSCANMULTI pState, int32_t *poffHit, uint32_t *piNeedle)
+{
+    pState->cbCarry = 0;
+    if (!pState->fHeldBack)
+        return false;
+    pState->fHeldBack = false;
+    *poffHit  = (int32_t)pState->offHeldBack - PAGE_SIZE;
+    *piNeedle = pState->iHeldBack;
+    return true;
+}
+
+
+/**
+ * Scans a page for any of a set of byte strings, keeping track of potential
+ * cross page matches.
+ *
+ * @returns true and *poffHit + *piNeedle on match, false on mismatch.
+ * @param   pState          The multi needle scan state.  The carried over
+ *                          bytes are consumed and updated.
+ * @param   pbPage          Pointer to the current page.
+ * @param   offPage         The offset into the page to start at (aligned).
+ *                          Must be zero if there are bytes carried over.
+ * @param   cb              The number of bytes to search, starting at @a offPage.
+ * @param   poffHit         Where to return the page offset of the match.  This
+ *                          is negative for matches starting in the previous page.
+ * @param   piNeedle        Where to return the index of the matching needle.
+ */
+static bool pgmR3DbgScanPageMulti(PPGMR3DBGSCANMULTI pState, const uint8_t *pbPage, uint32_t offPage, uint32_t cb,
+                                  int32_t *poffHit, uint32_t *piNeedle)
+{
+    uint32_t const uAlign = pState->uAlign;
+    uint32_t const offEnd = offPage + cb;
+    Assert(offEnd <= PAGE_SIZE);
+
+    /*
+     * Try the matches starting in the bytes carried over from the previous
+     * page.  Any match here crosses the page boundrary, as the rest would
+     * have been found when scanning the previous page, except for a match
+     * held back there, which is found here at the latest.
+     */
+    uint32_t const cbCarry = pState->cbCarry;
+    if (cbCarry)
+    {
+        Assert(!offPage);
+        uint32_t const cbHead = RT_MIN(pState->cbMaxNeedle - 1, offEnd);
+        memcpy(&pState->abCarry[cbCarry], pbPage, cbHead);
+        for (uint32_t i = 0; i < cbCarry; i++)
+            if (   !((PAGE_SIZE - cbCarry + i) & (uAlign - 1))
+                && pgmR3DbgScanMultiMatch(pState, &pState->abCarry[i], cbCarry + cbHead - i, piNeedle))
+            {
+                pState->fHeldBack = false;
+                *poffHit = -(int32_t)(cbCarry - i);
+                return true;
+            }
+        Assert(!pState->fHeldBack);
+        pState->fHeldBack = false;
+        pState->cbCarry   = 0;
+    }
+
+    /*
+     * Match the body of the page, looking for the first bytes.
+     */
+#ifdef RT_ARCH_AMD64
+    if (   pState->cFirstBytes <= MAX_SIMD_FIRST_BYTES
+        && uAlign <= 16)
+    {
+        /* Compare 16 bytes at a time against all the first bytes.  Unused
+           comparands duplicate the first one. */
+        uint8_t const *pab = pState->abFirstBytes;
+        uint8_t const  c   = pState->cFirstBytes;
+        __m128i const uFirst0 = _mm_set1_epi8((char)pab[0]);
+        __m128i const uFirst1 = _mm_set1_epi8((char)pab[c > 1 ? 1 : 0]);
+        __m128i const uFirst2 = _mm_set1_epi8((char)pab[c > 2 ? 2 : 0]);
+        __m128i const uFirst3 = _mm_set1_epi8((char)pab[c > 3 ? 3 : 0]);
+
+        /* Only the aligned positions are of interest. */
+        uint32_t const fAlignMask = uAlign == 1 ? 0xffff
+                                  : uAlign == 2 ? 0x5555
+                                  : uAlign == 4 ? 0x1111
+                                  : uAlign == 8 ? 0x0101 : 0x0001;
+        uint32_t off   = offPage & ~(uint32_t)15;
+        uint32_t fMask = (UINT32_C(0xffff) << (offPage & 15)) & fAlignMask;
+        for (; off < offEnd; off += 16, fMask = fAlignMask)
+        {
+            __m128i const uBytes = _mm_loadu_si128((__m128i const *)&pbPage[off]);
+            __m128i const uEq    = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(uBytes, uFirst0), _mm_cmpeq_epi8(uBytes, uFirst1)),
+                                                _mm_or_si128(_mm_cmpeq_epi8(uBytes, uFirst2), _mm_cmpeq_epi8(uBytes, uFirst3)));
+            uint32_t fHits = (uint32_t)_mm_movemask_epi8(uEq) & fMask;
+            if (offEnd - off < 16)
+                fHits &= RT_BIT_32(offEnd - off) - 1;
+            while (fHits)
+            {
+                uint32_t const offHit = off + ASMBitFirstSetU32(fHits) - 1;
+                fHits &= fHits - 1;
+                if (pgmR3DbgScanMultiMatch(pState, &pbPage[offHit], offEnd - offHit, piNeedle))
+                {
+                    if (pgmR3DbgScanMultiHoldBack(pState, pbPage, offPage, cb, offHit, *piNeedle))
+                        return false;
+                    *poffHit = (int32_t)offHit;
+                    return true;
+                }
+            }
+        }
+    }
+    else
+#endif
+    if (pState->cFirstBytes == 1)
+    {
+        const uint8_t *pb = pbPage + offPage;
+        while ((pb = pgmR3DbgAlignedMemChr(pb, pState->abFirstBytes[0], pbPage + offEnd - pb, uAlign)) != NULL)
+        {
+            if (pgmR3DbgScanMultiMatch(pState, pb, pbPage + offEnd - pb, piNeedle))
+            {
+                if (pgmR3DbgScanMultiHoldBack(pState, pbPage, offPage, cb, (uint32_t)(pb - pbPage), *piNeedle))
+                    return false;
+                *poffHit = (int32_t)(pb - pbPage);
+                return true;
+            }
+            if ((size_t)(pbPage + offEnd - pb) <= uAlign)
+                break;
+            pb += uAlign;
+        }
+    }
+    else
+    {
+        for (uint32_t off = offPage; off < offEnd; off += uAlign)
+            if (   pState->aiFirstNeedle[pbPage[off]] != UINT8_MAX
+                && pgmR3DbgScanMultiMatch(pState, &pbPage[off], offEnd - off, piNeedle))
+            {
+                if (pgmR3DbgScanMultiHoldBack(pState, pbPage, offPage, cb, off, *piNeedle))
+                    return false;
+                *poffHit = (int32_t)off;
+                return true;
+            }
+    }
+
+    pgmR3DbgScanMultiCarry(pState, pbPage, offEnd, cb);
+    return false;
+}
+
+
 
 /**
  * Scans guest physical memory for a byte string.
@@ -780,6 +1129,227 @@ VMMR3_INT_DECL(int) PGMR3DbgScanPhysical(PVM pVM, RTGCPHYS GCPhys, RTGCPHYS cbRa
 }
 
 
+/**
+ * Scans guest physical memory for any of a set of byte strings.
+ *
+ * This is a lot cheaper than calling PGMR3DbgScanPhysical for each of them as
+ * the memory is only walked once.
+ *
+ * @returns VBox status codes:
+ * @retval  VINF_SUCCESS and *pGCPhysHit + *piNeedle on success.
+ * @retval  VERR_DBGF_MEM_NOT_FOUND if not found.
+ * @retval  VERR_INVALID_POINTER if any of the pointer arguments are invalid.
+ * @retval  VERR_INVALID_ARGUMENT if any other arguments are invalid.
+ *
+ * @param   pVM             The cross context VM structure.
+ * @param   GCPhys          Where to start searching.
+ * @param   cbRange         The number of bytes to search.
+ * @param   GCPhysAlign     The alignment of the needles. Must be a power of two
+ *                          and less or equal to 4GB.
+ * @param   paNeedles       The byte strings to search for.  Max 256 bytes each.
+ * @param   cNeedles        The number of needles. Max 64.
+ * @param   pGCPhysHit      Where to store the address of the first occurrence
+ *                          of any of the needles on success.
+ * @param   piNeedle        Where to store the index of the needle found.  If
+ *                          several match at the same address, the first one
+ *                          in @a paNeedles is returned.
+ */
+VMMR3_INT_DECL(int) PGMR3DbgScanPhysicalMulti(PVM pVM, RTGCPHYS GCPhys, RTGCPHYS cbRange, RTGCPHYS GCPhysAlign,
+                                              PCDBGFMEMSCANNEEDLE paNeedles, uint32_t cNeedles,
+                                              PRTGCPHYS pGCPhysHit, uint32_t *piNeedle)
+{
+    /*
+     * Validate and adjust the input a bit.
+     */
+    if (!VALID_PTR(pGCPhysHit) || !VALID_PTR(piNeedle))
+        return VERR_INVALID_POINTER;
+    *pGCPhysHit = NIL_RTGCPHYS;
+    *piNeedle   = UINT32_MAX;
+
+    if (GCPhys == NIL_RTGCPHYS)
+        return VERR_INVALID_POINTER;
+    if (!GCPhysAlign)
+        return VERR_INVALID_PARAMETER;
+    if (GCPhysAlign > UINT32_MAX)
+        return VERR_NOT_POWER_OF_TWO;
+    if (GCPhysAlign & (GCPhysAlign - 1))
+        return VERR_INVALID_PARAMETER;
+
+    PGMR3DBGSCANMULTI State;
+    int rc = pgmR3DbgScanMultiInit(&State, paNeedles, cNeedles, (uint32_t)GCPhysAlign);
+    if (RT_FAILURE(rc))
+        return rc;
+
+    if (!cbRange)
+        return VERR_DBGF_MEM_NOT_FOUND;
+
+    if (GCPhys & (GCPhysAlign - 1))
+    {
+        RTGCPHYS Adj = GCPhysAlign - (GCPhys & (GCPhysAlign - 1));
+        if (    cbRange <= Adj
+            ||  GCPhys + Adj < GCPhys)
+            return VERR_DBGF_MEM_NOT_FOUND;
+        GCPhys  += Adj;
+        cbRange -= Adj;
+    }
+
+    const uint32_t  cIncPages  = GCPhysAlign <= PAGE_SIZE
+                               ? 1
+                               : GCPhysAlign >> PAGE_SHIFT;
+    const RTGCPHYS  GCPhysLast = GCPhys + cbRange - 1 >= GCPhys
+                               ? GCPhys + cbRange - 1
+                               : ~(RTGCPHYS)0;
+
+    /*
+     * Search the memory - ignore MMIO and zero pages, also don't
+     * bother to match across ranges.
+     */
+    pgmLock(pVM);
+    for (PPGMRAMRANGE pRam = pVM->pgm.s.CTX_SUFF(pRamRangesX);
+         pRam;
+         pRam = pRam->CTX_SUFF(pNext))
+    {
+        /*
+         * If the search range starts prior to the current ram range record,
+         * adjust the search range and possibly conclude the search.
+         */
+        RTGCPHYS off;
+        if (GCPhys < pRam->GCPhys)
+        {
+            if (GCPhysLast < pRam->GCPhys)
+                break;
+            GCPhys = pRam->GCPhys;
+            off = 0;
+        }
+        else
+            off = GCPhys - pRam->GCPhys;
+        if (off < pRam->cb)
+        {
+            /*
+             * Iterate the relevant pages.
+             */
+            const uint32_t  cPages   = pRam->cb >> PAGE_SHIFT;
+            uint32_t        iPage    = off >> PAGE_SHIFT;
+            uint32_t        offPage  = GCPhys & PAGE_OFFSET_MASK;
+            GCPhys &= ~(RTGCPHYS)PAGE_OFFSET_MASK;
+            State.cbCarry = 0;
+            for (;; offPage = 0)
+            {
+                PPGMPAGE pPage  = &pRam->aPages[iPage];
+                int32_t  offHit = 0;
+                bool     fRc;
+                if (   (   !PGM_PAGE_IS_ZERO(pPage)
+                        || State.fAllZero)
+                    && !PGM_PAGE_IS_MMIO_OR_ALIAS(pPage)
+                    && !PGM_PAGE_IS_BALLOONED(pPage))
+                {
+                    void const     *pvPage;
+                    PGMPAGEMAPLOCK  Lock;
+                    rc = PGMPhysGCPhys2CCPtrReadOnly(pVM, GCPhys, &pvPage, &Lock);
+                    if (RT_SUCCESS(rc))
+                    {
+                        uint32_t cbSearch = (GCPhys ^ GCPhysLast) & ~(RTGCPHYS)PAGE_OFFSET_MASK
+                                          ? PAGE_SIZE                           - offPage
+                                          : (GCPhysLast & PAGE_OFFSET_MASK) + 1 - offPage;
+                        fRc = pgmR3DbgScanPageMulti(&State, (uint8_t const *)pvPage, offPage, cbSearch, &offHit, piNeedle);
+                        PGMPhysReleasePageMappingLock(pVM, &Lock);
+                    }
+                    else
+                        fRc = pgmR3DbgScanMultiEnd(&State, &offHit, piNeedle); /* ignore error. */
+                }
+                else
+                    fRc = pgmR3DbgScanMultiEnd(&State, &offHit, piNeedle);
+                if (fRc)
+                {
+                    *pGCPhysHit = GCPhys + offHit;
+                    pgmUnlock(pVM);
+                    return VINF_SUCCESS;
+                }
+
+                /* advance to the next page. */
+                GCPhys += (RTGCPHYS)cIncPages << PAGE_SHIFT;
+                iPage  += cIncPages;
+                if (   GCPhys >= GCPhysLast /* (may not always hit, but we're run out of ranges.) */
+                    || iPage < cIncPages
+                    || iPage >= cPages)
+                {
+                    /* The next page isn't scanned with the carried over bytes. */
+                    if (pgmR3DbgScanMultiEnd(&State, &offHit, piNeedle))
+                    {
+                        *pGCPhysHit = GCPhys + offHit;
+                        pgmUnlock(pVM);
+                        return VINF_SUCCESS;
+                    }
+                    if (GCPhys >= GCPhysLast)
+                    {
+                        pgmUnlock(pVM);
+                        return VERR_DBGF_MEM_NOT_FOUND;
+                    }
+                    break;
+                }
+            }
+        }
+    }
+    pgmUnlock(pVM);
+    return VERR_DBGF_MEM_NOT_FOUND;
+}
+
+
+/**
+ * Works out how many pages a scan can skip after a failed guest page table
+ * walk.
+ *
+ * @returns Number of pages to skip.
+ * @param   pWalk           The failed walk.
+ * @param   GCPtr           The page address the walk failed for.
+ * @param   cPages          The number of pages left to scan.
+ */
+static uint64_t pgmR3DbgScanVirtualCalcSkip(PCPGMPTWALKGST pWalk, RTGCPTR GCPtr, RTGCPTR cPages)
+{
+    uint64_t cPagesCanSkip;
+    switch (pWalk->u.Core.uLevel)
+    {
+        case 1:
+            /* page level, use cIncPages */
+            cPagesCanSkip = 1;
+            break;
+        case 2:
+            if (pWalk->enmType == PGMPTWALKGSTTYPE_32BIT)
+            {
+                cPagesCanSkip = X86_PG_ENTRIES     - ((GCPtr >> X86_PT_SHIFT)     & X86_PT_MASK);
+                Assert(!((GCPtr + ((RTGCPTR)cPagesCanSkip << X86_PT_PAE_SHIFT)) & (RT_BIT_64(X86_PD_SHIFT) - 1)));
+            }
+            else
+            {
+                cPagesCanSkip = X86_PG_PAE_ENTRIES - ((GCPtr >> X86_PT_PAE_SHIFT) & X86_PT_PAE_MASK);
+                Assert(!((GCPtr + ((RTGCPTR)cPagesCanSkip << X86_PT_PAE_SHIFT)) & (RT_BIT_64(X86_PD_PAE_SHIFT) - 1)));
+            }
+            break;
+        case 3:
+            cPagesCanSkip = (X86_PG_PAE_ENTRIES - ((GCPtr >> X86_PD_PAE_SHIFT) & X86_PD_PAE_MASK)) * X86_PG_PAE_ENTRIES
+                          - ((GCPtr >> X86_PT_PAE_SHIFT) & X86_PT_PAE_MASK);
+            Assert(!((GCPtr + ((RTGCPTR)cPagesCanSkip << X86_PT_PAE_SHIFT)) & (RT_BIT_64(X86_PDPT_SHIFT) - 1)));
+            break;
+        case 4:
+            cPagesCanSkip =   (X86_PG_PAE_ENTRIES  - ((GCPtr >> X86_PDPT_SHIFT) & X86_PDPT_MASK_AMD64))
+                            * X86_PG_PAE_ENTRIES * X86_PG_PAE_ENTRIES
+                          - ((((GCPtr >> X86_PD_PAE_SHIFT) & X86_PD_PAE_MASK)) * X86_PG_PAE_ENTRIES)
+                          - ((  GCPtr >> X86_PT_PAE_SHIFT) & X86_PT_PAE_MASK);
+            Assert(!((GCPtr + ((RTGCPTR)cPagesCanSkip << X86_PT_PAE_SHIFT)) & (RT_BIT_64(X86_PML4_SHIFT) - 1)));
+            break;
+        case 8:
+            /* The CR3 value is bad, forget the whole search. */
+            cPagesCanSkip = cPages;
+            break;
+        default:
+            AssertMsgFailed(("%d\n", pWalk->u.Core.uLevel));
+            cPagesCanSkip = 0;
+            break;
+    }
+    return cPagesCanSkip;
+}
+
+
 /**
  * Scans (guest) virtual memory for a byte string.
  *
@@ -923,46 +1493,7 @@ VMMR3_INT_DECL(int) PGMR3DbgScanVirtual(PVM pVM, PVMCPU pVCpu, RTGCPTR GCPtr, RT
              * Try skip as much as possible. No need to figure out that a PDE
              * is not present 512 times!
              */
-            uint64_t cPagesCanSkip;
-            switch (Walk.u.Core.uLevel)
-            {
-                case 1:
-                    /* page level, use cIncPages */
-                    cPagesCanSkip = 1;
-                    break;
-                case 2:
-                    if (Walk.enmType == PGMPTWALKGSTTYPE_32BIT)
-                    {
-                        cPagesCanSkip = X86_PG_ENTRIES     - ((GCPtr >> X86_PT_SHIFT)     & X86_PT_MASK);
-                        Assert(!((GCPtr + ((RTGCPTR)cPagesCanSkip << X86_PT_PAE_SHIFT)) & (RT_BIT_64(X86_PD_SHIFT) - 1)));
-                    }
-                    else
-                    {
-                        cPagesCanSkip = X86_PG_PAE_ENTRIES - ((GCPtr >> X86_PT_PAE_SHIFT) & X86_PT_PAE_MASK);
-                        Assert(!((GCPtr + ((RTGCPTR)cPagesCanSkip << X86_PT_PAE_SHIFT)) & (RT_BIT_64(X86_PD_PAE_SHIFT) - 1)));
-                    }
-                    break;
-                case 3:
-                    cPagesCanSkip = (X86_PG_PAE_ENTRIES - ((GCPtr >> X86_PD_PAE_SHIFT) & X86_PD_PAE_MASK)) * X86_PG_PAE_ENTRIES
-                                  - ((GCPtr >> X86_PT_PAE_SHIFT) & X86_PT_PAE_MASK);
-                    Assert(!((GCPtr + ((RTGCPTR)cPagesCanSkip << X86_PT_PAE_SHIFT)) & (RT_BIT_64(X86_PDPT_SHIFT) - 1)));
-                    break;
-                case 4:
-                    cPagesCanSkip =   (X86_PG_PAE_ENTRIES  - ((GCPtr >> X86_PDPT_SHIFT) & X86_PDPT_MASK_AMD64))
-                                    * X86_PG_PAE_ENTRIES * X86_PG_PAE_ENTRIES
-                                  - ((((GCPtr >> X86_PD_PAE_SHIFT) & X86_PD_PAE_MASK)) * X86_PG_PAE_ENTRIES)
-                                  - ((  GCPtr >> X86_PT_PAE_SHIFT) & X86_PT_PAE_MASK);
-                    Assert(!((GCPtr + ((RTGCPTR)cPagesCanSkip << X86_PT_PAE_SHIFT)) & (RT_BIT_64(X86_PML4_SHIFT) - 1)));
-                    break;
-                case 8:
-                    /* The CR3 value is bad, forget the whole search. */
-                    cPagesCanSkip = cPages;
-                    break;
-                default:
-                    AssertMsgFailed(("%d\n", Walk.u.Core.uLevel));
-                    cPagesCanSkip = 0;
-                    break;
-            }
+            uint64_t cPagesCanSkip = pgmR3DbgScanVirtualCalcSkip(&Walk, GCPtr, cPages);
             if (cPages <= cPagesCanSkip)
                 break;
             if (cPagesCanSkip >= cIncPages)
@@ -991,6 +1522,181 @@ VMMR3_INT_DECL(int) PGMR3DbgScanVirtual(PVM pVM, PVMCPU pVCpu, RTGCPTR GCPtr, RT
 }
 
 
+/**
+ * Scans (guest) virtual memory for any of a set of byte strings.
+ *
+ * This is a lot cheaper than calling PGMR3DbgScanVirtual for each of them as
+ * the page tables are only walked once.
+ *
+ * @returns VBox status codes:
+ * @retval  VINF_SUCCESS and *pGCPtrHit + *piNeedle on success.
+ * @retval  VERR_DBGF_MEM_NOT_FOUND if not found.
+ * @retval  VERR_INVALID_POINTER if any of the pointer arguments are invalid.
+ * @retval  VERR_INVALID_ARGUMENT if any other arguments are invalid.
+ *
+ * @param   pVM             The cross context VM structure.
+ * @param   pVCpu           The cross context virtual CPU structure of the CPU
+ *                          context to search from.
+ * @param   GCPtr           Where to start searching.
+ * @param   cbRange         The number of bytes to search.
+ * @param   GCPtrAlign      The alignment of the needles. Must be a power of two
+ *                          and less or equal to 4GB.
+ * @param   paNeedles       The byte strings to search for.  Max 256 bytes each.
+ * @param   cNeedles        The number of needles. Max 64.
+ * @param   pGCPtrHit       Where to store the address of the first occurrence
+ *                          of any of the needles on success.
+ * @param   piNeedle        Where to store the index of the needle found.  If
+ *                          several match at the same address, the first one
+ *                          in @a paNeedles is returned.
+ */
+VMMR3_INT_DECL(int) PGMR3DbgScanVirtualMulti(PVM pVM, PVMCPU pVCpu, RTGCPTR GCPtr, RTGCPTR cbRange, RTGCPTR GCPtrAlign,
+                                             PCDBGFMEMSCANNEEDLE paNeedles, uint32_t cNeedles,
+                                             PRTGCUINTPTR pGCPtrHit, uint32_t *piNeedle)
+{
+    VMCPU_ASSERT_EMT(pVCpu);
+
+    /*
+     * Validate and adjust the input a bit.
+     */
+    if (!VALID_PTR(pGCPtrHit) || !VALID_PTR(piNeedle))
+        return VERR_INVALID_POINTER;
+    *pGCPtrHit = 0;
+    *piNeedle  = UINT32_MAX;
+
+    if (!GCPtrAlign)
+        return VERR_INVALID_PARAMETER;
+    if (GCPtrAlign > UINT32_MAX)
+        return VERR_NOT_POWER_OF_TWO;
+    if (GCPtrAlign & (GCPtrAlign - 1))
+        return VERR_INVALID_PARAMETER;
+
+    PGMR3DBGSCANMULTI State;
+    int rc = pgmR3DbgScanMultiInit(&State, paNeedles, cNeedles, (uint32_t)GCPtrAlign);
+    if (RT_FAILURE(rc))
+        return rc;
+
+    if (!cbRange)
+        return VERR_DBGF_MEM_NOT_FOUND;
+
+    if (GCPtr & (GCPtrAlign - 1))
+    {
+        RTGCPTR Adj = GCPtrAlign - (GCPtr & (GCPtrAlign - 1));
+        if (    cbRange <= Adj
+            ||  GCPtr + Adj < GCPtr)
+            return VERR_DBGF_MEM_NOT_FOUND;
+        GCPtr   += Adj;
+        cbRange -= Adj;
+    }
+
+    /* Only paged protected mode or long mode here, use the physical scan for
+       the other modes. */
+    PGMMODE enmMode   = PGMGetGuestMode(pVCpu);
+    AssertReturn(PGMMODE_WITH_PAGING(enmMode), VERR_PGM_NOT_USED_IN_MODE);
+
+    /*
+     * Search the memory - ignore MMIO, zero and not-present pages.
+     */
+    RTGCPTR         GCPtrMask = PGMMODE_IS_LONG_MODE(enmMode) ? UINT64_MAX : UINT32_MAX;
+    const uint32_t  cIncPages = GCPtrAlign <= PAGE_SIZE
+                              ? 1
+                              : GCPtrAlign >> PAGE_SHIFT;
+    const RTGCPTR   GCPtrLast = GCPtr + cbRange - 1 >= GCPtr
+                              ? (GCPtr + cbRange - 1) & GCPtrMask
+                              : GCPtrMask;
+    RTGCPTR         cPages    = (((GCPtrLast - GCPtr) + (GCPtr & PAGE_OFFSET_MASK)) >> PAGE_SHIFT) + 1;
+    uint32_t        offPage   = GCPtr & PAGE_OFFSET_MASK;
+    GCPtr &= ~(RTGCPTR)PAGE_OFFSET_MASK;
+
+    uint32_t        cYieldCountDown = 4096;
+    pgmLock(pVM);
+    for (;; offPage = 0)
+    {
+        int32_t offHit = 0;
+        bool    fRc    = false;
+        PGMPTWALKGST Walk;
+        rc = pgmGstPtWalk(pVCpu, GCPtr, &Walk);
+        if (RT_SUCCESS(rc) && Walk.u.Core.fSucceeded)
+        {
+            PPGMPAGE pPage = pgmPhysGetPage(pVM, Walk.u.Core.GCPhys);
+            if (   pPage
+                && (   !PGM_PAGE_IS_ZERO(pPage)
+                    || State.fAllZero)
+                && !PGM_PAGE_IS_MMIO_OR_ALIAS(pPage)
+                && !PGM_PAGE_IS_BALLOONED(pPage))
+            {
+                void const *pvPage;
+                PGMPAGEMAPLOCK Lock;
+                rc = PGMPhysGCPhys2CCPtrReadOnly(pVM, Walk.u.Core.GCPhys, &pvPage, &Lock);
+                if (RT_SUCCESS(rc))
+                {
+                    uint32_t cbSearch = cPages > 1
+                                      ? PAGE_SIZE                          - offPage
+                                      : (GCPtrLast & PAGE_OFFSET_MASK) + 1 - offPage;
+                    fRc = pgmR3DbgScanPageMulti(&State, (uint8_t const *)pvPage, offPage, cbSearch, &offHit, piNeedle);
+                    PGMPhysReleasePageMappingLock(pVM, &Lock);
+                }
+                else
+                    fRc = pgmR3DbgScanMultiEnd(&State, &offHit, piNeedle); /* ignore error. */
+            }
+            else
+                fRc = pgmR3DbgScanMultiEnd(&State, &offHit, piNeedle);
+        }
+        else
+        {
+            Assert(Walk.enmType != PGMPTWALKGSTTYPE_INVALID);
+            Assert(!Walk.u.Core.fSucceeded);
+            fRc = pgmR3DbgScanMultiEnd(&State, &offHit, piNeedle); /* ignore error. */
+            if (!fRc)
+            {
+                /*
+                 * Try skip as much as possible. No need to figure out that a PDE
+                 * is not present 512 times!
+                 */
+                uint64_t cPagesCanSkip = pgmR3DbgScanVirtualCalcSkip(&Walk, GCPtr, cPages);
+                if (cPages <= cPagesCanSkip)
+                    break;
+                if (cPagesCanSkip >= cIncPages)
+                {
+                    cPages -= cPagesCanSkip;
+                    GCPtr += (RTGCPTR)cPagesCanSkip << X86_PT_PAE_SHIFT;
+                    continue;
+                }
+            }
+        }
+        if (fRc)
+        {
+            *pGCPtrHit = (GCPtr + offHit) & GCPtrMask;
+            pgmUnlock(pVM);
+            return VINF_SUCCESS;
+        }
+
+        /* advance to the next page. */
+        if (cPages <= cIncPages)
+        {
+            /* Return a match held back for a needle running past the end of the range. */
+            if (pgmR3DbgScanMultiEnd(&State, &offHit, piNeedle))
+            {
+                *pGCPtrHit = (GCPtr + PAGE_SIZE + offHit) & GCPtrMask;
+                pgmUnlock(pVM);
+                return VINF_SUCCESS;
+            }
+            break;
+        }
+        cPages -= cIncPages;
+        GCPtr += (RTGCPTR)cIncPages << X86_PT_PAE_SHIFT;
+
+        /* Yield the PGM lock every now and then. */
+        if (!--cYieldCountDown)
+        {
+            PDMR3CritSectYield(&pVM->pgm.s.CritSectX);
+            cYieldCountDown = 4096;
+        }
+    }
+    pgmUnlock(pVM);
+    return VERR_DBGF_MEM_NOT_FOUND;
+}
+
+
 /**
  * Initializes the dumper state.
  *
@@ -1356,6 +1356,41 @@ VMMR3DECL(int) PGMR3PhysGetRange(PVM pVM, uint32_t iRange, PRTGCPHYS pGCPhysStar
 }
 
 
+/**
+ * Checks which pages in a run of guest physical memory are known to read as
+ * zeros without having to look at their content, i.e. pages that have not been
+ * allocated yet and ballooned pages.
+ *
+ * @returns VBox status code.
+ * @param   pVM             The cross context VM structure.
+ * @param   GCPhys          The address of the first page.
+ * @param   cPages          The number of pages to check.
+ * @param   pvBitmap        Where to return the result, one bit per page.  The
+ *                          bit is set for pages known to be zero and clear
+ *                          for all others, including invalid addresses.
+ */
+VMMR3_INT_DECL(int) PGMR3PhysQueryZeroPages(PVM pVM, RTGCPHYS GCPhys, uint32_t cPages, void *pvBitmap)
+{
+    VM_ASSERT_VALID_EXT_RETURN(pVM, VERR_INVALID_VM_HANDLE);
+    AssertReturn(!(GCPhys & PAGE_OFFSET_MASK), VERR_INVALID_PARAMETER);
+    AssertPtrReturn(pvBitmap, VERR_INVALID_POINTER);
+
+    pgmLock(pVM);
+    for (uint32_t iPage = 0; iPage < cPages; iPage++)
+    {
+        PPGMPAGE pPage = pgmPhysGetPage(pVM, GCPhys + ((RTGCPHYS)iPage << PAGE_SHIFT));
+        if (   pPage
+            && (   PGM_PAGE_IS_ZERO(pPage)
+                || PGM_PAGE_IS_BALLOONED(pPage)))
+            ASMBitSet(pvBitmap, iPage);
+        else
+            ASMBitClear(pvBitmap, iPage);
+    }
+    pgmUnlock(pVM);
+    return VINF_SUCCESS;
+}
+
+
 /**
  * Query the amount of free memory inside VMMR0
  *
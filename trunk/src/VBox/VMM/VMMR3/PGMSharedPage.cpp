@@ -21,7 +21,9 @@
 *********************************************************************************************************************************/
 #define LOG_GROUP LOG_GROUP_PGM_SHARED
 #include <VBox/vmm/pgm.h>
+#include <VBox/vmm/cfgm.h>
 #include <VBox/vmm/stam.h>
+#include <VBox/vmm/tm.h>
 #include <VBox/vmm/uvm.h>
 #include "PGMInternal.h"
 #include <VBox/vmm/vm.h>
@@ -272,6 +274,214 @@ VMMR3DECL(int) PGMR3SharedModuleCheckAll(PVM pVM)
 }
 
 
+/**
+ * Rendezvous callback for scanning the next batch of guest pages for content
+ * that can be shared.
+ *
+ * @returns VBox strict status code.
+ * @param   pVM                 The cross context VM structure.
+ * @param   pVCpu               The cross context virtual CPU structure of the calling EMT.
+ * @param   pvUser              Not used.
+ */
+static DECLCALLBACK(VBOXSTRICTRC) pgmR3DedupScanRendezvous(PVM pVM, PVMCPU pVCpu, void *pvUser)
+{
+    RT_NOREF(pVCpu, pvUser);
+
+    /* Stay out of the way of live saving (see fPhysWriteMonitoringEngaged). */
+    if (pVM->pgm.s.fPhysWriteMonitoringEngaged)
+        return VINF_SUCCESS;
+
+    /* Flush all pending handy page operations before changing any shared page assignments. */
+    int rc = PGMR3PhysAllocateHandyPages(pVM);
+    AssertRC(rc);
+
+    pgmLock(pVM);
+    pgmR3PhysAssertSharedPageChecksums(pVM);
+
+    PGMMDEDUPSCANREQ pReq       = pVM->pgm.s.pDedupReqR3;
+    RTGCPHYS         GCPhys     = pVM->pgm.s.GCPhysDedupNext;
+    uint32_t         cPagesLeft = pVM->pgm.s.cDedupPagesPerScan;
+    bool             fWrapped   = false;
+    rc = VINF_SUCCESS;
+    while (cPagesLeft > 0)
+    {
+        /*
+         * Find the RAM range containing or following the current position,
+         * skipping MMIO2 and ad hoc ranges.  Wrap around once at the end.
+         */
+        PPGMRAMRANGE pRam;
+        for (pRam = pVM->pgm.s.pRamRangesXR3; pRam; pRam = pRam->pNextR3)
+            if (   GCPhys <= pRam->GCPhysLast
+                && !pRam->pvR3
+                && !PGM_RAM_RANGE_IS_AD_HOC(pRam))
+                break;
+        if (!pRam)
+        {
+            if (fWrapped)
+                break;
+            fWrapped = true;
+            GCPhys   = 0;
+            continue;
+        }
+        if (GCPhys < pRam->GCPhys)
+            GCPhys = pRam->GCPhys;
+
+        /*
+         * Look up the hash array of the range, allocating it on first use.
+         */
+        PPGMDEDUPRANGE pDedupRange = pVM->pgm.s.pDedupRangesR3;
+        while (   pDedupRange
+               && (   pDedupRange->GCPhys     != pRam->GCPhys
+                   || pDedupRange->GCPhysLast != pRam->GCPhysLast))
+            pDedupRange = pDedupRange->pNext;
+        if (!pDedupRange)
+        {
+            uint32_t const cRangePages = (uint32_t)((pRam->GCPhysLast - pRam->GCPhys) >> PAGE_SHIFT) + 1;
+            pDedupRange = (PPGMDEDUPRANGE)RTMemAllocZ(RT_OFFSETOF(PGMDEDUPRANGE, auHashes[cRangePages]));
+            if (!pDedupRange)
+            {
+                rc = VERR_NO_MEMORY;
+                break;
+            }
+            pDedupRange->GCPhys         = pRam->GCPhys;
+            pDedupRange->GCPhysLast     = pRam->GCPhysLast;
+            pDedupRange->pNext          = pVM->pgm.s.pDedupRangesR3;
+            pVM->pgm.s.pDedupRangesR3   = pDedupRange;
+        }
+
+        /*
+         * Let ring-0 do the hashing and sharing for a batch of pages.
+         */
+        uint32_t cPages = RT_MIN(cPagesLeft, GMM_DEDUP_SCAN_MAX_PAGES);
+        cPages = (uint32_t)RT_MIN((RTGCPHYS)cPages, ((pRam->GCPhysLast - GCPhys) >> PAGE_SHIFT) + 1);
+        uint32_t *pauHashes = &pDedupRange->auHashes[(GCPhys - pRam->GCPhys) >> PAGE_SHIFT];
+
+        pReq->GCPhysFirst = GCPhys;
+        pReq->cPages      = cPages;
+        memcpy(&pReq->auHashes[0], pauHashes, cPages * sizeof(uint32_t));
+        rc = GMMR3DedupScanPages(pVM, pReq);
+        if (RT_FAILURE(rc))
+            break;
+        memcpy(pauHashes, &pReq->auHashes[0], cPages * sizeof(uint32_t));
+
+        STAM_REL_COUNTER_ADD(&pVM->pgm.s.StatDedupScannedPages,   cPages);
+        STAM_REL_COUNTER_ADD(&pVM->pgm.s.StatDedupStablePages,    pReq->cStablePages);
+        STAM_REL_COUNTER_ADD(&pVM->pgm.s.StatDedupNewSharedPages, pReq->cNewSharedPages);
+        STAM_REL_COUNTER_ADD(&pVM->pgm.s.StatDedupMergedPages,    pReq->cMergedPages);
+
+        GCPhys     += (RTGCPHYS)cPages << PAGE_SHIFT;
+        cPagesLeft -= cPages;
+    }
+    pVM->pgm.s.GCPhysDedupNext = GCPhys;
+
+    pgmR3PhysAssertSharedPageChecksums(pVM);
+    pgmUnlock(pVM);
+
+    LogFlow(("pgmR3DedupScanRendezvous: done at %RGp (%d shared) rc=%Rrc\n", GCPhys, pVM->pgm.s.cSharedPages, rc));
+    return rc;
+}
+
+
+/**
+ * Deduplication scan helper (called on the way out).
+ *
+ * @param   pVM         The cross context VM structure.
+ */
+static DECLCALLBACK(void) pgmR3DedupScanHelper(PVM pVM)
+{
+    /* Stall the other VCPUs so we don't have to send IPI flush commands for every single change we make. */
+    STAM_REL_PROFILE_START(&pVM->pgm.s.StatDedupScan, a);
+    int rc = VMMR3EmtRendezvous(pVM, VMMEMTRENDEZVOUS_FLAGS_TYPE_ONCE, pgmR3DedupScanRendezvous, NULL);
+    STAM_REL_PROFILE_STOP(&pVM->pgm.s.StatDedupScan, a);
+    if (RT_FAILURE(rc))
+    {
+        LogRel(("PGM: Page deduplication failed (%Rrc), disabling it.\n", rc));
+        pVM->pgm.s.fDedupEnabled = false;
+        return;
+    }
+
+    TMTimerSetMillies(pVM->pgm.s.pDedupTimerR3, pVM->pgm.s.cMsDedupInterval);
+}
+
+
+/**
+ * @callback_method_impl{FNTMTIMERINT, Deduplication scan timer.}
+ */
+static DECLCALLBACK(void) pgmR3DedupTimer(PVM pVM, PTMTIMER pTimer, void *pvUser)
+{
+    RT_NOREF(pTimer, pvUser);
+
+    /* Queue the actual scan as we cannot rendezvous from the timer callback.
+       The timer is rearmed when the scan has completed. */
+    if (pVM->pgm.s.fDedupEnabled)
+    {
+        int rc = VMR3ReqCallNoWait(pVM, VMCPUID_ANY_QUEUE, (PFNRT)pgmR3DedupScanHelper, 1, pVM);
+        AssertLogRelRC(rc);
+    }
+}
+
+
+/**
+ * Initializes the content based page deduplication scanner.
+ *
+ * @returns VBox status code.
+ * @param   pVM                 The cross context VM structure.
+ */
+int pgmR3DedupInit(PVM pVM)
+{
+    PCFGMNODE pCfgDedup = CFGMR3GetChild(CFGMR3GetRoot(pVM), "PGM/Dedup");
+    int rc = CFGMR3QueryBoolDef(pCfgDedup, "Enabled", &pVM->pgm.s.fDedupEnabled, false);
+    AssertLogRelRCReturn(rc, rc);
+    rc = CFGMR3QueryU32Def(pCfgDedup, "PagesPerScan", &pVM->pgm.s.cDedupPagesPerScan, 1024);
+    AssertLogRelRCReturn(rc, rc);
+    rc = CFGMR3QueryU32Def(pCfgDedup, "IntervalMs", &pVM->pgm.s.cMsDedupInterval, 100);
+    AssertLogRelRCReturn(rc, rc);
+    if (   !pVM->pgm.s.fDedupEnabled
+        || !pVM->pgm.s.cDedupPagesPerScan)
+        return VINF_SUCCESS;
+    if (!pVM->pgm.s.fPageFusionAllowed)
+    {
+        LogRel(("PGM: Page deduplication requires page fusion to be allowed, ignoring.\n"));
+        pVM->pgm.s.fDedupEnabled = false;
+        return VINF_SUCCESS;
+    }
+    if (pVM->pgm.s.cMsDedupInterval < 1)
+        pVM->pgm.s.cMsDedupInterval = 1;
+
+    pVM->pgm.s.pDedupReqR3 = (PGMMDEDUPSCANREQ)RTMemAllocZ(RT_OFFSETOF(GMMDEDUPSCANREQ, auHashes[GMM_DEDUP_SCAN_MAX_PAGES]));
+    AssertReturn(pVM->pgm.s.pDedupReqR3, VERR_NO_MEMORY);
+
+    rc = TMR3TimerCreateInternal(pVM, TMCLOCK_VIRTUAL, pgmR3DedupTimer, NULL, "PGM Dedup", &pVM->pgm.s.pDedupTimerR3);
+    AssertRCReturn(rc, rc);
+    rc = TMTimerSetMillies(pVM->pgm.s.pDedupTimerR3, pVM->pgm.s.cMsDedupInterval);
+    AssertRCReturn(rc, rc);
+
+    LogRel(("PGM: Page deduplication enabled: %u pages every %u ms\n", pVM->pgm.s.cDedupPagesPerScan, pVM->pgm.s.cMsDedupInterval));
+    return VINF_SUCCESS;
+}
+
+
+/**
+ * Frees the resources of the content based page deduplication scanner.
+ *
+ * The timer is taken care of by TM.
+ *
+ * @param   pVM                 The cross context VM structure.
+ */
+void pgmR3DedupTerm(PVM pVM)
+{
+    pVM->pgm.s.fDedupEnabled = false;
+    while (pVM->pgm.s.pDedupRangesR3)
+    {
+        PPGMDEDUPRANGE pDedupRange = pVM->pgm.s.pDedupRangesR3;
+        pVM->pgm.s.pDedupRangesR3 = pDedupRange->pNext;
+        RTMemFree(pDedupRange);
+    }
+    RTMemFree(pVM->pgm.s.pDedupReqR3);
+    pVM->pgm.s.pDedupReqR3      = NULL;
+}
+
+
 # ifdef DEBUG
 /**
  * Query the state of a page in a shared module
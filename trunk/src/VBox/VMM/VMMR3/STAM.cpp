@@ -21,7 +21,9 @@
  * with a somewhat uniform way of accessing VMM statistics.  STAM sports a
  * couple of different APIs for accessing them: STAMR3EnumU, STAMR3SnapshotU,
  * STAMR3DumpU, STAMR3DumpToReleaseLogU and the debugger.  Main is exposing the
- * XML based one, STAMR3SnapshotU.
+ * XML based one, STAMR3SnapshotU.  For frequent polling of many samples there
+ * is also a compact binary format, see STAMR3BinSnapshotTake, which only
+ * transfers the changes since the previous poll.
  *
  * The rest of the VMM together with the devices and drivers registers their
  * statistics with STAM giving them a name.  The name is hierarchical, the
@@ -62,6 +64,7 @@
 #include <iprt/mem.h>
 #include <iprt/stream.h>
 #include <iprt/string.h>
+#include <iprt/time.h>
 
 
 /*********************************************************************************************************************************
@@ -70,6 +73,11 @@
 /** The maximum name length excluding the terminator. */
 #define STAM_MAX_NAME_LEN   239
 
+/** Magic value for STAMBINSNAP::u32Magic (Dorothy Parker). */
+#define STAMBINSNAP_HANDLE_MAGIC        UINT32_C(0x18930822)
+/** Magic value for STAMBINSNAP::u32Magic after destruction. */
+#define STAMBINSNAP_HANDLE_MAGIC_DEAD   UINT32_C(0x19670607)
+
 
 /*********************************************************************************************************************************
 *   Structures and Typedefs                                                                                                      *
@@ -119,6 +127,78 @@ typedef struct STAMR3SNAPSHOTONE
 } STAMR3SNAPSHOTONE, *PSTAMR3SNAPSHOTONE;
 
 
+/**
+ * Binary snapshot output buffer.
+ */
+typedef struct STAMBINSNAPBUF
+{
+    /** The buffer. */
+    uint8_t        *pb;
+    /** Bytes used. */
+    size_t          cb;
+    /** Bytes allocated. */
+    size_t          cbAlloc;
+} STAMBINSNAPBUF;
+/** Pointer to a binary snapshot output buffer. */
+typedef STAMBINSNAPBUF *PSTAMBINSNAPBUF;
+
+/**
+ * Binary snapshot context.
+ *
+ * The pattern is matched once and the resulting sample set cached until the
+ * registry generation changes, so polling only costs a copy of the values.
+ */
+typedef struct STAMBINSNAP
+{
+    /** Magic value (STAMBINSNAP_HANDLE_MAGIC). */
+    uint32_t        u32Magic;
+    /** The registry generation papDescs was resolved at. */
+    uint32_t        cGeneration;
+    /** Pointer to the user mode VM structure. */
+    PUVM            pUVM;
+    /** The pattern, NULL for all samples. */
+    char           *pszPat;
+    /** The pattern split into expressions (for the ring-0 update). */
+    char          **papszExpressions;
+    /** The copy papszExpressions points into. */
+    char           *pszExprCopy;
+    /** Number of expressions in papszExpressions. */
+    unsigned        cExpressions;
+    /** Whether papDescs is valid and the previous values in pauPrev. */
+    bool            fResolved;
+    /** Number of matching samples. */
+    uint32_t        cDescs;
+    /** Number of entries allocated for papDescs. */
+    uint32_t        cDescsAlloc;
+    /** The matching samples. */
+    PSTAMDESC      *papDescs;
+    /** The number of values each sample yields, 0 for callbacks.  This
+     * allows encoding without touching the descriptors. */
+    uint8_t        *pacValues;
+    /** Number of numeric values the samples yield. */
+    uint32_t        cValues;
+    /** Number of entries allocated for pauCur and pauPrev. */
+    uint32_t        cValuesAlloc;
+    /** The values of the current snapshot. */
+    uint64_t       *pauCur;
+    /** The values of the previous snapshot. */
+    uint64_t       *pauPrev;
+    /** Callback sample strings (zero terminated, back to back). */
+    char           *pszStrings;
+    /** Bytes used in pszStrings. */
+    size_t          cbStrings;
+    /** Bytes allocated for pszStrings. */
+    size_t          cbStringsAlloc;
+    /** The encoded sample definitions, built when resolving the sample set so
+     * no names need to be touched when taking a snapshot. */
+    STAMBINSNAPBUF  Defs;
+    /** The output buffer. */
+    STAMBINSNAPBUF  Out;
+    /** Status of buffer allocations. */
+    int             rc;
+} STAMBINSNAP;
+
+
 /**
  * Init record for a ring-0 statistic sample.
  */
@@ -243,6 +323,8 @@ static const STAMR0SAMPLE g_aGMMStats[] =
     { RT_UOFFSETOF(GMMSTATS, cChunks),                          STAMTYPE_U32,   STAMUNIT_COUNT, "/GMM/cChunks",                     "The number of allocation chunks." },
     { RT_UOFFSETOF(GMMSTATS, cFreedChunks),                     STAMTYPE_U32,   STAMUNIT_COUNT, "/GMM/cFreedChunks",                "The number of freed chunks ever." },
     { RT_UOFFSETOF(GMMSTATS, cShareableModules),                STAMTYPE_U32,   STAMUNIT_COUNT, "/GMM/cShareableModules",           "The number of shareable modules." },
+    { RT_UOFFSETOF(GMMSTATS, cDedupMergedPages),                STAMTYPE_U64,   STAMUNIT_PAGES, "/GMM/cDedupMergedPages",           "The number of private pages the deduplication scanner replaced by an identical shared page." },
+    { RT_UOFFSETOF(GMMSTATS, cSharedPageCowBreaks),             STAMTYPE_U64,   STAMUNIT_PAGES, "/GMM/cSharedPageCowBreaks",        "The number of shared pages replaced by private copies after being written to." },
     { RT_UOFFSETOF(GMMSTATS, VMStats.Reserved.cBasePages),      STAMTYPE_U64,   STAMUNIT_PAGES, "/GMM/VM/Reserved/cBasePages",      "The amount of base memory (RAM, ROM, ++) reserved by the VM." },
     { RT_UOFFSETOF(GMMSTATS, VMStats.Reserved.cShadowPages),    STAMTYPE_U32,   STAMUNIT_PAGES, "/GMM/VM/Reserved/cShadowPages",    "The amount of memory reserved for shadow/nested page tables." },
     { RT_UOFFSETOF(GMMSTATS, VMStats.Reserved.cFixedPages),     STAMTYPE_U32,   STAMUNIT_PAGES, "/GMM/VM/Reserved/cFixedPages",     "The amount of memory reserved for fixed allocations like MMIO2 and the hyper heap." },
@@ -1431,6 +1513,7 @@ static int stamR3RegisterU(PUVM pUVM, void *pvSample, PFNSTAMR3CALLBACKRESET pfn
 #endif
 
         stamR3ResetOne(pNew, pUVM->pVM);
+        ASMAtomicIncU32(&pUVM->stam.s.cGeneration);
         rc = VINF_SUCCESS;
     }
     else
@@ -1445,10 +1528,12 @@ static int stamR3RegisterU(PUVM pUVM, void *pvSample, PFNSTAMR3CALLBACKRESET pfn
  * Destroys the statistics descriptor, unlinking it and freeing all resources.
  *
  * @returns VINF_SUCCESS
+ * @param   pUVM        Pointer to the user mode VM structure.
  * @param   pCur        The descriptor to destroy.
  */
-static int stamR3DestroyDesc(PSTAMDESC pCur)
+static int stamR3DestroyDesc(PUVM pUVM, PSTAMDESC pCur)
 {
+    ASMAtomicIncU32(&pUVM->stam.s.cGeneration);
     RTListNodeRemove(&pCur->ListEntry);
 #ifdef STAM_WITH_LOOKUP_TREE
     pCur->pLookup->pDesc = NULL; /** @todo free lookup nodes once it's working. */
@@ -1491,7 +1576,7 @@ VMMR3DECL(int)  STAMR3DeregisterByAddr(PUVM pUVM, void *pvSample)
     RTListForEachSafe(&pUVM->stam.s.List, pCur, pNext, STAMDESC, ListEntry)
     {
         if (pCur->u.pv == pvSample)
-            rc = stamR3DestroyDesc(pCur);
+            rc = stamR3DestroyDesc(pUVM, pCur);
     }
 
     STAM_UNLOCK_WR(pUVM);
@@ -1524,7 +1609,7 @@ static int stamR3DeregisterByPattern(PUVM pUVM, const char *pszPat)
             PSTAMDESC pNext = RTListNodeGetNext(&pCur->ListEntry, STAMDESC, ListEntry);
 
             if (RTStrSimplePatternMatch(pszPat, pCur->pszName))
-                rc = stamR3DestroyDesc(pCur);
+                rc = stamR3DestroyDesc(pUVM, pCur);
 
             /* advance. */
             if (pCur == pLast)
@@ -2088,6 +2173,524 @@ VMMR3DECL(int)  STAMR3SnapshotFree(PUVM pUVM, char *pszSnapshot)
 }
 
 
+/**
+ * Makes sure there are @a cb more bytes available in a binary snapshot buffer.
+ *
+ * @returns Pointer to the free space, NULL on allocation failure.
+ * @param   pThis       The binary snapshot context.
+ * @param   pBuf        The buffer.
+ * @param   cb          The number of bytes needed.
+ */
+static uint8_t *stamR3BinSnapReserve(PSTAMBINSNAP pThis, PSTAMBINSNAPBUF pBuf, size_t cb)
+{
+    if (RT_UNLIKELY(pBuf->cb + cb > pBuf->cbAlloc))
+    {
+        if (RT_FAILURE(pThis->rc))
+            return NULL;
+        size_t   cbNew = RT_ALIGN_Z(RT_MAX(pBuf->cbAlloc * 2, pBuf->cb + cb), _4K);
+        uint8_t *pbNew = (uint8_t *)RTMemRealloc(pBuf->pb, cbNew);
+        if (!pbNew)
+        {
+            pThis->rc = VERR_NO_MEMORY;
+            return NULL;
+        }
+        pBuf->pb      = pbNew;
+        pBuf->cbAlloc = cbNew;
+    }
+    return &pBuf->pb[pBuf->cb];
+}
+
+
+/**
+ * Writes an unsigned LEB128 encoded value to a binary snapshot buffer.
+ *
+ * @param   pThis       The binary snapshot context.
+ * @param   pBuf        The buffer.
+ * @param   uValue      The value.
+ */
+static void stamR3BinSnapPutVarU64(PSTAMBINSNAP pThis, PSTAMBINSNAPBUF pBuf, uint64_t uValue)
+{
+    uint8_t *pb = stamR3BinSnapReserve(pThis, pBuf, 10);
+    if (pb)
+    {
+        size_t cb = 0;
+        while (uValue >= 0x80)
+        {
+            pb[cb++] = (uint8_t)uValue | 0x80;
+            uValue >>= 7;
+        }
+        pb[cb++] = (uint8_t)uValue;
+        pBuf->cb += cb;
+    }
+}
+
+
+/**
+ * Writes bytes to a binary snapshot buffer.
+ *
+ * @param   pThis       The binary snapshot context.
+ * @param   pBuf        The buffer.
+ * @param   pv          The bytes.
+ * @param   cb          The number of bytes.
+ */
+static void stamR3BinSnapPutBytes(PSTAMBINSNAP pThis, PSTAMBINSNAPBUF pBuf, const void *pv, size_t cb)
+{
+    uint8_t *pb = stamR3BinSnapReserve(pThis, pBuf, cb);
+    if (pb)
+    {
+        memcpy(pb, pv, cb);
+        pBuf->cb += cb;
+    }
+}
+
+
+/**
+ * Gets the number of numeric values a sample yields in binary snapshots.
+ *
+ * @returns Number of values, 0 for callback samples.
+ * @param   enmType     The sample type.
+ */
+static uint32_t stamR3BinSnapValueCount(STAMTYPE enmType)
+{
+    switch (enmType)
+    {
+        case STAMTYPE_PROFILE:
+        case STAMTYPE_PROFILE_ADV:
+            return 4;
+        case STAMTYPE_RATIO_U32:
+        case STAMTYPE_RATIO_U32_RESET:
+            return 2;
+        case STAMTYPE_CALLBACK:
+            return 0;
+        default:
+            return 1;
+    }
+}
+
+
+/**
+ * stamR3EnumU callback employed by stamR3BinSnapResolve to collect the
+ * matching samples.
+ *
+ * @returns VINF_SUCCESS or VERR_NO_MEMORY.
+ * @param   pDesc       The sample.
+ * @param   pvArg       The binary snapshot context.
+ */
+static int stamR3BinSnapCollectOne(PSTAMDESC pDesc, void *pvArg)
+{
+    PSTAMBINSNAP pThis = (PSTAMBINSNAP)pvArg;
+    if (pThis->cDescs >= pThis->cDescsAlloc)
+    {
+        uint32_t   cNew      = pThis->cDescsAlloc ? pThis->cDescsAlloc * 2 : 256;
+        PSTAMDESC *papNew    = (PSTAMDESC *)RTMemRealloc(pThis->papDescs, cNew * sizeof(pThis->papDescs[0]));
+        if (!papNew)
+            return VERR_NO_MEMORY;
+        pThis->papDescs    = papNew;
+        uint8_t   *pacNew    = (uint8_t *)RTMemRealloc(pThis->pacValues, cNew);
+        if (!pacNew)
+            return VERR_NO_MEMORY;
+        pThis->pacValues   = pacNew;
+        pThis->cDescsAlloc = cNew;
+    }
+    uint8_t const cValues = (uint8_t)stamR3BinSnapValueCount(pDesc->enmType);
+    pThis->pacValues[pThis->cDescs]  = cValues;
+    pThis->papDescs[pThis->cDescs++] = pDesc;
+    pThis->cValues += cValues;
+
+    /* The definition, see STAMR3BinSnapshotTake. */
+    stamR3BinSnapPutVarU64(pThis, &pThis->Defs, pDesc->enmType);
+    stamR3BinSnapPutVarU64(pThis, &pThis->Defs, pDesc->enmUnit);
+    stamR3BinSnapPutVarU64(pThis, &pThis->Defs, pDesc->enmVisibility);
+    size_t const cchName = strlen(pDesc->pszName);
+    stamR3BinSnapPutVarU64(pThis, &pThis->Defs, cchName);
+    stamR3BinSnapPutBytes(pThis, &pThis->Defs, pDesc->pszName, cchName);
+    return pThis->rc;
+}
+
+
+/**
+ * Matches the pattern against the registry, (re)building the sample set.
+ *
+ * @returns VBox status code.
+ * @param   pThis       The binary snapshot context.
+ * @param   cGeneration The registry generation read before calling.
+ */
+static int stamR3BinSnapResolve(PSTAMBINSNAP pThis, uint32_t cGeneration)
+{
+    pThis->fResolved   = false;
+    pThis->cDescs      = 0;
+    pThis->cValues     = 0;
+    pThis->cGeneration = cGeneration;
+    pThis->Defs.cb     = 0;
+    pThis->rc          = VINF_SUCCESS;
+    int rc = stamR3EnumU(pThis->pUVM, pThis->pszPat, false /*fUpdateRing0*/, stamR3BinSnapCollectOne, pThis);
+    if (RT_SUCCESS(rc) && pThis->cValues > pThis->cValuesAlloc)
+    {
+        uint32_t  cNew     = RT_ALIGN_32(pThis->cValues, 256);
+        uint64_t *pauCur   = (uint64_t *)RTMemRealloc(pThis->pauCur, cNew * sizeof(uint64_t));
+        if (pauCur)
+            pThis->pauCur = pauCur;
+        uint64_t *pauPrev  = (uint64_t *)RTMemRealloc(pThis->pauPrev, cNew * sizeof(uint64_t));
+        if (pauPrev)
+            pThis->pauPrev = pauPrev;
+        if (pauCur && pauPrev)
+            pThis->cValuesAlloc = cNew;
+        else
+            rc = VERR_NO_MEMORY;
+    }
+    return rc;
+}
+
+
+/**
+ * Appends a callback sample string to the string buffer.
+ *
+ * @param   pThis       The binary snapshot context.
+ * @param   psz         The string.
+ */
+static void stamR3BinSnapAddString(PSTAMBINSNAP pThis, const char *psz)
+{
+    size_t const cb = strlen(psz) + 1;
+    if (pThis->cbStrings + cb > pThis->cbStringsAlloc)
+    {
+        size_t cbNew  = RT_ALIGN_Z(RT_MAX(pThis->cbStringsAlloc * 2, pThis->cbStrings + cb), _4K);
+        char  *pszNew = (char *)RTMemRealloc(pThis->pszStrings, cbNew);
+        if (!pszNew)
+        {
+            pThis->rc = VERR_NO_MEMORY;
+            return;
+        }
+        pThis->pszStrings     = pszNew;
+        pThis->cbStringsAlloc = cbNew;
+    }
+    memcpy(&pThis->pszStrings[pThis->cbStrings], psz, cb);
+    pThis->cbStrings += cb;
+}
+
+
+/**
+ * Copies the current sample values, called while holding the read lock.
+ *
+ * This is kept as short as possible so readers don't hold up registrations
+ * (or anyone else wanting the write lock) for longer than necessary.  The
+ * values are encoded after dropping the lock.
+ *
+ * @param   pThis       The binary snapshot context.
+ */
+static void stamR3BinSnapCopyValues(PSTAMBINSNAP pThis)
+{
+    uint64_t *pau = pThis->pauCur;
+    pThis->cbStrings = 0;
+    for (uint32_t i = 0; i < pThis->cDescs; i++)
+    {
+        PSTAMDESC pDesc = pThis->papDescs[i];
+        switch (pDesc->enmType)
+        {
+            case STAMTYPE_COUNTER:
+                *pau++ = pDesc->u.pCounter->c;
+                break;
+
+            case STAMTYPE_PROFILE:
+            case STAMTYPE_PROFILE_ADV:
+                *pau++ = pDesc->u.pProfile->cPeriods;
+                *pau++ = pDesc->u.pProfile->cTicks;
+                *pau++ = pDesc->u.pProfile->cTicksMin;
+                *pau++ = pDesc->u.pProfile->cTicksMax;
+                break;
+
+            case STAMTYPE_RATIO_U32:
+            case STAMTYPE_RATIO_U32_RESET:
+                *pau++ = pDesc->u.pRatioU32->u32A;
+                *pau++ = pDesc->u.pRatioU32->u32B;
+                break;
+
+            case STAMTYPE_CALLBACK:
+            {
+                char szBuf[512];
+                szBuf[0] = '\0';
+                pDesc->u.Callback.pfnPrint(pThis->pUVM->pVM, pDesc->u.Callback.pvSample, szBuf, sizeof(szBuf));
+                szBuf[sizeof(szBuf) - 1] = '\0';
+                stamR3BinSnapAddString(pThis, szBuf);
+                break;
+            }
+
+            case STAMTYPE_U8:
+            case STAMTYPE_U8_RESET:
+            case STAMTYPE_X8:
+            case STAMTYPE_X8_RESET:
+                *pau++ = *pDesc->u.pu8;
+                break;
+
+            case STAMTYPE_U16:
+            case STAMTYPE_U16_RESET:
+            case STAMTYPE_X16:
+            case STAMTYPE_X16_RESET:
+                *pau++ = *pDesc->u.pu16;
+                break;
+
+            case STAMTYPE_U32:
+            case STAMTYPE_U32_RESET:
+            case STAMTYPE_X32:
+            case STAMTYPE_X32_RESET:
+                *pau++ = *pDesc->u.pu32;
+                break;
+
+            case STAMTYPE_U64:
+            case STAMTYPE_U64_RESET:
+            case STAMTYPE_X64:
+            case STAMTYPE_X64_RESET:
+                *pau++ = *pDesc->u.pu64;
+                break;
+
+            case STAMTYPE_BOOL:
+            case STAMTYPE_BOOL_RESET:
+                *pau++ = *pDesc->u.pf;
+                break;
+
+            default:
+                AssertMsgFailed(("%d\n", pDesc->enmType));
+                *pau++ = 0;
+                break;
+        }
+    }
+    Assert((uint32_t)(pau - pThis->pauCur) == pThis->cValues);
+}
+
+
+/**
+ * Writes the snapshot header and, for full snapshots, the sample definitions.
+ *
+ * @param   pThis       The binary snapshot context.
+ * @param   fFull       Whether it's a full snapshot.
+ * @param   u64NanoTS   The time of the snapshot.
+ */
+static void stamR3BinSnapPutHeader(PSTAMBINSNAP pThis, bool fFull, uint64_t u64NanoTS)
+{
+    uint32_t const au32Hdr[2] = { RT_H2LE_U32(STAMBINSNAP_MAGIC), RT_H2LE_U32(fFull ? STAMBINSNAP_F_FULL : 0) };
+    stamR3BinSnapPutBytes(pThis, &pThis->Out, au32Hdr, sizeof(au32Hdr));
+    uint64_t const u64Now = RT_H2LE_U64(u64NanoTS);
+    stamR3BinSnapPutBytes(pThis, &pThis->Out, &u64Now, sizeof(u64Now));
+    stamR3BinSnapPutVarU64(pThis, &pThis->Out, pThis->cDescs);
+    if (fFull && pThis->Defs.cb)
+        stamR3BinSnapPutBytes(pThis, &pThis->Out, pThis->Defs.pb, pThis->Defs.cb);
+}
+
+
+/**
+ * Creates a binary snapshot context for the samples matching a pattern.
+ *
+ * The context is intended for polling the same set of samples repeatedly
+ * with STAMR3BinSnapshotTake.  It must be destroyed before the VM is.
+ *
+ * @returns VBox status code.
+ * @param   pUVM            The user mode VM handle.
+ * @param   pszPat          The name matching pattern, see STAMR3Snapshot.
+ *                          If NULL all samples are included.
+ * @param   phSnap          Where to return the snapshot context handle.
+ */
+VMMR3DECL(int) STAMR3BinSnapshotCreate(PUVM pUVM, const char *pszPat, PSTAMBINSNAP *phSnap)
+{
+    UVM_ASSERT_VALID_EXT_RETURN(pUVM, VERR_INVALID_VM_HANDLE);
+    VM_ASSERT_VALID_EXT_RETURN(pUVM->pVM, VERR_INVALID_VM_HANDLE);
+    AssertPtrReturn(phSnap, VERR_INVALID_POINTER);
+    AssertPtrNullReturn(pszPat, VERR_INVALID_POINTER);
+    *phSnap = NULL;
+
+    PSTAMBINSNAP pThis = (PSTAMBINSNAP)RTMemAllocZ(sizeof(*pThis));
+    if (!pThis)
+        return VERR_NO_MEMORY;
+    pThis->u32Magic = STAMBINSNAP_HANDLE_MAGIC;
+    pThis->pUVM     = pUVM;
+    pThis->rc       = VINF_SUCCESS;
+
+    if (!pszPat || !*pszPat || !strcmp(pszPat, "*"))
+        pszPat = "*";
+    else
+    {
+        pThis->pszPat = RTStrDup(pszPat);
+        if (!pThis->pszPat)
+        {
+            RTMemFree(pThis);
+            return VERR_NO_MEMORY;
+        }
+    }
+    pThis->papszExpressions = stamR3SplitPattern(pszPat, &pThis->cExpressions, &pThis->pszExprCopy);
+    if (!pThis->papszExpressions)
+    {
+        RTStrFree(pThis->pszPat);
+        RTMemFree(pThis);
+        return VERR_NO_MEMORY;
+    }
+
+    *phSnap = pThis;
+    return VINF_SUCCESS;
+}
+
+
+/**
+ * Takes a binary snapshot.
+ *
+ * The values are copied while holding the registry lock in shared mode, but
+ * the pattern matching is only redone when samples have been registered or
+ * deregistered since the previous call.  The sample definitions are encoded
+ * when the set is resolved and everything else is encoded after releasing
+ * the lock.
+ *
+ * The format is a header followed by an optional list of sample definitions
+ * and the value records:
+ *      - uint32_t  STAMBINSNAP_MAGIC, little endian.
+ *      - uint32_t  Flags, STAMBINSNAP_F_XXX, little endian.
+ *      - uint64_t  RTTimeNanoTS() at the time of the snapshot, little endian.
+ *      - varint    The number of samples.
+ *      - If STAMBINSNAP_F_FULL, one sample definition per sample:
+ *          - varint    The type (STAMTYPE).
+ *          - varint    The unit (STAMUNIT).
+ *          - varint    The visibility (STAMVISIBILITY).
+ *          - varint    The name length, followed by the name without
+ *                      terminator.
+ *      - One value record per sample, in the same order as the definitions:
+ *          - For callback samples the printed value as a varint length
+ *            followed by the string without terminator.
+ *          - Otherwise 1 to 4 values (profiles: cPeriods, cTicks, cTicksMin
+ *            and cTicksMax; ratios: u32A and u32B; the rest: the value),
+ *            each stored as the zigzag encoded varint of the difference to
+ *            the value in the previous snapshot.  The previous value is zero
+ *            for full snapshots.
+ *
+ * All varints are unsigned LEB128.  A consumer keeps the definitions and
+ * the accumulated values from the last full snapshot.
+ *
+ * @returns VBox status code.
+ * @param   hSnap           The binary snapshot context.
+ * @param   ppvData         Where to return the pointer to the snapshot data.
+ *                          It is valid until the next call or until the
+ *                          context is destroyed.
+ * @param   pcbData         Where to return the size of the snapshot data.
+ */
+VMMR3DECL(int) STAMR3BinSnapshotTake(PSTAMBINSNAP hSnap, const void **ppvData, size_t *pcbData)
+{
+    PSTAMBINSNAP pThis = hSnap;
+    AssertPtrReturn(pThis, VERR_INVALID_HANDLE);
+    AssertReturn(pThis->u32Magic == STAMBINSNAP_HANDLE_MAGIC, VERR_INVALID_HANDLE);
+    AssertPtrReturn(ppvData, VERR_INVALID_POINTER);
+    AssertPtrReturn(pcbData, VERR_INVALID_POINTER);
+    *ppvData = NULL;
+    *pcbData = 0;
+    PUVM pUVM = pThis->pUVM;
+
+    stamR3Ring0StatsUpdateMultiU(pUVM, pThis->papszExpressions, pThis->cExpressions);
+
+    /*
+     * Copy the values, re-resolving the sample set if the registry changed.
+     */
+    bool     fFull     = !pThis->fResolved;
+    unsigned cTries    = 0;
+    uint64_t u64NanoTS = 0;
+    int      rc;
+    for (;;)
+    {
+        STAM_LOCK_RD(pUVM);
+        uint32_t const cGeneration = ASMAtomicReadU32(&pUVM->stam.s.cGeneration);
+        if (pThis->fResolved && pThis->cGeneration == cGeneration)
+        {
+            pThis->rc = VINF_SUCCESS;
+            u64NanoTS = RTTimeNanoTS();
+            stamR3BinSnapCopyValues(pThis);
+            STAM_UNLOCK_RD(pUVM);
+            rc = pThis->rc;
+            break;
+        }
+        STAM_UNLOCK_RD(pUVM);
+
+        if (++cTries >= 64) /* registration storm */
+            return VERR_TRY_AGAIN;
+        rc = stamR3BinSnapResolve(pThis, cGeneration);
+        if (RT_FAILURE(rc))
+            return rc;
+        pThis->fResolved = true;
+        fFull = true;
+    }
+    if (RT_FAILURE(rc))
+    {
+        pThis->fResolved = false; /* make sure the next one is a full one */
+        return rc;
+    }
+    if (fFull)
+        RT_BZERO(pThis->pauPrev, pThis->cValues * sizeof(uint64_t));
+
+    /*
+     * Encode the snapshot.
+     */
+    pThis->Out.cb = 0;
+    stamR3BinSnapPutHeader(pThis, fFull, u64NanoTS);
+    const char *pszString = pThis->pszStrings;
+    uint32_t    iValue    = 0;
+    for (uint32_t i = 0; i < pThis->cDescs; i++)
+    {
+        uint32_t cValues = pThis->pacValues[i];
+        if (!cValues)
+        {
+            size_t const cch = strlen(pszString);
+            stamR3BinSnapPutVarU64(pThis, &pThis->Out, cch);
+            stamR3BinSnapPutBytes(pThis, &pThis->Out, pszString, cch);
+            pszString += cch + 1;
+        }
+        else
+            for (; cValues > 0; cValues--, iValue++)
+            {
+                int64_t const iDelta = (int64_t)(pThis->pauCur[iValue] - pThis->pauPrev[iValue]);
+                stamR3BinSnapPutVarU64(pThis, &pThis->Out, ((uint64_t)iDelta << 1) ^ (uint64_t)(iDelta >> 63));
+            }
+    }
+    Assert(iValue == pThis->cValues);
+    if (RT_FAILURE(pThis->rc))
+    {
+        pThis->fResolved = false;
+        return pThis->rc;
+    }
+
+    /* The current values become the previous ones. */
+    uint64_t *pauTmp = pThis->pauPrev;
+    pThis->pauPrev   = pThis->pauCur;
+    pThis->pauCur    = pauTmp;
+
+    *ppvData = pThis->Out.pb;
+    *pcbData = pThis->Out.cb;
+    return VINF_SUCCESS;
+}
+
+
+/**
+ * Destroys a binary snapshot context.
+ *
+ * @returns VBox status code.
+ * @param   hSnap           The binary snapshot context.  NULL is quietly
+ *                          ignored.
+ */
+VMMR3DECL(int) STAMR3BinSnapshotDestroy(PSTAMBINSNAP hSnap)
+{
+    PSTAMBINSNAP pThis = hSnap;
+    if (!pThis)
+        return VINF_SUCCESS;
+    AssertPtrReturn(pThis, VERR_INVALID_HANDLE);
+    AssertReturn(pThis->u32Magic == STAMBINSNAP_HANDLE_MAGIC, VERR_INVALID_HANDLE);
+
+    pThis->u32Magic = STAMBINSNAP_HANDLE_MAGIC_DEAD;
+    RTMemTmpFree(pThis->papszExpressions);
+    RTStrFree(pThis->pszExprCopy);
+    RTStrFree(pThis->pszPat);
+    RTMemFree(pThis->papDescs);
+    RTMemFree(pThis->pacValues);
+    RTMemFree(pThis->pauCur);
+    RTMemFree(pThis->pauPrev);
+    RTMemFree(pThis->pszStrings);
+    RTMemFree(pThis->Defs.pb);
+    RTMemFree(pThis->Out.pb);
+    RTMemFree(pThis);
+    return VINF_SUCCESS;
+}
+
+
 /**
  * Dumps the selected statistics to the log.
  *
@@ -1472,6 +1472,7 @@ static int tmr3TimerCreate(PVM pVM, TMCLOCK enmClock, const char *pszDesc, PPTMT
     pTimer->offScheduleNext = 0;
     pTimer->offNext         = 0;
     pTimer->offPrev         = 0;
+    pTimer->offChild        = 0;
     pTimer->pvUser          = NULL;
     pTimer->pCritSect       = NULL;
     pTimer->pszDesc         = pszDesc;
@@ -1781,24 +1782,10 @@ VMMR3DECL(int) TMR3TimerDestroy(PTMTIMER pTimer)
     }
 
     /*
-     * Unlink from the active list.
+     * Unlink from the active heap.
      */
     if (fActive)
-    {
-        const PTMTIMER pPrev = TMTIMER_GET_PREV(pTimer);
-        const PTMTIMER pNext = TMTIMER_GET_NEXT(pTimer);
-        if (pPrev)
-            TMTIMER_SET_NEXT(pPrev, pNext);
-        else
-        {
-            TMTIMER_SET_HEAD(pQueue, pNext);
-            pQueue->u64Expire = pNext ? pNext->u64Expire : INT64_MAX;
-        }
-        if (pNext)
-            TMTIMER_SET_PREV(pNext, pPrev);
-        pTimer->offNext = 0;
-        pTimer->offPrev = 0;
-    }
+        tmTimerQueueUnlinkActive(pQueue, pTimer);
 
     /*
      * Unlink from the schedule list by running it.
@@ -1815,7 +1802,7 @@ VMMR3DECL(int) TMR3TimerDestroy(PTMTIMER pTimer)
     /*
      * Read to move the timer from the created list and onto the free list.
      */
-    Assert(!pTimer->offNext); Assert(!pTimer->offPrev); Assert(!pTimer->offScheduleNext);
+    Assert(!pTimer->offNext); Assert(!pTimer->offPrev); Assert(!pTimer->offChild); Assert(!pTimer->offScheduleNext);
 
     /* unlink from created list */
     if (pTimer->pBigPrev)
@@ -2139,6 +2126,52 @@ VMMR3DECL(void) TMR3TimerQueuesDo(PVM pVM)
 //RT_C_DECLS_END
 
 
+/**
+ * Finds the expired active timer with the lowest expire time in a sub-heap.
+ *
+ * The children of a timer never expire before it, so only the children of
+ * expired timers need looking at.
+ *
+ * @returns The timer, pBest if none better was found.
+ * @param   pTimer          The first timer in the sibling list to search.
+ * @param   u64Now          The current clock time.
+ * @param   pBest           The best timer found so far, NULL if none.
+ */
+static PTMTIMER tmR3TimerHeapFindExpired(PTMTIMER pTimer, uint64_t u64Now, PTMTIMER pBest)
+{
+    for (; pTimer; pTimer = TMTIMER_GET_NEXT(pTimer))
+        if (pTimer->u64Expire <= u64Now)
+        {
+            if (   pTimer->enmState == TMTIMERSTATE_ACTIVE
+                && (!pBest || pTimer->u64Expire < pBest->u64Expire))
+                pBest = pTimer;
+            pBest = tmR3TimerHeapFindExpired(TMTIMER_GET_CHILD(pTimer), u64Now, pBest);
+        }
+    return pBest;
+}
+
+
+/**
+ * Gets the next timer for tmR3TimerQueueRun to fire.
+ *
+ * This is the head of the active heap, unless someone else is changing it, in
+ * which case it's the first expired active timer behind it.
+ *
+ * @returns The timer, NULL if none.  Not necessarily expired.
+ * @param   pQueue          The queue.
+ * @param   u64Now          The current clock time.
+ */
+static PTMTIMER tmR3TimerQueueNextToRun(PTMTIMERQUEUE pQueue, uint64_t u64Now)
+{
+    PTMTIMER pHead = TMTIMER_GET_HEAD(pQueue);
+    if (   !pHead
+        || pHead->u64Expire > u64Now
+        || pHead->enmState == TMTIMERSTATE_ACTIVE)
+        return pHead;
+    return tmR3TimerHeapFindExpired(pHead, u64Now, NULL);
+}
+
+
 /**
  * Schedules and runs any pending times in the specified queue.
  *
@@ -2162,15 +2195,23 @@ static void tmR3TimerQueueRun(PVM pVM, PTMTIMERQUEUE pQueue)
      *      However, we only allow EMT to handle EXPIRED_PENDING
      *      timers, thus enabling the timer handler function to
      *      arm the timer again.
-     */
-    PTMTIMER pNext = TMTIMER_GET_HEAD(pQueue);
-    if (!pNext)
+     *
+     * The head of the active heap is consumed one timer at the time.  When
+     * the head timer is being changed by someone else, we apply any pending
+     * scheduling and carry on with the expired timers behind it if it's still
+     * in the way.  We don't run more timers than were active when we started
+     * so a handler re-arming its timer in the past cannot keep us here
+     * forever.
+     */
+    if (!TMTIMER_GET_HEAD(pQueue))
         return;
-    const uint64_t u64Now = tmClock(pVM, pQueue->enmClock);
-    while (pNext && pNext->u64Expire <= u64Now)
+    const uint64_t u64Now  = tmClock(pVM, pQueue->enmClock);
+    PTMTIMER       pTimer  = tmR3TimerQueueNextToRun(pQueue, u64Now);
+    uint32_t       cMaxRun = pQueue->cActive;
+    while (   pTimer
+           && pTimer->u64Expire <= u64Now
+           && cMaxRun-- > 0)
     {
-        PTMTIMER        pTimer    = pNext;
-        pNext = TMTIMER_GET_NEXT(pTimer);
         PPDMCRITSECT    pCritSect = pTimer->pCritSect;
         if (pCritSect)
             PDMCritSectEnter(pCritSect, VERR_IGNORED);
@@ -2183,18 +2224,7 @@ static void tmR3TimerQueueRun(PVM pVM, PTMTIMERQUEUE pQueue)
             Assert(!pTimer->offScheduleNext); /* this can trigger falsely */
 
             /* unlink */
-            const PTMTIMER pPrev = TMTIMER_GET_PREV(pTimer);
-            if (pPrev)
-                TMTIMER_SET_NEXT(pPrev, pNext);
-            else
-            {
-                TMTIMER_SET_HEAD(pQueue, pNext);
-                pQueue->u64Expire = pNext ? pNext->u64Expire : INT64_MAX;
-            }
-            if (pNext)
-                TMTIMER_SET_PREV(pNext, pPrev);
-            pTimer->offNext = 0;
-            pTimer->offPrev = 0;
+            tmTimerQueueUnlinkActive(pQueue, pTimer);
 
             /* fire */
             TM_SET_STATE(pTimer, TMTIMERSTATE_EXPIRED_DELIVER);
@@ -2213,9 +2243,20 @@ static void tmR3TimerQueueRun(PVM pVM, PTMTIMERQUEUE pQueue)
             /* change the state if it wasn't changed already in the handler. */
             TM_TRY_SET_STATE(pTimer, TMTIMERSTATE_STOPPED, TMTIMERSTATE_EXPIRED_DELIVER, fRc);
             Log2(("tmR3TimerQueueRun: new state %s\n", tmTimerState(pTimer->enmState)));
+            if (pCritSect)
+                PDMCritSectLeave(pCritSect);
         }
-        if (pCritSect)
-            PDMCritSectLeave(pCritSect);
+        else
+        {
+            /* Being stopped or rescheduled, apply it if it's been queued already. */
+            if (pCritSect)
+                PDMCritSectLeave(pCritSect);
+            if (pQueue->offSchedule)
+                tmTimerQueueSchedule(pVM, pQueue);
+        }
+
+        /* next */
+        pTimer = tmR3TimerQueueNextToRun(pQueue, u64Now);
     } /* run loop */
 }
 
@@ -2351,11 +2392,13 @@ static void tmR3TimerQueueRunVirtualSync(PVM pVM)
 #ifdef VBOX_STRICT
     uint64_t u64Prev = u64Now; NOREF(u64Prev);
 #endif
-    while (pNext && pNext->u64Expire <= u64Max)
+    uint32_t cMaxRun = pQueue->cActive;
+    while (   pNext
+           && pNext->u64Expire <= u64Max
+           && cMaxRun-- > 0)
     {
         /* Advance */
         PTMTIMER pTimer = pNext;
-        pNext = TMTIMER_GET_NEXT(pTimer);
 
         /* Take the associated lock. */
         PPDMCRITSECT pCritSect = pTimer->pCritSect;
@@ -2404,6 +2447,9 @@ static void tmR3TimerQueueRunVirtualSync(PVM pVM)
         /* Leave the associated lock. */
         if (pCritSect)
             PDMCritSectLeave(pCritSect);
+
+        /* The handler may have re-armed timers, so always take the current head. */
+        pNext = TMTIMER_GET_HEAD(pQueue);
     } /* run loop */
 
 
@@ -3527,7 +3573,7 @@ static DECLCALLBACK(void) tmR3TimerInfoActive(PVM pVM, PCDBGFINFOHLP pHlp, const
         TM_LOCK_TIMERS(pVM);
         for (PTMTIMERR3 pTimer = TMTIMER_GET_HEAD(&pVM->tm.s.paTimerQueuesR3[iQueue]);
              pTimer;
-             pTimer = TMTIMER_GET_NEXT(pTimer))
+             pTimer = tmTimerQueueWalkNext(pTimer))
         {
             pHlp->pfnPrintf(pHlp,
                             "%p %08RX32 %08RX32 %08RX32 %s %18RU64 %18RU64 %6RU32 %-25s %s\n",
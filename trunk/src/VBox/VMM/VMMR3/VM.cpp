@@ -911,6 +911,35 @@ static int vmR3InitRing3(PVM pVM, PUVM pUVM)
         AssertRC(rc);
         rc = STAMR3RegisterF(pVM, &pUVM->aCpus[idCpu].vm.s.StatHaltTimers,          STAMTYPE_PROFILE, STAMVISIBILITY_ALWAYS, STAMUNIT_NS_PER_CALL, "Profiling halted state timer tasks.", "/PROF/CPU%d/VM/Halt/Timers", idCpu);
         AssertRC(rc);
+        rc = STAMR3RegisterF(pVM, &pUVM->aCpus[idCpu].vm.s.StatHaltPoll,            STAMTYPE_PROFILE, STAMVISIBILITY_USED,   STAMUNIT_NS_PER_CALL, "Time spent polling before blocking.", "/PROF/CPU%d/VM/Halt/Poll", idCpu);
+        AssertRC(rc);
+        rc = STAMR3RegisterF(pVM, &pUVM->aCpus[idCpu].vm.s.StatHaltPollHits,        STAMTYPE_COUNTER, STAMVISIBILITY_USED,   STAMUNIT_OCCURENCES,  "Halts ending while polling.",        "/PROF/CPU%d/VM/Halt/PollHits", idCpu);
+        AssertRC(rc);
+        rc = STAMR3RegisterF(pVM, &pUVM->aCpus[idCpu].vm.s.StatHaltPollMisses,      STAMTYPE_COUNTER, STAMVISIBILITY_USED,   STAMUNIT_OCCURENCES,  "Halts blocking after polling.",      "/PROF/CPU%d/VM/Halt/PollMisses", idCpu);
+        AssertRC(rc);
+        rc = STAMR3RegisterF(pVM, &pUVM->aCpus[idCpu].vm.s.Halt.Adaptive.cNsPollPeriod, STAMTYPE_U64,  STAMVISIBILITY_USED,   STAMUNIT_NS,          "Current adaptive poll period.",      "/PROF/CPU%d/VM/Halt/PollPeriod", idCpu);
+        AssertRC(rc);
+        for (unsigned i = 0; i < VM_HALT_HISTOGRAM_BUCKETS; i++)
+        {
+            /* The names give the approximate upper bound of the bucket. */
+            if (i < VM_HALT_HISTOGRAM_BUCKETS - 1)
+            {
+                rc = STAMR3RegisterF(pVM, &pUVM->aCpus[idCpu].vm.s.aStatHaltDuration[i], STAMTYPE_COUNTER, STAMVISIBILITY_USED, STAMUNIT_OCCURENCES,
+                                     "Halt duration histogram.", "/PROF/CPU%d/VM/Halt/Duration/%05uus", idCpu, 1U << i);
+                AssertRC(rc);
+                rc = STAMR3RegisterF(pVM, &pUVM->aCpus[idCpu].vm.s.aStatHaltWakeupLatency[i], STAMTYPE_COUNTER, STAMVISIBILITY_USED, STAMUNIT_OCCURENCES,
+                                     "Wakeup latency histogram.", "/PROF/CPU%d/VM/Halt/WakeupLatency/%05uus", idCpu, 1U << i);
+            }
+            else
+            {
+                rc = STAMR3RegisterF(pVM, &pUVM->aCpus[idCpu].vm.s.aStatHaltDuration[i], STAMTYPE_COUNTER, STAMVISIBILITY_USED, STAMUNIT_OCCURENCES,
+                                     "Halt duration histogram.", "/PROF/CPU%d/VM/Halt/Duration/Longer", idCpu);
+                AssertRC(rc);
+                rc = STAMR3RegisterF(pVM, &pUVM->aCpus[idCpu].vm.s.aStatHaltWakeupLatency[i], STAMTYPE_COUNTER, STAMVISIBILITY_USED, STAMUNIT_OCCURENCES,
+                                     "Wakeup latency histogram.", "/PROF/CPU%d/VM/Halt/WakeupLatency/Longer", idCpu);
+            }
+            AssertRC(rc);
+        }
     }
 
     STAM_REG(pVM, &pUVM->vm.s.StatReqAllocNew,   STAMTYPE_COUNTER,     "/VM/Req/AllocNew",       STAMUNIT_OCCURENCES,        "Number of VMR3ReqAlloc returning a new packet.");
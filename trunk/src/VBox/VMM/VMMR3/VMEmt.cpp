@@ -319,6 +319,7 @@ static const char *vmR3GetHaltMethodName(VMHALTMETHOD enmMethod)
         case VMHALTMETHOD_1:            return "method1";
         //case VMHALTMETHOD_2:            return "method2";
         case VMHALTMETHOD_GLOBAL_1:     return "global1";
+        case VMHALTMETHOD_ADAPTIVE:     return "adaptive";
         default:                        return "unknown";
     }
 }
@@ -866,6 +867,274 @@ static DECLCALLBACK(void) vmR3HaltGlobal1NotifyCpuFF(PUVMCPU pUVCpu, uint32_t fF
 }
 
 
+/**
+ * Gets the halt duration histogram bucket for the given period.
+ *
+ * @returns Bucket index, less than VM_HALT_HISTOGRAM_BUCKETS.
+ * @param   cNs             The period in nanoseconds.
+ */
+DECLINLINE(unsigned) vmR3HaltAdaptiveBucket(uint64_t cNs)
+{
+    unsigned iBucket = ASMBitLastSetU64(cNs >> 10);
+    return RT_MIN(iBucket, VM_HALT_HISTOGRAM_BUCKETS - 1);
+}
+
+
+/**
+ * Initialize the adaptive halt method.
+ *
+ * @return VBox status code.
+ * @param   pUVM            Pointer to the user mode VM structure.
+ */
+static DECLCALLBACK(int) vmR3HaltAdaptiveInit(PUVM pUVM)
+{
+    /*
+     * The defaults.
+     */
+    uint32_t cNsResolution = SUPSemEventMultiGetResolution(pUVM->vm.s.pSession);
+    if (cNsResolution > 5*RT_NS_100US)
+        pUVM->vm.s.Halt.Adaptive.cNsSpinBlockThresholdCfg = 50000;
+    else if (cNsResolution > RT_NS_100US)
+        pUVM->vm.s.Halt.Adaptive.cNsSpinBlockThresholdCfg = cNsResolution / 4;
+    else
+        pUVM->vm.s.Halt.Adaptive.cNsSpinBlockThresholdCfg = 2000;
+    pUVM->vm.s.Halt.Adaptive.cNsPollMaxCfg       = 200000; /* 0.2 ms */
+    pUVM->vm.s.Halt.Adaptive.uPollCoveragePctCfg = 50;
+
+    /*
+     * Query overrides.
+     */
+    PCFGMNODE pCfg = CFGMR3GetChild(CFGMR3GetRoot(pUVM->pVM), "/VMM/HaltedAdaptive");
+    if (pCfg)
+    {
+        uint32_t u32;
+        if (RT_SUCCESS(CFGMR3QueryU32(pCfg, "SpinBlockThreshold", &u32)))
+            pUVM->vm.s.Halt.Adaptive.cNsSpinBlockThresholdCfg = u32;
+        if (RT_SUCCESS(CFGMR3QueryU32(pCfg, "PollMax", &u32)))
+            pUVM->vm.s.Halt.Adaptive.cNsPollMaxCfg = u32;
+        if (RT_SUCCESS(CFGMR3QueryU32(pCfg, "PollCoveragePct", &u32)))
+        {
+            if (u32 > 100)
+                return VMSetError(pUVM->pVM, VERR_OUT_OF_RANGE, RT_SRC_POS,
+                                  N_("Invalid /VMM/HaltedAdaptive/PollCoveragePct value %u, max 100"), u32);
+            pUVM->vm.s.Halt.Adaptive.uPollCoveragePctCfg = u32;
+        }
+    }
+    LogRel(("VMEmt: HaltedAdaptive config: cNsSpinBlockThresholdCfg=%u cNsPollMaxCfg=%u uPollCoveragePctCfg=%u\n",
+            pUVM->vm.s.Halt.Adaptive.cNsSpinBlockThresholdCfg, pUVM->vm.s.Halt.Adaptive.cNsPollMaxCfg,
+            pUVM->vm.s.Halt.Adaptive.uPollCoveragePctCfg));
+
+    /*
+     * Start out without polling, the history will tell us whether it pays off.
+     * (The other EMTs are waiting on the rendezvous, so this is safe.)
+     */
+    for (VMCPUID idCpu = 0; idCpu < pUVM->cCpus; idCpu++)
+        RT_ZERO(pUVM->aCpus[idCpu].vm.s.Halt.Adaptive);
+    return VINF_SUCCESS;
+}
+
+
+/**
+ * Records a halt for the adaptive method, updating the poll period every so
+ * often.
+ *
+ * The poll period is set to cover uPollCoveragePctCfg percent of the recent
+ * halts, unless that exceeds cNsPollMaxCfg in which case blocking right away
+ * is the better choice.
+ *
+ * @param   pUVCpu          Pointer to the user mode VMCPU structure.
+ * @param   cNsHalted       How long the halt lasted.
+ * @param   u64EndTS        When the halt ended (RTTimeNanoTS).
+ */
+static void vmR3HaltAdaptiveRecord(PUVMCPU pUVCpu, uint64_t cNsHalted, uint64_t u64EndTS)
+{
+    PUVM     pUVM    = pUVCpu->pUVM;
+    unsigned iBucket = vmR3HaltAdaptiveBucket(cNsHalted);
+    STAM_REL_COUNTER_INC(&pUVCpu->vm.s.aStatHaltDuration[iBucket]);
+
+    uint64_t const u64NotifyTS = ASMAtomicUoReadU64(&pUVCpu->vm.s.Halt.Adaptive.u64NotifyTS);
+    if (u64NotifyTS && u64NotifyTS <= u64EndTS)
+        STAM_REL_COUNTER_INC(&pUVCpu->vm.s.aStatHaltWakeupLatency[vmR3HaltAdaptiveBucket(u64EndTS - u64NotifyTS)]);
+
+    /*
+     * Update the history, halving it when recalculating the period so that
+     * old behaviour fades out.
+     */
+    pUVCpu->vm.s.Halt.Adaptive.acHalts[iBucket]++;
+    if (++pUVCpu->vm.s.Halt.Adaptive.cHalts >= 64)
+    {
+        uint32_t cTotal = 0;
+        for (unsigned i = 0; i < VM_HALT_HISTOGRAM_BUCKETS; i++)
+            cTotal += pUVCpu->vm.s.Halt.Adaptive.acHalts[i];
+
+        uint32_t const cCover = cTotal * pUVM->vm.s.Halt.Adaptive.uPollCoveragePctCfg / 100;
+        uint64_t       cNsPollPeriod = 0;
+        uint32_t       cSeen  = 0;
+        for (unsigned i = 0; i < VM_HALT_HISTOGRAM_BUCKETS - 1 && cCover > 0; i++)
+        {
+            cSeen += pUVCpu->vm.s.Halt.Adaptive.acHalts[i];
+            if (cSeen >= cCover)
+            {
+                cNsPollPeriod = UINT64_C(1024) << i;
+                break;
+            }
+        }
+        if (cNsPollPeriod > pUVM->vm.s.Halt.Adaptive.cNsPollMaxCfg)
+            cNsPollPeriod = 0;
+        pUVCpu->vm.s.Halt.Adaptive.cNsPollPeriod = cNsPollPeriod;
+
+        for (unsigned i = 0; i < VM_HALT_HISTOGRAM_BUCKETS; i++)
+            pUVCpu->vm.s.Halt.Adaptive.acHalts[i] /= 2;
+        pUVCpu->vm.s.Halt.Adaptive.cHalts = 0;
+    }
+}
+
+
+/**
+ * The adaptive halt method - Poll for FFs for a learned period before
+ * blocking in GMM (ring-0) like the global 1 method.
+ *
+ * Short halts, like those caused by IPI heavy guest workloads, are thus
+ * serviced without paying for a sleep and wakeup round trip.
+ */
+static DECLCALLBACK(int) vmR3HaltAdaptiveHalt(PUVMCPU pUVCpu, const uint32_t fMask, uint64_t u64Now)
+{
+    PUVM    pUVM  = pUVCpu->pUVM;
+    PVMCPU  pVCpu = pUVCpu->pVCpu;
+    PVM     pVM   = pUVCpu->pVM;
+    Assert(VMMGetCpu(pVM) == pVCpu);
+
+    ASMAtomicWriteU64(&pUVCpu->vm.s.Halt.Adaptive.u64NotifyTS, 0);
+    ASMAtomicWriteBool(&pUVCpu->vm.s.Halt.Adaptive.fHalted, true);
+
+    /*
+     * Halt loop.
+     *
+     * Note! fWait is only set while blocking.  The FFs are always set before
+     *       the notification, so while polling we'll see them without help.
+     */
+    uint64_t const cNsPollPeriod = pUVCpu->vm.s.Halt.Adaptive.cNsPollPeriod;
+    uint64_t const u64PollEndTS  = u64Now + cNsPollPeriod;
+    bool           fBlocked      = false;
+    int            rc            = VINF_SUCCESS;
+    unsigned       cLoops        = 0;
+    for (;; cLoops++)
+    {
+        /*
+         * Work the timers and check if we can exit.
+         */
+        uint64_t const u64StartTimers   = RTTimeNanoTS();
+        TMR3TimerQueuesDo(pVM);
+        uint64_t const cNsElapsedTimers = RTTimeNanoTS() - u64StartTimers;
+        STAM_REL_PROFILE_ADD_PERIOD(&pUVCpu->vm.s.StatHaltTimers, cNsElapsedTimers);
+        if (    VM_FF_IS_PENDING(pVM, VM_FF_EXTERNAL_HALTED_MASK)
+            ||  VMCPU_FF_IS_PENDING(pVCpu, fMask))
+            break;
+
+        /*
+         * Estimate time left to the next event.
+         */
+        uint64_t u64Delta;
+        uint64_t u64GipTime = TMTimerPollGIP(pVM, pVCpu, &u64Delta);
+        if (    VM_FF_IS_PENDING(pVM, VM_FF_EXTERNAL_HALTED_MASK)
+            ||  VMCPU_FF_IS_PENDING(pVCpu, fMask))
+            break;
+
+        /*
+         * Keep polling while inside the poll period.
+         */
+        if (u64StartTimers + cNsElapsedTimers < u64PollEndTS)
+        {
+            ASMNopPause();
+            continue;
+        }
+
+        /*
+         * Block if the interval isn't all that small.
+         */
+        if (u64Delta >= pUVM->vm.s.Halt.Adaptive.cNsSpinBlockThresholdCfg)
+        {
+            VMMR3YieldStop(pVM);
+            ASMAtomicWriteBool(&pUVCpu->vm.s.fWait, true);
+            if (    VM_FF_IS_PENDING(pVM, VM_FF_EXTERNAL_HALTED_MASK)
+                ||  VMCPU_FF_IS_PENDING(pVCpu, fMask))
+                break;
+
+            fBlocked = true;
+            uint64_t const u64StartSchedHalt   = RTTimeNanoTS();
+            rc = SUPR3CallVMMR0Ex(pVM->pVMR0, pVCpu->idCpu, VMMR0_DO_GVMM_SCHED_HALT, u64GipTime, NULL);
+            uint64_t const u64EndSchedHalt     = RTTimeNanoTS();
+            uint64_t const cNsElapsedSchedHalt = u64EndSchedHalt - u64StartSchedHalt;
+            STAM_REL_PROFILE_ADD_PERIOD(&pUVCpu->vm.s.StatHaltBlock, cNsElapsedSchedHalt);
+            ASMAtomicWriteBool(&pUVCpu->vm.s.fWait, false);
+
+            if (rc == VERR_INTERRUPTED)
+                rc = VINF_SUCCESS;
+            else if (RT_FAILURE(rc))
+            {
+                rc = vmR3FatalWaitError(pUVCpu, "vmR3HaltAdaptiveHalt: VMMR0_DO_GVMM_SCHED_HALT->%Rrc\n", rc);
+                break;
+            }
+            else
+            {
+                int64_t const cNsOverslept = u64EndSchedHalt - u64GipTime;
+                if (cNsOverslept > 50000)
+                    STAM_PROFILE_ADD_PERIOD(&pUVCpu->vm.s.StatHaltBlockOverslept, cNsOverslept);
+                else if (cNsOverslept < -50000)
+                    STAM_PROFILE_ADD_PERIOD(&pUVCpu->vm.s.StatHaltBlockInsomnia,  cNsElapsedSchedHalt);
+                else
+                    STAM_PROFILE_ADD_PERIOD(&pUVCpu->vm.s.StatHaltBlockOnTime,    cNsElapsedSchedHalt);
+            }
+        }
+        /*
+         * When spinning call upon the GVMM and do some wakups once
+         * in a while, it's not like we're actually busy or anything.
+         */
+        else if (!(cLoops & 0x1fff))
+        {
+            uint64_t const u64StartSchedYield   = RTTimeNanoTS();
+            rc = SUPR3CallVMMR0Ex(pVM->pVMR0, pVCpu->idCpu, VMMR0_DO_GVMM_SCHED_POLL, false /* don't yield */, NULL);
+            uint64_t const cNsElapsedSchedYield = RTTimeNanoTS() - u64StartSchedYield;
+            STAM_REL_PROFILE_ADD_PERIOD(&pUVCpu->vm.s.StatHaltYield, cNsElapsedSchedYield);
+        }
+    }
+
+    ASMAtomicUoWriteBool(&pUVCpu->vm.s.fWait, false);
+    ASMAtomicWriteBool(&pUVCpu->vm.s.Halt.Adaptive.fHalted, false);
+
+    /*
+     * Update the statistics and the history.
+     */
+    uint64_t const u64EndTS = RTTimeNanoTS();
+    if (cNsPollPeriod)
+    {
+        STAM_REL_PROFILE_ADD_PERIOD(&pUVCpu->vm.s.StatHaltPoll, RT_MIN(u64EndTS, u64PollEndTS) - u64Now);
+        if (fBlocked)
+            STAM_REL_COUNTER_INC(&pUVCpu->vm.s.StatHaltPollMisses);
+        else
+            STAM_REL_COUNTER_INC(&pUVCpu->vm.s.StatHaltPollHits);
+    }
+    vmR3HaltAdaptiveRecord(pUVCpu, u64EndTS - u64Now, u64EndTS);
+    return rc;
+}
+
+
+/**
+ * The adaptive halt method - VMR3NotifyFF() worker.
+ *
+ * @param   pUVCpu          Pointer to the user mode VMCPU structure.
+ * @param   fFlags          Notification flags, VMNOTIFYFF_FLAGS_*.
+ */
+static DECLCALLBACK(void) vmR3HaltAdaptiveNotifyCpuFF(PUVMCPU pUVCpu, uint32_t fFlags)
+{
+    /* Time stamp the first notification of a halt for the wakeup latency statistics. */
+    if (   pUVCpu->vm.s.Halt.Adaptive.fHalted
+        && !pUVCpu->vm.s.Halt.Adaptive.u64NotifyTS)
+        ASMAtomicCmpXchgU64(&pUVCpu->vm.s.Halt.Adaptive.u64NotifyTS, RTTimeNanoTS(), 0);
+    vmR3HaltGlobal1NotifyCpuFF(pUVCpu, fFlags);
+}
+
+
 /**
  * Bootstrap VMR3Wait() worker.
  *
@@ -1021,10 +1290,11 @@ static const struct VMHALTMETHODDESC
     DECLR3CALLBACKMEMBER(void, pfnNotifyGlobalFF,(PUVM pUVM, uint32_t fFlags));
 } g_aHaltMethods[] =
 {
-    { VMHALTMETHOD_BOOTSTRAP, NULL,                NULL,   NULL,                vmR3BootstrapWait,   vmR3BootstrapNotifyCpuFF,   NULL },
-    { VMHALTMETHOD_OLD,       NULL,                NULL,   vmR3HaltOldDoHalt,   vmR3DefaultWait,     vmR3DefaultNotifyCpuFF,     NULL },
-    { VMHALTMETHOD_1,         vmR3HaltMethod1Init, NULL,   vmR3HaltMethod1Halt, vmR3DefaultWait,     vmR3DefaultNotifyCpuFF,     NULL },
-    { VMHALTMETHOD_GLOBAL_1,  vmR3HaltGlobal1Init, NULL,   vmR3HaltGlobal1Halt, vmR3HaltGlobal1Wait, vmR3HaltGlobal1NotifyCpuFF, NULL },
+    { VMHALTMETHOD_BOOTSTRAP, NULL,                 NULL, NULL,                 vmR3BootstrapWait,   vmR3BootstrapNotifyCpuFF,    NULL },
+    { VMHALTMETHOD_OLD,       NULL,                 NULL, vmR3HaltOldDoHalt,    vmR3DefaultWait,     vmR3DefaultNotifyCpuFF,      NULL },
+    { VMHALTMETHOD_1,         vmR3HaltMethod1Init,  NULL, vmR3HaltMethod1Halt,  vmR3DefaultWait,     vmR3DefaultNotifyCpuFF,      NULL },
+    { VMHALTMETHOD_GLOBAL_1,  vmR3HaltGlobal1Init,  NULL, vmR3HaltGlobal1Halt,  vmR3HaltGlobal1Wait, vmR3HaltGlobal1NotifyCpuFF,  NULL },
+    { VMHALTMETHOD_ADAPTIVE,  vmR3HaltAdaptiveInit, NULL, vmR3HaltAdaptiveHalt, vmR3HaltGlobal1Wait, vmR3HaltAdaptiveNotifyCpuFF, NULL },
 };
 
 
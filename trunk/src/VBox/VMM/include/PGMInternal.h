@@ -1469,6 +1469,25 @@ AssertCompileSize(PGMLIVESAVERAMPAGE, 4);
 /** Pointer to the per page live save tracking data. */
 typedef PGMLIVESAVERAMPAGE *PPGMLIVESAVERAMPAGE;
 
+
+/**
+ * Per RAM range page content hashes for the deduplication scanner.
+ */
+typedef struct PGMDEDUPRANGE
+{
+    /** Pointer to the next entry. */
+    R3PTRTYPE(struct PGMDEDUPRANGE *) pNext;
+    /** The first address of the RAM range. */
+    RTGCPHYS                    GCPhys;
+    /** The last address of the RAM range. */
+    RTGCPHYS                    GCPhysLast;
+    /** The page content hashes from the previous scan, indexed by the page
+     * number within the range.  Zero means not known. */
+    uint32_t                    auHashes[1];
+} PGMDEDUPRANGE;
+/** Pointer to the page content hashes of a RAM range. */
+typedef PGMDEDUPRANGE *PPGMDEDUPRANGE;
+
 /** The max value of PGMLIVESAVERAMPAGE::cDirtied. */
 #define PGMLIVSAVEPAGE_MAX_DIRTIED 0x00fffff0
 
@@ -3603,6 +3622,34 @@ typedef struct PGM
         uint32_t                    cAlignment;
     } LiveSave;
 
+    /** @name   Content based page deduplication (PGMSharedPage.cpp).
+     * @{ */
+    /** @cfgm{/PGM/Dedup/Enabled, boolean, false}
+     * Whether to periodically scan guest RAM for pages that are identical to
+     * pages in this or other VMs and share them.  Unlike the shared module
+     * checking this doesn't need any guest additions. */
+    bool                            fDedupEnabled;
+    /** Padding. */
+    bool                            afDedupReserved[3];
+    /** @cfgm{/PGM/Dedup/PagesPerScan, uint32_t, 1024}
+     * The max number of pages to look at each time the scan timer fires. */
+    uint32_t                        cDedupPagesPerScan;
+    /** @cfgm{/PGM/Dedup/IntervalMs, uint32_t, 100}
+     * The interval between scans (virtual time). */
+    uint32_t                        cMsDedupInterval;
+    /** Padding. */
+    uint32_t                        u32DedupReserved;
+    /** The guest physical address where the next scan starts. */
+    RTGCPHYS                        GCPhysDedupNext;
+    /** The scan timer. */
+    PTMTIMERR3                      pDedupTimerR3;
+    /** The page content hashes from the previous scan, one entry per RAM
+     * range that has been scanned. */
+    R3PTRTYPE(PPGMDEDUPRANGE)       pDedupRangesR3;
+    /** The ring-0 request buffer (GMM_DEDUP_SCAN_MAX_PAGES). */
+    R3PTRTYPE(PGMMDEDUPSCANREQ)     pDedupReqR3;
+    /** @} */
+
     /** @name   Error injection.
      * @{ */
     /** Inject handy page allocation errors pretending we're completely out of
@@ -3629,7 +3676,7 @@ typedef struct PGM
     uint32_t                        cUnmappedChunks;        /**< Number of times we unmapped a chunk. */
     uint32_t                        cLargePages;            /**< The number of large pages. */
     uint32_t                        cLargePagesDisabled;    /**< The number of disabled large pages. */
-/*    uint32_t                        aAlignment4[1]; */
+    uint32_t                        cSharedPageCowBreaks;   /**< The number of shared pages replaced by private copies on write. */
 
     /** The number of times we were forced to change the hypervisor region location. */
     STAMCOUNTER                     cRelocations;
@@ -3639,6 +3686,12 @@ typedef struct PGM
     STAMCOUNTER                     StatLargePageRecheck;   /**< The number of times we rechecked a disabled large page.*/
 
     STAMPROFILE                     StatShModCheck;         /**< Profiles shared module checks. */
+
+    STAMPROFILE                     StatDedupScan;          /**< Profiles the content deduplication scans. */
+    STAMCOUNTER                     StatDedupScannedPages;  /**< Pages looked at by the deduplication scanner. */
+    STAMCOUNTER                     StatDedupStablePages;   /**< Scanned pages whose content hadn't changed since the previous scan. */
+    STAMCOUNTER                     StatDedupNewSharedPages;/**< Pages converted into new shared pages by the deduplication scanner. */
+    STAMCOUNTER                     StatDedupMergedPages;   /**< Pages replaced by an existing shared page by the deduplication scanner. */
     /** @} */
 
 #ifdef VBOX_WITH_STATISTICS
@@ -4254,6 +4307,10 @@ int             pgmR3PhysChunkMap(PVM pVM, uint32_t idChunk, PPPGMCHUNKR3MAP ppC
 int             pgmR3PhysRamTerm(PVM pVM);
 void            pgmR3PhysRomTerm(PVM pVM);
 void            pgmR3PhysAssertSharedPageChecksums(PVM pVM);
+# ifdef VBOX_WITH_PAGE_SHARING
+int             pgmR3DedupInit(PVM pVM);
+void            pgmR3DedupTerm(PVM pVM);
+# endif
 
 int             pgmR3PoolInit(PVM pVM);
 void            pgmR3PoolRelocate(PVM pVM);
@@ -146,8 +146,10 @@ typedef struct STAMUSERPERVM
     /** The number of registered host CPU leaves. */
     uint32_t                cRegisteredHostCpus;
 
-    /** Explicit alignment padding. */
-    uint32_t                uAlignment;
+    /** The registry generation, incremented (while write locked) whenever a
+     * sample is registered or deregistered.  Used by binary snapshots to
+     * tell when their resolved sample set is stale. */
+    uint32_t volatile       cGeneration;
     /** The copy of the GMM statistics. */
     GMMSTATS                GMMStats;
 } STAMUSERPERVM;
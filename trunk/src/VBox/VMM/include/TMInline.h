@@ -19,8 +19,105 @@
 #define ___TMInline_h
 
 
+
 /**
- * Used to unlink a timer from the active list.
+ * Melds two active timer heaps (pairing heap).
+ *
+ * @returns The root of the combined heap.
+ * @param   pRoot1      The root of the first heap.  Must not have any siblings.
+ * @param   pRoot2      The root of the second heap.  Must not have any siblings.
+ *
+ * @remarks On equal expire times the first heap wins, so pass the older one
+ *          first to approximate FIFO ordering.
+ */
+DECL_FORCE_INLINE(PTMTIMER) tmTimerHeapMeld(PTMTIMER pRoot1, PTMTIMER pRoot2)
+{
+    Assert(!pRoot1->offNext && !pRoot1->offPrev);
+    Assert(!pRoot2->offNext && !pRoot2->offPrev);
+    if (pRoot2->u64Expire < pRoot1->u64Expire)
+    {
+        PTMTIMER pTmp = pRoot1;
+        pRoot1 = pRoot2;
+        pRoot2 = pTmp;
+    }
+
+    /* Make pRoot2 the first child of pRoot1. */
+    PTMTIMER pChild = TMTIMER_GET_CHILD(pRoot1);
+    TMTIMER_SET_NEXT(pRoot2, pChild);
+    if (pChild)
+        TMTIMER_SET_PREV(pChild, pRoot2);
+    TMTIMER_SET_PREV(pRoot2, pRoot1);
+    TMTIMER_SET_CHILD(pRoot1, pRoot2);
+    return pRoot1;
+}
+
+
+/**
+ * Combines a list of sibling heaps into a single heap using the standard
+ * two-pass pairing.
+ *
+ * @returns The new root, NULL if the list was empty.
+ * @param   pFirst      The first sibling.  Its previous link is ignored.
+ */
+DECLINLINE(PTMTIMER) tmTimerHeapMergePairs(PTMTIMER pFirst)
+{
+    /*
+     * Pass 1: Meld pairs left to right, chaining the results in reverse
+     *         order via the next link.
+     */
+    PTMTIMER pPairs = NULL;
+    while (pFirst)
+    {
+        PTMTIMER pA = pFirst;
+        PTMTIMER pB = TMTIMER_GET_NEXT(pA);
+        pFirst = pB ? TMTIMER_GET_NEXT(pB) : NULL;
+        pA->offNext = 0;
+        pA->offPrev = 0;
+        if (pB)
+        {
+            pB->offNext = 0;
+            pB->offPrev = 0;
+            pA = tmTimerHeapMeld(pA, pB);
+        }
+        TMTIMER_SET_NEXT(pA, pPairs);
+        pPairs = pA;
+    }
+
+    /*
+     * Pass 2: Meld the pairs right to left.
+     */
+    PTMTIMER pRoot = pPairs;
+    if (pRoot)
+    {
+        pPairs = TMTIMER_GET_NEXT(pRoot);
+        pRoot->offNext = 0;
+        while (pPairs)
+        {
+            PTMTIMER pNext = TMTIMER_GET_NEXT(pPairs);
+            pPairs->offNext = 0;
+            pRoot = tmTimerHeapMeld(pRoot, pPairs);
+            pPairs = pNext;
+        }
+    }
+    return pRoot;
+}
+
+
+/**
+ * Sets the head of the active heap, updating the cached expire time.
+ *
+ * @param   pQueue      The timer queue.
+ * @param   pHead       The new head timer, NULL if empty.
+ */
+DECL_FORCE_INLINE(void) tmTimerQueueSetHead(PTMTIMERQUEUE pQueue, PTMTIMER pHead)
+{
+    TMTIMER_SET_HEAD(pQueue, pHead);
+    ASMAtomicWriteU64(&pQueue->u64Expire, pHead ? pHead->u64Expire : INT64_MAX);
+}
+
+
+/**
+ * Used to unlink a timer from the active heap.
  *
  * @param   pQueue      The timer queue.
  * @param   pTimer      The timer that needs linking.
@@ -33,23 +130,77 @@ DECL_FORCE_INLINE(void) tmTimerQueueUnlinkActive(PTMTIMERQUEUE pQueue, PTMTIMER
     TMTIMERSTATE const enmState = pTimer->enmState;
     Assert(  pTimer->enmClock == TMCLOCK_VIRTUAL_SYNC
            ? enmState == TMTIMERSTATE_ACTIVE
-           : enmState == TMTIMERSTATE_PENDING_SCHEDULE || enmState == TMTIMERSTATE_PENDING_STOP_SCHEDULE);
+           : enmState == TMTIMERSTATE_PENDING_SCHEDULE || enmState == TMTIMERSTATE_PENDING_STOP_SCHEDULE
+             || enmState == TMTIMERSTATE_EXPIRED_GET_UNLINK || enmState == TMTIMERSTATE_DESTROY);
 #endif
+    Assert(pQueue->cActive > 0);
 
-    const PTMTIMER pPrev = TMTIMER_GET_PREV(pTimer);
-    const PTMTIMER pNext = TMTIMER_GET_NEXT(pTimer);
-    if (pPrev)
-        TMTIMER_SET_NEXT(pPrev, pNext);
-    else
+    PTMTIMER const pSubHeap = tmTimerHeapMergePairs(TMTIMER_GET_CHILD(pTimer));
+    PTMTIMER const pHead    = TMTIMER_GET_HEAD(pQueue);
+    if (pHead == pTimer)
     {
-        TMTIMER_SET_HEAD(pQueue, pNext);
-        pQueue->u64Expire = pNext ? pNext->u64Expire : INT64_MAX;
+        tmTimerQueueSetHead(pQueue, pSubHeap);
         DBGFTRACE_U64_TAG(pTimer->CTX_SUFF(pVM), pQueue->u64Expire, "tmTimerQueueUnlinkActive");
     }
-    if (pNext)
-        TMTIMER_SET_PREV(pNext, pPrev);
-    pTimer->offNext = 0;
-    pTimer->offPrev = 0;
+    else
+    {
+        /* The previous link is either the parent (if we're the first child) or the left sibling. */
+        PTMTIMER const pPrev = TMTIMER_GET_PREV(pTimer);
+        PTMTIMER const pNext = TMTIMER_GET_NEXT(pTimer);
+        Assert(pPrev);
+        if (TMTIMER_GET_CHILD(pPrev) == pTimer)
+            TMTIMER_SET_CHILD(pPrev, pNext);
+        else
+            TMTIMER_SET_NEXT(pPrev, pNext);
+        if (pNext)
+            TMTIMER_SET_PREV(pNext, pPrev);
+        if (pSubHeap)
+        {
+            /* Everything in the sub-heap expires no earlier than the head, so the head stays put. */
+            PTMTIMER pNewHead = tmTimerHeapMeld(pHead, pSubHeap);
+            Assert(pNewHead == pHead); NOREF(pNewHead);
+        }
+    }
+    pTimer->offNext  = 0;
+    pTimer->offPrev  = 0;
+    pTimer->offChild = 0;
+    pQueue->cActive--;
+}
+
+
+/**
+ * Gets the next timer when walking the active heap of a timer queue.
+ *
+ * The walk is in pre-order, i.e. the head timer comes first but the rest are
+ * NOT sorted by expire time.
+ *
+ * @returns The next timer, NULL when done.
+ * @param   pTimer      The current timer.
+ *
+ * @remarks Called while owning the relevant queue lock.
+ */
+DECLINLINE(PTMTIMER) tmTimerQueueWalkNext(PTMTIMER pTimer)
+{
+    PTMTIMER pChild = TMTIMER_GET_CHILD(pTimer);
+    if (pChild)
+        return pChild;
+    for (;;)
+    {
+        PTMTIMER pNext = TMTIMER_GET_NEXT(pTimer);
+        if (pNext)
+            return pNext;
+
+        /* Climb to the parent: walk back over the left siblings to the first child. */
+        PTMTIMER pPrev = TMTIMER_GET_PREV(pTimer);
+        while (pPrev && TMTIMER_GET_CHILD(pPrev) != pTimer)
+        {
+            pTimer = pPrev;
+            pPrev  = TMTIMER_GET_PREV(pTimer);
+        }
+        if (!pPrev)
+            return NULL;
+        pTimer = pPrev;
+    }
 }
 
 #endif
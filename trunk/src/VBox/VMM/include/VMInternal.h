@@ -126,6 +126,11 @@ typedef struct VMRUNTIMEERROR
     uint32_t                        fFlags;
 } VMRUNTIMEERROR, *PVMRUNTIMEERROR;
 
+/** Number of buckets in the halt duration histograms.
+ * Bucket 0 holds everything below 1024 ns and each following bucket covers
+ * twice the range of the previous one, the last bucket taking the rest. */
+#define VM_HALT_HISTOGRAM_BUCKETS       16
+
 /** The halt method. */
 typedef enum
 {
@@ -141,6 +146,9 @@ typedef enum
     VMHALTMETHOD_1,
     /** The first go at a more global approach. */
     VMHALTMETHOD_GLOBAL_1,
+    /** The global approach with adaptive polling before blocking.
+     * Selected with VM/HaltMethod=6. */
+    VMHALTMETHOD_ADAPTIVE,
     /** The end of valid methods. (not inclusive of course) */
     VMHALTMETHOD_END,
     /** The usual 32-bit max value. */
@@ -306,6 +314,20 @@ typedef struct VMINTUSERPERVM
             /** The threshold between spinning and blocking. */
             uint32_t                cNsSpinBlockThresholdCfg;
         }                           Global1;
+
+       /**
+        * Adaptive - Like global 1, but polls for a per-VCPU learned period
+        * before blocking in the GVMM.
+        */
+        struct
+        {
+            /** The threshold between spinning and blocking. */
+            uint32_t                cNsSpinBlockThresholdCfg;
+            /** The max time to poll before blocking. */
+            uint32_t                cNsPollMaxCfg;
+            /** The percentage of recent halts the poll period should cover. */
+            uint32_t                uPollCoveragePctCfg;
+        }                           Adaptive;
     }                               Halt;
 
     /** Pointer to the DBGC instance data. */
@@ -400,6 +422,27 @@ typedef struct VMINTUSERPERVMCPU
             uint64_t                u64StartSpinTS;
         }                           Method12;
 
+       /**
+        * Adaptive - Poll for a while before blocking, with the poll period
+        * derived from the recent halt duration distribution.
+        */
+        struct
+        {
+            /** The current poll period (ns), 0 if not polling. */
+            uint64_t                cNsPollPeriod;
+            /** When the EMT was first notified during the current halt
+             * (RTTimeNanoTS), 0 if not notified yet. */
+            uint64_t volatile       u64NotifyTS;
+            /** Set while in the halt method. */
+            bool volatile           fHalted;
+            /** Align the next member. */
+            bool                    afAlignment[3];
+            /** Number of halts recorded since the poll period was last updated. */
+            uint32_t                cHalts;
+            /** Decaying histogram of recent halt durations, see vmR3HaltAdaptiveBucket. */
+            uint16_t                acHalts[VM_HALT_HISTOGRAM_BUCKETS];
+        }                           Adaptive;
+
 # if 0
        /**
         * Method 3 & 4 - Same as method 1 & 2 respectivly, except that we
@@ -445,6 +488,14 @@ typedef struct VMINTUSERPERVMCPU
     STAMPROFILE                     StatHaltTimers;
     STAMPROFILE                     StatHaltPoll;
     /** @} */
+
+    /** Adaptive halt method statistics.
+     * @{ */
+    STAMCOUNTER                     StatHaltPollHits;
+    STAMCOUNTER                     StatHaltPollMisses;
+    STAMCOUNTER                     aStatHaltDuration[VM_HALT_HISTOGRAM_BUCKETS];
+    STAMCOUNTER                     aStatHaltWakeupLatency[VM_HALT_HISTOGRAM_BUCKETS];
+    /** @} */
 } VMINTUSERPERVMCPU;
 AssertCompileMemberAlignment(VMINTUSERPERVMCPU, u64HaltsStartTS, 8);
 AssertCompileMemberAlignment(VMINTUSERPERVMCPU, Halt.Method12.cNSBlockedTooLongAvg, 8);
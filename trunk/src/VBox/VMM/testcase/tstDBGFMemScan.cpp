@@ -0,0 +1,236 @@
+/* $Id$ */
+/** @file
+ * DBGF Testcase - Single and multi needle guest memory scanning.
+ */
+
+/*
+ * Copyright (C) 2017 Oracle Corporation
+ *
+ * This file is part of VirtualBox Open Source Edition (OSE), as
+ * available from http://www.virtualbox.org. This file is free software;
+ * you can redistribute it and/or modify it under the terms of the GNU
+ * General Public License (GPL) as published by the Free Software
+ * Foundation, in version 2 as it comes in the "COPYING" file of the
+ * VirtualBox OSE distribution. VirtualBox OSE is distributed in the
+ * hope that it will be useful, but WITHOUT ANY WARRANTY of any kind.
+ */
+
+
+/*********************************************************************************************************************************
+*   Header Files                                                                                                                 *
+*********************************************************************************************************************************/
+#include <VBox/vmm/vm.h>
+#include <VBox/vmm/dbgf.h>
+#include <VBox/vmm/cfgm.h>
+#include <VBox/err.h>
+#include <VBox/log.h>
+#include <iprt/assert.h>
+#include <iprt/initterm.h>
+#include <iprt/mem.h>
+#include <iprt/rand.h>
+#include <iprt/stream.h>
+#include <iprt/string.h>
+#include <iprt/test.h>
+#include <iprt/time.h>
+
+
+/*********************************************************************************************************************************
+*   Defined Constants And Macros                                                                                                 *
+*********************************************************************************************************************************/
+#define TESTCASE    "tstDBGFMemScan"
+
+/** Where the synthetic kernel image starts in guest physical memory. */
+#define TST_IMAGE_ADDR      _1M
+/** The size of the synthetic kernel image. */
+#define TST_IMAGE_SIZE      (64 * _1M)
+
+
+/*********************************************************************************************************************************
+*   Global Variables                                                                                                             *
+*********************************************************************************************************************************/
+/** The needles, the same ones the Linux digger uses for finding kallsyms. */
+static const DBGFMEMSCANNEEDLE g_aNeedles[] =
+{
+    { RT_STR_TUPLE("kobj") },
+    { RT_STR_TUPLE("kobjec") },
+    { RT_STR_TUPLE("nmi") },
+};
+
+
+/**
+ * Fills the guest memory with something resembling kernel data: mostly
+ * lower case text with the odd control byte, but without any of the needles.
+ * The needles are then planted near the end, each crossing a page boundrary.
+ */
+static int tstFillImage(PUVM pUVM, RTGCPHYS *paGCPhysPlanted)
+{
+    uint8_t *pbChunk = (uint8_t *)RTMemAlloc(_64K);
+    if (!pbChunk)
+        return VERR_NO_MEMORY;
+
+    int      rc     = VINF_SUCCESS;
+    uint32_t uState = RTRandU32() | 1;
+    for (uint32_t off = 0; off < TST_IMAGE_SIZE && RT_SUCCESS(rc); off += _64K)
+    {
+        for (uint32_t i = 0; i < _64K; i++)
+        {
+            /* No 'j' or 'i', so none of the needles occur by accident. */
+            uState ^= uState << 13;
+            uState ^= uState >> 17;
+            uState ^= uState << 5;
+            uint32_t const u = uState & 31;
+            pbChunk[i] = u < 26 ? (uint8_t)("abcdefghxklmnopqrstuvwxyzk"[u]) : (uint8_t)(u * 37);
+        }
+        DBGFADDRESS Addr;
+        rc = DBGFR3MemWrite(pUVM, 0 /*idCpu*/, DBGFR3AddrFromPhys(pUVM, &Addr, TST_IMAGE_ADDR + off), pbChunk, _64K);
+    }
+    RTMemFree(pbChunk);
+
+    for (uint32_t i = 0; i < RT_ELEMENTS(g_aNeedles) && RT_SUCCESS(rc); i++)
+    {
+        paGCPhysPlanted[i] = TST_IMAGE_ADDR + TST_IMAGE_SIZE - (RT_ELEMENTS(g_aNeedles) - i) * _1M - 2;
+        DBGFADDRESS Addr;
+        rc = DBGFR3MemWrite(pUVM, 0 /*idCpu*/, DBGFR3AddrFromPhys(pUVM, &Addr, paGCPhysPlanted[i]),
+                            g_aNeedles[i].pvNeedle, g_aNeedles[i].cbNeedle);
+    }
+    return rc;
+}
+
+
+/**
+ * Checks the results of the multi needle scanner and times it against one
+ * single needle scan per needle.
+ */
+static void tstScan(RTTEST hTest, PUVM pUVM, RTGCPHYS const *paGCPhysPlanted, unsigned cRounds)
+{
+    DBGFADDRESS StartAddr;
+    DBGFR3AddrFromPhys(pUVM, &StartAddr, TST_IMAGE_ADDR);
+
+    RTTestSub(hTest, "Correctness");
+    for (uint32_t i = 0; i < RT_ELEMENTS(g_aNeedles); i++)
+    {
+        DBGFADDRESS HitAddr;
+        uint32_t    iNeedle;
+        int rc = DBGFR3MemScanMulti(pUVM, 0 /*idCpu*/, &StartAddr, TST_IMAGE_SIZE, 1, &g_aNeedles[i], 1, &HitAddr, &iNeedle);
+        RTTEST_CHECK_RC(hTest, rc, VINF_SUCCESS);
+        RTTEST_CHECK(hTest, HitAddr.FlatPtr == paGCPhysPlanted[i] && iNeedle == 0);
+    }
+
+    /* "kobjec" starts with "kobj", so the latter should be found first and reported as such. */
+    DBGFADDRESS HitAddr;
+    uint32_t    iNeedle;
+    int rc = DBGFR3MemScanMulti(pUVM, 0 /*idCpu*/, &StartAddr, TST_IMAGE_SIZE, 1,
+                                g_aNeedles, RT_ELEMENTS(g_aNeedles), &HitAddr, &iNeedle);
+    RTTEST_CHECK_RC(hTest, rc, VINF_SUCCESS);
+    RTTEST_CHECK(hTest, HitAddr.FlatPtr == paGCPhysPlanted[0] && iNeedle == 0);
+
+    DBGFADDRESS NextAddr = HitAddr;
+    DBGFR3AddrAdd(&NextAddr, 1);
+    rc = DBGFR3MemScanMulti(pUVM, 0 /*idCpu*/, &NextAddr, TST_IMAGE_ADDR + TST_IMAGE_SIZE - NextAddr.FlatPtr, 1,
+                            &g_aNeedles[1], RT_ELEMENTS(g_aNeedles) - 1, &HitAddr, &iNeedle);
+    RTTEST_CHECK_RC(hTest, rc, VINF_SUCCESS);
+    RTTEST_CHECK(hTest, HitAddr.FlatPtr == paGCPhysPlanted[1] && iNeedle == 0);
+
+    /* A needle cut short by the end of the range must not be found. */
+    rc = DBGFR3MemScanMulti(pUVM, 0 /*idCpu*/, &StartAddr, paGCPhysPlanted[2] + 2 - TST_IMAGE_ADDR, 1,
+                            &g_aNeedles[2], 1, &HitAddr, &iNeedle);
+    RTTEST_CHECK_RC(hTest, rc, VERR_DBGF_MEM_NOT_FOUND);
+
+    /*
+     * The way the diggers used to do it: one full scan per needle, as the
+     * fallback needles are only tried when the previous ones weren't found.
+     * The timing is for the worst case, none of the needles being present.
+     */
+    static const DBGFMEMSCANNEEDLE s_aMissing[] =
+    {
+        { RT_STR_TUPLE("kobj_missing") },
+        { RT_STR_TUPLE("nmi_missing") },
+        { RT_STR_TUPLE("IKCFG_ST") },
+    };
+
+    RTTestSub(hTest, "Timing");
+    uint64_t nsStart = RTTimeNanoTS();
+    for (unsigned iRound = 0; iRound < cRounds; iRound++)
+        for (uint32_t i = 0; i < RT_ELEMENTS(s_aMissing); i++)
+        {
+            rc = DBGFR3MemScan(pUVM, 0 /*idCpu*/, &StartAddr, TST_IMAGE_SIZE, 1,
+                               s_aMissing[i].pvNeedle, s_aMissing[i].cbNeedle, &HitAddr);
+            RTTEST_CHECK_RC(hTest, rc, VERR_DBGF_MEM_NOT_FOUND);
+        }
+    RTTestValue(hTest, "one scan per needle", (RTTimeNanoTS() - nsStart) / cRounds, RTTESTUNIT_NS_PER_CALL);
+
+    nsStart = RTTimeNanoTS();
+    for (unsigned iRound = 0; iRound < cRounds; iRound++)
+    {
+        rc = DBGFR3MemScanMulti(pUVM, 0 /*idCpu*/, &StartAddr, TST_IMAGE_SIZE, 1,
+                                s_aMissing, RT_ELEMENTS(s_aMissing), &HitAddr, &iNeedle);
+        RTTEST_CHECK_RC(hTest, rc, VERR_DBGF_MEM_NOT_FOUND);
+    }
+    RTTestValue(hTest, "all needles at once", (RTTimeNanoTS() - nsStart) / cRounds, RTTESTUNIT_NS_PER_CALL);
+}
+
+
+static DECLCALLBACK(int)
+tstDBGFMemScanConfigConstructor(PUVM pUVM, PVM pVM, void *pvUser)
+{
+    RT_NOREF2(pUVM, pvUser);
+    /* The default RAM size is plenty for the image. */
+    return CFGMR3ConstructDefaultTree(pVM);
+}
+
+
+/**
+ *  Entry point.
+ */
+extern "C" DECLEXPORT(int) TrustedMain(int argc, char **argv, char **envp)
+{
+    RT_NOREF1(envp);
+
+    /*
+     * Init runtime and the test environment.
+     */
+    RTTEST hTest;
+    RTEXITCODE rcExit = RTTestInitExAndCreate(argc, &argv, RTR3INIT_FLAGS_SUPLIB, TESTCASE, &hTest);
+    if (rcExit != RTEXITCODE_SUCCESS)
+        return rcExit;
+    RTTestBanner(hTest);
+
+    /*
+     * Create an empty VM and scan its memory.
+     */
+    PUVM pUVM;
+    int rc = VMR3Create(1, NULL, NULL, NULL, tstDBGFMemScanConfigConstructor, NULL, NULL, &pUVM);
+    if (RT_SUCCESS(rc))
+    {
+        RTGCPHYS aGCPhysPlanted[RT_ELEMENTS(g_aNeedles)];
+        rc = tstFillImage(pUVM, aGCPhysPlanted);
+        if (RT_SUCCESS(rc))
+            tstScan(hTest, pUVM, aGCPhysPlanted, argc > 1 ? 20 : 3);
+        else
+            RTTestFailed(hTest, "Failed to fill the guest memory: rc=%Rrc\n", rc);
+
+        rc = VMR3PowerOff(pUVM);
+        if (RT_FAILURE(rc))
+            RTTestFailed(hTest, "VMR3PowerOff failed: rc=%Rrc\n", rc);
+        rc = VMR3Destroy(pUVM);
+        if (RT_FAILURE(rc))
+            RTTestFailed(hTest, "VMR3Destroy failed: rc=%Rrc\n", rc);
+        VMR3ReleaseUVM(pUVM);
+    }
+    else
+        RTTestFailed(hTest, "VMR3Create failed: rc=%Rrc\n", rc);
+
+    return RTTestSummaryAndDestroy(hTest);
+}
+
+
+#if !defined(VBOX_WITH_HARDENING) || !defined(RT_OS_WINDOWS)
+/**
+ * Main entry point.
+ */
+int main(int argc, char **argv, char **envp)
+{
+    return TrustedMain(argc, argv, envp);
+}
+#endif
+
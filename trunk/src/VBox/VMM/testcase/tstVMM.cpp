@@ -24,6 +24,7 @@
 #include <VBox/vmm/cpum.h>
 #include <VBox/vmm/tm.h>
 #include <VBox/vmm/pdmapi.h>
+#include <VBox/vmm/stam.h>
 #include <VBox/err.h>
 #include <VBox/log.h>
 #include <iprt/assert.h>
@@ -36,6 +37,7 @@
 #include <iprt/string.h>
 #include <iprt/test.h>
 #include <iprt/thread.h>
+#include <iprt/time.h>
 
 
 /*********************************************************************************************************************************
@@ -141,6 +143,190 @@ DECLCALLBACK(int) tstTMWorker(PVM pVM, RTTEST hTest)
 }
 
 
+/**
+ * Arms, re-arms and expires a large number of timers on one clock, measuring
+ * the cost of the active timer queue operations.
+ *
+ * @returns VINF_SUCCESS, test failure is reported via RTTEST.
+ * @param   pVM         Pointer to the VM.
+ * @param   hTest       The test handle.
+ */
+DECLCALLBACK(int) tstTMStressWorker(PVM pVM, RTTEST hTest)
+{
+    static PTMTIMER s_apTimers[4096];
+    uint32_t const  cTimers = RT_ELEMENTS(s_apTimers);
+
+    int rc;
+    for (uint32_t i = 0; i < cTimers; i++)
+    {
+        rc = TMR3TimerCreateInternal(pVM, TMCLOCK_VIRTUAL, tstTMDummyCallback, NULL, "stress timer", &s_apTimers[i]);
+        RTTEST_CHECK_RET(hTest, RT_SUCCESS(rc), rc);
+    }
+
+    /*
+     * Arm everything with scattered expire times far enough into the future
+     * not to fire, then re-arm each one a couple of times.
+     */
+    uint32_t const cRounds = 16;
+    uint64_t       uSeed   = UINT64_C(0x9e3779b97f4a7c15);
+    uint64_t       uStart  = RTTimeNanoTS();
+    for (uint32_t iRound = 0; iRound < cRounds; iRound++)
+        for (uint32_t i = 0; i < cTimers; i++)
+        {
+            uSeed = uSeed * UINT64_C(6364136223846793005) + UINT64_C(1442695040888963407);
+            rc = TMTimerSet(s_apTimers[i], TMTimerGet(s_apTimers[i]) + RT_NS_1SEC_64 * 60 + (uSeed >> 40));
+            RTTEST_CHECK_MSG(hTest, RT_SUCCESS(rc), (hTest, "TMTimerSet: %Rrc\n", rc));
+        }
+    TMR3TimerQueuesDo(pVM); /* process the pending schedules */
+    uint64_t cNsElapsed = RTTimeNanoTS() - uStart;
+    RTTestValue(hTest, "TMTimerSet", cNsElapsed / (cTimers * cRounds), RTTESTUNIT_NS_PER_CALL);
+
+    /*
+     * Stop them all.
+     */
+    uStart = RTTimeNanoTS();
+    for (uint32_t i = 0; i < cTimers; i++)
+    {
+        rc = TMTimerStop(s_apTimers[i]);
+        RTTEST_CHECK_MSG(hTest, RT_SUCCESS(rc), (hTest, "TMTimerStop: %Rrc\n", rc));
+    }
+    TMR3TimerQueuesDo(pVM);
+    cNsElapsed = RTTimeNanoTS() - uStart;
+    RTTestValue(hTest, "TMTimerStop", cNsElapsed / cTimers, RTTESTUNIT_NS_PER_CALL);
+
+    /*
+     * Arm everything to expire right away and time the queue run.
+     */
+    for (uint32_t i = 0; i < cTimers; i++)
+    {
+        rc = TMTimerSet(s_apTimers[i], TMTimerGet(s_apTimers[i]));
+        RTTEST_CHECK_MSG(hTest, RT_SUCCESS(rc), (hTest, "TMTimerSet: %Rrc\n", rc));
+    }
+    uStart = RTTimeNanoTS();
+    TMR3TimerQueuesDo(pVM);
+    cNsElapsed = RTTimeNanoTS() - uStart;
+    RTTestValue(hTest, "TMR3TimerQueuesDo", cNsElapsed / cTimers, RTTESTUNIT_NS_PER_CALL);
+
+    for (uint32_t i = 0; i < cTimers; i++)
+        RTTEST_CHECK(hTest, !TMTimerIsActive(s_apTimers[i]));
+
+    for (uint32_t i = 0; i < cTimers; i++)
+        TMR3TimerDestroy(s_apTimers[i]);
+    return VINF_SUCCESS;
+}
+
+
+/**
+ * Decodes an unsigned LEB128 value from a binary STAM snapshot.
+ */
+static uint64_t tstSTAMGetVarU64(const uint8_t **ppb, const uint8_t *pbEnd)
+{
+    uint64_t uValue = 0;
+    unsigned cShift = 0;
+    const uint8_t *pb = *ppb;
+    while (pb < pbEnd)
+    {
+        uint8_t b = *pb++;
+        uValue |= (uint64_t)(b & 0x7f) << cShift;
+        cShift += 7;
+        if (!(b & 0x80))
+            break;
+    }
+    *ppb = pb;
+    return uValue;
+}
+
+
+/**
+ * Compares XML and binary snapshots of 10k counters.
+ *
+ * @param   pUVM        The user mode VM handle.
+ * @param   hTest       The test handle.
+ */
+static void tstSTAMSnapshot(PUVM pUVM, RTTEST hTest)
+{
+    static STAMCOUNTER s_aCounters[10000];
+    uint32_t const     cCounters = RT_ELEMENTS(s_aCounters);
+    for (uint32_t i = 0; i < cCounters; i++)
+    {
+        int rc = STAMR3RegisterFU(pUVM, &s_aCounters[i], STAMTYPE_COUNTER, STAMVISIBILITY_ALWAYS, STAMUNIT_OCCURENCES,
+                                  "Snapshot test counter.", "/tstVMM/Snapshot/%05u", i);
+        RTTEST_CHECK_RC_OK_RETV(hTest, rc);
+        s_aCounters[i].c = i;
+    }
+    uint32_t const cLoops = 100;
+
+    /*
+     * The XML snapshot.
+     */
+    size_t   cchXml = 0;
+    uint64_t uStart = RTTimeNanoTS();
+    for (uint32_t iLoop = 0; iLoop < cLoops; iLoop++)
+    {
+        char *pszSnapshot = NULL;
+        RTTEST_CHECK_RC_OK_RETV(hTest, STAMR3Snapshot(pUVM, "/tstVMM/Snapshot/*", &pszSnapshot, &cchXml, false /*fWithDesc*/));
+        STAMR3SnapshotFree(pUVM, pszSnapshot);
+    }
+    RTTestValue(hTest, "XML snapshot", (RTTimeNanoTS() - uStart) / cLoops, RTTESTUNIT_NS_PER_CALL);
+    RTTestValue(hTest, "XML snapshot size", cchXml, RTTESTUNIT_BYTES);
+
+    /*
+     * The binary one.
+     */
+    PSTAMBINSNAP hSnap;
+    RTTEST_CHECK_RC_OK_RETV(hTest, STAMR3BinSnapshotCreate(pUVM, "/tstVMM/Snapshot/*", &hSnap));
+
+    const void *pvData;
+    size_t      cbData;
+    RTTEST_CHECK_RC_OK(hTest, STAMR3BinSnapshotTake(hSnap, &pvData, &cbData));
+    RTTestValue(hTest, "Binary full snapshot size", cbData, RTTESTUNIT_BYTES);
+
+    /* Change one in a hundred counters and check that the delta says so. */
+    for (uint32_t i = 0; i < cCounters; i += 100)
+        s_aCounters[i].c += i + 1;
+    RTTEST_CHECK_RC_OK(hTest, STAMR3BinSnapshotTake(hSnap, &pvData, &cbData));
+    RTTestValue(hTest, "Binary delta snapshot size", cbData, RTTESTUNIT_BYTES);
+    if (RTTestErrorCount(hTest) == 0)
+    {
+        const uint8_t *pb    = (const uint8_t *)pvData;
+        const uint8_t *pbEnd = pb + cbData;
+        uint32_t       au32Hdr[2];
+        memcpy(au32Hdr, pb, sizeof(au32Hdr));
+        RTTEST_CHECK(hTest, RT_LE2H_U32(au32Hdr[0]) == STAMBINSNAP_MAGIC);
+        RTTEST_CHECK(hTest, !(RT_LE2H_U32(au32Hdr[1]) & STAMBINSNAP_F_FULL));
+        pb += sizeof(au32Hdr) + sizeof(uint64_t);
+        RTTEST_CHECK(hTest, tstSTAMGetVarU64(&pb, pbEnd) == cCounters);
+        for (uint32_t i = 0; i < cCounters; i++)
+        {
+            uint64_t const uZigZag = tstSTAMGetVarU64(&pb, pbEnd);
+            int64_t  const iDelta  = (int64_t)(uZigZag >> 1) ^ -(int64_t)(uZigZag & 1);
+            if (iDelta != (i % 100 ? 0 : (int64_t)i + 1))
+            {
+                RTTestFailed(hTest, "Counter #%u: delta %RI64\n", i, iDelta);
+                break;
+            }
+        }
+        RTTEST_CHECK(hTest, pb == pbEnd);
+    }
+
+    uStart = RTTimeNanoTS();
+    for (uint32_t iLoop = 0; iLoop < cLoops; iLoop++)
+        RTTEST_CHECK_RC_OK(hTest, STAMR3BinSnapshotTake(hSnap, &pvData, &cbData));
+    RTTestValue(hTest, "Binary snapshot", (RTTimeNanoTS() - uStart) / cLoops, RTTESTUNIT_NS_PER_CALL);
+
+    /* Registering another sample must trigger a full snapshot. */
+    static STAMCOUNTER s_Extra;
+    RTTEST_CHECK_RC_OK(hTest, STAMR3RegisterU(pUVM, &s_Extra, STAMTYPE_COUNTER, STAMVISIBILITY_ALWAYS, "/tstVMM/Snapshot/Extra",
+                                              STAMUNIT_OCCURENCES, "Snapshot test counter."));
+    RTTEST_CHECK_RC_OK(hTest, STAMR3BinSnapshotTake(hSnap, &pvData, &cbData));
+    if (cbData >= 8)
+        RTTEST_CHECK(hTest, RT_LE2H_U32(((uint32_t const *)pvData)[1]) & STAMBINSNAP_F_FULL);
+
+    RTTEST_CHECK_RC_OK(hTest, STAMR3BinSnapshotDestroy(hSnap));
+    RTTEST_CHECK_RC_OK(hTest, STAMR3Deregister(pUVM, "/tstVMM/Snapshot/*"));
+}
+
+
 /** PDMR3LdrEnumModules callback, see FNPDMR3ENUM. */
 static DECLCALLBACK(int)
 tstVMMLdrEnum(PVM pVM, const char *pszFilename, const char *pszName, RTUINTPTR ImageBase, size_t cbImage,
@@ -219,7 +405,7 @@ extern "C" DECLEXPORT(int) TrustedMain(int argc, char **argv, char **envp)
     };
     enum
     {
-        kTstVMMTest_VMM,  kTstVMMTest_TM, kTstVMMTest_MSRs, kTstVMMTest_KnownMSRs, kTstVMMTest_MSRExperiments
+        kTstVMMTest_VMM,  kTstVMMTest_TM, kTstVMMTest_TMStress, kTstVMMTest_STAM, kTstVMMTest_MSRs, kTstVMMTest_KnownMSRs, kTstVMMTest_MSRExperiments
     } enmTestOpt = kTstVMMTest_VMM;
 
     int ch;
@@ -239,6 +425,10 @@ extern "C" DECLEXPORT(int) TrustedMain(int argc, char **argv, char **envp)
                     enmTestOpt = kTstVMMTest_VMM;
                 else if (!strcmp("tm", ValueUnion.psz))
                     enmTestOpt = kTstVMMTest_TM;
+                else if (!strcmp("tm-stress", ValueUnion.psz))
+                    enmTestOpt = kTstVMMTest_TMStress;
+                else if (!strcmp("stam", ValueUnion.psz))
+                    enmTestOpt = kTstVMMTest_STAM;
                 else if (!strcmp("msr", ValueUnion.psz) || !strcmp("msrs", ValueUnion.psz))
                     enmTestOpt = kTstVMMTest_MSRs;
                 else if (!strcmp("known-msr", ValueUnion.psz) || !strcmp("known-msrs", ValueUnion.psz))
@@ -257,7 +447,7 @@ extern "C" DECLEXPORT(int) TrustedMain(int argc, char **argv, char **envp)
                 break;
 
             case 'h':
-                RTPrintf("usage: tstVMM [--cpus|-c cpus] [-s] [--test <vmm|tm|msrs|known-msrs>]\n");
+                RTPrintf("usage: tstVMM [--cpus|-c cpus] [-s] [--test <vmm|tm|tm-stress|stam|msrs|known-msrs>]\n");
                 return 1;
 
             case 'V':
@@ -316,6 +506,22 @@ extern "C" DECLEXPORT(int) TrustedMain(int argc, char **argv, char **envp)
                 break;
             }
 
+            case kTstVMMTest_TMStress:
+            {
+                RTTestSub(hTest, "TM stress");
+                rc = VMR3ReqCallWaitU(pUVM, 0 /*idDstCpu*/, (PFNRT)tstTMStressWorker, 2, pVM, hTest);
+                if (RT_FAILURE(rc))
+                    RTTestFailed(hTest, "tstTMStressWorker failed: rc=%Rrc\n", rc);
+                if (g_fStat)
+                    STAMR3Dump(pUVM, "*");
+                break;
+            }
+
+            case kTstVMMTest_STAM:
+                RTTestSub(hTest, "STAM snapshots");
+                tstSTAMSnapshot(pUVM, hTest);
+                break;
+
             case kTstVMMTest_MSRs:
             {
                 RTTestSub(hTest, "MSRs");